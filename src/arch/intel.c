@@ -16,6 +16,7 @@
 #include "arch/probe.h"
 
 /* flags we export */
+int ceph_arch_intel_aesni = 0;
 int ceph_arch_intel_pclmul = 0;
 int ceph_arch_intel_sse42 = 0;
 int ceph_arch_intel_sse41 = 0;
@@ -45,6 +46,7 @@ static void do_cpuid(unsigned int *eax, unsigned int *ebx, unsigned int *ecx,
 
 /* http://en.wikipedia.org/wiki/CPUID#EAX.3D1:_Processor_Info_and_Feature_Bits */
 
+#define CPUID_AESNI	(1 << 25)
 #define CPUID_PCLMUL	(1 << 1)
 #define CPUID_SSE42	(1 << 20)
 #define CPUID_SSE41	(1 << 19)
@@ -57,6 +59,9 @@ int ceph_arch_intel_probe(void)
 	/* i know how to check this on x86_64... */
 	unsigned int eax = 1, ebx, ecx, edx;
 	do_cpuid(&eax, &ebx, &ecx, &edx);
+	if ((ecx & CPUID_AESNI) != 0) {
+		ceph_arch_intel_aesni = 1;
+	}
 	if ((ecx & CPUID_PCLMUL) != 0) {
 		ceph_arch_intel_pclmul = 1;
 	}
@@ -21,10 +21,21 @@ class CephContext;
 class CephxSessionHandler  : public AuthSessionHandler {
   uint64_t features;
 
+#ifdef __x86_64__
+  // AES-128 round keys, expanded once from the session key so the
+  // per-message signature path can encrypt its single block with AES-NI
+  // instead of going through the generic crypto handler.
+  uint32_t aes_round_key[44] __attribute__ ((aligned(16)));
+  bool use_aesni;
+#endif
+  void _setup_aes_fast_path();
+
 public:
   CephxSessionHandler(CephContext *cct_, CryptoKey session_key, uint64_t features)
     : AuthSessionHandler(cct_, CEPH_AUTH_CEPHX, session_key),
-      features(features) {}
+      features(features) {
+    _setup_aes_fast_path();
+  }
   ~CephxSessionHandler() {}
   
   bool no_security() {
@@ -406,10 +406,19 @@ int main(int argc, const char **argv)
 	 << TEXT_NORMAL << dendl;
   }
 
+  // replication/backfill traffic may run on a different transport than
+  // client traffic (e.g. xio/rdma on the cluster network while clients
+  // stay on tcp).  the heartbeat messengers stay on ms_type: the single
+  // hb client pings peers on both the public and cluster networks, so
+  // it cannot commit to a transport only cluster peers speak.
+  std::string cluster_msg_type =
+    g_conf->ms_cluster_type.empty() ? g_conf->ms_type :
+				      g_conf->ms_cluster_type;
+
   Messenger *ms_public = Messenger::create(g_ceph_context, g_conf->ms_type,
 					   entity_name_t::OSD(whoami), "client",
 					   getpid());
-  Messenger *ms_cluster = Messenger::create(g_ceph_context, g_conf->ms_type,
+  Messenger *ms_cluster = Messenger::create(g_ceph_context, cluster_msg_type,
 					    entity_name_t::OSD(whoami), "cluster",
 					    getpid(), CEPH_FEATURES_ALL);
   Messenger *ms_hbclient = Messenger::create(g_ceph_context, g_conf->ms_type,
@@ -477,9 +486,13 @@ int main(int argc, const char **argv)
 
   ms_cluster->set_default_policy(Messenger::Policy::stateless_server(0, 0));
   ms_cluster->set_policy(entity_name_t::TYPE_MON, Messenger::Policy::lossy_client(0,0));
-  ms_cluster->set_policy(entity_name_t::TYPE_OSD,
-			 Messenger::Policy::lossless_peer(supported,
-							  osd_required));
+  {
+    Messenger::Policy p = Messenger::Policy::lossless_peer(supported,
+							   osd_required);
+    // replication links crossing a WAN benefit from on-wire compression
+    p.compress = g_conf->osd_compress_cluster_messages;
+    ms_cluster->set_policy(entity_name_t::TYPE_OSD, p);
+  }
   ms_cluster->set_policy(entity_name_t::TYPE_CLIENT,
 			 Messenger::Policy::stateless_server(0, 0));
 
@@ -528,6 +541,13 @@ int main(int argc, const char **argv)
   global_init_daemonize(g_ceph_context, 0);
   common_init_finish(g_ceph_context);
 
+  if (g_conf->buffer_hugepage_pool_size &&
+      !buffer::init_hugepage_pool(g_conf->buffer_hugepage_pool_size)) {
+    derr << "unable to reserve " << g_conf->buffer_hugepage_pool_size
+	 << " bytes of hugepages for the buffer pool; check vm.nr_hugepages"
+	 << dendl;
+  }
+
   MonClient mc(g_ceph_context);
   if (mc.build_initial_monmap() < 0)
     return -1;
@@ -917,8 +917,8 @@ void Client::update_dentry_lease(Dentry *dn, LeaseStat *dlease, utime_t from, Me
 {
   utime_t dttl = from;
   dttl += (float)dlease->duration_ms / 1000.0;
-  
-  assert(dn && dn->inode);
+
+  assert(dn);  // dn->inode may be NULL for a negative dentry
 
   if (dlease->mask & CEPH_LOCK_DN) {
     if (dttl > dn->lease_ttl) {
@@ -1157,8 +1157,9 @@ Inode* Client::insert_trace(MetaRequest *request, MetaSession *session)
                           ((request->head.op == CEPH_MDS_OP_RENAME) ?
                                         request->old_dentry() : NULL));
     } else {
+      Dentry *dn = NULL;
       if (diri->dir && diri->dir->dentries.count(dname)) {
-	Dentry *dn = diri->dir->dentries[dname];
+	dn = diri->dir->dentries[dname];
 	if (dn->inode) {
 	  diri->dir->ordered_count++;
 	  if (diri->flags & I_DIR_ORDERED) {
@@ -1168,6 +1169,15 @@ Inode* Client::insert_trace(MetaRequest *request, MetaSession *session)
 	  unlink(dn, true, true);  // keep dir, dentry
 	}
       }
+      if (dlease.duration_ms > 0) {
+	// negative dentry: cache the absence under the mds lease so
+	// repeated lookups of the missing name stay local
+	if (!dn) {
+	  Dir *dir = diri->open_dir();
+	  dn = link(dir, dname, NULL, NULL);
+	}
+	update_dentry_lease(dn, &dlease, request->sent_stamp, session);
+      }
     }
   } else if (reply->head.op == CEPH_MDS_OP_LOOKUPSNAP ||
 	     reply->head.op == CEPH_MDS_OP_MKSNAP) {
@@ -3069,8 +3079,16 @@ void Client::check_caps(Inode *in, bool is_delayed)
     if (wanted & ~(cap->wanted | cap->issued))
       goto ack;
 
-    if (!revoking && unmounting && (cap_used == 0))
+    if (!revoking && unmounting && (cap_used == 0)) {
+      // tearing down a clean inode: drop the cap outright and let the
+      // batched release message carry it, instead of sending a full
+      // per-inode MClientCaps just to say goodbye
+      if (!in->dirty_caps && !in->flushing_caps && in->cap_snaps.empty()) {
+	remove_cap(cap, true);
+	continue;
+      }
       goto ack;
+    }
 
     if (wanted == cap->wanted &&         // mds knows what we want.
 	((cap->issued & ~retain) == 0) &&// and we don't have anything we wouldn't like
@@ -3535,6 +3553,10 @@ void Client::remove_cap(Cap *cap, bool queue_release)
       cap->issue_seq,
       cap->mseq,
       cap_epoch_barrier);
+    // don't let the batched release message grow without bound; a big
+    // cache trim can queue tens of thousands of entries between ticks
+    if (session->release->caps.size() >= (size_t)cct->_conf->client_max_cap_releases)
+      flush_cap_releases();
   }
 
   if (in->auth_cap == cap) {
@@ -5136,10 +5158,35 @@ int Client::_do_lookup(Inode *dir, const string& name, InodeRef *target)
   return r;
 }
 
+/*
+ * Pull a whole directory into the cache with readdir requests.  Each
+ * reply carries many dentries with their inodes, leases and caps, so a
+ * directory walk that would otherwise do one lookup round trip per
+ * entry pays one round trip per fragment instead.
+ */
+int Client::_readdir_prefetch(Inode *diri)
+{
+  ldout(cct, 10) << "_readdir_prefetch " << *diri << dendl;
+
+  dir_result_t dirp(diri);
+  int r = 0;
+  while (!dirp.at_end()) {
+    r = _readdir_get_frag(&dirp);
+    if (r < 0)
+      break;
+    if (dirp.last_name.empty())
+      dirp.next_frag();     // frag exhausted, move to the next one
+    /* else: continue the same frag from last_name */
+  }
+  _readdir_drop_dirp_buffer(&dirp);
+  return r;
+}
+
 int Client::_lookup(Inode *dir, const string& dname, InodeRef *target)
 {
   int r = 0;
   Dentry *dn = NULL;
+  bool prefetched = false;
 
   if (!dir->is_dir()) {
     r = -ENOTDIR;
@@ -5170,6 +5217,7 @@ int Client::_lookup(Inode *dir, const string& dname, InodeRef *target)
     goto done;
   }
 
+ retry:
   if (dir->dir &&
       dir->dir->dentries.count(dname)) {
     dn = dir->dir->dentries[dname];
@@ -5217,10 +5265,25 @@ int Client::_lookup(Inode *dir, const string& dname, InodeRef *target)
     }
   }
 
+  // a run of uncached lookups in the same directory looks like a
+  // directory walk; batch the remaining round trips by prefetching the
+  // whole directory through readdir, then retry from the cache
+  if (!prefetched &&
+      cct->_conf->client_dir_prefetch_min_misses > 0 &&
+      ++dir->lookup_misses >= (unsigned)cct->_conf->client_dir_prefetch_min_misses &&
+      !(dir->flags & I_COMPLETE) &&
+      dir->dirstat.size() <= cct->_conf->client_dir_prefetch_max_entries) {
+    dir->lookup_misses = 0;
+    prefetched = true;
+    if (_readdir_prefetch(dir) >= 0)
+      goto retry;
+  }
+
   r = _do_lookup(dir, dname, target);
   goto done;
 
  hit_dn:
+  dir->lookup_misses = 0;
   if (dn->inode) {
     *target = dn->inode;
   } else {
@@ -7523,7 +7586,7 @@ int Client::_preadv_pwritev(int fd, const struct iovec *iov, unsigned iovcnt, in
 }
 
 int Client::_write(Fh *f, int64_t offset, uint64_t size, const char *buf,
-                  const struct iovec *iov, int iovcnt)
+                  const struct iovec *iov, int iovcnt, bufferlist *write_bl)
 {
   if ((uint64_t)(offset+size) > mdsmap->get_max_filesize()) //too large!
     return -EFBIG;
@@ -7577,7 +7640,10 @@ int Client::_write(Fh *f, int64_t offset, uint64_t size, const char *buf,
   // copy into fresh buffer (since our write may be resub, async)
   bufferlist bl;
   bufferptr *bparr = NULL;
-  if (buf) {
+  if (write_bl) {
+    // caller-owned buffer (e.g. spliced out of the fuse device); no copy
+    bl.claim(*write_bl);
+  } else if (buf) {
       bufferptr bp;
       if (size > 0) bp = buffer::copy(buf, size);
       bl.push_back( bp );
@@ -10308,6 +10374,23 @@ int Client::ll_write(Fh *fh, loff_t off, loff_t len, const char *data)
   return r;
 }
 
+int Client::ll_write(Fh *fh, loff_t off, bufferlist& bl)
+{
+  Mutex::Locker lock(client_lock);
+  loff_t len = bl.length();
+  ldout(cct, 3) << "ll_write " << fh << " " << fh->inode->ino << " " << off <<
+    "~" << len << " (bl)" << dendl;
+  tout(cct) << "ll_write" << std::endl;
+  tout(cct) << (unsigned long)fh << std::endl;
+  tout(cct) << off << std::endl;
+  tout(cct) << len << std::endl;
+
+  int r = _write(fh, off, len, NULL, NULL, 0, &bl);
+  ldout(cct, 3) << "ll_write " << fh << " " << off << "~" << len << " = " << r
+		<< dendl;
+  return r;
+}
+
 int Client::ll_flush(Fh *fh)
 {
   Mutex::Locker lock(client_lock);
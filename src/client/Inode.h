@@ -228,6 +228,7 @@ struct Inode {
   // about the dir (if this is one!)
   set<int>  dir_contacts;
   bool      dir_hashed, dir_replicated;
+  unsigned  lookup_misses;   // consecutive uncached lookups, drives readdir prefetch
 
   // per-mds caps
   map<mds_rank_t, Cap*> caps;            // mds -> Cap
@@ -303,7 +304,7 @@ struct Inode {
       inline_version(0),
       flags(0),
       qtree(NULL),
-      dir_hashed(false), dir_replicated(false), auth_cap(NULL),
+      dir_hashed(false), dir_replicated(false), lookup_misses(0), auth_cap(NULL),
       dirty_caps(0), flushing_caps(0), flushing_cap_seq(0), shared_gen(0), cache_gen(0),
       snap_caps(0), snap_cap_refs(0),
       cap_item(this), flushing_cap_item(this), last_flush_tid(0),
@@ -32,6 +32,7 @@
 #include "Fh.h"
 #include "ioctl.h"
 #include "common/config.h"
+#include "common/Thread.h"
 #include "include/assert.h"
 
 #include "fuse_ll.h"
@@ -69,6 +70,7 @@ public:
   int init(int argc, const char *argv[]);
   int start();
   int loop();
+  void dispatch(int *res);
   void finalize();
 
   uint64_t fino_snap(uint64_t fino);
@@ -93,6 +95,17 @@ public:
   struct fuse_args args;
 };
 
+class FuseDispatchThread : public Thread {
+  CephFuse::Handle *handle;
+public:
+  int res;
+  FuseDispatchThread(CephFuse::Handle *h) : handle(h), res(0) {}
+  void *entry() {
+    handle->dispatch(&res);
+    return NULL;
+  }
+};
+
 static void fuse_ll_lookup(fuse_req_t req, fuse_ino_t parent, const char *name)
 {
   CephFuse::Handle *cfuse = (CephFuse::Handle *)fuse_req_userdata(req);
@@ -443,10 +456,35 @@ static void fuse_ll_read(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off,
   Fh *fh = reinterpret_cast<Fh*>(fi->fh);
   bufferlist bl;
   int r = cfuse->client->ll_read(fh, off, size, &bl);
-  if (r >= 0)
+  if (r >= 0) {
+#if FUSE_VERSION >= FUSE_MAKE_VERSION(2, 9)
+    // hand libfuse the fragment list as-is; with splice enabled the
+    // data goes to the fuse device without a contiguity rebuild
+    const std::list<bufferptr>& ls = bl.buffers();
+    if (ls.size() > 1) {
+      struct fuse_bufvec *bufv = (struct fuse_bufvec *)calloc(
+	1, sizeof(struct fuse_bufvec) +
+	   (ls.size() - 1) * sizeof(struct fuse_buf));
+      if (bufv) {
+	unsigned n = 0;
+	for (std::list<bufferptr>::const_iterator p = ls.begin();
+	     p != ls.end(); ++p) {
+	  bufv->buf[n].mem = (void *)p->c_str();
+	  bufv->buf[n].size = p->length();
+	  n++;
+	}
+	bufv->count = n;
+	fuse_reply_data(req, bufv, FUSE_BUF_SPLICE_MOVE);
+	free(bufv);
+	return;
+      }
+      // allocation failed; fall through to the contiguous reply
+    }
+#endif
     fuse_reply_buf(req, bl.c_str(), bl.length());
-  else
+  } else {
     fuse_reply_err(req, -r);
+  }
 }
 
 static void fuse_ll_write(fuse_req_t req, fuse_ino_t ino, const char *buf,
@@ -461,6 +499,64 @@ static void fuse_ll_write(fuse_req_t req, fuse_ino_t ino, const char *buf,
     fuse_reply_err(req, -r);
 }
 
+#if FUSE_VERSION >= FUSE_MAKE_VERSION(2, 9)
+static void fuse_ll_write_buf(fuse_req_t req, fuse_ino_t ino,
+			      struct fuse_bufvec *bufv, off_t off,
+			      struct fuse_file_info *fi)
+{
+  CephFuse::Handle *cfuse = (CephFuse::Handle *)fuse_req_userdata(req);
+  Fh *fh = reinterpret_cast<Fh*>(fi->fh);
+  size_t size = fuse_buf_size(bufv);
+  bufferlist bl;
+  bool gathered = false;
+
+  // with splice_read enabled the data arrives as an fd-backed segment;
+  // splice it straight into a pipe-backed raw, deferring the only
+  // memory copy to where the osd write needs contiguous data
+  if (bufv->count == bufv->idx + 1 && bufv->off == 0) {
+    struct fuse_buf *fb = &bufv->buf[bufv->idx];
+    if (fb->flags & FUSE_BUF_IS_FD) {
+      int64_t pos = fb->pos;
+      try {
+	bufferptr bp(buffer::create_zero_copy(
+	  fb->size, fb->fd, (fb->flags & FUSE_BUF_FD_SEEK) ? &pos : NULL));
+	if (bp.length() == fb->size) {
+	  bl.push_back(bp);
+	  gathered = true;
+	} else {
+	  // partial splice consumed the source; we cannot retry
+	  fuse_reply_err(req, EIO);
+	  return;
+	}
+      } catch (buffer::error &e) {
+	// no splice support or pipe limit hit; fall back to copying
+      }
+    }
+  }
+
+  if (!gathered) {
+    bufferptr bp = buffer::create(size);
+    struct fuse_bufvec dst;
+    memset(&dst, 0, sizeof(dst));
+    dst.count = 1;
+    dst.buf[0].mem = bp.c_str();
+    dst.buf[0].size = size;
+    ssize_t res = fuse_buf_copy(&dst, bufv, (enum fuse_buf_copy_flags)0);
+    if (res < 0) {
+      fuse_reply_err(req, -res);
+      return;
+    }
+    bl.append(bp, 0, res);
+  }
+
+  int r = cfuse->client->ll_write(fh, off, bl);
+  if (r >= 0)
+    fuse_reply_write(req, r);
+  else
+    fuse_reply_err(req, -r);
+}
+#endif
+
 static void fuse_ll_flush(fuse_req_t req, fuse_ino_t ino,
 			  struct fuse_file_info *fi)
 {
@@ -781,9 +877,28 @@ static int remount_cb(void *handle)
   return r;
 }
 
-static void do_init(void *data, fuse_conn_info *bar)
+static void do_init(void *data, fuse_conn_info *conn)
 {
   CephFuse::Handle *cfuse = (CephFuse::Handle *)data;
+  Client *client = cfuse->client;
+
+#if FUSE_VERSION >= FUSE_MAKE_VERSION(2, 9)
+  if (client->cct->_conf->fuse_splice_read &&
+      (conn->capable & FUSE_CAP_SPLICE_READ))
+    conn->want |= FUSE_CAP_SPLICE_READ;
+  if (client->cct->_conf->fuse_splice_write &&
+      (conn->capable & FUSE_CAP_SPLICE_WRITE))
+    conn->want |= FUSE_CAP_SPLICE_WRITE;
+  if (client->cct->_conf->fuse_splice_move &&
+      (conn->capable & FUSE_CAP_SPLICE_MOVE))
+    conn->want |= FUSE_CAP_SPLICE_MOVE;
+#endif
+#ifdef FUSE_CAP_WRITEBACK_CACHE
+  if (client->cct->_conf->fuse_writeback_cache &&
+      (conn->capable & FUSE_CAP_WRITEBACK_CACHE))
+    conn->want |= FUSE_CAP_WRITEBACK_CACHE;
+#endif
+
   if (cfuse->fd_on_success) {
     //cout << "fuse init signaling on fd " << fd_on_success << std::endl;
     uint32_t r = 0;
@@ -846,7 +961,7 @@ const static struct fuse_lowlevel_ops fuse_ll_oper = {
  poll: 0,
 #endif
 #if FUSE_VERSION >= FUSE_MAKE_VERSION(2, 9)
- write_buf: 0,
+ write_buf: fuse_ll_write_buf,
  retrieve_reply: 0,
  forget_multi: 0,
  flock: fuse_ll_flock,
@@ -986,10 +1101,62 @@ int CephFuse::Handle::start()
   return 0;
 }
 
+/*
+ * One dispatch worker: read requests off the channel and process them.
+ * Multiple workers can safely read the same channel concurrently; that
+ * is exactly what libfuse's own loop_mt does.
+ */
+void CephFuse::Handle::dispatch(int *res)
+{
+  size_t bufsize = fuse_chan_bufsize(ch);
+  char *buf = new char[bufsize];
+
+  while (!fuse_session_exited(se)) {
+    struct fuse_chan *tmpch = ch;
+    int r = fuse_chan_recv(&tmpch, buf, bufsize);
+    if (r == -EINTR || r == -EAGAIN)
+      continue;
+    if (r <= 0) {
+      if (r < 0 && r != -ENODEV)  // ENODEV means we got unmounted
+	*res = r;
+      fuse_session_exit(se);
+      break;
+    }
+    fuse_session_process(se, buf, r, tmpch);
+  }
+
+  delete[] buf;
+}
+
 int CephFuse::Handle::loop()
 {
   if (client->cct->_conf->fuse_multithreaded) {
-    return fuse_session_loop_mt(se);
+    int threads = client->cct->_conf->fuse_dispatch_threads;
+    if (threads <= 0) {
+      // libfuse spawns a thread per concurrent request on its own
+      return fuse_session_loop_mt(se);
+    }
+
+    // fixed pool, so a burst of slow requests can't fork off an
+    // unbounded number of threads
+    list<FuseDispatchThread*> workers;
+    for (int i = 0; i < threads; i++) {
+      FuseDispatchThread *t = new FuseDispatchThread(this);
+      t->create();
+      workers.push_back(t);
+    }
+
+    int r = 0;
+    while (!workers.empty()) {
+      FuseDispatchThread *t = workers.front();
+      workers.pop_front();
+      t->join();
+      if (t->res < 0)
+	r = t->res;
+      delete t;
+    }
+    fuse_session_reset(se);
+    return r;
   } else {
     return fuse_session_loop(se);
   }
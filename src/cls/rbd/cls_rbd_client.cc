@@ -790,6 +790,14 @@ namespace librbd {
       return ioctx->exec(oid, "rbd", "metadata_set", in, out);
     }
 
+    void metadata_set(librados::ObjectWriteOperation *op,
+                      const map<string, bufferlist> &data)
+    {
+      bufferlist in;
+      ::encode(data, in);
+      op->exec("rbd", "metadata_set", in);
+    }
+
     int metadata_remove(librados::IoCtx *ioctx, const std::string &oid,
                         const std::string &key)
     {
@@ -799,6 +807,14 @@ namespace librbd {
       return ioctx->exec(oid, "rbd", "metadata_remove", in, out);
     }
 
+    void metadata_remove(librados::ObjectWriteOperation *op,
+                         const std::string &key)
+    {
+      bufferlist in;
+      ::encode(key, in);
+      op->exec("rbd", "metadata_remove", in);
+    }
+
     int metadata_list(librados::IoCtx *ioctx, const std::string &oid,
                       const std::string &start, uint64_t max_return,
                       map<string, bufferlist> *pairs)
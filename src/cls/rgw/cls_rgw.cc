@@ -400,6 +400,21 @@ static int read_bucket_header(cls_method_context_t hctx, struct rgw_bucket_dir_h
   return 0;
 }
 
+/* advance a key to the first string that sorts after every key sharing
+ * it as a prefix; returns false if no such string exists (all 0xff) */
+static bool key_successor(string *key)
+{
+  while (!key->empty()) {
+    unsigned char c = (*key)[key->size() - 1];
+    if (c != 0xff) {
+      (*key)[key->size() - 1] = c + 1;
+      return true;
+    }
+    key->resize(key->size() - 1);
+  }
+  return false;
+}
+
 int rgw_bucket_list(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
 {
   bufferlist::iterator iter = in->begin();
@@ -422,55 +437,82 @@ int rgw_bucket_list(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
 
   bufferlist bl;
 
-  map<string, bufferlist> keys;
   string start_key;
   encode_list_index_key(hctx, op.start_obj, &start_key);
-  rc = get_obj_vals(hctx, start_key, op.filter_prefix, op.num_entries + 1, &keys);
-  if (rc < 0)
-    return rc;
 
   std::map<string, struct rgw_bucket_dir_entry>& m = new_dir.m;
-  std::map<string, bufferlist>::iterator kiter = keys.begin();
-  uint32_t i;
 
+  uint32_t left = op.num_entries;
   bool done = false;
+  bool more = false;
+  bool reseek = false;
 
-  for (i = 0; i < op.num_entries && kiter != keys.end(); ++i, ++kiter) {
-    struct rgw_bucket_dir_entry entry;
+  /* with a delimiter, common-prefix heavy ranges are skipped over with key
+   * seeks instead of being scanned entry by entry: once an entry marks a
+   * common prefix, only its first entry is returned and the scan restarts
+   * past the prefix's upper bound */
+  do {
+    map<string, bufferlist> keys;
+    rc = get_obj_vals(hctx, start_key, op.filter_prefix, left + 1, &keys);
+    if (rc < 0)
+      return rc;
 
-    if (!bi_is_objs_index(kiter->first)) {
-      done = true;
-      break;
-    }
+    std::map<string, bufferlist>::iterator kiter = keys.begin();
+    uint32_t i;
 
-    bufferlist& entrybl = kiter->second;
-    bufferlist::iterator eiter = entrybl.begin();
-    try {
-      ::decode(entry, eiter);
-    } catch (buffer::error& err) {
-      CLS_LOG(1, "ERROR: rgw_bucket_list(): failed to decode entry, key=%s\n", kiter->first.c_str());
-      return -EINVAL;
-    }
+    reseek = false;
 
-    cls_rgw_obj_key key;
-    uint64_t ver;
-    decode_list_index_key(kiter->first, &key, &ver);
+    for (i = 0; i < left && kiter != keys.end() && !reseek; ++i, ++kiter) {
+      struct rgw_bucket_dir_entry entry;
 
-    if (!entry.is_valid()) {
-      CLS_LOG(20, "entry %s[%s] is not valid\n", key.name.c_str(), key.instance.c_str());
-      continue;
-    }
+      if (!bi_is_objs_index(kiter->first)) {
+        done = true;
+        break;
+      }
 
-    if (!op.list_versions && !entry.is_visible()) {
-      CLS_LOG(20, "entry %s[%s] is not visible\n", key.name.c_str(), key.instance.c_str());
-      continue;
+      bufferlist& entrybl = kiter->second;
+      bufferlist::iterator eiter = entrybl.begin();
+      try {
+        ::decode(entry, eiter);
+      } catch (buffer::error& err) {
+        CLS_LOG(1, "ERROR: rgw_bucket_list(): failed to decode entry, key=%s\n", kiter->first.c_str());
+        return -EINVAL;
+      }
+
+      cls_rgw_obj_key key;
+      uint64_t ver;
+      decode_list_index_key(kiter->first, &key, &ver);
+
+      if (!entry.is_valid()) {
+        CLS_LOG(20, "entry %s[%s] is not valid\n", key.name.c_str(), key.instance.c_str());
+        continue;
+      }
+
+      if (!op.list_versions && !entry.is_visible()) {
+        CLS_LOG(20, "entry %s[%s] is not visible\n", key.name.c_str(), key.instance.c_str());
+        continue;
+      }
+      m[kiter->first] = entry;
+
+      CLS_LOG(20, "got entry %s[%s] m.size()=%d\n", key.name.c_str(), key.instance.c_str(), (int)m.size());
+
+      if (!op.delimiter.empty()) {
+        int delim_pos = key.name.find(op.delimiter, op.filter_prefix.size());
+        if (delim_pos >= 0) {
+          string skip = key.name.substr(0, delim_pos + op.delimiter.size());
+          if (key_successor(&skip)) {
+            start_key = skip;
+            reseek = true;
+          }
+        }
+      }
     }
-    m[kiter->first] = entry;
 
-    CLS_LOG(20, "got entry %s[%s] m.size()=%d\n", key.name.c_str(), key.instance.c_str(), (int)m.size());
-  }
+    left -= i;
+    more = (kiter != keys.end());
+  } while (reseek && left > 0 && !done);
 
-  ret.is_truncated = (kiter != keys.end() && !done);
+  ret.is_truncated = (!done && (more || reseek));
 
   ::encode(ret, *out);
   return 0;
@@ -895,6 +937,7 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
 
   list<cls_rgw_obj_key>::iterator remove_iter;
   CLS_LOG(20, "rgw_bucket_complete_op(): remove_objs.size()=%d\n", (int)op.remove_objs.size());
+  set<string> remove_idx;
   for (remove_iter = op.remove_objs.begin(); remove_iter != op.remove_objs.end(); ++remove_iter) {
     cls_rgw_obj_key& remove_key = *remove_iter;
     CLS_LOG(1, "rgw_bucket_complete_op(): removing entries, read_index_entry name=%s instance=%s\n",
@@ -918,10 +961,14 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
         continue;
     }
 
-    ret = cls_cxx_map_remove_key(hctx, k);
+    remove_idx.insert(k);
+  }
+
+  /* one OMAPRMKEYS call covers the whole batch */
+  if (!remove_idx.empty()) {
+    int ret = cls_cxx_map_remove_keys(hctx, remove_idx);
     if (ret < 0) {
-      CLS_LOG(1, "rgw_bucket_complete_op(): cls_cxx_map_remove_key, failed to remove entry, name=%s instance=%s read_index_entry ret=%d\n", remove_key.name.c_str(), remove_key.instance.c_str(), rc);
-      continue;
+      CLS_LOG(1, "rgw_bucket_complete_op(): cls_cxx_map_remove_keys, failed to remove entries ret=%d\n", ret);
     }
   }
 
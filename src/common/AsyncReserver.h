@@ -22,6 +22,8 @@
 #include "common/Mutex.h"
 #include "common/Finisher.h"
 #include "common/Formatter.h"
+#include "common/Clock.h"
+#include "include/stringify.h"
 
 /**
  * Manages a configurable number of asyncronous reservations.
@@ -29,32 +31,107 @@
  * Memory usage is linear with the number of items queued and
  * linear with respect to the total number of priorities used
  * over all time.
+ *
+ * Each reservation belongs to a group (e.g. a pool); groups may be
+ * given a concurrency limit so one group cannot consume every slot,
+ * and a priority bonus so its requests queue ahead of others.  Waiting
+ * requests optionally age: every age_interval seconds spent queued
+ * raises a request's effective priority by one, so low-priority groups
+ * are delayed but never starved.
  */
 template <typename T>
 class AsyncReserver {
   Finisher *f;
   unsigned max_allowed;
   unsigned min_priority;
+  double age_interval;  ///< seconds queued per priority step, 0 = no aging
   Mutex lock;
 
-  map<unsigned, list<pair<T, Context*> > > queues;
-  map<T, pair<unsigned, typename list<pair<T, Context*> >::iterator > > queue_pointers;
-  set<T> in_progress;
+  struct Request {
+    T item;
+    Context *on_reserved;
+    unsigned base_prio;   ///< priority at request time (incl. group bonus)
+    uint64_t group;
+    utime_t queued;
+  };
+
+  map<unsigned, list<Request> > queues;
+  map<T, pair<unsigned, typename list<Request>::iterator > > queue_pointers;
+  map<T, uint64_t> in_progress;            ///< item -> group
+  map<uint64_t, unsigned> group_in_progress;
+  map<uint64_t, unsigned> group_limit;     ///< absent or 0 = unlimited
+  map<uint64_t, unsigned> group_prio_bonus;
+
+  unsigned effective_prio(const Request& r, utime_t now) const {
+    if (age_interval <= 0)
+      return r.base_prio;
+    double bonus = (double)(now - r.queued) / age_interval;
+    if (bonus >= (double)(MAX_PRIORITY - r.base_prio))
+      return MAX_PRIORITY;
+    return r.base_prio + (unsigned)bonus;
+  }
+
+  bool group_at_limit(uint64_t group) const {
+    typename map<uint64_t, unsigned>::const_iterator l =
+      group_limit.find(group);
+    if (l == group_limit.end() || !l->second)
+      return false;
+    typename map<uint64_t, unsigned>::const_iterator p =
+      group_in_progress.find(group);
+    return p != group_in_progress.end() && p->second >= l->second;
+  }
+
+  /// move requests whose age raised their effective priority
+  void age_queues() {
+    if (age_interval <= 0)
+      return;
+    utime_t now = ceph_clock_now(NULL);
+    list<Request> promoted;
+    for (typename map<unsigned, list<Request> >::iterator it = queues.begin();
+	 it != queues.end();
+	 ++it) {
+      typename list<Request>::iterator i = it->second.begin();
+      while (i != it->second.end()) {
+	if (effective_prio(*i, now) > it->first) {
+	  queue_pointers.erase(i->item);
+	  promoted.push_back(*i);
+	  it->second.erase(i++);
+	} else {
+	  ++i;
+	}
+      }
+    }
+    for (typename list<Request>::iterator i = promoted.begin();
+	 i != promoted.end();
+	 ++i) {
+      unsigned prio = effective_prio(*i, now);
+      queues[prio].push_back(*i);
+      queue_pointers.insert(
+	make_pair(i->item, make_pair(prio, --(queues[prio]).end())));
+    }
+  }
 
   void do_queues() {
-    typename map<unsigned, list<pair<T, Context*> > >::reverse_iterator it;
+    age_queues();
+    typename map<unsigned, list<Request> >::reverse_iterator it;
     for (it = queues.rbegin();
          it != queues.rend() &&
 	   in_progress.size() < max_allowed &&
 	   it->first >= min_priority;
          ++it) {
-      while (in_progress.size() < max_allowed &&
-             !it->second.empty()) {
-        pair<T, Context*> p = it->second.front();
-        queue_pointers.erase(p.first);
-        it->second.pop_front();
-        f->queue(p.second);
-        in_progress.insert(p.first);
+      typename list<Request>::iterator i = it->second.begin();
+      while (i != it->second.end() &&
+	     in_progress.size() < max_allowed) {
+	if (group_at_limit(i->group)) {
+	  // leave it queued; other groups may still proceed
+	  ++i;
+	  continue;
+	}
+        queue_pointers.erase(i->item);
+        f->queue(i->on_reserved);
+        in_progress[i->item] = i->group;
+	group_in_progress[i->group]++;
+	it->second.erase(i++);
       }
     }
   }
@@ -66,6 +143,7 @@ public:
     : f(f),
       max_allowed(max_allowed),
       min_priority(min_priority),
+      age_interval(0),
       lock("AsyncReserver::lock") {}
 
   void set_max(unsigned max) {
@@ -80,29 +158,78 @@ public:
     do_queues();
   }
 
+  /// set seconds of queueing per priority step, 0 to disable aging
+  void set_age_interval(double interval) {
+    Mutex::Locker l(lock);
+    age_interval = interval;
+    do_queues();
+  }
+
+  /// cap concurrent reservations for a group, 0 to remove the cap
+  void set_group_limit(uint64_t group, unsigned max) {
+    Mutex::Locker l(lock);
+    if (max)
+      group_limit[group] = max;
+    else
+      group_limit.erase(group);
+    do_queues();
+  }
+
+  /// priority added to future requests from a group, 0 to remove
+  void set_group_priority(uint64_t group, unsigned bonus) {
+    Mutex::Locker l(lock);
+    if (bonus)
+      group_prio_bonus[group] = bonus;
+    else
+      group_prio_bonus.erase(group);
+  }
+
+  /// drop per-group settings for groups not in the given maps
+  void set_group_config(const map<uint64_t, unsigned>& limits,
+			const map<uint64_t, unsigned>& bonuses) {
+    Mutex::Locker l(lock);
+    group_limit = limits;
+    group_prio_bonus = bonuses;
+    do_queues();
+  }
+
   void dump(Formatter *f) {
     Mutex::Locker l(lock);
     f->dump_unsigned("max_allowed", max_allowed);
     f->dump_unsigned("min_priority", min_priority);
+    f->dump_float("age_interval", age_interval);
     f->open_array_section("queues");
-    for (typename map<unsigned, list<pair<T, Context*> > > ::const_iterator p =
+    for (typename map<unsigned, list<Request> > ::const_iterator p =
 	   queues.begin(); p != queues.end(); ++p) {
       f->open_object_section("queue");
       f->dump_unsigned("priority", p->first);
       f->open_array_section("items");
-      for (typename list<pair<T, Context*> >::const_iterator q =
+      for (typename list<Request>::const_iterator q =
 	     p->second.begin(); q != p->second.end(); ++q) {
-	f->dump_stream("item") << q->first;
+	f->open_object_section("item");
+	f->dump_stream("item") << q->item;
+	f->dump_unsigned("group", q->group);
+	f->dump_stream("queued") << q->queued;
+	f->close_section();
       }
       f->close_section();
       f->close_section();
     }
     f->close_section();
     f->open_array_section("in_progress");
-    for (typename set<T>::const_iterator p = in_progress.begin();
+    for (typename map<T, uint64_t>::const_iterator p = in_progress.begin();
 	 p != in_progress.end();
 	 ++p) {
-      f->dump_stream("item") << *p;
+      f->open_object_section("item");
+      f->dump_stream("item") << p->first;
+      f->dump_unsigned("group", p->second);
+      f->close_section();
+    }
+    f->close_section();
+    f->open_object_section("group_limits");
+    for (typename map<uint64_t, unsigned>::const_iterator p =
+	   group_limit.begin(); p != group_limit.end(); ++p) {
+      f->dump_unsigned(stringify(p->first).c_str(), p->second);
     }
     f->close_section();
   }
@@ -118,13 +245,29 @@ public:
   void request_reservation(
     T item,                   ///< [in] reservation key
     Context *on_reserved,     ///< [in] callback to be called on reservation
-    unsigned prio
+    unsigned prio,            ///< [in] priority
+    uint64_t group = 0        ///< [in] group (e.g. pool) for shares/bonus
     ) {
     Mutex::Locker l(lock);
     assert(!queue_pointers.count(item) &&
 	   !in_progress.count(item));
-    queues[prio].push_back(make_pair(item, on_reserved));
-    queue_pointers.insert(make_pair(item, make_pair(prio,--(queues[prio]).end())));
+    typename map<uint64_t, unsigned>::const_iterator b =
+      group_prio_bonus.find(group);
+    if (b != group_prio_bonus.end()) {
+      if (b->second >= MAX_PRIORITY - prio)
+	prio = MAX_PRIORITY;
+      else
+	prio += b->second;
+    }
+    Request r;
+    r.item = item;
+    r.on_reserved = on_reserved;
+    r.base_prio = prio;
+    r.group = group;
+    r.queued = ceph_clock_now(NULL);
+    queues[prio].push_back(r);
+    queue_pointers.insert(
+      make_pair(item, make_pair(prio, --(queues[prio]).end())));
     do_queues();
   }
 
@@ -133,7 +276,7 @@ public:
    *
    * Frees the reservation under key for use.
    * Note, after cancel_reservation, the reservation_callback may or
-   * may not still be called. 
+   * may not still be called.
    */
   void cancel_reservation(
     T item                   ///< [in] key for reservation to cancel
@@ -141,11 +284,19 @@ public:
     Mutex::Locker l(lock);
     if (queue_pointers.count(item)) {
       unsigned prio = queue_pointers[item].first;
-      delete queue_pointers[item].second->second;
+      delete queue_pointers[item].second->on_reserved;
       queues[prio].erase(queue_pointers[item].second);
       queue_pointers.erase(item);
     } else {
-      in_progress.erase(item);
+      typename map<T, uint64_t>::iterator p = in_progress.find(item);
+      if (p != in_progress.end()) {
+	typename map<uint64_t, unsigned>::iterator g =
+	  group_in_progress.find(p->second);
+	assert(g != group_in_progress.end());
+	if (--g->second == 0)
+	  group_in_progress.erase(g);
+	in_progress.erase(p);
+      }
     }
     do_queues();
   }
@@ -14,6 +14,31 @@
 
 namespace ceph {
 
+std::string BackTrace::demangle(const char *sym)
+{
+  // find the parentheses and address offset surrounding the mangled name
+  const char *begin = 0, *end = 0;
+  for (const char *j = sym; *j; ++j) {
+    if (*j == '(')
+      begin = j+1;
+    else if (*j == '+')
+      end = j;
+  }
+  if (!begin || !end || begin >= end)
+    return sym;
+
+  std::string mangled(begin, end);
+  int status;
+  char *demangled = abi::__cxa_demangle(mangled.c_str(), NULL, NULL, &status);
+  if (!demangled) {
+    // demangling failed, just pretend it's a C function with no args
+    return mangled + "()";
+  }
+  std::string result = demangled;
+  free(demangled);
+  return result;
+}
+
 void BackTrace::print(std::ostream& out)
 {
   out << " " << pretty_version_to_str() << std::endl;
@@ -2,6 +2,7 @@
 #define CEPH_BACKTRACE_H
 
 #include <iosfwd>
+#include <string>
 #include <execinfo.h>
 #include <stdlib.h>
 
@@ -27,6 +28,10 @@ struct BackTrace {
   const BackTrace& operator=(const BackTrace& other);
 
   void print(std::ostream& out);
+
+  // extract and demangle the function name from one backtrace_symbols()
+  // line; falls back to the raw line if it cannot be parsed
+  static std::string demangle(const char *sym);
 };
 
 }
@@ -12,50 +12,57 @@
 void Finisher::start()
 {
   ldout(cct, 10) << __func__ << dendl;
-  finisher_thread.create();
+  for (unsigned i = 0; i < shards.size(); ++i)
+    shards[i]->create();
 }
 
 void Finisher::stop()
 {
   ldout(cct, 10) << __func__ << dendl;
-  finisher_lock.Lock();
-  finisher_stop = true;
-  // we don't have any new work to do, but we want the worker to wake up anyway
-  // to process the stop condition.
-  finisher_cond.Signal();
-  finisher_lock.Unlock();
-  finisher_thread.join(); // wait until the worker exits completely
+  for (unsigned i = 0; i < shards.size(); ++i) {
+    FinisherShard *s = shards[i];
+    s->lock.Lock();
+    s->stop = true;
+    // we don't have any new work to do, but we want the worker to wake up
+    // anyway to process the stop condition.
+    s->cond.Signal();
+    s->lock.Unlock();
+  }
+  for (unsigned i = 0; i < shards.size(); ++i)
+    shards[i]->join(); // wait until the workers exit completely
   ldout(cct, 10) << __func__ << " finish" << dendl;
 }
 
 void Finisher::wait_for_empty()
 {
-  finisher_lock.Lock();
-  while (!finisher_queue.empty() || finisher_running) {
-    ldout(cct, 10) << "wait_for_empty waiting" << dendl;
-    finisher_empty_cond.Wait(finisher_lock);
+  for (unsigned i = 0; i < shards.size(); ++i) {
+    FinisherShard *s = shards[i];
+    s->lock.Lock();
+    while (!s->queue.empty() || s->running) {
+      ldout(cct, 10) << "wait_for_empty waiting" << dendl;
+      s->empty_cond.Wait(s->lock);
+    }
+    s->lock.Unlock();
   }
-  ldout(cct, 10) << "wait_for_empty empty" << dendl;
-  finisher_lock.Unlock();
 }
 
-void *Finisher::finisher_thread_entry()
+void *Finisher::FinisherShard::entry()
 {
-  finisher_lock.Lock();
-  ldout(cct, 10) << "finisher_thread start" << dendl;
+  lock.Lock();
+  ldout(fin->cct, 10) << "finisher_thread start" << dendl;
 
-  while (!finisher_stop) {
+  while (!stop) {
     /// Every time we are woken up, we process the queue until it is empty.
-    while (!finisher_queue.empty()) {
+    while (!queue.empty()) {
       // To reduce lock contention, we swap out the queue to process.
       // This way other threads can submit new contexts to complete while we are working.
       vector<Context*> ls;
       list<pair<Context*,int> > ls_rval;
-      ls.swap(finisher_queue);
-      ls_rval.swap(finisher_queue_rval);
-      finisher_running = true;
-      finisher_lock.Unlock();
-      ldout(cct, 10) << "finisher_thread doing " << ls << dendl;
+      ls.swap(queue);
+      ls_rval.swap(queue_rval);
+      running = true;
+      lock.Unlock();
+      ldout(fin->cct, 10) << "finisher_thread doing " << ls << dendl;
 
       // Now actually process the contexts.
       for (vector<Context*>::iterator p = ls.begin();
@@ -64,8 +71,8 @@ void *Finisher::finisher_thread_entry()
 	if (*p) {
 	  (*p)->complete(0);
 	} else {
-	  // When an item is NULL in the finisher_queue, it means
-	  // we should instead process an item from finisher_queue_rval,
+	  // When an item is NULL in the queue, it means
+	  // we should instead process an item from queue_rval,
 	  // which has a parameter for complete() other than zero.
 	  // This preserves the order while saving some storage.
 	  assert(!ls_rval.empty());
@@ -73,30 +80,29 @@ void *Finisher::finisher_thread_entry()
 	  c->complete(ls_rval.front().second);
 	  ls_rval.pop_front();
 	}
-	if (logger)
-	  logger->dec(l_finisher_queue_len);
+	if (fin->logger)
+	  fin->logger->dec(l_finisher_queue_len);
       }
-      ldout(cct, 10) << "finisher_thread done with " << ls << dendl;
+      ldout(fin->cct, 10) << "finisher_thread done with " << ls << dendl;
       ls.clear();
 
-      finisher_lock.Lock();
-      finisher_running = false;
+      lock.Lock();
+      running = false;
     }
-    ldout(cct, 10) << "finisher_thread empty" << dendl;
-    finisher_empty_cond.Signal();
-    if (finisher_stop)
+    ldout(fin->cct, 10) << "finisher_thread empty" << dendl;
+    empty_cond.Signal();
+    if (stop)
       break;
-    
-    ldout(cct, 10) << "finisher_thread sleeping" << dendl;
-    finisher_cond.Wait(finisher_lock);
+
+    ldout(fin->cct, 10) << "finisher_thread sleeping" << dendl;
+    cond.Wait(lock);
   }
   // If we are exiting, we signal the thread waiting in stop(),
   // otherwise it would never unblock
-  finisher_empty_cond.Signal();
+  empty_cond.Signal();
 
-  ldout(cct, 10) << "finisher_thread stop" << dendl;
-  finisher_stop = false;
-  finisher_lock.Unlock();
+  ldout(fin->cct, 10) << "finisher_thread stop" << dendl;
+  stop = false;
+  lock.Unlock();
   return 0;
 }
-
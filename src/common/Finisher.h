@@ -1,4 +1,4 @@
-// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*- 
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
 // vim: ts=8 sw=2 smarttab
 /*
  * Ceph - scalable distributed file system
@@ -7,9 +7,9 @@
  *
  * This is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
- * License version 2.1, as published by the Free Software 
+ * License version 2.1, as published by the Free Software
  * Foundation.  See file COPYING.
- * 
+ *
  */
 
 #ifndef CEPH_FINISHER_H
@@ -32,91 +32,124 @@ enum {
 
 /** @brief Asynchronous cleanup class.
  * Finisher asynchronously completes Contexts, which are simple classes
- * representing callbacks, in a dedicated worker thread. Enqueuing
- * contexts to complete is thread-safe.
+ * representing callbacks, in one or more dedicated worker threads.
+ * Enqueuing contexts to complete is thread-safe.
+ *
+ * Each worker thread drains its own queue, which forms an ordering
+ * domain: contexts queued to the same domain complete in queue order.
+ * A single-threaded finisher (the default) therefore completes
+ * everything in FIFO order, exactly as before.  On a multi-threaded
+ * finisher, use the domain variant of queue() when relative ordering
+ * matters; the domainless variants spread work round-robin and make no
+ * cross-context ordering promise.
  */
 class Finisher {
   CephContext *cct;
-  Mutex        finisher_lock; ///< Protects access to queues and finisher_running.
-  Cond         finisher_cond; ///< Signaled when there is something to process.
-  Cond         finisher_empty_cond; ///< Signaled when the finisher has nothing more to process.
-  bool         finisher_stop; ///< Set when the finisher should stop.
-  bool         finisher_running; ///< True when the finisher is currently executing contexts.
-  /// Queue for contexts for which complete(0) will be called.
-  /// NULLs in this queue indicate that an item from finisher_queue_rval
-  /// should be completed in that place instead.
-  vector<Context*> finisher_queue;
-
-  /// Queue for contexts for which the complete function will be called
-  /// with a parameter other than 0.
-  list<pair<Context*,int> > finisher_queue_rval;
 
   /// Performance counter for the finisher's queue length.
   /// Only active for named finishers.
   PerfCounters *logger;
-  
-  void *finisher_thread_entry();
 
-  struct FinisherThread : public Thread {
-    Finisher *fin;    
-    FinisherThread(Finisher *f) : fin(f) {}
-    void* entry() { return (void*)fin->finisher_thread_entry(); }
-  } finisher_thread;
+  /// One ordering domain: a queue drained in order by its own thread.
+  struct FinisherShard : public Thread {
+    Finisher *fin;
+    Mutex lock;       ///< Protects the queues, running and stop.
+    Cond cond;        ///< Signaled when there is something to process.
+    Cond empty_cond;  ///< Signaled when there is nothing more to process.
+    bool stop;        ///< Set when the thread should stop.
+    bool running;     ///< True while the thread is executing contexts.
+
+    /// Queue for contexts for which complete(0) will be called.
+    /// NULLs in this queue indicate that an item from queue_rval
+    /// should be completed in that place instead.
+    vector<Context*> queue;
+
+    /// Queue for contexts for which the complete function will be
+    /// called with a parameter other than 0.
+    list<pair<Context*,int> > queue_rval;
+
+    FinisherShard(Finisher *f)
+      : fin(f), lock("Finisher::FinisherShard::lock"),
+	stop(false), running(false) {}
+    void *entry();
+  };
+
+  vector<FinisherShard*> shards;
+  atomic_t next_shard;   ///< round-robin pick for the domainless queue()
+
+  FinisherShard *pick() {
+    if (shards.size() == 1)
+      return shards[0];
+    return shards[next_shard.inc() % shards.size()];
+  }
 
- public:
-  /// Add a context to complete, optionally specifying a parameter for the complete function.
-  void queue(Context *c, int r = 0) {
-    finisher_lock.Lock();
-    if (finisher_queue.empty()) {
-      finisher_cond.Signal();
-    }
+  /* Only wake the thread when it is actually waiting: while it is
+   * running contexts it rechecks the queue before sleeping, so the
+   * signal would just be a wasted futex wake. */
+  void _queue(FinisherShard *s, Context *c, int r) {
+    s->lock.Lock();
+    if (s->queue.empty() && !s->running)
+      s->cond.Signal();
     if (r) {
-      finisher_queue_rval.push_back(pair<Context*, int>(c, r));
-      finisher_queue.push_back(NULL);
+      s->queue_rval.push_back(pair<Context*, int>(c, r));
+      s->queue.push_back(NULL);
     } else
-      finisher_queue.push_back(c);
+      s->queue.push_back(c);
     if (logger)
       logger->inc(l_finisher_queue_len);
-    finisher_lock.Unlock();
+    s->lock.Unlock();
   }
+
+ public:
+  /// Add a context to complete, optionally specifying a parameter for the complete function.
+  void queue(Context *c, int r = 0) {
+    _queue(pick(), c, r);
+  }
+
+  /// Add a context to a specific ordering domain; contexts queued to
+  /// the same domain complete in queue order even with multiple threads.
+  void queue(Context *c, int r, uint64_t domain) {
+    _queue(shards[domain % shards.size()], c, r);
+  }
+
   void queue(vector<Context*>& ls) {
-    finisher_lock.Lock();
-    if (finisher_queue.empty()) {
-      finisher_cond.Signal();
-    }
-    finisher_queue.insert(finisher_queue.end(), ls.begin(), ls.end());
+    FinisherShard *s = pick();
+    s->lock.Lock();
+    if (s->queue.empty() && !s->running)
+      s->cond.Signal();
+    s->queue.insert(s->queue.end(), ls.begin(), ls.end());
     if (logger)
       logger->inc(l_finisher_queue_len, ls.size());
-    finisher_lock.Unlock();
+    s->lock.Unlock();
     ls.clear();
   }
   void queue(deque<Context*>& ls) {
-    finisher_lock.Lock();
-    if (finisher_queue.empty()) {
-      finisher_cond.Signal();
-    }
-    finisher_queue.insert(finisher_queue.end(), ls.begin(), ls.end());
+    FinisherShard *s = pick();
+    s->lock.Lock();
+    if (s->queue.empty() && !s->running)
+      s->cond.Signal();
+    s->queue.insert(s->queue.end(), ls.begin(), ls.end());
     if (logger)
       logger->inc(l_finisher_queue_len, ls.size());
-    finisher_lock.Unlock();
+    s->lock.Unlock();
     ls.clear();
   }
   void queue(list<Context*>& ls) {
-    finisher_lock.Lock();
-    if (finisher_queue.empty()) {
-      finisher_cond.Signal();
-    }
-    finisher_queue.insert(finisher_queue.end(), ls.begin(), ls.end());
+    FinisherShard *s = pick();
+    s->lock.Lock();
+    if (s->queue.empty() && !s->running)
+      s->cond.Signal();
+    s->queue.insert(s->queue.end(), ls.begin(), ls.end());
     if (logger)
       logger->inc(l_finisher_queue_len, ls.size());
-    finisher_lock.Unlock();
+    s->lock.Unlock();
     ls.clear();
   }
 
-  /// Start the worker thread.
+  /// Start the worker threads.
   void start();
 
-  /** @brief Stop the worker thread.
+  /** @brief Stop the worker threads.
    *
    * Does not wait until all outstanding contexts are completed.
    * To ensure that everything finishes, you should first shut down
@@ -129,20 +162,25 @@ class Finisher {
    * finishes, but this class should never be used in this way. */
   void wait_for_empty();
 
-  /// Construct an anonymous Finisher.
+  /// Construct an anonymous single-threaded Finisher.
   /// Anonymous finishers do not log their queue length.
   Finisher(CephContext *cct_) :
-    cct(cct_), finisher_lock("Finisher::finisher_lock"),
-    finisher_stop(false), finisher_running(false),
-    logger(0),
-    finisher_thread(this) {}
-
-  /// Construct a named Finisher that logs its queue length.
-  Finisher(CephContext *cct_, string name) :
-    cct(cct_), finisher_lock("Finisher::finisher_lock"),
-    finisher_stop(false), finisher_running(false),
-    logger(0),
-    finisher_thread(this) {
+    cct(cct_), logger(0) {
+    FinisherShard *s = new FinisherShard(this);
+    s->set_role("finisher");
+    shards.push_back(s);
+  }
+
+  /// Construct a named Finisher that logs its queue length, with
+  /// nthreads ordering domains.
+  Finisher(CephContext *cct_, string name, int nthreads = 1) :
+    cct(cct_), logger(0) {
+    assert(nthreads > 0);
+    for (int i = 0; i < nthreads; ++i) {
+      FinisherShard *s = new FinisherShard(this);
+      s->set_role(string("finisher-") + name);
+      shards.push_back(s);
+    }
     PerfCountersBuilder b(cct, string("finisher-") + name,
 			  l_finisher_first, l_finisher_last);
     b.add_u64(l_finisher_queue_len, "queue_len");
@@ -156,6 +194,8 @@ class Finisher {
       cct->get_perfcounters_collection()->remove(logger);
       delete logger;
     }
+    for (unsigned i = 0; i < shards.size(); ++i)
+      delete shards[i];
   }
 };
 
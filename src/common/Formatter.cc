@@ -59,6 +59,18 @@ FormatterAttrs::FormatterAttrs(const char *attr, ...)
   va_end(ap);
 }
 
+void format_buffer::grow(size_t need)
+{
+  size_t cap = m_cap ? m_cap : 4096;
+  while (cap < need)
+    cap *= 2;
+  char *b = (char *)realloc(m_buf, cap);
+  if (!b)
+    throw std::bad_alloc();
+  m_buf = b;
+  m_cap = cap;
+}
+
 Formatter::Formatter() { }
 
 Formatter::~Formatter() { }
@@ -125,18 +137,25 @@ JSONFormatter::JSONFormatter(bool p)
 void JSONFormatter::flush(std::ostream& os)
 {
   finish_pending_string();
-  os << m_ss.str();
+  m_ss.write(os);
   if (m_pretty)
     os << "\n";
   m_ss.clear();
-  m_ss.str("");
+}
+
+void JSONFormatter::flush(bufferlist &bl)
+{
+  finish_pending_string();
+  if (m_pretty)
+    m_ss.append('\n');
+  m_ss.write(bl);
+  m_ss.clear();
 }
 
 void JSONFormatter::reset()
 {
   m_stack.clear();
   m_ss.clear();
-  m_ss.str("");
   m_pending_string.clear();
   m_pending_string.str("");
 }
@@ -145,19 +164,19 @@ void JSONFormatter::print_comma(json_formatter_stack_entry_d& entry)
 {
   if (entry.size) {
     if (m_pretty) {
-      m_ss << ",\n";
+      m_ss.append(",\n", 2);
       for (unsigned i = 1; i < m_stack.size(); i++)
-        m_ss << "    ";
+        m_ss.append("    ", 4);
     } else {
-      m_ss << ",";
+      m_ss.append(',');
     }
   } else if (m_pretty) {
-    m_ss << "\n";
+    m_ss.append('\n');
     for (unsigned i = 1; i < m_stack.size(); i++)
-      m_ss << "    ";
+      m_ss.append("    ", 4);
   }
   if (m_pretty && entry.is_array)
-    m_ss << "    ";
+    m_ss.append("    ", 4);
 }
 
 void JSONFormatter::print_quoted_string(const std::string& s)
@@ -165,7 +184,9 @@ void JSONFormatter::print_quoted_string(const std::string& s)
   int len = escape_json_attr_len(s.c_str(), s.size());
   char escaped[len];
   escape_json_attr(s.c_str(), s.size(), escaped);
-  m_ss << '\"' << escaped << '\"';
+  m_ss.append('\"');
+  m_ss.append(escaped);
+  m_ss.append('\"');
 }
 
 void JSONFormatter::print_name(const char *name)
@@ -177,13 +198,15 @@ void JSONFormatter::print_name(const char *name)
   print_comma(entry);
   if (!entry.is_array) {
     if (m_pretty) {
-      m_ss << "    ";
+      m_ss.append("    ", 4);
     }
-    m_ss << "\"" << name << "\"";
+    m_ss.append('\"');
+    m_ss.append(name);
+    m_ss.append('\"');
     if (m_pretty)
-      m_ss << ": ";
+      m_ss.append(": ", 2);
     else
-      m_ss << ':';
+      m_ss.append(':');
   }
   ++entry.size;
 }
@@ -192,9 +215,9 @@ void JSONFormatter::open_section(const char *name, bool is_array)
 {
   print_name(name);
   if (is_array)
-    m_ss << '[';
+    m_ss.append('[');
   else
-    m_ss << '{';
+    m_ss.append('{');
 
   json_formatter_stack_entry_d n;
   n.is_array = is_array;
@@ -232,11 +255,11 @@ void JSONFormatter::close_section()
 
   struct json_formatter_stack_entry_d& entry = m_stack.back();
   if (m_pretty && entry.size) {
-    m_ss << "\n";
+    m_ss.append('\n');
     for (unsigned i = 1; i < m_stack.size(); i++)
-      m_ss << "    ";
+      m_ss.append("    ", 4);
   }
-  m_ss << (entry.is_array ? ']' : '}');
+  m_ss.append(entry.is_array ? ']' : '}');
   m_stack.pop_back();
 }
 
@@ -252,21 +275,23 @@ void JSONFormatter::finish_pending_string()
 void JSONFormatter::dump_unsigned(const char *name, uint64_t u)
 {
   print_name(name);
-  m_ss << u;
+  m_ss.append_uint(u);
 }
 
 void JSONFormatter::dump_int(const char *name, int64_t s)
 {
   print_name(name);
-  m_ss << s;
+  m_ss.append_int(s);
 }
 
 void JSONFormatter::dump_float(const char *name, double d)
 {
   print_name(name);
   char foo[30];
-  snprintf(foo, sizeof(foo), "%lf", d);
-  m_ss << foo;
+  int len = snprintf(foo, sizeof(foo), "%lf", d);
+  if (len >= (int)sizeof(foo))
+    len = sizeof(foo) - 1;
+  m_ss.append(foo, len);
 }
 
 void JSONFormatter::dump_string(const char *name, const std::string& s)
@@ -291,18 +316,18 @@ void JSONFormatter::dump_format_va(const char *name, const char *ns, bool quoted
   if (quoted) {
     print_quoted_string(std::string(buf));
   } else {
-    m_ss << std::string(buf);
+    m_ss.append(buf);
   }
 }
 
 int JSONFormatter::get_len() const
 {
-  return m_ss.str().size();
+  return m_ss.length();
 }
 
 void JSONFormatter::write_raw_data(const char *data)
 {
-  m_ss << data;
+  m_ss.append(data);
 }
 
 const char *XMLFormatter::XML_1_DTD =
@@ -317,17 +342,24 @@ XMLFormatter::XMLFormatter(bool pretty)
 void XMLFormatter::flush(std::ostream& os)
 {
   finish_pending_string();
-  os << m_ss.str();
+  m_ss.write(os);
   if (m_pretty)
     os << "\n";
   m_ss.clear();
-  m_ss.str("");
+}
+
+void XMLFormatter::flush(bufferlist &bl)
+{
+  finish_pending_string();
+  if (m_pretty)
+    m_ss.append('\n');
+  m_ss.write(bl);
+  m_ss.clear();
 }
 
 void XMLFormatter::reset()
 {
   m_ss.clear();
-  m_ss.str("");
   m_pending_string.clear();
   m_pending_string.str("");
   m_sections.clear();
@@ -372,63 +404,98 @@ void XMLFormatter::close_section()
   std::string section = m_sections.back();
   m_sections.pop_back();
   print_spaces();
-  m_ss << "</" << section << ">";
+  m_ss.append("</", 2);
+  m_ss.append(section);
+  m_ss.append('>');
   if (m_pretty)
-    m_ss << "\n";
+    m_ss.append('\n');
 }
 
 void XMLFormatter::dump_unsigned(const char *name, uint64_t u)
 {
-  std::string e(name);
   print_spaces();
-  m_ss << "<" << e << ">" << u << "</" << e << ">";
+  m_ss.append('<');
+  m_ss.append(name);
+  m_ss.append('>');
+  m_ss.append_uint(u);
+  m_ss.append("</", 2);
+  m_ss.append(name);
+  m_ss.append('>');
   if (m_pretty)
-    m_ss << "\n";
+    m_ss.append('\n');
 }
 
 void XMLFormatter::dump_int(const char *name, int64_t u)
 {
-  std::string e(name);
   print_spaces();
-  m_ss << "<" << e << ">" << u << "</" << e << ">";
+  m_ss.append('<');
+  m_ss.append(name);
+  m_ss.append('>');
+  m_ss.append_int(u);
+  m_ss.append("</", 2);
+  m_ss.append(name);
+  m_ss.append('>');
   if (m_pretty)
-    m_ss << "\n";
+    m_ss.append('\n');
 }
 
 void XMLFormatter::dump_float(const char *name, double d)
 {
-  std::string e(name);
   print_spaces();
-  m_ss << "<" << e << ">" << d << "</" << e << ">";
+  m_ss.append('<');
+  m_ss.append(name);
+  m_ss.append('>');
+  // %g matches what operator<< printed here before
+  char foo[32];
+  int len = snprintf(foo, sizeof(foo), "%g", d);
+  if (len >= (int)sizeof(foo))
+    len = sizeof(foo) - 1;
+  m_ss.append(foo, len);
+  m_ss.append("</", 2);
+  m_ss.append(name);
+  m_ss.append('>');
   if (m_pretty)
-    m_ss << "\n";
+    m_ss.append('\n');
 }
 
 void XMLFormatter::dump_string(const char *name, const std::string& s)
 {
-  std::string e(name);
   print_spaces();
-  m_ss << "<" << e << ">" << escape_xml_str(s.c_str()) << "</" << e << ">";
+  m_ss.append('<');
+  m_ss.append(name);
+  m_ss.append('>');
+  m_ss.append(escape_xml_str(s.c_str()));
+  m_ss.append("</", 2);
+  m_ss.append(name);
+  m_ss.append('>');
   if (m_pretty)
-    m_ss << "\n";
+    m_ss.append('\n');
 }
 
 void XMLFormatter::dump_string_with_attrs(const char *name, const std::string& s, const FormatterAttrs& attrs)
 {
-  std::string e(name);
   std::string attrs_str;
   get_attrs_str(&attrs, attrs_str);
   print_spaces();
-  m_ss << "<" << e << attrs_str << ">" << escape_xml_str(s.c_str()) << "</" << e << ">";
+  m_ss.append('<');
+  m_ss.append(name);
+  m_ss.append(attrs_str);
+  m_ss.append('>');
+  m_ss.append(escape_xml_str(s.c_str()));
+  m_ss.append("</", 2);
+  m_ss.append(name);
+  m_ss.append('>');
   if (m_pretty)
-    m_ss << "\n";
+    m_ss.append('\n');
 }
 
 std::ostream& XMLFormatter::dump_stream(const char *name)
 {
   print_spaces();
   m_pending_string_name = name;
-  m_ss << "<" << m_pending_string_name << ">";
+  m_ss.append('<');
+  m_ss.append(m_pending_string_name);
+  m_ss.append('>');
   return m_pending_string;
 }
 
@@ -437,26 +504,34 @@ void XMLFormatter::dump_format_va(const char* name, const char *ns, bool quoted,
   char buf[LARGE_SIZE];
   vsnprintf(buf, LARGE_SIZE, fmt, ap);
 
-  std::string e(name);
   print_spaces();
+  m_ss.append('<');
+  m_ss.append(name);
   if (ns) {
-    m_ss << "<" << e << " xmlns=\"" << ns << "\">" << buf << "</" << e << ">";
+    m_ss.append(" xmlns=\"", 8);
+    m_ss.append(ns);
+    m_ss.append("\">", 2);
+    m_ss.append(buf);
   } else {
-    m_ss << "<" << e << ">" << escape_xml_str(buf) << "</" << e << ">";
+    m_ss.append('>');
+    m_ss.append(escape_xml_str(buf));
   }
+  m_ss.append("</", 2);
+  m_ss.append(name);
+  m_ss.append('>');
 
   if (m_pretty)
-    m_ss << "\n";
+    m_ss.append('\n');
 }
 
 int XMLFormatter::get_len() const
 {
-  return m_ss.str().size();
+  return m_ss.length();
 }
 
 void XMLFormatter::write_raw_data(const char *data)
 {
-  m_ss << data;
+  m_ss.append(data);
 }
 
 void XMLFormatter::get_attrs_str(const FormatterAttrs *attrs, std::string& attrs_str)
@@ -481,25 +556,31 @@ void XMLFormatter::open_section_in_ns(const char *name, const char *ns, const Fo
     get_attrs_str(attrs, attrs_str);
   }
 
+  m_ss.append('<');
+  m_ss.append(name);
+  m_ss.append(attrs_str);
   if (ns) {
-    m_ss << "<" << name << attrs_str << " xmlns=\"" << ns << "\">";
-  } else {
-    m_ss << "<" << name << attrs_str << ">";
+    m_ss.append(" xmlns=\"", 8);
+    m_ss.append(ns);
+    m_ss.append('\"');
   }
+  m_ss.append('>');
   if (m_pretty)
-    m_ss << "\n";
+    m_ss.append('\n');
   m_sections.push_back(name);
 }
 
 void XMLFormatter::finish_pending_string()
 {
   if (!m_pending_string_name.empty()) {
-    m_ss << escape_xml_str(m_pending_string.str().c_str())
-      << "</" << m_pending_string_name << ">";
+    m_ss.append(escape_xml_str(m_pending_string.str().c_str()));
+    m_ss.append("</", 2);
+    m_ss.append(m_pending_string_name);
+    m_ss.append('>');
     m_pending_string_name.clear();
     m_pending_string.str(std::string());
     if (m_pretty) {
-      m_ss << "\n";
+      m_ss.append('\n');
     }
   }
 }
@@ -508,8 +589,8 @@ void XMLFormatter::print_spaces()
 {
   finish_pending_string();
   if (m_pretty) {
-    std::string spaces(m_sections.size(), ' ');
-    m_ss << spaces;
+    for (size_t i = 0; i < m_sections.size(); i++)
+      m_ss.append(' ');
   }
 }
 
@@ -14,6 +14,9 @@
 #include <string>
 #include <map>
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "include/buffer.h"
 
 namespace ceph {
@@ -24,6 +27,77 @@ namespace ceph {
     FormatterAttrs(const char *attr, ...);
   };
 
+  /**
+   * flat append buffer that formatter output is rendered into.
+   * iostreams spend most of a small dump in locale plumbing and
+   * temporary strings; this keeps one growable array that survives
+   * reset() and flush(), so a reused formatter settles into
+   * steady-state zero allocation, and integers are formatted by a
+   * plain digits loop.
+   */
+  class format_buffer {
+  public:
+    format_buffer() : m_buf(NULL), m_len(0), m_cap(0) {}
+    ~format_buffer() {
+      free(m_buf);
+    }
+    void clear() {
+      m_len = 0;
+    }
+    size_t length() const {
+      return m_len;
+    }
+    void append(char c) {
+      if (m_len + 1 > m_cap)
+	grow(m_len + 1);
+      m_buf[m_len++] = c;
+    }
+    void append(const char *s, size_t n) {
+      if (m_len + n > m_cap)
+	grow(m_len + n);
+      memcpy(m_buf + m_len, s, n);
+      m_len += n;
+    }
+    void append(const char *s) {
+      append(s, strlen(s));
+    }
+    void append(const std::string& s) {
+      append(s.data(), s.size());
+    }
+    void append_uint(uint64_t v) {
+      char t[24];
+      char *p = t + sizeof(t);
+      do {
+	*--p = '0' + (char)(v % 10);
+	v /= 10;
+      } while (v);
+      append(p, t + sizeof(t) - p);
+    }
+    void append_int(int64_t v) {
+      if (v < 0) {
+	append('-');
+	append_uint(-(uint64_t)v);
+      } else {
+	append_uint(v);
+      }
+    }
+    void write(std::ostream& os) const {
+      if (m_len)
+	os.write(m_buf, m_len);
+    }
+    void write(bufferlist& bl) const {
+      if (m_len)
+	bl.append(m_buf, m_len);
+    }
+  private:
+    void grow(size_t need);
+    format_buffer(const format_buffer&);
+    format_buffer& operator=(const format_buffer&);
+
+    char *m_buf;
+    size_t m_len, m_cap;
+  };
+
   class Formatter {
   public:
     static Formatter *create(const std::string& type,
@@ -41,7 +115,7 @@ namespace ceph {
     virtual ~Formatter();
 
     virtual void flush(std::ostream& os) = 0;
-    void flush(bufferlist &bl)
+    virtual void flush(bufferlist &bl)
     {
       std::stringstream os;
       flush(os);
@@ -95,6 +169,7 @@ namespace ceph {
     JSONFormatter(bool p = false);
 
     void flush(std::ostream& os);
+    void flush(bufferlist &bl);
     void reset();
     virtual void open_array_section(const char *name);
     void open_array_section_in_ns(const char *name, const char *ns);
@@ -125,7 +200,8 @@ namespace ceph {
     void print_comma(json_formatter_stack_entry_d& entry);
     void finish_pending_string();
 
-    std::stringstream m_ss, m_pending_string;
+    format_buffer m_ss;
+    std::stringstream m_pending_string;
     std::list<json_formatter_stack_entry_d> m_stack;
     bool m_is_pending_string;
   };
@@ -136,6 +212,7 @@ namespace ceph {
     XMLFormatter(bool pretty = false);
 
     void flush(std::ostream& os);
+    void flush(bufferlist &bl);
     void reset();
     void open_array_section(const char *name);
     void open_array_section_in_ns(const char *name, const char *ns);
@@ -162,7 +239,8 @@ namespace ceph {
     static std::string escape_xml_str(const char *str);
     void get_attrs_str(const FormatterAttrs *attrs, std::string& attrs_str);
 
-    std::stringstream m_ss, m_pending_string;
+    format_buffer m_ss;
+    std::stringstream m_pending_string;
     std::deque<std::string> m_sections;
     bool m_pretty;
     std::string m_pending_string_name;
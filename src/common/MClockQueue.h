@@ -0,0 +1,361 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * Copyright (C) 2004-2006 Sage Weil <sage@newdream.net>
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef MCLOCK_QUEUE_H
+#define MCLOCK_QUEUE_H
+
+#include "common/OpQueue.h"
+#include "common/Clock.h"
+#include "include/assert.h"
+
+#include <map>
+#include <utility>
+#include <list>
+#include <vector>
+
+/**
+ * mClock-style QoS scheduler between a small fixed set of service
+ * classes (e.g. client ops, recovery, scrub, snap trim)
+ *
+ * Each class has a reservation (ops/s guaranteed), a weight (share of
+ * the remaining capacity), and a limit (ops/s cap).  Dequeue first
+ * serves any class whose reservation tag has come due, so reserved
+ * classes meet their minimum regardless of load; otherwise it picks
+ * the smallest weight tag among classes under their limit, so idle
+ * capacity is divided in proportion to the weights.  If every backlog
+ * is over its limit we still dispatch the smallest weight tag rather
+ * than idle the disk: the OSD has no mechanism to re-poll the queue
+ * later, so limits shape relative order rather than impose hard
+ * throttling.
+ *
+ * A reservation or limit of 0 means "none".  Tags advance by 1/rate
+ * per item; item cost is recorded but not yet folded into the tag
+ * arithmetic.  Within a class items are FIFO -- fairness between
+ * classes of type K is the job of the scheduler above only insofar as
+ * the class mapping provides it.
+ *
+ * The mapping from a queued item to a service class is supplied as a
+ * function pointer at construction so this stays independent of the
+ * OSD types it queues.
+ *
+ * enqueue_strict items bypass QoS entirely and are serviced in strict
+ * priority order first, as with PrioritizedQueue.
+ *
+ * Per-class dispatch and queue-wait counters are kept and exposed via
+ * dump() so that enforcement can be verified from the running daemon.
+ */
+template <typename T, typename K>
+class MClockQueue : public OpQueue<T, K> {
+  typedef typename OpQueue<T, K>::Filter Filter;
+
+public:
+  struct ClassParams {
+    double res;  ///< reserved ops/s (0 = no reservation)
+    double wgt;  ///< relative share of unreserved capacity
+    double lim;  ///< ops/s cap (0 = unlimited)
+    ClassParams() : res(0), wgt(1), lim(0) {}
+    ClassParams(double res, double wgt, double lim)
+      : res(res), wgt(wgt), lim(lim) {}
+  };
+  typedef unsigned (*ClassOfFunc)(const T&);
+
+private:
+  struct QItem {
+    K cl;
+    unsigned cost;
+    double qtime;   ///< enqueue time, for the wait counters
+    T item;
+    QItem(K cl, unsigned cost, double qtime, T item)
+      : cl(cl), cost(cost), qtime(qtime), item(item) {}
+  };
+  typedef std::list<QItem> QItemList;
+
+  struct ServiceClass {
+    ClassParams p;
+    QItemList q;
+    double r_tag, w_tag, l_tag;  ///< next-dispatch tags (seconds)
+    // counters
+    uint64_t dispatched;
+    double total_wait, max_wait;
+    ServiceClass()
+      : r_tag(0), w_tag(0), l_tag(0),
+	dispatched(0), total_wait(0), max_wait(0) {}
+  };
+
+  ClassOfFunc classof;
+  std::vector<ServiceClass> classes;
+  unsigned total;       ///< items across all service classes
+  unsigned high_total;  ///< items in the strict bands
+
+  /// strict bands, serviced highest priority first, before any QoS class
+  typedef std::map<unsigned, QItemList> SubQueues;
+  SubQueues high_queue;
+
+  static double now() {
+    utime_t t = ceph_clock_now(NULL);
+    return (double)t;
+  }
+
+  unsigned class_of(const T &item) const {
+    unsigned i = classof(item);
+    assert(i < classes.size());
+    return i;
+  }
+
+  /// on an idle->busy transition, forfeit credit accumulated while idle
+  void catch_up_tags(ServiceClass &c, double t) {
+    if (c.q.empty()) {
+      if (c.r_tag < t)
+	c.r_tag = t;
+      if (c.w_tag < t)
+	c.w_tag = t;
+      if (c.l_tag < t)
+	c.l_tag = t;
+    }
+  }
+
+  void advance_tags(ServiceClass &c, double t) {
+    if (c.p.res > 0)
+      c.r_tag = (c.r_tag > t ? c.r_tag : t) + 1.0 / c.p.res;
+    if (c.p.wgt > 0)
+      c.w_tag = (c.w_tag > t ? c.w_tag : t) + 1.0 / c.p.wgt;
+    if (c.p.lim > 0)
+      c.l_tag = (c.l_tag > t ? c.l_tag : t) + 1.0 / c.p.lim;
+  }
+
+  T pop_front(ServiceClass &c, double t) {
+    QItem qi = c.q.front();
+    c.q.pop_front();
+    total--;
+    advance_tags(c, t);
+    c.dispatched++;
+    double wait = t - qi.qtime;
+    if (wait > 0) {
+      c.total_wait += wait;
+      if (wait > c.max_wait)
+	c.max_wait = wait;
+    }
+    return qi.item;
+  }
+
+  static unsigned filter_qitems(
+    QItemList *l, const Filter &f,
+    std::list<T> *out) {
+    unsigned ret = 0;
+    if (out) {
+      for (typename QItemList::reverse_iterator i = l->rbegin();
+	   i != l->rend();
+	   ++i) {
+	if (f(i->item)) {
+	  out->push_front(i->item);
+	}
+      }
+    }
+    for (typename QItemList::iterator i = l->begin();
+	 i != l->end();
+      ) {
+      if (f(i->item)) {
+	l->erase(i++);
+	++ret;
+      } else {
+	++i;
+      }
+    }
+    return ret;
+  }
+
+  static unsigned remove_class_qitems(
+    QItemList *l, K k,
+    std::list<T> *out) {
+    unsigned ret = 0;
+    if (out) {
+      for (typename QItemList::reverse_iterator i = l->rbegin();
+	   i != l->rend();
+	   ++i) {
+	if (i->cl == k) {
+	  out->push_front(i->item);
+	}
+      }
+    }
+    for (typename QItemList::iterator i = l->begin();
+	 i != l->end();
+      ) {
+      if (i->cl == k) {
+	l->erase(i++);
+	++ret;
+      } else {
+	++i;
+      }
+    }
+    return ret;
+  }
+
+public:
+  MClockQueue(const std::vector<ClassParams> &params, ClassOfFunc classof)
+    : classof(classof),
+      classes(params.size()),
+      total(0),
+      high_total(0) {
+    assert(!params.empty());
+    for (unsigned i = 0; i < params.size(); ++i)
+      classes[i].p = params[i];
+  }
+
+  unsigned length() const {
+    return total + high_total;
+  }
+
+  void remove_by_filter(const Filter &f, std::list<T> *removed = 0) {
+    for (unsigned i = 0; i < classes.size(); ++i)
+      total -= filter_qitems(&classes[i].q, f, removed);
+    for (typename SubQueues::iterator i = high_queue.begin();
+	 i != high_queue.end();
+	 ) {
+      high_total -= filter_qitems(&i->second, f, removed);
+      if (i->second.empty()) {
+	high_queue.erase(i++);
+      } else {
+	++i;
+      }
+    }
+  }
+
+  void remove_by_class(K k, std::list<T> *out = 0) {
+    for (unsigned i = 0; i < classes.size(); ++i)
+      total -= remove_class_qitems(&classes[i].q, k, out);
+    for (typename SubQueues::iterator i = high_queue.begin();
+	 i != high_queue.end();
+	 ) {
+      high_total -= remove_class_qitems(&i->second, k, out);
+      if (i->second.empty()) {
+	high_queue.erase(i++);
+      } else {
+	++i;
+      }
+    }
+  }
+
+  void enqueue_strict(K cl, unsigned priority, T item) {
+    high_queue[priority].push_back(QItem(cl, 0, now(), item));
+    high_total++;
+  }
+
+  void enqueue_strict_front(K cl, unsigned priority, T item) {
+    high_queue[priority].push_front(QItem(cl, 0, now(), item));
+    high_total++;
+  }
+
+  void enqueue(K cl, unsigned priority, unsigned cost, T item) {
+    ServiceClass &c = classes[class_of(item)];
+    double t = now();
+    catch_up_tags(c, t);
+    c.q.push_back(QItem(cl, cost, t, item));
+    total++;
+  }
+
+  void enqueue_front(K cl, unsigned priority, unsigned cost, T item) {
+    ServiceClass &c = classes[class_of(item)];
+    double t = now();
+    catch_up_tags(c, t);
+    c.q.push_front(QItem(cl, cost, t, item));
+    total++;
+  }
+
+  bool empty() const {
+    return total == 0 && high_total == 0;
+  }
+
+  T dequeue() {
+    assert(!empty());
+
+    if (high_total) {
+      typename SubQueues::reverse_iterator i = high_queue.rbegin();
+      QItem qi = i->second.front();
+      i->second.pop_front();
+      high_total--;
+      if (i->second.empty())
+	high_queue.erase(i->first);
+      return qi.item;
+    }
+
+    double t = now();
+
+    // reservation phase: any class with a due reservation tag goes
+    // first, earliest tag wins
+    ServiceClass *best = 0;
+    for (unsigned i = 0; i < classes.size(); ++i) {
+      ServiceClass &c = classes[i];
+      if (c.q.empty() || c.p.res <= 0 || c.r_tag > t)
+	continue;
+      if (!best || c.r_tag < best->r_tag)
+	best = &c;
+    }
+    if (best)
+      return pop_front(*best, t);
+
+    // weight phase: smallest weight tag among classes under their
+    // limit; if everything is over limit, take the smallest weight
+    // tag anyway to stay work conserving
+    ServiceClass *limited = 0;
+    for (unsigned i = 0; i < classes.size(); ++i) {
+      ServiceClass &c = classes[i];
+      if (c.q.empty())
+	continue;
+      if (c.p.lim > 0 && c.l_tag > t) {
+	if (!limited || c.w_tag < limited->w_tag)
+	  limited = &c;
+	continue;
+      }
+      if (!best || c.w_tag < best->w_tag)
+	best = &c;
+    }
+    if (!best)
+      best = limited;
+    assert(best);
+    return pop_front(*best, t);
+  }
+
+  void dump(Formatter *f) const {
+    f->dump_int("total", total);
+    f->dump_int("high_total", high_total);
+    f->open_array_section("classes");
+    for (unsigned i = 0; i < classes.size(); ++i) {
+      const ServiceClass &c = classes[i];
+      f->open_object_section("class");
+      f->dump_int("class", i);
+      f->dump_float("reservation", c.p.res);
+      f->dump_float("weight", c.p.wgt);
+      f->dump_float("limit", c.p.lim);
+      f->dump_int("queued", c.q.size());
+      f->dump_unsigned("dispatched", c.dispatched);
+      f->dump_float("avg_wait",
+		    c.dispatched ? c.total_wait / c.dispatched : 0.0);
+      f->dump_float("max_wait", c.max_wait);
+      f->close_section();
+    }
+    f->close_section();
+    f->open_array_section("high_queues");
+    for (typename SubQueues::const_iterator p = high_queue.begin();
+	 p != high_queue.end();
+	 ++p) {
+      f->open_object_section("subqueue");
+      f->dump_int("priority", p->first);
+      f->dump_int("size", p->second.size());
+      f->close_section();
+    }
+    f->close_section();
+  }
+};
+
+#endif
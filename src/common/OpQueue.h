@@ -0,0 +1,78 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * Copyright (C) 2004-2006 Sage Weil <sage@newdream.net>
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef OP_QUEUE_H
+#define OP_QUEUE_H
+
+#include "common/Formatter.h"
+
+#include <list>
+
+/**
+ * Abstract class for all Op Queues
+ *
+ * In order to provide optimized implementations of dequeue operations
+ * for different workloads, this abstract class allows the queue
+ * implementation behind ShardedOpWQ to be selected at runtime (see
+ * osd_op_queue).  T is the queued item, K is a class used to provide
+ * fairness between different item sources (e.g. entity_inst_t).
+ */
+template <typename T, typename K>
+class OpQueue {
+public:
+  /**
+   * Predicate for remove_by_filter; implementations take this by
+   * reference since a virtual member function cannot be templated on
+   * an arbitrary functor type.
+   */
+  struct Filter {
+    virtual bool operator()(const T &item) const = 0;
+    virtual ~Filter() {}
+  };
+
+  /// Items in the queue
+  virtual unsigned length() const = 0;
+
+  /// Remove items satisfying the filter, appending them to *removed if not NULL
+  virtual void remove_by_filter(const Filter &f, std::list<T> *removed = 0) = 0;
+
+  /// Remove all items of class k, appending them to *out if not NULL
+  virtual void remove_by_class(K k, std::list<T> *out = 0) = 0;
+
+  /// Enqueue item in the strict priority bands
+  virtual void enqueue_strict(K cl, unsigned priority, T item) = 0;
+
+  /// Enqueue item at the front of its strict priority band
+  virtual void enqueue_strict_front(K cl, unsigned priority, T item) = 0;
+
+  /// Enqueue item with cost-based sharing between priorities
+  virtual void enqueue(K cl, unsigned priority, unsigned cost, T item) = 0;
+
+  /// Enqueue item at the front of its band
+  virtual void enqueue_front(K cl, unsigned priority, unsigned cost, T item) = 0;
+
+  /// True if the queue is empty
+  virtual bool empty() const = 0;
+
+  /// Return the next item to dispatch
+  virtual T dequeue() = 0;
+
+  /// Formatted output of the queue
+  virtual void dump(Formatter *f) const = 0;
+
+  /// Don't leak resources on destruction
+  virtual ~OpQueue() {}
+};
+
+#endif
@@ -17,6 +17,7 @@
 
 #include "common/Mutex.h"
 #include "common/Formatter.h"
+#include "common/OpQueue.h"
 
 #include <map>
 #include <utility>
@@ -44,7 +45,7 @@
  * to provide fairness for different clients.
  */
 template <typename T, typename K>
-class PrioritizedQueue {
+class PrioritizedQueue : public OpQueue<T, K> {
   int64_t total_priority;
   int64_t max_tokens_per_subqueue;
   int64_t min_cost;
@@ -229,6 +230,16 @@ class PrioritizedQueue {
     }
   }
 
+  /// adapts an OpQueue::Filter to the functor shape the templated
+  /// remove_by_filter expects
+  struct FilterWrapper {
+    const typename OpQueue<T, K>::Filter &f;
+    FilterWrapper(const typename OpQueue<T, K>::Filter &f) : f(f) {}
+    bool operator()(const T &item) {
+      return f(item);
+    }
+  };
+
 public:
   PrioritizedQueue(unsigned max_per, unsigned min_c)
     : total_priority(0),
@@ -253,6 +264,13 @@ public:
     return total;
   }
 
+  /// OpQueue::Filter entry point; forwards to the functor-templated
+  /// implementation below
+  void remove_by_filter(const typename OpQueue<T, K>::Filter &f,
+			std::list<T> *removed = 0) {
+    remove_by_filter(FilterWrapper(f), removed);
+  }
+
   template <class F>
   void remove_by_filter(F f, std::list<T> *removed = 0) {
     for (typename SubQueues::iterator i = queue.begin();
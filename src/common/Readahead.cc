@@ -11,15 +11,12 @@ Readahead::Readahead()
     m_readahead_max_bytes(NO_LIMIT),
     m_alignments(),
     m_lock("Readahead::m_lock"),
-    m_nr_consec_read(0),
-    m_consec_read_bytes(0),
-    m_last_pos(0),
-    m_readahead_pos(0),
-    m_readahead_trigger_pos(0),
-    m_readahead_size(0),
+    m_streams(4),
+    m_stream_ticks(0),
     m_pending(0),
     m_pending_lock("Readahead::m_pending_lock"),
     m_pending_cond() {
+  m_cur = &m_streams.front();
 }
 
 Readahead::~Readahead() {
@@ -30,7 +27,7 @@ Readahead::extent_t Readahead::update(const vector<extent_t>& extents, uint64_t
   for (vector<extent_t>::const_iterator p = extents.begin(); p != extents.end(); ++p) {
     _observe_read(p->first, p->second);
   }
-  if (m_readahead_pos >= limit) {
+  if (m_cur->readahead_pos >= limit) {
     m_lock.Unlock();
     return extent_t(0, 0);
   }
@@ -42,7 +39,7 @@ Readahead::extent_t Readahead::update(const vector<extent_t>& extents, uint64_t
 Readahead::extent_t Readahead::update(uint64_t offset, uint64_t length, uint64_t limit) {
   m_lock.Lock();
   _observe_read(offset, length);
-  if (m_readahead_pos >= limit) {
+  if (m_cur->readahead_pos >= limit) {
     m_lock.Unlock();
     return extent_t(0, 0);
   }
@@ -52,41 +49,103 @@ Readahead::extent_t Readahead::update(uint64_t offset, uint64_t length, uint64_t
 }
 
 void Readahead::_observe_read(uint64_t offset, uint64_t length) {
-  if (offset == m_last_pos) {
-    m_nr_consec_read++;
-    m_consec_read_bytes += length;
-  } else {
-    m_nr_consec_read = 0;
-    m_consec_read_bytes = 0;
-    m_readahead_trigger_pos = 0;
-    m_readahead_size = 0;
-    m_readahead_pos = 0;
+  m_stream_ticks++;
+
+  // exact continuation of a tracked stream, contiguous or strided?
+  for (vector<Stream>::iterator p = m_streams.begin(); p != m_streams.end(); ++p) {
+    Stream *s = &*p;
+    if (s->last_tick == 0) {
+      continue;
+    }
+    if (offset == s->last_pos ||
+	(s->stride != 0 && offset == s->last_start + s->stride)) {
+      if (offset == s->last_pos) {
+	// contiguous reads trump a candidate stride
+	s->stride = 0;
+      }
+      s->nr_consec_read++;
+      s->consec_read_bytes += length;
+      s->hits++;
+      s->last_start = offset;
+      s->last_pos = offset + length;
+      s->last_tick = m_stream_ticks;
+      m_cur = s;
+      return;
+    }
+  }
+
+  // near miss?  use the read to (re)seed the stride of the closest
+  // preceding stream that has not yet settled into a pattern.
+  // established streams only advance on exact matches, so interleaved
+  // readers cannot corrupt each other's state.
+  const uint64_t max_stride = 4 * 1024 * 1024;
+  Stream *near = NULL;
+  for (vector<Stream>::iterator p = m_streams.begin(); p != m_streams.end(); ++p) {
+    Stream *s = &*p;
+    if (s->last_tick == 0 ||
+	s->nr_consec_read >= m_trigger_requests ||
+	offset <= s->last_start ||
+	offset - s->last_start > max_stride) {
+      continue;
+    }
+    if (!near || s->last_start > near->last_start) {
+      near = s;
+    }
+  }
+  if (near) {
+    near->misses++;
+    near->stride = offset - near->last_start;
+    near->nr_consec_read = 0;
+    near->consec_read_bytes = 0;
+    near->readahead_pos = 0;
+    near->readahead_trigger_pos = 0;
+    near->readahead_size = 0;
+    near->last_start = offset;
+    near->last_pos = offset + length;
+    near->last_tick = m_stream_ticks;
+    m_cur = near;
+    return;
   }
-  m_last_pos = offset + length;
+
+  // a new stream; replace the least recently hit one
+  Stream *lru = &m_streams.front();
+  for (vector<Stream>::iterator p = m_streams.begin(); p != m_streams.end(); ++p) {
+    if (p->last_tick < lru->last_tick) {
+      lru = &*p;
+    }
+  }
+  lru->reset();
+  lru->last_start = offset;
+  lru->last_pos = offset + length;
+  lru->last_tick = m_stream_ticks;
+  m_cur = lru;
 }
 
 Readahead::extent_t Readahead::_compute_readahead(uint64_t limit) {
+  Stream *s = m_cur;
   uint64_t readahead_offset = 0;
   uint64_t readahead_length = 0;
-  if (m_nr_consec_read >= m_trigger_requests) {
-    // currently reading sequentially
-    if (m_last_pos >= m_readahead_trigger_pos) {
+  if (s->nr_consec_read >= m_trigger_requests) {
+    // currently reading in a recognized pattern
+    if (s->last_pos >= s->readahead_trigger_pos) {
       // need to read ahead
-      if (m_readahead_size == 0) {
+      if (s->readahead_size == 0) {
 	// initial readahead trigger
-	m_readahead_size = m_consec_read_bytes;
-	m_readahead_pos = m_last_pos;
+	s->readahead_size = s->consec_read_bytes;
+	s->readahead_pos = s->last_pos;
       } else {
-	// continuing readahead trigger
-	m_readahead_size *= 2;
-	if (m_last_pos > m_readahead_pos) {
-	  m_readahead_pos = m_last_pos;
+	// continuing readahead trigger; grow the window in proportion
+	// to how reliable this stream's predictions have been: double
+	// it at full confidence, keep it flat at half
+	s->readahead_size += s->readahead_size * s->hits / (s->hits + s->misses);
+	if (s->last_pos > s->readahead_pos) {
+	  s->readahead_pos = s->last_pos;
 	}
       }
-      m_readahead_size = MAX(m_readahead_size, m_readahead_min_bytes);
-      m_readahead_size = MIN(m_readahead_size, m_readahead_max_bytes);
-      readahead_offset = m_readahead_pos;
-      readahead_length = m_readahead_size;
+      s->readahead_size = MAX(s->readahead_size, m_readahead_min_bytes);
+      s->readahead_size = MIN(s->readahead_size, m_readahead_max_bytes);
+      readahead_offset = s->readahead_pos;
+      readahead_length = s->readahead_size;
 
       // Snap to the first alignment possible
       uint64_t readahead_end = readahead_offset + readahead_length;
@@ -108,15 +167,15 @@ Readahead::extent_t Readahead::_compute_readahead(uint64_t limit) {
 	  readahead_length = align_next - readahead_offset;
 	  break;
 	}
-	// Note that m_readahead_size should remain unadjusted.
+	// Note that s->readahead_size should remain unadjusted.
       }
 
-      if (m_readahead_pos + readahead_length > limit) {
-	readahead_length = limit - m_readahead_pos;
+      if (s->readahead_pos + readahead_length > limit) {
+	readahead_length = limit - s->readahead_pos;
       }
 
-      m_readahead_trigger_pos = m_readahead_pos + readahead_length / 2;
-      m_readahead_pos += readahead_length;
+      s->readahead_trigger_pos = s->readahead_pos + readahead_length / 2;
+      s->readahead_pos += readahead_length;
     }
   }
   return extent_t(readahead_offset, readahead_length);
@@ -154,6 +213,17 @@ void Readahead::set_trigger_requests(int trigger_requests) {
   m_lock.Unlock();
 }
 
+void Readahead::set_max_streams(int max_streams) {
+  m_lock.Lock();
+  if (max_streams < 1) {
+    max_streams = 1;
+  }
+  m_streams.assign(max_streams, Stream());
+  m_cur = &m_streams.front();
+  m_stream_ticks = 0;
+  m_lock.Unlock();
+}
+
 void Readahead::set_min_readahead_size(uint64_t min_readahead_size) {
   m_lock.Lock();
   m_readahead_min_bytes = min_readahead_size;
@@ -10,6 +10,8 @@
 /**
    This class provides common state and logic for code that needs to perform readahead
    on linear things such as RBD images or files.
+   Several independent read streams are tracked at once, so interleaved sequential
+   readers and fixed-stride readers are recognized as well as a single sequential one.
    Unless otherwise specified, all methods are thread-safe.
 
    Minimum and maximum readahead sizes may be violated by up to 50\% if alignment is enabled.
@@ -76,6 +78,12 @@ public:
    */
   void set_trigger_requests(int trigger_requests);
 
+  /**
+     Sets the number of independent read streams (sequential or strided)
+     tracked at once.  Must be at least 1.  Resets all pattern state.
+   */
+  void set_max_streams(int max_streams);
+
   /**
      Sets the minimum size of a readahead request, in bytes.
    */
@@ -122,23 +130,67 @@ private:
   /// Held while reading/modifying any state except m_pending
   Mutex m_lock;
 
-  /// Number of consecutive read requests in the current sequential stream
-  int m_nr_consec_read;
+  /// State for one detected read stream, sequential or strided
+  struct Stream {
+    /// Number of consecutive read requests matching this stream's pattern
+    int nr_consec_read;
+
+    /// Number of bytes read by those requests
+    uint64_t consec_read_bytes;
+
+    /// Start of the last read matching this stream
+    uint64_t last_start;
+
+    /// End of the last read matching this stream
+    uint64_t last_pos;
+
+    /// Distance between consecutive read starts; 0 while reads are contiguous
+    uint64_t stride;
+
+    /// Number of reads that matched this stream's prediction
+    int hits;
+
+    /// Number of times the prediction missed and the stride was re-seeded
+    int misses;
+
+    /// Tick of the last read matching this stream, for LRU replacement; 0 if never used
+    uint64_t last_tick;
+
+    /// Position of the readahead stream
+    uint64_t readahead_pos;
+
+    /// When readahead is already triggered and the read stream crosses this point, readahead is continued
+    uint64_t readahead_trigger_pos;
+
+    /// Size of the next readahead request (barring changes due to alignment, etc.)
+    uint64_t readahead_size;
 
-  /// Number of bytes read in the current sequenial stream
-  uint64_t m_consec_read_bytes;
+    Stream() : last_tick(0) {
+      reset();
+    }
 
-  /// Position of the read stream
-  uint64_t m_last_pos;
+    void reset() {
+      nr_consec_read = 0;
+      consec_read_bytes = 0;
+      last_start = 0;
+      last_pos = 0;
+      stride = 0;
+      hits = 0;
+      misses = 0;
+      readahead_pos = 0;
+      readahead_trigger_pos = 0;
+      readahead_size = 0;
+    }
+  };
 
-  /// Position of the readahead stream
-  uint64_t m_readahead_pos;
+  /// Streams being tracked
+  std::vector<Stream> m_streams;
 
-  /// When readahead is already triggered and the read stream crosses this point, readahead is continued
-  uint64_t m_readahead_trigger_pos;
+  /// Stream the most recent read matched; always points into m_streams
+  Stream *m_cur;
 
-  /// Size of the next readahead request (barring changes due to alignment, etc.)
-  uint64_t m_readahead_size;
+  /// Read counter, used as the LRU clock for stream replacement
+  uint64_t m_stream_ticks;
 
   /// Number of pending readahead requests, as determined by inc_pending() and dec_pending()
   int m_pending;
@@ -0,0 +1,206 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * Copyright (C) 2004-2006 Sage Weil <sage@newdream.net>
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "common/SamplingProfiler.h"
+#include "common/BackTrace.h"
+
+#include <errno.h>
+#include <execinfo.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#define PROFILER_MAX_DEPTH   32
+#define PROFILER_MAX_SAMPLES 32768
+
+struct profiler_sample {
+  int depth;
+  void *frames[PROFILER_MAX_DEPTH];
+};
+
+// serializes start/stop/dump; never taken by the signal handler
+static pthread_mutex_t profiler_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static profiler_sample *profiler_buf = NULL;  // allocated on first start, kept
+static volatile int profiler_active = 0;
+static unsigned profiler_pos = 0;  // next slot; may run past the buffer end
+
+static void profiler_handler(int sig)
+{
+  if (!profiler_active)
+    return;
+  // gcc builtin rather than atomic_t: the spinlock fallback of
+  // include/atomic.h is not async-signal-safe
+  unsigned i = __sync_fetch_and_add(&profiler_pos, 1U);
+  if (i >= PROFILER_MAX_SAMPLES)
+    return;  // buffer full; keep counting so we can report drops
+  profiler_buf[i].depth = backtrace(profiler_buf[i].frames,
+				    PROFILER_MAX_DEPTH);
+}
+
+int SamplingProfiler::start(int hz)
+{
+  if (hz <= 0 || hz > 10000)
+    return -EINVAL;
+
+  pthread_mutex_lock(&profiler_lock);
+  if (profiler_active) {
+    pthread_mutex_unlock(&profiler_lock);
+    return -EBUSY;
+  }
+  if (!profiler_buf)
+    profiler_buf = new profiler_sample[PROFILER_MAX_SAMPLES];
+  memset(profiler_buf, 0, sizeof(profiler_sample) * PROFILER_MAX_SAMPLES);
+  profiler_pos = 0;
+
+  // prime backtrace(): its first call may allocate, which we must not
+  // do from the signal handler
+  void *primer[4];
+  backtrace(primer, 4);
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = profiler_handler;
+  sigemptyset(&sa.sa_mask);
+  sa.sa_flags = SA_RESTART;
+  if (sigaction(SIGPROF, &sa, NULL) < 0) {
+    int r = -errno;
+    pthread_mutex_unlock(&profiler_lock);
+    return r;
+  }
+  profiler_active = 1;
+
+  struct itimerval iv;
+  memset(&iv, 0, sizeof(iv));
+  long period = 1000000 / hz;
+  iv.it_interval.tv_sec = period / 1000000;
+  iv.it_interval.tv_usec = period % 1000000;
+  iv.it_value = iv.it_interval;
+  if (setitimer(ITIMER_PROF, &iv, NULL) < 0) {
+    int r = -errno;
+    profiler_active = 0;
+    signal(SIGPROF, SIG_IGN);
+    pthread_mutex_unlock(&profiler_lock);
+    return r;
+  }
+
+  pthread_mutex_unlock(&profiler_lock);
+  return 0;
+}
+
+int SamplingProfiler::stop()
+{
+  pthread_mutex_lock(&profiler_lock);
+  if (!profiler_active) {
+    pthread_mutex_unlock(&profiler_lock);
+    return -EINVAL;
+  }
+  struct itimerval iv;
+  memset(&iv, 0, sizeof(iv));
+  setitimer(ITIMER_PROF, &iv, NULL);
+  profiler_active = 0;
+  signal(SIGPROF, SIG_IGN);  // swallow any already-queued tick
+  pthread_mutex_unlock(&profiler_lock);
+  return 0;
+}
+
+void SamplingProfiler::reset()
+{
+  pthread_mutex_lock(&profiler_lock);
+  if (profiler_buf)
+    memset(profiler_buf, 0, sizeof(profiler_sample) * PROFILER_MAX_SAMPLES);
+  profiler_pos = 0;
+  pthread_mutex_unlock(&profiler_lock);
+}
+
+bool SamplingProfiler::running()
+{
+  return profiler_active;
+}
+
+uint64_t SamplingProfiler::get_samples()
+{
+  unsigned n = profiler_pos;
+  return n > PROFILER_MAX_SAMPLES ? PROFILER_MAX_SAMPLES : n;
+}
+
+uint64_t SamplingProfiler::get_lost()
+{
+  unsigned n = profiler_pos;
+  return n > PROFILER_MAX_SAMPLES ? n - PROFILER_MAX_SAMPLES : 0;
+}
+
+void SamplingProfiler::dump_folded(std::ostream& out)
+{
+  pthread_mutex_lock(&profiler_lock);
+  unsigned n = profiler_pos;
+  if (n > PROFILER_MAX_SAMPLES)
+    n = PROFILER_MAX_SAMPLES;
+
+  // aggregate identical stacks; frames 0-1 are the handler and the
+  // kernel signal trampoline, skip them.  a slot still being filled by
+  // the handler has depth 0 and is skipped too.
+  std::map<std::vector<void*>, uint64_t> agg;
+  for (unsigned i = 0; i < n; i++) {
+    const profiler_sample& s = profiler_buf[i];
+    if (s.depth <= 2)
+      continue;
+    std::vector<void*> v(s.frames + 2, s.frames + s.depth);
+    agg[v]++;
+  }
+
+  // symbolize each unique address once
+  std::map<void*, std::string> names;
+  for (std::map<std::vector<void*>, uint64_t>::iterator p = agg.begin();
+       p != agg.end(); ++p) {
+    for (unsigned j = 0; j < p->first.size(); j++)
+      names[p->first[j]];
+  }
+  if (!names.empty()) {
+    std::vector<void*> addrs;
+    for (std::map<void*, std::string>::iterator p = names.begin();
+	 p != names.end(); ++p)
+      addrs.push_back(p->first);
+    char **strings = backtrace_symbols(&addrs[0], addrs.size());
+    if (strings) {
+      for (unsigned i = 0; i < addrs.size(); i++)
+	names[addrs[i]] = ceph::BackTrace::demangle(strings[i]);
+      free(strings);
+    }
+  }
+
+  // emit root-first, one stack per line, leaf rightmost
+  for (std::map<std::vector<void*>, uint64_t>::iterator p = agg.begin();
+       p != agg.end(); ++p) {
+    const std::vector<void*>& v = p->first;
+    for (unsigned j = v.size(); j > 0; j--) {
+      if (j != v.size())
+	out << ';';
+      const std::string& nm = names[v[j - 1]];
+      if (nm.empty())
+	out << v[j - 1];
+      else
+	out << nm;
+    }
+    out << ' ' << p->second << '\n';
+  }
+
+  pthread_mutex_unlock(&profiler_lock);
+}
@@ -0,0 +1,45 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * Copyright (C) 2004-2006 Sage Weil <sage@newdream.net>
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_COMMON_SAMPLINGPROFILER_H
+#define CEPH_COMMON_SAMPLINGPROFILER_H
+
+#include <iosfwd>
+#include <stdint.h>
+
+/**
+ * In-process sampled stack profiler.
+ *
+ * While running, a SIGPROF handler driven by ITIMER_PROF captures the
+ * stack of whichever thread is consuming cpu into a preallocated sample
+ * buffer.  dump_folded() aggregates and symbolizes the samples into
+ * folded-stack format ("main;funcA;funcB <count>"), which feeds
+ * directly into flamegraph.pl.
+ *
+ * The profiler is process-wide, so all methods are static; start/stop
+ * are driven from the admin socket ("profile start" etc, see
+ * CephContext::do_command).  Steady-state cost when stopped is zero.
+ */
+class SamplingProfiler {
+ public:
+  static int start(int hz);             ///< begin sampling, -EBUSY if running
+  static int stop();                    ///< stop sampling, -EINVAL if stopped
+  static void reset();                  ///< discard collected samples
+  static bool running();
+  static uint64_t get_samples();        ///< samples captured
+  static uint64_t get_lost();           ///< samples dropped (buffer full)
+  static void dump_folded(std::ostream& out);
+};
+
+#endif
@@ -17,21 +17,26 @@
 #include "common/debug.h"
 #include "common/signal.h"
 #include "common/io_priority.h"
+#include "common/Formatter.h"
 
 #include <dirent.h>
 #include <errno.h>
 #include <iostream>
+#include <map>
 #include <pthread.h>
+#include <set>
 #include <signal.h>
 #include <sstream>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
+#include <vector>
 #ifdef HAVE_SCHED
 #include <sched.h>
 #endif
 
-static int _set_affinity(int id)
+static int _set_affinity_tid(pid_t tid, int id)
 {
 #ifdef HAVE_SCHED
   if (id >= 0 && id < CPU_SETSIZE) {
@@ -40,15 +45,108 @@ static int _set_affinity(int id)
 
     CPU_SET(id, &cpuset);
 
-    if (sched_setaffinity(0, sizeof(cpuset), &cpuset) < 0)
+    if (sched_setaffinity(tid, sizeof(cpuset), &cpuset) < 0)
       return -errno;
-    /* guaranteed to take effect immediately */
-    sched_yield();
   }
 #endif
   return 0;
 }
 
+static int _set_affinity(int id)
+{
+  int r = _set_affinity_tid(0, id);
+  if (r < 0)
+    return r;
+#ifdef HAVE_SCHED
+  /* guaranteed to take effect immediately */
+  sched_yield();
+#endif
+  return 0;
+}
+
+// thread role registry
+//
+// Every running Thread is registered here so that per-role affinity
+// policies can be applied and the current placement dumped over the
+// admin socket.  Plain pthread primitives and leaked heap containers
+// are used deliberately: this must be usable before and after any
+// CephContext exists.
+
+static pthread_mutex_t thread_registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static std::set<Thread*> *thread_registry = NULL;
+static std::map<std::string, std::vector<int> > *affinity_policy = NULL;
+static std::map<std::string, unsigned> *affinity_cursor = NULL;
+
+// pick the next cpu for a role, or -1 if the policy has none.
+// registry lock must be held.
+static int _pick_role_cpu(const std::string& role)
+{
+  if (!affinity_policy || role.empty())
+    return -1;
+  std::map<std::string, std::vector<int> >::iterator p =
+    affinity_policy->find(role);
+  if (p == affinity_policy->end())
+    return -1;
+  unsigned c = (*affinity_cursor)[role]++;
+  return p->second[c % p->second.size()];
+}
+
+// parse "0-3,8,10-11" into a list of cpu ids
+static bool _parse_cpu_list(const std::string& s, std::vector<int> *out)
+{
+  const char *p = s.c_str();
+  while (*p) {
+    char *e;
+    long a = strtol(p, &e, 10);
+    if (e == p || a < 0 || a > 4095)
+      return false;
+    long b = a;
+    if (*e == '-') {
+      p = e + 1;
+      b = strtol(p, &e, 10);
+      if (e == p || b < a || b > 4095)
+	return false;
+    }
+    for (long i = a; i <= b; i++)
+      out->push_back((int)i);
+    if (*e == ',')
+      p = e + 1;
+    else if (*e == '\0')
+      break;
+    else
+      return false;
+  }
+  return !out->empty();
+}
+
+// last cpu the task executed on, from /proc (field 39 of stat)
+static int _get_task_cpu(pid_t tid)
+{
+  char path[64], buf[1024];
+  snprintf(path, sizeof(path), "/proc/self/task/%d/stat", tid);
+  FILE *fp = fopen(path, "r");
+  if (!fp)
+    return -1;
+  size_t len = fread(buf, 1, sizeof(buf) - 1, fp);
+  fclose(fp);
+  if (len == 0)
+    return -1;
+  buf[len] = '\0';
+  char *p = strrchr(buf, ')');  // comm may contain spaces
+  if (!p || !p[1])
+    return -1;
+  int field = 2, cpu = -1;
+  for (p += 1; *p; p++) {
+    if (*p == ' ') {
+      if (++field == 39) {
+	cpu = atoi(p + 1);
+	break;
+      }
+    }
+  }
+  return cpu;
+}
+
 Thread::Thread()
   : thread_id(0),
     pid(0),
@@ -60,6 +158,10 @@ Thread::Thread()
 
 Thread::~Thread()
 {
+  pthread_mutex_lock(&thread_registry_lock);
+  if (thread_registry)
+    thread_registry->erase(this);
+  pthread_mutex_unlock(&thread_registry_lock);
 }
 
 void *Thread::_entry_func(void *arg) {
@@ -79,9 +181,20 @@ void *Thread::entry_wrapper()
 		    pid,
 		    IOPRIO_PRIO_VALUE(ioprio_class, ioprio_priority));
   }
+  pthread_mutex_lock(&thread_registry_lock);
+  if (!thread_registry)
+    thread_registry = new std::set<Thread*>;
+  thread_registry->insert(this);
+  if (cpuid < 0)
+    cpuid = _pick_role_cpu(role);
+  pthread_mutex_unlock(&thread_registry_lock);
   if (pid && cpuid >= 0)
     _set_affinity(cpuid);
-  return entry();
+  void *r = entry();
+  pthread_mutex_lock(&thread_registry_lock);
+  thread_registry->erase(this);
+  pthread_mutex_unlock(&thread_registry_lock);
+  return r;
 }
 
 const pthread_t &Thread::get_thread_id() const
@@ -199,3 +312,73 @@ int Thread::set_affinity(int id)
     _set_affinity(id);
   return 0;
 }
+
+int Thread::set_affinity_policy(const std::string& desc)
+{
+  std::map<std::string, std::vector<int> > *policy =
+    new std::map<std::string, std::vector<int> >;
+  size_t off = 0;
+  while (off < desc.length()) {
+    size_t end = desc.find(';', off);
+    if (end == std::string::npos)
+      end = desc.length();
+    std::string ent = desc.substr(off, end - off);
+    off = end + 1;
+    if (ent.empty())
+      continue;
+    size_t colon = ent.find(':');
+    if (colon == std::string::npos || colon == 0) {
+      delete policy;
+      return -EINVAL;
+    }
+    std::vector<int>& cpus = (*policy)[ent.substr(0, colon)];
+    if (!_parse_cpu_list(ent.substr(colon + 1), &cpus)) {
+      delete policy;
+      return -EINVAL;
+    }
+  }
+
+  pthread_mutex_lock(&thread_registry_lock);
+  delete affinity_policy;
+  affinity_policy = policy;
+  delete affinity_cursor;
+  affinity_cursor = new std::map<std::string, unsigned>;
+  // place already-running threads that have no explicit affinity
+  if (thread_registry) {
+    for (std::set<Thread*>::iterator p = thread_registry->begin();
+	 p != thread_registry->end();
+	 ++p) {
+      Thread *t = *p;
+      if (t->cpuid >= 0 || !t->pid)
+	continue;
+      int cpu = _pick_role_cpu(t->role);
+      if (cpu >= 0) {
+	t->cpuid = cpu;
+	_set_affinity_tid(t->pid, cpu);
+      }
+    }
+  }
+  pthread_mutex_unlock(&thread_registry_lock);
+  return 0;
+}
+
+void Thread::dump_placement(ceph::Formatter *f)
+{
+  pthread_mutex_lock(&thread_registry_lock);
+  f->open_array_section("threads");
+  if (thread_registry) {
+    for (std::set<Thread*>::iterator p = thread_registry->begin();
+	 p != thread_registry->end();
+	 ++p) {
+      Thread *t = *p;
+      f->open_object_section("thread");
+      f->dump_string("role", t->role);
+      f->dump_int("tid", t->pid);
+      f->dump_int("affinity_cpu", t->cpuid);
+      f->dump_int("last_cpu", t->pid ? _get_task_cpu(t->pid) : -1);
+      f->close_section();
+    }
+  }
+  f->close_section();
+  pthread_mutex_unlock(&thread_registry_lock);
+}
@@ -18,6 +18,11 @@
 
 #include <pthread.h>
 #include <sys/types.h>
+#include <string>
+
+namespace ceph {
+  class Formatter;
+}
 
 class Thread {
  private:
@@ -25,6 +30,7 @@ class Thread {
   pid_t pid;
   int ioprio_class, ioprio_priority;
   int cpuid;
+  std::string role;
 
   void *entry_wrapper();
 
@@ -53,6 +59,26 @@ class Thread {
   int detach();
   int set_ioprio(int cls, int prio);
   int set_affinity(int cpuid);
+
+  /// tag this thread with a role name; call before create().  Threads
+  /// sharing a role are placed round-robin over the role's cpu list
+  /// (if any) from the affinity policy.
+  void set_role(const std::string& r) { role = r; }
+  const std::string& get_role() const { return role; }
+
+  /**
+   * Install a per-role affinity policy.
+   *
+   * @param desc "role:cpulist[;role:cpulist...]", where cpulist is a
+   * comma-separated list of cpu ids and a-b ranges, e.g.
+   * "osd_op_tp:0-7,16-23;journal_write:0-7,16-23".  Applies to running
+   * threads whose affinity has not been set explicitly, and to threads
+   * started later.
+   */
+  static int set_affinity_policy(const std::string& desc);
+
+  /// dump role, tid and cpu placement of all live threads
+  static void dump_placement(ceph::Formatter *f);
 };
 
 #endif
@@ -130,13 +130,16 @@ bool Throttle::wait(int64_t m)
     return false;
   }
 
+  waiters.inc();
   Mutex::Locker l(lock);
   if (m) {
     assert(m > 0);
     _reset_max(m);
   }
   ldout(cct, 10) << "wait" << dendl;
-  return _wait(0);
+  bool waited = _wait(0);
+  waiters.dec();
+  return waited;
 }
 
 int64_t Throttle::take(int64_t c)
@@ -146,10 +149,7 @@ int64_t Throttle::take(int64_t c)
   }
   assert(c >= 0);
   ldout(cct, 10) << "take " << c << dendl;
-  {
-    Mutex::Locker l(lock);
-    count.add(c);
-  }
+  count.add(c);  // take ignores the limit, so no lock needed
   if (logger) {
     logger->inc(l_throttle_take);
     logger->inc(l_throttle_take_sum, c);
@@ -166,8 +166,31 @@ bool Throttle::get(int64_t c, int64_t m)
 
   assert(c >= 0);
   ldout(cct, 10) << "get " << c << " (" << count.read() << " -> " << (count.read() + c) << ")" << dendl;
+
+  if (0 == m && 0 == waiters.read()) {
+    // fast path: nobody is queued, so optimistically take the slots
+    // without the lock and keep them if we stayed within the limit.
+    // a racing get may observe our tentative overshoot and fall to
+    // the slow path, which just errs on the side of waiting.
+    count.add(c);
+    int64_t cur = count.read();
+    int64_t mx = max.read();
+    if (0 == mx ||
+	((c > mx || cur <= mx) && (c < mx || cur - c <= mx))) {
+      if (logger) {
+	logger->inc(l_throttle_get);
+	logger->inc(l_throttle_get_sum, c);
+	logger->set(l_throttle_val, count.read());
+      }
+      return false;
+    }
+    // crossed the limit; undo and queue up behind everyone else
+    count.sub(c);
+  }
+
   bool waited = false;
   {
+    waiters.inc();
     Mutex::Locker l(lock);
     if (m) {
       assert(m > 0);
@@ -175,6 +198,7 @@ bool Throttle::get(int64_t c, int64_t m)
     }
     waited = _wait(c);
     count.add(c);
+    waiters.dec();
   }
   if (logger) {
     logger->inc(l_throttle_get);
@@ -222,12 +246,17 @@ int64_t Throttle::put(int64_t c)
 
   assert(c >= 0);
   ldout(cct, 10) << "put " << c << " (" << count.read() << " -> " << (count.read()-c) << ")" << dendl;
-  Mutex::Locker l(lock);
   if (c) {
-    if (!cond.empty())
-      cond.front()->SignalOne();
     assert(((int64_t)count.read()) >= c); //if count goes negative, we failed somewhere!
+    // release the count before looking for waiters: a waiter always
+    // bumps `waiters` before checking the count, so we either see it
+    // here and signal, or it sees our updated count and doesn't block
     count.sub(c);
+    if (waiters.read()) {
+      Mutex::Locker l(lock);
+      if (!cond.empty())
+	cond.front()->SignalOne();
+    }
     if (logger) {
       logger->inc(l_throttle_put);
       logger->inc(l_throttle_put_sum, c);
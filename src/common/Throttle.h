@@ -25,6 +25,10 @@ class Throttle {
   const std::string name;
   PerfCounters *logger;
   ceph::atomic_t count, max;
+  /// threads in (or headed for) the blocking slow path; while this is
+  /// non-zero get() stops taking the lock-free fast path so nobody can
+  /// barge ahead of queued waiters
+  ceph::atomic_t waiters;
   Mutex lock;
   list<Cond*> cond;
   const bool use_perf;
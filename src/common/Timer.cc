@@ -45,17 +45,29 @@ public:
 typedef std::multimap < utime_t, Context *> scheduled_map_t;
 typedef std::map < Context*, scheduled_map_t::iterator > event_lookup_map_t;
 
-SafeTimer::SafeTimer(CephContext *cct_, Mutex &l, bool safe_callbacks)
+const double SafeTimer::WHEEL_TICK_SECONDS = 0.1;
+
+SafeTimer::SafeTimer(CephContext *cct_, Mutex &l, bool safe_callbacks,
+		     bool use_wheel)
   : cct(cct_), lock(l),
     safe_callbacks(safe_callbacks),
     thread(NULL),
-    stopping(false)
+    stopping(false),
+    use_wheel(use_wheel),
+    wheel_tick(0)
 {
+  if (use_wheel) {
+    wheel_start = ceph_clock_now(cct);
+    for (unsigned i = 0; i < WHEEL_SLOTS; ++i)
+      wheel.push_back(new xlist<wheel_event*>);
+  }
 }
 
 SafeTimer::~SafeTimer()
 {
   assert(thread == NULL);
+  for (unsigned i = 0; i < wheel.size(); ++i)
+    delete wheel[i];
 }
 
 void SafeTimer::init()
@@ -81,8 +93,76 @@ void SafeTimer::shutdown()
   }
 }
 
+uint64_t SafeTimer::tick_of(utime_t t) const
+{
+  if (t <= wheel_start)
+    return 0;
+  return (uint64_t)((double)(t - wheel_start) / WHEEL_TICK_SECONDS);
+}
+
+void SafeTimer::wheel_thread()
+{
+  lock.Lock();
+  ldout(cct,10) << "wheel_thread starting" << dendl;
+  while (!stopping) {
+    utime_t now = ceph_clock_now(cct);
+    uint64_t now_tick = tick_of(now);
+
+    while (wheel_tick <= now_tick && !stopping) {
+      xlist<wheel_event*> *slot = wheel[wheel_tick % WHEEL_SLOTS];
+      bool fired = true;
+      while (fired && !stopping) {
+	fired = false;
+	for (xlist<wheel_event*>::iterator p = slot->begin(); !p.end(); ++p) {
+	  wheel_event *ev = *p;
+	  if (tick_of(ev->when) > wheel_tick)
+	    continue;	// not due for another round (or more)
+
+	  Context *callback = ev->callback;
+	  ev->item.remove_myself();
+	  wheel_events.erase(callback);
+	  delete ev;
+	  ldout(cct,10) << "wheel_thread executing " << callback << dendl;
+
+	  if (!safe_callbacks)
+	    lock.Unlock();
+	  callback->complete(0);
+	  if (!safe_callbacks)
+	    lock.Lock();
+
+	  // the slot may have changed while unlocked; rescan it
+	  fired = true;
+	  break;
+	}
+      }
+      if (stopping)
+	break;
+      ++wheel_tick;
+    }
+    if (stopping)
+      break;
+
+    ldout(cct,20) << "wheel_thread going to sleep" << dendl;
+    if (wheel_events.empty()) {
+      cond.Wait(lock);
+    } else {
+      utime_t next = wheel_start;
+      next += (double)wheel_tick * WHEEL_TICK_SECONDS;
+      cond.WaitUntil(lock, next);
+    }
+    ldout(cct,20) << "wheel_thread awake" << dendl;
+  }
+  ldout(cct,10) << "wheel_thread exiting" << dendl;
+  lock.Unlock();
+}
+
 void SafeTimer::timer_thread()
 {
+  if (use_wheel) {
+    wheel_thread();
+    return;
+  }
+
   lock.Lock();
   ldout(cct,10) << "timer_thread starting" << dendl;
   while (!stopping) {
@@ -136,6 +216,11 @@ void SafeTimer::add_event_at(utime_t when, Context *callback)
   assert(lock.is_locked());
   ldout(cct,10) << "add_event_at " << when << " -> " << callback << dendl;
 
+  if (use_wheel) {
+    _wheel_add(when, callback);
+    return;
+  }
+
   scheduled_map_t::value_type s_val(when, callback);
   scheduled_map_t::iterator i = schedule.insert(s_val);
 
@@ -152,10 +237,48 @@ void SafeTimer::add_event_at(utime_t when, Context *callback)
 
 }
 
+void SafeTimer::_wheel_add(utime_t when, Context *callback)
+{
+  wheel_event *ev = new wheel_event(when, callback);
+  wheel[tick_of(when) % WHEEL_SLOTS]->push_back(&ev->item);
+
+  pair<ceph::unordered_map<Context*, wheel_event*>::iterator, bool> rval(
+    wheel_events.insert(make_pair(callback, ev)));
+
+  /* If you hit this, you tried to insert the same Context* twice. */
+  assert(rval.second);
+
+  /* The thread parks indefinitely when it has nothing scheduled;
+   * otherwise it already wakes within a tick. */
+  if (wheel_events.size() == 1)
+    cond.Signal();
+}
+
+bool SafeTimer::_wheel_cancel(Context *callback)
+{
+  ceph::unordered_map<Context*, wheel_event*>::iterator p =
+    wheel_events.find(callback);
+  if (p == wheel_events.end()) {
+    ldout(cct,10) << "cancel_event " << callback << " not found" << dendl;
+    return false;
+  }
+
+  ldout(cct,10) << "cancel_event " << p->second->when << " -> " << callback << dendl;
+  delete p->first;
+
+  p->second->item.remove_myself();
+  delete p->second;
+  wheel_events.erase(p);
+  return true;
+}
+
 bool SafeTimer::cancel_event(Context *callback)
 {
   assert(lock.is_locked());
-  
+
+  if (use_wheel)
+    return _wheel_cancel(callback);
+
   std::map<Context*, std::multimap<utime_t, Context*>::iterator>::iterator p = events.find(callback);
   if (p == events.end()) {
     ldout(cct,10) << "cancel_event " << callback << " not found" << dendl;
@@ -174,7 +297,17 @@ void SafeTimer::cancel_all_events()
 {
   ldout(cct,10) << "cancel_all_events" << dendl;
   assert(lock.is_locked());
-  
+
+  while (!wheel_events.empty()) {
+    ceph::unordered_map<Context*, wheel_event*>::iterator p =
+      wheel_events.begin();
+    ldout(cct,10) << " cancelled " << p->second->when << " -> " << p->first << dendl;
+    delete p->first;
+    p->second->item.remove_myself();
+    delete p->second;
+    wheel_events.erase(p);
+  }
+
   while (!events.empty()) {
     std::map<Context*, std::multimap<utime_t, Context*>::iterator>::iterator p = events.begin();
     ldout(cct,10) << " cancelled " << p->second->first << " -> " << p->first << dendl;
@@ -194,4 +327,10 @@ void SafeTimer::dump(const char *caller) const
        s != schedule.end();
        ++s)
     ldout(cct,10) << " " << s->first << "->" << s->second << dendl;
+
+  for (ceph::unordered_map<Context*, wheel_event*>::const_iterator p =
+	 wheel_events.begin();
+       p != wheel_events.end();
+       ++p)
+    ldout(cct,10) << " " << p->second->when << "->" << p->first << dendl;
 }
@@ -19,7 +19,11 @@
 #include "Mutex.h"
 #include "RWLock.h"
 
+#include "include/unordered_map.h"
+#include "include/xlist.h"
+
 #include <map>
+#include <vector>
 
 class CephContext;
 class Context;
@@ -46,6 +50,36 @@ class SafeTimer
   std::map<Context*, std::multimap<utime_t, Context*>::iterator> events;
   bool stopping;
 
+  /*
+   * Hashed timer wheel mode (use_wheel).  Events hash into one of
+   * WHEEL_SLOTS buckets by expiry tick; add and cancel are O(1)
+   * (intrusive list splice plus a hash lookup) instead of a multimap
+   * rebalance.  The timer thread advances one slot per tick and fires
+   * whatever in the slot is due, so far-future events in the same slot
+   * just get skipped until their round comes up.  Expiry granularity
+   * is one tick (WHEEL_TICK_SECONDS).
+   */
+  struct wheel_event {
+    utime_t when;
+    Context *callback;
+    xlist<wheel_event*>::item item;
+    wheel_event(utime_t w, Context *cb)
+      : when(w), callback(cb), item(this) {}
+  };
+  static const unsigned WHEEL_SLOTS = 256;
+  static const double WHEEL_TICK_SECONDS;
+
+  bool use_wheel;
+  std::vector<xlist<wheel_event*>*> wheel;
+  ceph::unordered_map<Context*, wheel_event*> wheel_events;
+  utime_t wheel_start;    ///< tick 0; set when the thread starts
+  uint64_t wheel_tick;    ///< next tick to scan
+
+  uint64_t tick_of(utime_t t) const;
+  void wheel_thread();
+  void _wheel_add(utime_t when, Context *callback);
+  bool _wheel_cancel(Context *callback);
+
   void dump(const char *caller = 0) const;
 
 public:
@@ -58,8 +92,14 @@ public:
    * Under some circumstances, holding the lock can cause lock cycles.
    * If you are able to relax requirements on cancelled callbacks, then
    * setting safe_callbacks = false eliminates the lock cycle issue.
+   *
+   * use_wheel selects the hashed timer wheel backend, which trades one
+   * tick of expiry granularity for O(1) add/cancel; use it for
+   * instances that schedule and cancel at high rates (e.g. per-op
+   * timeouts).
    * */
-  SafeTimer(CephContext *cct, Mutex &l, bool safe_callbacks=true);
+  SafeTimer(CephContext *cct, Mutex &l, bool safe_callbacks=true,
+	    bool use_wheel=false);
   ~SafeTimer();
 
   /* Call with the event_lock UNLOCKED.
@@ -16,9 +16,17 @@
 #include <vector>
 #include "common/debug.h"
 #include "common/config.h"
+#include "common/perf_counters.h"
 #include "msg/Message.h"
 #include "include/assert.h"
 
+enum {
+  l_optracker_first = 862000,
+  l_optracker_slab_hit,
+  l_optracker_slab_miss,
+  l_optracker_last,
+};
+
 #define dout_subsys ceph_subsys_optracker
 #undef dout_prefix
 #define dout_prefix _prefix(_dout)
@@ -88,48 +96,134 @@ void OpHistory::dump_ops(utime_t now, Formatter *f)
   f->close_section();
 }
 
+void OpLatencyHistogram::dump(Formatter *f) const
+{
+  f->open_object_section("op_latency_histogram");
+  for (int t = 0; t < NUM_TYPES; t++) {
+    uint64_t sums[NUM_BUCKETS];
+    uint64_t total = 0;
+    for (unsigned b = 0; b < NUM_BUCKETS; b++) {
+      sums[b] = 0;
+      for (vector<Shard*>::const_iterator p = shards.begin();
+	   p != shards.end();
+	   ++p)
+	sums[b] += (*p)->buckets[t][b].read();
+      total += sums[b];
+    }
+    f->open_object_section(get_type_name(t));
+    f->dump_unsigned("total", total);
+    f->open_array_section("buckets");
+    for (unsigned b = 0; b < NUM_BUCKETS; b++) {
+      if (!sums[b])
+	continue;
+      f->open_object_section("bucket");
+      f->dump_unsigned("lower_bound_usec", b ? ((uint64_t)1 << b) : 0);
+      f->dump_unsigned("count", sums[b]);
+      f->close_section();
+    }
+    f->close_section();
+    f->close_section();
+  }
+  f->close_section();
+}
+
 void OpTracker::dump_historic_ops(Formatter *f)
 {
   utime_t now = ceph_clock_now(cct);
   history.dump_ops(now, f);
 }
 
-void OpTracker::dump_ops_in_flight(Formatter *f)
+bool OpTracker::visit_shard(ShardedTrackingData *sdata, OpVisitor &v)
+{
+  Mutex::Locker locker(sdata->sweep_lock);
+  TrackedNode *prev = &sdata->stub;
+  TrackedNode *cur = prev->next;
+  while (cur) {
+    if (cur->state.compare_and_swap(NODE_LIVE, NODE_READING)) {
+      // pinned; unregister spins until we put it back
+      bool cont = v(cur->op);
+      cur->state.set(NODE_LIVE);
+      if (!cont)
+	return false;
+      prev = cur;
+      cur = cur->next;
+      continue;
+    }
+    if (cur->state.read() == NODE_DEAD && cur->next != NULL) {
+      // safe to unlink: next is set, so the producer that appended
+      // after this node is done touching it, and we are the only
+      // walker (sweep_lock)
+      prev->next = cur->next;
+      sdata->put_free_node(cur);
+      cur = prev->next;
+      continue;
+    }
+    // dead tail node; leave it for a later sweep
+    prev = cur;
+    cur = cur->next;
+  }
+  return true;
+}
+
+void OpTracker::visit_ops_in_flight(OpVisitor &v)
 {
-  f->open_object_section("ops_in_flight"); // overall dump
-  uint64_t total_ops_in_flight = 0;
-  f->open_array_section("ops"); // list of TrackedOps
-  utime_t now = ceph_clock_now(cct);
   for (uint32_t i = 0; i < num_optracker_shards; i++) {
     ShardedTrackingData* sdata = sharded_in_flight_list[i];
-    assert(NULL != sdata); 
-    Mutex::Locker locker(sdata->ops_in_flight_lock_sharded);    
-    for (xlist<TrackedOp*>::iterator p = sdata->ops_in_flight_sharded.begin(); !p.end(); ++p) {
+    assert(NULL != sdata);
+    if (!visit_shard(sdata, v))
+      return;
+  }
+}
+
+void OpTracker::dump_ops_in_flight(Formatter *f)
+{
+  struct DumpVisitor : public OpVisitor {
+    Formatter *f;
+    utime_t now;
+    uint64_t total;
+    DumpVisitor(Formatter *f, utime_t now) : f(f), now(now), total(0) {}
+    bool operator()(TrackedOp *op) {
       f->open_object_section("op");
-      (*p)->dump(now, f);
+      op->dump(now, f);
       f->close_section(); // this TrackedOp
-      total_ops_in_flight++;
+      total++;
+      return true;
     }
-  }
+  } v(f, ceph_clock_now(cct));
+
+  f->open_object_section("ops_in_flight"); // overall dump
+  f->open_array_section("ops"); // list of TrackedOps
+  visit_ops_in_flight(v);
   f->close_section(); // list of TrackedOps
-  f->dump_int("num_ops", total_ops_in_flight);
+  f->dump_int("num_ops", v.total);
   f->close_section(); // overall dump
 }
 
-void OpTracker::register_inflight_op(xlist<TrackedOp*>::item *i)
+void OpTracker::register_inflight_op(TrackedOp *i)
 {
   if (!tracking_enabled)
     return;
 
   uint64_t current_seq = seq.inc();
+  i->seq = current_seq;
   uint32_t shard_index = current_seq % num_optracker_shards;
   ShardedTrackingData* sdata = sharded_in_flight_list[shard_index];
   assert(NULL != sdata);
-  {
-    Mutex::Locker locker(sdata->ops_in_flight_lock_sharded);
-    sdata->ops_in_flight_sharded.push_back(i);
-    sdata->ops_in_flight_sharded.back()->seq = current_seq;
-  }
+
+  TrackedNode *n = sdata->get_free_node();
+  n->op = i;
+  n->next = NULL;
+  n->state.set(NODE_LIVE);
+  i->tnode = n;
+
+  // append at the tail so walkers see arrival order.  the CAS is a
+  // full barrier, so the node's fields above are visible before any
+  // walker can reach it through prev->next.
+  TrackedNode *prev;
+  do {
+    prev = reinterpret_cast<TrackedNode*>((uintptr_t)sdata->tail.read());
+  } while (!sdata->tail.compare_and_swap((uintptr_t)prev, (uintptr_t)n));
+  prev->next = n;
 }
 
 void OpTracker::unregister_inflight_op(TrackedOp *i)
@@ -137,14 +231,17 @@ void OpTracker::unregister_inflight_op(TrackedOp *i)
   // caller checks;
   assert(tracking_enabled);
 
-  uint32_t shard_index = i->seq % num_optracker_shards;
-  ShardedTrackingData* sdata = sharded_in_flight_list[shard_index];
-  assert(NULL != sdata);
-  {
-    Mutex::Locker locker(sdata->ops_in_flight_lock_sharded);
-    assert(i->xitem.get_list() == &sdata->ops_in_flight_sharded);
-    i->xitem.remove_myself();
+  TrackedNode *n = i->tnode;
+  assert(n);
+  while (!n->state.compare_and_swap(NODE_LIVE, NODE_DEAD)) {
+    // a walker has the node pinned (NODE_READING) and is looking at
+    // the op; wait for it to let go.  walks are rare and brief.
+    assert(n->state.read() != NODE_FREE);
   }
+  i->tnode = NULL;
+  // from here on the node is dead and op may be freed; a later sweep
+  // will unlink and recycle the node.
+
   i->_unregistered();
   utime_t now = ceph_clock_now(cct);
   history.insert(now, TrackedOpRef(i));
@@ -158,28 +255,26 @@ bool OpTracker::check_ops_in_flight(std::vector<string> &warning_vector)
   utime_t now = ceph_clock_now(cct);
   utime_t too_old = now;
   too_old -= complaint_time;
-  utime_t oldest_op = now;
-  uint64_t total_ops_in_flight = 0;
 
-  for (uint32_t i = 0; i < num_optracker_shards; i++) {
-    ShardedTrackingData* sdata = sharded_in_flight_list[i];
-    assert(NULL != sdata);
-    Mutex::Locker locker(sdata->ops_in_flight_lock_sharded);
-    if (!sdata->ops_in_flight_sharded.empty()) {
-      utime_t oldest_op_tmp = sdata->ops_in_flight_sharded.front()->get_initiated();
-      if (oldest_op_tmp < oldest_op) {
-        oldest_op = oldest_op_tmp;
-      }
-    } 
-    total_ops_in_flight += sdata->ops_in_flight_sharded.size();
-  }
-      
-  if (0 == total_ops_in_flight)
+  struct OldestVisitor : public OpVisitor {
+    utime_t oldest_op;
+    uint64_t total;
+    OldestVisitor(utime_t now) : oldest_op(now), total(0) {}
+    bool operator()(TrackedOp *op) {
+      if (op->get_initiated() < oldest_op)
+	oldest_op = op->get_initiated();
+      total++;
+      return true;
+    }
+  } ov(now);
+  visit_ops_in_flight(ov);
+
+  if (0 == ov.total)
     return false;
 
-  utime_t oldest_secs = now - oldest_op;
+  utime_t oldest_secs = now - ov.oldest_op;
 
-  dout(10) << "ops_in_flight.size: " << total_ops_in_flight
+  dout(10) << "ops_in_flight.size: " << ov.total
            << "; oldest is " << oldest_secs
            << " seconds old" << dendl;
 
@@ -190,42 +285,50 @@ bool OpTracker::check_ops_in_flight(std::vector<string> &warning_vector)
   //store summary message
   warning_vector.push_back("");
 
-  int slow = 0;     // total slow
-  int warned = 0;   // total logged
-  for (uint32_t iter = 0;
-       iter < num_optracker_shards && warned < log_threshold; iter++) {
-    ShardedTrackingData* sdata = sharded_in_flight_list[iter];
-    assert(NULL != sdata);
-    Mutex::Locker locker(sdata->ops_in_flight_lock_sharded);
-    if (sdata->ops_in_flight_sharded.empty())
-      continue;
-    xlist<TrackedOp*>::iterator i = sdata->ops_in_flight_sharded.begin();    
-    while (!i.end() && (*i)->get_initiated() < too_old) {
+  struct WarnVisitor : public OpVisitor {
+    utime_t now, too_old;
+    float complaint_time;
+    int log_threshold;
+    std::vector<string> &warning_vector;
+    int slow;     // total slow
+    int warned;   // total logged
+    WarnVisitor(utime_t now, utime_t too_old, float complaint_time,
+		int log_threshold, std::vector<string> &warning_vector)
+      : now(now), too_old(too_old), complaint_time(complaint_time),
+	log_threshold(log_threshold), warning_vector(warning_vector),
+	slow(0), warned(0) {}
+    bool operator()(TrackedOp *op) {
+      if (op->get_initiated() >= too_old)
+	return true;   // each shard is in arrival order, but the next
+		       // shard may still hold older ops; keep going
       slow++;
 
       // exponential backoff of warning intervals
-      if (((*i)->get_initiated() +
-	 (complaint_time * (*i)->warn_interval_multiplier)) < now) {
-      // will warn
-        warned++;
-        if (warned > log_threshold)
-          break;
-
-        utime_t age = now - (*i)->get_initiated();
-        stringstream ss;
-        ss << "slow request " << age << " seconds old, received at "
-           << (*i)->get_initiated() << ": ";
-        (*i)->_dump_op_descriptor_unlocked(ss);
-        ss << " currently "
-	   << ((*i)->current.size() ? (*i)->current : (*i)->state_string());
-        warning_vector.push_back(ss.str());
-
-        // only those that have been shown will backoff
-        (*i)->warn_interval_multiplier *= 2;
+      if ((op->get_initiated() +
+	   (complaint_time * op->warn_interval_multiplier)) < now) {
+	// will warn
+	warned++;
+	if (warned > log_threshold)
+	  return false;
+
+	utime_t age = now - op->get_initiated();
+	stringstream ss;
+	ss << "slow request " << age << " seconds old, received at "
+	   << op->get_initiated() << ": ";
+	op->_dump_op_descriptor_unlocked(ss);
+	ss << " currently "
+	   << (op->current.size() ? op->current : op->state_string());
+	warning_vector.push_back(ss.str());
+
+	// only those that have been shown will backoff
+	op->warn_interval_multiplier *= 2;
       }
-      ++i;
+      return true;
     }
-  }
+  } wv(now, too_old, complaint_time, log_threshold, warning_vector);
+  visit_ops_in_flight(wv);
+  int slow = wv.slow;
+  int warned = wv.warned;
 
   // only summarize if we warn about any.  if everything has backed
   // off, we will stay silent.
@@ -243,35 +346,34 @@ void OpTracker::get_age_ms_histogram(pow2_hist_t *h)
 {
   h->clear();
 
-  utime_t now = ceph_clock_now(NULL);
-  unsigned bin = 30;
-  uint32_t lb = 1 << (bin-1);  // lower bound for this bin
-  int count = 0;
-  
-  for (uint32_t iter = 0; iter < num_optracker_shards; iter++) {
-    ShardedTrackingData* sdata = sharded_in_flight_list[iter];
-    assert(NULL != sdata);
-    Mutex::Locker locker(sdata->ops_in_flight_lock_sharded);
-
-    for (xlist<TrackedOp*>::iterator i = sdata->ops_in_flight_sharded.begin();
-                                                               !i.end(); ++i) {
-      utime_t age = now - (*i)->get_initiated();
+  struct AgeVisitor : public OpVisitor {
+    pow2_hist_t *h;
+    utime_t now;
+    unsigned bin;
+    uint32_t lb;   // lower bound for this bin
+    int count;
+    AgeVisitor(pow2_hist_t *h, utime_t now)
+      : h(h), now(now), bin(30), lb(1 << (bin-1)), count(0) {}
+    bool operator()(TrackedOp *op) {
+      utime_t age = now - op->get_initiated();
       uint32_t ms = (long)(age * 1000.0);
       if (ms >= lb) {
-        count++;
-        continue;
+	count++;
+	return true;
       }
       if (count)
-        h->set_bin(bin, count);
+	h->set_bin(bin, count);
       while (lb > ms) {
-        bin--;
-        lb >>= 1;
+	bin--;
+	lb >>= 1;
       }
       count = 1;
+      return true;
     }
-  }
-  if (count)
-    h->set_bin(bin, count);
+  } v(h, ceph_clock_now(NULL));
+  visit_ops_in_flight(v);
+  if (v.count)
+    h->set_bin(v.bin, v.count);
 }
 
 void OpTracker::mark_event(TrackedOp *op, const string &dest, utime_t time)
@@ -293,10 +395,107 @@ void OpTracker::_mark_event(TrackedOp *op, const string &evt,
      
 }
 
+void OpTracker::_init_op_slabs()
+{
+  for (uint32_t i = 0; i < num_optracker_shards; i++)
+    slab_shards.push_back(new OpSlabShard);
+
+  // the name needs an instance id: tests create several trackers in
+  // one process
+  static atomic_t instance;
+  char name[32];
+  snprintf(name, sizeof(name), "optracker-%u",
+	   (unsigned)instance.inc());
+  PerfCountersBuilder b(cct, name, l_optracker_first, l_optracker_last);
+  b.add_u64_counter(l_optracker_slab_hit, "slab_hit",
+		    "Op allocations served from the slab recycler");
+  b.add_u64_counter(l_optracker_slab_miss, "slab_miss",
+		    "Op allocations that fell through to the allocator");
+  slab_logger = b.create_perf_counters();
+  cct->get_perfcounters_collection()->add(slab_logger);
+}
+
+void OpTracker::_shutdown_op_slabs()
+{
+  if (slab_logger) {
+    cct->get_perfcounters_collection()->remove(slab_logger);
+    delete slab_logger;
+    slab_logger = NULL;
+  }
+  while (!slab_shards.empty()) {
+    OpSlabShard *s = slab_shards.back();
+    for (vector<void*>::iterator p = s->free_chunks.begin();
+	 p != s->free_chunks.end();
+	 ++p)
+      ::operator delete(*p);
+    delete s;
+    slab_shards.pop_back();
+  }
+}
+
+void *OpTracker::alloc_op_mem(size_t size, bool *from_slab)
+{
+  size_t ss = slab_size.read();
+  if (ss == 0) {
+    slab_size.compare_and_swap(0, size);
+    ss = slab_size.read();
+  }
+  if (ss != size) {
+    // a second op type on the same tracker; don't recycle it
+    *from_slab = false;
+    return ::operator new(size);
+  }
+  *from_slab = true;
+  OpSlabShard *s = slab_shards[slab_next.inc() % slab_shards.size()];
+  void *p = NULL;
+  ceph_spin_lock(&s->lock);
+  if (!s->free_chunks.empty()) {
+    p = s->free_chunks.back();
+    s->free_chunks.pop_back();
+  }
+  ceph_spin_unlock(&s->lock);
+  if (p) {
+    slab_logger->inc(l_optracker_slab_hit);
+    return p;
+  }
+  slab_logger->inc(l_optracker_slab_miss);
+  return ::operator new(size);
+}
+
+void OpTracker::free_op_mem(void *p, bool from_slab)
+{
+  if (from_slab) {
+    OpSlabShard *s =
+      slab_shards[(reinterpret_cast<uintptr_t>(p) >> 6) % slab_shards.size()];
+    ceph_spin_lock(&s->lock);
+    if (s->free_chunks.size() < MAX_FREE_CHUNKS_PER_SHARD) {
+      s->free_chunks.push_back(p);
+      p = NULL;
+    }
+    ceph_spin_unlock(&s->lock);
+  }
+  if (p)
+    ::operator delete(p);
+}
+
+void OpTracker::free_op(TrackedOp *op)
+{
+  // ops single-inherit from TrackedOp, so `op` is also the start of
+  // the chunk create_request allocated
+  bool from_slab = op->from_op_slab;
+  op->~TrackedOp();
+  free_op_mem(op, from_slab);
+}
+
 void OpTracker::RemoveOnDelete::operator()(TrackedOp *op) {
+  utime_t now = ceph_clock_now(tracker->cct);
+  tracker->latency_histogram.record(
+    op->get_latency_type(),
+    now - op->get_initiated(),
+    reinterpret_cast<uintptr_t>(op) >> 6);
   if (!tracker->tracking_enabled) {
     op->_unregistered();
-    delete op;
+    tracker->free_op(op);
     return;
   }
   op->mark_event("done");
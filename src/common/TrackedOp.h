@@ -13,16 +13,17 @@
 
 #ifndef TRACKEDREQUEST_H_
 #define TRACKEDREQUEST_H_
+#include <new>
 #include <sstream>
 #include <stdint.h>
 #include <include/utime.h>
 #include "common/Mutex.h"
 #include "common/histogram.h"
-#include "include/xlist.h"
 #include "msg/Message.h"
 #include "include/memory.h"
 
 class TrackedOp;
+class PerfCounters;
 typedef ceph::shared_ptr<TrackedOp> TrackedOpRef;
 
 class OpTracker;
@@ -51,6 +52,62 @@ public:
   }
 };
 
+/**
+ * Fixed-size log2-scaled latency histogram with lock-free recording.
+ *
+ * Recording an op is a single atomic increment on one of several
+ * shards, so it stays cheap enough to leave enabled even when full op
+ * tracking (and its per-op event lists) is turned off.
+ */
+class OpLatencyHistogram {
+public:
+  enum op_type_t {
+    TYPE_OTHER = 0,
+    TYPE_READ,
+    TYPE_WRITE,
+    NUM_TYPES
+  };
+  static const char *get_type_name(int t) {
+    switch (t) {
+    case TYPE_READ: return "read";
+    case TYPE_WRITE: return "write";
+    default: return "other";
+    }
+  }
+  /// bucket n counts ops with latency in [2^n, 2^(n+1)) usecs; the top
+  /// bucket absorbs everything slower
+  static const unsigned NUM_BUCKETS = 32;
+
+private:
+  struct Shard {
+    atomic64_t buckets[NUM_TYPES][NUM_BUCKETS];
+  };
+  vector<Shard*> shards;
+
+public:
+  OpLatencyHistogram(uint32_t num_shards) {
+    for (uint32_t i = 0; i < num_shards; i++)
+      shards.push_back(new Shard);
+  }
+  ~OpLatencyHistogram() {
+    while (!shards.empty()) {
+      delete shards.back();
+      shards.pop_back();
+    }
+  }
+  void record(int type, const utime_t& lat, uint64_t shard_hint) {
+    assert(type >= 0 && type < NUM_TYPES);
+    uint64_t usec = lat.to_nsec() / 1000;
+    unsigned bucket = 0;
+    while (usec >>= 1)
+      bucket++;
+    if (bucket >= NUM_BUCKETS)
+      bucket = NUM_BUCKETS - 1;
+    shards[shard_hint % shards.size()]->buckets[type][bucket].inc();
+  }
+  void dump(Formatter *f) const;
+};
+
 class OpTracker {
   class RemoveOnDelete {
     OpTracker *tracker;
@@ -61,14 +118,131 @@ class OpTracker {
   friend class RemoveOnDelete;
   friend class OpHistory;
   atomic64_t seq;
+
+public:
+  /// node states; see ShardedTrackingData
+  enum {
+    NODE_FREE = 0,   ///< on the shard freelist
+    NODE_LIVE,       ///< op pointer valid
+    NODE_READING,    ///< a walker is using op; unregister must wait
+    NODE_DEAD        ///< op unregistered; node awaiting sweep
+  };
+
+  /// list node for an in-flight op.  owned by the shard, never by the
+  /// op: unregistering only flags it dead, so walkers stay safe even
+  /// though the op itself may be freed right after.
+  struct TrackedNode {
+    TrackedNode *next;
+    TrackedOp *op;     ///< only valid while state is LIVE/READING
+    atomic_t state;
+    TrackedNode() : next(NULL), op(NULL), state(NODE_FREE) {}
+  };
+
+  /// callback for visit_ops_in_flight; return false to stop early
+  struct OpVisitor {
+    virtual bool operator()(TrackedOp *op) = 0;
+    virtual ~OpVisitor() {}
+  };
+
+private:
+  /**
+   * Lock-free in-flight registry shard (intrusive MPSC list).
+   *
+   * Registration appends a node at the tail with a CAS loop;
+   * unregistration just CASes the node LIVE -> DEAD.  Neither takes a
+   * mutex, so op create/destroy never serializes on a shared lock.
+   * Walkers (dumps and the slow-op scan -- rare admin/tick paths) take
+   * sweep_lock, traverse from the permanent stub in arrival order, pin
+   * each live op with LIVE -> READING while looking at it, and unlink
+   * dead nodes onto the freelist as they go.  A dead node is only
+   * unlinked once its next pointer is set, i.e. once the producer that
+   * appended after it is done touching it; the current tail is left
+   * for a later sweep.
+   */
   struct ShardedTrackingData {
-    Mutex ops_in_flight_lock_sharded;
-    xlist<TrackedOp *> ops_in_flight_sharded;
-    ShardedTrackingData(string lock_name):
-        ops_in_flight_lock_sharded(lock_name.c_str()) {}
+    TrackedNode stub;           ///< permanent list head anchor
+    atomic64_t tail;            ///< TrackedNode*; producers append here
+    Mutex sweep_lock;           ///< serializes walkers
+    ceph_spinlock_t free_lock;  ///< protects free_nodes
+    vector<TrackedNode*> free_nodes;
+    ShardedTrackingData(string lock_name)
+      : tail((uintptr_t)&stub),
+	sweep_lock(lock_name.c_str()) {
+      stub.state.set(NODE_DEAD);   // never visited, never unlinked
+      ceph_spin_init(&free_lock);
+    }
+    ~ShardedTrackingData() {
+      // all ops must be unregistered by now
+      TrackedNode *p = stub.next;
+      while (p) {
+	TrackedNode *n = p->next;
+	assert(p->state.read() == NODE_DEAD);
+	delete p;
+	p = n;
+      }
+      for (vector<TrackedNode*>::iterator q = free_nodes.begin();
+	   q != free_nodes.end();
+	   ++q)
+	delete *q;
+      ceph_spin_destroy(&free_lock);
+    }
+    TrackedNode *get_free_node() {
+      TrackedNode *n = NULL;
+      ceph_spin_lock(&free_lock);
+      if (!free_nodes.empty()) {
+	n = free_nodes.back();
+	free_nodes.pop_back();
+      }
+      ceph_spin_unlock(&free_lock);
+      if (!n)
+	n = new TrackedNode;
+      return n;
+    }
+    void put_free_node(TrackedNode *n) {
+      n->op = NULL;
+      n->next = NULL;
+      n->state.set(NODE_FREE);
+      ceph_spin_lock(&free_lock);
+      free_nodes.push_back(n);
+      ceph_spin_unlock(&free_lock);
+    }
   };
   vector<ShardedTrackingData*> sharded_in_flight_list;
+  /// walk one shard in arrival order, sweeping dead nodes; holds the
+  /// shard's sweep_lock
+  bool visit_shard(ShardedTrackingData *sdata, OpVisitor &v);
+  /**
+   * Recycler for op allocations.  Ops are allocated and freed within a
+   * few milliseconds at very high rates, and a given tracker only ever
+   * sees one op type in practice, so raw chunks of the first-seen size
+   * are kept on small per-shard freelists instead of going back to the
+   * allocator.  Chunks always come from ::operator new, so an op that
+   * escapes the recycler (OpHistory holds a ref with the default
+   * deleter) can still be plain deleted safely.
+   */
+  struct OpSlabShard {
+    ceph_spinlock_t lock;
+    vector<void*> free_chunks;
+    OpSlabShard() {
+      ceph_spin_init(&lock);
+    }
+    ~OpSlabShard() {
+      ceph_spin_destroy(&lock);
+    }
+  };
+  vector<OpSlabShard*> slab_shards;
+  atomic_t slab_size;	///< chunk size, set by the first allocation
+  atomic_t slab_next;	///< round-robin cursor for allocation
+  static const unsigned MAX_FREE_CHUNKS_PER_SHARD = 128;
+  PerfCounters *slab_logger;
+  void _init_op_slabs();
+  void _shutdown_op_slabs();
+  void *alloc_op_mem(size_t size, bool *from_slab);
+  void free_op_mem(void *p, bool from_slab);
+  /// destroy an untracked op and recycle its memory
+  void free_op(TrackedOp *op);
   uint32_t num_optracker_shards;
+  OpLatencyHistogram latency_histogram;
   OpHistory history;
   float complaint_time;
   int log_threshold;
@@ -77,8 +251,11 @@ class OpTracker {
 public:
   bool tracking_enabled;
   CephContext *cct;
-  OpTracker(CephContext *cct_, bool tracking, uint32_t num_shards) : seq(0), 
+  OpTracker(CephContext *cct_, bool tracking, uint32_t num_shards) : seq(0),
+                                     slab_size(0), slab_next(0),
+				     slab_logger(NULL),
                                      num_optracker_shards(num_shards),
+				     latency_histogram(num_shards),
 				     complaint_time(0), log_threshold(0),
 				     tracking_enabled(tracking), cct(cct_) {
 
@@ -88,6 +265,7 @@ public:
       ShardedTrackingData* one_shard = new ShardedTrackingData(lock_name);
       sharded_in_flight_list.push_back(one_shard);
     }
+    _init_op_slabs();
   }
       
   void set_complaint_and_threshold(float time, int threshold) {
@@ -99,9 +277,16 @@ public:
   }
   void dump_ops_in_flight(Formatter *f);
   void dump_historic_ops(Formatter *f);
-  void register_inflight_op(xlist<TrackedOp*>::item *i);
+  /// always populated, even with tracking_enabled == false
+  void dump_op_latency(Formatter *f) {
+    latency_histogram.dump(f);
+  }
+  void register_inflight_op(TrackedOp *i);
   void unregister_inflight_op(TrackedOp *i);
 
+  /// visit every in-flight op, oldest first within each shard
+  void visit_ops_in_flight(OpVisitor &v);
+
   void get_age_ms_histogram(pow2_hist_t *h);
 
   /**
@@ -121,17 +306,21 @@ public:
   }
   ~OpTracker() {
     while (!sharded_in_flight_list.empty()) {
-      assert((sharded_in_flight_list.back())->ops_in_flight_sharded.empty());
+      // the shard destructor asserts every remaining node is dead
       delete sharded_in_flight_list.back();
       sharded_in_flight_list.pop_back();
-    }    
+    }
+    _shutdown_op_slabs();
   }
 
   template <typename T, typename U>
   typename T::Ref create_request(U params)
   {
-    typename T::Ref retval(new T(params, this),
-			   RemoveOnDelete(this));
+    bool from_slab;
+    void *mem = alloc_op_mem(sizeof(T), &from_slab);
+    T *op = new (mem) T(params, this);
+    op->from_op_slab = from_slab;
+    typename T::Ref retval(op, RemoveOnDelete(this));
     return retval;
   }
 };
@@ -140,7 +329,7 @@ class TrackedOp {
 private:
   friend class OpHistory;
   friend class OpTracker;
-  xlist<TrackedOp*>::item xitem;
+  OpTracker::TrackedNode *tnode;  ///< our slot in the in-flight registry
 protected:
   OpTracker *tracker; /// the tracker we are associated with
 
@@ -152,15 +341,19 @@ protected:
 
   uint32_t warn_interval_multiplier; // limits output of a given op warning
 
+  /// memory came from the tracker's slab recycler (see alloc_op_mem)
+  bool from_op_slab;
+
   TrackedOp(OpTracker *_tracker, const utime_t& initiated) :
-    xitem(this),
+    tnode(NULL),
     tracker(_tracker),
     initiated_at(initiated),
     lock("TrackedOp::lock"),
     seq(0),
-    warn_interval_multiplier(1)
+    warn_interval_multiplier(1),
+    from_op_slab(false)
   {
-    tracker->register_inflight_op(&xitem);
+    tracker->register_inflight_op(this);
     if (tracker->tracking_enabled)
       events.push_back(make_pair(initiated_at, "initiated"));
   }
@@ -188,6 +381,11 @@ public:
       return ceph_clock_now(NULL) - get_initiated();
   }
 
+  /// which OpLatencyHistogram bucket family this op belongs to
+  virtual int get_latency_type() const {
+    return OpLatencyHistogram::TYPE_OTHER;
+  }
+
   void mark_event(const string &event);
   virtual const char *state_string() const {
     return events.rbegin()->second.c_str();
@@ -0,0 +1,358 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * Copyright (C) 2004-2006 Sage Weil <sage@newdream.net>
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef WEIGHTED_ROUND_ROBIN_QUEUE_H
+#define WEIGHTED_ROUND_ROBIN_QUEUE_H
+
+#include "common/OpQueue.h"
+#include "include/assert.h"
+
+#include <map>
+#include <utility>
+#include <list>
+#include <vector>
+
+/**
+ * Deficit weighted round-robin queue with fixed priority lanes
+ *
+ * Each priority value gets its own lane; non-empty lanes are kept on
+ * a round-robin ring.  A lane at the head of the ring may dispatch as
+ * long as its deficit counter covers the cost of its front item; when
+ * it cannot, it earns a quantum proportional to its priority and the
+ * ring rotates.  Over time each lane therefore receives bandwidth
+ * proportional to (priority + 1), but both enqueue and dequeue touch
+ * only the head of the ring -- there is no tree walk over priorities
+ * and no global token redistribution as in PrioritizedQueue.
+ *
+ * enqueue_strict items bypass the ring and are serviced in strict
+ * priority order first, as in PrioritizedQueue.
+ *
+ * Within a lane, classes of type K are served round-robin to provide
+ * fairness between item sources (e.g. different clients).
+ */
+template <typename T, typename K>
+class WeightedRoundRobinQueue : public OpQueue<T, K> {
+  typedef typename OpQueue<T, K>::Filter Filter;
+
+  int64_t min_cost;
+  int64_t max_cost;
+  int64_t quantum;   ///< deficit earned per round per unit of weight
+  unsigned total;    ///< items across all normal lanes
+
+  typedef std::list<std::pair<unsigned, T> > ListPairs;
+  static unsigned filter_list_pairs(
+    ListPairs *l, const Filter &f,
+    std::list<T> *out) {
+    unsigned ret = 0;
+    if (out) {
+      for (typename ListPairs::reverse_iterator i = l->rbegin();
+	   i != l->rend();
+	   ++i) {
+	if (f(i->second)) {
+	  out->push_front(i->second);
+	}
+      }
+    }
+    for (typename ListPairs::iterator i = l->begin();
+	 i != l->end();
+      ) {
+      if (f(i->second)) {
+	l->erase(i++);
+	++ret;
+      } else {
+	++i;
+      }
+    }
+    return ret;
+  }
+
+  struct Lane {
+    typedef std::map<K, ListPairs> Classes;
+    Classes q;
+    unsigned size;
+    int64_t deficit;
+    typename Classes::iterator cur;
+    Lane() : size(0), deficit(0), cur(q.begin()) {}
+    Lane(const Lane &other)
+      : q(other.q),
+	size(other.size),
+	deficit(other.deficit),
+	cur(q.begin()) {}
+    void enqueue(K cl, unsigned cost, T item) {
+      q[cl].push_back(std::make_pair(cost, item));
+      if (cur == q.end())
+	cur = q.begin();
+      size++;
+    }
+    void enqueue_front(K cl, unsigned cost, T item) {
+      q[cl].push_front(std::make_pair(cost, item));
+      if (cur == q.end())
+	cur = q.begin();
+      size++;
+    }
+    std::pair<unsigned, T> front() const {
+      assert(!(q.empty()));
+      assert(cur != q.end());
+      return cur->second.front();
+    }
+    void pop_front() {
+      assert(!(q.empty()));
+      assert(cur != q.end());
+      cur->second.pop_front();
+      if (cur->second.empty())
+	q.erase(cur++);
+      else
+	++cur;
+      if (cur == q.end())
+	cur = q.begin();
+      size--;
+    }
+    bool empty() const {
+      return q.empty();
+    }
+    void remove_by_filter(const Filter &f, std::list<T> *out) {
+      for (typename Classes::iterator i = q.begin();
+	   i != q.end();
+	   ) {
+	size -= filter_list_pairs(&(i->second), f, out);
+	if (i->second.empty()) {
+	  if (cur == i)
+	    ++cur;
+	  q.erase(i++);
+	} else {
+	  ++i;
+	}
+      }
+      if (cur == q.end())
+	cur = q.begin();
+    }
+    void remove_by_class(K k, std::list<T> *out) {
+      typename Classes::iterator i = q.find(k);
+      if (i == q.end())
+	return;
+      size -= i->second.size();
+      if (i == cur)
+	++cur;
+      if (out) {
+	for (typename ListPairs::reverse_iterator j =
+	       i->second.rbegin();
+	     j != i->second.rend();
+	     ++j) {
+	  out->push_front(j->second);
+	}
+      }
+      q.erase(i);
+      if (cur == q.end())
+	cur = q.begin();
+    }
+    void dump(Formatter *f) const {
+      f->dump_int("deficit", deficit);
+      f->dump_int("size", size);
+      f->dump_int("num_keys", q.size());
+      if (!empty())
+	f->dump_int("first_item_cost", front().first);
+    }
+  };
+
+  /// one lane per priority; index == priority
+  std::vector<Lane> lanes;
+  /// round-robin ring of non-empty lane indexes
+  std::list<unsigned> active;
+
+  /// strict bands, serviced highest priority first
+  typedef std::map<unsigned, Lane> SubQueues;
+  SubQueues high_queue;
+
+  void activate(unsigned priority, bool front) {
+    if (priority >= lanes.size())
+      lanes.resize(priority + 1);
+    if (!lanes[priority].size) {
+      if (front)
+	active.push_front(priority);
+      else
+	active.push_back(priority);
+    }
+  }
+
+  void deactivate(unsigned priority) {
+    assert(!lanes[priority].size);
+    lanes[priority].deficit = 0;
+    active.remove(priority);
+  }
+
+  unsigned clamp_cost(unsigned cost) const {
+    if ((int64_t)cost < min_cost)
+      return min_cost;
+    if ((int64_t)cost > max_cost)
+      return max_cost;
+    return cost;
+  }
+
+public:
+  WeightedRoundRobinQueue(unsigned max_per, unsigned min_c)
+    : min_cost(min_c),
+      max_cost(max_per),
+      quantum(min_c ? min_c : 1),
+      total(0)
+  {}
+
+  unsigned length() const {
+    unsigned r = total;
+    for (typename SubQueues::const_iterator i = high_queue.begin();
+	 i != high_queue.end();
+	 ++i) {
+      assert(i->second.size);
+      r += i->second.size;
+    }
+    return r;
+  }
+
+  void remove_by_filter(const Filter &f, std::list<T> *removed = 0) {
+    for (unsigned i = 0; i < lanes.size(); ++i) {
+      if (!lanes[i].size)
+	continue;
+      unsigned before = lanes[i].size;
+      lanes[i].remove_by_filter(f, removed);
+      total -= before - lanes[i].size;
+      if (!lanes[i].size)
+	deactivate(i);
+    }
+    for (typename SubQueues::iterator i = high_queue.begin();
+	 i != high_queue.end();
+	 ) {
+      i->second.remove_by_filter(f, removed);
+      if (i->second.empty()) {
+	high_queue.erase(i++);
+      } else {
+	++i;
+      }
+    }
+  }
+
+  void remove_by_class(K k, std::list<T> *out = 0) {
+    for (unsigned i = 0; i < lanes.size(); ++i) {
+      if (!lanes[i].size)
+	continue;
+      unsigned before = lanes[i].size;
+      lanes[i].remove_by_class(k, out);
+      total -= before - lanes[i].size;
+      if (!lanes[i].size)
+	deactivate(i);
+    }
+    for (typename SubQueues::iterator i = high_queue.begin();
+	 i != high_queue.end();
+	 ) {
+      i->second.remove_by_class(k, out);
+      if (i->second.empty()) {
+	high_queue.erase(i++);
+      } else {
+	++i;
+      }
+    }
+  }
+
+  void enqueue_strict(K cl, unsigned priority, T item) {
+    high_queue[priority].enqueue(cl, 0, item);
+  }
+
+  void enqueue_strict_front(K cl, unsigned priority, T item) {
+    high_queue[priority].enqueue_front(cl, 0, item);
+  }
+
+  void enqueue(K cl, unsigned priority, unsigned cost, T item) {
+    activate(priority, false);
+    lanes[priority].enqueue(cl, clamp_cost(cost), item);
+    total++;
+  }
+
+  void enqueue_front(K cl, unsigned priority, unsigned cost, T item) {
+    // requeued work goes to the head of the ring too, so it is not
+    // penalized a full rotation for having been dispatched early
+    activate(priority, true);
+    lanes[priority].enqueue_front(cl, clamp_cost(cost), item);
+    total++;
+  }
+
+  bool empty() const {
+    return total == 0 && high_queue.empty();
+  }
+
+  T dequeue() {
+    assert(!empty());
+
+    if (!(high_queue.empty())) {
+      T ret = high_queue.rbegin()->second.front().second;
+      high_queue.rbegin()->second.pop_front();
+      if (high_queue.rbegin()->second.empty())
+	high_queue.erase(high_queue.rbegin()->first);
+      return ret;
+    }
+
+    while (true) {
+      assert(!active.empty());
+      unsigned i = active.front();
+      Lane &lane = lanes[i];
+      assert(lane.size);
+      unsigned cost = lane.front().first;
+      if (lane.deficit < (int64_t)cost) {
+	// earn a quantum proportional to weight and move to the back
+	// of the ring; the loop is bounded by max_cost / quantum
+	lane.deficit += (int64_t)(i + 1) * quantum;
+	active.pop_front();
+	active.push_back(i);
+	continue;
+      }
+      lane.deficit -= cost;
+      T ret = lane.front().second;
+      lane.pop_front();
+      total--;
+      if (!lane.size) {
+	// the served lane is at the head of the ring, so leaving the
+	// ring is a pop rather than a scan
+	lane.deficit = 0;
+	active.pop_front();
+      }
+      return ret;
+    }
+  }
+
+  void dump(Formatter *f) const {
+    f->dump_int("total", total);
+    f->dump_int("min_cost", min_cost);
+    f->dump_int("max_cost", max_cost);
+    f->dump_int("quantum", quantum);
+    f->open_array_section("high_queues");
+    for (typename SubQueues::const_iterator p = high_queue.begin();
+	 p != high_queue.end();
+	 ++p) {
+      f->open_object_section("subqueue");
+      f->dump_int("priority", p->first);
+      p->second.dump(f);
+      f->close_section();
+    }
+    f->close_section();
+    f->open_array_section("lanes");
+    for (unsigned i = 0; i < lanes.size(); ++i) {
+      if (!lanes[i].size)
+	continue;
+      f->open_object_section("lane");
+      f->dump_int("priority", i);
+      lanes[i].dump(f);
+      f->close_section();
+    }
+    f->close_section();
+  }
+};
+
+#endif
@@ -169,6 +169,7 @@ void ThreadPool::start_threads()
     if (r < 0)
       lderr(cct) << " set_ioprio got " << cpp_strerror(r) << dendl;
 
+    wt->set_role(name);
     wt->create();
   }
 }
@@ -356,6 +357,7 @@ void ShardedThreadPool::start_threads()
     WorkThreadSharded *wt = new WorkThreadSharded(this, thread_index);
     ldout(cct, 10) << "start_threads creating and starting " << wt << dendl;
     threads_shardedpool.push_back(wt);
+    wt->set_role(name);
     wt->create();
     thread_index++;
   }
@@ -438,3 +440,167 @@ void ShardedThreadPool::drain()
   ldout(cct,10) << "drained" << dendl;
 }
 
+
+WorkStealingThreadPool::WorkStealingThreadPool(CephContext *pcct_, string nm,
+  uint32_t pnum_threads): cct(pcct_),name(nm),lockname(nm + "::lock"),
+  pool_lock(lockname.c_str()),num_threads(pnum_threads),stop_threads(0),
+  pause_threads(0),drain_threads(0), num_paused(0), num_drained(0), wq(NULL) {}
+
+void WorkStealingThreadPool::worker(uint32_t thread_index)
+{
+  assert(wq != NULL);
+  ldout(cct,10) << "worker start" << dendl;
+
+  std::stringstream ss;
+  ss << name << " thread " << (void*)pthread_self();
+  heartbeat_handle_d *hb = cct->get_heartbeat_map()->add_worker(ss.str());
+
+  while (!stop_threads.read()) {
+    if (pause_threads.read()) {
+      pool_lock.Lock();
+      ++num_paused;
+      wait_cond.Signal();
+      while (pause_threads.read()) {
+	cct->get_heartbeat_map()->reset_timeout(
+	  hb,
+	  wq->timeout_interval, wq->suicide_interval);
+	pool_cond.WaitInterval(cct, pool_lock,
+	  utime_t(
+	    cct->_conf->threadpool_empty_queue_max_wait, 0));
+      }
+      --num_paused;
+      pool_lock.Unlock();
+    }
+    if (drain_threads.read()) {
+      pool_lock.Lock();
+      if (wq->_all_empty()) {
+	++num_drained;
+	wait_cond.Signal();
+	while (drain_threads.read()) {
+	  cct->get_heartbeat_map()->reset_timeout(
+	    hb,
+	    wq->timeout_interval, wq->suicide_interval);
+	  pool_cond.WaitInterval(cct, pool_lock,
+	    utime_t(
+	      cct->_conf->threadpool_empty_queue_max_wait, 0));
+	}
+	--num_drained;
+      }
+      pool_lock.Unlock();
+    }
+
+    cct->get_heartbeat_map()->reset_timeout(
+      hb,
+      wq->timeout_interval, wq->suicide_interval);
+    ThreadPool::TPHandle handle(cct, hb, wq->timeout_interval,
+				wq->suicide_interval);
+    if (wq->_try_process(thread_index, handle))
+      continue;
+
+    // nothing in our deque and nothing to steal; sleep until an
+    // enqueue pokes us.  recheck under the lock so a push that raced
+    // with our scan can't strand its item until the interval expires.
+    pool_lock.Lock();
+    if (!stop_threads.read() && wq->_all_empty())
+      pool_cond.WaitInterval(cct, pool_lock,
+	utime_t(
+	  cct->_conf->threadpool_empty_queue_max_wait, 0));
+    pool_lock.Unlock();
+  }
+
+  ldout(cct,10) << "stealing worker finish" << dendl;
+
+  cct->get_heartbeat_map()->remove_worker(hb);
+}
+
+void WorkStealingThreadPool::start_threads()
+{
+  assert(pool_lock.is_locked());
+  uint32_t thread_index = 0;
+  while (threads.size() < num_threads) {
+    WorkThreadStealing *wt = new WorkThreadStealing(this, thread_index);
+    ldout(cct, 10) << "start_threads creating and starting " << wt << dendl;
+    threads.push_back(wt);
+    wt->set_role(name);
+    wt->create();
+    thread_index++;
+  }
+}
+
+void WorkStealingThreadPool::start()
+{
+  ldout(cct,10) << "start" << dendl;
+
+  pool_lock.Lock();
+  start_threads();
+  pool_lock.Unlock();
+  ldout(cct,15) << "started" << dendl;
+}
+
+void WorkStealingThreadPool::stop()
+{
+  ldout(cct,10) << "stop" << dendl;
+  stop_threads.set(1);
+  {
+    Mutex::Locker l(pool_lock);
+    pool_cond.SignalAll();
+  }
+  for (vector<WorkThreadStealing*>::iterator p = threads.begin();
+       p != threads.end();
+       ++p) {
+    (*p)->join();
+    delete *p;
+  }
+  threads.clear();
+  assert(wq != NULL);
+  wq->_clear();
+  ldout(cct,15) << "stopped" << dendl;
+}
+
+void WorkStealingThreadPool::pause()
+{
+  ldout(cct,10) << "pause" << dendl;
+  pool_lock.Lock();
+  pause_threads.set(1);
+  pool_cond.SignalAll();
+  while (num_threads != num_paused) {
+    wait_cond.Wait(pool_lock);
+  }
+  pool_lock.Unlock();
+  ldout(cct,10) << "paused" << dendl;
+}
+
+void WorkStealingThreadPool::pause_new()
+{
+  ldout(cct,10) << "pause_new" << dendl;
+  pool_lock.Lock();
+  pause_threads.set(1);
+  pool_cond.SignalAll();
+  pool_lock.Unlock();
+  ldout(cct,10) << "paused_new" << dendl;
+}
+
+void WorkStealingThreadPool::unpause()
+{
+  ldout(cct,10) << "unpause" << dendl;
+  pool_lock.Lock();
+  pause_threads.set(0);
+  pool_cond.SignalAll();
+  pool_lock.Unlock();
+  ldout(cct,10) << "unpaused" << dendl;
+}
+
+void WorkStealingThreadPool::drain()
+{
+  ldout(cct,10) << "drain" << dendl;
+  pool_lock.Lock();
+  drain_threads.set(1);
+  pool_cond.SignalAll();
+  while (num_threads != num_drained) {
+    wait_cond.Wait(pool_lock);
+  }
+  drain_threads.set(0);
+  pool_cond.SignalAll();
+  pool_lock.Unlock();
+  ldout(cct,10) << "drained" << dendl;
+}
@@ -21,6 +21,9 @@
 #include "common/config_obs.h"
 #include "common/HeartbeatMap.h"
 
+#include <deque>
+#include <stdlib.h>
+
 class CephContext;
 
 /// Pool of threads that share work submitted to multiple work queues.
@@ -620,5 +623,201 @@ public:
 
 };
 
+/**
+ * Pool whose workers each own a deque of work items and steal from a
+ * victim when their own runs dry.
+ *
+ * ThreadPool funnels every dequeue through one mutex, and
+ * ShardedThreadPool binds work to a shard for its whole life; neither
+ * keeps the other cores busy when a single source is hot.  Here
+ * enqueues spread round-robin across per-worker deques, the common
+ * dequeue touches only the owner's lock, and a worker that finds its
+ * own deque empty takes the oldest item from a victim's deque before
+ * it ever sleeps.
+ */
+class WorkStealingThreadPool {
+
+  CephContext *cct;
+  string name;
+  string lockname;
+  Mutex pool_lock;    ///< lifecycle (pause/drain/idle sleep), not the deques
+  Cond pool_cond;     ///< idle and paused workers wait here
+  Cond wait_cond;     ///< pause()/drain() callers wait here
+  uint32_t num_threads;
+  atomic_t stop_threads;
+  atomic_t pause_threads;
+  atomic_t drain_threads;
+  uint32_t num_paused;
+  uint32_t num_drained;
+
+public:
+
+  class BaseWSQ {
+
+  public:
+    time_t timeout_interval, suicide_interval;
+    BaseWSQ(time_t ti, time_t sti): timeout_interval(ti), suicide_interval(sti) {}
+    virtual ~BaseWSQ() {}
+
+    /// process one item, own deque first, then a victim's; false if idle
+    virtual bool _try_process(uint32_t thread_index,
+			      ThreadPool::TPHandle &handle) = 0;
+    virtual bool _all_empty() = 0;
+    /// drop all queued items (called once the workers have stopped)
+    virtual void _clear() = 0;
+  };
+
+  template <typename T>
+  class WSQueue: public BaseWSQ {
+
+    WorkStealingThreadPool* pool;
+
+    struct shard_t {
+      Mutex lock;
+      std::deque<T> q;
+      shard_t(const string &n) : lock(n.c_str()) {}
+    };
+    vector<shard_t*> shards;
+    atomic_t next_shard;
+
+    bool _dequeue(uint32_t thread_index, T *item) {
+      shard_t *own = shards[thread_index];
+      own->lock.Lock();
+      if (!own->q.empty()) {
+	*item = own->q.front();
+	own->q.pop_front();
+	own->lock.Unlock();
+	return true;
+      }
+      own->lock.Unlock();
+
+      // steal the oldest item from someone else, starting at a random
+      // victim so idle workers don't all gang up on shard 0
+      uint32_t start = rand();
+      for (uint32_t k = 0; k < shards.size(); ++k) {
+	uint32_t v = (start + k) % shards.size();
+	if (v == thread_index)
+	  continue;
+	shard_t *victim = shards[v];
+	victim->lock.Lock();
+	if (!victim->q.empty()) {
+	  *item = victim->q.back();
+	  victim->q.pop_back();
+	  victim->lock.Unlock();
+	  return true;
+	}
+	victim->lock.Unlock();
+      }
+      return false;
+    }
+
+  protected:
+    /** @brief Process a work item.
+     * This function will be called several times in parallel
+     * and must therefore be thread-safe. */
+    virtual void _process(T item, ThreadPool::TPHandle &handle) = 0;
+
+  public:
+    WSQueue(const string &n, time_t ti, time_t sti,
+	    WorkStealingThreadPool* tp)
+      : BaseWSQ(ti, sti), pool(tp) {
+      for (uint32_t i = 0; i < tp->num_threads; ++i)
+	shards.push_back(new shard_t(n + "::shard"));
+      tp->set_wq(this);
+    }
+    virtual ~WSQueue() {
+      for (uint32_t i = 0; i < shards.size(); ++i)
+	delete shards[i];
+    }
+
+    void queue(T item) {
+      uint32_t i = next_shard.inc() % shards.size();
+      shards[i]->lock.Lock();
+      shards[i]->q.push_back(item);
+      shards[i]->lock.Unlock();
+      pool->_wake_one();
+    }
+    void queue_front(T item) {
+      uint32_t i = next_shard.inc() % shards.size();
+      shards[i]->lock.Lock();
+      shards[i]->q.push_front(item);
+      shards[i]->lock.Unlock();
+      pool->_wake_one();
+    }
+    void drain() {
+      pool->drain();
+    }
+
+    bool _try_process(uint32_t thread_index, ThreadPool::TPHandle &handle) {
+      T item;
+      if (!_dequeue(thread_index, &item))
+	return false;
+      handle.reset_tp_timeout();
+      _process(item, handle);
+      return true;
+    }
+    bool _all_empty() {
+      for (uint32_t i = 0; i < shards.size(); ++i) {
+	Mutex::Locker l(shards[i]->lock);
+	if (!shards[i]->q.empty())
+	  return false;
+      }
+      return true;
+    }
+    void _clear() {
+      for (uint32_t i = 0; i < shards.size(); ++i) {
+	Mutex::Locker l(shards[i]->lock);
+	shards[i]->q.clear();
+      }
+    }
+  };
+
+private:
+
+  BaseWSQ* wq;
+  // threads
+  struct WorkThreadStealing : public Thread {
+    WorkStealingThreadPool *pool;
+    uint32_t thread_index;
+    WorkThreadStealing(WorkStealingThreadPool *p, uint32_t pthread_index)
+      : pool(p), thread_index(pthread_index) {}
+    void *entry() {
+      pool->worker(thread_index);
+      return 0;
+    }
+  };
+
+  vector<WorkThreadStealing*> threads;
+  void start_threads();
+  void worker(uint32_t thread_index);
+  void set_wq(BaseWSQ* q) {
+    wq = q;
+  }
+  void _wake_one() {
+    Mutex::Locker l(pool_lock);
+    pool_cond.Signal();
+  }
+
+public:
+
+  WorkStealingThreadPool(CephContext *cct_, string nm, uint32_t pnum_threads);
+
+  ~WorkStealingThreadPool() {};
+
+  /// start thread pool thread
+  void start();
+  /// stop thread pool thread
+  void stop();
+  /// pause thread pool (if it not already paused)
+  void pause();
+  /// pause initiation of new work
+  void pause_new();
+  /// resume work in thread pool.  must match each pause() call 1:1 to resume.
+  void unpause();
+  /// wait for all work to complete
+  void drain();
+
+};
+
 
 #endif
@@ -576,24 +576,75 @@ public:
       return false;
     }
 
-    cell_type* tmp = new cell_type[new_table_size];
-    std::copy(bit_table_, bit_table_ + (new_table_size), tmp);
-    cell_type* itr = bit_table_ + (new_table_size);
-    cell_type* end = bit_table_ + (original_table_size);
-    cell_type* itr_tmp = tmp;
-    cell_type* itr_end = tmp + (new_table_size);
-    while (end != itr)
+    fold_to(new_table_size);
+    return true;
+  }
+
+  /**
+   * compress, but only to an exact power-of-two divisor of the current
+   * table size.  Filters folded this way keep a divisor chain of
+   * sizes, which is what try_merge() requires, at the cost of
+   * compressing a little less than the requested ratio.
+   */
+  inline bool compress_mergeable(const double& target_ratio)
+  {
+    if (!bit_table_)
+      return false;
+
+    if ((0.0 >= target_ratio) || (target_ratio >= 1.0))
     {
-      *(itr_tmp++) |= (*itr++);
-      if (itr_tmp == itr_end)
-	itr_tmp = tmp;
+      return false;
     }
 
-    delete[] bit_table_;
-    bit_table_ = tmp;
-    size_list.push_back(new_table_size);
-    table_size_ = new_table_size;
+    std::size_t original_table_size = size_list.back();
+    std::size_t target_table_size =
+      static_cast<std::size_t>(original_table_size * target_ratio);
+    std::size_t new_table_size = original_table_size;
+    while (!(new_table_size & 1) && (new_table_size >> 1) >= target_table_size)
+      new_table_size >>= 1;
+
+    if (new_table_size >= original_table_size)
+    {
+      return false;
+    }
+
+    fold_to(new_table_size);
+    return true;
+  }
+
+  /**
+   * merge another filter into this one by folding and OR-ing the bit
+   * tables.
+   *
+   * This is only well defined if both filters hash identically (same
+   * salts and original table size) and both have only ever been folded
+   * to exact divisors of the original size (see compress_mergeable()),
+   * so that each fold chain collapses to a single modulo.  Returns
+   * false and leaves this filter unchanged otherwise.
+   */
+  inline bool try_merge(const compressible_bloom_filter &other)
+  {
+    if (!bit_table_ || !other.bit_table_)
+      return false;
+    if (salt_ != other.salt_)
+      return false;
+    if (size_list.empty() || other.size_list.empty() ||
+	size_list.front() != other.size_list.front())
+      return false;
+    if (!is_divisor_chain() || !other.is_divisor_chain())
+      return false;
+    if (table_size_ < other.table_size_) {
+      if (other.table_size_ % table_size_)
+	return false;
+    } else if (table_size_ > other.table_size_) {
+      if (table_size_ % other.table_size_)
+	return false;
+      fold_to(other.table_size_);
+    }
 
+    for (std::size_t i = 0; i < other.table_size_; ++i)
+      bit_table_[i % table_size_] |= other.bit_table_[i];
+    insert_count_ += other.insert_count_;
     return true;
   }
 
@@ -617,6 +668,41 @@ private:
     bit = bit_index & 7;
   }
 
+  /// fold the bit table down to new_table_size, OR-ing wrapped bytes
+  inline void fold_to(std::size_t new_table_size)
+  {
+    std::size_t original_table_size = size_list.back();
+    cell_type* tmp = new cell_type[new_table_size];
+    std::copy(bit_table_, bit_table_ + (new_table_size), tmp);
+    cell_type* itr = bit_table_ + (new_table_size);
+    cell_type* end = bit_table_ + (original_table_size);
+    cell_type* itr_tmp = tmp;
+    cell_type* itr_end = tmp + (new_table_size);
+    while (end != itr)
+    {
+      *(itr_tmp++) |= (*itr++);
+      if (itr_tmp == itr_end)
+	itr_tmp = tmp;
+    }
+
+    delete[] bit_table_;
+    bit_table_ = tmp;
+    size_list.push_back(new_table_size);
+    table_size_ = new_table_size;
+  }
+
+  /// true if each size is an exact multiple of the next, i.e. the
+  /// modulo chain in compute_indices() collapses to a single modulo
+  inline bool is_divisor_chain() const
+  {
+    for (std::size_t i = 1; i < size_list.size(); ++i)
+    {
+      if (!size_list[i] || size_list[i-1] % size_list[i])
+	return false;
+    }
+    return true;
+  }
+
   std::vector<std::size_t> size_list;
 public:
   void encode(bufferlist& bl) const;
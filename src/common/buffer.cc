@@ -176,17 +176,54 @@ static simple_spinlock_t buffer_debug_lock = SIMPLE_SPINLOCK_INITIALIZER;
       // and/or registered memory that is scarce
       return true;
     }
+    /// called instead of delete when the last reference drops; return
+    /// true if the raw parked itself in a pool and must not be freed
+    virtual bool try_recycle() {
+      return false;
+    }
     bool get_crc(const pair<size_t, size_t> &fromto,
          pair<uint32_t, uint32_t> *crc) const {
       crc_lock.get_read();
       map<pair<size_t, size_t>, pair<uint32_t, uint32_t> >::const_iterator i =
       crc_map.find(fromto);
-      if (i == crc_map.end()) {
+      if (i != crc_map.end()) {
+          *crc = i->second;
           crc_lock.unlock();
-          return false;
+          return true;
+      }
+      // no exact match; see whether cached crcs for smaller ranges
+      // tile [from, to) exactly, as happens when crcs were computed
+      // before the buffer was re-segmented into one larger ptr.
+      // pieces are chained with the same zero-length adjustment
+      // trick list::crc32c uses for a mismatched initial value:
+      //   crc32c(buf, v') = crc32c(buf, v) ^ crc32c(0*len(buf), v ^ v')
+      uint32_t init = 0, cur = 0;
+      size_t pos = fromto.first;
+      bool have_first = false;
+      while (pos < fromto.second) {
+	// largest cached piece starting at pos that stays in range
+	map<pair<size_t, size_t>, pair<uint32_t, uint32_t> >::const_iterator p =
+	  crc_map.upper_bound(make_pair(pos, fromto.second));
+	if (p == crc_map.begin())
+	  break;
+	--p;
+	if (p->first.first != pos || p->first.second <= pos)
+	  break;
+	if (!have_first) {
+	  init = p->second.first;
+	  cur = p->second.second;
+	  have_first = true;
+	} else {
+	  cur = p->second.second ^
+	    ceph_crc32c(p->second.first ^ cur, NULL,
+			p->first.second - p->first.first);
+	}
+	pos = p->first.second;
       }
-      *crc = i->second;
       crc_lock.unlock();
+      if (!have_first || pos != fromto.second)
+	return false;
+      *crc = make_pair(init, cur);
       return true;
     }
     void set_crc(const pair<size_t, size_t> &fromto,
@@ -207,6 +244,43 @@ static simple_spinlock_t buffer_debug_lock = SIMPLE_SPINLOCK_INITIALIZER;
     }
   };
 
+  /*
+   * a raw with the data living in the same memory chunk as the raw
+   * itself, so creating a buffer costs one allocation instead of two.
+   * this matters for the small (frequently well under 64 byte) buffers
+   * that dominate encoding of things like utime_t and object attrs.
+   */
+  class buffer::raw_combined : public buffer::raw {
+  public:
+    raw_combined(char *dataptr, unsigned l) : raw(dataptr, l) {
+      inc_total_alloc(len);
+      bdout << "raw_combined " << this << " alloc " << (void *)data << " " << l << " " << buffer::get_total_alloc() << bendl;
+    }
+    ~raw_combined() {
+      dec_total_alloc(len);
+      bdout << "raw_combined " << this << " free " << (void *)data << " " << buffer::get_total_alloc() << bendl;
+    }
+    raw* clone_empty() {
+      return create(len);
+    }
+
+    static raw_combined *create(unsigned len) {
+      // data first so it keeps malloc's alignment, with the
+      // raw_combined object at the tail of the same chunk
+      size_t datalen = ROUND_UP_TO((size_t)len, __alignof__(raw_combined));
+      char *p = (char*)malloc(datalen + sizeof(raw_combined));
+      if (!p)
+	throw bad_alloc();
+      return new (p + datalen) raw_combined(p, len);
+    }
+
+    static void operator delete(void *p) {
+      // the data pointer is the start of the combined allocation
+      raw_combined *raw = (raw_combined *)p;
+      ::free((void *)raw->data);
+    }
+  };
+
   class buffer::raw_malloc : public buffer::raw {
   public:
     raw_malloc(unsigned l) : raw(l) {
@@ -254,10 +328,43 @@ static simple_spinlock_t buffer_debug_lock = SIMPLE_SPINLOCK_INITIALIZER;
     }
   };
 
+  /*
+   * a read-only window onto a file, mapped in place of a copied-out
+   * buffer.  the mapping is released when the last reference drops.
+   */
+  class buffer::raw_mmap_file : public buffer::raw {
+    char *base;
+    unsigned map_len;
+  public:
+    raw_mmap_file(unsigned l, int fd, uint64_t offset) : raw(l) {
+      unsigned front = offset & ~CEPH_PAGE_MASK;
+      map_len = front + len;
+      base = (char*)::mmap(NULL, map_len, PROT_READ, MAP_PRIVATE, fd,
+			   offset & CEPH_PAGE_MASK);
+      if (base == MAP_FAILED)
+	throw error_code(-errno);
+      data = base + front;
+      inc_total_alloc(map_len);
+      bdout << "raw_mmap_file " << this << " map " << (void *)data << " " << l << " " << buffer::get_total_alloc() << bendl;
+    }
+    ~raw_mmap_file() {
+      ::munmap(base, map_len);
+      dec_total_alloc(map_len);
+      bdout << "raw_mmap_file " << this << " unmap " << (void *)data << " " << buffer::get_total_alloc() << bendl;
+    }
+    raw* clone_empty() {
+      // a clone is a copy by definition; plain pages will do
+      return buffer::create(len);
+    }
+  };
+
   class buffer::raw_posix_aligned : public buffer::raw {
     unsigned align;
   public:
-    raw_posix_aligned(unsigned l, unsigned _align) : raw(l) {
+    /// freelist link while parked in the thread-local page pool
+    raw_posix_aligned *pool_next;
+
+    raw_posix_aligned(unsigned l, unsigned _align) : raw(l), pool_next(NULL) {
       align = _align;
       assert((align >= sizeof(void *)) && (align & (align - 1)) == 0);
 #ifdef DARWIN
@@ -281,7 +388,200 @@ static simple_spinlock_t buffer_debug_lock = SIMPLE_SPINLOCK_INITIALIZER;
     raw* clone_empty() {
       return new raw_posix_aligned(len, align);
     }
+    bool try_recycle();
+  };
+
+  /*
+   * thread-local pool of free page-size, page-aligned raws.  the OSD
+   * write path allocates and frees these at a very high rate, so
+   * instead of going back to the allocator a dying raw parks itself
+   * here and the next create_page_aligned() on the thread reuses it.
+   */
+  struct page_raw_pool_t {
+    static const unsigned MAX = 64;
+    buffer::raw_posix_aligned *head;
+    unsigned count;
+    page_raw_pool_t() : head(NULL), count(0) {}
+    ~page_raw_pool_t() {
+      while (head) {
+	buffer::raw_posix_aligned *r = head;
+	head = r->pool_next;
+	delete r;
+      }
+    }
+  };
+  static thread_local page_raw_pool_t page_raw_pool;
+
+  bool buffer::raw_posix_aligned::try_recycle()
+  {
+    if (len != CEPH_PAGE_SIZE || align != CEPH_PAGE_SIZE)
+      return false;
+    page_raw_pool_t *pool = &page_raw_pool;
+    if (pool->count >= page_raw_pool_t::MAX)
+      return false;
+    invalidate_crc();
+    pool_next = pool->head;
+    pool->head = this;
+    pool->count++;
+    return true;
+  }
+#endif
+
+#if defined(__linux__) && defined(MAP_HUGETLB)
+  /*
+   * opt-in arena of 2MB hugepages backing large data buffers.  the
+   * OSD data path (messenger receive, filestore reads) churns through
+   * multi-megabyte aligned buffers; a fresh posix_memalign for each
+   * one costs a TLB entry per 4k on every access and slowly
+   * fragments the heap.  spans are carved from the arena in whole
+   * hugepages and recycled through a freelist per size class, with a
+   * tiny per-thread cache in front so the steady alloc/free rhythm of
+   * a reader or filestore thread never touches the shared lists.
+   * when the arena runs dry create_page_aligned() falls back to
+   * posix_memalign as before.
+   */
+  struct hugepage_pool_t {
+    static const unsigned SLAB_SHIFT = 21;   // 2MB, the x86_64 hugepage
+    static const unsigned CLASSES = 4;       // spans of 1..4 slabs
+    char *arena;
+    char *bump;              ///< next uncarved byte, under lock
+    char *end;
+    void *central[CLASSES];  ///< embedded freelists, under lock
+    simple_spinlock_t lock;
+    atomic64_t inuse;        ///< span bytes backing live raws
+    uint64_t total;
+    hugepage_pool_t() : arena(NULL), bump(NULL), end(NULL), total(0) {
+      memset(central, 0, sizeof(central));
+      lock = SIMPLE_SPINLOCK_INITIALIZER;
+    }
+  };
+  static hugepage_pool_t hugepage_pool;
+
+  static inline uint64_t hugepage_span_bytes(unsigned cls) {
+    return (uint64_t)(cls + 1) << hugepage_pool_t::SLAB_SHIFT;
+  }
+
+  struct hugepage_tcache_t {
+    static const unsigned MAX = 2;  // spans are MBs; keep the cache tiny
+    void *head[hugepage_pool_t::CLASSES];
+    unsigned count[hugepage_pool_t::CLASSES];
+    hugepage_tcache_t() {
+      memset(head, 0, sizeof(head));
+      memset(count, 0, sizeof(count));
+    }
+    ~hugepage_tcache_t();
+  };
+  static thread_local hugepage_tcache_t hugepage_tcache;
+
+  static void *hugepage_span_get(unsigned cls)
+  {
+    hugepage_tcache_t *tc = &hugepage_tcache;
+    void *p = tc->head[cls];
+    if (p) {
+      tc->head[cls] = *(void**)p;
+      tc->count[cls]--;
+      return p;
+    }
+    simple_spin_lock(&hugepage_pool.lock);
+    p = hugepage_pool.central[cls];
+    if (p) {
+      hugepage_pool.central[cls] = *(void**)p;
+    } else if (hugepage_pool.bump + hugepage_span_bytes(cls) <=
+	       hugepage_pool.end) {
+      p = hugepage_pool.bump;
+      hugepage_pool.bump += hugepage_span_bytes(cls);
+    }
+    simple_spin_unlock(&hugepage_pool.lock);
+    return p;
+  }
+
+  static void hugepage_span_put(unsigned cls, void *p)
+  {
+    hugepage_tcache_t *tc = &hugepage_tcache;
+    if (tc->count[cls] < hugepage_tcache_t::MAX) {
+      *(void**)p = tc->head[cls];
+      tc->head[cls] = p;
+      tc->count[cls]++;
+      return;
+    }
+    simple_spin_lock(&hugepage_pool.lock);
+    *(void**)p = hugepage_pool.central[cls];
+    hugepage_pool.central[cls] = p;
+    simple_spin_unlock(&hugepage_pool.lock);
+  }
+
+  hugepage_tcache_t::~hugepage_tcache_t()
+  {
+    // dying thread hands its cached spans back to the shared lists
+    for (unsigned c = 0; c < hugepage_pool_t::CLASSES; c++) {
+      while (head[c]) {
+	void *p = head[c];
+	head[c] = *(void**)p;
+	simple_spin_lock(&hugepage_pool.lock);
+	*(void**)p = hugepage_pool.central[c];
+	hugepage_pool.central[c] = p;
+	simple_spin_unlock(&hugepage_pool.lock);
+      }
+    }
+  }
+
+  class buffer::raw_hugepage : public buffer::raw {
+    unsigned cls;
+  public:
+    raw_hugepage(char *span, unsigned l, unsigned _cls)
+      : raw(span, l), cls(_cls) {
+      inc_total_alloc(len);
+      hugepage_pool.inuse.add(hugepage_span_bytes(cls));
+      bdout << "raw_hugepage " << this << " alloc " << (void *)data << " l=" << l << " total_alloc=" << buffer::get_total_alloc() << bendl;
+    }
+    ~raw_hugepage() {
+      hugepage_pool.inuse.sub(hugepage_span_bytes(cls));
+      dec_total_alloc(len);
+      hugepage_span_put(cls, data);
+      bdout << "raw_hugepage " << this << " free " << (void *)data << " " << buffer::get_total_alloc() << bendl;
+    }
+    raw* clone_empty() {
+      return buffer::create_page_aligned(len);
+    }
   };
+
+  bool buffer::init_hugepage_pool(uint64_t bytes)
+  {
+    if (hugepage_pool.arena)
+      return true;    // once per process is plenty
+    bytes &= ~(((uint64_t)1 << hugepage_pool_t::SLAB_SHIFT) - 1);
+    if (!bytes)
+      return false;
+    void *a = ::mmap(NULL, bytes, PROT_READ|PROT_WRITE,
+		     MAP_PRIVATE|MAP_ANON|MAP_HUGETLB, -1, 0);
+    if (a == MAP_FAILED)
+      return false;   // vm.nr_hugepages says no
+    hugepage_pool.arena = hugepage_pool.bump = (char*)a;
+    hugepage_pool.end = (char*)a + bytes;
+    hugepage_pool.total = bytes;
+    return true;
+  }
+  uint64_t buffer::get_hugepage_pool_inuse()
+  {
+    return hugepage_pool.inuse.read();
+  }
+  uint64_t buffer::get_hugepage_pool_total()
+  {
+    return hugepage_pool.total;
+  }
+#else
+  bool buffer::init_hugepage_pool(uint64_t)
+  {
+    return false;
+  }
+  uint64_t buffer::get_hugepage_pool_inuse()
+  {
+    return 0;
+  }
+  uint64_t buffer::get_hugepage_pool_total()
+  {
+    return 0;
+  }
 #endif
 
 #ifdef __CYGWIN__
@@ -571,11 +871,13 @@ static simple_spinlock_t buffer_debug_lock = SIMPLE_SPINLOCK_INITIALIZER;
 
   class buffer::xio_mempool : public buffer::raw {
   public:
-    struct xio_reg_mem *mp;
-    xio_mempool(struct xio_reg_mem *_mp, unsigned l) :
-      raw((char*)mp->addr, l), mp(_mp)
+    struct xio_reg_mem mp;
+    xio_mempool(struct xio_reg_mem& _mp, unsigned l) :
+      raw((char*)_mp.addr, l), mp(_mp)
     { }
-    ~xio_mempool() {}
+    ~xio_mempool() {
+      xio_mempool_free(&mp);
+    }
     raw* clone_empty() {
       return new buffer::raw_char(len);
     }
@@ -585,7 +887,7 @@ static simple_spinlock_t buffer_debug_lock = SIMPLE_SPINLOCK_INITIALIZER;
   {
     buffer::xio_mempool *mb = dynamic_cast<buffer::xio_mempool*>(bp.get_raw());
     if (mb) {
-      return mb->mp;
+      return &mb->mp;
     }
     return NULL;
   }
@@ -598,15 +900,26 @@ static simple_spinlock_t buffer_debug_lock = SIMPLE_SPINLOCK_INITIALIZER;
     new (bp) xio_msg_buffer(m_hook, buf, len);
     return bp;
   }
+
+  buffer::raw* buffer::create_reg(unsigned len) {
+    if (! xio_msgr_reg_mpool)
+      return NULL;
+    /* no malloc fallback here: unregistered memory would defeat the
+     * purpose, the caller falls back to an ordinary buffer instead */
+    struct xio_reg_mem mp;
+    if (xio_mempool_alloc(xio_msgr_reg_mpool, len, &mp))
+      return NULL;
+    return new xio_mempool(mp, len);
+  }
 #endif /* HAVE_XIO */
 
   buffer::raw* buffer::copy(const char *c, unsigned len) {
-    raw* r = new raw_char(len);
+    raw* r = raw_combined::create(len);
     memcpy(r->data, c, len);
     return r;
   }
   buffer::raw* buffer::create(unsigned len) {
-    return new raw_char(len);
+    return raw_combined::create(len);
   }
   buffer::raw* buffer::claim_char(unsigned len, char *buf) {
     return new raw_char(len, buf);
@@ -629,6 +942,29 @@ static simple_spinlock_t buffer_debug_lock = SIMPLE_SPINLOCK_INITIALIZER;
 #endif
   }
   buffer::raw* buffer::create_page_aligned(unsigned len) {
+#if defined(__linux__) && defined(MAP_HUGETLB)
+    if (hugepage_pool.arena &&
+	len > ((unsigned)1 << hugepage_pool_t::SLAB_SHIFT) / 2) {
+      unsigned cls = (len - 1) >> hugepage_pool_t::SLAB_SHIFT;
+      if (cls < hugepage_pool_t::CLASSES) {
+	void *span = hugepage_span_get(cls);
+	if (span)
+	  return new raw_hugepage((char*)span, len, cls);
+	// arena exhausted; fall through to the ordinary aligned path
+      }
+    }
+#endif
+#ifndef __CYGWIN__
+    if (len == CEPH_PAGE_SIZE) {
+      page_raw_pool_t *pool = &page_raw_pool;
+      if (pool->head) {
+	raw_posix_aligned *r = pool->head;
+	pool->head = r->pool_next;
+	pool->count--;
+	return r;
+      }
+    }
+#endif
     return create_aligned(len, CEPH_PAGE_SIZE);
   }
 
@@ -646,6 +982,14 @@ static simple_spinlock_t buffer_debug_lock = SIMPLE_SPINLOCK_INITIALIZER;
 #endif
   }
 
+  buffer::raw* buffer::create_mmap_file(unsigned len, int fd, uint64_t offset) {
+#ifndef __CYGWIN__
+    return new raw_mmap_file(len, fd, offset);
+#else
+    throw error_code(-ENOTSUP);
+#endif
+  }
+
   buffer::raw* buffer::create_unshareable(unsigned len) {
     return new raw_unshareable(len);
   }
@@ -736,7 +1080,8 @@ static simple_spinlock_t buffer_debug_lock = SIMPLE_SPINLOCK_INITIALIZER;
       bdout << "ptr " << this << " release " << _raw << bendl;
       if (_raw->nref.dec() == 0) {
 	//cout << "hosing raw " << (void*)_raw << " len " << _raw->len << std::endl;
-	delete _raw;  // dealloc old (if any)
+	if (!_raw->try_recycle())
+	  delete _raw;  // dealloc old (if any)
       }
       _raw = 0;
     }
@@ -1557,6 +1902,28 @@ void buffer::list::rebuild_page_aligned()
     }
   }
 
+  char *buffer::list::reserve_append_space(unsigned len)
+  {
+    if (append_buffer.unused_tail_length() < len) {
+      // make a new append_buffer, as append() does.  the old one keeps
+      // whatever tail it has left; we never write a reservation across
+      // two buffers.
+      unsigned alen = CEPH_BUFFER_APPEND_SIZE * (((len-1) / CEPH_BUFFER_APPEND_SIZE) + 1);
+      append_buffer = create_aligned(alen, CEPH_BUFFER_APPEND_SIZE);
+      append_buffer.set_length(0);   // unused, so far.
+    }
+    return append_buffer.c_str() + append_buffer.length();
+  }
+
+  void buffer::list::commit_append_space(unsigned used)
+  {
+    if (!used)
+      return;
+    // the data is already in place; just account for it.
+    append_buffer.set_length(append_buffer.length() + used);
+    append(append_buffer, append_buffer.end() - used, used);
+  }
+
   void buffer::list::append(const ptr& bp)
   {
     if (bp.length())
@@ -1983,6 +2350,86 @@ int buffer::list::write_fd(int fd) const
   return 0;
 }
 
+static int do_writev(int fd, struct iovec *vec, uint64_t offset, unsigned veclen,
+		     ssize_t bytes)
+{
+  while (bytes > 0) {
+    ssize_t r = 0;
+#ifdef HAVE_PWRITEV
+    r = ::pwritev(fd, vec, veclen, offset);
+#else
+    r = ::lseek64(fd, offset, SEEK_SET);
+    if (r != (ssize_t)offset)
+      return -errno;
+    r = ::writev(fd, vec, veclen);
+#endif
+    if (r < 0) {
+      if (errno == EINTR)
+	continue;
+      return -errno;
+    }
+
+    bytes -= r;
+    offset += r;
+    if (bytes == 0)
+      break;
+
+    while (r > 0) {
+      if (vec[0].iov_len <= (size_t)r) {
+	// drain this whole item
+	r -= vec[0].iov_len;
+	++vec;
+	--veclen;
+      } else {
+	vec[0].iov_base = (char *)vec[0].iov_base + r;
+	vec[0].iov_len -= r;
+	break;
+      }
+    }
+  }
+  return 0;
+}
+
+int buffer::list::write_fd(int fd, uint64_t offset) const
+{
+  if (can_zero_copy()) {
+    int64_t off = offset;
+    for (std::list<ptr>::const_iterator it = _buffers.begin();
+	 it != _buffers.end(); ++it) {
+      int r = it->zero_copy_to_fd(fd, &off);
+      if (r < 0)
+	return r;
+      off += it->length();
+    }
+    return 0;
+  }
+
+  // write the fragment list as-is with positioned scatter-gather i/o;
+  // no need to rebuild into a contiguous buffer or seek first
+  iovec iov[IOV_MAX];
+
+  std::list<ptr>::const_iterator p = _buffers.begin();
+  while (p != _buffers.end()) {
+    unsigned iovlen = 0;
+    ssize_t bytes = 0;
+    while (p != _buffers.end() && iovlen < IOV_MAX - 1) {
+      if (p->length() > 0) {
+	iov[iovlen].iov_base = (void *)p->c_str();
+	iov[iovlen].iov_len = p->length();
+	bytes += p->length();
+	iovlen++;
+      }
+      ++p;
+    }
+
+    int r = do_writev(fd, iov, offset, iovlen, bytes);
+    if (r < 0)
+      return r;
+    offset += bytes;
+  }
+  return 0;
+}
+
 void buffer::list::prepare_iov(std::vector<iovec> *piov) const
 {
   piov->resize(_buffers.size());
@@ -18,6 +18,7 @@
 
 #include "common/admin_socket.h"
 #include "common/perf_counters.h"
+#include "common/SamplingProfiler.h"
 #include "common/Thread.h"
 #include "common/ceph_context.h"
 #include "common/ceph_crypto.h"
@@ -291,6 +292,13 @@ void CephContext::do_command(std::string command, cmdmap_t& cmdmap,
     command == "perf schema") {
     _perf_counters_collection->dump_formatted(f, true);
   }
+  else if (command == "perf dump_bin") {
+    // raw binary straight into out; no Formatter involved
+    _perf_counters_collection->dump_binary(*out);
+  }
+  else if (command == "perf schema_bin") {
+    _perf_counters_collection->dump_binary_schema(*out);
+  }
   else if (command == "perf reset") {
     std::string var;
     if (!cmd_getval(this, cmdmap, "var", var)) {
@@ -300,6 +308,44 @@ void CephContext::do_command(std::string command, cmdmap_t& cmdmap,
         f->dump_stream("error") << "Not find: " << var;
     }
   }
+  else if (command == "dump_thread_placement") {
+    Thread::dump_placement(f);
+  }
+  else if (command == "profile start") {
+    int64_t hz = _conf->profiler_sample_hz;
+    cmd_getval(this, cmdmap, "hz", hz);
+    int r = SamplingProfiler::start(hz);
+    if (r < 0)
+      f->dump_stream("error") << "profile start failed: " << cpp_strerror(r);
+    else
+      f->dump_int("sample_hz", hz);
+  }
+  else if (command == "profile stop") {
+    int r = SamplingProfiler::stop();
+    if (r < 0) {
+      f->dump_stream("error") << "profile stop failed: " << cpp_strerror(r);
+    } else {
+      f->dump_unsigned("samples", SamplingProfiler::get_samples());
+      f->dump_unsigned("lost", SamplingProfiler::get_lost());
+    }
+  }
+  else if (command == "profile reset") {
+    SamplingProfiler::reset();
+    f->dump_string("profiler", "reset");
+  }
+  else if (command == "profile status") {
+    f->open_object_section("profiler");
+    f->dump_string("state", SamplingProfiler::running() ? "running" : "stopped");
+    f->dump_unsigned("samples", SamplingProfiler::get_samples());
+    f->dump_unsigned("lost", SamplingProfiler::get_lost());
+    f->close_section();
+  }
+  else if (command == "profile dump") {
+    // folded stacks straight into out (flamegraph.pl input); no Formatter
+    ostringstream os;
+    SamplingProfiler::dump_folded(os);
+    out->append(os.str());
+  }
   else {
     string section = command;
     boost::replace_all(section, " ", "_");
@@ -437,6 +483,8 @@ CephContext::CephContext(uint32_t module_type_)
   _admin_socket->register_command("perfcounters_schema", "perfcounters_schema", _admin_hook, "");
   _admin_socket->register_command("2", "2", _admin_hook, "");
   _admin_socket->register_command("perf schema", "perf schema", _admin_hook, "dump perfcounters schema");
+  _admin_socket->register_command("perf dump_bin", "perf dump_bin", _admin_hook, "dump perfcounters values in binary (see perf schema_bin)");
+  _admin_socket->register_command("perf schema_bin", "perf schema_bin", _admin_hook, "dump perfcounters schema in binary");
   _admin_socket->register_command("perf reset", "perf reset name=var,type=CephString", _admin_hook, "perf reset <name>: perf reset all or one perfcounter name");
   _admin_socket->register_command("config show", "config show", _admin_hook, "dump current config settings");
   _admin_socket->register_command("config set", "config set name=var,type=CephString name=val,type=CephString,n=N",  _admin_hook, "config set <field> <val> [<val> ...]: set a config variable");
@@ -447,6 +495,12 @@ CephContext::CephContext(uint32_t module_type_)
   _admin_socket->register_command("log flush", "log flush", _admin_hook, "flush log entries to log file");
   _admin_socket->register_command("log dump", "log dump", _admin_hook, "dump recent log entries to log file");
   _admin_socket->register_command("log reopen", "log reopen", _admin_hook, "reopen log file");
+  _admin_socket->register_command("dump_thread_placement", "dump_thread_placement", _admin_hook, "dump role, tid and cpu placement of all threads");
+  _admin_socket->register_command("profile start", "profile start name=hz,type=CephInt,req=false", _admin_hook, "start in-process sampled stack profiling");
+  _admin_socket->register_command("profile stop", "profile stop", _admin_hook, "stop sampled stack profiling");
+  _admin_socket->register_command("profile reset", "profile reset", _admin_hook, "discard collected profile samples");
+  _admin_socket->register_command("profile status", "profile status", _admin_hook, "show profiler state and sample counts");
+  _admin_socket->register_command("profile dump", "profile dump", _admin_hook, "dump collected samples in folded-stack (flamegraph) format");
 
   _crypto_none = CryptoHandler::create(CEPH_CRYPTO_NONE);
   _crypto_aes = CryptoHandler::create(CEPH_CRYPTO_AES);
@@ -465,6 +519,8 @@ CephContext::~CephContext()
   _admin_socket->unregister_command("1");
   _admin_socket->unregister_command("perfcounters_schema");
   _admin_socket->unregister_command("perf schema");
+  _admin_socket->unregister_command("perf dump_bin");
+  _admin_socket->unregister_command("perf schema_bin");
   _admin_socket->unregister_command("2");
   _admin_socket->unregister_command("perf reset");
   _admin_socket->unregister_command("config show");
@@ -474,6 +530,12 @@ CephContext::~CephContext()
   _admin_socket->unregister_command("log flush");
   _admin_socket->unregister_command("log dump");
   _admin_socket->unregister_command("log reopen");
+  _admin_socket->unregister_command("dump_thread_placement");
+  _admin_socket->unregister_command("profile start");
+  _admin_socket->unregister_command("profile stop");
+  _admin_socket->unregister_command("profile reset");
+  _admin_socket->unregister_command("profile status");
+  _admin_socket->unregister_command("profile dump");
   delete _admin_hook;
   delete _admin_socket;
 
@@ -21,6 +21,7 @@
 #include "common/dout.h"
 #include "common/errno.h"
 #include "common/safe_io.h"
+#include "common/Thread.h"
 #include "common/version.h"
 #include "include/color.h"
 
@@ -119,4 +120,11 @@ void common_init_finish(CephContext *cct, int flags)
 
   if (!(flags & CINIT_FLAG_NO_DAEMON_ACTIONS))
     cct->start_service_thread();
+
+  if (!cct->_conf->thread_affinity.empty()) {
+    int r = Thread::set_affinity_policy(cct->_conf->thread_affinity);
+    if (r < 0)
+      lderr(cct) << "ignoring malformed thread_affinity '"
+		 << cct->_conf->thread_affinity << "'" << dendl;
+  }
 }
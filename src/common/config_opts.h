@@ -32,6 +32,7 @@ OPTION(daemonize, OPT_BOOL, false) // default changed by common_preinit()
 OPTION(pid_file, OPT_STR, "") // default changed by common_preinit()
 OPTION(chdir, OPT_STR, "/")
 OPTION(max_open_files, OPT_LONGLONG, 0)
+OPTION(buffer_hugepage_pool_size, OPT_U64, 0) // bytes of 2MB hugepages to reserve for large data buffers (0 = disabled)
 OPTION(restapi_log_level, OPT_STR, "") 	// default set by Python code
 OPTION(restapi_base_url, OPT_STR, "")	// "
 OPTION(fatal_signal_handlers, OPT_BOOL, true)
@@ -62,6 +63,8 @@ OPTION(mon_cluster_log_to_syslog_facility, OPT_STR, "daemon")
 OPTION(mon_cluster_log_file, OPT_STR,
     "default=/var/log/ceph/$cluster.$channel.log cluster=/var/log/ceph/$cluster.log")
 OPTION(mon_cluster_log_file_level, OPT_STR, "info")
+OPTION(mon_cluster_log_source_rate, OPT_DOUBLE, 50.0) // sustained cluster log entries/sec accepted per source daemon; 0 disables the limit
+OPTION(mon_cluster_log_source_burst, OPT_INT, 500)    // burst allowance for the per-source limit
 
 OPTION(enable_experimental_unrecoverable_data_corrupting_features, OPT_STR, "")
 
@@ -78,7 +81,9 @@ OPTION(xio_mp_max_hint, OPT_INT, 4096) // max size-hint chunks
 OPTION(xio_portal_threads, OPT_INT, 2) // xio portal threads per messenger
 OPTION(xio_transport_type, OPT_STR, "rdma") // xio transport type: {rdma or tcp}
 OPTION(xio_max_send_inline, OPT_INT, 512) // xio maximum threshold to send inline
+OPTION(xio_max_reg_copy, OPT_U64, 262144) // copy unregistered payloads up to this size into pre-registered slabs (0 = register in place)
 
+OPTION(compressor_dir, OPT_STR, CEPH_PKGLIBDIR"/compressor") // where the compression codec plugins live
 OPTION(async_compressor_enabled, OPT_BOOL, false)
 OPTION(async_compressor_type, OPT_STR, "snappy")
 OPTION(async_compressor_threads, OPT_INT, 2)
@@ -138,8 +143,12 @@ OPTION(heartbeat_interval, OPT_INT, 5)
 OPTION(heartbeat_file, OPT_STR, "")
 OPTION(heartbeat_inject_failure, OPT_INT, 0)    // force an unhealthy heartbeat for N seconds
 OPTION(perf, OPT_BOOL, true)       // enable internal perf counters
+OPTION(perf_sharded_counters, OPT_BOOL, false) // accumulate inc/tinc in per-thread blocks, sum on read
+OPTION(thread_affinity, OPT_STR, "") // per-role thread placement, e.g. "osd_op_tp:0-7,16-23;journal_write:0-7"
+OPTION(profiler_sample_hz, OPT_INT, 100) // default rate for 'profile start' sampled stack capture
 
 OPTION(ms_type, OPT_STR, "simple")   // messenger backend
+OPTION(ms_cluster_type, OPT_STR, "") // messenger backend for the OSD cluster network (ms_type if empty)
 OPTION(ms_tcp_nodelay, OPT_BOOL, true)
 OPTION(ms_tcp_rcvbuf, OPT_INT, 0)
 OPTION(ms_tcp_prefetch_max_size, OPT_INT, 4096) // max prefetch size, we limit this to avoid extra memcpy
@@ -147,11 +156,13 @@ OPTION(ms_initial_backoff, OPT_DOUBLE, .2)
 OPTION(ms_max_backoff, OPT_DOUBLE, 15.0)
 OPTION(ms_crc_data, OPT_BOOL, true)
 OPTION(ms_crc_header, OPT_BOOL, true)
+OPTION(ms_compress_min_size, OPT_U64, 65536) // don't compress msg data below this
 OPTION(ms_die_on_bad_msg, OPT_BOOL, false)
 OPTION(ms_die_on_unhandled_msg, OPT_BOOL, false)
 OPTION(ms_die_on_old_message, OPT_BOOL, false)     // assert if we get a dup incoming message and shouldn't have (may be triggered by pre-541cd3c64be0dfa04e8a2df39422e0eb9541a428 code)
 OPTION(ms_die_on_skipped_message, OPT_BOOL, false)  // assert if we skip a seq (kernel client does this intentionally)
 OPTION(ms_dispatch_throttle_bytes, OPT_U64, 100 << 20)
+OPTION(ms_dispatch_batch_size, OPT_U64, 16) // max messages pulled off the dispatch queue per lock hold
 OPTION(ms_bind_ipv6, OPT_BOOL, false)
 OPTION(ms_bind_port_min, OPT_INT, 6800)
 OPTION(ms_bind_port_max, OPT_INT, 7300)
@@ -177,6 +188,7 @@ OPTION(ms_async_set_affinity, OPT_BOOL, true)
 // If ms_async_affinity_cores is empty, all threads will be bind to current running
 // core
 OPTION(ms_async_affinity_cores, OPT_STR, "")
+OPTION(ms_async_timer_coalesce_us, OPT_U64, 1000) // bucket time events into shared expiries of this granularity (0 = exact)
 
 OPTION(inject_early_sigterm, OPT_BOOL, false)
 
@@ -186,6 +198,7 @@ OPTION(mon_sync_fs_threshold, OPT_INT, 5)   // sync() when writing this many obj
 OPTION(mon_compact_on_start, OPT_BOOL, false)  // compact leveldb on ceph-mon start
 OPTION(mon_compact_on_bootstrap, OPT_BOOL, false)  // trigger leveldb compaction on bootstrap
 OPTION(mon_compact_on_trim, OPT_BOOL, true)       // compact (a prefix) when we trim old states
+OPTION(mon_compact_on_trim_interval, OPT_INT, 300) // seconds between trim-triggered compactions; 0 = compact on every trim
 OPTION(mon_tick_interval, OPT_INT, 5)
 OPTION(mon_subscribe_interval, OPT_DOUBLE, 300)
 OPTION(mon_delta_reset_interval, OPT_DOUBLE, 10)   // seconds of inactivity before we reset the pg delta to 0
@@ -206,6 +219,7 @@ OPTION(mon_osd_allow_primary_temp, OPT_BOOL, false)  // allow primary_temp to be
 OPTION(mon_osd_allow_primary_affinity, OPT_BOOL, false)  // allow primary_affinity to be set in the osdmap
 OPTION(mon_osd_prime_pg_temp, OPT_BOOL, false)  // prime osdmap with pg mapping changes
 OPTION(mon_osd_prime_pg_temp_max_time, OPT_FLOAT, .5)  // max time to spend priming
+OPTION(mon_osd_cache_size, OPT_INT, 10)  // max osdmap epochs (inc and full each) kept in the encoded-map LRU
 OPTION(mon_stat_smooth_intervals, OPT_INT, 2)  // smooth stats over last N PGMap maps
 OPTION(mon_lease, OPT_FLOAT, 5)       // lease interval
 OPTION(mon_lease_renew_interval, OPT_FLOAT, 3) // on leader, to renew the lease
@@ -313,6 +327,7 @@ OPTION(mon_client_hunt_interval, OPT_DOUBLE, 3.0)   // try new mon every N secon
 OPTION(mon_client_ping_interval, OPT_DOUBLE, 10.0)  // ping every N seconds
 OPTION(mon_client_ping_timeout, OPT_DOUBLE, 30.0)   // fail if we don't hear back
 OPTION(mon_client_hunt_interval_backoff, OPT_DOUBLE, 2.0) // each time we reconnect to a monitor, double our timeout
+OPTION(mon_client_hunt_interval_jitter, OPT_DOUBLE, 0.5) // randomize each hunt interval by +/- this fraction to spread reconnect stampedes
 OPTION(mon_client_hunt_interval_max_multiple, OPT_DOUBLE, 10.0) // up to a max of 10*default (30 seconds)
 OPTION(mon_client_max_log_entries_per_message, OPT_INT, 1000)
 OPTION(mon_max_pool_pg_num, OPT_INT, 65536)
@@ -327,17 +342,21 @@ OPTION(client_trace, OPT_STR, "")
 OPTION(client_readahead_min, OPT_LONGLONG, 128*1024)  // readahead at _least_ this much.
 OPTION(client_readahead_max_bytes, OPT_LONGLONG, 0)  //8 * 1024*1024
 OPTION(client_readahead_max_periods, OPT_LONGLONG, 4)  // as multiple of file layout period (object size * num stripes)
+OPTION(client_dir_prefetch_min_misses, OPT_INT, 4) // uncached lookups in a dir before its contents are prefetched via readdir (0 = disabled)
+OPTION(client_dir_prefetch_max_entries, OPT_INT, 10000) // don't prefetch dirs reported bigger than this
 OPTION(client_snapdir, OPT_STR, ".snap")
 OPTION(client_mountpoint, OPT_STR, "/")
 OPTION(client_notify_timeout, OPT_INT, 10) // in seconds
 OPTION(osd_client_watch_timeout, OPT_INT, 30) // in seconds
 OPTION(client_caps_release_delay, OPT_INT, 5) // in seconds
+OPTION(client_max_cap_releases, OPT_INT, 1024) // flush the batched release message once this many are queued
 OPTION(client_quota, OPT_BOOL, false)
 OPTION(client_oc, OPT_BOOL, true)
 OPTION(client_oc_size, OPT_INT, 1024*1024* 200)    // MB * n
 OPTION(client_oc_max_dirty, OPT_INT, 1024*1024* 100)    // MB * n  (dirty OR tx.. bigish)
 OPTION(client_oc_target_dirty, OPT_INT, 1024*1024* 8) // target dirty (keep this smallish)
 OPTION(client_oc_max_dirty_age, OPT_DOUBLE, 5.0)      // max age in cache before writeback
+OPTION(client_oc_flush_candidates, OPT_INT, 8)  // oldest dirty bhs weighed per flush for the largest mergeable run (1 = plain lru order)
 OPTION(client_oc_max_objects, OPT_INT, 1000)      // max objects in cache
 OPTION(client_debug_force_sync_read, OPT_BOOL, false)     // always read synchronously (go to osds)
 OPTION(client_debug_inject_tick_delay, OPT_INT, 0) // delay the client tick for a number of seconds
@@ -346,12 +365,17 @@ OPTION(client_inject_release_failure, OPT_BOOL, false)  // synthetic client bug
 OPTION(client_inject_fixed_oldest_tid, OPT_BOOL, false)  // synthetic client bug for testing
 // note: the max amount of "in flight" dirty data is roughly (max - target)
 OPTION(fuse_use_invalidate_cb, OPT_BOOL, false) // use fuse 2.8+ invalidate callback to keep page cache consistent
+OPTION(fuse_splice_read, OPT_BOOL, true) // use fuse 2.9+ splice to move write data out of the fuse device
+OPTION(fuse_splice_write, OPT_BOOL, true) // use fuse 2.9+ splice when replying with read data
+OPTION(fuse_splice_move, OPT_BOOL, true) // let the kernel move pages instead of copying them
+OPTION(fuse_writeback_cache, OPT_BOOL, true) // enable kernel writeback cache where libfuse supports it
 OPTION(fuse_allow_other, OPT_BOOL, true)
 OPTION(fuse_default_permissions, OPT_BOOL, true)
 OPTION(fuse_big_writes, OPT_BOOL, true)
 OPTION(fuse_atomic_o_trunc, OPT_BOOL, true)
 OPTION(fuse_debug, OPT_BOOL, false)
 OPTION(fuse_multithreaded, OPT_BOOL, true)
+OPTION(fuse_dispatch_threads, OPT_INT, 0) // > 0: fixed pool of that many dispatch threads; 0: let libfuse manage its own pool
 OPTION(client_try_dentry_invalidate, OPT_BOOL, true) // the client should try to use dentry invaldation instead of remounting, on kernels it believes that will work for
 OPTION(client_die_on_failed_remount, OPT_BOOL, true)
 OPTION(client_check_pool_perm, OPT_BOOL, true)
@@ -362,8 +386,18 @@ OPTION(objecter_tick_interval, OPT_DOUBLE, 5.0)
 OPTION(objecter_timeout, OPT_DOUBLE, 10.0)    // before we ask for a map
 OPTION(objecter_inflight_op_bytes, OPT_U64, 1024*1024*100) // max in-flight data (both directions)
 OPTION(objecter_inflight_ops, OPT_U64, 1024)               // max in-flight ios
+OPTION(objecter_adaptive_window_min, OPT_INT, 0)   // per-OSD adaptive in-flight window floor (0 = disable windowing)
+OPTION(objecter_adaptive_window_max, OPT_INT, 256) // per-OSD adaptive in-flight window ceiling
+OPTION(objecter_backoff_qlen, OPT_INT, 512)        // halve the window when the OSD reports more queued ops than this
+OPTION(objecter_backoff_latency_factor, OPT_DOUBLE, 2.0) // halve the window when an op rtt exceeds this multiple of the smoothed rtt
 OPTION(objecter_completion_locks_per_session, OPT_U64, 32) // num of completion locks per each session, for serializing same object responses
 OPTION(objecter_inject_no_watch_ping, OPT_BOOL, false)   // suppress watch pings
+OPTION(objecter_batch_watch_pings, OPT_BOOL, false)   // one MWatchPing per osd session instead of one ping op per watch; needs OSDs that understand it
+OPTION(objecter_trace_every, OPT_U64, 0)   // trace one in N ops end to end (0 = off); see objecter_traces asok command
+
+// number of librados completion callback threads; callbacks for one
+// aio completion always run on the same thread, in order
+OPTION(librados_finisher_threads, OPT_INT, 1)
 
 // Max number of deletes at once in a single Filer::purge call
 OPTION(filer_max_purge_ops, OPT_U32, 10)
@@ -378,6 +412,7 @@ OPTION(mds_data, OPT_STR, "/var/lib/ceph/mds/$cluster-$id")
 OPTION(mds_max_file_size, OPT_U64, 1ULL << 40) // Used when creating new CephFS. Change with 'ceph mds set max_file_size <size>' afterwards
 OPTION(mds_cache_size, OPT_INT, 100000)
 OPTION(mds_cache_mid, OPT_FLOAT, .7)
+OPTION(mds_cache_memory_limit, OPT_U64, 0) // rss bytes above which the cache is trimmed regardless of mds_cache_size (0 = count-based limit only)
 OPTION(mds_max_file_recover, OPT_U32, 32)
 OPTION(mds_dir_max_commit_size, OPT_INT, 10) // MB
 OPTION(mds_decay_halflife, OPT_FLOAT, 5)
@@ -393,6 +428,7 @@ OPTION(mds_freeze_tree_timeout, OPT_FLOAT, 30)    // detecting freeze tree deadl
 OPTION(mds_session_autoclose, OPT_FLOAT, 300) // autoclose idle session
 OPTION(mds_health_summarize_threshold, OPT_INT, 10) // collapse N-client health metrics to a single 'many'
 OPTION(mds_reconnect_timeout, OPT_FLOAT, 45)  // seconds to wait for clients during mds restart
+OPTION(mds_open_inodes_persist_interval, OPT_INT, 60) // seconds between saves of the open-inode digest a takeover uses to warm its cache; 0 disables
 	      //  make it (mds_session_timeout - mds_beacon_grace)
 OPTION(mds_tick_interval, OPT_FLOAT, 5)
 OPTION(mds_dirstat_min_interval, OPT_FLOAT, 1)    // try to avoid propagating more often than this
@@ -408,6 +444,8 @@ OPTION(mds_log_segment_size, OPT_INT, 0)  // segment size for mds log,
 	      // defaults to g_default_file_layout.fl_object_size (4MB)
 OPTION(mds_log_max_segments, OPT_U32, 30)
 OPTION(mds_log_max_expiring, OPT_INT, 20)
+OPTION(mds_log_flush_bytes, OPT_U64, 1 << 20) // start flushing buffered journal events past this many bytes, overlapping writeout with submission (0 = flush only on timer/fsync)
+OPTION(mds_readdir_prefetch_frags, OPT_INT, 2) // dirfrags to fetch ahead of a client readdir walk (0 = disabled)
 OPTION(mds_bal_sample_interval, OPT_FLOAT, 3.0)  // every 5 seconds
 OPTION(mds_bal_replicate_threshold, OPT_FLOAT, 8000)
 OPTION(mds_bal_unreplicate_threshold, OPT_FLOAT, 0)
@@ -499,6 +537,18 @@ OPTION(osd_max_backfills, OPT_U64, 1)
 // Minimum recovery priority (255 = max, smaller = lower)
 OPTION(osd_min_recovery_priority, OPT_INT, 0)
 
+// Seconds a queued recovery/backfill reservation waits per priority
+// step it is promoted by (0 = no aging)
+OPTION(osd_reserver_age_interval, OPT_DOUBLE, 60.0)
+
+// Per-pool cap on concurrent recovery/backfill reservations,
+// "poolid:max[,poolid:max]*" (absent or 0 = unlimited)
+OPTION(osd_reserver_pool_shares, OPT_STR, "")
+
+// Per-pool priority bonus for recovery/backfill reservations,
+// "poolid:bonus[,poolid:bonus]*"
+OPTION(osd_reserver_pool_priority, OPT_STR, "")
+
 // Refuse backfills when OSD full ratio is above this value
 OPTION(osd_backfill_full_ratio, OPT_FLOAT, 0.85)
 
@@ -508,6 +558,7 @@ OPTION(osd_backfill_retry_interval, OPT_DOUBLE, 10.0)
 // max agent flush ops
 OPTION(osd_agent_max_ops, OPT_INT, 4)
 OPTION(osd_agent_max_low_ops, OPT_INT, 2)
+OPTION(osd_agent_max_evict_batch, OPT_INT, 16) // max clean objects evicted in one transaction
 OPTION(osd_agent_min_evict_effort, OPT_FLOAT, .1)
 OPTION(osd_agent_quantize_effort, OPT_FLOAT, .1)
 OPTION(osd_agent_delay_time, OPT_FLOAT, 5.0)
@@ -573,6 +624,7 @@ OPTION(osd_pool_default_cache_min_evict_age, OPT_INT, 0)  // seconds
 OPTION(osd_hit_set_min_size, OPT_INT, 1000)  // min target size for a HitSet
 OPTION(osd_hit_set_max_size, OPT_INT, 100000)  // max target size for a HitSet
 OPTION(osd_hit_set_namespace, OPT_STR, ".ceph-internal") // rados namespace for hit_set tracking
+OPTION(osd_object_temp_sample_size, OPT_INT, 0) // per-pg reservoir of object access samples for 'pg <pgid> dump_temperature' (0 = off)
 
 OPTION(osd_tier_default_cache_mode, OPT_STR, "writeback")
 OPTION(osd_tier_default_cache_hit_set_count, OPT_INT, 4)
@@ -580,6 +632,8 @@ OPTION(osd_tier_default_cache_hit_set_period, OPT_INT, 1200)
 OPTION(osd_tier_default_cache_hit_set_type, OPT_STR, "bloom")
 OPTION(osd_tier_default_cache_min_read_recency_for_promote, OPT_INT, 1) // number of recent HitSets the object must appear in to be promoted (on read)
 OPTION(osd_tier_default_cache_min_write_recency_for_promote, OPT_INT, 1) // number of recent HitSets the object must appear in to be promoted (on write)
+OPTION(osd_tier_promote_max_objects_sec, OPT_U64, 25)      // max promotions started per second; 0 = unlimited
+OPTION(osd_tier_promote_max_bytes_sec, OPT_U64, 5242880)   // max promoted bytes per second; 0 = unlimited
 
 OPTION(osd_map_dedup, OPT_BOOL, true)
 OPTION(osd_map_max_advance, OPT_INT, 200) // make this < cache_size!
@@ -590,9 +644,27 @@ OPTION(osd_inject_bad_map_crc_probability, OPT_FLOAT, 0)
 OPTION(osd_inject_failure_on_pg_removal, OPT_BOOL, false)
 OPTION(osd_op_threads, OPT_INT, 2)    // 0 == no threading
 OPTION(osd_peering_wq_batch_size, OPT_U64, 20)
+OPTION(osd_op_queue, OPT_STR, "prio") // which op queue backs the sharded op wq: "prio", "wrr" or "mclock"
+// mclock reservation (ops/s, 0 = none), weight and limit (ops/s, 0 = none)
+// per service class; only used when osd_op_queue = mclock
+OPTION(osd_op_queue_mclock_client_res, OPT_DOUBLE, 0)
+OPTION(osd_op_queue_mclock_client_wgt, OPT_DOUBLE, 500)
+OPTION(osd_op_queue_mclock_client_lim, OPT_DOUBLE, 0)
+OPTION(osd_op_queue_mclock_recov_res, OPT_DOUBLE, 0)
+OPTION(osd_op_queue_mclock_recov_wgt, OPT_DOUBLE, 100)
+OPTION(osd_op_queue_mclock_recov_lim, OPT_DOUBLE, 0)
+OPTION(osd_op_queue_mclock_scrub_res, OPT_DOUBLE, 0)
+OPTION(osd_op_queue_mclock_scrub_wgt, OPT_DOUBLE, 50)
+OPTION(osd_op_queue_mclock_scrub_lim, OPT_DOUBLE, 0)
+OPTION(osd_op_queue_mclock_snap_res, OPT_DOUBLE, 0)
+OPTION(osd_op_queue_mclock_snap_wgt, OPT_DOUBLE, 50)
+OPTION(osd_op_queue_mclock_snap_lim, OPT_DOUBLE, 0)
 OPTION(osd_op_pq_max_tokens_per_priority, OPT_U64, 4194304)
 OPTION(osd_op_pq_min_cost, OPT_U64, 65536)
+OPTION(osd_fast_ondisk_ack, OPT_BOOL, false) // send commit reply from the journal completion path instead of the ondisk finisher
+OPTION(osd_op_async_reads, OPT_BOOL, false)  // serve replicated-pool reads through the async read path so op threads don't block on the disk
 OPTION(osd_disk_threads, OPT_INT, 1)
+OPTION(osd_load_pgs_threads, OPT_INT, 4)  // threads loading pg metadata/logs at startup (1 == serial)
 OPTION(osd_disk_thread_ioprio_class, OPT_STR, "") // rt realtime be best effort idle
 OPTION(osd_disk_thread_ioprio_priority, OPT_INT, -1) // 0-7
 OPTION(osd_recovery_threads, OPT_INT, 1)
@@ -622,11 +694,17 @@ OPTION(osd_command_thread_suicide_timeout, OPT_INT, 15*60)
 OPTION(osd_heartbeat_addr, OPT_ADDR, entity_addr_t())
 OPTION(osd_heartbeat_interval, OPT_INT, 6)       // (seconds) how often we ping peers
 OPTION(osd_heartbeat_grace, OPT_INT, 20)         // (seconds) how long before we decide a peer has failed
+OPTION(osd_heartbeat_use_adaptive_grace, OPT_BOOL, true)  // widen grace per peer from observed reply intervals (accrual-style)
+OPTION(osd_heartbeat_adaptive_grace_factor, OPT_DOUBLE, 4.0)  // declare failure at mean + factor * stddev of reply intervals
+OPTION(osd_heartbeat_adaptive_grace_min_samples, OPT_INT, 8)  // use the fixed grace until this many replies are seen
 OPTION(osd_heartbeat_min_peers, OPT_INT, 10)     // minimum number of peers
 OPTION(osd_heartbeat_use_min_delay_socket, OPT_BOOL, false) // prio the heartbeat tcp socket and set dscp as CS6 on it if true
 
 // max number of parallel snap trims/pg
 OPTION(osd_pg_max_concurrent_snap_trims, OPT_U64, 2)
+// objects to fetch per snap mapper range scan while trimming; the
+// osd_snap_trim_sleep pacing still applies between trim batches
+OPTION(osd_pg_snap_trim_batch, OPT_U64, 128)
 
 // minimum number of peers that must be reachable to mark ourselves
 // back up after being wrongly marked down.
@@ -644,6 +722,7 @@ OPTION(osd_recovery_delay_start, OPT_FLOAT, 0)
 OPTION(osd_recovery_max_active, OPT_INT, 3)
 OPTION(osd_recovery_max_single_start, OPT_INT, 1)
 OPTION(osd_recovery_max_chunk, OPT_U64, 8<<20)  // max size of push chunk
+OPTION(osd_recovery_readahead_chunks, OPT_U64, 1)  // push chunks to prefetch while the current one is on the wire; 0 to disable
 OPTION(osd_copyfrom_max_chunk, OPT_U64, 8<<20)   // max size of a COPYFROM chunk
 OPTION(osd_push_per_object_cost, OPT_U64, 1000)  // push cost per object
 OPTION(osd_max_push_cost, OPT_U64, 8<<20)  // max size of push message
@@ -659,9 +738,12 @@ OPTION(osd_scrub_interval_randomize_ratio, OPT_FLOAT, 0.5) // randomize the sche
 OPTION(osd_scrub_chunk_min, OPT_INT, 5)
 OPTION(osd_scrub_chunk_max, OPT_INT, 25)
 OPTION(osd_scrub_sleep, OPT_FLOAT, 0)   // sleep between [deep]scrub ops
+OPTION(osd_scrub_latency_target, OPT_FLOAT, 0) // client op latency (seconds) scrub tries to stay under by shrinking chunks and stretching sleeps (0 = fixed)
+OPTION(osd_scrub_rate_estimate, OPT_U64, 0) // estimated scrub bytes/sec; larger pgs are scheduled earlier in their window (0 = ignore pg size)
 OPTION(osd_deep_scrub_interval, OPT_FLOAT, 60*60*24*7) // once a week
 OPTION(osd_deep_scrub_stride, OPT_INT, 524288)
 OPTION(osd_deep_scrub_update_digest_min_age, OPT_INT, 2*60*60)   // objects must be this old (seconds) before we update the whole-object digest on scrub
+OPTION(osd_deep_scrub_skip_unmodified, OPT_BOOL, false) // trust stored whole-object digests for objects unmodified since the last deep scrub instead of rereading them; trades bit-rot detection on cold objects for much cheaper deep scrubs
 OPTION(osd_scan_list_ping_tp_interval, OPT_U64, 100)
 OPTION(osd_class_dir, OPT_STR, CEPH_LIBDIR "/rados-classes") // where rados plugins are stored
 OPTION(osd_open_classes_on_start, OPT_BOOL, true)
@@ -704,6 +786,7 @@ OPTION(osd_failsafe_full_ratio, OPT_FLOAT, .97) // what % full makes an OSD "ful
 OPTION(osd_failsafe_nearfull_ratio, OPT_FLOAT, .90) // what % full makes an OSD near full (failsafe)
 
 OPTION(osd_pg_object_context_cache_count, OPT_INT, 64)
+OPTION(osd_pg_object_context_cache_shards, OPT_INT, 4)  // rounded up to a power of two
 
 // determines whether PGLog::check() compares written out log to stored log
 OPTION(osd_debug_pg_log_writeout, OPT_BOOL, false)
@@ -736,6 +819,10 @@ OPTION(keyvaluestore_rocksdb_options, OPT_STR, "")
 OPTION(filestore_rocksdb_options, OPT_STR, "")
 // rocksdb options that will be used in monstore
 OPTION(mon_rocksdb_options, OPT_STR, "")
+// named rocksdb partitions (column families) selected by key prefix, with
+// optional per-partition options, e.g. "_USER_:write_buffer_size=33554432;_HOBJTOSEQ_"
+// only applied when a store is created; existing stores keep their layout
+OPTION(rocksdb_partitions, OPT_STR, "")
 
 /**
  * osd_*_priority adjust the relative priority of client io, recovery io,
@@ -748,6 +835,10 @@ OPTION(mon_rocksdb_options, OPT_STR, "")
 OPTION(osd_client_op_priority, OPT_U32, 63)
 OPTION(osd_recovery_op_priority, OPT_U32, 3)
 
+// extra shards to read for EC client reads so a single slow shard does
+// not stall the whole read; 0 disables hedging
+OPTION(osd_ec_hedged_read_shards, OPT_U64, 0)
+
 OPTION(osd_snap_trim_priority, OPT_U32, 5)
 OPTION(osd_snap_trim_cost, OPT_U32, 1<<20) // set default cost equal to 1MB io
 
@@ -765,6 +856,8 @@ OPTION(osd_recovery_op_warn_multiple, OPT_U32, 16)
 OPTION(osd_mon_shutdown_timeout, OPT_DOUBLE, 5)
 
 OPTION(osd_max_object_size, OPT_U64, 100*1024L*1024L*1024L) // OSD's maximum object size
+OPTION(osd_compress_min_size, OPT_U64, 4096)
+OPTION(osd_compress_cluster_messages, OPT_BOOL, false) // on-wire compression on the cluster (replication) messenger // full-object writes below this are stored raw even on pools with the compress flag
 OPTION(osd_max_object_name_len, OPT_U32, 2048) // max rados object name len
 OPTION(osd_max_attr_name_len, OPT_U32, 100)    // max rados attr name len; cannot go higher than 100 chars for file system backends
 OPTION(osd_max_attr_size, OPT_U64, 0)
@@ -801,6 +894,14 @@ OPTION(filestore_wbthrottle_xfs_inodes_start_flusher, OPT_U64, 500)
 /// These must be less than the fd limit
 OPTION(filestore_wbthrottle_btrfs_inodes_hard_limit, OPT_U64, 5000)
 OPTION(filestore_wbthrottle_xfs_inodes_hard_limit, OPT_U64, 5000)
+// scale the wbthrottle limits from observed flush latency (AIMD) so a
+// slow device backs the throttle off instead of stalling the op tp
+OPTION(filestore_wbthrottle_adaptive, OPT_BOOL, false)
+OPTION(filestore_wbthrottle_adaptive_target_lat, OPT_DOUBLE, .5)  // seconds per flush
+OPTION(filestore_wbthrottle_adaptive_min_ratio, OPT_DOUBLE, .01)  // floor for the scale
+// trickle-flush the oldest dirty inode this often even below the
+// start_flusher limits, so the periodic commit sync has little left to do
+OPTION(filestore_wbthrottle_paced_flush_interval, OPT_DOUBLE, 0)  // seconds between idle flushes (0 = disabled)
 
 // Tests index failure paths
 OPTION(filestore_index_retry_probability, OPT_DOUBLE, 0)
@@ -810,6 +911,7 @@ OPTION(filestore_debug_inject_read_err, OPT_BOOL, false)
 
 OPTION(filestore_debug_omap_check, OPT_BOOL, 0) // Expensive debugging check on sync
 OPTION(filestore_omap_header_cache_size, OPT_INT, 1024)
+OPTION(filestore_omap_batch_max_ops, OPT_INT, 0)  // > 0 merges omap mutations into batched backend transactions of up to this many ops
 
 // Use omap for xattrs for attrs over
 // filestore_max_inline_xattr_size or
@@ -855,15 +957,21 @@ OPTION(filestore_queue_committing_max_bytes, OPT_INT, 100 << 20) //  "
 OPTION(filestore_op_threads, OPT_INT, 2)
 OPTION(filestore_op_thread_timeout, OPT_INT, 60)
 OPTION(filestore_op_thread_suicide_timeout, OPT_INT, 180)
+OPTION(filestore_read_threads, OPT_INT, 8)       // threads servicing read_async
 OPTION(filestore_commit_timeout, OPT_FLOAT, 600)
 OPTION(filestore_fiemap_threshold, OPT_INT, 4096)
 OPTION(filestore_merge_threshold, OPT_INT, 10)
 OPTION(filestore_split_multiple, OPT_INT, 2)
 OPTION(filestore_update_to, OPT_INT, 1000)
 OPTION(filestore_blackhole, OPT_BOOL, false)     // drop any new transactions on the floor
+OPTION(filestore_coalesce_ops, OPT_BOOL, true)   // merge consecutive contiguous writes and setattrs on the same object into one syscall
+OPTION(filestore_mmap_reads, OPT_BOOL, false)    // serve large reads as mmap'd file ranges instead of copying the data out
+OPTION(filestore_mmap_read_min, OPT_U64, 65536)  // only mmap reads at least this large
+OPTION(filestore_index_verify_name, OPT_BOOL, true)  // regenerate and check each parsed name while listing; disabling speeds up large backfill/scrub scans
 OPTION(filestore_fd_cache_size, OPT_INT, 128)    // FD lru size
-OPTION(filestore_fd_cache_shards, OPT_INT, 16)   // FD number of shards
+OPTION(filestore_fd_cache_shards, OPT_INT, 16)   // FD number of shards (rounded up to a power of two; <= 0 scales with filestore_op_threads)
 OPTION(filestore_dump_file, OPT_STR, "")         // file onto which store transaction dumps
+OPTION(filestore_record_file, OPT_STR, "")       // file onto which store transactions are recorded in binary replayable form
 OPTION(filestore_kill_at, OPT_INT, 0)            // inject a failure at the n'th opportunity
 OPTION(filestore_inject_stall, OPT_INT, 0)       // artificially stall for N seconds in op queue thread
 OPTION(filestore_fail_eio, OPT_BOOL, true)       // fail/crash on EIO
@@ -871,6 +979,7 @@ OPTION(filestore_debug_verify_split, OPT_BOOL, false)
 OPTION(journal_dio, OPT_BOOL, true)
 OPTION(journal_aio, OPT_BOOL, true)
 OPTION(journal_force_aio, OPT_BOOL, false)
+OPTION(journal_direct_submit, OPT_BOOL, false) // submit aio from the queueing thread when the device is idle (requires journal_dio and journal_aio)
 
 OPTION(keyvaluestore_queue_max_ops, OPT_INT, 50)
 OPTION(keyvaluestore_queue_max_bytes, OPT_INT, 100 << 20)
@@ -879,6 +988,7 @@ OPTION(keyvaluestore_op_threads, OPT_INT, 2)
 OPTION(keyvaluestore_op_thread_timeout, OPT_INT, 60)
 OPTION(keyvaluestore_op_thread_suicide_timeout, OPT_INT, 180)
 OPTION(keyvaluestore_default_strip_size, OPT_INT, 4096) // Only affect new object
+OPTION(keyvaluestore_max_strip_size, OPT_U64, 65536) // Upper bound when re-striping an object for large writes (0 = never re-strip)
 OPTION(keyvaluestore_max_expected_write_size, OPT_U64, 1ULL << 24) // bytes
 OPTION(keyvaluestore_header_cache_size, OPT_INT, 4096)    // Header cache size
 OPTION(keyvaluestore_backend, OPT_STR, "leveldb")
@@ -894,6 +1004,8 @@ OPTION(journal_queue_max_ops, OPT_INT, 300)
 OPTION(journal_queue_max_bytes, OPT_INT, 32 << 20)
 OPTION(journal_align_min_size, OPT_INT, 64 << 10)  // align data payloads >= this.
 OPTION(journal_replay_from, OPT_INT, 0)
+OPTION(journal_replay_threads, OPT_INT, 0)  // > 1 replays entries touching disjoint collections in parallel
+OPTION(journal_replay_window, OPT_INT, 64)  // max entries buffered per parallel replay round
 OPTION(journal_zero_on_create, OPT_BOOL, false)
 OPTION(journal_ignore_corruption, OPT_BOOL, false) // assume journal is not corrupt
 OPTION(journal_discard, OPT_BOOL, false) //using ssd disk as journal, whether support discard nouse journal-data.
@@ -912,7 +1024,14 @@ OPTION(rbd_cache_target_dirty, OPT_LONGLONG, 16<<20) // target dirty limit in by
 OPTION(rbd_cache_max_dirty_age, OPT_FLOAT, 1.0)      // seconds in cache before writeback starts
 OPTION(rbd_cache_max_dirty_object, OPT_INT, 0)       // dirty limit for objects - set to 0 for auto calculate from rbd_cache_size
 OPTION(rbd_cache_block_writes_upfront, OPT_BOOL, false) // whether to block writes to the cache before the aio_write call completes (true), or block before the aio completion is called (false)
+OPTION(rbd_cache_merge_writebacks, OPT_BOOL, true) // merge the dirty extents of an object into a single write op at flush time
+OPTION(rbd_persistent_read_cache_path, OPT_STR, "") // directory holding per-image local read cache files (empty = disabled); only safe when images are not written from other hosts concurrently
+OPTION(rbd_persistent_read_cache_size, OPT_LONGLONG, 1<<30) // bytes of local disk used per image
+OPTION(rbd_persistent_read_cache_block_size, OPT_LONGLONG, 256<<10) // cache block granularity
 OPTION(rbd_concurrent_management_ops, OPT_INT, 10) // how many operations can be in flight for a management operation like deleting or resizing an image
+OPTION(rbd_adaptive_management_ops, OPT_BOOL, true) // scale back concurrent management ops while foreground IO latency is elevated
+OPTION(rbd_management_op_latency_factor, OPT_DOUBLE, 2.0) // foreground latency multiple over baseline that halves management op concurrency (0 = disabled)
+OPTION(rbd_flatten_checkpoint_objects, OPT_LONGLONG, 512) // persist flatten progress in the image metadata after this many objects (0 = disabled)
 OPTION(rbd_balance_snap_reads, OPT_BOOL, false)
 OPTION(rbd_localize_snap_reads, OPT_BOOL, false)
 OPTION(rbd_balance_parent_reads, OPT_BOOL, false)
@@ -920,12 +1039,19 @@ OPTION(rbd_localize_parent_reads, OPT_BOOL, true)
 OPTION(rbd_readahead_trigger_requests, OPT_INT, 10) // number of sequential requests necessary to trigger readahead
 OPTION(rbd_readahead_max_bytes, OPT_LONGLONG, 512 * 1024) // set to 0 to disable readahead
 OPTION(rbd_readahead_disable_after_bytes, OPT_LONGLONG, 50 * 1024 * 1024) // how many bytes are read in total before readahead is disabled
+OPTION(rbd_readahead_max_streams, OPT_INT, 4) // number of independent read streams (sequential or strided) tracked per image
 OPTION(rbd_clone_copy_on_read, OPT_BOOL, false)
 OPTION(rbd_blacklist_on_break_lock, OPT_BOOL, true) // whether to blacklist clients whose lock was broken
 OPTION(rbd_blacklist_expire_seconds, OPT_INT, 0) // number of seconds to blacklist - set to 0 for OSD default
 OPTION(rbd_request_timed_out_seconds, OPT_INT, 30) // number of seconds before maint request times out
 OPTION(rbd_skip_partial_discard, OPT_BOOL, false) // when trying to discard a range inside an object, set to true to skip zeroing the range.
 OPTION(rbd_enable_alloc_hint, OPT_BOOL, true) // when writing a object, it will issue a hint to osd backend to indicate the expected size object need
+OPTION(rbd_coalesce_writes, OPT_BOOL, false) // merge adjacent small sequential writes into one object op (only when the cache is disabled)
+OPTION(rbd_coalesce_window, OPT_FLOAT, .001) // seconds a small write may be held waiting for a mergeable neighbor
+OPTION(rbd_coalesce_max_bytes, OPT_LONGLONG, 65536) // stop merging once the buffered extent reaches this size
+OPTION(rbd_copyup_cache_max_bytes, OPT_LONGLONG, 0) // cache of parent blocks read by clone copyups, so a copyup storm reads each parent block once; 0 disables
+OPTION(rbd_copyup_readahead_objects, OPT_INT, 4) // objects of parent data to prefetch ahead of a copyup (requires rbd_copyup_cache_max_bytes > 0)
+OPTION(rbd_fast_lock_handoff, OPT_BOOL, true) // skip the full cache writeback during exclusive lock release when the cache holds no dirty data
 
 /*
  * The following options change the behavior for librbd's image creation methods that
@@ -974,6 +1100,7 @@ OPTION(rgw_override_bucket_index_max_shards, OPT_U32, 0)
  * Represents the maximum AIO pending requests for the bucket index object shards.
  */
 OPTION(rgw_bucket_index_max_aio, OPT_U32, 8)
+OPTION(rgw_bucket_index_list_per_shard, OPT_U32, 0) // entries fetched from each index shard per listing round (0 = scale with requested count / shards)
 
 /**
  * whether or not the quota/gc threads should be started
@@ -985,6 +1112,9 @@ OPTION(rgw_data, OPT_STR, "/var/lib/ceph/radosgw/$cluster-$id")
 OPTION(rgw_enable_apis, OPT_STR, "s3, swift, swift_auth, admin")
 OPTION(rgw_cache_enabled, OPT_BOOL, true)   // rgw cache enabled
 OPTION(rgw_cache_lru_size, OPT_INT, 10000)   // num of entries in rgw cache
+OPTION(rgw_cache_num_shards, OPT_INT, 8)     // num of locking shards in rgw metadata cache
+OPTION(rgw_cache_distribute_interval_ms, OPT_INT, 0) // batch cache notifications into one digest notify per interval (0 = notify per write); all gateways must support digests before enabling
+OPTION(rgw_civetweb_stream_responses, OPT_BOOL, true) // stream responses of unknown length with chunked transfer encoding instead of buffering them per connection
 OPTION(rgw_socket_path, OPT_STR, "")   // path to unix domain socket, if not specified, rgw will not run as external fcgi
 OPTION(rgw_host, OPT_STR, "")  // host for radosgw, can be an IP, default is 0.0.0.0
 OPTION(rgw_port, OPT_STR, "")  // port to listen, format as "8080" "5000", if not specified, rgw will not run external fcgi
@@ -1006,6 +1136,7 @@ OPTION(rgw_keystone_admin_tenant, OPT_STR, "")  // keystone admin user tenant
 OPTION(rgw_keystone_accepted_roles, OPT_STR, "Member, admin")  // roles required to serve requests
 OPTION(rgw_keystone_token_cache_size, OPT_INT, 10000)  // max number of entries in keystone token cache
 OPTION(rgw_keystone_revocation_interval, OPT_INT, 15 * 60)  // seconds between tokens revocation check
+OPTION(rgw_keystone_token_refresh_window, OPT_INT, 5 * 60)  // renew cached keystone admin token this many seconds before expiry (0 = only on the request path)
 OPTION(rgw_s3_auth_use_rados, OPT_BOOL, true)  // should we try to use the internal credentials for s3?
 OPTION(rgw_s3_auth_use_keystone, OPT_BOOL, false)  // should we try to use keystone for s3?
 OPTION(rgw_admin_entry, OPT_STR, "admin")  // entry point for which a url is considered an admin request
@@ -1044,12 +1175,15 @@ OPTION(rgw_gc_max_objs, OPT_INT, 32)
 OPTION(rgw_gc_obj_min_wait, OPT_INT, 2 * 3600)    // wait time before object may be handled by gc
 OPTION(rgw_gc_processor_max_time, OPT_INT, 3600)  // total run time for a single gc processor work
 OPTION(rgw_gc_processor_period, OPT_INT, 3600)  // gc processor cycle time
+OPTION(rgw_gc_processor_threads, OPT_INT, 1)  // concurrent gc worker threads; shards are arbitrated by the per-shard lock
+OPTION(rgw_gc_aio_window, OPT_INT, 16)  // max in-flight tail object deletions per gc worker
 OPTION(rgw_s3_success_create_obj_status, OPT_INT, 0) // alternative success status response for create-obj (0 - default)
 OPTION(rgw_resolve_cname, OPT_BOOL, false)  // should rgw try to resolve hostname as a dns cname record
 OPTION(rgw_obj_stripe_size, OPT_INT, 4 << 20)
 OPTION(rgw_extended_http_attrs, OPT_STR, "") // list of extended attrs that can be set on objects (beyond the default)
 OPTION(rgw_exit_timeout_secs, OPT_INT, 120) // how many seconds to wait for process to go down before exiting unconditionally
 OPTION(rgw_get_obj_window_size, OPT_INT, 16 << 20) // window size in bytes for single get obj request
+OPTION(rgw_get_obj_max_window_size, OPT_INT, 64 << 20) // upper bound when widening the window for large requests
 OPTION(rgw_get_obj_max_req_size, OPT_INT, 4 << 20) // max length of a single get obj rados op
 OPTION(rgw_relaxed_s3_bucket_names, OPT_BOOL, false) // enable relaxed bucket name rules for US region buckets
 OPTION(rgw_defer_to_bucket_acls, OPT_STR, "") // if the user has bucket perms, use those before key perms (recurse and full_control)
@@ -1067,7 +1201,11 @@ OPTION(rgw_data_log_num_shards, OPT_INT, 128) // number of objects to keep data
 OPTION(rgw_data_log_obj_prefix, OPT_STR, "data_log") //
 OPTION(rgw_replica_log_obj_prefix, OPT_STR, "replica_log") //
 
+OPTION(rgw_log_auto_trim_interval, OPT_INT, 0) // seconds between auto trim of mdlog/datalog/bilog below peer replica log bounds (0 = disabled)
+OPTION(rgw_log_trim_batch_size, OPT_INT, 1000) // max log entries removed per trim operation
+
 OPTION(rgw_bucket_quota_ttl, OPT_INT, 600) // time for cached bucket stats to be cached within rgw instance
+OPTION(rgw_quota_cache_max_staleness, OPT_INT, 60) // secs an expired quota stats entry may still be served while refreshed async (0 = block on refresh)
 OPTION(rgw_bucket_quota_soft_threshold, OPT_DOUBLE, 0.95) // threshold from which we don't rely on cached info for quota decisions
 OPTION(rgw_bucket_quota_cache_size, OPT_INT, 10000) // number of entries in bucket quota cache
 
@@ -1081,6 +1219,7 @@ OPTION(rgw_user_quota_sync_idle_users, OPT_BOOL, false) // whether stats for idl
 OPTION(rgw_user_quota_sync_wait_time, OPT_INT, 3600 * 24) // min time between two full stats sync for non-idle users
 
 OPTION(rgw_multipart_min_part_size, OPT_INT, 5 * 1024 * 1024) // min size for each part (except for last one) in multipart upload
+OPTION(rgw_multipart_complete_max_aio, OPT_INT, 8) // max concurrent part metadata reads when completing a multipart upload
 OPTION(rgw_multipart_part_upload_limit, OPT_INT, 10000) // parts limit in multipart upload
 
 OPTION(rgw_olh_pending_timeout_sec, OPT_INT, 3600) // time until we retire a pending olh change
@@ -56,3 +56,39 @@ void pow2_hist_t::decay(int bits)
   }
   _contract();
 }
+
+// -- log_linear_hist_t --
+void log_linear_hist_t::dump(Formatter *f) const
+{
+  f->open_array_section("histogram");
+  for (std::vector<int32_t>::const_iterator p = h.begin(); p != h.end(); ++p)
+    f->dump_int("count", *p);
+  f->close_section();
+  f->dump_unsigned("total", total);
+}
+
+void log_linear_hist_t::encode(bufferlist& bl) const
+{
+  ENCODE_START(1, 1, bl);
+  ::encode(h, bl);
+  ::encode(total, bl);
+  ENCODE_FINISH(bl);
+}
+
+void log_linear_hist_t::decode(bufferlist::iterator& p)
+{
+  DECODE_START(1, p);
+  ::decode(h, p);
+  ::decode(total, p);
+  DECODE_FINISH(p);
+}
+
+void log_linear_hist_t::generate_test_instances(std::list<log_linear_hist_t*>& ls)
+{
+  ls.push_back(new log_linear_hist_t);
+  ls.push_back(new log_linear_hist_t);
+  ls.back()->add(1);
+  ls.back()->add(16);
+  ls.back()->add(1024);
+  ls.back()->add(1000000);
+}
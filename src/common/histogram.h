@@ -132,4 +132,116 @@ public:
 };
 WRITE_CLASS_ENCODER(pow2_hist_t)
 
+/**
+ * log-linear histogram
+ *
+ * Buckets are arranged in power-of-two groups of SUB_BUCKETS linear
+ * sub-buckets each (HDR-histogram style), so the relative error of a
+ * recorded value is bounded by 1/SUB_BUCKETS at any magnitude.  Useful
+ * for latency distributions where both the median and the far tail
+ * matter; also suitable for perf counters that want percentiles.
+ */
+struct log_linear_hist_t {
+  static const unsigned SUB_BUCKET_BITS = 4;
+  static const unsigned SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+
+  /// h[bucket_of(v)] is the count of values recorded for v
+  std::vector<int32_t> h;
+  /// total count of recorded values
+  uint64_t total;
+
+  log_linear_hist_t() : total(0) {}
+
+private:
+  /// expand to at least another's size
+  void _expand_to(unsigned s) {
+    if (s > h.size())
+      h.resize(s, 0);
+  }
+  /// drop useless trailing 0's
+  void _contract() {
+    unsigned p = h.size();
+    while (p > 0 && h[p-1] == 0)
+      --p;
+    h.resize(p);
+  }
+
+public:
+  void clear() {
+    h.clear();
+    total = 0;
+  }
+
+  /// bucket a value lands in
+  static unsigned bucket_of(uint64_t v) {
+    if (v < SUB_BUCKETS)
+      return v;
+    unsigned group = 63;
+    while (!(v & ((uint64_t)1 << group)))
+      --group;
+    // v in [2^group, 2^(group+1)); linear sub-bucket within the group
+    unsigned sub = (v >> (group - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+    return (group - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub;
+  }
+
+  /// smallest value that lands in bucket b
+  static uint64_t bucket_floor(unsigned b) {
+    if (b < SUB_BUCKETS)
+      return b;
+    unsigned group = b / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+    unsigned sub = b % SUB_BUCKETS;
+    return (uint64_t)(SUB_BUCKETS + sub) << (group - SUB_BUCKET_BITS);
+  }
+
+  void add(uint64_t v) {
+    unsigned b = bucket_of(v);
+    _expand_to(b + 1);
+    h[b]++;
+    total++;
+  }
+
+  /// merge another histogram into this one
+  void add(const log_linear_hist_t& o) {
+    _expand_to(o.h.size());
+    for (unsigned p = 0; p < o.h.size(); ++p)
+      h[p] += o.h[p];
+    total += o.total;
+    _contract();
+  }
+
+  bool operator==(const log_linear_hist_t &r) const {
+    return h == r.h && total == r.total;
+  }
+
+  /**
+   * value at quantile @p q (e.g. 0.5 for the median, 0.99 for p99)
+   *
+   * Returns the lower bound of the bucket holding the q'th value, i.e.
+   * the result underestimates by at most 1/SUB_BUCKETS.  Returns 0 if
+   * nothing has been recorded.
+   */
+  uint64_t value_at_quantile(double q) const {
+    if (total == 0)
+      return 0;
+    uint64_t need = (uint64_t)(q * total);
+    if (need < 1)
+      need = 1;
+    if (need > total)
+      need = total;
+    uint64_t sum = 0;
+    for (unsigned i = 0; i < h.size(); ++i) {
+      sum += h[i];
+      if (sum >= need)
+	return bucket_floor(i);
+    }
+    return bucket_floor(h.size());
+  }
+
+  void dump(Formatter *f) const;
+  void encode(bufferlist &bl) const;
+  void decode(bufferlist::iterator &bl);
+  static void generate_test_instances(std::list<log_linear_hist_t*>& o);
+};
+WRITE_CLASS_ENCODER(log_linear_hist_t)
+
 #endif /* CEPH_HISTOGRAM_H */
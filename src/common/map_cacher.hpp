@@ -69,6 +69,27 @@ public:
     pair<K, V> *next    ///< [out] first key after key
     ) = 0; ///< @return 0 on success, -ENOENT if there is no next
 
+  /// Returns up to max keys after key in one pass; drivers which can
+  /// scan a range cheaply should override this
+  virtual int get_next_batch(
+    const K &key,        ///< [in] key after which to get next
+    unsigned max,        ///< [in] max keys to return
+    std::map<K, V> *out  ///< [out] up to max keys after key
+    ) {
+    K cur = key;
+    for (unsigned i = 0; i < max; ++i) {
+      pair<K, V> next;
+      int r = get_next(cur, &next);
+      if (r == -ENOENT)
+	break;
+      else if (r < 0)
+	return r;
+      out->insert(next);
+      cur = next.first;
+    }
+    return out->empty() ? -ENOENT : 0;
+  } ///< @return 0 on success, -ENOENT if there are no more entries
+
   virtual ~StoreDriver() {}
 };
 
@@ -130,6 +151,48 @@ public:
     return -EINVAL;
   } ///< @return error value, 0 on success, -ENOENT if no more entries
 
+  /// Fetch up to max key/value pairs after specified key
+  int get_next_batch(
+    K key,              ///< [in] key after which to get next
+    unsigned max,       ///< [in] max pairs to return
+    map<K, V> *out      ///< [out] up to max pairs after key
+    ) {
+    while (true) {
+      map<K, V> store;
+      int r = driver->get_next_batch(key, max, &store);
+      if (r < 0 && r != -ENOENT)
+	return r;
+      bool store_exhausted = (r == -ENOENT) || store.size() < max;
+      K bound = store.empty() ? key : store.rbegin()->first;
+
+      // overlay the unstable in-progress updates on the range we got
+      // back from the store
+      K cur = key;
+      pair<K, boost::optional<V> > cached;
+      while (in_progress.get_next(cur, &cached)) {
+	cur = cached.first;
+	if (!store_exhausted && cur > bound)
+	  break;
+	if (cached.second)
+	  store[cur] = cached.second.get();
+	else
+	  store.erase(cur); // cached as removed
+      }
+      while (store.size() > max)
+	store.erase(--store.end());
+
+      if (store.empty()) {
+	if (store_exhausted)
+	  return -ENOENT;
+	// every key in this range was cached as removed; keep scanning
+	key = bound;
+	continue;
+      }
+      out->swap(store);
+      return 0;
+    }
+  } ///< @return error value, 0 on success, -ENOENT if no more entries
+
   /// Adds operation setting keys to Transaction
   void set_keys(
     const map<K, V> &keys,  ///< [in] keys/values to set
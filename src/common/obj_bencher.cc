@@ -25,6 +25,7 @@
 
 #include <stdlib.h>
 #include <time.h>
+#include <unistd.h>
 #include <sstream>
 #include <vector>
 
@@ -169,9 +170,9 @@ void *ObjBencher::status_printer(void *_bencher) {
 
 int ObjBencher::aio_bench(
   int operation, int secondsToRun,
-  int concurrentios, int object_size, bool cleanup, const std::string& run_name, bool no_verify) {
+  int concurrentios, int object_size, bool cleanup, const std::string& run_name, bool no_verify, int rw_mix_read) {
 
-  if (concurrentios <= 0) 
+  if (concurrentios <= 0)
     return -EINVAL;
 
   int num_objects = 0;
@@ -201,12 +202,19 @@ int ObjBencher::aio_bench(
   data.min_latency = 9999.0; // this better be higher than initial latency!
   data.max_latency = 0;
   data.avg_latency = 0;
+  data.latency_hist.clear();
   data.object_contents = contentsChars;
   lock.Unlock();
 
   //fill in contentsChars deterministically so we can check returns
   sanitize_object_contents(&data, data.object_size);
 
+  //make coordinated instances start together
+  if (num_clients > 1) {
+    r = multi_client_barrier(run_name_meta);
+    if (r < 0) goto out;
+  }
+
   if (OP_WRITE == operation) {
     r = write_bench(secondsToRun, concurrentios, run_name_meta);
     if (r != 0) goto out;
@@ -219,6 +227,15 @@ int ObjBencher::aio_bench(
     r = rand_read_bench(secondsToRun, num_objects, concurrentios, prevPid, no_verify);
     if (r != 0) goto out;
   }
+  else if (OP_RW_MIX == operation) {
+    r = rand_read_bench(secondsToRun, num_objects, concurrentios, prevPid, no_verify, rw_mix_read);
+    if (r != 0) goto out;
+  }
+
+  if (num_clients > 1) {
+    r = multi_client_report(run_name_meta);
+    if (r < 0) goto out;
+  }
 
   if (OP_WRITE == operation && cleanup) {
     r = fetch_bench_metadata(run_name_meta, &object_size, &num_objects, &prevPid);
@@ -254,6 +271,13 @@ void _aio_cb(void *cb, void *arg) {
   lc->lock->Unlock();
 }
 
+// histogram records latencies in usec; report them in seconds like the
+// other latency figures
+static double hist_latency(const log_linear_hist_t& h, double q)
+{
+  return (double)h.value_at_quantile(q) / 1000000.0;
+}
+
 template<class T>
 static T vec_stddev(vector<T>& v)
 {
@@ -299,6 +323,148 @@ int ObjBencher::fetch_bench_metadata(const std::string& metadata_file, int* obje
   return 0;
 }
 
+static std::string multi_client_object(const std::string& run, const char *what, int id)
+{
+  std::ostringstream oss;
+  oss << run << "_" << what;
+  if (id >= 0)
+    oss << "_" << id;
+  return oss.str();
+}
+
+int ObjBencher::multi_client_barrier(const std::string& run_name_meta) {
+  bufferlist bl;
+  ::encode(client_id, bl);
+  int r = sync_write(multi_client_object(run_name_meta, "barrier_ready", client_id), bl, sizeof(int));
+  if (r < 0)
+    return r;
+  const std::string go = multi_client_object(run_name_meta, "barrier_go", -1);
+  if (client_id == 0) {
+    // coordinator: wait for everyone to check in, then give the go
+    for (int i = 1; i < num_clients; ++i) {
+      const std::string ready = multi_client_object(run_name_meta, "barrier_ready", i);
+      while (true) {
+        bufferlist in;
+        r = sync_read(ready, in, sizeof(int));
+        if (r > 0)
+          break;
+        if (r < 0 && r != -ENOENT)
+          return r;
+        usleep(100 * 1000);
+      }
+    }
+    bufferlist gobl;
+    ::encode(num_clients, gobl);
+    r = sync_write(go, gobl, sizeof(int));
+    if (r < 0)
+      return r;
+  } else {
+    while (true) {
+      bufferlist in;
+      r = sync_read(go, in, sizeof(int));
+      if (r > 0)
+        break;
+      if (r < 0 && r != -ENOENT)
+        return r;
+      usleep(100 * 1000);
+    }
+  }
+  out(cout) << "Client " << client_id << "/" << num_clients
+	    << " passed start barrier" << std::endl;
+  return 0;
+}
+
+int ObjBencher::multi_client_report(const std::string& run_name_meta) {
+  uint32_t ops = data.finished;
+  uint64_t bytes = (uint64_t)data.finished * data.object_size;
+  uint64_t min_lat = (uint64_t)(data.min_latency * 1000000.0);
+  uint64_t max_lat = (uint64_t)(data.max_latency * 1000000.0);
+
+  // publish this client's totals
+  bufferlist bl;
+  ::encode(ops, bl);
+  ::encode(bytes, bl);
+  ::encode(data.run_time, bl);
+  ::encode(min_lat, bl);
+  ::encode(max_lat, bl);
+  ::encode(data.latency_hist, bl);
+  int r = sync_write(multi_client_object(run_name_meta, "result", client_id), bl, bl.length());
+  if (r < 0)
+    return r;
+  if (client_id != 0)
+    return 0;
+
+  // coordinator: merge everyone's results
+  uint64_t total_ops = ops;
+  uint64_t total_bytes = bytes;
+  utime_t max_time = data.run_time;
+  uint64_t merged_min = min_lat;
+  uint64_t merged_max = max_lat;
+  log_linear_hist_t merged = data.latency_hist;
+  for (int i = 1; i < num_clients; ++i) {
+    const std::string name = multi_client_object(run_name_meta, "result", i);
+    bufferlist in;
+    while (true) {
+      in.clear();
+      r = sync_read(name, in, 1 << 16);
+      if (r > 0)
+        break;
+      if (r < 0 && r != -ENOENT)
+        return r;
+      usleep(100 * 1000);
+    }
+    uint32_t o_ops;
+    uint64_t o_bytes, o_min, o_max;
+    utime_t o_time;
+    log_linear_hist_t o_hist;
+    try {
+      bufferlist::iterator p = in.begin();
+      ::decode(o_ops, p);
+      ::decode(o_bytes, p);
+      ::decode(o_time, p);
+      ::decode(o_min, p);
+      ::decode(o_max, p);
+      ::decode(o_hist, p);
+    } catch (buffer::error& e) {
+      cerr << "Corrupt result object from client " << i << std::endl;
+      return -EINVAL;
+    }
+    total_ops += o_ops;
+    total_bytes += o_bytes;
+    if (o_time > max_time)
+      max_time = o_time;
+    if (o_min < merged_min)
+      merged_min = o_min;
+    if (o_max > merged_max)
+      merged_max = o_max;
+    merged.add(o_hist);
+  }
+
+  double elapsed = (double)max_time;
+  double bandwidth = elapsed > 0 ? (double)total_bytes / elapsed / (1024*1024) : 0;
+  out(cout) << "Aggregate of " << num_clients << " clients:" << std::endl
+       << "Total ops:              " << total_ops << std::endl
+       << "Total time run:         " << max_time << std::endl
+       << "Bandwidth (MB/sec):     " << setprecision(3) << bandwidth << std::endl
+       << "Average IOPS:           " << (int)(elapsed > 0 ? total_ops / elapsed : 0) << std::endl
+       << "Max latency:            " << (double)merged_max / 1000000.0 << std::endl
+       << "Min latency:            " << (double)merged_min / 1000000.0 << std::endl
+       << "Latency p50:            " << hist_latency(merged, 0.5) << std::endl
+       << "Latency p95:            " << hist_latency(merged, 0.95) << std::endl
+       << "Latency p99:            " << hist_latency(merged, 0.99) << std::endl
+       << "Latency p99.9:          " << hist_latency(merged, 0.999) << std::endl;
+
+  // best effort removal of the coordination objects so the run name
+  // can be reused
+  for (int i = 0; i < num_clients; ++i) {
+    sync_remove(multi_client_object(run_name_meta, "barrier_ready", i));
+    sync_remove(multi_client_object(run_name_meta, "result", i));
+  }
+  sync_remove(multi_client_object(run_name_meta, "barrier_go", -1));
+
+  return 0;
+}
+
 int ObjBencher::write_bench(int secondsToRun,
 			    int concurrentios, const string& run_name_meta) {
   if (concurrentios <= 0) 
@@ -401,6 +567,7 @@ int ObjBencher::write_bench(int secondsToRun,
     }
     data.cur_latency = ceph_clock_now(cct) - start_times[slot];
     data.history.latency.push_back(data.cur_latency);
+    data.latency_hist.add((uint64_t)((double)data.cur_latency * 1000000.0));
     total_latency += data.cur_latency;
     if( data.cur_latency > data.max_latency) data.max_latency = data.cur_latency;
     if (data.cur_latency < data.min_latency) data.min_latency = data.cur_latency;
@@ -438,6 +605,8 @@ int ObjBencher::write_bench(int secondsToRun,
     }
     data.cur_latency = ceph_clock_now(cct) - start_times[slot];
     data.history.latency.push_back(data.cur_latency);
+    data.latency_hist.add((uint64_t)((double)data.cur_latency * 1000000.0));
+    data.latency_hist.add((uint64_t)((double)data.cur_latency * 1000000.0));
     total_latency += data.cur_latency;
     if (data.cur_latency > data.max_latency) data.max_latency = data.cur_latency;
     if (data.cur_latency < data.min_latency) data.min_latency = data.cur_latency;
@@ -453,6 +622,7 @@ int ObjBencher::write_bench(int secondsToRun,
   timePassed = ceph_clock_now(cct) - data.start_time;
   lock.Lock();
   data.done = true;
+  data.run_time = timePassed;
   lock.Unlock();
 
   pthread_join(print_thread, NULL);
@@ -475,7 +645,11 @@ int ObjBencher::write_bench(int secondsToRun,
        << "Average Latency:        " << data.avg_latency << std::endl
        << "Stddev Latency:         " << vec_stddev(data.history.latency) << std::endl
        << "Max latency:            " << data.max_latency << std::endl
-       << "Min latency:            " << data.min_latency << std::endl;
+       << "Min latency:            " << data.min_latency << std::endl
+       << "Latency p50:            " << hist_latency(data.latency_hist, 0.5) << std::endl
+       << "Latency p95:            " << hist_latency(data.latency_hist, 0.95) << std::endl
+       << "Latency p99:            " << hist_latency(data.latency_hist, 0.99) << std::endl
+       << "Latency p99.9:          " << hist_latency(data.latency_hist, 0.999) << std::endl;
 
   //write object size/number data for read benchmarks
   ::encode(data.object_size, b_write);
@@ -614,6 +788,7 @@ int ObjBencher::seq_read_bench(int seconds_to_run, int num_objects, int concurre
       goto ERR;
     }
     lock.Lock();
+    data.latency_hist.add((uint64_t)((double)data.cur_latency * 1000000.0));
     total_latency += data.cur_latency;
     if (data.cur_latency > data.max_latency) data.max_latency = data.cur_latency;
     if (data.cur_latency < data.min_latency) data.min_latency = data.cur_latency;
@@ -649,6 +824,7 @@ int ObjBencher::seq_read_bench(int seconds_to_run, int num_objects, int concurre
       goto ERR;
     }
     data.cur_latency = ceph_clock_now(cct) - start_times[slot];
+    data.latency_hist.add((uint64_t)((double)data.cur_latency * 1000000.0));
     total_latency += data.cur_latency;
     if (data.cur_latency > data.max_latency) data.max_latency = data.cur_latency;
     if (data.cur_latency < data.min_latency) data.min_latency = data.cur_latency;
@@ -672,6 +848,7 @@ int ObjBencher::seq_read_bench(int seconds_to_run, int num_objects, int concurre
   runtime = ceph_clock_now(cct) - data.start_time;
   lock.Lock();
   data.done = true;
+  data.run_time = runtime;
   lock.Unlock();
 
   pthread_join(print_thread, NULL);
@@ -690,7 +867,11 @@ int ObjBencher::seq_read_bench(int seconds_to_run, int num_objects, int concurre
        << "Min IOPS:             " << data.idata.min_iops << std::endl
        << "Average Latency:      " << data.avg_latency << std::endl
        << "Max latency:          " << data.max_latency << std::endl
-       << "Min latency:          " << data.min_latency << std::endl;
+       << "Min latency:          " << data.min_latency << std::endl
+       << "Latency p50:          " << hist_latency(data.latency_hist, 0.5) << std::endl
+       << "Latency p95:          " << hist_latency(data.latency_hist, 0.95) << std::endl
+       << "Latency p99:          " << hist_latency(data.latency_hist, 0.99) << std::endl
+       << "Latency p99.9:        " << hist_latency(data.latency_hist, 0.999) << std::endl;
 
   completions_done();
 
@@ -704,7 +885,7 @@ int ObjBencher::seq_read_bench(int seconds_to_run, int num_objects, int concurre
   return r;
 }
 
-int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurrentios, int pid, bool no_verify)
+int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurrentios, int pid, bool no_verify, int read_percent)
 {
   lock_cond lc(&lock);
 
@@ -715,6 +896,7 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
   std::string newName;
   bufferlist* contents[concurrentios];
   int index[concurrentios];
+  std::vector<bool> is_write(concurrentios, false);
   int errors = 0;
   utime_t start_time;
   std::vector<utime_t> start_times(concurrentios);
@@ -806,6 +988,7 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
       goto ERR;
     }
 
+    data.latency_hist.add((uint64_t)((double)data.cur_latency * 1000000.0));
     total_latency += data.cur_latency;
     if (data.cur_latency > data.max_latency) data.max_latency = data.cur_latency;
     if (data.cur_latency < data.min_latency) data.min_latency = data.cur_latency;
@@ -814,13 +997,13 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
     --data.in_flight;
     lock.Unlock();
     
-    if (!no_verify) {
+    if (!no_verify && !is_write[slot]) {
       snprintf(data.object_contents, data.object_size, "I'm the %16dth object!", current_index);
       if (memcmp(data.object_contents, cur_contents->c_str(), data.object_size) != 0) {
         cerr << name[slot] << " is not correct!" << std::endl;
         ++errors;
       }
-    } 
+    }
 
     rand_id = rand() % num_objects;
     newName = generate_object_name(rand_id, pid);
@@ -830,10 +1013,20 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
     // invalidate internal crc cache
     cur_contents->invalidate_crc();
 
-    //start new read and check data if requested
+    //start new op; a mixed workload writes with probability
+    //(100 - read_percent), rewriting the object's deterministic
+    //contents so later reads still verify
+    is_write[slot] = ((rand() % 100) >= read_percent);
     start_times[slot] = ceph_clock_now(g_ceph_context);
     create_completion(slot, _aio_cb, (void *)&lc);
-    r = aio_read(newName, slot, contents[slot], data.object_size);
+    if (is_write[slot]) {
+      snprintf(data.object_contents, data.object_size, "I'm the %16dth object!", rand_id);
+      cur_contents->clear();
+      cur_contents->append(data.object_contents, data.object_size);
+      r = aio_write(newName, slot, *cur_contents, data.object_size);
+    } else {
+      r = aio_read(newName, slot, contents[slot], data.object_size);
+    }
     if (r < 0) {
       goto ERR;
     }
@@ -857,6 +1050,7 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
       goto ERR;
     }
     data.cur_latency = ceph_clock_now(g_ceph_context) - start_times[slot];
+    data.latency_hist.add((uint64_t)((double)data.cur_latency * 1000000.0));
     total_latency += data.cur_latency;
     if (data.cur_latency > data.max_latency) data.max_latency = data.cur_latency;
     if (data.cur_latency < data.min_latency) data.min_latency = data.cur_latency;
@@ -864,7 +1058,7 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
     data.avg_latency = total_latency / data.finished;
     --data.in_flight;
     release_completion(slot);
-    if (!no_verify) {
+    if (!no_verify && !is_write[slot]) {
       snprintf(data.object_contents, data.object_size, "I'm the %16dth object!", index[slot]);
       lock.Unlock();
       if (memcmp(data.object_contents, contents[slot]->c_str(), data.object_size) != 0) {
@@ -880,6 +1074,7 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
   runtime = ceph_clock_now(g_ceph_context) - data.start_time;
   lock.Lock();
   data.done = true;
+  data.run_time = runtime;
   lock.Unlock();
 
   pthread_join(print_thread, NULL);
@@ -889,7 +1084,8 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
   bandwidth = bandwidth/(1024*1024); // we want it in MB/sec
 
   out(cout) << "Total time run:       " << runtime << std::endl
-       << "Total reads made:     " << data.finished << std::endl
+       << (read_percent == 100 ? "Total reads made:     "
+				: "Total ops made:       ") << data.finished << std::endl
        << "Read size:            " << data.object_size << std::endl
        << "Bandwidth (MB/sec):   " << setprecision(3) << bandwidth << std::endl
        << "Average IOPS:         " << (int)(data.finished/runtime) << std::endl
@@ -898,7 +1094,11 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
        << "Min IOPS:             " << data.idata.min_iops << std::endl
        << "Average Latency:      " << data.avg_latency << std::endl
        << "Max latency:          " << data.max_latency << std::endl
-       << "Min latency:          " << data.min_latency << std::endl;
+       << "Min latency:          " << data.min_latency << std::endl
+       << "Latency p50:          " << hist_latency(data.latency_hist, 0.5) << std::endl
+       << "Latency p95:          " << hist_latency(data.latency_hist, 0.95) << std::endl
+       << "Latency p99:          " << hist_latency(data.latency_hist, 0.99) << std::endl
+       << "Latency p99.9:        " << hist_latency(data.latency_hist, 0.999) << std::endl;
 
   completions_done();
 
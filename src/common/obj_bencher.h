@@ -18,6 +18,7 @@
 #include "common/config.h"
 #include "common/Cond.h"
 #include "common/ceph_context.h"
+#include "common/histogram.h"
 #include <cfloat>
 
 struct bench_interval_data {
@@ -45,20 +46,25 @@ struct bench_data {
   double avg_latency;
   struct bench_interval_data idata; // data that is updated by time intervals and not by events
   struct bench_history history; // data history, used to calculate stddev
+  log_linear_hist_t latency_hist; //per-op latencies in usec, for percentiles
   utime_t cur_latency; //latency of last completed transaction
   utime_t start_time; //start time for benchmark
+  utime_t run_time; //elapsed time of the timed portion of the benchmark
   char *object_contents; //pointer to the contents written to each object
 };
 
 const int OP_WRITE     = 1;
 const int OP_SEQ_READ  = 2;
 const int OP_RAND_READ = 3;
+const int OP_RW_MIX    = 4;
 
 // Object is composed of <oid,namespace>
 typedef std::pair<std::string, std::string> Object;
 
 class ObjBencher {
   bool show_time;
+  int num_clients; //total coordinated bench instances, 1 if standalone
+  int client_id; //this instance's id, 0 acts as the coordinator
 public:
   CephContext *cct;
 protected:
@@ -72,7 +78,10 @@ protected:
 
   int write_bench(int secondsToRun, int concurrentios, const string& run_name_meta);
   int seq_read_bench(int secondsToRun, int num_objects, int concurrentios, int writePid, bool no_verify=false);
-  int rand_read_bench(int secondsToRun, int num_objects, int concurrentios, int writePid, bool no_verify=false);
+  int rand_read_bench(int secondsToRun, int num_objects, int concurrentios, int writePid, bool no_verify=false, int read_percent=100);
+
+  int multi_client_barrier(const std::string& run_name_meta);
+  int multi_client_report(const std::string& run_name_meta);
 
   int clean_up(int num_objects, int prevPid, int concurrentios);
   bool more_objects_matching_prefix(const std::string& prefix, std::list<Object>* name);
@@ -100,16 +109,25 @@ protected:
   ostream& out(ostream& os);
   ostream& out(ostream& os, utime_t& t);
 public:
-  ObjBencher(CephContext *cct_) : show_time(false), cct(cct_), lock("ObjBencher::lock") {}
+  ObjBencher(CephContext *cct_) : show_time(false), num_clients(1), client_id(0), cct(cct_), lock("ObjBencher::lock") {}
   virtual ~ObjBencher() {}
   int aio_bench(
     int operation, int secondsToRun,
-    int concurrentios, int op_size, bool cleanup, const std::string& run_name, bool no_verify=false);
+    int concurrentios, int op_size, bool cleanup, const std::string& run_name, bool no_verify=false, int rw_mix_read=50);
   int clean_up(const std::string& prefix, int concurrentios, const std::string& run_name);
 
   void set_show_time(bool dt) {
     show_time = dt;
   }
+  /*
+   * Coordinate this instance with num-1 others sharing the pool: all
+   * instances block on a barrier (objects under the run name) before
+   * the timed run, and instance 0 prints merged results afterwards.
+   */
+  void set_multi_client(int num, int id) {
+    num_clients = num;
+    client_id = id;
+  }
   int clean_up_slow(const std::string& prefix, int concurrentios);
 };
 
@@ -18,6 +18,7 @@
 #include "common/dout.h"
 #include "common/errno.h"
 #include "common/Formatter.h"
+#include "include/encoding.h"
 
 #include <errno.h>
 #include <map>
@@ -30,7 +31,8 @@ using std::ostringstream;
 
 PerfCountersCollection::PerfCountersCollection(CephContext *cct)
   : m_cct(cct),
-    m_lock("PerfCountersCollection")
+    m_lock("PerfCountersCollection"),
+    m_schema_epoch(1)
 {
 }
 
@@ -54,6 +56,7 @@ void PerfCountersCollection::add(class PerfCounters *l)
   }
 
   m_loggers.insert(l);
+  m_schema_epoch++;
 }
 
 void PerfCountersCollection::remove(class PerfCounters *l)
@@ -62,6 +65,7 @@ void PerfCountersCollection::remove(class PerfCounters *l)
   perf_counters_set_t::iterator i = m_loggers.find(l);
   assert(i != m_loggers.end());
   m_loggers.erase(i);
+  m_schema_epoch++;
 }
 
 void PerfCountersCollection::clear()
@@ -72,6 +76,7 @@ void PerfCountersCollection::clear()
   for (; i != i_end; ) {
     m_loggers.erase(i++);
   }
+  m_schema_epoch++;
 }
 
 bool PerfCountersCollection::reset(const std::string &name)
@@ -131,10 +136,101 @@ void PerfCountersCollection::dump_formatted(
   f->close_section();
 }
 
+/**
+ * Serialize the counter schema in binary form: the schema epoch, then
+ * per logger its name and the (name, type) of every counter.  The
+ * matching dump_binary() output is a flat array of raw values in the
+ * same order (two values -- avgcount then sum -- for LONGRUNAVG
+ * counters, one otherwise), so a consumer fetches the schema once and
+ * can then decode high-frequency polls without any Formatter overhead.
+ * An epoch mismatch between schema and dump means the set of loggers
+ * changed and the schema must be re-fetched.
+ */
+void PerfCountersCollection::dump_binary_schema(bufferlist& bl)
+{
+  Mutex::Locker lck(m_lock);
+  ENCODE_START(1, 1, bl);
+  ::encode(m_schema_epoch, bl);
+  __u32 num = m_loggers.size();
+  ::encode(num, bl);
+  for (perf_counters_set_t::iterator l = m_loggers.begin();
+       l != m_loggers.end(); ++l) {
+    (*l)->dump_binary_schema(bl);
+  }
+  ENCODE_FINISH(bl);
+}
+
+void PerfCountersCollection::dump_binary(bufferlist& bl)
+{
+  Mutex::Locker lck(m_lock);
+  ENCODE_START(1, 1, bl);
+  ::encode(m_schema_epoch, bl);
+  for (perf_counters_set_t::iterator l = m_loggers.begin();
+       l != m_loggers.end(); ++l) {
+    (*l)->dump_binary(bl);
+  }
+  ENCODE_FINISH(bl);
+}
+
 // ---------------------------
 
+// Sharded mode support.  Each PerfCounters instance gets a
+// process-unique id, and each thread keeps an id -> block map pointing
+// at its accumulation block for that instance.  Ids are never reused,
+// so entries for deleted instances are never looked up again; they are
+// just dead weight in the map until the thread exits.
+static atomic64_t perf_counters_next_id;
+static thread_local std::map<uint64_t, void*> perf_shard_map;
+
+PerfCounters::perf_counter_data_vec_t *PerfCounters::get_shard()
+{
+  void *&slot = perf_shard_map[m_id];
+  if (!slot) {
+    perf_counter_data_vec_t *shard = new perf_counter_data_vec_t(m_data.size());
+    Mutex::Locker lck(m_lock);
+    m_shards.push_back(shard);
+    slot = shard;
+  }
+  return static_cast<perf_counter_data_vec_t*>(slot);
+}
+
+uint64_t PerfCounters::sum_u64(int off) const
+{
+  // unsigned wraparound makes this exact even if a shard's delta went
+  // "negative" from dec()
+  uint64_t v = m_data[off].u64.read();
+  if (m_sharded) {
+    Mutex::Locker lck(m_lock);
+    for (std::list<perf_counter_data_vec_t*>::const_iterator s = m_shards.begin();
+	 s != m_shards.end();
+	 ++s)
+      v += (**s)[off].u64.read();
+  }
+  return v;
+}
+
+pair<uint64_t,uint64_t> PerfCounters::sum_avg(int off) const
+{
+  pair<uint64_t,uint64_t> a = m_data[off].read_avg();
+  if (m_sharded) {
+    Mutex::Locker lck(m_lock);
+    for (std::list<perf_counter_data_vec_t*>::const_iterator s = m_shards.begin();
+	 s != m_shards.end();
+	 ++s) {
+      pair<uint64_t,uint64_t> b = (**s)[off].read_avg();
+      a.first += b.first;
+      a.second += b.second;
+    }
+  }
+  return a;
+}
+
 PerfCounters::~PerfCounters()
 {
+  while (!m_shards.empty()) {
+    delete m_shards.front();
+    m_shards.pop_front();
+  }
 }
 
 void PerfCounters::inc(int idx, uint64_t amt)
@@ -147,12 +243,14 @@ void PerfCounters::inc(int idx, uint64_t amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_U64))
     return;
+  perf_counter_data_any_d& out = m_sharded ?
+    (*get_shard())[idx - m_lower_bound - 1] : data;
   if (data.type & PERFCOUNTER_LONGRUNAVG) {
-    data.avgcount.inc();
-    data.u64.add(amt);
-    data.avgcount2.inc();
+    out.avgcount.inc();
+    out.u64.add(amt);
+    out.avgcount2.inc();
   } else {
-    data.u64.add(amt);
+    out.u64.add(amt);
   }
 }
 
@@ -167,7 +265,9 @@ void PerfCounters::dec(int idx, uint64_t amt)
   assert(!(data.type & PERFCOUNTER_LONGRUNAVG));
   if (!(data.type & PERFCOUNTER_U64))
     return;
-  data.u64.sub(amt);
+  perf_counter_data_any_d& out = m_sharded ?
+    (*get_shard())[idx - m_lower_bound - 1] : data;
+  out.u64.sub(amt);
 }
 
 void PerfCounters::set(int idx, uint64_t amt)
@@ -199,7 +299,7 @@ uint64_t PerfCounters::get(int idx) const
   const perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_U64))
     return 0;
-  return data.u64.read();
+  return sum_u64(idx - m_lower_bound - 1);
 }
 
 void PerfCounters::tinc(int idx, utime_t amt)
@@ -212,12 +312,14 @@ void PerfCounters::tinc(int idx, utime_t amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return;
+  perf_counter_data_any_d& out = m_sharded ?
+    (*get_shard())[idx - m_lower_bound - 1] : data;
   if (data.type & PERFCOUNTER_LONGRUNAVG) {
-    data.avgcount.inc();
-    data.u64.add(amt.to_nsec());
-    data.avgcount2.inc();
+    out.avgcount.inc();
+    out.u64.add(amt.to_nsec());
+    out.avgcount2.inc();
   } else {
-    data.u64.add(amt.to_nsec());
+    out.u64.add(amt.to_nsec());
   }
 }
 
@@ -246,7 +348,7 @@ utime_t PerfCounters::tget(int idx) const
   const perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return utime_t();
-  uint64_t v = data.u64.read();
+  uint64_t v = sum_u64(idx - m_lower_bound - 1);
   return utime_t(v / 1000000000ull, v % 1000000000ull);
 }
 
@@ -262,7 +364,7 @@ pair<uint64_t, uint64_t> PerfCounters::get_tavg_ms(int idx) const
     return make_pair(0, 0);
   if (!(data.type & PERFCOUNTER_LONGRUNAVG))
     return make_pair(0, 0);
-  pair<uint64_t,uint64_t> a = data.read_avg();
+  pair<uint64_t,uint64_t> a = sum_avg(idx - m_lower_bound - 1);
   return make_pair(a.second, a.first / 1000000ull);
 }
 
@@ -275,6 +377,22 @@ void PerfCounters::reset()
     d->reset();
     ++d;
   }
+
+  if (m_sharded) {
+    Mutex::Locker lck(m_lock);
+    for (std::list<perf_counter_data_vec_t*>::iterator s = m_shards.begin();
+	 s != m_shards.end();
+	 ++s) {
+      for (unsigned i = 0; i < m_data.size(); ++i) {
+	// shard entries carry no type; apply the base entry's reset rule
+	if (m_data[i].type != PERFCOUNTER_U64) {
+	  (**s)[i].u64.set(0);
+	  (**s)[i].avgcount.set(0);
+	  (**s)[i].avgcount2.set(0);
+	}
+      }
+    }
+  }
 }
 
 void PerfCounters::dump_formatted(Formatter *f, bool schema,
@@ -306,9 +424,10 @@ void PerfCounters::dump_formatted(Formatter *f, bool schema,
       }
       f->close_section();
     } else {
+      int off = d - m_data.begin();
       if (d->type & PERFCOUNTER_LONGRUNAVG) {
 	f->open_object_section(d->name);
-	pair<uint64_t,uint64_t> a = d->read_avg();
+	pair<uint64_t,uint64_t> a = sum_avg(off);
 	if (d->type & PERFCOUNTER_U64) {
 	  f->dump_unsigned("avgcount", a.second);
 	  f->dump_unsigned("sum", a.first);
@@ -322,7 +441,7 @@ void PerfCounters::dump_formatted(Formatter *f, bool schema,
 	}
 	f->close_section();
       } else {
-	uint64_t v = d->u64.read();
+	uint64_t v = sum_u64(off);
 	if (d->type & PERFCOUNTER_U64) {
 	  f->dump_unsigned(d->name, v);
 	} else if (d->type & PERFCOUNTER_TIME) {
@@ -338,6 +457,35 @@ void PerfCounters::dump_formatted(Formatter *f, bool schema,
   f->close_section();
 }
 
+void PerfCounters::dump_binary_schema(bufferlist& bl)
+{
+  ::encode(m_name, bl);
+  __u32 num = m_data.size();
+  ::encode(num, bl);
+  for (perf_counter_data_vec_t::const_iterator d = m_data.begin();
+       d != m_data.end(); ++d) {
+    ::encode(string(d->name), bl);
+    ::encode((__u32)d->type, bl);
+  }
+}
+
+void PerfCounters::dump_binary(bufferlist& bl)
+{
+  // raw values only, in schema order; the consumer derives names,
+  // types, and per-poll deltas from its cached schema
+  for (perf_counter_data_vec_t::const_iterator d = m_data.begin();
+       d != m_data.end(); ++d) {
+    int off = d - m_data.begin();
+    if (d->type & PERFCOUNTER_LONGRUNAVG) {
+      pair<uint64_t,uint64_t> a = sum_avg(off);
+      ::encode(a.second, bl);  // avgcount
+      ::encode(a.first, bl);   // sum
+    } else {
+      ::encode(sum_u64(off), bl);
+    }
+  }
+}
+
 const std::string &PerfCounters::get_name() const
 {
   return m_name;
@@ -350,7 +498,9 @@ PerfCounters::PerfCounters(CephContext *cct, const std::string &name,
     m_upper_bound(upper_bound),
     m_name(name.c_str()),
     m_lock_name(std::string("PerfCounters::") + name.c_str()),
-    m_lock(m_lock_name.c_str())
+    m_lock(m_lock_name.c_str()),
+    m_sharded(cct->_conf->perf_sharded_counters),
+    m_id(perf_counters_next_id.inc())
 {
   m_data.resize(upper_bound - lower_bound - 1);
 }
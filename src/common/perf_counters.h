@@ -22,6 +22,7 @@
 #include "include/utime.h"
 
 #include <stdint.h>
+#include <list>
 #include <string>
 #include <vector>
 
@@ -97,6 +98,8 @@ public:
   void reset();
   void dump_formatted(ceph::Formatter *f, bool schema,
       const std::string &counter = "");
+  void dump_binary_schema(ceph::bufferlist& bl);
+  void dump_binary(ceph::bufferlist& bl);
   pair<uint64_t, uint64_t> get_tavg_ms(int idx) const;
 
   const std::string& get_name() const;
@@ -180,11 +183,28 @@ private:
   std::string m_name;
   const std::string m_lock_name;
 
-  /** Protects m_data */
+  /** Protects m_data and m_shards */
   mutable Mutex m_lock;
 
   perf_counter_data_vec_t m_data;
 
+  /**
+   * With perf_sharded_counters set, inc/dec/tinc accumulate into a
+   * per-thread block instead of the shared m_data, so the hot updates
+   * never bounce a cache line between threads; readers sum m_data and
+   * every block.  Blocks are handed out lazily by get_shard() and owned
+   * (and freed) by this object -- a thread that exits simply stops
+   * writing to its block, so no deltas are lost.  set/tset still write
+   * m_data directly, since a set cannot be expressed as a delta.
+   */
+  bool m_sharded;
+  uint64_t m_id;      ///< process-unique; keys the thread-local lookup
+  std::list<perf_counter_data_vec_t*> m_shards;
+
+  perf_counter_data_vec_t *get_shard();
+  uint64_t sum_u64(int off) const;
+  pair<uint64_t,uint64_t> sum_avg(int off) const;
+
   friend class PerfCountersBuilder;
 };
 
@@ -214,6 +234,8 @@ public:
       bool schema,
       const std::string &logger = "",
       const std::string &counter = "");
+  void dump_binary_schema(ceph::bufferlist& bl);
+  void dump_binary(ceph::bufferlist& bl);
 private:
   CephContext *m_cct;
 
@@ -222,6 +244,10 @@ private:
 
   perf_counters_set_t m_loggers;
 
+  /// bumped whenever the set of loggers changes; lets binary-dump
+  /// consumers detect that their cached schema is stale
+  uint64_t m_schema_epoch;
+
   friend class PerfCountersCollectionTest;
 };
 
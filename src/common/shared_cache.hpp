@@ -19,6 +19,7 @@
 #include <list>
 #include <memory>
 #include <utility>
+#include <functional>
 #include "common/Mutex.h"
 #include "common/Cond.h"
 
@@ -360,4 +361,123 @@ public:
   friend class SharedLRUTest;
 };
 
+/**
+ * ShardedSharedLRU
+ *
+ * Hash-sharded wrapper around SharedLRU.  Point operations (lookup,
+ * lookup_or_create, add, purge) touch only the shard owning the key,
+ * so concurrent accesses to distinct keys contend on different locks;
+ * this is the same sharding FDCache applies to its fd registry.
+ * Ordered iteration (get_next) merges across the shards, which each
+ * keep their contents sorted by C.
+ */
+template <class K, class V, class C = std::less<K>, class H = std::hash<K> >
+class ShardedSharedLRU {
+  typedef ceph::shared_ptr<V> VPtr;
+  unsigned num_shards;
+  uint32_t shard_mask;
+  H hash;
+  C comp;
+  SharedLRU<K, V, C> *shards;
+
+  SharedLRU<K, V, C> &shard(const K& key) {
+    return shards[hash(key) & shard_mask];
+  }
+
+public:
+  ShardedSharedLRU(CephContext *cct, size_t max_size, unsigned n)
+    : num_shards(1) {
+    // power of two so we can shard by mask instead of division
+    while (num_shards < n)
+      num_shards <<= 1;
+    shard_mask = num_shards - 1;
+    shards = new SharedLRU<K, V, C>[num_shards];
+    size_t per_shard = max_size / num_shards;
+    if (!per_shard)
+      per_shard = 1;
+    for (unsigned i = 0; i < num_shards; ++i) {
+      shards[i].set_cct(cct);
+      shards[i].set_size(per_shard);
+    }
+  }
+
+  ~ShardedSharedLRU() {
+    delete[] shards;
+  }
+
+  void reset_comparator(C c) {
+    comp = c;
+    for (unsigned i = 0; i < num_shards; ++i)
+      shards[i].reset_comparator(c);
+  }
+
+  C get_comparator() {
+    return comp;
+  }
+
+  void set_size(size_t new_size) {
+    size_t per_shard = new_size / num_shards;
+    if (!per_shard)
+      per_shard = 1;
+    for (unsigned i = 0; i < num_shards; ++i)
+      shards[i].set_size(per_shard);
+  }
+
+  void dump_weak_refs() {
+    for (unsigned i = 0; i < num_shards; ++i)
+      shards[i].dump_weak_refs();
+  }
+
+  void clear() {
+    for (unsigned i = 0; i < num_shards; ++i)
+      shards[i].clear();
+  }
+
+  void clear(const K& key) {
+    shard(key).clear(key);
+  }
+
+  void purge(const K& key) {
+    shard(key).purge(key);
+  }
+
+  bool empty() {
+    for (unsigned i = 0; i < num_shards; ++i) {
+      if (!shards[i].empty())
+	return false;
+    }
+    return true;
+  }
+
+  VPtr lookup(const K& key) {
+    return shard(key).lookup(key);
+  }
+
+  VPtr lookup_or_create(const K& key) {
+    return shard(key).lookup_or_create(key);
+  }
+
+  VPtr add(const K& key, V *value, bool *existed = NULL) {
+    return shard(key).add(key, value, existed);
+  }
+
+  /// smallest cached key (by C) greater than key, merged over shards
+  bool get_next(const K& key, pair<K, VPtr> *next) {
+    bool found = false;
+    pair<K, VPtr> best;
+    for (unsigned i = 0; i < num_shards; ++i) {
+      pair<K, VPtr> candidate;
+      if (!shards[i].get_next(key, &candidate))
+	continue;
+      if (!found || comp(candidate.first, best.first)) {
+	best = candidate;
+	found = true;
+      }
+    }
+    if (found && next)
+      *next = best;
+    return found;
+  }
+};
+
 #endif
@@ -20,8 +20,8 @@
 #undef dout_prefix
 #define dout_prefix *_dout << "compressor "
 
-AsyncCompressor::AsyncCompressor(CephContext *c):
-  compressor(Compressor::create(c->_conf->async_compressor_type)), cct(c),
+AsyncCompressor::AsyncCompressor(CephContext *c, const string &type, int level):
+  compressor(Compressor::create(c, type.empty() ? c->_conf->async_compressor_type : type, level)), cct(c),
   job_id(0),
   compress_tp(g_ceph_context, "AsyncCompressor::compressor_tp", cct->_conf->async_compressor_threads, "async_compressor_threads"),
   job_lock("AsyncCompressor::job_lock"),
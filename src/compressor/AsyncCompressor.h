@@ -108,8 +108,17 @@ class AsyncCompressor {
   void _decompress(bufferlist &in, bufferlist &out);
 
  public:
-  AsyncCompressor(CephContext *c);
-  virtual ~AsyncCompressor() {}
+  // type defaults to async_compressor_type; level is forwarded to the
+  // codec plugin (only zstd cares)
+  AsyncCompressor(CephContext *c, const string &type = "", int level = 0);
+  virtual ~AsyncCompressor() {
+    delete compressor;
+  }
+
+  // false if the codec plugin could not be loaded
+  bool valid() const {
+    return compressor != NULL;
+  }
 
   int get_cpuid(int id) {
     if (coreids.empty())
@@ -0,0 +1,78 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * Copyright (C) 2015 Ceph contributors
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_COMPRESSION_PLUGIN_H
+#define CEPH_COMPRESSION_PLUGIN_H
+
+#include "common/Mutex.h"
+#include "Compressor.h"
+
+extern "C" {
+  const char *__compressor_version();
+  int __compressor_init(char *plugin_name, char *directory);
+}
+
+namespace ceph {
+
+  class CompressionPlugin {
+  public:
+    void *library;
+
+    CompressionPlugin() :
+      library(0) {}
+    virtual ~CompressionPlugin() {}
+
+    virtual int factory(int level,
+			Compressor **cs,
+			ostream *ss) = 0;
+  };
+
+  class CompressionPluginRegistry {
+  public:
+    Mutex lock;
+    bool loading;
+    bool disable_dlclose;
+    std::map<std::string,CompressionPlugin*> plugins;
+
+    static CompressionPluginRegistry singleton;
+
+    CompressionPluginRegistry();
+    ~CompressionPluginRegistry();
+
+    static CompressionPluginRegistry &instance() {
+      return singleton;
+    }
+
+    int factory(const std::string &plugin,
+		const std::string &directory,
+		int level,
+		Compressor **cs,
+		ostream *ss);
+
+    int add(const std::string &name, CompressionPlugin *plugin);
+    int remove(const std::string &name);
+    CompressionPlugin *get(const std::string &name);
+
+    int load(const std::string &plugin_name,
+	     const std::string &directory,
+	     CompressionPlugin **plugin,
+	     ostream *ss);
+
+    int preload(const std::string &plugins,
+		const std::string &directory,
+		ostream *ss);
+  };
+}
+
+#endif
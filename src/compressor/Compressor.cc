@@ -12,14 +12,25 @@
  *
  */
 
+#include "common/ceph_context.h"
+#include "common/config.h"
+#include "common/debug.h"
 #include "Compressor.h"
-#include "SnappyCompressor.h"
+#include "CompressionPlugin.h"
 
+#define dout_subsys ceph_subsys_osd
 
-Compressor* Compressor::create(const string &type)
+Compressor* Compressor::create(CephContext *cct, const string &type,
+			       int level)
 {
-  if (type == "snappy")
-    return new SnappyCompressor();
-
-  assert(0);
+  Compressor *cs = NULL;
+  stringstream ss;
+  int r = CompressionPluginRegistry::instance().factory(
+    type, cct->_conf->compressor_dir, level, &cs, &ss);
+  if (r) {
+    lderr(cct) << __func__ << " failed to load compressor plugin "
+	       << type << ": " << ss.str() << dendl;
+    return NULL;
+  }
+  return cs;
 }
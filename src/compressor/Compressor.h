@@ -18,13 +18,19 @@
 #include "include/int_types.h"
 #include "include/Context.h"
 
+class CephContext;
+
 class Compressor {
  public:
   virtual ~Compressor() {}
   virtual int compress(bufferlist &in, bufferlist &out) = 0;
   virtual int decompress(bufferlist &in, bufferlist &out) = 0;
 
-  static Compressor *create(const string &type);
+  // loads the codec through CompressionPluginRegistry; level is only
+  // meaningful for codecs that support one (e.g. zstd) and is ignored
+  // by the others
+  static Compressor *create(CephContext *cct, const string &type,
+			    int level = 0);
 };
 
 #endif
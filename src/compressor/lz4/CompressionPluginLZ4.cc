@@ -0,0 +1,35 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * Copyright (C) 2015 Ceph contributors
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "ceph_ver.h"
+#include "compressor/CompressionPlugin.h"
+#include "LZ4Compressor.h"
+
+class CompressionPluginLZ4 : public ceph::CompressionPlugin {
+public:
+  virtual int factory(int level, Compressor **cs, ostream *ss)
+  {
+    // lz4 has no compression level in the fast path
+    *cs = new LZ4Compressor();
+    return 0;
+  }
+};
+
+const char *__compressor_version() { return CEPH_GIT_NICE_VER; }
+
+int __compressor_init(char *plugin_name, char *directory)
+{
+  CompressionPluginRegistry &instance = CompressionPluginRegistry::instance();
+  return instance.add(plugin_name, new CompressionPluginLZ4());
+}
@@ -0,0 +1,61 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * Copyright (C) 2015 Ceph contributors
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_LZ4COMPRESSOR_H
+#define CEPH_LZ4COMPRESSOR_H
+
+#include <lz4.h>
+#include "include/buffer.h"
+#include "include/encoding.h"
+#include "compressor/Compressor.h"
+
+class LZ4Compressor : public Compressor {
+ public:
+  virtual ~LZ4Compressor() {}
+  virtual int compress(bufferlist &src, bufferlist &dst) {
+    // lz4 does not record the uncompressed length, so prepend it
+    bufferptr ptr(LZ4_compressBound(src.length()));
+    int compressed = LZ4_compress_default(src.get_contiguous(0, src.length()),
+					  ptr.c_str(),
+					  src.length(),
+					  ptr.length());
+    if (compressed <= 0)
+      return -1;
+    uint32_t raw_len = src.length();
+    ::encode(raw_len, dst);
+    dst.append(ptr, 0, compressed);
+    return 0;
+  }
+  virtual int decompress(bufferlist &src, bufferlist &dst) {
+    uint32_t raw_len;
+    bufferlist::iterator p = src.begin();
+    try {
+      ::decode(raw_len, p);
+    } catch (buffer::error &e) {
+      return -1;
+    }
+    bufferptr ptr(raw_len);
+    int decompressed = LZ4_decompress_safe(
+      src.get_contiguous(sizeof(raw_len), src.length() - sizeof(raw_len)),
+      ptr.c_str(),
+      src.length() - sizeof(raw_len),
+      raw_len);
+    if (decompressed < 0 || (uint32_t)decompressed != raw_len)
+      return -1;
+    dst.append(ptr);
+    return 0;
+  }
+};
+
+#endif
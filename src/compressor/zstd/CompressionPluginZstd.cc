@@ -0,0 +1,34 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * Copyright (C) 2015 Ceph contributors
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "ceph_ver.h"
+#include "compressor/CompressionPlugin.h"
+#include "ZstdCompressor.h"
+
+class CompressionPluginZstd : public ceph::CompressionPlugin {
+public:
+  virtual int factory(int level, Compressor **cs, ostream *ss)
+  {
+    *cs = new ZstdCompressor(level);
+    return 0;
+  }
+};
+
+const char *__compressor_version() { return CEPH_GIT_NICE_VER; }
+
+int __compressor_init(char *plugin_name, char *directory)
+{
+  CompressionPluginRegistry &instance = CompressionPluginRegistry::instance();
+  return instance.add(plugin_name, new CompressionPluginZstd());
+}
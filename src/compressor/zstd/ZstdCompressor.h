@@ -0,0 +1,64 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * Copyright (C) 2015 Ceph contributors
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_ZSTDCOMPRESSOR_H
+#define CEPH_ZSTDCOMPRESSOR_H
+
+#include <zstd.h>
+#include "include/buffer.h"
+#include "include/encoding.h"
+#include "compressor/Compressor.h"
+
+class ZstdCompressor : public Compressor {
+  int level;
+
+ public:
+  explicit ZstdCompressor(int l) : level(l > 0 ? l : 1) {}
+  virtual ~ZstdCompressor() {}
+  virtual int compress(bufferlist &src, bufferlist &dst) {
+    // keep the same framing as the other codecs: uncompressed length
+    // first, compressed payload after
+    bufferptr ptr(ZSTD_compressBound(src.length()));
+    size_t compressed = ZSTD_compress(ptr.c_str(), ptr.length(),
+				      src.get_contiguous(0, src.length()),
+				      src.length(),
+				      level);
+    if (ZSTD_isError(compressed))
+      return -1;
+    uint32_t raw_len = src.length();
+    ::encode(raw_len, dst);
+    dst.append(ptr, 0, compressed);
+    return 0;
+  }
+  virtual int decompress(bufferlist &src, bufferlist &dst) {
+    uint32_t raw_len;
+    bufferlist::iterator p = src.begin();
+    try {
+      ::decode(raw_len, p);
+    } catch (buffer::error &e) {
+      return -1;
+    }
+    bufferptr ptr(raw_len);
+    size_t decompressed = ZSTD_decompress(
+      ptr.c_str(), raw_len,
+      src.get_contiguous(sizeof(raw_len), src.length() - sizeof(raw_len)),
+      src.length() - sizeof(raw_len));
+    if (ZSTD_isError(decompressed) || decompressed != raw_len)
+      return -1;
+    dst.append(ptr);
+    return 0;
+  }
+};
+
+#endif
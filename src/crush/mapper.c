@@ -21,6 +21,7 @@
 # include "crush_compat.h"
 # include "crush.h"
 # include "hash.h"
+# include "mapper_intel.h"
 #endif
 #include "crush_ln_table.h"
 
@@ -294,6 +295,11 @@ static __u64 crush_ln(unsigned int xin)
  *
  */
 
+#ifndef __KERNEL__
+/* largest bucket the stack-allocated batch hash buffer covers */
+#define CRUSH_STRAW2_HASH_BATCH_MAX	128
+#endif
+
 static int bucket_straw2_choose(struct crush_bucket_straw2 *bucket,
 				int x, int r)
 {
@@ -301,10 +307,31 @@ static int bucket_straw2_choose(struct crush_bucket_straw2 *bucket,
 	unsigned int u;
 	unsigned int w;
 	__s64 ln, draw, high_draw = 0;
+#ifndef __KERNEL__
+	unsigned int hash_batch[CRUSH_STRAW2_HASH_BATCH_MAX];
+	const unsigned int *uv = NULL;
+
+	/*
+	 * hashing every item is the bulk of the per-bucket cost and the
+	 * items are independent, so compute all the (already masked)
+	 * hashes up front with the SIMD helper when the cpu supports it.
+	 * the ln lookup and the per-weight divide below stay scalar.
+	 */
+	if (bucket->h.size <= CRUSH_STRAW2_HASH_BATCH_MAX &&
+	    crush_straw2_hash_batch_usable(bucket)) {
+		crush_straw2_hash_batch(bucket, x, r, hash_batch);
+		uv = hash_batch;
+	}
+#endif
 
 	for (i = 0; i < bucket->h.size; i++) {
 		w = bucket->item_weights[i];
 		if (w) {
+#ifndef __KERNEL__
+			if (uv)
+				u = uv[i];
+			else
+#endif
 			u = crush_hash32_3(bucket->h.hash, x,
 					   bucket->h.items[i], r);
 			u &= 0xffff;
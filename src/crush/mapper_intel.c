@@ -0,0 +1,117 @@
+/*
+ * Ceph - scalable distributed file system
+ *
+ * Copyright (C) 2015 Intel Corporation All Rights Reserved
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "arch/probe.h"
+#include "arch/intel.h"
+
+#include "crush_compat.h"
+#include "crush.h"
+#include "hash.h"
+#include "mapper_intel.h"
+
+#ifdef __x86_64__
+
+#include <emmintrin.h>
+
+/*
+ * Four-lane SSE2 version of crush_hash32_rjenkins1_3().  Each 32-bit
+ * lane runs the identical sequence of adds, shifts and xors the scalar
+ * code in hash.c runs, so the results are bit-for-bit the same; only
+ * the item (the second hash input) differs between lanes.  SSE2 is
+ * part of the x86_64 baseline, but we still gate on the runtime probe
+ * so a future non-SSE port of this file stays honest.
+ *
+ * This must stay in lockstep with crush_hashmix() in hash.c.
+ */
+#define crush_hashmix_sse2(a, b, c) do {				\
+		a = _mm_sub_epi32(a, b);				\
+		a = _mm_sub_epi32(a, c);				\
+		a = _mm_xor_si128(a, _mm_srli_epi32(c, 13));		\
+		b = _mm_sub_epi32(b, c);				\
+		b = _mm_sub_epi32(b, a);				\
+		b = _mm_xor_si128(b, _mm_slli_epi32(a, 8));		\
+		c = _mm_sub_epi32(c, a);				\
+		c = _mm_sub_epi32(c, b);				\
+		c = _mm_xor_si128(c, _mm_srli_epi32(b, 13));		\
+		a = _mm_sub_epi32(a, b);				\
+		a = _mm_sub_epi32(a, c);				\
+		a = _mm_xor_si128(a, _mm_srli_epi32(c, 12));		\
+		b = _mm_sub_epi32(b, c);				\
+		b = _mm_sub_epi32(b, a);				\
+		b = _mm_xor_si128(b, _mm_slli_epi32(a, 16));		\
+		c = _mm_sub_epi32(c, a);				\
+		c = _mm_sub_epi32(c, b);				\
+		c = _mm_xor_si128(c, _mm_srli_epi32(b, 5));		\
+		a = _mm_sub_epi32(a, b);				\
+		a = _mm_sub_epi32(a, c);				\
+		a = _mm_xor_si128(a, _mm_srli_epi32(c, 3));		\
+		b = _mm_sub_epi32(b, c);				\
+		b = _mm_sub_epi32(b, a);				\
+		b = _mm_xor_si128(b, _mm_slli_epi32(a, 10));		\
+		c = _mm_sub_epi32(c, a);				\
+		c = _mm_sub_epi32(c, b);				\
+		c = _mm_xor_si128(c, _mm_srli_epi32(b, 15));		\
+	} while (0)
+
+#define crush_hash_seed 1315423911
+
+int crush_straw2_hash_batch_usable(const struct crush_bucket_straw2 *bucket)
+{
+	if (!ceph_arch_probed)
+		ceph_arch_probe();
+	return ceph_arch_intel_sse2 &&
+		bucket->h.hash == CRUSH_HASH_RJENKINS1 &&
+		bucket->h.size >= 4;
+}
+
+void crush_straw2_hash_batch(const struct crush_bucket_straw2 *bucket,
+			     int x, int r, unsigned int *hashes)
+{
+	const __s32 *items = bucket->h.items;
+	unsigned int size = bucket->h.size;
+	unsigned int i;
+
+	for (i = 0; i + 4 <= size; i += 4) {
+		__m128i a = _mm_set1_epi32(x);
+		__m128i b = _mm_loadu_si128((const __m128i *)&items[i]);
+		__m128i c = _mm_set1_epi32(r);
+		__m128i hash = _mm_xor_si128(_mm_set1_epi32(crush_hash_seed ^ x ^ r), b);
+		__m128i x0 = _mm_set1_epi32(231232);
+		__m128i y = _mm_set1_epi32(1232);
+
+		crush_hashmix_sse2(a, b, hash);
+		crush_hashmix_sse2(c, x0, hash);
+		crush_hashmix_sse2(y, a, hash);
+		crush_hashmix_sse2(b, x0, hash);
+		crush_hashmix_sse2(y, c, hash);
+
+		hash = _mm_and_si128(hash, _mm_set1_epi32(0xffff));
+		_mm_storeu_si128((__m128i *)&hashes[i], hash);
+	}
+	for (; i < size; i++)
+		hashes[i] = crush_hash32_3(bucket->h.hash, x,
+					   items[i], r) & 0xffff;
+}
+
+#else /* !__x86_64__ */
+
+int crush_straw2_hash_batch_usable(const struct crush_bucket_straw2 *bucket)
+{
+	return 0;
+}
+
+void crush_straw2_hash_batch(const struct crush_bucket_straw2 *bucket,
+			     int x, int r, unsigned int *hashes)
+{
+}
+
+#endif /* __x86_64__ */
@@ -0,0 +1,43 @@
+/*
+ * Ceph - scalable distributed file system
+ *
+ * Copyright (C) 2015 Intel Corporation All Rights Reserved
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_CRUSH_MAPPER_INTEL_H
+#define CEPH_CRUSH_MAPPER_INTEL_H
+
+#include "crush.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * SIMD helpers for the straw2 draw computation.  These are userspace
+ * only (the kernel copy of mapper.c keeps the scalar loop) and produce
+ * bit-identical hash values to crush_hash32_3(), so placement results
+ * do not change depending on which path ran.
+ */
+
+/* true if the batch hash path can be used for this bucket */
+extern int crush_straw2_hash_batch_usable(const struct crush_bucket_straw2 *bucket);
+
+/*
+ * compute crush_hash32_3(bucket->h.hash, x, item, r) & 0xffff for every
+ * item in the bucket.  hashes must have room for bucket->h.size entries.
+ */
+extern void crush_straw2_hash_batch(const struct crush_bucket_straw2 *bucket,
+				    int x, int r, unsigned int *hashes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -68,7 +68,30 @@ int ErasureCode::minimum_to_decode_with_cost(const set<int> &want_to_read,
        i != available.end();
        ++i)
     available_chunks.insert(i->first);
-  return minimum_to_decode(want_to_read, available_chunks, minimum);
+
+  // reading the wanted chunks directly beats any repair set
+  if (includes(available_chunks.begin(), available_chunks.end(),
+	       want_to_read.begin(), want_to_read.end())) {
+    *minimum = want_to_read;
+    return 0;
+  }
+
+  // an MDS code reconstructs from any k chunks, so take the k
+  // cheapest instead of the k lowest-numbered.  plugins with
+  // structured recovery sets (lrc, shec) override this method.
+  unsigned int k = get_data_chunk_count();
+  if (available_chunks.size() < (unsigned)k)
+    return -EIO;
+  vector<pair<int, int> > costs;
+  costs.reserve(available.size());
+  for (map<int, int>::const_iterator i = available.begin();
+       i != available.end();
+       ++i)
+    costs.push_back(make_pair(i->second, i->first));
+  sort(costs.begin(), costs.end());
+  for (unsigned int j = 0; j < (unsigned)k; j++)
+    minimum->insert(costs[j].second);
+  return 0;
 }
 
 int ErasureCode::encode_prepare(const bufferlist &raw,
@@ -118,7 +141,21 @@ int ErasureCode::encode(const set<int> &want_to_encode,
   int err = encode_prepare(in, *encoded);
   if (err)
     return err;
-  encode_chunks(want_to_encode, encoded);
+  if (want_to_encode.size() == k + m) {
+    // the common case: everything is wanted and encode_prepare left
+    // every chunk contiguous and aligned, so hand the raw regions
+    // straight to the plugin kernel
+    vector<char*> chunks(k + m);
+    for (unsigned int i = 0; i < k + m; i++)
+      chunks[i] = (*encoded)[i].c_str();
+    err = encode_regions(&chunks[0], (*encoded)[0].length(), 1);
+    if (err)
+      return err;
+  } else {
+    // plugins that honor want_to_encode (e.g. lrc layers) need the
+    // chunk interface
+    encode_chunks(want_to_encode, encoded);
+  }
   for (unsigned int i = 0; i < k + m; i++) {
     if (want_to_encode.count(i) == 0)
       encoded->erase(i);
@@ -131,6 +168,30 @@ int ErasureCode::encode_chunks(const set<int> &want_to_encode,
 {
   assert("ErasureCode::encode_chunks not implemented" == 0);
 }
+
+int ErasureCode::encode_regions(char **chunks,
+                                unsigned int blocksize,
+                                unsigned int stripes)
+{
+  unsigned int k = get_data_chunk_count();
+  unsigned int m = get_chunk_count() - k;
+  set<int> want_to_encode;
+  for (unsigned int i = 0; i < k + m; i++)
+    want_to_encode.insert(i);
+  for (unsigned int s = 0; s < stripes; s++) {
+    // wrap the regions in static bufferptrs: encode_chunks
+    // implementations call c_str() on contiguous lists, so the kernel
+    // still reads and writes the caller's memory without copies
+    map<int, bufferlist> encoded;
+    char **stripe = chunks + s * (k + m);
+    for (unsigned int i = 0; i < k + m; i++)
+      encoded[i].push_back(buffer::create_static(blocksize, stripe[i]));
+    int err = encode_chunks(want_to_encode, &encoded);
+    if (err)
+      return err;
+  }
+  return 0;
+}
  
 int ErasureCode::decode(const set<int> &want_to_read,
                         const map<int, bufferlist> &chunks,
@@ -70,6 +70,10 @@ namespace ceph {
     virtual int encode_chunks(const set<int> &want_to_encode,
                               map<int, bufferlist> *encoded);
 
+    virtual int encode_regions(char **chunks,
+                               unsigned int blocksize,
+                               unsigned int stripes);
+
     virtual int decode(const set<int> &want_to_read,
                        const map<int, bufferlist> &chunks,
                        map<int, bufferlist> *decoded);
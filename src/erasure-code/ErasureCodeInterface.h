@@ -359,6 +359,29 @@ namespace ceph {
     virtual int encode_chunks(const set<int> &want_to_encode,
                               map<int, bufferlist> *encoded) = 0;
 
+    /**
+     * Encode one or more stripes given as raw memory regions,
+     * computing all coding chunks.
+     *
+     * The **chunks** array contains **stripes** consecutive groups of
+     * **get_chunk_count()** pointers: for stripe **s**, entries
+     * **s * get_chunk_count()** .. **s * get_chunk_count() + k - 1**
+     * point to the data chunks and the remaining **m** entries point
+     * to the coding chunks to be filled in. Every region must be
+     * **blocksize** bytes, SIMD aligned, and already padded by the
+     * caller: unlike **encode** no padding or copying happens here,
+     * which is the point -- plugins can run their kernels directly on
+     * the caller's buffers, across all stripes of the batch.
+     *
+     * @param [in,out] chunks array of stripes * get_chunk_count() pointers
+     * @param [in] blocksize size in bytes of each region
+     * @param [in] stripes number of stripes in the batch
+     * @return **0** on success or a negative errno on error.
+     */
+    virtual int encode_regions(char **chunks,
+                               unsigned int blocksize,
+                               unsigned int stripes) = 0;
+
     /**
      * Decode the **chunks** and store at least **want_to_read**
      * chunks in **decoded**.
@@ -114,6 +114,19 @@ int ErasureCodeIsa::encode_chunks(const set<int> &want_to_encode,
   return 0;
 }
 
+int ErasureCodeIsa::encode_regions(char **chunks,
+                                   unsigned int blocksize,
+                                   unsigned int stripes)
+{
+  // the regions come in pre-padded and aligned, so each stripe goes
+  // straight to the isa kernel without any bufferlist wrapping
+  for (unsigned int s = 0; s < stripes; s++) {
+    char **stripe = chunks + s * (k + m);
+    isa_encode(stripe, stripe + k, blocksize);
+  }
+  return 0;
+}
+
 int ErasureCodeIsa::decode_chunks(const set<int> &want_to_read,
                                   const map<int, bufferlist> &chunks,
                                   map<int, bufferlist> *decoded)
@@ -90,6 +90,10 @@ public:
   virtual int encode_chunks(const set<int> &want_to_encode,
                             map<int, bufferlist> *encoded);
 
+  virtual int encode_regions(char **chunks,
+                             unsigned int blocksize,
+                             unsigned int stripes);
+
   virtual int decode_chunks(const set<int> &want_to_read,
                             const map<int, bufferlist> &chunks,
                             map<int, bufferlist> *decoded);
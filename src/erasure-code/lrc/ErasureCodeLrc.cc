@@ -555,6 +555,20 @@ unsigned int ErasureCodeLrc::get_chunk_size(unsigned int object_size) const
 
 void p(const set<int> &s) { cerr << s; } // for gdb
 
+int ErasureCodeLrc::minimum_to_decode_with_cost(const set<int> &want_to_read,
+						const map<int, int> &available,
+						set<int> *minimum)
+{
+  // the locality structure dictates which sets can repair; per-chunk
+  // costs cannot override it, so strip them
+  set<int> available_chunks;
+  for (map<int, int>::const_iterator i = available.begin();
+       i != available.end();
+       ++i)
+    available_chunks.insert(i->first);
+  return minimum_to_decode(want_to_read, available_chunks, minimum);
+}
+
 int ErasureCodeLrc::minimum_to_decode(const set<int> &want_to_read,
 				      const set<int> &available_chunks,
 				      set<int> *minimum)
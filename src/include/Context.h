@@ -64,6 +64,36 @@ class Context {
     finish(r);
     delete this;
   }
+  /**
+   * Dispose of a context that will never be completed.
+   *
+   * Cancellation paths that would otherwise 'delete' a pending
+   * callback should call this instead, so that contexts which are not
+   * heap-allocated (see EmbeddedContext) can release what they hold
+   * without being deleted.
+   */
+  virtual void abandon() {
+    delete this;
+  }
+};
+
+/**
+ * Context embedded in a longer-lived object
+ *
+ * complete() runs finish() but does not delete, so a chain of
+ * completions can live inline in the object they complete -- one
+ * allocation for the whole chain instead of one heap Context per
+ * stage.  The embedding object must stay alive until the callback has
+ * fired, typically by taking a ref when the context is armed and
+ * dropping it at the end of finish(); finish() must not touch members
+ * after that ref is dropped.
+ */
+class EmbeddedContext : public Context {
+public:
+  void complete(int r) {
+    finish(r);
+  }
+  virtual void abandon() = 0;  ///< must release held refs, never delete
 };
 
 /**
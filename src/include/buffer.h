@@ -123,6 +123,14 @@ public:
   /// enable/disable tracking of buffer::ptr::c_str() calls
   static void track_c_str(bool b);
 
+  /// reserve an arena of 2MB hugepages backing large aligned buffers;
+  /// false if the kernel would not give us the pages
+  static bool init_hugepage_pool(uint64_t bytes);
+  /// bytes of the hugepage arena backing live buffers
+  static uint64_t get_hugepage_pool_inuse();
+  /// bytes reserved for the hugepage arena (0 = pool disabled)
+  static uint64_t get_hugepage_pool_total();
+
 private:
  
   /* hack for memory utilization debugging. */
@@ -133,16 +141,21 @@ private:
    * an abstract raw buffer.  with a reference count.
    */
   class raw;
+  class raw_combined;
   class raw_malloc;
   class raw_static;
   class raw_mmap_pages;
+  class raw_mmap_file;
   class raw_posix_aligned;
   class raw_hack_aligned;
+  class raw_hugepage;
   class raw_char;
   class raw_pipe;
   class raw_unshareable; // diagnostic, unshareable char buffer
 
   friend std::ostream& operator<<(std::ostream& out, const raw &r);
+  /// thread-local free page cache in buffer.cc; needs the raw types
+  friend struct page_raw_pool_t;
 
 public:
   class xio_mempool;
@@ -160,10 +173,12 @@ public:
   static raw* create_aligned(unsigned len, unsigned align);
   static raw* create_page_aligned(unsigned len);
   static raw* create_zero_copy(unsigned len, int fd, int64_t *offset);
+  static raw* create_mmap_file(unsigned len, int fd, uint64_t offset);
   static raw* create_unshareable(unsigned len);
 
 #if defined(HAVE_XIO)
   static raw* create_msg(unsigned len, char *buf, XioDispatchHook *m_hook);
+  static raw* create_reg(unsigned len); // pre-registered (rdma) memory
 #endif
 
   /*
@@ -320,6 +335,10 @@ public:
     mutable iterator last_p;
     int zero_copy_to_fd(int fd) const;
 
+    // for contiguous_appender: carve writable space out of append_buffer
+    char *reserve_append_space(unsigned len);
+    void commit_append_space(unsigned used);
+
   public:
     // cons/des
     list() : _len(0), _memcopy_count(0), last_p(this) {}
@@ -459,7 +478,54 @@ public:
     void append(const list& bl);
     void append(std::istream& in);
     void append_zero(unsigned len);
-    
+
+    /*
+     * contiguous_appender - reserve an upper bound of space once and
+     * write fields through a bare pointer, instead of paying the
+     * capacity check in append() for every few bytes.  The space is
+     * carved out of append_buffer, so this adds no extra buffers or
+     * fragments over a plain append of the same bytes.  Do not modify
+     * the list by other means until flush() (or the destructor) has
+     * run, and do not write past the reservation.
+     */
+    class CEPH_BUFFER_API contiguous_appender {
+      list *pbl;
+      char *start, *pos, *end;
+
+      // no copying; the destructor commits the reserved space
+      contiguous_appender(const contiguous_appender& other);
+      contiguous_appender& operator=(const contiguous_appender& other);
+
+    public:
+      contiguous_appender(list &l, size_t upper_bound) : pbl(&l) {
+	pos = start = l.reserve_append_space(upper_bound);
+	end = start + upper_bound;
+      }
+      ~contiguous_appender() {
+	flush();
+      }
+
+      /// commit what has been written so far to the list
+      void flush() {
+	if (pbl) {
+	  pbl->commit_append_space(pos - start);
+	  pbl = NULL;
+	}
+      }
+
+      void append(const char *p, size_t l) {
+	assert(pos + l <= end);
+	memcpy(pos, p, l);
+	pos += l;
+      }
+
+      /// current write position; valid until flush().  lets callers
+      /// backfill a length they only know after writing (DENC_FINISH)
+      char *get_pos() const {
+	return pos;
+      }
+    };
+
     /*
      * get a char
      */
@@ -486,6 +552,7 @@ public:
     int read_fd_zero_copy(int fd, size_t len);
     int write_file(const char *fn, int mode=0644);
     int write_fd(int fd) const;
+    int write_fd(int fd, uint64_t offset) const;
     int write_fd_zero_copy(int fd) const;
     void prepare_iov(std::vector<iovec> *piov) const;
     uint32_t crc32c(uint32_t crc) const;
@@ -67,6 +67,8 @@
 #define CEPH_FEATURE_OSD_BITWISE_HOBJ_SORT (1ULL<<51) /* can sort objs bitwise */
 #define CEPH_FEATURE_OSD_PROXY_WRITE_FEATURES (1ULL<<52)
 #define CEPH_FEATURE_ERASURE_CODE_PLUGINS_V3 (1ULL<<53)
+#define CEPH_FEATURE_MSG_COMPRESS (1ULL<<54)  /* peer can decompress msg data */
+#define CEPH_FEATURE_OSD_PGLOG_DELTA (1ULL<<55) /* compact pg log wire encoding */
 
 #define CEPH_FEATURE_RESERVED2 (1ULL<<61)  /* slow down, we are almost out... */
 #define CEPH_FEATURE_RESERVED  (1ULL<<62)  /* DO NOT USE THIS ... last bit! */
@@ -156,6 +158,8 @@ static inline unsigned long long ceph_sanitize_features(unsigned long long f) {
 	 CEPH_FEATURE_OSD_BITWISE_HOBJ_SORT |		 \
          CEPH_FEATURE_ERASURE_CODE_PLUGINS_V3 |   \
          CEPH_FEATURE_OSD_PROXY_WRITE_FEATURES |         \
+	 CEPH_FEATURE_MSG_COMPRESS |			 \
+	 CEPH_FEATURE_OSD_PGLOG_DELTA |			 \
 	 0ULL)
 
 #define CEPH_FEATURES_SUPPORTED_DEFAULT  CEPH_FEATURES_ALL
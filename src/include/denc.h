@@ -0,0 +1,158 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * Copyright (C) 2015 Red Hat, Inc.
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+#ifndef CEPH_DENC_H
+#define CEPH_DENC_H
+
+#include "include/int_types.h"
+
+#include "byteorder.h"
+#include "buffer.h"
+#include "encoding.h"
+
+/*
+ * Flat codec support for hot, fixed-layout wire types.
+ *
+ * A denc-capable type implements
+ *
+ *   void bound_encode(size_t& p) const;
+ *     - add an upper bound on the encoded size to p (no data touched)
+ *   void encode(bufferlist::contiguous_appender& p) const;
+ *     - write the encoding through the appender's raw pointer
+ *   void decode(bufferlist::iterator& p);
+ *     - the usual decoder; iterator::copy is already a straight
+ *       memcpy for flat fields, so there is no separate decode pass
+ *
+ * WRITE_CLASS_DENC(T) then generates the usual free encode()/decode()
+ * so existing ::encode(v, bl) call sites and the STL container
+ * encoders keep working: the generated encode() runs the bound pass
+ * once, reserves that much contiguous space, and lets the type write
+ * every field through the pointer with no per-field capacity checks.
+ *
+ * The wire format is whatever the methods emit -- converting a type to
+ * denc must not change its encoding.  The denc() overloads for the
+ * primitive types and DENC_{START,FINISH} below make that mechanical:
+ * a field's bound_encode and encode lines are textually identical,
+ * both 'denc(field, p)'.
+ */
+
+// primitive types: one denc() per pass.  these mirror the
+// WRITE_RAW_ENCODER/WRITE_INTTYPE_ENCODER wire formats exactly.
+#define DENC_RAW(type)							\
+  inline void denc(type v, size_t& p) {					\
+    p += sizeof(type);							\
+  }									\
+  inline void denc(type v, bufferlist::contiguous_appender& p) {	\
+    encode_raw(v, p);							\
+  }									\
+  inline void denc(type &v, bufferlist::iterator& p) {			\
+    decode_raw(v, p);							\
+  }
+
+DENC_RAW(__u8)
+DENC_RAW(__s8)
+
+#define DENC_INTTYPE(type, etype)					\
+  inline void denc(type v, size_t& p) {					\
+    p += sizeof(ceph_##etype);						\
+  }									\
+  inline void denc(type v, bufferlist::contiguous_appender& p) {	\
+    ceph_##etype e;							\
+    e = v;								\
+    encode_raw(e, p);							\
+  }									\
+  inline void denc(type &v, bufferlist::iterator& p) {			\
+    ceph_##etype e;							\
+    decode_raw(e, p);							\
+    v = e;								\
+  }
+
+DENC_INTTYPE(uint64_t, le64)
+DENC_INTTYPE(int64_t, le64)
+DENC_INTTYPE(uint32_t, le32)
+DENC_INTTYPE(int32_t, le32)
+DENC_INTTYPE(uint16_t, le16)
+DENC_INTTYPE(int16_t, le16)
+
+inline void denc(bool v, size_t& p) {
+  p += sizeof(__u8);
+}
+inline void denc(bool v, bufferlist::contiguous_appender& p) {
+  __u8 vv = v;
+  encode_raw(vv, p);
+}
+inline void denc(bool &v, bufferlist::iterator& p) {
+  __u8 vv;
+  decode_raw(vv, p);
+  v = vv;
+}
+
+// versioned encoding, same wire format as ENCODE_START/ENCODE_FINISH:
+// struct_v, struct_compat, then a length backfilled once the fields
+// have been written.  the decode side keeps using the DECODE_START
+// macros from encoding.h.
+inline char *denc_start(__u8 v, __u8 compat, size_t& p)
+{
+  p += 2 * sizeof(__u8) + sizeof(__u32);
+  return NULL;
+}
+inline char *denc_start(__u8 v, __u8 compat, bufferlist::contiguous_appender& p)
+{
+  denc(v, p);
+  denc(compat, p);
+  char *len_pos = p.get_pos();
+  ceph_le32 filler;
+  filler = 0;
+  encode_raw(filler, p);
+  return len_pos;
+}
+inline void denc_finish(char *len_pos, size_t& p)
+{
+}
+inline void denc_finish(char *len_pos, bufferlist::contiguous_appender& p)
+{
+  ceph_le32 len;
+  len = p.get_pos() - (len_pos + sizeof(len));
+  memcpy(len_pos, &len, sizeof(len));
+}
+
+#define DENC_START(v, compat, p)				\
+  char *_denc_len_pos = denc_start((v), (compat), (p))
+#define DENC_FINISH(p)						\
+  denc_finish(_denc_len_pos, (p))
+
+// glue a denc-capable class into the classic encode()/decode() world
+#define WRITE_CLASS_DENC(cl)						\
+  inline void encode(const cl &c, bufferlist &bl, uint64_t features=0) { \
+    size_t bound = 0;							\
+    c.bound_encode(bound);						\
+    bufferlist::contiguous_appender ap(bl, bound);			\
+    c.encode(ap);							\
+  }									\
+  inline void encode(const cl &c, bufferlist::contiguous_appender &ap) { \
+    c.encode(ap);							\
+  }									\
+  inline void decode(cl &c, bufferlist::iterator &p) {			\
+    c.decode(p);							\
+  }									\
+  inline void denc(const cl &c, size_t &p) {				\
+    c.bound_encode(p);							\
+  }									\
+  inline void denc(const cl &c, bufferlist::contiguous_appender &p) {	\
+    c.encode(p);							\
+  }									\
+  inline void denc(cl &c, bufferlist::iterator &p) {			\
+    c.decode(p);							\
+  }
+
+#endif
@@ -52,6 +52,11 @@ inline void encode_raw(const T& t, bufferlist& bl)
   bl.append((char*)&t, sizeof(t));
 }
 template<class T>
+inline void encode_raw(const T& t, bufferlist::contiguous_appender& ap)
+{
+  ap.append((const char*)&t, sizeof(t));
+}
+template<class T>
 inline void decode_raw(T& t, bufferlist::iterator &p)
 {
   p.copy(sizeof(t), (char*)&t);
@@ -59,6 +64,7 @@ inline void decode_raw(T& t, bufferlist::iterator &p)
 
 #define WRITE_RAW_ENCODER(type)						\
   inline void encode(const type &v, bufferlist& bl, uint64_t features=0) { encode_raw(v, bl); } \
+  inline void encode(const type &v, bufferlist::contiguous_appender& ap) { encode_raw(v, ap); } \
   inline void decode(type &v, bufferlist::iterator& p) { __ASSERT_FUNCTION decode_raw(v, p); }
 
 WRITE_RAW_ENCODER(__u8)
@@ -76,6 +82,10 @@ inline void encode(const bool &v, bufferlist& bl) {
   __u8 vv = v;
   encode_raw(vv, bl);
 }
+inline void encode(const bool &v, bufferlist::contiguous_appender& ap) {
+  __u8 vv = v;
+  encode_raw(vv, ap);
+}
 inline void decode(bool &v, bufferlist::iterator& p) {
   __u8 vv;
   decode_raw(vv, p);
@@ -92,6 +102,11 @@ inline void decode(bool &v, bufferlist::iterator& p) {
     e = v;                                                              \
     encode_raw(e, bl);							\
   }									\
+  inline void encode(type v, bufferlist::contiguous_appender& ap) {	\
+    ceph_##etype e;					                \
+    e = v;                                                              \
+    encode_raw(e, ap);							\
+  }									\
   inline void decode(type &v, bufferlist::iterator& p) {		\
     ceph_##etype e;							\
     decode_raw(e, p);							\
@@ -0,0 +1,537 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_FLAT_INTERVAL_SET_H
+#define CEPH_FLAT_INTERVAL_SET_H
+
+#include <algorithm>
+#include <iterator>
+#include <ostream>
+#include <utility>
+#include <vector>
+using namespace std;
+
+#include "encoding.h"
+
+#ifndef MIN
+# define MIN(a,b)  ((a)<=(b) ? (a):(b))
+#endif
+#ifndef MAX
+# define MAX(a,b)  ((a)>=(b) ? (a):(b))
+#endif
+
+/*
+ * flat_interval_set is interval_set backed by a sorted vector of
+ * (start, len) pairs instead of a std::map.  The intervals live in one
+ * contiguous allocation, so copying a set is a single memcpy-ish clone
+ * rather than a node-by-node rebuild, and intersection/union are tight
+ * index-based merge loops over flat arrays instead of pointer chases.
+ * The cost is O(n) insert/erase in the middle, which is fine for the
+ * small sets (clone overlap maps, recovery ranges) this is meant for.
+ *
+ * It mirrors the parts of the interval_set interface the tree uses and
+ * encodes to the identical wire format, so the two are interchangeable
+ * on disk and over the wire.  interval_set's templated set operations
+ * accept a flat_interval_set (and vice versa), so call sites can mix
+ * the two containers where convenient.
+ */
+template<typename T>
+class flat_interval_set {
+ public:
+
+  class const_iterator;
+
+  class iterator : public std::iterator <std::forward_iterator_tag, T>
+  {
+    public:
+        explicit iterator(typename std::vector<std::pair<T,T> >::iterator iter)
+          : _iter(iter)
+        { }
+
+        bool operator==(const iterator& rhs) const {
+          return (_iter == rhs._iter);
+        }
+
+        bool operator!=(const iterator& rhs) const {
+          return (_iter != rhs._iter);
+        }
+
+        // Dereference this iterator to get a pair.
+        pair < T, T > &operator*() {
+                return *_iter;
+        }
+
+        // Return the interval start.
+        T get_start() const {
+                return _iter->first;
+        }
+
+        // Return the interval length.
+        T get_len() const {
+                return _iter->second;
+        }
+
+        // Set the interval length.
+        void set_len(T len) {
+                _iter->second = len;
+        }
+
+        // Preincrement
+        iterator &operator++()
+        {
+                ++_iter;
+                return *this;
+        }
+
+        // Postincrement
+        iterator operator++(int)
+        {
+                iterator prev(_iter);
+                ++_iter;
+                return prev;
+        }
+
+    friend class flat_interval_set<T>::const_iterator;
+
+    protected:
+        typename vector<pair<T,T> >::iterator _iter;
+    friend class flat_interval_set<T>;
+  };
+
+  class const_iterator : public std::iterator <std::forward_iterator_tag, T>
+  {
+    public:
+        explicit const_iterator(typename std::vector<std::pair<T,T> >::const_iterator iter)
+          : _iter(iter)
+        { }
+
+        const_iterator(const iterator &i)
+	  : _iter(i._iter)
+        { }
+
+        bool operator==(const const_iterator& rhs) const {
+          return (_iter == rhs._iter);
+        }
+
+        bool operator!=(const const_iterator& rhs) const {
+          return (_iter != rhs._iter);
+        }
+
+        // Dereference this iterator to get a pair.
+        pair < T, T > operator*() const {
+                return *_iter;
+        }
+
+        // Return the interval start.
+        T get_start() const {
+                return _iter->first;
+        }
+
+        // Return the interval length.
+        T get_len() const {
+                return _iter->second;
+        }
+
+        // Preincrement
+        const_iterator &operator++()
+        {
+                ++_iter;
+                return *this;
+        }
+
+        // Postincrement
+        const_iterator operator++(int)
+        {
+                const_iterator prev(_iter);
+                ++_iter;
+                return prev;
+        }
+
+    protected:
+        typename vector<pair<T,T> >::const_iterator _iter;
+  };
+
+  flat_interval_set() : _size(0) {}
+
+  int num_intervals() const
+  {
+    return m.size();
+  }
+
+  typename flat_interval_set<T>::iterator begin() {
+    return typename flat_interval_set<T>::iterator(m.begin());
+  }
+
+  typename flat_interval_set<T>::iterator end() {
+    return typename flat_interval_set<T>::iterator(m.end());
+  }
+
+  typename flat_interval_set<T>::const_iterator begin() const {
+    return typename flat_interval_set<T>::const_iterator(m.begin());
+  }
+
+  typename flat_interval_set<T>::const_iterator end() const {
+    return typename flat_interval_set<T>::const_iterator(m.end());
+  }
+
+  // helpers
+ private:
+  static bool _start_lt(const pair<T,T>& i, T start) {
+    return i.first < start;
+  }
+
+  /// first interval with first >= start
+  typename vector<pair<T,T> >::iterator lower_bound_m(T start) {
+    return std::lower_bound(m.begin(), m.end(), start, _start_lt);
+  }
+  typename vector<pair<T,T> >::const_iterator lower_bound_m(T start) const {
+    return std::lower_bound(m.begin(), m.end(), start, _start_lt);
+  }
+
+  /// interval containing or after start (analogous to interval_set::find_inc)
+  typename vector<pair<T,T> >::const_iterator find_inc(T start) const {
+    typename vector<pair<T,T> >::const_iterator p = lower_bound_m(start);
+    if (p != m.begin() &&
+        (p == m.end() || p->first > start)) {
+      p--;   // might overlap?
+      if (p->first + p->second <= start)
+        p++; // it doesn't.
+    }
+    return p;
+  }
+
+  typename vector<pair<T,T> >::iterator find_inc_m(T start) {
+    typename vector<pair<T,T> >::iterator p = lower_bound_m(start);
+    if (p != m.begin() &&
+        (p == m.end() || p->first > start)) {
+      p--;   // might overlap?
+      if (p->first + p->second <= start)
+        p++; // it doesn't.
+    }
+    return p;
+  }
+
+ public:
+  bool operator==(const flat_interval_set& other) const {
+    return _size == other._size && m == other.m;
+  }
+
+  int size() const {
+    return _size;
+  }
+
+  // Wire format is identical to interval_set<T> (i.e. to a
+  // std::map<T,T>): __u32 count followed by (start, len) pairs in
+  // ascending order.
+  void encode(bufferlist& bl) const {
+    __u32 n = (__u32)m.size();
+    ::encode(n, bl);
+    encode_nohead(bl);
+  }
+  void encode_nohead(bufferlist& bl) const {
+    for (typename vector<pair<T,T> >::const_iterator p = m.begin();
+	 p != m.end();
+	 ++p) {
+      ::encode(p->first, bl);
+      ::encode(p->second, bl);
+    }
+  }
+  void decode(bufferlist::iterator& bl) {
+    __u32 n;
+    ::decode(n, bl);
+    decode_nohead(n, bl);
+  }
+  void decode_nohead(int n, bufferlist::iterator& bl) {
+    m.clear();
+    m.reserve(n);
+    _size = 0;
+    while (n--) {
+      T start, len;
+      ::decode(start, bl);
+      ::decode(len, bl);
+      m.push_back(make_pair(start, len));
+      _size += len;
+    }
+  }
+
+  void clear() {
+    m.clear();
+    _size = 0;
+  }
+
+  void reserve(size_t n) {
+    m.reserve(n);
+  }
+
+  bool contains(T i) const {
+    typename vector<pair<T,T> >::const_iterator p = find_inc(i);
+    if (p == m.end()) return false;
+    if (p->first > i) return false;
+    if (p->first+p->second <= i) return false;
+    assert(p->first <= i && p->first+p->second > i);
+    return true;
+  }
+  bool contains(T start, T len) const {
+    typename vector<pair<T,T> >::const_iterator p = find_inc(start);
+    if (p == m.end()) return false;
+    if (p->first > start) return false;
+    if (p->first+p->second <= start) return false;
+    assert(p->first <= start && p->first+p->second > start);
+    if (p->first+p->second < start+len) return false;
+    return true;
+  }
+  bool intersects(T start, T len) const {
+    flat_interval_set a;
+    a.insert(start, len);
+    flat_interval_set i;
+    i.intersection_of( *this, a );
+    if (i.empty()) return false;
+    return true;
+  }
+
+  // outer range of set
+  bool empty() const {
+    return m.empty();
+  }
+  T range_start() const {
+    assert(!empty());
+    return m.front().first;
+  }
+  T range_end() const {
+    assert(!empty());
+    return m.back().first + m.back().second;
+  }
+
+  void insert(T val) {
+    insert(val, 1);
+  }
+
+  void insert(T start, T len) {
+    assert(len > 0);
+    _size += len;
+    typename vector<pair<T,T> >::iterator p = lower_bound_m(start);
+    if (p != m.begin()) {
+      typename vector<pair<T,T> >::iterator q = p - 1;
+      if (q->first + q->second >= start) {
+	// adjacent (or, illegally, overlapping) with the previous interval
+	assert(q->first + q->second == start);
+	q->second += len;              // append to end
+	if (p != m.end() &&
+	    start+len == p->first) {   // combine with next, too!
+	  q->second += p->second;
+	  m.erase(p);
+	}
+	return;
+      }
+    }
+    if (p != m.end() && start+len == p->first) {
+      p->first = start;                // append to front
+      p->second += len;
+    } else {
+      assert(p == m.end() || p->first > start+len);
+      m.insert(p, make_pair(start, len));  // new interval
+    }
+  }
+
+  void swap(flat_interval_set<T>& other) {
+    m.swap(other.m);
+    int64_t t = _size;
+    _size = other._size;
+    other._size = t;
+  }
+
+  void erase(T val) {
+    erase(val, 1);
+  }
+
+  void erase(T start, T len) {
+    typename vector<pair<T,T> >::iterator p = find_inc_m(start);
+
+    _size -= len;
+    assert(_size >= 0);
+
+    assert(p != m.end());
+    assert(p->first <= start);
+
+    T before = start - p->first;
+    assert(p->second >= before+len);
+    T after = p->second - before - len;
+
+    if (before) {
+      p->second = before;        // shorten bit before
+      if (after)
+	m.insert(p + 1, make_pair(start+len, after));
+    } else if (after) {
+      p->first = start+len;      // shorten bit after, in place
+      p->second = after;
+    } else {
+      m.erase(p);
+    }
+  }
+
+  void subtract(const flat_interval_set &a) {
+    for (typename vector<pair<T,T> >::const_iterator p = a.m.begin();
+         p != a.m.end();
+         ++p)
+      erase(p->first, p->second);
+  }
+
+  /// subtract any set with interval_set-style const_iterators
+  template<typename S>
+  void subtract(const S &a) {
+    for (typename S::const_iterator p = a.begin();
+	 p != a.end();
+	 ++p)
+      erase(p.get_start(), p.get_len());
+  }
+
+  void insert(const flat_interval_set &a) {
+    for (typename vector<pair<T,T> >::const_iterator p = a.m.begin();
+         p != a.m.end();
+         ++p)
+      insert(p->first, p->second);
+  }
+
+  void intersection_of(const flat_interval_set &a, const flat_interval_set &b) {
+    assert(&a != this);
+    assert(&b != this);
+    clear();
+
+    // Straight-line merge over the two flat arrays.  Everything is
+    // index arithmetic on contiguous memory, so the compiler can keep
+    // the cursors in registers and the hardware prefetcher does the
+    // rest; no tree walking.
+    size_t ia = 0, ib = 0;
+    size_t na = a.m.size(), nb = b.m.size();
+    m.reserve(MIN(na, nb));
+    while (ia < na && ib < nb) {
+      T as = a.m[ia].first, ae = as + a.m[ia].second;
+      T bs = b.m[ib].first, be = bs + b.m[ib].second;
+      T start = MAX(as, bs);
+      T en = MIN(ae, be);
+      if (en > start) {
+	m.push_back(make_pair(start, en - start));
+	_size += en - start;
+      }
+      if (ae <= be)
+	ia++;
+      if (be <= ae)
+	ib++;
+    }
+  }
+  void intersection_of(const flat_interval_set& b) {
+    flat_interval_set a;
+    swap(a);
+    intersection_of(a, b);
+  }
+
+  /// intersect with any set with interval_set-style const_iterators
+  template<typename S>
+  void intersection_of(const S& b) {
+    flat_interval_set a;
+    swap(a);
+    m.reserve(a.m.size());
+    size_t ia = 0, na = a.m.size();
+    typename S::const_iterator pb = b.begin();
+    while (ia < na && pb != b.end()) {
+      T as = a.m[ia].first, ae = as + a.m[ia].second;
+      T bs = pb.get_start(), be = bs + pb.get_len();
+      T start = MAX(as, bs);
+      T en = MIN(ae, be);
+      if (en > start) {
+	m.push_back(make_pair(start, en - start));
+	_size += en - start;
+      }
+      if (ae <= be)
+	ia++;
+      if (be <= ae)
+	++pb;
+    }
+  }
+
+  void union_of(const flat_interval_set &a, const flat_interval_set &b) {
+    assert(&a != this);
+    assert(&b != this);
+    clear();
+
+    // Merge by ascending start, coalescing overlapping or adjacent
+    // intervals as we append; one linear pass, no intermediate sets.
+    size_t ia = 0, ib = 0;
+    size_t na = a.m.size(), nb = b.m.size();
+    m.reserve(na + nb);
+    while (ia < na || ib < nb) {
+      pair<T,T> next;
+      if (ib == nb || (ia < na && a.m[ia].first <= b.m[ib].first))
+	next = a.m[ia++];
+      else
+	next = b.m[ib++];
+      if (!m.empty() && m.back().first + m.back().second >= next.first) {
+	T en = next.first + next.second;
+	T cur_en = m.back().first + m.back().second;
+	if (en > cur_en) {
+	  m.back().second += en - cur_en;
+	  _size += en - cur_en;
+	}
+      } else {
+	m.push_back(next);
+	_size += next.second;
+      }
+    }
+  }
+  void union_of(const flat_interval_set &b) {
+    flat_interval_set a;
+    swap(a);
+    union_of(a, b);
+  }
+
+  bool subset_of(const flat_interval_set &big) const {
+    for (typename vector<pair<T,T> >::const_iterator i = m.begin();
+         i != m.end();
+         ++i)
+      if (!big.contains(i->first, i->second)) return false;
+    return true;
+  }
+
+private:
+  // data
+  int64_t _size;
+  vector<pair<T,T> > m;   // sorted, non-overlapping (start, len) pairs
+};
+
+
+template<class T>
+inline ostream& operator<<(ostream& out, const flat_interval_set<T> &s) {
+  out << "[";
+  const char *prequel = "";
+  for (typename flat_interval_set<T>::const_iterator i = s.begin();
+       i != s.end();
+       ++i)
+  {
+    out << prequel << i.get_start() << "~" << i.get_len();
+    prequel = ",";
+  }
+  out << "]";
+  return out;
+}
+
+template<class T>
+inline void encode(const flat_interval_set<T>& s, bufferlist& bl)
+{
+  s.encode(bl);
+}
+template<class T>
+inline void decode(flat_interval_set<T>& s, bufferlist::iterator& p)
+{
+  s.decode(p);
+}
+
+#endif
@@ -408,6 +408,16 @@ class interval_set {
       erase(p->first, p->second);
   }
 
+  /// subtract any set with interval_set-style const_iterators
+  /// (e.g. flat_interval_set)
+  template<typename S>
+  void subtract(const S &a) {
+    for (typename S::const_iterator p = a.begin();
+	 p != a.end();
+	 ++p)
+      erase(p.get_start(), p.get_len());
+  }
+
   void insert(const interval_set &a) {
     for (typename map<T,T>::const_iterator p = a.m.begin();
          p != a.m.end();
@@ -446,6 +456,33 @@ class interval_set {
     intersection_of(a, b);
   }
 
+  /// intersect with any set with interval_set-style const_iterators
+  /// (e.g. flat_interval_set)
+  template<typename S>
+  void intersection_of(const S& b) {
+    interval_set a;
+    swap(a);
+    typename interval_set<T>::const_iterator pa = a.begin();
+    typename S::const_iterator pb = b.begin();
+    while (pa != a.end() && pb != b.end()) {
+      T as = pa.get_start(), ae = as + pa.get_len();
+      T bs = pb.get_start(), be = bs + pb.get_len();
+      // passing?
+      if (ae <= bs)
+	{ ++pa;  continue; }
+      if (be <= as)
+	{ ++pb;  continue; }
+      T start = MAX(as, bs);
+      T en = MIN(ae, be);
+      assert(en > start);
+      insert(start, en-start);
+      if (ae > be)
+	++pb;
+      else
+	++pa;
+    }
+  }
+
   void union_of(const interval_set &a, const interval_set &b) {
     assert(&a != this);
     assert(&b != this);
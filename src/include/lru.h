@@ -18,6 +18,7 @@
 #define CEPH_LRU_H
 
 #include <stdint.h>
+#include <vector>
 
 #include "common/config.h"
 
@@ -302,11 +303,26 @@ class LRU {
   
   LRUObject *lru_expire() {
     LRUObject *p = lru_get_next_expire();
-    if (p) 
+    if (p)
       return lru_remove(p);
     return NULL;
   }
 
+  // peek at up to max of the oldest unpinned items, oldest first,
+  // without disturbing the lists
+  void lru_peek_expire_candidates(unsigned max, std::vector<LRUObject*>& ls) {
+    for (LRUObject *p = lru_bot.get_tail();
+	 p && ls.size() < max;
+	 p = p->lru_prev)
+      if (!p->lru_pinned)
+	ls.push_back(p);
+    for (LRUObject *p = lru_top.get_tail();
+	 p && ls.size() < max;
+	 p = p->lru_prev)
+      if (!p->lru_pinned)
+	ls.push_back(p);
+  }
+
 
   void lru_status() {
     //generic_dout(10) << "lru: " << lru_num << " items, " << lru_top.get_length() << " top, " << lru_bot.get_length() << " bot, " << lru_pintail.get_length() << " pintail" << dendl;
@@ -30,6 +30,7 @@ extern "C" {
 #include "rados_types.h"
 
 #include <sys/time.h>
+#include <sys/uio.h>
 
 #ifndef CEPH_OSD_TMAP_SET
 /* These are also defined in rados.h and objclass.h. Keep them in sync! */
@@ -808,6 +809,18 @@ CEPH_RADOS_API int rados_ioctx_pool_get_auid(rados_ioctx_t io, uint64_t *auid);
 CEPH_RADOS_API int rados_ioctx_pool_requires_alignment(rados_ioctx_t io);
 CEPH_RADOS_API uint64_t rados_ioctx_pool_required_alignment(rados_ioctx_t io);
 
+/**
+ * Get the number of pgs in the pool of the io context
+ *
+ * This bounds the object listing hash position space, so it can be
+ * used to shard a parallel listing across several iterators (see
+ * rados_nobjects_list_seek() and rados_nobjects_list_set_end()).
+ *
+ * @param io the io context to query
+ * @returns number of pgs, or negative error code on failure
+ */
+CEPH_RADOS_API int rados_ioctx_pool_get_pg_num(rados_ioctx_t io);
+
 /**
  * Get the pool id of the io context
  *
@@ -900,6 +913,22 @@ CEPH_RADOS_API uint32_t rados_nobjects_list_get_pg_hash_position(rados_list_ctx_
 CEPH_RADOS_API uint32_t rados_nobjects_list_seek(rados_list_ctx_t ctx,
                                                  uint32_t pos);
 
+/**
+ * Stop the listing before a given hash position
+ *
+ * The end position is exclusive and is rounded to a pg boundary like
+ * rados_nobjects_list_seek().  Together with seek this allows several
+ * iterators to list disjoint slices of a pool in parallel; use
+ * rados_ioctx_pool_get_pg_num() to bound the position space.
+ *
+ * @param ctx iterator marking where you are in the listing
+ * @param pos hash position to stop before
+ * @returns actual (rounded) end position set, 0 meaning the listing
+ * runs to the end of the pool
+ */
+CEPH_RADOS_API uint32_t rados_nobjects_list_set_end(rados_list_ctx_t ctx,
+                                                    uint32_t pos);
+
 /**
  * Get the next object name and locator in the pool
  *
@@ -1812,6 +1841,36 @@ CEPH_RADOS_API int rados_aio_read(rados_ioctx_t io, const char *oid,
 		                  rados_completion_t completion,
 		                  char *buf, size_t len, uint64_t off);
 
+/**
+ * Asychronously read multiple extents of an object
+ *
+ * All extents are sent to the OSD as a single operation, so a
+ * scattered read costs one round trip instead of one per extent.
+ * Extent i reads iov[i].iov_len bytes from object offset off[i] into
+ * iov[i].iov_base.
+ *
+ * The io context determines the snapshot to read from, if any was set
+ * by rados_ioctx_snap_set_read().
+ *
+ * The return value of the completion will be the total number of
+ * bytes read on success (short extents at end of object read short),
+ * negative error code on failure.
+ *
+ * @note only the 'complete' callback of the completion will be called.
+ *
+ * @param io the context in which to perform the read
+ * @param oid the name of the object to read from
+ * @param completion what to do when the read is complete
+ * @param iov where to store the results, one entry per extent
+ * @param iovcnt number of extents
+ * @param off object offset of each extent, parallel to iov
+ * @returns 0 on success, negative error code on failure
+ */
+CEPH_RADOS_API int rados_aio_readv(rados_ioctx_t io, const char *oid,
+		                   rados_completion_t completion,
+		                   const struct iovec *iov, int iovcnt,
+		                   const uint64_t *off);
+
 /**
  * Block until all pending writes in an io context are safe
  *
@@ -2431,6 +2490,30 @@ CEPH_RADOS_API int rados_aio_write_op_operate(rados_write_op_t write_op,
                                               time_t *mtime,
 			                      int flags);
 
+/**
+ * Perform a batch of write operations asynchronously
+ *
+ * All operations are submitted in a single pass and share one
+ * completion, which fires once every operation in the batch is safe.
+ * The completion's return value is 0 if every operation succeeded, or
+ * the first error seen; per-operation return values are stored in
+ * rvals if it is non-NULL.
+ *
+ * @param io the ioctx that the objects are in
+ * @param completion what to do when the whole batch has been attempted
+ * @param oids the object ids, one per operation
+ * @param write_ops operations to perform, parallel to oids
+ * @param num_ops number of operations in the batch
+ * @param rvals array of num_ops ints for per-operation return values,
+ *        may be NULL
+ */
+CEPH_RADOS_API int rados_aio_operate_batch(rados_ioctx_t io,
+                                           rados_completion_t completion,
+                                           const char * const *oids,
+                                           rados_write_op_t *write_ops,
+                                           size_t num_ops,
+                                           int *rvals);
+
 /**
  * Create a new rados_read_op_t write operation. This will store all
  * actions to be performed atomically. You must call
@@ -109,6 +109,16 @@ namespace librados
     /// move the iterator to a given hash position.  this may (will!) be rounded to the nearest pg.
     uint32_t seek(uint32_t pos);
 
+    /**
+     * Stop the listing before a given hash position (exclusive),
+     * rounded to the nearest pg like seek().  Together with seek()
+     * this lets several iterators list disjoint slices of a pool in
+     * parallel; use IoCtx::pool_get_pg_num() to bound the position
+     * space.  Returns the end position actually set; 0 means the
+     * listing runs to the end of the pool.
+     */
+    uint32_t set_end(uint32_t pos);
+
     /**
      * Configure PGLS filter to be applied OSD-side (requires caller
      * to know/understand the format expected by the OSD)
@@ -635,6 +645,10 @@ namespace librados
     bool pool_requires_alignment();
     uint64_t pool_required_alignment();
 
+    /// number of pgs in the pool; this bounds the object listing hash
+    /// position space, so it can be used to shard a parallel listing
+    int pool_get_pg_num();
+
     // create an object
     int create(const std::string& oid, bool exclusive);
     int create(const std::string& oid, bool exclusive,
@@ -775,6 +789,12 @@ namespace librados
     /// Start enumerating objects for a pool starting from a hash position
     NObjectIterator nobjects_begin(uint32_t start_hash_position,
                                    const bufferlist &filter=bufferlist());
+    /// Start enumerating a slice of a pool: hash positions
+    /// [start_hash_position, end_hash_position).  Disjoint slices may
+    /// be listed by several iterators (or threads) in parallel.
+    NObjectIterator nobjects_begin(uint32_t start_hash_position,
+                                   uint32_t end_hash_position,
+                                   const bufferlist &filter=bufferlist());
     /// Iterator indicating the end of a pool
     const NObjectIterator& nobjects_end() const;
 
@@ -942,6 +962,25 @@ namespace librados
     int aio_operate(const std::string& oid, AioCompletion *c,
 		    ObjectReadOperation *op, int flags,
 		    bufferlist *pbl);
+    /**
+     * Schedule a batch of async write operations
+     *
+     * All operations are submitted in a single pass and complete into
+     * one AioCompletion, which fires once every operation in the batch
+     * is safe.  The completion's return value is 0 if every operation
+     * succeeded, or the first error seen; per-operation return values
+     * are stored in *rvals (resized to match the batch).
+     *
+     * @param oids the objects to operate on, one per operation
+     * @param c what to do when the whole batch is complete and safe
+     * @param ops which operations to perform, parallel to oids
+     * @param rvals per-operation return values, may be NULL
+     * @returns 0 on success, negative error code on failure
+     */
+    int aio_operate_batch(const std::vector<std::string>& oids,
+			  AioCompletion *c,
+			  const std::vector<ObjectWriteOperation*>& ops,
+			  std::vector<int> *rvals);
 
     // watch/notify
     int watch2(const std::string& o, uint64_t *handle,
@@ -231,6 +231,7 @@ struct ltstr
 
 
 #include "encoding.h"
+#include "denc.h"
 
 WRITE_RAW_ENCODER(ceph_fsid)
 WRITE_RAW_ENCODER(ceph_file_layout)
@@ -503,6 +504,12 @@ struct shard_id_t {
 
   const static shard_id_t NO_SHARD;
 
+  void bound_encode(size_t &p) const {
+    denc(id, p);
+  }
+  void encode(bufferlist::contiguous_appender &p) const {
+    denc(id, p);
+  }
   void encode(bufferlist &bl) const {
     ::encode(id, bl);
   }
@@ -510,7 +517,7 @@ struct shard_id_t {
     ::decode(id, bl);
   }
 };
-WRITE_CLASS_ENCODER(shard_id_t)
+WRITE_CLASS_DENC(shard_id_t)
 WRITE_EQ_OPERATORS_1(shard_id_t, id)
 WRITE_CMP_OPERATORS_1(shard_id_t, id)
 ostream &operator<<(ostream &lhs, const shard_id_t &rhs);
@@ -99,6 +99,14 @@ public:
     ::encode(tv.tv_sec, bl);
     ::encode(tv.tv_nsec, bl);
   }
+  void bound_encode(size_t &p) const {
+    denc(tv.tv_sec, p);
+    denc(tv.tv_nsec, p);
+  }
+  void encode(bufferlist::contiguous_appender &p) const {
+    denc(tv.tv_sec, p);
+    denc(tv.tv_nsec, p);
+  }
   void decode(bufferlist::iterator &p) {
     ::decode(tv.tv_sec, p);
     ::decode(tv.tv_nsec, p);
@@ -309,7 +317,7 @@ public:
     return 0;
   }
 };
-WRITE_CLASS_ENCODER(utime_t)
+WRITE_CLASS_DENC(utime_t)
 
 
 // arithmetic operators
@@ -361,12 +361,22 @@ static int omap_insert(cls_method_context_t hctx,
 
   int assert_bound = bound;
 
-  //if this is an exclusive insert, make sure the key doesn't already exist.
+  //if this is an exclusive insert, make sure the keys don't already exist.
+  //one batched read covers all of them.
+  std::set<string> keys;
   for (map<string, bufferlist>::const_iterator it = omap.begin();
       it != omap.end(); ++it) {
-    bufferlist bl;
-    r = cls_cxx_map_get_val(hctx, it->first, &bl);
-    if (r == 0 && string(bl.c_str(), bl.length()) != ""){
+    keys.insert(it->first);
+  }
+  map<string, bufferlist> existing;
+  r = cls_cxx_map_get_vals_by_keys(hctx, keys, &existing);
+  if (r < 0 && r != -ENODATA && r != -ENOENT) {
+    CLS_LOG(20, "error reading omap vals: %d", r);
+    return r;
+  }
+  for (map<string, bufferlist>::iterator it = existing.begin();
+      it != existing.end(); ++it) {
+    if (string(it->second.c_str(), it->second.length()) != "") {
       if (exclusive) {
 	CLS_LOG(20, "error: this is an exclusive insert and %s exists.",
 	    it->first.c_str());
@@ -374,9 +384,6 @@ static int omap_insert(cls_method_context_t hctx,
       }
       assert_bound++;
       CLS_LOG(20, "increased assert_bound to %d", assert_bound);
-    } else if (r != -ENODATA && r != -ENOENT) {
-      CLS_LOG(20, "error reading omap val for %s: %d", it->first.c_str(), r);
-      return r;
     }
   }
 
@@ -509,17 +516,19 @@ static int omap_remove(cls_method_context_t hctx,
     return r;
   }
 
-  //check for existance of the key first
+  //check for existance of the keys first, with one batched read
+  map<string, bufferlist> existing;
+  r = cls_cxx_map_get_vals_by_keys(hctx, omap, &existing);
+  if (r < 0 && r != -ENODATA && r != -ENOENT) {
+    CLS_LOG(20, "error reading omap vals: %d", r);
+    return r;
+  }
   for (set<string>::const_iterator it = omap.begin();
       it != omap.end(); ++it) {
-    bufferlist bl;
-    r = cls_cxx_map_get_val(hctx, *it, &bl);
-    if (r == -ENOENT || r == -ENODATA
-	|| string(bl.c_str(), bl.length()) == ""){
+    map<string, bufferlist>::iterator f = existing.find(*it);
+    if (f == existing.end()
+	|| string(f->second.c_str(), f->second.length()) == ""){
       return -ENODATA;
-    } else if (r < 0) {
-      CLS_LOG(20, "error reading omap val for %s: %d", it->c_str(), r);
-      return r;
     }
   }
 
@@ -550,13 +559,10 @@ static int omap_remove(cls_method_context_t hctx,
     return r;
   }
 
-  for (std::set<string>::const_iterator it = omap.begin();
-      it != omap.end(); ++it) {
-    r = cls_cxx_map_remove_key(hctx, *it);
-    if (r < 0) {
-      CLS_LOG(20, "error removing omap: %d", r);
-      return r;
-    }
+  r = cls_cxx_map_remove_keys(hctx, omap);
+  if (r < 0) {
+    CLS_LOG(20, "error removing omap: %d", r);
+    return r;
   }
   return 0;
 }
@@ -604,10 +610,27 @@ static int maybe_read_for_balance(cls_method_context_t hctx,
   }
   odata.size = atoi(string(size.c_str(), size.length()).c_str());
 
-  //check if it needs to be balanced
-  r = assert_size_in_bound(hctx, bound, comparator);
-  if (r < 0) {
-    CLS_LOG(20, "rebalance read: error on asserting size: %d", r);
+  //check if it needs to be balanced. the size xattr was just read, so
+  //there is no need for an assert_size_in_bound round trip.
+  bool balance = false;
+  switch (comparator) {
+  case CEPH_OSD_CMPXATTR_OP_EQ:
+    balance = ((int)odata.size == bound);
+    break;
+  case CEPH_OSD_CMPXATTR_OP_LT:
+    balance = ((int)odata.size < bound);
+    break;
+  case CEPH_OSD_CMPXATTR_OP_GT:
+    balance = ((int)odata.size > bound);
+    break;
+  default:
+    CLS_LOG(20, "invalid argument passed to maybe_read_for_balance: %d",
+	    comparator);
+    return -EINVAL;
+  }
+  if (!balance) {
+    CLS_LOG(20, "rebalance read: size %llu is in bound %d",
+	    (unsigned long long)odata.size, bound);
     return -EBALANCE;
   }
 
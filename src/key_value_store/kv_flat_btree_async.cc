@@ -87,6 +87,13 @@ void IndexCache::push(const index_data &idata) {
   }
 }
 
+void IndexCache::set_index_version(uint64_t ver) {
+  if (ver > index_ver) {
+    clear();
+    index_ver = ver;
+  }
+}
+
 void IndexCache::pop() {
   if (cache_size == 0) {
     return;
@@ -284,6 +291,11 @@ int KvFlatBtreeAsync::read_index(const string &key, index_data * idata,
     assert(0 == client_name + "-read_index: reading index failed");
     return err;
   }
+  //verify the cache against the index version just read - entries read
+  //from an older incarnation of the index are dropped.
+  icache_lock.Lock();
+  icache.set_index_version(io_ctx.get_last_version());
+  icache_lock.Unlock();
   kvmap.insert(dupmap.begin(), dupmap.end());
   for (map<string, bufferlist>::iterator it = ++kvmap.begin();
       it != kvmap.end();
@@ -410,6 +422,7 @@ int KvFlatBtreeAsync::split(const index_data &idata) {
       << std::endl;
   /////END CRITICAL SECTION/////
   icache_lock.Lock();
+  icache.set_index_version(io_ctx.get_last_version());
   for (vector<delete_data>::iterator it = out_data.to_delete.begin();
       it != out_data.to_delete.end(); ++it) {
     icache.erase(it->max);
@@ -640,6 +653,7 @@ int KvFlatBtreeAsync::rebalance(const index_data &idata1,
     return err;
   }
   icache_lock.Lock();
+  icache.set_index_version(io_ctx.get_last_version());
   for (vector<delete_data>::iterator it = out_data.to_delete.begin();
       it != out_data.to_delete.end(); ++it) {
     icache.erase(it->max);
@@ -1926,6 +1940,7 @@ int KvFlatBtreeAsync::set_many(const map<string, bufferlist> &in_map) {
       << std::endl;
   /////END CRITICAL SECTION/////
   icache_lock.Lock();
+  icache.set_index_version(io_ctx.get_last_version());
   for (vector<delete_data>::iterator it = idata.to_delete.begin();
       it != idata.to_delete.end(); ++it) {
     icache.erase(it->max);
@@ -1938,6 +1953,63 @@ int KvFlatBtreeAsync::set_many(const map<string, bufferlist> &in_map) {
   return err;
 }
 
+int KvFlatBtreeAsync::set_batch(const map<string, bufferlist> &in_map) {
+  if (verbose) cout << client_name << ": setting batch of " << in_map.size()
+      << " keys" << std::endl;
+  int err = 0;
+
+  //group the writes by the leaf object they belong to, so that each leaf
+  //is written with a single omap_insert op.
+  map<string, map<string, bufferlist> > by_obj;
+  for (map<string, bufferlist>::const_iterator it = in_map.begin();
+      it != in_map.end(); ++it) {
+    index_data idata(it->first);
+    err = read_index(it->first, &idata, NULL, false);
+    if (err < 0) {
+      if (verbose) cout << "\t" << client_name
+	  << ": getting oid failed with code " << err << std::endl;
+      return err;
+    }
+    by_obj[idata.obj].insert(*it);
+  }
+
+  for (map<string, map<string, bufferlist> >::iterator oit = by_obj.begin();
+      oit != by_obj.end(); ++oit) {
+    bufferlist inbl;
+    omap_set_args args;
+    args.bound = 2 * k;
+    args.exclusive = false;
+    args.omap = oit->second;
+    args.encode(inbl);
+
+    librados::ObjectWriteOperation owo;
+    owo.exec("kvs", "omap_insert", inbl);
+    if ((((KeyValueStructure *)this)->*KvFlatBtreeAsync::interrupt)() == 1 ) {
+      if (verbose) cout << client_name << " IS SUICIDING!" << std::endl;
+      return -ESUICIDE;
+    }
+    if (verbose) cout << "\t" << client_name << ": inserting "
+	<< oit->second.size() << " keys into object " << oit->first
+	<< std::endl;
+    err = io_ctx.operate(oit->first, &owo);
+    if (err < 0) {
+      //the batch did not fit or the leaf changed - fall back to setting
+      //the keys one at a time so splits happen as usual.
+      if (verbose) cout << "\t" << client_name << ": batch write to "
+	  << oit->first << " failed with " << err
+	  << ", falling back to single sets" << std::endl;
+      for (map<string, bufferlist>::iterator kit = oit->second.begin();
+	  kit != oit->second.end(); ++kit) {
+	err = set(kit->first, kit->second, true);
+	if (err < 0) {
+	  return err;
+	}
+      }
+    }
+  }
+  return err;
+}
+
 int KvFlatBtreeAsync::remove_all() {
   if (verbose) cout << client_name << ": removing all" << std::endl;
   int err = 0;
@@ -422,11 +422,21 @@ protected:
   map<key_data, pair<index_data, utime_t> > k2itmap;
   map<utime_t, key_data> t2kmap;
   int cache_size;
+  uint64_t index_ver; //the version of the index object the cached entries
+		      //were read at
 
 public:
   IndexCache(int n)
-  : cache_size(n)
+  : cache_size(n),
+    index_ver(0)
   {}
+
+  /**
+   * Records the version of the index object the caller just observed. If
+   * it is newer than the version the cached entries were read at, any of
+   * them could be stale, so the cache is cleared.
+   */
+  void set_index_version(uint64_t ver);
   /**
    * Inserts idata into the cache and removes whatever key mapped to before.
    * If the cache is full, pops the oldest entry.
@@ -892,6 +902,17 @@ KvFlatBtreeAsync(int k_val, string name, int cache, double cache_r,
    */
   int set_many(const map<string, bufferlist> &in_map);
 
+  /**
+   * Sets all of the keys in in_map, grouping writes to the same leaf
+   * object into a single omap_insert op. Unlike set_many, this goes
+   * through the normal guarded write path, so it is safe with concurrent
+   * clients. Leaves that reject the batch (e.g., because they would need
+   * to split) fall back to setting their keys one at a time.
+   *
+   * Existing keys are updated.
+   */
+  int set_batch(const map<string, bufferlist> &in_map);
+
   int get_all_keys(std::set<string> *keys);
   int get_all_keys_and_values(map<string,bufferlist> *kv_map);
 
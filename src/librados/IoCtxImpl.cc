@@ -106,7 +106,8 @@ void librados::IoCtxImpl::complete_aio_write(AioCompletionImpl *c)
     ldout(client->cct, 20) << " waking waiters on seq " << waiters->first << dendl;
     for (std::list<AioCompletionImpl*>::iterator it = waiters->second.begin();
 	 it != waiters->second.end(); ++it) {
-      client->finisher.queue(new C_AioCompleteAndSafe(*it));
+      client->finisher.queue(new C_AioCompleteAndSafe(*it), 0,
+			     (uint64_t)(uintptr_t)*it);
       (*it)->put();
     }
     aio_write_waiters.erase(waiters++);
@@ -126,7 +127,8 @@ void librados::IoCtxImpl::flush_aio_writes_async(AioCompletionImpl *c)
   if (aio_write_list.empty()) {
     ldout(client->cct, 20) << "flush_aio_writes_async no writes. (tid "
 			   << seq << ")" << dendl;
-    client->finisher.queue(new C_AioCompleteAndSafe(c));
+    client->finisher.queue(new C_AioCompleteAndSafe(c), 0,
+			   (uint64_t)(uintptr_t)c);
   } else {
     ldout(client->cct, 20) << "flush_aio_writes_async " << aio_write_list.size()
 			   << " writes in flight; waiting on tid " << seq << dendl;
@@ -375,6 +377,12 @@ uint32_t librados::IoCtxImpl::nlist_seek(Objecter::NListContext *context,
   return objecter->list_nobjects_seek(context, pos);
 }
 
+uint32_t librados::IoCtxImpl::nlist_set_end(Objecter::NListContext *context,
+					    uint32_t pos)
+{
+  return objecter->list_nobjects_set_end(context, pos);
+}
+
 int librados::IoCtxImpl::list(Objecter::ListContext *context, int max_entries)
 {
   Cond cond;
@@ -606,6 +614,39 @@ int librados::IoCtxImpl::aio_operate(const object_t& oid,
   return 0;
 }
 
+int librados::IoCtxImpl::aio_operate_batch(const std::vector<object_t>& oids,
+					   const std::vector< ::ObjectOperation*>& ops,
+					   AioCompletionImpl *c,
+					   const SnapContext& snap_context,
+					   int flags, int *rvals)
+{
+  utime_t ut = ceph_clock_now(client->cct);
+  /* can't write to a snapshot */
+  if (snap_seq != CEPH_NOSNAP)
+    return -EROFS;
+  if (oids.size() != ops.size() || oids.empty())
+    return -EINVAL;
+
+  // one reference and one outstanding-write slot for the whole batch;
+  // the last op to go safe completes c.
+  AioBatchInfo *info = new AioBatchInfo(c, rvals, ops.size());
+  c->io = this;
+  queue_aio_write(c);
+
+  vector<Objecter::Op*> objecter_ops;
+  objecter_ops.reserve(ops.size());
+  for (unsigned i = 0; i < ops.size(); i++) {
+    objecter_ops.push_back(
+      objecter->prepare_mutate_op(oids[i], oloc, *ops[i], snap_context, ut,
+				  flags, NULL, new C_aio_batch_Safe(info, i)));
+  }
+
+  // submit under a single objecter lock hold
+  objecter->op_submit_batch(objecter_ops);
+
+  return 0;
+}
+
 int librados::IoCtxImpl::aio_read(const object_t oid, AioCompletionImpl *c,
 				  bufferlist *pbl, size_t len, uint64_t off,
 				  uint64_t snapid)
@@ -658,6 +699,60 @@ private:
   Context *m_ctx;
 };
 
+// scatters the per-extent replies of a multi-extent read into the
+// caller's iovecs, then completes the nested context with the total
+// number of bytes read
+class C_aio_Readv : public Context {
+public:
+  ::ObjectOperation m_ops;
+  std::vector<bufferlist> bls;
+  std::vector<struct iovec> iovs;
+  C_aio_Readv(Context *c) : m_ctx(c) {}
+  virtual void finish(int r) {
+    if (r >= 0) {
+      r = 0;
+      for (unsigned i = 0; i < bls.size(); ++i) {
+	unsigned l = MIN(bls[i].length(), iovs[i].iov_len);
+	if (l)
+	  bls[i].copy(0, l, (char *)iovs[i].iov_base);
+	r += l;
+      }
+    }
+    m_ctx->complete(r);
+  }
+private:
+  Context *m_ctx;
+};
+
+int librados::IoCtxImpl::aio_readv(const object_t oid, AioCompletionImpl *c,
+				   const struct iovec *iov, int iovcnt,
+				   const uint64_t *off, uint64_t snapid)
+{
+  if (iovcnt <= 0)
+    return -EINVAL;
+  uint64_t len = 0;
+  for (int i = 0; i < iovcnt; i++)
+    len += iov[i].iov_len;
+  if (len > (size_t) INT_MAX)
+    return -EDOM;
+
+  Context *nested = new C_aio_Ack(c);
+  C_aio_Readv *onack = new C_aio_Readv(nested);
+
+  c->is_read = true;
+  c->io = this;
+
+  onack->bls.resize(iovcnt);
+  onack->iovs.assign(iov, iov + iovcnt);
+  for (int i = 0; i < iovcnt; i++)
+    onack->m_ops.read(off[i], iov[i].iov_len, &onack->bls[i], NULL, NULL);
+
+  c->tid = objecter->read(oid, oloc,
+	 onack->m_ops, snapid, NULL, 0,
+	 onack, &c->objver);
+  return 0;
+}
+
 int librados::IoCtxImpl::aio_sparse_read(const object_t oid,
 					 AioCompletionImpl *c,
 					 std::map<uint64_t,uint64_t> *m,
@@ -1316,10 +1411,12 @@ void librados::IoCtxImpl::C_aio_Ack::finish(int r)
   }
 
   if (c->callback_complete) {
-    c->io->client->finisher.queue(new C_AioComplete(c));
+    c->io->client->finisher.queue(new C_AioComplete(c), 0,
+				  (uint64_t)(uintptr_t)c);
   }
   if (c->is_read && c->callback_safe) {
-    c->io->client->finisher.queue(new C_AioSafe(c));
+    c->io->client->finisher.queue(new C_AioSafe(c), 0,
+				  (uint64_t)(uintptr_t)c);
   }
 
   c->put_unlock();
@@ -1346,7 +1443,8 @@ void librados::IoCtxImpl::C_aio_stat_Ack::finish(int r)
   }
 
   if (c->callback_complete) {
-    c->io->client->finisher.queue(new C_AioComplete(c));
+    c->io->client->finisher.queue(new C_AioComplete(c), 0,
+				  (uint64_t)(uintptr_t)c);
   }
 
   c->put_unlock();
@@ -1370,11 +1468,60 @@ void librados::IoCtxImpl::C_aio_Safe::finish(int r)
   c->cond.Signal();
 
   if (c->callback_safe) {
-    c->io->client->finisher.queue(new C_AioSafe(c));
+    c->io->client->finisher.queue(new C_AioSafe(c), 0,
+				  (uint64_t)(uintptr_t)c);
+  }
+
+  c->io->complete_aio_write(c);
+
+  c->put_unlock();
+}
+
+/////////////////////////// C_aio_batch_Safe ///////////////////////////
+
+librados::IoCtxImpl::AioBatchInfo::AioBatchInfo(AioCompletionImpl *_c,
+						int *_rvals, unsigned n)
+  : c(_c), rvals(_rvals), remaining(n), err(0)
+{
+  c->get();
+}
+
+librados::IoCtxImpl::C_aio_batch_Safe::C_aio_batch_Safe(AioBatchInfo *_info,
+							unsigned _idx)
+  : info(_info), idx(_idx)
+{
+}
+
+void librados::IoCtxImpl::C_aio_batch_Safe::finish(int r)
+{
+  if (info->rvals)
+    info->rvals[idx] = r;
+  if (r < 0)
+    info->err.compare_and_swap(0, (unsigned)(-r));
+
+  if (info->remaining.dec() > 0)
+    return;
+
+  // last op in the batch: complete the AioCompletion
+  AioCompletionImpl *c = info->c;
+  c->lock.Lock();
+  c->rval = -(int)info->err.read();
+  c->ack = true;
+  c->safe = true;
+  c->cond.Signal();
+
+  if (c->callback_complete) {
+    c->io->client->finisher.queue(new C_AioComplete(c), 0,
+				  (uint64_t)(uintptr_t)c);
+  }
+  if (c->callback_safe) {
+    c->io->client->finisher.queue(new C_AioSafe(c), 0,
+				  (uint64_t)(uintptr_t)c);
   }
 
   c->io->complete_aio_write(c);
 
   c->put_unlock();
+  delete info;
 }
 
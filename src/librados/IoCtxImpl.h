@@ -113,6 +113,7 @@ struct librados::IoCtxImpl {
   // io
   int nlist(Objecter::NListContext *context, int max_entries);
   uint32_t nlist_seek(Objecter::NListContext *context, uint32_t pos);
+  uint32_t nlist_set_end(Objecter::NListContext *context, uint32_t pos);
   int list(Objecter::ListContext *context, int max_entries);
   uint32_t list_seek(Objecter::ListContext *context, uint32_t pos);
   int create(const object_t& oid, bool exclusive);
@@ -149,6 +150,10 @@ struct librados::IoCtxImpl {
 		  int flags);
   int aio_operate_read(const object_t& oid, ::ObjectOperation *o,
 		       AioCompletionImpl *c, int flags, bufferlist *pbl);
+  int aio_operate_batch(const std::vector<object_t>& oids,
+			const std::vector< ::ObjectOperation*>& ops,
+			AioCompletionImpl *c, const SnapContext& snap_context,
+			int flags, int *rvals);
 
   struct C_aio_Ack : public Context {
     librados::AioCompletionImpl *c;
@@ -170,10 +175,33 @@ struct librados::IoCtxImpl {
     void finish(int r);
   };
 
+  /**
+   * Shared state for a batch of ops completing into one AioCompletion.
+   * The last per-op callback to fire completes the AioCompletion with
+   * the first error seen (or 0) and deletes this.
+   */
+  struct AioBatchInfo {
+    AioCompletionImpl *c;
+    int *rvals;          ///< caller-owned per-op result array, may be NULL
+    atomic_t remaining;  ///< ops not yet safe
+    atomic_t err;        ///< first error seen, negated (0 = none)
+    AioBatchInfo(AioCompletionImpl *_c, int *_rvals, unsigned n);
+  };
+
+  struct C_aio_batch_Safe : public Context {
+    AioBatchInfo *info;
+    unsigned idx;
+    C_aio_batch_Safe(AioBatchInfo *_info, unsigned _idx);
+    void finish(int r);
+  };
+
   int aio_read(const object_t oid, AioCompletionImpl *c,
 	       bufferlist *pbl, size_t len, uint64_t off, uint64_t snapid);
   int aio_read(object_t oid, AioCompletionImpl *c,
 	       char *buf, size_t len, uint64_t off, uint64_t snapid);
+  int aio_readv(const object_t oid, AioCompletionImpl *c,
+		const struct iovec *iov, int iovcnt, const uint64_t *off,
+		uint64_t snapid);
   int aio_sparse_read(const object_t oid, AioCompletionImpl *c,
 		      std::map<uint64_t,uint64_t> *m, bufferlist *data_bl,
 		      size_t len, uint64_t off, uint64_t snapid);
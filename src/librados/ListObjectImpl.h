@@ -67,6 +67,9 @@ class NObjectIteratorImpl {
     /// move the iterator to a given hash position.  this may (will!) be rounded to the nearest pg.
     uint32_t seek(uint32_t pos);
 
+    /// stop the listing before a given hash position (exclusive)
+    uint32_t set_end(uint32_t pos);
+
     void set_filter(const bufferlist &bl);
 
   private:
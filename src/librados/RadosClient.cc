@@ -77,7 +77,9 @@ librados::RadosClient::RadosClient(CephContext *cct_)
     timer(cct, lock),
     refcnt(1),
     log_last_version(0), log_cb(NULL), log_cb_arg(NULL),
-    finisher(cct)
+    finisher(cct, "radosclient",
+	     cct_->_conf->librados_finisher_threads < 1 ?
+	       1 : cct_->_conf->librados_finisher_threads)
 {
 }
 
@@ -122,6 +124,19 @@ uint64_t librados::RadosClient::pool_required_alignment(int64_t pool_id)
   return ret;
 }
 
+int librados::RadosClient::pool_get_pg_num(int64_t pool_id)
+{
+  int r = wait_for_osdmap();
+  if (r < 0)
+    return r;
+
+  const OSDMap *osdmap = objecter->get_osdmap_read();
+  int ret = osdmap->have_pg_pool(pool_id) ?
+    (int)osdmap->get_pg_pool(pool_id)->get_pg_num() : -ENOENT;
+  objecter->put_osdmap_read();
+  return ret;
+}
+
 int librados::RadosClient::pool_get_auid(uint64_t pool_id, unsigned long long *auid)
 {
   int r = wait_for_osdmap();
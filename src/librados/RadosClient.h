@@ -94,6 +94,7 @@ public:
   int64_t lookup_pool(const char *name);
   bool pool_requires_alignment(int64_t pool_id);
   uint64_t pool_required_alignment(int64_t pool_id);
+  int pool_get_pg_num(int64_t pool_id);
   int pool_get_auid(uint64_t pool_id, unsigned long long *auid);
   int pool_get_name(uint64_t pool_id, std::string *auid);
 
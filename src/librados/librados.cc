@@ -624,6 +624,11 @@ uint32_t librados::NObjectIteratorImpl::seek(uint32_t pos)
   return r;
 }
 
+uint32_t librados::NObjectIteratorImpl::set_end(uint32_t pos)
+{
+  return rados_nobjects_list_set_end(ctx.get(), pos);
+}
+
 void librados::NObjectIteratorImpl::set_filter(const bufferlist &bl)
 {
   assert(ctx);
@@ -749,6 +754,12 @@ uint32_t librados::NObjectIterator::seek(uint32_t pos)
   return impl->seek(pos);
 }
 
+uint32_t librados::NObjectIterator::set_end(uint32_t pos)
+{
+  assert(impl);
+  return impl->set_end(pos);
+}
+
 void librados::NObjectIterator::set_filter(const bufferlist &bl)
 {
   impl->set_filter(bl);
@@ -1061,6 +1072,11 @@ uint64_t librados::IoCtx::pool_required_alignment()
   return io_ctx_impl->client->pool_required_alignment(get_id());
 }
 
+int librados::IoCtx::pool_get_pg_num()
+{
+  return io_ctx_impl->client->pool_get_pg_num(get_id());
+}
+
 std::string librados::IoCtx::get_pool_name()
 {
   std::string s;
@@ -1402,6 +1418,28 @@ int librados::IoCtx::aio_operate(const std::string& oid, AioCompletion *c,
 				       translate_flags(flags), pbl);
 }
 
+int librados::IoCtx::aio_operate_batch(const std::vector<std::string>& oids,
+				       AioCompletion *c,
+				       const std::vector<ObjectWriteOperation*>& ops,
+				       std::vector<int> *rvals)
+{
+  std::vector<object_t> objs;
+  std::vector< ::ObjectOperation*> oov;
+  objs.reserve(oids.size());
+  oov.reserve(ops.size());
+  for (size_t i = 0; i < oids.size(); ++i)
+    objs.push_back(object_t(oids[i]));
+  for (size_t i = 0; i < ops.size(); ++i)
+    oov.push_back((::ObjectOperation*)ops[i]->impl);
+  int *prvals = NULL;
+  if (rvals) {
+    rvals->resize(ops.size());
+    prvals = &(*rvals)[0];
+  }
+  return io_ctx_impl->aio_operate_batch(objs, oov, c->pc,
+					io_ctx_impl->snapc, 0, prvals);
+}
+
 
 void librados::IoCtx::snap_set_read(snap_t seq)
 {
@@ -1578,6 +1616,22 @@ librados::NObjectIterator librados::IoCtx::nobjects_begin(
   return iter;
 }
 
+librados::NObjectIterator librados::IoCtx::nobjects_begin(
+  uint32_t pos, uint32_t end, const bufferlist &filter)
+{
+  rados_list_ctx_t listh;
+  rados_nobjects_list_open(io_ctx_impl, &listh);
+  NObjectIterator iter((ObjListCtx*)listh);
+  if (filter.length() > 0) {
+    iter.set_filter(filter);
+  }
+  // set the end before seeking; seek fetches the first batch and an
+  // empty slice must not run past its end looking for objects
+  iter.set_end(end);
+  iter.seek(pos);
+  return iter;
+}
+
 const librados::NObjectIterator& librados::IoCtx::nobjects_end() const
 {
   return NObjectIterator::__EndObjectIterator;
@@ -3081,6 +3135,15 @@ extern "C" uint64_t rados_ioctx_pool_required_alignment(rados_ioctx_t io)
   return retval;
 }
 
+extern "C" int rados_ioctx_pool_get_pg_num(rados_ioctx_t io)
+{
+  tracepoint(librados, rados_ioctx_pool_get_pg_num_enter, io);
+  librados::IoCtxImpl *ctx = (librados::IoCtxImpl *)io;
+  int retval = ctx->client->pool_get_pg_num(ctx->get_id());
+  tracepoint(librados, rados_ioctx_pool_get_pg_num_exit, retval);
+  return retval;
+}
+
 extern "C" void rados_ioctx_locator_set_key(rados_ioctx_t io, const char *key)
 {
   tracepoint(librados, rados_ioctx_locator_set_key_enter, io, key);
@@ -3517,6 +3580,21 @@ extern "C" uint32_t rados_nobjects_list_seek(rados_list_ctx_t listctx,
   return r;
 }
 
+extern "C" uint32_t rados_nobjects_list_set_end(rados_list_ctx_t listctx,
+						uint32_t pos)
+{
+  librados::ObjListCtx *lh = (librados::ObjListCtx *)listctx;
+
+  // ranged listing requires the new listing protocol
+  if (!lh->new_request)
+    return 0;
+
+  tracepoint(librados, rados_nobjects_list_set_end_enter, listctx, pos);
+  uint32_t r = lh->ctx->nlist_set_end(lh->nlc, pos);
+  tracepoint(librados, rados_nobjects_list_set_end_exit, r);
+  return r;
+}
+
 extern "C" uint32_t rados_nobjects_list_get_pg_hash_position(
   rados_list_ctx_t listctx)
 {
@@ -3781,6 +3859,20 @@ extern "C" int rados_aio_read(rados_ioctx_t io, const char *o,
   return retval;
 }
 
+extern "C" int rados_aio_readv(rados_ioctx_t io, const char *o,
+			       rados_completion_t completion,
+			       const struct iovec *iov, int iovcnt,
+			       const uint64_t *off)
+{
+  tracepoint(librados, rados_aio_readv_enter, io, o, completion, iovcnt);
+  librados::IoCtxImpl *ctx = (librados::IoCtxImpl *)io;
+  object_t oid(o);
+  int retval = ctx->aio_readv(oid, (librados::AioCompletionImpl*)completion,
+			      iov, iovcnt, off, ctx->snap_seq);
+  tracepoint(librados, rados_aio_readv_exit, retval);
+  return retval;
+}
+
 extern "C" int rados_aio_write(rados_ioctx_t io, const char *o,
 				rados_completion_t completion,
 				const char *buf, size_t len, uint64_t off)
@@ -4429,6 +4521,29 @@ extern "C" int rados_aio_write_op_operate(rados_write_op_t write_op,
   return retval;
 }
 
+extern "C" int rados_aio_operate_batch(rados_ioctx_t io,
+				       rados_completion_t completion,
+				       const char * const *oids,
+				       rados_write_op_t *write_ops,
+				       size_t num_ops,
+				       int *rvals)
+{
+  tracepoint(librados, rados_aio_operate_batch_enter, io, completion, num_ops);
+  librados::IoCtxImpl *ctx = (librados::IoCtxImpl *)io;
+  librados::AioCompletionImpl *c = (librados::AioCompletionImpl*)completion;
+  std::vector<object_t> objs;
+  std::vector< ::ObjectOperation*> oov;
+  objs.reserve(num_ops);
+  oov.reserve(num_ops);
+  for (size_t i = 0; i < num_ops; ++i) {
+    objs.push_back(object_t(oids[i]));
+    oov.push_back((::ObjectOperation *)write_ops[i]);
+  }
+  int retval = ctx->aio_operate_batch(objs, oov, c, ctx->snapc, 0, rvals);
+  tracepoint(librados, rados_aio_operate_batch_exit, retval);
+  return retval;
+}
+
 extern "C" rados_read_op_t rados_create_read_op()
 {
   tracepoint(librados, rados_create_read_op_enter);
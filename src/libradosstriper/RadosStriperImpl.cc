@@ -556,6 +556,8 @@ int libradosstriper::RadosStriperImpl::remove(const std::string& soid)
   try {
     // lock the object in exclusive mode. Will be released when leaving the scope
     RadosExclusiveLock lock(&m_ioCtx, firstObjOid);
+    // the cached size is about to become meaningless
+    invalidateCachedInfo(soid);
     // check size and get number of rados objects to delete
     uint64_t nb_objects = 0;
     bufferlist bl2;
@@ -613,6 +615,8 @@ int libradosstriper::RadosStriperImpl::trunc(const std::string& soid, uint64_t s
   std::string firstObjOid = getObjectId(soid, 0);
   try {
     RadosExclusiveLock lock(&m_ioCtx, firstObjOid);
+    // the cached size is about to become meaningless
+    invalidateCachedInfo(soid);
     // load layout and size
     ceph_file_layout layout;
     uint64_t original_size;
@@ -866,6 +870,10 @@ int libradosstriper::RadosStriperImpl::openStripedObjectForRead(const std::strin
     // error case (including -ENOENT)
     return rc;
   }
+  // use the cached layout and size when this striper wrote the object
+  // recently; this spares the getxattrs round trip
+  if (getCachedInfo(soid, layout, size))
+    return 0;
   rc = internal_get_layout_and_size(firstObjOid, layout, size);
   if (rc) {
     m_ioCtx.unlock(firstObjOid, RADOS_LOCK_NAME, *lockCookie);
@@ -894,40 +902,71 @@ int libradosstriper::RadosStriperImpl::openStripedObjectForWrite(const std::stri
   if (rc) {
     if (rc == -ENOENT) {
       // object does not exist, delegate to createEmptyStripedObject
+      // drop any stale cache entry first (the object may have been
+      // removed and is being recreated)
+      invalidateCachedInfo(soid);
       int rc = createAndOpenStripedObject(soid, layout, *size, lockCookie, isFileSizeAbsolute);
       // return original size
       *size = 0;
-      return rc; 
+      return rc;
     } else {
       return rc;
     }
   }
-  // all fine
+  // all fine. Get layout and current size, from the local cache when
+  // this striper wrote the object recently
   uint64_t curSize;
-  rc = internal_get_layout_and_size(firstObjOid, layout, &curSize);
-  if (rc) {
-    m_ioCtx.unlock(firstObjOid, RADOS_LOCK_NAME, *lockCookie);
-    lderr(cct()) << "RadosStriperImpl::openStripedObjectForWrite : "
+  bool cached = getCachedInfo(soid, layout, &curSize);
+  if (!cached) {
+    rc = internal_get_layout_and_size(firstObjOid, layout, &curSize);
+    if (rc) {
+      m_ioCtx.unlock(firstObjOid, RADOS_LOCK_NAME, *lockCookie);
+      lderr(cct()) << "RadosStriperImpl::openStripedObjectForWrite : "
 		   << "could not load layout and size for "
 		   << soid << " : rc = " << rc << dendl;
-    return rc;
+      return rc;
+    }
   }
   // atomically update object size, only if smaller than current one
-  if (!isFileSizeAbsolute)
-    *size += curSize;
-  librados::ObjectWriteOperation writeOp;
-  writeOp.cmpxattr(XATTR_SIZE, LIBRADOS_CMPXATTR_OP_GT, *size);
-  std::ostringstream oss;
-  oss << *size;
-  bufferlist bl;
-  bl.append(oss.str());
-  writeOp.setxattr(XATTR_SIZE, bl);
-  rc = m_ioCtx.operate(firstObjOid, &writeOp);
+  uint64_t sizeArg = *size;
+  while (true) {
+    uint64_t newSize = sizeArg;
+    if (!isFileSizeAbsolute)
+      newSize += curSize;
+    librados::ObjectWriteOperation writeOp;
+    writeOp.cmpxattr(XATTR_SIZE, LIBRADOS_CMPXATTR_OP_GT, newSize);
+    std::ostringstream oss;
+    oss << newSize;
+    bufferlist bl;
+    bl.append(oss.str());
+    writeOp.setxattr(XATTR_SIZE, bl);
+    rc = m_ioCtx.operate(firstObjOid, &writeOp);
+    if (-ECANCELED == rc && cached) {
+      // our cached size lost a race with another writer; refresh it
+      // from the cluster and redo the update with the actual value
+      invalidateCachedInfo(soid);
+      cached = false;
+      rc = internal_get_layout_and_size(firstObjOid, layout, &curSize);
+      if (rc) {
+	m_ioCtx.unlock(firstObjOid, RADOS_LOCK_NAME, *lockCookie);
+	lderr(cct()) << "RadosStriperImpl::openStripedObjectForWrite : "
+		     << "could not refresh layout and size for "
+		     << soid << " : rc = " << rc << dendl;
+	return rc;
+      }
+      continue;
+    }
+    if (-ECANCELED == rc) {
+      // handle case where objectsize is already bigger than size
+      rc = 0;
+      updateCachedInfo(soid, *layout, curSize);
+    } else if (rc == 0) {
+      updateCachedInfo(soid, *layout, newSize);
+    }
+    break;
+  }
   // return current size
   *size = curSize;
-  // handle case where objectsize is already bigger than size
-  if (-ECANCELED == rc) 
-    rc = 0;
   if (rc) {
     m_ioCtx.unlock(firstObjOid, RADOS_LOCK_NAME, *lockCookie);
     lderr(cct()) << "RadosStriperImpl::openStripedObjectForWrite : "
@@ -1071,3 +1110,37 @@ std::string libradosstriper::RadosStriperImpl::getUUID()
   uuid.print(suuid);
   return std::string(suuid);
 }
+
+///////////////////////// striped object info cache /////////////////////////////
+
+bool libradosstriper::RadosStriperImpl::getCachedInfo(const std::string& soid,
+						      ceph_file_layout *layout,
+						      uint64_t *size)
+{
+  Mutex::Locker l(lock);
+  std::map<std::string, StripedObjectInfo>::iterator it = m_objectCache.find(soid);
+  if (it == m_objectCache.end())
+    return false;
+  *layout = it->second.layout;
+  *size = it->second.size;
+  return true;
+}
+
+void libradosstriper::RadosStriperImpl::updateCachedInfo(const std::string& soid,
+							 const ceph_file_layout& layout,
+							 uint64_t size)
+{
+  Mutex::Locker l(lock);
+  if (m_objectCache.size() >= MAX_CACHED_OBJECTS &&
+      m_objectCache.find(soid) == m_objectCache.end())
+    m_objectCache.clear();
+  StripedObjectInfo &info = m_objectCache[soid];
+  info.layout = layout;
+  info.size = size;
+}
+
+void libradosstriper::RadosStriperImpl::invalidateCachedInfo(const std::string& soid)
+{
+  Mutex::Locker l(lock);
+  m_objectCache.erase(soid);
+}
@@ -15,6 +15,7 @@
 #ifndef CEPH_LIBRADOSSTRIPER_RADOSSTRIPERIMPL_H
 #define CEPH_LIBRADOSSTRIPER_RADOSSTRIPERIMPL_H
 
+#include <map>
 #include <string>
 
 #include "include/atomic.h"
@@ -315,6 +316,18 @@ struct libradosstriper::RadosStriperImpl {
    * creates a unique identifier
    */
   static std::string getUUID();
+
+  /**
+   * handling of the cache of layout and size of striped objects
+   * recently written by this striper (see m_objectCache)
+   */
+  bool getCachedInfo(const std::string& soid,
+		     ceph_file_layout *layout,
+		     uint64_t *size);
+  void updateCachedInfo(const std::string& soid,
+			const ceph_file_layout& layout,
+			uint64_t size);
+  void invalidateCachedInfo(const std::string& soid);
   
   CephContext *cct() {
     return (CephContext*)m_radosCluster.cct();
@@ -333,6 +346,26 @@ struct libradosstriper::RadosStriperImpl {
 
   // Default layout
   ceph_file_layout m_layout;
+
+  /**
+   * Cache of the layout and size of striped objects recently written
+   * by this striper, keyed by striped object id and guarded by 'lock'.
+   * It saves the getxattrs round trip of the open on streaming write
+   * and append workloads.  A cached size that lost a race with another
+   * writer is detected by the atomic size update of the write path and
+   * refreshed there (see openStripedObjectForWrite); reads only consult
+   * the cache, they never populate it, so a pure reader keeps seeing
+   * remote size updates.  The layout of a striped object never changes
+   * once created.
+   */
+  struct StripedObjectInfo {
+    ceph_file_layout layout;
+    uint64_t size;
+  };
+  std::map<std::string, StripedObjectInfo> m_objectCache;
+  /// bound on m_objectCache entries; the cache is dropped wholesale
+  /// when a new object would exceed it
+  static const unsigned MAX_CACHED_OBJECTS = 128;
 };
 
 #endif
@@ -26,7 +26,7 @@ namespace librbd {
 
   void AioCompletion::finish_adding_requests(CephContext *cct)
   {
-    ldout(cct, 20) << "AioCompletion::finish_adding_requests " << (void*)this << " pending " << pending_count << dendl;
+    ldout(cct, 20) << "AioCompletion::finish_adding_requests " << (void*)this << " pending " << pending_count.read() << dendl;
     unblock(cct);
   }
 
@@ -102,18 +102,19 @@ namespace librbd {
   {
     lderr(cct) << "AioCompletion::fail() " << this << ": " << cpp_strerror(r)
                << dendl;
+    assert(pending_count.read() == 1);
     lock.Lock();
-    assert(pending_count == 0);
     rval = r;
     complete(cct);
-    put_unlock();
+    lock.Unlock();
+    put();
   }
 
   void AioCompletion::complete_request(CephContext *cct, ssize_t r)
   {
     ldout(cct, 20) << "AioCompletion::complete_request() "
 		   << (void *)this << " complete_cb=" << (void *)complete_cb
-		   << " pending " << pending_count << dendl;
+		   << " pending " << pending_count.read() << dendl;
     lock.Lock();
     if (rval >= 0) {
       if (r < 0 && r != -EEXIST)
@@ -121,13 +122,17 @@ namespace librbd {
       else if (r > 0)
 	rval += r;
     }
-    assert(pending_count);
-    int count = --pending_count;
-    if (!count && blockers == 0) {
+    lock.Unlock();
+    // all other requests have decremented before us, so their rval
+    // updates are visible once we observe the count reach zero
+    assert(pending_count.read() > 0);
+    if (pending_count.dec() == 0) {
+      lock.Lock();
       finalize(cct, rval);
       complete(cct);
+      lock.Unlock();
     }
-    put_unlock();
+    put();
   }
 
   bool AioCompletion::is_complete() {
@@ -7,6 +7,7 @@
 #include "common/Mutex.h"
 #include "common/ceph_context.h"
 #include "common/perf_counters.h"
+#include "include/atomic.h"
 #include "include/Context.h"
 #include "include/utime.h"
 #include "include/rbd/librbd.hpp"
@@ -49,9 +50,11 @@ namespace librbd {
     callback_t complete_cb;
     void *complete_arg;
     rbd_completion_t rbd_comp;
-    int pending_count;   ///< number of requests
-    uint32_t blockers;
-    int ref;
+    /// number of outstanding requests plus one count per block(); the
+    /// completion fires when this reaches zero, so the request fast
+    /// path never takes the lock to account arrivals and departures
+    atomic_t pending_count;
+    atomic_t ref;
     bool released;
     ImageCtx *ictx;
     utime_t start_time;
@@ -67,7 +70,7 @@ namespace librbd {
     AioCompletion() : lock("AioCompletion::lock", true, false),
 		      done(false), rval(0), complete_cb(NULL),
 		      complete_arg(NULL), rbd_comp(NULL),
-		      pending_count(0), blockers(1),
+		      pending_count(1),  // dropped by finish_adding_requests()
 		      ref(1), released(false), ictx(NULL),
 		      aio_type(AIO_TYPE_NONE),
 		      read_bl(NULL), read_buf(NULL), read_buf_len(0) {
@@ -78,9 +81,7 @@ namespace librbd {
     int wait_for_complete();
 
     void add_request() {
-      lock.Lock();
-      pending_count++;
-      lock.Unlock();
+      pending_count.inc();
       get();
     }
 
@@ -114,40 +115,30 @@ namespace librbd {
     ssize_t get_return_value();
 
     void get() {
-      lock.Lock();
-      assert(ref > 0);
-      ref++;
-      lock.Unlock();
+      assert(ref.read() > 0);
+      ref.inc();
     }
     void release() {
-      lock.Lock();
       assert(!released);
       released = true;
-      put_unlock();
+      put();
     }
     void put() {
-      lock.Lock();
-      put_unlock();
-    }
-    void put_unlock() {
-      assert(ref > 0);
-      int n = --ref;
-      lock.Unlock();
-      if (!n)
+      assert(ref.read() > 0);
+      if (ref.dec() == 0)
 	delete this;
     }
 
     void block() {
-      Mutex::Locker l(lock);
-      ++blockers;
+      pending_count.inc();
     }
     void unblock(CephContext *cct) {
-      Mutex::Locker l(lock);
-      assert(blockers > 0);
-      --blockers;
-      if (pending_count == 0 && blockers == 0) {
-        finalize(cct, rval);
-        complete(cct);
+      assert(pending_count.read() > 0);
+      if (pending_count.dec() == 0) {
+	lock.Lock();
+	finalize(cct, rval);
+	complete(cct);
+	lock.Unlock();
       }
     }
   };
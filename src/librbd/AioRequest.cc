@@ -14,6 +14,7 @@
 
 #include "librbd/AioRequest.h"
 #include "librbd/CopyupRequest.h"
+#include "librbd/DiskReadCache.h"
 
 #include <boost/bind.hpp>
 #include <boost/optional.hpp>
@@ -389,6 +390,12 @@ namespace librbd {
     ldout(m_ictx->cct, 20) << "send " << get_write_type() << " " << this <<" "
                            << m_oid << " " << m_object_off << "~"
                            << m_object_len << dendl;
+    if (m_ictx->disk_read_cache != NULL) {
+      // zero-length ops (trim, remove) affect the whole object
+      m_ictx->disk_read_cache->invalidate(
+        m_oid, m_object_off,
+        m_object_len > 0 ? m_object_len : m_ictx->get_object_size());
+    }
     send_pre();
   }
 
@@ -512,6 +519,53 @@ namespace librbd {
     wr->set_op_flags2(m_op_flags);
   }
 
+  namespace {
+
+  // offset and length spanned by a set of scattered extents, for the
+  // AbstractWrite bookkeeping and log messages
+  uint64_t scattered_write_off(
+      const std::vector<std::pair<uint64_t, ceph::bufferlist> > &extents) {
+    assert(!extents.empty());
+    uint64_t off = extents.front().first;
+    for (std::vector<std::pair<uint64_t, ceph::bufferlist> >::const_iterator
+	   it = extents.begin(); it != extents.end(); ++it) {
+      off = MIN(off, it->first);
+    }
+    return off;
+  }
+
+  uint64_t scattered_write_len(
+      const std::vector<std::pair<uint64_t, ceph::bufferlist> > &extents) {
+    uint64_t end = 0;
+    for (std::vector<std::pair<uint64_t, ceph::bufferlist> >::const_iterator
+	   it = extents.begin(); it != extents.end(); ++it) {
+      end = MAX(end, it->first + it->second.length());
+    }
+    return end - scattered_write_off(extents);
+  }
+
+  } // anonymous namespace
+
+  AioScatteredWrite::AioScatteredWrite(ImageCtx *ictx, const std::string &oid,
+				       uint64_t object_no,
+				       const std::vector<std::pair<uint64_t, ceph::bufferlist> > &extents,
+				       const ::SnapContext &snapc,
+				       Context *completion)
+    : AbstractWrite(ictx, oid, object_no, scattered_write_off(extents),
+		    scattered_write_len(extents), snapc, completion, false),
+      m_extents(extents)
+  {
+  }
+
+  void AioScatteredWrite::add_write_ops(librados::ObjectWriteOperation *wr) {
+    if (m_ictx->enable_alloc_hint && !m_ictx->object_map.object_may_exist(m_object_no))
+      wr->set_alloc_hint(m_ictx->get_object_size(), m_ictx->get_object_size());
+    for (std::vector<std::pair<uint64_t, ceph::bufferlist> >::iterator it =
+	   m_extents.begin(); it != m_extents.end(); ++it) {
+      wr->write(it->first, it->second);
+    }
+  }
+
   void AioRemove::guard_write() {
     // do nothing to disable write guard only if deep-copyup not required
     RWLock::RLocker snap_locker(m_ictx->snap_lock);
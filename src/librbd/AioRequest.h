@@ -223,6 +223,34 @@ namespace librbd {
     int m_op_flags;
   };
 
+  /**
+   * Writes several non-overlapping extents of one object as a single
+   * librados op.  Used by the writeback handler to merge the dirty
+   * buffers of a cached object into one request.
+   */
+  class AioScatteredWrite : public AbstractWrite {
+  public:
+    AioScatteredWrite(ImageCtx *ictx, const std::string &oid,
+		      uint64_t object_no,
+		      const std::vector<std::pair<uint64_t, ceph::bufferlist> > &extents,
+		      const ::SnapContext &snapc, Context *completion);
+    virtual ~AioScatteredWrite() {}
+
+  protected:
+    virtual void add_write_ops(librados::ObjectWriteOperation *wr);
+
+    virtual const char* get_write_type() const {
+      return "scattered write";
+    }
+
+    virtual void pre_object_map_update(uint8_t *new_state) {
+      *new_state = OBJECT_EXISTS;
+    }
+
+  private:
+    std::vector<std::pair<uint64_t, ceph::bufferlist> > m_extents;
+  };
+
   class AioRemove : public AbstractWrite {
   public:
     AioRemove(ImageCtx *ictx, const std::string &oid, uint64_t object_no,
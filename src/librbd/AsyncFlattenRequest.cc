@@ -9,6 +9,8 @@
 #include "librbd/ObjectMap.h"
 #include "common/dout.h"
 #include "common/errno.h"
+#include "common/strtol.h"
+#include "include/stringify.h"
 #include <boost/lambda/bind.hpp>
 #include <boost/lambda/construct.hpp>
 
@@ -18,6 +20,11 @@
 
 namespace librbd {
 
+namespace {
+// image metadata key holding the resume position of an interrupted flatten
+const std::string FLATTEN_CHECKPOINT_KEY = ".rbd_flatten_position";
+}
+
 class AsyncFlattenObjectContext : public C_AsyncObjectThrottle {
 public:
   AsyncFlattenObjectContext(AsyncObjectThrottle &throttle, ImageCtx *image_ctx,
@@ -62,6 +69,11 @@ private:
 bool AsyncFlattenRequest::should_complete(int r) {
   CephContext *cct = m_image_ctx.cct;
   ldout(cct, 5) << this << " should_complete: " << " r=" << r << dendl;
+  if (r < 0 && m_state == STATE_CHECKPOINT) {
+    // progress checkpoints are an optimization only
+    ldout(cct, 5) << "flatten checkpoint failed: " << cpp_strerror(r) << dendl;
+    r = 0;
+  }
   if (r < 0 && !(r == -ENOENT && m_ignore_enoent) ) {
     lderr(cct) << "flatten encountered an error: " << cpp_strerror(r) << dendl;
     return true;
@@ -70,8 +82,20 @@ bool AsyncFlattenRequest::should_complete(int r) {
   switch (m_state) {
   case STATE_FLATTEN_OBJECTS:
     ldout(cct, 5) << "FLATTEN_OBJECTS" << dendl;
+    if (m_flatten_pos < m_overlap_objects) {
+      m_prog_ctx.update_progress(m_flatten_pos, m_overlap_objects);
+      return send_checkpoint();
+    }
     return send_update_header();
 
+  case STATE_CHECKPOINT:
+    ldout(cct, 5) << "CHECKPOINT" << dendl;
+    {
+      RWLock::RLocker owner_locker(m_image_ctx.owner_lock);
+      send_flatten_objects();
+    }
+    return false;
+
   case STATE_UPDATE_HEADER:
     ldout(cct, 5) << "UPDATE_HEADER" << dendl;
     return send_update_children();
@@ -93,17 +117,91 @@ void AsyncFlattenRequest::send() {
   CephContext *cct = m_image_ctx.cct;
   ldout(cct, 5) << this << " send" << dendl;
 
+  m_flatten_pos = load_checkpoint();
+  send_flatten_objects();
+}
+
+void AsyncFlattenRequest::send_flatten_objects() {
+  assert(m_image_ctx.owner_lock.is_locked());
+  CephContext *cct = m_image_ctx.cct;
+
+  uint64_t end_object_no = m_overlap_objects;
+  uint64_t checkpoint_objects =
+    m_image_ctx.cct->_conf->rbd_flatten_checkpoint_objects;
+  if (checkpoint_objects > 0 &&
+      m_flatten_pos + checkpoint_objects < m_overlap_objects) {
+    end_object_no = m_flatten_pos + checkpoint_objects;
+  }
+  ldout(cct, 5) << this << " send_flatten_objects " << m_flatten_pos << "~"
+		<< end_object_no << dendl;
+
   m_state = STATE_FLATTEN_OBJECTS;
   AsyncObjectThrottle::ContextFactory context_factory(
     boost::lambda::bind(boost::lambda::new_ptr<AsyncFlattenObjectContext>(),
       boost::lambda::_1, &m_image_ctx, m_object_size, m_snapc,
       boost::lambda::_2));
+  // only report fine-grained progress on the final chunk, where the
+  // throttle knows the true total; earlier chunks are reported when
+  // they complete
   AsyncObjectThrottle *throttle = new AsyncObjectThrottle(
-    this, m_image_ctx, context_factory, create_callback_context(), &m_prog_ctx,
-    0, m_overlap_objects);
+    this, m_image_ctx, context_factory, create_callback_context(),
+    (end_object_no == m_overlap_objects ? &m_prog_ctx : NULL),
+    m_flatten_pos, end_object_no);
+  m_flatten_pos = end_object_no;
   throttle->start_ops(m_image_ctx.concurrent_management_ops);
 }
 
+bool AsyncFlattenRequest::send_checkpoint() {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 5) << this << " send_checkpoint position=" << m_flatten_pos
+		<< dendl;
+  m_state = STATE_CHECKPOINT;
+  m_clear_checkpoint = true;
+
+  map<string, bufferlist> data;
+  data[FLATTEN_CHECKPOINT_KEY].append(stringify(m_flatten_pos));
+
+  librados::ObjectWriteOperation op;
+  cls_client::metadata_set(&op, data);
+
+  librados::AioCompletion *rados_completion = create_callback_completion();
+  int r = m_image_ctx.md_ctx.aio_operate(m_image_ctx.header_oid,
+					 rados_completion, &op);
+  assert(r == 0);
+  rados_completion->release();
+  return false;
+}
+
+uint64_t AsyncFlattenRequest::load_checkpoint() {
+  CephContext *cct = m_image_ctx.cct;
+  if (m_image_ctx.cct->_conf->rbd_flatten_checkpoint_objects == 0 ||
+      m_image_ctx.old_format) {
+    return 0;
+  }
+
+  string value;
+  int r = cls_client::metadata_get(&m_image_ctx.md_ctx, m_image_ctx.header_oid,
+				   FLATTEN_CHECKPOINT_KEY, &value);
+  if (r < 0) {
+    if (r != -ENOENT) {
+      ldout(cct, 5) << "failed to read flatten checkpoint: " << cpp_strerror(r)
+		    << dendl;
+    }
+    return 0;
+  }
+  m_clear_checkpoint = true;
+
+  string err;
+  uint64_t pos = strict_strtoll(value.c_str(), 10, &err);
+  if (!err.empty() || pos > m_overlap_objects) {
+    ldout(cct, 5) << "ignoring invalid flatten checkpoint '" << value << "'"
+		  << dendl;
+    return 0;
+  }
+  ldout(cct, 5) << "resuming flatten at object " << pos << dendl;
+  return pos;
+}
+
 bool AsyncFlattenRequest::send_update_header() {
   assert(m_image_ctx.owner_lock.is_locked());
   CephContext *cct = m_image_ctx.cct;
@@ -133,6 +231,9 @@ bool AsyncFlattenRequest::send_update_header() {
     m_image_ctx.image_watcher->assert_header_locked(&op);
   }
   cls_client::remove_parent(&op);
+  if (m_clear_checkpoint) {
+    cls_client::metadata_remove(&op, FLATTEN_CHECKPOINT_KEY);
+  }
 
   librados::AioCompletion *rados_completion = create_callback_completion();
   int r = m_image_ctx.md_ctx.aio_operate(m_image_ctx.header_oid,
@@ -20,7 +20,7 @@ public:
 		      const ::SnapContext &snapc, ProgressContext &prog_ctx)
     : AsyncRequest(image_ctx, on_finish), m_object_size(object_size),
       m_overlap_objects(overlap_objects), m_snapc(snapc), m_prog_ctx(prog_ctx),
-      m_ignore_enoent(false)
+      m_flatten_pos(0), m_clear_checkpoint(false), m_ignore_enoent(false)
   {
   }
 
@@ -39,26 +39,34 @@ private:
    * <start>
    *    |
    *    v
-   * STATE_FLATTEN_OBJECTS ---> STATE_UPDATE_HEADER . . . . .
-   *           .                         |                  .
-   *           .                         |                  .
-   *           .                         v                  .
-   *           .               STATE_UPDATE_CHILDREN        .
-   *           .                         |                  .
-   *           .                         |                  .
-   *           .                         \---> <finish> < . .
-   *           .                                   ^
-   *           .                                   .
-   *           . . . . . . . . . . . . . . . . . . .
+   * STATE_FLATTEN_OBJECTS <--> STATE_CHECKPOINT
+   *    |      .
+   *    |      .
+   *    v      .
+   * STATE_UPDATE_HEADER . . . . .
+   *    |                        .
+   *    |                        .
+   *    v                        .
+   * STATE_UPDATE_CHILDREN       .
+   *    |                        .
+   *    |                        .
+   *    \---> <finish> < . . . . .
+   *              ^
+   *              .
+   *    . . . . . .
    *
    * @endverbatim
    *
-   * The _UPDATE_CHILDREN state will be skipped if the image has one or
-   * more snapshots. The _UPDATE_HEADER state will be skipped if the
-   * image was concurrently flattened by another client.
+   * Objects are flattened in chunks; between chunks the position is
+   * checkpointed to the image metadata (STATE_CHECKPOINT) so that an
+   * interrupted flatten can resume without rescanning completed
+   * objects. The _UPDATE_CHILDREN state will be skipped if the image
+   * has one or more snapshots. The _UPDATE_HEADER state will be
+   * skipped if the image was concurrently flattened by another client.
    */
   enum State {
     STATE_FLATTEN_OBJECTS,
+    STATE_CHECKPOINT,
     STATE_UPDATE_HEADER,
     STATE_UPDATE_CHILDREN
   };
@@ -70,10 +78,16 @@ private:
   State m_state;
 
   parent_spec m_parent_spec;
+  uint64_t m_flatten_pos;
+  bool m_clear_checkpoint;
   bool m_ignore_enoent;
 
+  void send_flatten_objects();
+  bool send_checkpoint();
   bool send_update_header();
   bool send_update_children();
+
+  uint64_t load_checkpoint();
 };
 
 } // namespace librbd
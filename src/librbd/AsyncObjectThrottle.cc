@@ -2,6 +2,7 @@
 // vim: ts=8 sw=2 smarttab
 #include "librbd/AsyncObjectThrottle.h"
 #include "include/rbd/librbd.hpp"
+#include "common/perf_counters.h"
 #include "common/RWLock.h"
 #include "librbd/AsyncRequest.h"
 #include "librbd/ImageCtx.h"
@@ -25,7 +26,9 @@ AsyncObjectThrottle::AsyncObjectThrottle(const AsyncRequest* async_request,
     m_async_request(async_request), m_image_ctx(image_ctx),
     m_context_factory(context_factory), m_ctx(ctx), m_prog_ctx(prog_ctx),
     m_object_no(object_no), m_end_object_no(end_object_no), m_current_ops(0),
-    m_ret(0)
+    m_ret(0), m_concurrent_limit(0), m_max_concurrent(0),
+    m_last_latency_count(0), m_last_latency_sum_ms(0),
+    m_baseline_latency_ms(0.0)
 {
 }
 
@@ -34,6 +37,17 @@ void AsyncObjectThrottle::start_ops(uint64_t max_concurrent) {
   bool complete;
   {
     Mutex::Locker l(m_lock);
+    m_concurrent_limit = max_concurrent;
+    m_max_concurrent = max_concurrent;
+    if (m_image_ctx.perfcounter != NULL) {
+      pair<uint64_t, uint64_t> rd =
+	m_image_ctx.perfcounter->get_tavg_ms(l_librbd_rd_latency);
+      pair<uint64_t, uint64_t> wr =
+	m_image_ctx.perfcounter->get_tavg_ms(l_librbd_wr_latency);
+      m_last_latency_count = rd.first + wr.first;
+      m_last_latency_sum_ms = rd.second + wr.second;
+    }
+
     for (uint64_t i = 0; i < max_concurrent; ++i) {
       start_next_op();
       if (m_ret < 0 && m_current_ops == 0) {
@@ -58,7 +72,14 @@ void AsyncObjectThrottle::finish_op(int r) {
       m_ret = r;
     }
 
-    start_next_op();
+    adapt_concurrency();
+    while (m_current_ops < m_max_concurrent) {
+      uint64_t prev_ops = m_current_ops;
+      start_next_op();
+      if (m_current_ops == prev_ops) {
+	break;
+      }
+    }
     complete = (m_current_ops == 0);
   }
   if (complete) {
@@ -67,6 +88,47 @@ void AsyncObjectThrottle::finish_op(int r) {
   }
 }
 
+void AsyncObjectThrottle::adapt_concurrency() {
+  assert(m_lock.is_locked());
+  if (!m_image_ctx.cct->_conf->rbd_adaptive_management_ops ||
+      m_image_ctx.perfcounter == NULL) {
+    return;
+  }
+
+  pair<uint64_t, uint64_t> rd =
+    m_image_ctx.perfcounter->get_tavg_ms(l_librbd_rd_latency);
+  pair<uint64_t, uint64_t> wr =
+    m_image_ctx.perfcounter->get_tavg_ms(l_librbd_wr_latency);
+  uint64_t count = rd.first + wr.first;
+  uint64_t sum_ms = rd.second + wr.second;
+
+  uint64_t count_delta = count - m_last_latency_count;
+  uint64_t sum_delta = sum_ms - m_last_latency_sum_ms;
+  m_last_latency_count = count;
+  m_last_latency_sum_ms = sum_ms;
+
+  if (count_delta == 0) {
+    // no foreground IO completed since the last sample
+    m_max_concurrent = MIN(m_max_concurrent + 1, m_concurrent_limit);
+    return;
+  }
+
+  double avg_ms = static_cast<double>(sum_delta) / count_delta;
+  if (m_baseline_latency_ms <= 0.0) {
+    m_baseline_latency_ms = avg_ms;
+  }
+
+  double factor = m_image_ctx.cct->_conf->rbd_management_op_latency_factor;
+  if (factor > 0.0 && avg_ms > m_baseline_latency_ms * factor) {
+    // foreground latency spiked: back off hard and leave the baseline
+    // alone so we don't learn to tolerate our own interference
+    m_max_concurrent = MAX(m_max_concurrent / 2, 1);
+  } else {
+    m_baseline_latency_ms = m_baseline_latency_ms * 0.95 + avg_ms * 0.05;
+    m_max_concurrent = MIN(m_max_concurrent + 1, m_concurrent_limit);
+  }
+}
+
 void AsyncObjectThrottle::start_next_op() {
   bool done = false;
   while (!done) {
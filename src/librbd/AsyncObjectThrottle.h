@@ -65,6 +65,14 @@ private:
   uint64_t m_current_ops;
   int m_ret;
 
+  /// adaptive concurrency: scale back when foreground IO latency rises
+  uint64_t m_concurrent_limit;
+  uint64_t m_max_concurrent;
+  uint64_t m_last_latency_count;
+  uint64_t m_last_latency_sum_ms;
+  double m_baseline_latency_ms;
+
+  void adapt_concurrency();
   void start_next_op();
 };
 
@@ -14,16 +14,17 @@ namespace librbd {
 void AsyncOperation::start_op(ImageCtx &image_ctx) {
   assert(m_image_ctx == NULL);
   m_image_ctx = &image_ctx;
+  m_shard = image_ctx.get_async_op_shard(this);
 
-  ldout(m_image_ctx->cct, 20) << this << " " << __func__ << dendl; 
-  Mutex::Locker l(m_image_ctx->async_ops_lock);
-  m_image_ctx->async_ops.push_front(&m_xlist_item);
+  ldout(m_image_ctx->cct, 20) << this << " " << __func__ << dendl;
+  Mutex::Locker l(m_shard->lock);
+  m_shard->ops.push_front(&m_xlist_item);
 }
 
 void AsyncOperation::finish_op() {
   ldout(m_image_ctx->cct, 20) << this << " " << __func__ << dendl;
   {
-    Mutex::Locker l(m_image_ctx->async_ops_lock);
+    Mutex::Locker l(m_shard->lock);
     xlist<AsyncOperation *>::iterator iter(&m_xlist_item);
     ++iter;
     assert(m_xlist_item.remove_myself());
@@ -49,8 +50,8 @@ void AsyncOperation::finish_op() {
 }
 
 void AsyncOperation::add_flush_context(Context *on_finish) {
-  assert(m_image_ctx->async_ops_lock.is_locked());
+  assert(m_shard->lock.is_locked());
   m_flush_contexts.push_back(on_finish);
-} 
+}
 
 } // namespace librbd
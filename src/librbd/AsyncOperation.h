@@ -12,12 +12,13 @@ class Context;
 namespace librbd {
 
 class ImageCtx;
+struct AsyncOpShard;
 
 class AsyncOperation {
 public:
 
   AsyncOperation()
-    : m_image_ctx(NULL), m_xlist_item(this)
+    : m_image_ctx(NULL), m_shard(NULL), m_xlist_item(this)
   {
   }
 
@@ -38,6 +39,7 @@ public:
 private:
 
   ImageCtx *m_image_ctx;
+  AsyncOpShard *m_shard;
   xlist<AsyncOperation *>::item m_xlist_item;
   std::list<Context *> m_flush_contexts;
 
@@ -0,0 +1,111 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "librbd/CopyupCache.h"
+#include "common/ceph_context.h"
+#include "common/dout.h"
+
+#define dout_subsys ceph_subsys_rbd
+#undef dout_prefix
+#define dout_prefix *_dout << "librbd::CopyupCache: "
+
+namespace librbd {
+
+CopyupCache::CopyupCache(CephContext *cct)
+  : m_cct(cct), m_lock("librbd::CopyupCache::m_lock"),
+    m_max_bytes(cct->_conf->rbd_copyup_cache_max_bytes), m_bytes(0)
+{
+}
+
+CopyupCache::~CopyupCache()
+{
+  assert(m_in_flight.empty());
+}
+
+bool CopyupCache::lookup(uint64_t snap_id, uint64_t object_no,
+			 uint64_t expected_length, ceph::bufferlist *bl)
+{
+  Mutex::Locker l(m_lock);
+  std::map<Key, Entry>::iterator it =
+    m_entries.find(std::make_pair(snap_id, object_no));
+  if (it == m_entries.end()) {
+    return false;
+  }
+  if (it->second.bl.length() != expected_length) {
+    // the parent overlap changed since this block was read
+    ldout(m_cct, 10) << "stale block " << snap_id << "/" << object_no
+		     << ": " << it->second.bl.length() << " != "
+		     << expected_length << dendl;
+    m_bytes -= it->second.bl.length();
+    m_lru.erase(it->second.lru_it);
+    m_entries.erase(it);
+    return false;
+  }
+
+  *bl = it->second.bl;
+  m_lru.splice(m_lru.begin(), m_lru, it->second.lru_it);
+  ldout(m_cct, 20) << "hit " << snap_id << "/" << object_no << " "
+		   << bl->length() << " bytes" << dendl;
+  return true;
+}
+
+void CopyupCache::insert(uint64_t snap_id, uint64_t object_no,
+			 const ceph::bufferlist &bl)
+{
+  Mutex::Locker l(m_lock);
+  Key key(snap_id, object_no);
+  if (m_entries.count(key) > 0) {
+    return;
+  }
+
+  ldout(m_cct, 20) << "insert " << snap_id << "/" << object_no << " "
+		   << bl.length() << " bytes" << dendl;
+  Entry &entry = m_entries[key];
+  entry.bl = bl;
+  m_lru.push_front(key);
+  entry.lru_it = m_lru.begin();
+  m_bytes += bl.length();
+  trim();
+}
+
+bool CopyupCache::start_prefetch(uint64_t snap_id, uint64_t object_no)
+{
+  Mutex::Locker l(m_lock);
+  Key key(snap_id, object_no);
+  if (m_entries.count(key) > 0 || m_in_flight.count(key) > 0) {
+    return false;
+  }
+  m_in_flight.insert(key);
+  return true;
+}
+
+void CopyupCache::finish_prefetch(uint64_t snap_id, uint64_t object_no,
+				  const ceph::bufferlist &bl, int r)
+{
+  {
+    Mutex::Locker l(m_lock);
+    m_in_flight.erase(std::make_pair(snap_id, object_no));
+  }
+  if (r >= 0) {
+    insert(snap_id, object_no, bl);
+  } else {
+    ldout(m_cct, 10) << "prefetch of " << snap_id << "/" << object_no
+		     << " failed: " << r << dendl;
+  }
+}
+
+void CopyupCache::trim()
+{
+  assert(m_lock.is_locked());
+  while (m_bytes > m_max_bytes && !m_lru.empty()) {
+    Key key = m_lru.back();
+    std::map<Key, Entry>::iterator it = m_entries.find(key);
+    assert(it != m_entries.end());
+    ldout(m_cct, 20) << "evict " << key.first << "/" << key.second << dendl;
+    m_bytes -= it->second.bl.length();
+    m_entries.erase(it);
+    m_lru.pop_back();
+  }
+}
+
+} // namespace librbd
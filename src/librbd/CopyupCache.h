@@ -0,0 +1,72 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+#ifndef CEPH_LIBRBD_COPYUP_CACHE_H
+#define CEPH_LIBRBD_COPYUP_CACHE_H
+
+#include "include/int_types.h"
+#include "include/buffer.h"
+#include "common/Mutex.h"
+#include <list>
+#include <map>
+#include <set>
+#include <utility>
+
+class CephContext;
+
+namespace librbd {
+
+/**
+ * CopyupCache holds recently read parent object data so that a burst
+ * of copyups against the same parent snapshot reads each parent block
+ * from the OSDs only once.  A clone's parent is always a protected
+ * snapshot, so the cached data can never go stale; entries are only
+ * evicted to stay under the configured size limit (LRU).
+ *
+ * The cache also tracks in-flight prefetch reads so that overlapping
+ * copyups do not issue duplicate reads for the same parent block.
+ */
+class CopyupCache {
+public:
+  CopyupCache(CephContext *cct);
+  ~CopyupCache();
+
+  /**
+   * Look up the parent data for the given object.  expected_length
+   * guards against a parent overlap change between the prefetch and
+   * the copyup: a cached block of the wrong size is treated as a miss.
+   */
+  bool lookup(uint64_t snap_id, uint64_t object_no, uint64_t expected_length,
+	      ceph::bufferlist *bl);
+
+  void insert(uint64_t snap_id, uint64_t object_no,
+	      const ceph::bufferlist &bl);
+
+  /// reserve a prefetch slot; false if the block is already cached or
+  /// a read for it is already in flight
+  bool start_prefetch(uint64_t snap_id, uint64_t object_no);
+  void finish_prefetch(uint64_t snap_id, uint64_t object_no,
+		       const ceph::bufferlist &bl, int r);
+
+private:
+  typedef std::pair<uint64_t, uint64_t> Key;
+
+  struct Entry {
+    ceph::bufferlist bl;
+    std::list<Key>::iterator lru_it;
+  };
+
+  CephContext *m_cct;
+  Mutex m_lock;
+  uint64_t m_max_bytes;
+  uint64_t m_bytes;
+
+  std::map<Key, Entry> m_entries;
+  std::list<Key> m_lru;		///< front is most recently used
+  std::set<Key> m_in_flight;
+
+  void trim();
+};
+
+} // namespace librbd
+
+#endif // CEPH_LIBRBD_COPYUP_CACHE_H
@@ -9,10 +9,13 @@
 #include "librbd/AioCompletion.h"
 #include "librbd/AioRequest.h"
 #include "librbd/AsyncObjectThrottle.h"
+#include "librbd/CopyupCache.h"
+#include "librbd/DiskReadCache.h"
 #include "librbd/CopyupRequest.h"
 #include "librbd/ImageCtx.h"
 #include "librbd/ImageWatcher.h"
 #include "librbd/ObjectMap.h"
+#include "osdc/Striper.h"
 
 #include <boost/bind.hpp>
 #include <boost/lambda/bind.hpp>
@@ -67,6 +70,42 @@ private:
   size_t m_snap_id_idx;
 };
 
+// populates the copyup cache with the parent data for an object that
+// hasn't been copied up yet, so a subsequent copyup for it skips the
+// parent read entirely
+class C_CopyupPrefetch : public Context {
+public:
+  C_CopyupPrefetch(ImageCtx *ictx, uint64_t snap_id, uint64_t object_no,
+                   const vector<pair<uint64_t,uint64_t> > &image_extents)
+    : m_ictx(ictx), m_snap_id(snap_id), m_object_no(object_no),
+      m_image_extents(image_extents)
+  {
+    m_async_op.start_op(*m_ictx);
+  }
+
+  virtual ~C_CopyupPrefetch() {
+    m_async_op.finish_op();
+  }
+
+  void send() {
+    AioCompletion *comp = aio_create_completion_internal(this, rbd_ctx_cb);
+    aio_read(m_ictx->parent, m_image_extents, NULL, &m_bl, comp, 0);
+  }
+
+protected:
+  virtual void finish(int r) {
+    m_ictx->copyup_cache->finish_prefetch(m_snap_id, m_object_no, m_bl, r);
+  }
+
+private:
+  ImageCtx *m_ictx;
+  uint64_t m_snap_id;
+  uint64_t m_object_no;
+  vector<pair<uint64_t,uint64_t> > m_image_extents;
+  ceph::bufferlist m_bl;
+  AsyncOperation m_async_op;
+};
+
 } // anonymous namespace
 
 
@@ -74,7 +113,8 @@ private:
                                uint64_t objectno,
 			       vector<pair<uint64_t,uint64_t> >& image_extents)
     : m_ictx(ictx), m_oid(oid), m_object_no(objectno),
-      m_image_extents(image_extents), m_state(STATE_READ_FROM_PARENT)
+      m_image_extents(image_extents), m_parent_snap_id(CEPH_NOSNAP),
+      m_read_from_cache(false), m_state(STATE_READ_FROM_PARENT)
   {
     m_async_op.start_op(*m_ictx);
   }
@@ -113,6 +153,10 @@ private:
 			   << ": oid " << m_oid << dendl;
     m_state = STATE_COPYUP;
 
+    if (m_ictx->disk_read_cache != NULL) {
+      m_ictx->disk_read_cache->invalidate(m_oid, 0, m_ictx->get_object_size());
+    }
+
     m_ictx->snap_lock.get_read();
     ::SnapContext snapc = m_ictx->snapc;
     m_ictx->snap_lock.put_read();
@@ -177,6 +221,29 @@ private:
   void CopyupRequest::send()
   {
     m_state = STATE_READ_FROM_PARENT;
+    m_parent_snap_id = m_ictx->parent->snap_id;
+
+    if (m_ictx->copyup_cache != NULL) {
+      uint64_t len = 0;
+      for (vector<pair<uint64_t,uint64_t> >::iterator it =
+             m_image_extents.begin();
+           it != m_image_extents.end(); ++it) {
+        len += it->second;
+      }
+      if (len > 0 &&
+          m_ictx->copyup_cache->lookup(m_parent_snap_id, m_object_no, len,
+                                       &m_copyup_data)) {
+        ldout(m_ictx->cct, 20) << __func__ << " " << this
+                               << ": oid " << m_oid
+                               << ": parent data found in copyup cache"
+                               << dendl;
+        m_read_from_cache = true;
+        prefetch_parent();
+        m_ictx->op_work_queue->queue(create_callback_context(), 0);
+        return;
+      }
+    }
+
     AioCompletion *comp = aio_create_completion_internal(
       create_callback_context(), rbd_ctx_cb);
 
@@ -186,6 +253,62 @@ private:
                            << ", extents " << m_image_extents
                            << dendl;
     aio_read(m_ictx->parent, m_image_extents, NULL, &m_copyup_data, comp, 0);
+    prefetch_parent();
+  }
+
+  void CopyupRequest::prefetch_parent()
+  {
+    if (m_ictx->copyup_cache == NULL) {
+      return;
+    }
+
+    int readahead = m_ictx->cct->_conf->rbd_copyup_readahead_objects;
+    for (int i = 1; i <= readahead; ++i) {
+      uint64_t object_no = m_object_no + i;
+      {
+        Mutex::Locker l(m_ictx->copyup_list_lock);
+        if (m_ictx->copyup_list.count(object_no) > 0) {
+          // a copyup for this object already has its own parent read
+          continue;
+        }
+      }
+
+      vector<pair<uint64_t,uint64_t> > image_extents;
+      Striper::extent_to_file(m_ictx->cct, &m_ictx->layout, object_no, 0,
+                              m_ictx->layout.fl_object_size, image_extents);
+      {
+        RWLock::RLocker snap_locker(m_ictx->snap_lock);
+        RWLock::RLocker parent_locker(m_ictx->parent_lock);
+        uint64_t parent_overlap = 0;
+        int r = m_ictx->get_parent_overlap(m_ictx->snap_id, &parent_overlap);
+        if (r < 0 ||
+            m_ictx->prune_parent_extents(image_extents, parent_overlap) == 0) {
+          // past the end of the parent overlap
+          break;
+        }
+
+        if (m_ictx->object_map.enabled()) {
+          RWLock::RLocker object_map_locker(m_ictx->object_map_lock);
+          if (m_ictx->object_map[object_no] != OBJECT_NONEXISTENT) {
+            // the child object already exists, so no copyup is coming
+            continue;
+          }
+        }
+      }
+
+      if (!m_ictx->copyup_cache->start_prefetch(m_parent_snap_id, object_no)) {
+        continue;
+      }
+
+      ldout(m_ictx->cct, 20) << __func__ << " " << this << ": prefetching "
+                             << "parent data for object " << object_no
+                             << dendl;
+      C_CopyupPrefetch *prefetch = new C_CopyupPrefetch(m_ictx,
+                                                        m_parent_snap_id,
+                                                        object_no,
+                                                        image_extents);
+      prefetch->send();
+    }
   }
 
   void CopyupRequest::queue_send()
@@ -222,6 +345,11 @@ private:
       ldout(cct, 20) << "READ_FROM_PARENT" << dendl;
       remove_from_list();
       if (r >= 0 || r == -ENOENT) {
+        if (r >= 0 && !m_read_from_cache && m_ictx->copyup_cache != NULL &&
+            m_copyup_data.length() > 0) {
+          m_ictx->copyup_cache->insert(m_parent_snap_id, m_object_no,
+                                       m_copyup_data);
+        }
         return send_object_map();
       }
       break;
@@ -63,6 +63,8 @@ namespace librbd {
     std::string m_oid;
     uint64_t m_object_no;
     vector<pair<uint64_t,uint64_t> > m_image_extents;
+    uint64_t m_parent_snap_id;
+    bool m_read_from_cache;
     State m_state;
     ceph::bufferlist m_copyup_data;
     vector<AioRequest *> m_pending_requests;
@@ -79,6 +81,8 @@ namespace librbd {
 
     void remove_from_list();
 
+    void prefetch_parent();
+
     bool send_object_map();
     bool send_copyup();
 
@@ -296,7 +296,9 @@ int DiffIterate::execute() {
 
   int r;
   bool fast_diff_enabled = false;
+  bool object_map_prune_enabled = false;
   BitVector<2> object_diff_state;
+  BitVector<2> object_may_exist;
   {
     RWLock::RLocker snap_locker(m_image_ctx.snap_lock);
     if (m_whole_object && (m_image_ctx.features & RBD_FEATURE_FAST_DIFF) != 0) {
@@ -308,6 +310,19 @@ int DiffIterate::execute() {
         fast_diff_enabled = true;
       }
     }
+    if (!fast_diff_enabled &&
+        (m_image_ctx.features & RBD_FEATURE_OBJECT_MAP) != 0) {
+      // even without (a valid) fast-diff, the object maps tell us which
+      // objects never existed anywhere in the snap range, so those can
+      // be skipped without listing their snaps
+      r = map_object_existence(from_snap_id, end_snap_id, &object_may_exist);
+      if (r < 0) {
+        ldout(cct, 5) << "object map pruning disabled" << dendl;
+      } else {
+        ldout(cct, 5) << "object map pruning enabled" << dendl;
+        object_map_prune_enabled = true;
+      }
+    }
   }
 
   // we must list snaps via the head, not end snap
@@ -373,11 +388,22 @@ int DiffIterate::execute() {
           }
         }
       } else {
+        const uint64_t object_no = p->second.front().objectno;
         C_DiffObject *diff_object = new C_DiffObject(m_image_ctx, head_ctx,
                                                      diff_context,
                                                      p->first.name, off,
                                                      p->second);
-        diff_object->send();
+        if (object_map_prune_enabled &&
+            (object_no >= object_may_exist.size() ||
+             object_may_exist[object_no] == 0)) {
+          // the object maps show the object never existed within the
+          // snap range, so list_snaps would return ENOENT; complete the
+          // request locally (reporting any parent overlap) without a
+          // round trip to the OSD
+          diff_object->complete(-ENOENT);
+        } else {
+          diff_object->send();
+        }
 
         r = diff_context.invoke_callback();
         if (r < 0) {
@@ -511,6 +537,91 @@ int DiffIterate::diff_object_map(uint64_t from_snap_id, uint64_t to_snap_id,
   return 0;
 }
 
+int DiffIterate::map_object_existence(uint64_t from_snap_id,
+                                      uint64_t to_snap_id,
+                                      BitVector<2>* object_may_exist) {
+  assert(m_image_ctx.snap_lock.is_locked());
+  CephContext* cct = m_image_ctx.cct;
+
+  if (from_snap_id == 0) {
+    if (!m_image_ctx.snaps.empty()) {
+      from_snap_id = m_image_ctx.snaps.back();
+    } else {
+      from_snap_id = CEPH_NOSNAP;
+    }
+  }
+
+  object_may_exist->clear();
+  int r;
+  uint64_t current_snap_id = from_snap_id;
+  uint64_t next_snap_id = to_snap_id;
+  while (true) {
+    uint64_t current_size = m_image_ctx.size;
+    if (current_snap_id != CEPH_NOSNAP) {
+      std::map<librados::snap_t, SnapInfo>::const_iterator snap_it =
+        m_image_ctx.snap_info.find(current_snap_id);
+      assert(snap_it != m_image_ctx.snap_info.end());
+      current_size = snap_it->second.size;
+
+      ++snap_it;
+      if (snap_it != m_image_ctx.snap_info.end()) {
+        next_snap_id = snap_it->first;
+      } else {
+        next_snap_id = CEPH_NOSNAP;
+      }
+    }
+
+    uint64_t flags;
+    r = m_image_ctx.get_flags(current_snap_id, &flags);
+    if (r < 0) {
+      lderr(cct) << "map_object_existence: failed to retrieve image flags"
+                 << dendl;
+      return r;
+    }
+    if ((flags & RBD_FLAG_OBJECT_MAP_INVALID) != 0) {
+      ldout(cct, 1) << "map_object_existence: cannot prune with an invalid "
+                    << "object map" << dendl;
+      return -EINVAL;
+    }
+
+    BitVector<2> object_map;
+    std::string oid(ObjectMap::object_map_name(m_image_ctx.id,
+                                               current_snap_id));
+    r = cls_client::object_map_load(&m_image_ctx.md_ctx, oid, &object_map);
+    if (r < 0) {
+      lderr(cct) << "map_object_existence: failed to load object map " << oid
+                 << dendl;
+      return r;
+    }
+    ldout(cct, 20) << "map_object_existence: loaded object map " << oid
+                   << dendl;
+
+    uint64_t num_objs = Striper::get_num_objects(m_image_ctx.layout,
+                                                 current_size);
+    if (object_map.size() < num_objs) {
+      ldout(cct, 1) << "map_object_existence: object map too small: "
+                    << object_map.size() << " < " << num_objs << dendl;
+      return -EINVAL;
+    }
+    object_map.resize(num_objs);
+
+    if (object_may_exist->size() < object_map.size()) {
+      object_may_exist->resize(object_map.size());
+    }
+    for (uint64_t i = 0; i < object_map.size(); ++i) {
+      if (object_map[i] != OBJECT_NONEXISTENT) {
+        (*object_may_exist)[i] = 1;
+      }
+    }
+
+    if (current_snap_id == next_snap_id || next_snap_id > to_snap_id) {
+      break;
+    }
+    current_snap_id = next_snap_id;
+  }
+  return 0;
+}
+
 int DiffIterate::simple_diff_cb(uint64_t off, size_t len, int exists,
                                 void *arg) {
   // This reads the existing extents in a parent from the beginning
@@ -38,6 +38,8 @@ private:
 
   int diff_object_map(uint64_t from_snap_id, uint64_t to_snap_id,
                       BitVector<2>* object_diff_state);
+  int map_object_existence(uint64_t from_snap_id, uint64_t to_snap_id,
+                           BitVector<2>* object_may_exist);
 
   static int simple_diff_cb(uint64_t off, size_t len, int exists, void *arg);
 };
@@ -0,0 +1,263 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "librbd/DiskReadCache.h"
+#include "common/ceph_context.h"
+#include "common/config.h"
+#include "common/dout.h"
+#include "common/errno.h"
+#include "include/ceph_hash.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define dout_subsys ceph_subsys_rbd
+#undef dout_prefix
+#define dout_prefix *_dout << "librbd::DiskReadCache: "
+
+namespace librbd {
+
+namespace {
+const char HEADER_MAGIC[8] = {'R', 'B', 'D', 'D', 'R', 'C', '1', '\0'};
+const uint64_t HEADER_SIZE = 4096;
+const size_t MAX_OID_LEN = 103;
+}
+
+struct DiskReadCache::Header {
+  char magic[8];
+  uint64_t block_size;
+  uint64_t num_slots;
+  uint64_t generation;
+};
+
+struct DiskReadCache::Slot {
+  uint32_t valid;
+  uint32_t valid_len;	///< bytes valid from the start of the block
+  uint64_t snap_id;
+  uint64_t block_no;
+  char oid[MAX_OID_LEN + 1];
+};
+
+DiskReadCache::DiskReadCache(CephContext *cct)
+  : m_cct(cct), m_lock("librbd::DiskReadCache::m_lock"), m_fd(-1),
+    m_map(NULL), m_map_len(0), m_block_size(0), m_num_slots(0), m_data_off(0),
+    m_write_seq(0)
+{
+}
+
+DiskReadCache::~DiskReadCache() {
+  if (m_map != NULL) {
+    ::munmap(m_map, m_map_len);
+  }
+  if (m_fd >= 0) {
+    ::close(m_fd);
+  }
+}
+
+int DiskReadCache::open(const std::string &path, uint64_t expected_generation,
+			uint64_t new_generation) {
+  m_block_size = m_cct->_conf->rbd_persistent_read_cache_block_size;
+  uint64_t cache_size = m_cct->_conf->rbd_persistent_read_cache_size;
+  if (m_block_size == 0 || cache_size < m_block_size) {
+    return -EINVAL;
+  }
+  m_num_slots = cache_size / m_block_size;
+  m_map_len = HEADER_SIZE + m_num_slots * sizeof(Slot);
+  m_data_off = m_map_len;
+
+  m_fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0600);
+  if (m_fd < 0) {
+    return -errno;
+  }
+
+  uint64_t total_size = m_data_off + m_num_slots * m_block_size;
+  struct stat st;
+  if (::fstat(m_fd, &st) < 0) {
+    return -errno;
+  }
+  bool existed = (static_cast<uint64_t>(st.st_size) == total_size);
+  if (!existed && ::ftruncate(m_fd, total_size) < 0) {
+    return -errno;
+  }
+
+  void *addr = ::mmap(NULL, m_map_len, PROT_READ | PROT_WRITE, MAP_SHARED,
+		      m_fd, 0);
+  if (addr == MAP_FAILED) {
+    return -errno;
+  }
+  m_map = static_cast<char *>(addr);
+
+  Header *header = reinterpret_cast<Header *>(m_map);
+  if (!existed ||
+      memcmp(header->magic, HEADER_MAGIC, sizeof(HEADER_MAGIC)) != 0 ||
+      header->block_size != m_block_size ||
+      header->num_slots != m_num_slots ||
+      header->generation != expected_generation) {
+    ldout(m_cct, 5) << "cold start: resetting " << path << dendl;
+    int r = reset(new_generation);
+    if (r < 0) {
+      return r;
+    }
+  } else {
+    ldout(m_cct, 5) << "warm start: " << path << " generation "
+		    << expected_generation << dendl;
+    header->generation = new_generation;
+  }
+  return 0;
+}
+
+int DiskReadCache::reset(uint64_t generation) {
+  memset(m_map, 0, m_map_len);
+
+  Header *header = reinterpret_cast<Header *>(m_map);
+  memcpy(header->magic, HEADER_MAGIC, sizeof(HEADER_MAGIC));
+  header->block_size = m_block_size;
+  header->num_slots = m_num_slots;
+  header->generation = generation;
+  if (::msync(m_map, m_map_len, MS_SYNC) < 0) {
+    return -errno;
+  }
+  return 0;
+}
+
+DiskReadCache::Slot *DiskReadCache::slot_at(uint64_t slot_no) {
+  return reinterpret_cast<Slot *>(m_map + HEADER_SIZE +
+				  slot_no * sizeof(Slot));
+}
+
+uint64_t DiskReadCache::slot_for(const std::string &oid, uint64_t snap_id,
+				 uint64_t block_no) {
+  uint64_t h = ceph_str_hash_rjenkins(oid.c_str(), oid.length());
+  h ^= block_no * 2654435761ull;
+  h ^= snap_id * 0x9e3779b97f4a7c15ull;
+  return h % m_num_slots;
+}
+
+bool DiskReadCache::lookup(const std::string &oid, uint64_t snap_id,
+			   uint64_t off, uint64_t len,
+			   ceph::bufferlist *pbl) {
+  if (len == 0 || oid.length() > MAX_OID_LEN) {
+    return false;
+  }
+
+  Mutex::Locker locker(m_lock);
+  ceph::bufferlist bl;
+  uint64_t pos = off;
+  uint64_t end = off + len;
+  while (pos < end) {
+    uint64_t block_no = pos / m_block_size;
+    uint64_t block_off = pos - block_no * m_block_size;
+    uint64_t seg_len = MIN(end - pos, m_block_size - block_off);
+
+    Slot *slot = slot_at(slot_for(oid, snap_id, block_no));
+    if (slot->valid == 0 || slot->block_no != block_no ||
+	slot->snap_id != snap_id || strcmp(slot->oid, oid.c_str()) != 0 ||
+	block_off + seg_len > slot->valid_len) {
+      return false;
+    }
+
+    ceph::bufferptr bp = ceph::buffer::create(seg_len);
+    ssize_t r = ::pread(m_fd, bp.c_str(), seg_len,
+			m_data_off +
+			(slot - slot_at(0)) * m_block_size + block_off);
+    if (r != static_cast<ssize_t>(seg_len)) {
+      return false;
+    }
+    bl.append(bp);
+    pos += seg_len;
+  }
+
+  pbl->claim(bl);
+  ldout(m_cct, 20) << "hit " << oid << " " << off << "~" << len << dendl;
+  return true;
+}
+
+void DiskReadCache::insert(const std::string &oid, uint64_t snap_id,
+			   uint64_t off, const ceph::bufferlist &bl,
+			   uint64_t read_seq) {
+  if (bl.length() == 0 || oid.length() > MAX_OID_LEN) {
+    return;
+  }
+
+  Mutex::Locker locker(m_lock);
+  if (snap_id == CEPH_NOSNAP) {
+    // drop the data if the object was written while the read was in
+    // flight -- the read may predate the write
+    std::map<std::string, uint64_t>::iterator it = m_oid_write_seq.find(oid);
+    if (it != m_oid_write_seq.end() && it->second > read_seq) {
+      ldout(m_cct, 20) << "skipping insert of " << oid
+		       << ": raced with write" << dendl;
+      return;
+    }
+  }
+
+  uint64_t end = off + bl.length();
+  uint64_t block_no = off / m_block_size;
+  if (block_no * m_block_size < off) {
+    ++block_no;	// only cache blocks whose start was read
+  }
+  for (; block_no * m_block_size < end; ++block_no) {
+    uint64_t block_start = block_no * m_block_size;
+    uint32_t seg_len = MIN(end - block_start, m_block_size);
+
+    uint64_t slot_no = slot_for(oid, snap_id, block_no);
+    Slot *slot = slot_at(slot_no);
+    if (slot->valid != 0 && slot->block_no == block_no &&
+	slot->snap_id == snap_id && strcmp(slot->oid, oid.c_str()) == 0 &&
+	slot->valid_len >= seg_len) {
+      continue;
+    }
+
+    // invalidate the slot before touching its data so a crash cannot
+    // leave a stale key pointing at new bytes
+    slot->valid = 0;
+
+    ceph::bufferlist seg;
+    seg.substr_of(bl, block_start - off, seg_len);
+    ssize_t r = ::pwrite(m_fd, seg.c_str(), seg_len,
+			 m_data_off + slot_no * m_block_size);
+    if (r != static_cast<ssize_t>(seg_len)) {
+      continue;
+    }
+
+    strncpy(slot->oid, oid.c_str(), sizeof(slot->oid));
+    slot->snap_id = snap_id;
+    slot->block_no = block_no;
+    slot->valid_len = seg_len;
+    slot->valid = 1;
+    ldout(m_cct, 20) << "insert " << oid << " block " << block_no << "~"
+		     << seg_len << dendl;
+  }
+}
+
+void DiskReadCache::invalidate(const std::string &oid, uint64_t off,
+			       uint64_t len) {
+  if (oid.length() > MAX_OID_LEN) {
+    return;
+  }
+
+  Mutex::Locker locker(m_lock);
+  m_oid_write_seq[oid] = ++m_write_seq;
+
+  uint64_t end = off + len;
+  for (uint64_t block_no = off / m_block_size;
+       block_no * m_block_size < end; ++block_no) {
+    Slot *slot = slot_at(slot_for(oid, CEPH_NOSNAP, block_no));
+    if (slot->valid != 0 && slot->block_no == block_no &&
+	slot->snap_id == CEPH_NOSNAP &&
+	strcmp(slot->oid, oid.c_str()) == 0) {
+      slot->valid = 0;
+    }
+  }
+}
+
+uint64_t DiskReadCache::get_read_seq() {
+  Mutex::Locker locker(m_lock);
+  return m_write_seq;
+}
+
+} // namespace librbd
@@ -0,0 +1,78 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+#ifndef CEPH_LIBRBD_DISK_READ_CACHE_H
+#define CEPH_LIBRBD_DISK_READ_CACHE_H
+
+#include "include/int_types.h"
+#include "include/buffer.h"
+#include "common/Mutex.h"
+#include <map>
+#include <string>
+
+class CephContext;
+
+namespace librbd {
+
+/**
+ * DiskReadCache spills clean blocks read from the cluster to a local
+ * file so a restarted client can serve warm reads without re-reading
+ * the OSDs.  It sits underneath the ObjectCacher, hooked into the
+ * LibrbdWriteback read path.
+ *
+ * The cache file is a direct-mapped, block-granular cache: a small
+ * mmap'd index of fixed-size slot records followed by one data block
+ * per slot.  Keys are (object name, snap id, block number).  Entries
+ * are written invalid-first so a crash can only lose blocks, never
+ * corrupt them.
+ *
+ * Staleness across restarts is handled by a generation number stored
+ * both in the image metadata and in the cache file header: every
+ * writable open bumps the cluster-side generation, so a cache file
+ * populated before some other client wrote the image fails the
+ * generation check and is discarded.  Within a session, writes bump a
+ * per-object sequence number and reads only insert their data if no
+ * write to the object was issued while they were in flight.
+ */
+class DiskReadCache {
+public:
+  DiskReadCache(CephContext *cct);
+  ~DiskReadCache();
+
+  int open(const std::string &path, uint64_t expected_generation,
+	   uint64_t new_generation);
+
+  bool lookup(const std::string &oid, uint64_t snap_id, uint64_t off,
+	      uint64_t len, ceph::bufferlist *pbl);
+  void insert(const std::string &oid, uint64_t snap_id, uint64_t off,
+	      const ceph::bufferlist &bl, uint64_t read_seq);
+  void invalidate(const std::string &oid, uint64_t off, uint64_t len);
+
+  /// sequence number to capture before issuing a cluster read
+  uint64_t get_read_seq();
+
+private:
+  struct Header;
+  struct Slot;
+
+  CephContext *m_cct;
+  Mutex m_lock;
+  int m_fd;
+  char *m_map;
+  size_t m_map_len;
+  uint64_t m_block_size;
+  uint64_t m_num_slots;
+  uint64_t m_data_off;
+
+  /// advanced whenever a write is issued; guards racing read inserts
+  uint64_t m_write_seq;
+  std::map<std::string, uint64_t> m_oid_write_seq;
+
+  Slot *slot_at(uint64_t slot_no);
+  uint64_t slot_for(const std::string &oid, uint64_t snap_id,
+		    uint64_t block_no);
+  int reset(uint64_t generation);
+};
+
+} // namespace librbd
+
+#endif // CEPH_LIBRBD_DISK_READ_CACHE_H
@@ -8,14 +8,19 @@
 #include "common/dout.h"
 #include "common/errno.h"
 #include "common/perf_counters.h"
+#include "common/strtol.h"
+#include "include/stringify.h"
 
 #include "librbd/AsyncOperation.h"
 #include "librbd/AsyncRequest.h"
 #include "librbd/AsyncResizeRequest.h"
+#include "librbd/CopyupCache.h"
+#include "librbd/DiskReadCache.h"
 #include "librbd/internal.h"
 #include "librbd/ImageCtx.h"
 #include "librbd/ImageWatcher.h"
 #include "librbd/ObjectMap.h"
+#include "librbd/WriteCoalescer.h"
 
 #include <boost/bind.hpp>
 
@@ -83,7 +88,9 @@ public:
       stripe_unit(0), stripe_count(0), flags(0),
       object_cacher(NULL), writeback_handler(NULL), object_set(NULL),
       readahead(),
-      total_bytes_read(0), copyup_finisher(NULL),
+      total_bytes_read(0),
+      write_coalescer(NULL), copyup_finisher(NULL), copyup_cache(NULL),
+      disk_read_cache(NULL),
       object_map(*this), aio_work_queue(NULL), op_work_queue(NULL)
   {
     md_ctx.dup(p);
@@ -94,6 +101,8 @@ public:
     memset(&header, 0, sizeof(header));
     memset(&layout, 0, sizeof(layout));
 
+    snapc_ref.reset(new ::SnapContext());
+
     ThreadPoolSingleton *thread_pool_singleton;
     cct->lookup_or_create_singleton_object<ThreadPoolSingleton>(
       thread_pool_singleton, "librbd::thread_pool");
@@ -119,10 +128,22 @@ public:
       delete object_set;
       object_set = NULL;
     }
+    if (write_coalescer != NULL) {
+      delete write_coalescer;
+      write_coalescer = NULL;
+    }
     if (copyup_finisher != NULL) {
       delete copyup_finisher;
       copyup_finisher = NULL;
     }
+    if (copyup_cache != NULL) {
+      delete copyup_cache;
+      copyup_cache = NULL;
+    }
+    if (disk_read_cache != NULL) {
+      delete disk_read_cache;
+      disk_read_cache = NULL;
+    }
     delete[] format_string;
 
     delete op_work_queue;
@@ -221,6 +242,8 @@ public:
       object_set = new ObjectCacher::ObjectSet(NULL, data_ctx.get_id(), 0);
       object_set->return_enoent = true;
       object_cacher->start();
+    } else if (!read_only && cct->_conf->rbd_coalesce_writes) {
+      write_coalescer = new WriteCoalescer(this);
     }
 
     if (clone_copy_on_read) {
@@ -228,12 +251,73 @@ public:
       copyup_finisher->start();
     }
 
+    if (!read_only && cct->_conf->rbd_copyup_cache_max_bytes > 0) {
+      copyup_cache = new CopyupCache(cct);
+    }
+
+    if (object_cacher != NULL &&
+	cct->_conf->rbd_persistent_read_cache_path.length() > 0) {
+      init_disk_read_cache();
+    }
+
     readahead.set_trigger_requests(readahead_trigger_requests);
     readahead.set_max_readahead_size(readahead_max_bytes);
+    readahead.set_max_streams(readahead_max_streams);
 
     return 0;
   }
 
+  void ImageCtx::init_disk_read_cache()
+  {
+    // a persisted cache is only valid if no other client opened the
+    // image for write since it was populated; track that with a
+    // generation number in the image metadata.  every writable open
+    // bumps the generation, so a cache file left behind by an older
+    // opener fails the check and starts cold.
+    static const std::string gen_key = ".rbd_read_cache_generation";
+
+    uint64_t gen = 0;
+    string value;
+    int r = cls_client::metadata_get(&md_ctx, header_oid, gen_key, &value);
+    if (r == 0) {
+      string err;
+      gen = strict_strtoll(value.c_str(), 10, &err);
+      if (!err.empty()) {
+	gen = 0;
+      }
+    } else if (r != -ENOENT) {
+      ldout(cct, 5) << "disk read cache disabled: cannot read generation: "
+		    << cpp_strerror(r) << dendl;
+      return;
+    }
+
+    uint64_t new_gen = gen;
+    if (!read_only) {
+      new_gen = gen + 1;
+      map<string, bufferlist> data;
+      data[gen_key].append(stringify(new_gen));
+      r = cls_client::metadata_set(&md_ctx, header_oid, data);
+      if (r < 0) {
+	ldout(cct, 5) << "disk read cache disabled: cannot update generation: "
+		      << cpp_strerror(r) << dendl;
+	return;
+      }
+    }
+
+    string path = string(cct->_conf->rbd_persistent_read_cache_path) +
+      "/rbd_" + stringify(data_ctx.get_id()) + "_" +
+      (id.empty() ? name : id) + ".cache";
+    DiskReadCache *cache = new DiskReadCache(cct);
+    r = cache->open(path, gen, new_gen);
+    if (r < 0) {
+      lderr(cct) << "failed to open disk read cache " << path << ": "
+		 << cpp_strerror(r) << dendl;
+      delete cache;
+      return;
+    }
+    disk_read_cache = cache;
+  }
+
   void ImageCtx::init_layout()
   {
     if (stripe_unit == 0 || stripe_count == 0) {
@@ -775,6 +859,11 @@ public:
     return len;
   }
 
+  void ImageCtx::refresh_snapc_ref() {
+    assert(snap_lock.is_wlocked());
+    snapc_ref.reset(new ::SnapContext(snapc));
+  }
+
   void ImageCtx::flush_async_operations() {
     C_SaferCond ctx;
     flush_async_operations(&ctx);
@@ -782,15 +871,30 @@ public:
   }
 
   void ImageCtx::flush_async_operations(Context *on_finish) {
-    Mutex::Locker l(async_ops_lock);
-    if (async_ops.empty()) {
-      op_work_queue->queue(on_finish, 0);
-      return;
+    if (write_coalescer != NULL) {
+      // make sure buffered writes are submitted so the ops we are
+      // about to wait on can make progress
+      write_coalescer->schedule_flush();
     }
 
-    ldout(cct, 20) << "flush async operations: " << on_finish << " "
-                   << "count=" << async_ops.size() << dendl;
-    async_ops.front()->add_flush_context(on_finish);
+    // attach a sub-context to the newest op of every shard; each shard
+    // list is ordered, so draining its newest op drains the whole shard
+    C_GatherBuilder gather_ctx(cct, on_finish);
+    for (int i = 0; i < ASYNC_OP_SHARDS; ++i) {
+      AsyncOpShard &shard = async_op_shards[i];
+      Mutex::Locker l(shard.lock);
+      if (!shard.ops.empty()) {
+	ldout(cct, 20) << "flush async operations: " << on_finish << " "
+		       << "shard=" << i << " count=" << shard.ops.size()
+		       << dendl;
+	shard.ops.front()->add_flush_context(gather_ctx.new_sub());
+      }
+    }
+    if (gather_ctx.has_subs()) {
+      gather_ctx.activate();
+    } else {
+      op_work_queue->queue(on_finish, 0);
+    }
   }
 
   void ImageCtx::cancel_async_requests() {
@@ -852,6 +956,7 @@ public:
         "rbd_readahead_trigger_requests", false)(
         "rbd_readahead_max_bytes", false)(
         "rbd_readahead_disable_after_bytes", false)(
+        "rbd_readahead_max_streams", false)(
         "rbd_clone_copy_on_read", false)(
         "rbd_blacklist_on_break_lock", false)(
         "rbd_blacklist_expire_seconds", false)(
@@ -918,6 +1023,7 @@ public:
     ASSIGN_OPTION(readahead_trigger_requests);
     ASSIGN_OPTION(readahead_max_bytes);
     ASSIGN_OPTION(readahead_disable_after_bytes);
+    ASSIGN_OPTION(readahead_max_streams);
     ASSIGN_OPTION(clone_copy_on_read);
     ASSIGN_OPTION(blacklist_on_break_lock);
     ASSIGN_OPTION(blacklist_expire_seconds);
@@ -19,6 +19,7 @@
 #include "common/WorkQueue.h"
 #include "include/atomic.h"
 #include "include/buffer.h"
+#include "include/memory.h"
 #include "include/rbd/librbd.hpp"
 #include "include/rbd_types.h"
 #include "include/types.h"
@@ -40,8 +41,22 @@ namespace librbd {
   class AsyncOperation;
   class AsyncRequest;
   class AsyncResizeRequest;
+  class CopyupCache;
+  class DiskReadCache;
   class CopyupRequest;
   class ImageWatcher;
+  class WriteCoalescer;
+
+  /**
+   * In-flight async ops are tracked in a set of shards, each with its
+   * own lock, so a high-iops workload does not serialize every op
+   * start/finish on a single list; a flush gathers across all shards.
+   */
+  struct AsyncOpShard {
+    Mutex lock;
+    xlist<AsyncOperation*> ops;
+    AsyncOpShard() : lock("librbd::AsyncOpShard::lock") {}
+  };
 
   struct ImageCtx {
     CephContext *cct;
@@ -50,6 +65,12 @@ namespace librbd {
     ::SnapContext snapc;
     std::vector<librados::snap_t> snaps; // this mirrors snapc.snaps, but is in
                                         // a format librados can understand
+    ceph::shared_ptr<const ::SnapContext> snapc_ref; // immutable copy of snapc,
+                                        // replaced (never modified in place)
+                                        // under snap_lock; the IO paths capture
+                                        // the snap context with one pointer
+                                        // grab instead of copying the vector
+                                        // per request
     std::map<librados::snap_t, SnapInfo> snap_info;
     std::map<std::string, librados::snap_t> snap_ids;
     uint64_t snap_id;
@@ -91,7 +112,7 @@ namespace librbd {
     RWLock parent_lock; // protects parent_md and parent
     Mutex refresh_lock; // protects refresh_seq and last_refresh
     RWLock object_map_lock; // protects object map updates and object_map itself
-    Mutex async_ops_lock; // protects async_ops and async_requests
+    Mutex async_ops_lock; // protects async_requests
     Mutex copyup_list_lock; // protects copyup_waiting_list
 
     unsigned extra_read_flags;
@@ -118,10 +139,20 @@ namespace librbd {
     Readahead readahead;
     uint64_t total_bytes_read;
 
+    WriteCoalescer *write_coalescer;
+
     Finisher *copyup_finisher;
     std::map<uint64_t, CopyupRequest*> copyup_list;
+    CopyupCache *copyup_cache; // parent block cache for clone copyups
+    DiskReadCache *disk_read_cache; // persistent local read cache
+
+    static const int ASYNC_OP_SHARDS = 16;
+    AsyncOpShard async_op_shards[ASYNC_OP_SHARDS];
+
+    AsyncOpShard *get_async_op_shard(AsyncOperation *op) {
+      return &async_op_shards[((uintptr_t)op >> 6) % ASYNC_OP_SHARDS];
+    }
 
-    xlist<AsyncOperation*> async_ops;
     xlist<AsyncRequest*> async_requests;
     Cond async_requests_cond;
 
@@ -153,6 +184,7 @@ namespace librbd {
     uint32_t readahead_trigger_requests;
     uint64_t readahead_max_bytes;
     uint64_t readahead_disable_after_bytes;
+    uint32_t readahead_max_streams;
     bool clone_copy_on_read;
     bool blacklist_on_break_lock;
     uint32_t blacklist_expire_seconds;
@@ -171,6 +203,7 @@ namespace librbd {
     ~ImageCtx();
     int init();
     void init_layout();
+    void init_disk_read_cache();
     void perf_start(std::string name);
     void perf_stop();
     void set_read_flag(unsigned flag);
@@ -230,6 +263,7 @@ namespace librbd {
     uint64_t prune_parent_extents(vector<pair<uint64_t,uint64_t> >& objectx,
 				  uint64_t overlap);
 
+    void refresh_snapc_ref();
     void flush_async_operations();
     void flush_async_operations(Context *on_finish);
 
@@ -388,8 +388,24 @@ bool ImageWatcher::release_lock()
 
   {
     RWLock::RLocker owner_locker(m_image_ctx.owner_lock);
-    RWLock::WLocker md_locker(m_image_ctx.md_lock);
-    librbd::_flush(&m_image_ctx);
+    bool skip_flush = false;
+    if (m_image_ctx.cct->_conf->rbd_fast_lock_handoff &&
+        m_image_ctx.object_cacher != NULL) {
+      // in-flight ops and async requests are already drained, so if the
+      // cache holds no dirty or in-transit data there is nothing the
+      // next owner could miss and the writeback (and its write quiesce)
+      // can be skipped entirely
+      Mutex::Locker cache_locker(m_image_ctx.cache_lock);
+      skip_flush = !m_image_ctx.object_cacher->set_is_dirty_or_committing(
+        m_image_ctx.object_set);
+    }
+    if (skip_flush) {
+      ldout(m_image_ctx.cct, 10) << this << " cache clean, skipping writeback "
+                                 << "for lock handoff" << dendl;
+    } else {
+      RWLock::WLocker md_locker(m_image_ctx.md_lock);
+      librbd::_flush(&m_image_ctx);
+    }
   }
 
   m_image_ctx.owner_lock.get_write();
@@ -3,6 +3,8 @@
 
 #include <errno.h>
 
+#include <boost/bind.hpp>
+
 #include "common/ceph_context.h"
 #include "common/dout.h"
 #include "common/Finisher.h"
@@ -12,6 +14,7 @@
 #include "include/rbd/librbd.hpp"
 
 #include "librbd/AioRequest.h"
+#include "librbd/DiskReadCache.h"
 #include "librbd/ImageCtx.h"
 #include "librbd/internal.h"
 #include "librbd/LibrbdWriteback.h"
@@ -64,6 +67,39 @@ namespace librbd {
     Mutex *m_lock;
   };
 
+  /**
+   * context to spill a completed cluster read into the disk read cache
+   *
+   * Completes the wrapped context inline and queues the cache insert
+   * on the writeback finisher so the rados callback thread never
+   * blocks on local disk IO.
+   */
+  class C_DiskCacheInsert : public Context {
+  public:
+    C_DiskCacheInsert(DiskReadCache *cache, Finisher *finisher,
+		      const std::string &oid, uint64_t snap_id, uint64_t off,
+		      bufferlist *pbl, uint64_t read_seq, Context *ctx)
+      : m_cache(cache), m_finisher(finisher), m_oid(oid), m_snap_id(snap_id),
+	m_off(off), m_pbl(pbl), m_read_seq(read_seq), m_ctx(ctx) {}
+    virtual void finish(int r) {
+      if (r >= 0) {
+	m_finisher->queue(new FunctionContext(boost::bind(
+	  &DiskReadCache::insert, m_cache, m_oid, m_snap_id, m_off, *m_pbl,
+	  m_read_seq)));
+      }
+      m_ctx->complete(r);
+    }
+  private:
+    DiskReadCache *m_cache;
+    Finisher *m_finisher;
+    std::string m_oid;
+    uint64_t m_snap_id;
+    uint64_t m_off;
+    bufferlist *m_pbl;
+    uint64_t m_read_seq;
+    Context *m_ctx;
+  };
+
   class C_OrderedWrite : public Context {
   public:
     C_OrderedWrite(CephContext *cct, LibrbdWriteback::write_result_d *result,
@@ -114,6 +150,18 @@ namespace librbd {
       }
     }
 
+    if (m_ictx->disk_read_cache != NULL) {
+      if (m_ictx->disk_read_cache->lookup(oid.name, snapid, off, len, pbl)) {
+	m_finisher->queue(req, len);
+	return;
+      }
+      // populate the cache when the cluster read completes
+      req = new C_DiskCacheInsert(m_ictx->disk_read_cache, m_finisher,
+				  oid.name, snapid, off, pbl,
+				  m_ictx->disk_read_cache->get_read_seq(),
+				  req);
+    }
+
     librados::AioCompletion *rados_completion =
       librados::Rados::aio_create_completion(req, context_cb, NULL);
     librados::ObjectReadOperation op;
@@ -170,6 +218,31 @@ namespace librbd {
     return ++m_tid;
   }
 
+  ceph_tid_t LibrbdWriteback::write_scattered(const object_t& oid,
+				const object_locator_t& oloc,
+				std::vector<std::pair<uint64_t, bufferlist> >& io_vec,
+				const SnapContext& snapc,
+				utime_t mtime, uint64_t trunc_size,
+				__u32 trunc_seq, Context *oncommit)
+  {
+    assert(m_ictx->owner_lock.is_locked());
+    uint64_t object_no = oid_to_object_no(oid.name, m_ictx->object_prefix);
+
+    write_result_d *result = new write_result_d(oid.name, oncommit);
+    m_writes[oid.name].push(result);
+    ldout(m_ictx->cct, 20) << "write_scattered will wait for result " << result
+			   << dendl;
+    C_OrderedWrite *req_comp = new C_OrderedWrite(m_ictx->cct, result, this);
+    AioScatteredWrite *req = new AioScatteredWrite(m_ictx, oid.name, object_no,
+						   io_vec, snapc, req_comp);
+    req->send();
+    return ++m_tid;
+  }
+
+  bool LibrbdWriteback::can_scattered_write() {
+    return m_ictx->cct->_conf->rbd_cache_merge_writebacks;
+  }
+
   void LibrbdWriteback::get_client_lock() {
     m_ictx->owner_lock.get_read();
   }
@@ -38,6 +38,15 @@ namespace librbd {
 			const bufferlist &bl, utime_t mtime, uint64_t trunc_size,
 			__u32 trunc_seq, Context *oncommit);
 
+    // Merge the dirty extents of one object into a single write op
+    virtual ceph_tid_t write_scattered(const object_t& oid,
+				       const object_locator_t& oloc,
+				       std::vector<std::pair<uint64_t, bufferlist> >& io_vec,
+				       const SnapContext& snapc, utime_t mtime,
+				       uint64_t trunc_size, __u32 trunc_seq,
+				       Context *oncommit);
+    virtual bool can_scattered_write();
+
     virtual void get_client_lock();
     virtual void put_client_lock();
 
@@ -8,6 +8,7 @@
 #include "common/errno.h"
 #include "include/stringify.h"
 #include "cls/lock/cls_lock_client.h"
+#include <boost/bind.hpp>
 #include <sstream>
 
 #define dout_subsys ceph_subsys_rbd
@@ -17,7 +18,8 @@
 namespace librbd {
 
 ObjectMap::ObjectMap(ImageCtx &image_ctx)
-  : m_image_ctx(image_ctx), m_snap_id(CEPH_NOSNAP), m_enabled(false)
+  : m_image_ctx(image_ctx), m_snap_id(CEPH_NOSNAP), m_enabled(false),
+    m_update_in_flight(false)
 {
 }
 
@@ -477,14 +479,97 @@ bool ObjectMap::aio_update(uint64_t start_object_no, uint64_t end_object_no,
     if ((!current_state || state == *current_state ||
           (*current_state == OBJECT_EXISTS && state == OBJECT_EXISTS_CLEAN)) &&
         state != new_state) {
-      aio_update(m_snap_id, start_object_no, end_object_no, new_state,
-                 current_state, on_finish);
+      if (m_snap_id == CEPH_NOSNAP) {
+        queue_update(start_object_no, end_object_no, new_state, current_state,
+                     on_finish);
+      } else {
+        aio_update(m_snap_id, start_object_no, end_object_no, new_state,
+                   current_state, on_finish);
+      }
       return true;
     }
   }
   return false;
 }
 
+void ObjectMap::queue_update(uint64_t start_object_no, uint64_t end_object_no,
+                             uint8_t new_state,
+                             const boost::optional<uint8_t> &current_state,
+                             Context *on_finish) {
+  assert(m_image_ctx.object_map_lock.is_wlocked());
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << &m_image_ctx << " queue_update: ["
+		 << start_object_no << "," << end_object_no << ") = "
+		 << (current_state ?
+		       stringify(static_cast<uint32_t>(*current_state)) : "")
+		 << "->" << static_cast<uint32_t>(new_state) << dendl;
+
+  // apply the in-memory overlay immediately; a failure of the batched
+  // on-disk update will invalidate the object map, so no rollback is
+  // required
+  for (uint64_t object_no = start_object_no;
+       object_no < MIN(end_object_no, m_object_map.size()); ++object_no) {
+    uint8_t state = m_object_map[object_no];
+    if (!current_state || state == *current_state ||
+        (*current_state == OBJECT_EXISTS && state == OBJECT_EXISTS_CLEAN)) {
+      m_object_map[object_no] = new_state;
+    }
+  }
+
+  PendingUpdate update;
+  update.start_object_no = start_object_no;
+  update.end_object_no = end_object_no;
+  update.new_state = new_state;
+  update.current_state = current_state;
+  update.on_finish = on_finish;
+  m_pending_updates.push_back(update);
+
+  if (!m_update_in_flight) {
+    send_pending_updates();
+  }
+}
+
+void ObjectMap::send_pending_updates() {
+  assert(m_image_ctx.object_map_lock.is_wlocked());
+  assert(!m_update_in_flight);
+  assert(!m_pending_updates.empty());
+  m_update_in_flight = true;
+
+  std::vector<PendingUpdate> updates;
+  updates.swap(m_pending_updates);
+
+  std::list<Context*> *on_finishes = new std::list<Context*>();
+  for (std::vector<PendingUpdate>::iterator it = updates.begin();
+       it != updates.end(); ++it) {
+    if (it->on_finish != NULL) {
+      on_finishes->push_back(it->on_finish);
+    }
+  }
+
+  BatchUpdateRequest *req = new BatchUpdateRequest(
+    m_image_ctx, updates,
+    new FunctionContext(boost::bind(&ObjectMap::handle_update_finished, this,
+				    _1, on_finishes)));
+  req->send();
+}
+
+void ObjectMap::handle_update_finished(int r,
+                                       std::list<Context*> *on_finishes) {
+  for (std::list<Context*>::iterator it = on_finishes->begin();
+       it != on_finishes->end(); ++it) {
+    (*it)->complete(r);
+  }
+  delete on_finishes;
+
+  RWLock::WLocker l(m_image_ctx.object_map_lock);
+  m_update_in_flight = false;
+  if (!m_pending_updates.empty()) {
+    // group commit: everything that queued while the last update was
+    // in flight goes out as a single operation
+    send_pending_updates();
+  }
+}
+
 void ObjectMap::aio_update(uint64_t snap_id, uint64_t start_object_no,
                            uint64_t end_object_no, uint8_t new_state,
                            const boost::optional<uint8_t> &current_state,
@@ -651,6 +736,34 @@ void ObjectMap::ResizeRequest::finish(ObjectMap *object_map) {
   object_map->resize(m_num_objs, m_default_object_state);
 }
 
+void ObjectMap::BatchUpdateRequest::send() {
+  assert(m_image_ctx.object_map_lock.is_wlocked());
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << &m_image_ctx << " updating on-disk object map: "
+		 << m_updates.size() << " batched update(s)" << dendl;
+
+  // the in-memory overlay was already updated when each transition was
+  // queued; apply all batched transitions in a single operation
+  librados::ObjectWriteOperation op;
+  rados::cls::lock::assert_locked(&op, RBD_LOCK_NAME, LOCK_EXCLUSIVE, "", "");
+  for (std::vector<PendingUpdate>::const_iterator it = m_updates.begin();
+       it != m_updates.end(); ++it) {
+    cls_client::object_map_update(&op, it->start_object_no, it->end_object_no,
+				  it->new_state, it->current_state);
+  }
+
+  librados::AioCompletion *rados_completion = create_callback_completion();
+  std::string oid(object_map_name(m_image_ctx.id, CEPH_NOSNAP));
+  int r = m_image_ctx.md_ctx.aio_operate(oid, rados_completion, &op);
+  assert(r == 0);
+  rados_completion->release();
+}
+
+void ObjectMap::BatchUpdateRequest::finish(ObjectMap *object_map) {
+  ldout(m_image_ctx.cct, 20) << &m_image_ctx << " on-disk object map updated"
+			     << dendl;
+}
+
 void ObjectMap::UpdateRequest::send() {
   assert(m_image_ctx.object_map_lock.is_locked());
   CephContext *cct = m_image_ctx.cct;
@@ -9,6 +9,8 @@
 #include "common/bit_vector.hpp"
 #include "librbd/AsyncRequest.h"
 #include <boost/optional.hpp>
+#include <list>
+#include <vector>
 
 class Context;
 
@@ -115,6 +117,31 @@ private:
     uint8_t m_default_object_state;
   };
 
+  /// a head object map transition awaiting its batched on-disk update
+  struct PendingUpdate {
+    uint64_t start_object_no;
+    uint64_t end_object_no;
+    uint8_t new_state;
+    boost::optional<uint8_t> current_state;
+    Context *on_finish;
+  };
+
+  class BatchUpdateRequest : public Request {
+  public:
+    BatchUpdateRequest(ImageCtx &image_ctx,
+                       const std::vector<PendingUpdate> &updates,
+                       Context *on_finish)
+      : Request(image_ctx, CEPH_NOSNAP, on_finish), m_updates(updates)
+    {
+    }
+
+    virtual void send();
+  protected:
+    virtual void finish(ObjectMap *object_map);
+  private:
+    std::vector<PendingUpdate> m_updates;
+  };
+
   class UpdateRequest : public Request {
   public:
     UpdateRequest(ImageCtx &image_ctx, uint64_t snap_id,
@@ -143,6 +170,18 @@ private:
   uint64_t m_snap_id;
   bool m_enabled;
 
+  /// head updates queued behind an in-flight on-disk update; they are
+  /// all applied via a single cls operation once it completes
+  bool m_update_in_flight;
+  std::vector<PendingUpdate> m_pending_updates;
+
+  void queue_update(uint64_t start_object_no, uint64_t end_object_no,
+                    uint8_t new_state,
+                    const boost::optional<uint8_t> &current_state,
+                    Context *on_finish);
+  void send_pending_updates();
+  void handle_update_finished(int r, std::list<Context*> *on_finishes);
+
   void invalidate(uint64_t snap_id);
   void resize(uint64_t num_objs, uint8_t default_state);
 };
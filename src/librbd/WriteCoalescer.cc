@@ -0,0 +1,182 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "librbd/WriteCoalescer.h"
+#include "librbd/AioRequest.h"
+#include "librbd/ImageCtx.h"
+#include "common/dout.h"
+
+#include <boost/bind.hpp>
+
+#define dout_subsys ceph_subsys_rbd
+#undef dout_prefix
+#define dout_prefix *_dout << "librbd::WriteCoalescer: "
+
+namespace librbd {
+
+namespace {
+
+enum { TASK_CODE_FLUSH = 0 };
+
+// completes every write that was folded into a single object op
+class C_CoalescedWrite : public Context {
+public:
+  C_CoalescedWrite(std::list<Context*> &comps) {
+    m_comps.swap(comps);
+  }
+  virtual void finish(int r) {
+    for (std::list<Context*>::iterator it = m_comps.begin();
+	 it != m_comps.end(); ++it) {
+      (*it)->complete(r);
+    }
+  }
+private:
+  std::list<Context*> m_comps;
+};
+
+} // anonymous namespace
+
+WriteCoalescer::WriteCoalescer(ImageCtx *ictx)
+  : m_ictx(ictx), m_lock("librbd::WriteCoalescer::m_lock"),
+    m_task_finisher(new TaskFinisher<int>(*ictx->cct)),
+    m_buffered(0),
+    m_max_bytes(ictx->cct->_conf->rbd_coalesce_max_bytes),
+    m_window(ictx->cct->_conf->rbd_coalesce_window)
+{
+}
+
+WriteCoalescer::~WriteCoalescer()
+{
+  // waits for a scheduled flush to run
+  delete m_task_finisher;
+  assert(m_pending.empty());
+}
+
+void WriteCoalescer::write(uint64_t object_no, const std::string &oid,
+			   uint64_t off, const ceph::bufferlist &bl,
+			   const ceph::shared_ptr<const ::SnapContext> &snapc,
+			   Context *req_comp, int op_flags)
+{
+  assert(m_ictx->owner_lock.is_locked());
+  CephContext *cct = m_ictx->cct;
+
+  std::list<PendingWrite*> ready;
+  bool buffered = false;
+  {
+    Mutex::Locker l(m_lock);
+    std::map<uint64_t, PendingWrite*>::iterator it = m_pending.find(object_no);
+    PendingWrite *pw = (it != m_pending.end()) ? it->second : NULL;
+
+    if (pw != NULL && pw->snapc == snapc &&
+	pw->off + pw->bl.length() == off &&
+	pw->bl.length() + bl.length() <= m_max_bytes) {
+      // contiguous with the buffered extent; fold it in
+      ldout(cct, 20) << "merging " << oid << " " << off << "~" << bl.length()
+		     << " into " << pw->off << "~" << pw->bl.length() << dendl;
+      pw->bl.append(bl);
+      pw->comps.push_back(req_comp);
+      pw->op_flags |= op_flags;
+      if (pw->bl.length() >= m_max_bytes) {
+	m_pending.erase(it);
+	m_buffered.dec();
+	ready.push_back(pw);
+      } else {
+	buffered = true;
+      }
+    } else {
+      // a non-contiguous write (or one under a new snap context) to
+      // the same object must not be reordered ahead of the buffered
+      // extent, so submit that first
+      if (pw != NULL) {
+	m_pending.erase(it);
+	m_buffered.dec();
+	ready.push_back(pw);
+      }
+
+      pw = new PendingWrite();
+      pw->oid = oid;
+      pw->object_no = object_no;
+      pw->off = off;
+      pw->bl = bl;
+      pw->comps.push_back(req_comp);
+      pw->snapc = snapc;
+      pw->op_flags = op_flags;
+
+      if (bl.length() >= m_max_bytes) {
+	// too big to benefit from merging
+	ready.push_back(pw);
+      } else {
+	m_pending[object_no] = pw;
+	m_buffered.inc();
+	buffered = true;
+      }
+    }
+  }
+
+  for (std::list<PendingWrite*>::iterator it = ready.begin();
+       it != ready.end(); ++it) {
+    submit(*it);
+  }
+
+  if (buffered) {
+    // no-op if a flush is already scheduled
+    m_task_finisher->add_event_after(
+      TASK_CODE_FLUSH, m_window,
+      new FunctionContext(boost::bind(&WriteCoalescer::handle_flush_task,
+				      this)));
+  }
+}
+
+void WriteCoalescer::flush()
+{
+  assert(m_ictx->owner_lock.is_locked());
+
+  std::list<PendingWrite*> ready;
+  {
+    Mutex::Locker l(m_lock);
+    for (std::map<uint64_t, PendingWrite*>::iterator it = m_pending.begin();
+	 it != m_pending.end(); ++it) {
+      ready.push_back(it->second);
+    }
+    m_pending.clear();
+    m_buffered.set(0);
+  }
+
+  for (std::list<PendingWrite*>::iterator it = ready.begin();
+       it != ready.end(); ++it) {
+    submit(*it);
+  }
+}
+
+void WriteCoalescer::schedule_flush()
+{
+  if (empty()) {
+    return;
+  }
+  m_task_finisher->queue(
+    TASK_CODE_FLUSH,
+    new FunctionContext(boost::bind(&WriteCoalescer::handle_flush_task,
+				    this)));
+}
+
+void WriteCoalescer::handle_flush_task()
+{
+  RWLock::RLocker owner_locker(m_ictx->owner_lock);
+  flush();
+}
+
+void WriteCoalescer::submit(PendingWrite *pw)
+{
+  ldout(m_ictx->cct, 20) << "submitting " << pw->oid << " " << pw->off << "~"
+			 << pw->bl.length() << " (" << pw->comps.size()
+			 << " writes)" << dendl;
+
+  AioWrite *req = new AioWrite(m_ictx, pw->oid, pw->object_no, pw->off,
+			       pw->bl, *pw->snapc,
+			       new C_CoalescedWrite(pw->comps));
+  req->set_op_flags(pw->op_flags);
+  req->send();
+  delete pw;
+}
+
+} // namespace librbd
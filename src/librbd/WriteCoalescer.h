@@ -0,0 +1,85 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+#ifndef CEPH_LIBRBD_WRITE_COALESCER_H
+#define CEPH_LIBRBD_WRITE_COALESCER_H
+
+#include "include/int_types.h"
+#include "include/atomic.h"
+#include "include/buffer.h"
+#include "include/memory.h"
+#include "common/Mutex.h"
+#include "common/snap_types.h"
+#include "librbd/TaskFinisher.h"
+#include <list>
+#include <map>
+#include <string>
+
+class Context;
+
+namespace librbd {
+
+class ImageCtx;
+
+/**
+ * WriteCoalescer merges adjacent small sequential writes to the same
+ * object into a single object op before submission.  A buffered write
+ * is held until the configured window expires, the merged extent
+ * reaches the configured size limit, or a flush forces submission.
+ * The existing flush/ordering semantics are preserved: the flush
+ * paths drain the coalescer before waiting for in-flight ops, and
+ * reads and discards drain it before they are issued.
+ */
+class WriteCoalescer {
+public:
+  WriteCoalescer(ImageCtx *ictx);
+  ~WriteCoalescer();
+
+  /**
+   * Buffer, merge, or directly submit one object write.  The caller
+   * must hold the image owner_lock.  req_comp is completed when the
+   * (possibly merged) object op completes.
+   */
+  void write(uint64_t object_no, const std::string &oid, uint64_t off,
+	     const ceph::bufferlist &bl,
+	     const ceph::shared_ptr<const ::SnapContext> &snapc,
+	     Context *req_comp, int op_flags);
+
+  /// true if nothing is buffered (cheap check for the read path)
+  bool empty() {
+    return m_buffered.read() == 0;
+  }
+
+  /// submit all buffered writes; the caller must hold the image
+  /// owner_lock
+  void flush();
+
+  /// queue a flush on the finisher thread; safe to call regardless of
+  /// which locks the caller holds
+  void schedule_flush();
+
+private:
+  struct PendingWrite {
+    std::string oid;
+    uint64_t object_no;
+    uint64_t off;
+    ceph::bufferlist bl;
+    std::list<Context*> comps;
+    ceph::shared_ptr<const ::SnapContext> snapc;
+    int op_flags;
+  };
+
+  ImageCtx *m_ictx;
+  Mutex m_lock;
+  TaskFinisher<int> *m_task_finisher;
+  std::map<uint64_t, PendingWrite*> m_pending;
+  atomic_t m_buffered;       ///< number of objects with buffered data
+  uint64_t m_max_bytes;
+  double m_window;
+
+  void handle_flush_task();
+  void submit(PendingWrite *pw);
+};
+
+} // namespace librbd
+
+#endif // CEPH_LIBRBD_WRITE_COALESCER_H
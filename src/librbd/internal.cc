@@ -27,6 +27,7 @@
 #include "librbd/ImageWatcher.h"
 #include "librbd/internal.h"
 #include "librbd/ObjectMap.h"
+#include "librbd/WriteCoalescer.h"
 #include "librbd/parent_types.h"
 #include "librbd/RebuildObjectMapRequest.h"
 #include "include/util.h"
@@ -2072,6 +2073,7 @@ reprotect_and_return_err:
 
 	ictx->snapc.seq = snap_id;
 	ictx->snapc.snaps.swap(snaps);
+	ictx->refresh_snapc_ref();
 	ictx->data_ctx.selfmanaged_snap_set_write_ctx(ictx->snapc.seq,
 						      ictx->snaps);
       }
@@ -2331,6 +2333,7 @@ reprotect_and_return_err:
       }
 
       ictx->snapc = new_snapc;
+      ictx->refresh_snapc_ref();
 
       if (ictx->snap_id != CEPH_NOSNAP &&
 	  ictx->get_snap_id(ictx->snap_name) != ictx->snap_id) {
@@ -3386,6 +3389,10 @@ reprotect_and_return_err:
     RWLock::RLocker owner_locker(ictx->owner_lock);
     ictx->user_flushed();
 
+    if (ictx->write_coalescer != NULL) {
+      ictx->write_coalescer->flush();
+    }
+
     C_AioWrite *flush_ctx = new C_AioWrite(cct, c);
     c->add_request();
     ictx->flush_async_operations(flush_ctx);
@@ -3434,6 +3441,9 @@ reprotect_and_return_err:
     if (ictx->object_cacher) {
       r = ictx->flush_cache();
     } else {
+      if (ictx->write_coalescer != NULL) {
+	ictx->write_coalescer->flush();
+      }
       r = ictx->data_ctx.aio_flush();
       ictx->flush_async_operations();
     }
@@ -3480,7 +3490,7 @@ reprotect_and_return_err:
     RWLock::RLocker md_locker(ictx->md_lock);
 
     uint64_t clip_len = len;
-    ::SnapContext snapc;
+    ceph::shared_ptr<const ::SnapContext> snapc;
     {
       // prevent image size from changing between computing clip and recording
       // pending async operation
@@ -3496,7 +3506,9 @@ reprotect_and_return_err:
         return;
       }
 
-      snapc = ictx->snapc;
+      // the referenced snap context is immutable; capturing it is a
+      // pointer grab rather than a vector copy under the lock
+      snapc = ictx->snapc_ref;
 
       c->init_time(ictx, AIO_TYPE_WRITE);
     }
@@ -3531,9 +3543,13 @@ reprotect_and_return_err:
       if (ictx->object_cacher) {
 	c->add_request();
 	ictx->write_to_cache(p->oid, bl, p->length, p->offset, req_comp, op_flags);
+      } else if (ictx->write_coalescer != NULL) {
+	c->add_request();
+	ictx->write_coalescer->write(p->objectno, p->oid.name, p->offset, bl,
+				     snapc, req_comp, op_flags);
       } else {
 	AioWrite *req = new AioWrite(ictx, p->oid.name, p->objectno, p->offset,
-				     bl, snapc, req_comp);
+				     bl, *snapc, req_comp);
 	c->add_request();
 
 	req->set_op_flags(op_flags);
@@ -3619,7 +3635,7 @@ reprotect_and_return_err:
     RWLock::RLocker md_locker(ictx->md_lock);
 
     uint64_t clip_len = len;
-    ::SnapContext snapc;
+    ceph::shared_ptr<const ::SnapContext> snapc;
     {
       // prevent image size from changing between computing clip and recording
       // pending async operation
@@ -3636,7 +3652,7 @@ reprotect_and_return_err:
       }
 
       // TODO: check for snap
-      snapc = ictx->snapc;
+      snapc = ictx->snapc_ref;
 
       c->init_time(ictx, AIO_TYPE_DISCARD);
     }
@@ -3649,6 +3665,11 @@ reprotect_and_return_err:
       return;
     }
 
+    if (ictx->write_coalescer != NULL && !ictx->write_coalescer->empty()) {
+      // the discard must not be reordered ahead of a buffered write
+      ictx->write_coalescer->flush();
+    }
+
     // map
     vector<ObjectExtent> extents;
     if (len > 0) {
@@ -3664,9 +3685,9 @@ reprotect_and_return_err:
       c->add_request();
 
       if (p->length == ictx->layout.fl_object_size) {
-	req = new AioRemove(ictx, p->oid.name, p->objectno, snapc, req_comp);
+	req = new AioRemove(ictx, p->oid.name, p->objectno, *snapc, req_comp);
       } else if (p->offset + p->length == ictx->layout.fl_object_size) {
-	req = new AioTruncate(ictx, p->oid.name, p->objectno, p->offset, snapc,
+	req = new AioTruncate(ictx, p->oid.name, p->objectno, p->offset, *snapc,
                               req_comp);
       } else {
 	if(ictx->cct->_conf->rbd_skip_partial_discard) {
@@ -3674,7 +3695,7 @@ reprotect_and_return_err:
 	  continue;
 	}
 	req = new AioZero(ictx, p->oid.name, p->objectno, p->offset, p->length,
-			  snapc, req_comp);
+			  *snapc, req_comp);
       }
 
       req->send();
@@ -3785,6 +3806,12 @@ reprotect_and_return_err:
       readahead(ictx, image_extents);
     }
 
+    if (ictx->write_coalescer != NULL && !ictx->write_coalescer->empty()) {
+      // the read must not be reordered ahead of a buffered write
+      RWLock::RLocker owner_locker(ictx->owner_lock);
+      ictx->write_coalescer->flush();
+    }
+
     snap_t snap_id;
     map<object_t,vector<ObjectExtent> > object_extents;
     uint64_t buffer_ofs = 0;
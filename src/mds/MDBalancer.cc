@@ -1127,3 +1127,86 @@ void MDBalancer::show_imports(bool external)
 {
   mds->mdcache->show_subtrees();
 }
+
+/* admin socket "dump loads": the per-dirfrag popularity counters the
+ * balancer bases its decisions on, as a walk from the root, plus the
+ * per-mds loads from the last heartbeat epoch */
+void MDBalancer::dump_loads(ceph::Formatter *f)
+{
+  utime_t now = ceph_clock_now(g_ceph_context);
+  DecayRate& decayrate = mds->mdcache->decayrate;
+
+  f->open_object_section("loads");
+
+  f->open_array_section("dirfrags");
+  list<CDir*> dfs;
+  if (mds->mdcache->get_root()) {
+    mds->mdcache->get_root()->get_dirfrags(dfs);
+  } else {
+    dout(5) << "dump_loads no root" << dendl;
+  }
+  while (!dfs.empty()) {
+    CDir *dir = dfs.front();
+    dfs.pop_front();
+
+    f->open_object_section("dir");
+    string path;
+    dir->get_inode()->make_path_string(path, true);
+    f->dump_string("path", path);
+    f->dump_stream("dirfrag") << dir->dirfrag();
+    f->open_object_section("pop_me");
+    dir->pop_me.dump(f);
+    f->dump_float("meta_load", dir->pop_me.meta_load(now, decayrate));
+    f->close_section();
+    f->open_object_section("pop_nested");
+    dir->pop_nested.dump(f);
+    f->dump_float("meta_load", dir->pop_nested.meta_load(now, decayrate));
+    f->close_section();
+    f->open_object_section("pop_auth_subtree");
+    dir->pop_auth_subtree.dump(f);
+    f->dump_float("meta_load", dir->pop_auth_subtree.meta_load(now, decayrate));
+    f->close_section();
+    f->open_object_section("pop_auth_subtree_nested");
+    dir->pop_auth_subtree_nested.dump(f);
+    f->dump_float("meta_load", dir->pop_auth_subtree_nested.meta_load(now, decayrate));
+    f->close_section();
+    f->close_section();  // dir
+
+    for (CDir::map_t::iterator it = dir->begin(); it != dir->end(); ++it) {
+      CInode *in = it->second->get_linkage()->get_inode();
+      if (!in || !in->is_dir())
+	continue;
+
+      list<CDir*> ls;
+      in->get_dirfrags(ls);
+      for (list<CDir*>::iterator p = ls.begin(); p != ls.end(); ++p) {
+	if ((*p)->pop_nested.meta_load(now, decayrate) < .001)
+	  continue;  // no meaningful load below here
+	dfs.push_back(*p);
+      }
+    }
+  }
+  f->close_section();  // dirfrags
+
+  f->open_object_section("mds_load");
+  for (map<mds_rank_t, mds_load_t>::iterator it = mds_load.begin();
+       it != mds_load.end(); ++it) {
+    char name[32];
+    snprintf(name, sizeof(name), "mds.%d", int(it->first));
+    f->open_object_section(name);
+    it->second.dump(f);
+    f->close_section();
+  }
+  f->close_section();  // mds_load
+
+  f->open_object_section("mds_meta_load");
+  for (map<mds_rank_t, float>::iterator it = mds_meta_load.begin();
+       it != mds_meta_load.end(); ++it) {
+    char name[32];
+    snprintf(name, sizeof(name), "mds.%d", int(it->first));
+    f->dump_float(name, it->second);
+  }
+  f->close_section();  // mds_meta_load
+
+  f->close_section();  // loads
+}
@@ -35,6 +35,10 @@ class CDir;
 class Messenger;
 class MonClient;
 
+namespace ceph {
+  class Formatter;
+}
+
 class MDBalancer {
  protected:
   MDSRank *mds;
@@ -119,6 +123,7 @@ public:
 
 
   void show_imports(bool external=false);
+  void dump_loads(ceph::Formatter *f);
 
   void queue_split(CDir *dir);
   void queue_merge(CDir *dir);
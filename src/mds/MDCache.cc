@@ -194,6 +194,7 @@ MDCache::MDCache(MDSRank *m) :
 
   discover_last_tid = 0;
   open_ino_last_tid = 0;
+  num_open_inodes_preloading = 0;
   find_ino_peer_last_tid = 0;
 
   last_cap_id = 0;
@@ -7209,6 +7210,25 @@ void MDCache::check_memory_usage()
       mds->server->recall_client_state(ratio);
   }
 
+  uint64_t limit = g_conf->mds_cache_memory_limit;
+  if (limit) {
+    uint64_t rss = (uint64_t)last.get_rss() << 10;
+    if (rss > limit) {
+      /* the cache dominates our heap, so shrinking the lru by the same
+       * ratio we are over budget converges over successive ticks; caps
+       * pin inodes against trimming, so ask clients to release state
+       * proportionally as well */
+      float ratio = (float)limit / (float)rss;
+      int count = lru.lru_get_size() * (1.0 - ratio);
+      if (count > 0) {
+	dout(2) << "check_memory_usage: rss " << (rss >> 10)
+		<< " kB over mds_cache_memory_limit " << (limit >> 10)
+		<< " kB, trimming " << count << " dentries" << dendl;
+	trim(-1, count);
+	mds->server->recall_client_state(ratio);
+      }
+    }
+  }
 }
 
 
@@ -8492,6 +8512,140 @@ void MDCache::kick_open_ino_peers(mds_rank_t who)
   }
 }
 
+/* ---- open inode digest ----
+ *
+ * The active rank periodically persists the set of inodes clients hold
+ * caps on.  After a failover the taking-over rank reads the digest and
+ * starts open_ino()s for the previous incarnation's working set while
+ * it is still sitting out the client reconnect window, so the hot
+ * inodes (and the dentries on their paths) are back in cache before
+ * clients start issuing requests, instead of being faulted in one miss
+ * at a time.  The digest is purely advisory: it may be stale or missing
+ * and is only ever used as a prefetch hint.
+ */
+
+static object_t open_inodes_digest_oid(mds_rank_t rank)
+{
+  char n[30];
+  snprintf(n, sizeof(n), "mds%d_openfiles", int(rank));
+  return object_t(n);
+}
+
+class C_IO_MDC_OpenInodesDigestSaved : public MDCacheIOContext {
+public:
+  C_IO_MDC_OpenInodesDigestSaved(MDCache *c) : MDCacheIOContext(c) {}
+  void finish(int r) {
+    mdcache->_open_inodes_digest_saved(r);
+  }
+};
+
+class C_IO_MDC_OpenInodesDigestLoaded : public MDCacheIOContext {
+public:
+  bufferlist bl;
+  C_IO_MDC_OpenInodesDigestLoaded(MDCache *c) : MDCacheIOContext(c) {}
+  void finish(int r) {
+    mdcache->_preload_open_inodes(r, bl);
+  }
+};
+
+struct C_MDC_InodePreloaded : public MDCacheContext {
+  inodeno_t ino;
+  C_MDC_InodePreloaded(MDCache *c, inodeno_t i) : MDCacheContext(c), ino(i) {}
+  void finish(int r) {
+    mdcache->_open_inode_preloaded(ino, r);
+  }
+};
+
+void MDCache::maybe_persist_open_inodes()
+{
+  if (g_conf->mds_open_inodes_persist_interval <= 0)
+    return;
+  utime_t now = ceph_clock_now(g_ceph_context);
+  if (now - last_open_inodes_persist < g_conf->mds_open_inodes_persist_interval)
+    return;
+  last_open_inodes_persist = now;
+
+  set<inodeno_t> inos;
+  const ceph::unordered_map<entity_name_t,Session*>& sessions =
+    mds->sessionmap.get_sessions();
+  for (ceph::unordered_map<entity_name_t,Session*>::const_iterator p = sessions.begin();
+       p != sessions.end();
+       ++p) {
+    for (xlist<Capability*>::iterator q = p->second->caps.begin(); !q.end(); ++q)
+      inos.insert((*q)->get_inode()->ino());
+  }
+
+  dout(10) << "maybe_persist_open_inodes " << inos.size() << " inodes" << dendl;
+
+  bufferlist bl;
+  __u8 v = 1;
+  ::encode(v, bl);
+  ::encode(inos, bl);
+
+  SnapContext snapc;
+  object_locator_t oloc(mds->mdsmap->get_metadata_pool());
+  mds->objecter->write_full(open_inodes_digest_oid(mds->get_nodeid()), oloc,
+			    snapc, bl, ceph_clock_now(g_ceph_context), 0,
+			    NULL,
+			    new C_OnFinisher(new C_IO_MDC_OpenInodesDigestSaved(this),
+					     mds->finisher));
+}
+
+void MDCache::_open_inodes_digest_saved(int r)
+{
+  // advisory data; a failed save just costs the next incarnation its
+  // prefetch, so don't go through handle_write_error
+  if (r < 0)
+    dout(1) << "_open_inodes_digest_saved write failed: " << cpp_strerror(r) << dendl;
+  else
+    dout(10) << "_open_inodes_digest_saved" << dendl;
+}
+
+void MDCache::preload_open_inodes()
+{
+  dout(10) << "preload_open_inodes" << dendl;
+  C_IO_MDC_OpenInodesDigestLoaded *c = new C_IO_MDC_OpenInodesDigestLoaded(this);
+  object_locator_t oloc(mds->mdsmap->get_metadata_pool());
+  mds->objecter->read_full(open_inodes_digest_oid(mds->get_nodeid()), oloc,
+			   CEPH_NOSNAP, &c->bl, 0,
+			   new C_OnFinisher(c, mds->finisher));
+}
+
+void MDCache::_preload_open_inodes(int r, bufferlist& bl)
+{
+  if (r < 0) {
+    dout(10) << "_preload_open_inodes no digest: " << cpp_strerror(r) << dendl;
+    return;
+  }
+
+  set<inodeno_t> inos;
+  try {
+    bufferlist::iterator p = bl.begin();
+    __u8 v;
+    ::decode(v, p);
+    ::decode(inos, p);
+  } catch (const buffer::error &e) {
+    dout(1) << "_preload_open_inodes corrupt digest, ignoring" << dendl;
+    return;
+  }
+
+  dout(1) << "_preload_open_inodes warming up " << inos.size() << " inodes" << dendl;
+  for (set<inodeno_t>::iterator p = inos.begin(); p != inos.end(); ++p) {
+    if (get_inode(*p))
+      continue;
+    num_open_inodes_preloading++;
+    open_ino(*p, -1, new C_MDC_InodePreloaded(this, *p), false);
+  }
+}
+
+void MDCache::_open_inode_preloaded(inodeno_t ino, int r)
+{
+  dout(20) << "_open_inode_preloaded " << ino << " r=" << r << dendl;
+  assert(num_open_inodes_preloading > 0);
+  if (--num_open_inodes_preloading == 0)
+    dout(1) << "_open_inode_preloaded done" << dendl;
+}
+
 void MDCache::open_ino(inodeno_t ino, int64_t pool, MDSInternalContextBase* fin,
 		       bool want_replica, bool want_xlocked)
 {
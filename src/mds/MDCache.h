@@ -921,7 +921,21 @@ public:
   void kick_open_ino_peers(mds_rank_t who);
   void open_ino(inodeno_t ino, int64_t pool, MDSInternalContextBase *fin,
 		bool want_replica=true, bool want_xlocked=false);
-  
+
+  // -- open inode digest (warm failover) --
+protected:
+  utime_t last_open_inodes_persist;
+  int num_open_inodes_preloading;
+  void _open_inodes_digest_saved(int r);
+  void _preload_open_inodes(int r, bufferlist& bl);
+  void _open_inode_preloaded(inodeno_t ino, int r);
+  friend class C_IO_MDC_OpenInodesDigestSaved;
+  friend class C_IO_MDC_OpenInodesDigestLoaded;
+  friend struct C_MDC_InodePreloaded;
+public:
+  void maybe_persist_open_inodes();
+  void preload_open_inodes();
+
   // -- find_ino_peer --
   struct find_ino_peer_info_t {
     inodeno_t ino;
@@ -384,6 +384,14 @@ void MDLog::_submit_thread()
       journaler->wait_for_flush(new C_MDL_Flushed(
             this, new_write_pos, data.fin));
 
+      if (!data.flush && g_conf->mds_log_flush_bytes &&
+	  new_write_pos - journaler->get_flush_pos() >= g_conf->mds_log_flush_bytes) {
+	// enough buffered: start the osd write now so journal transmission
+	// overlaps with encoding of the following events, instead of
+	// accumulating everything for the next timed flush
+	data.flush = true;
+      }
+
       if (data.flush)
 	journaler->flush();
 
@@ -1264,74 +1272,82 @@ void MDLog::_replay_thread()
     
     assert(journaler->is_readable() || mds->is_daemon_stopping());
     
-    // read it
-    uint64_t pos = journaler->get_read_pos();
-    bufferlist bl;
-    bool r = journaler->try_read_entry(bl);
-    if (!r && journaler->get_error())
+    // read a batch of entries; they become readable together as each
+    // prefetched object arrives, and draining them under one lock hold
+    // avoids a lock/prefetch round trip per event
+    std::list<Journaler::Entry> entries;
+    size_t n = journaler->try_read_entries(entries);
+    if (n == 0 && journaler->get_error())
       continue;
-    assert(r);
-    
-    // unpack event
-    LogEvent *le = LogEvent::decode(bl);
-    if (!le) {
-      dout(0) << "_replay " << pos << "~" << bl.length() << " / " << journaler->get_write_pos() 
-	      << " -- unable to decode event" << dendl;
-      dout(0) << "dump of unknown or corrupt event:\n";
-      bl.hexdump(*_dout);
-      *_dout << dendl;
-
-      mds->clog->error() << "corrupt journal event at " << pos << "~"
-                         << bl.length() << " / "
-                         << journaler->get_write_pos();
-      if (g_conf->mds_log_skip_corrupt_events) {
-        continue;
-      } else {
-        mds->damaged_unlocked();
-        assert(0);  // Should be unreachable because damaged() calls
-                    // respawn()
+    assert(n > 0);
+
+    for (std::list<Journaler::Entry>::iterator p = entries.begin();
+	   p != entries.end();
+	   ++p) {
+      uint64_t pos = p->start_off;
+      bufferlist &bl = p->bl;
+
+      // unpack event
+      LogEvent *le = LogEvent::decode(bl);
+      if (!le) {
+        dout(0) << "_replay " << pos << "~" << bl.length() << " / " << journaler->get_write_pos() 
+	        << " -- unable to decode event" << dendl;
+        dout(0) << "dump of unknown or corrupt event:\n";
+        bl.hexdump(*_dout);
+        *_dout << dendl;
+
+        mds->clog->error() << "corrupt journal event at " << pos << "~"
+                           << bl.length() << " / "
+                           << journaler->get_write_pos();
+        if (g_conf->mds_log_skip_corrupt_events) {
+          continue;
+        } else {
+          mds->damaged_unlocked();
+          assert(0);  // Should be unreachable because damaged() calls
+                      // respawn()
+        }
+
       }
+      le->set_start_off(pos);
 
-    }
-    le->set_start_off(pos);
-
-    // new segment?
-    if (le->get_type() == EVENT_SUBTREEMAP ||
-	le->get_type() == EVENT_RESETJOURNAL) {
-      ESubtreeMap *sle = dynamic_cast<ESubtreeMap*>(le);
-      if (sle && sle->event_seq > 0)
-	event_seq = sle->event_seq;
-      else
-	event_seq = pos;
-      segments[event_seq] = new LogSegment(event_seq, pos);
-      logger->set(l_mdl_seg, segments.size());
-    } else {
-      event_seq++;
-    }
+      // new segment?
+      if (le->get_type() == EVENT_SUBTREEMAP ||
+	  le->get_type() == EVENT_RESETJOURNAL) {
+        ESubtreeMap *sle = dynamic_cast<ESubtreeMap*>(le);
+        if (sle && sle->event_seq > 0)
+	  event_seq = sle->event_seq;
+        else
+	  event_seq = pos;
+        segments[event_seq] = new LogSegment(event_seq, pos);
+        logger->set(l_mdl_seg, segments.size());
+      } else {
+        event_seq++;
+      }
 
-    // have we seen an import map yet?
-    if (segments.empty()) {
-      dout(10) << "_replay " << pos << "~" << bl.length() << " / " << journaler->get_write_pos() 
-	       << " " << le->get_stamp() << " -- waiting for subtree_map.  (skipping " << *le << ")" << dendl;
-    } else {
-      dout(10) << "_replay " << pos << "~" << bl.length() << " / " << journaler->get_write_pos() 
-	       << " " << le->get_stamp() << ": " << *le << dendl;
-      le->_segment = get_current_segment();    // replay may need this
-      le->_segment->num_events++;
-      le->_segment->end = journaler->get_read_pos();
-      num_events++;
-
-      {
-        Mutex::Locker l(mds->mds_lock);
-        if (mds->is_daemon_stopping()) {
-          return;
+      // have we seen an import map yet?
+      if (segments.empty()) {
+        dout(10) << "_replay " << pos << "~" << bl.length() << " / " << journaler->get_write_pos() 
+	         << " " << le->get_stamp() << " -- waiting for subtree_map.  (skipping " << *le << ")" << dendl;
+      } else {
+        dout(10) << "_replay " << pos << "~" << bl.length() << " / " << journaler->get_write_pos() 
+	         << " " << le->get_stamp() << ": " << *le << dendl;
+        le->_segment = get_current_segment();    // replay may need this
+        le->_segment->num_events++;
+        le->_segment->end = p->end_off;
+        num_events++;
+
+        {
+          Mutex::Locker l(mds->mds_lock);
+          if (mds->is_daemon_stopping()) {
+            return;
+          }
+          le->replay(mds);
         }
-        le->replay(mds);
       }
-    }
-    delete le;
+      delete le;
 
-    logger->set(l_mdl_rdpos, pos);
+      logger->set(l_mdl_rdpos, pos);
+    }
   }
 
   // done!
@@ -101,7 +101,9 @@ class C_VoidFn : public Context
 // cons/des
 MDSDaemon::MDSDaemon(const std::string &n, Messenger *m, MonClient *mc) : 
   Dispatcher(m->cct),
-  mds_lock("MDSDaemon::mds_lock"),
+  /* passing cct instruments the lock with a wait-time perf counter
+   * (mutex-MDSDaemon::mds_lock, gated by mutex_perf_counter) */
+  mds_lock("MDSDaemon::mds_lock", false, true, false, m->cct),
   stopping(false),
   timer(m->cct, mds_lock),
   beacon(m->cct, mc, n),
@@ -300,6 +302,11 @@ void MDSDaemon::set_up_admin_socket()
 				     asok_hook,
 				     "List fragments in directory");
   assert(r == 0);
+  r = admin_socket->register_command("dump loads",
+				     "dump loads",
+				     asok_hook,
+				     "dump metadata loads");
+  assert(r == 0);
 }
 
 void MDSDaemon::clean_up_admin_socket()
@@ -315,6 +322,7 @@ void MDSDaemon::clean_up_admin_socket()
   admin_socket->unregister_command("session ls");
   admin_socket->unregister_command("flush journal");
   admin_socket->unregister_command("force_readonly");
+  admin_socket->unregister_command("dump loads");
   delete asok_hook;
   asok_hook = NULL;
 }
@@ -189,6 +189,7 @@ void MDSRankDispatcher::tick()
   
   if (is_active()) {
     balancer->tick();
+    mdcache->maybe_persist_open_inodes();
     mdcache->find_stale_fragment_freeze();
     mdcache->migrator->find_stale_export_freeze();
     if (snapserver)
@@ -1185,6 +1186,11 @@ void MDSRank::reconnect_start()
     reopen_log();
   }
 
+  // start pulling the previous incarnation's hot inode set off disk
+  // while we sit out the client reconnect window
+  if (g_conf->mds_open_inodes_persist_interval > 0)
+    mdcache->preload_open_inodes();
+
   server->reconnect_clients(new C_VoidFn(this, &MDSRank::reconnect_done));
   finish_contexts(g_ceph_context, waiting_for_reconnect);
 }
@@ -1768,6 +1774,9 @@ bool MDSRankDispatcher::handle_asok_command(
   } else if (command == "dirfrag ls") {
     Mutex::Locker l(mds_lock);
     command_dirfrag_ls(cmdmap, ss, f);
+  } else if (command == "dump loads") {
+    Mutex::Locker l(mds_lock);
+    balancer->dump_loads(f);
   } else {
     return false;
   }
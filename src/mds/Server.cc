@@ -3306,7 +3306,23 @@ void Server::handle_client_readdir(MDRequestRef& mdr)
   }
   
   __u8 complete = (end && offset_str.empty());  // FIXME: what purpose does this serve
-  
+
+  // the client walks fragments serially, so once it has consumed this
+  // one it will immediately come back for the next; start fetching the
+  // following fragments now so those requests find them complete
+  if (end) {
+    frag_t pf = fg;
+    for (int i = 0; i < g_conf->mds_readdir_prefetch_frags && !pf.is_rightmost(); i++) {
+      pf = diri->dirfragtree[pf.next().value()];
+      CDir *pdir = diri->get_or_open_dirfrag(mdcache, pf);
+      if (pdir && pdir->is_auth() && !pdir->is_complete() && !pdir->is_frozen()) {
+	dout(10) << " prefetching dirfrag " << *pdir << dendl;
+	pdir->fetch(NULL);
+      }
+    }
+  }
+
+
   // finish final blob
   ::encode(numfiles, dirbl);
   ::encode(end, dirbl);
@@ -32,7 +32,7 @@ class OSD;
 
 class MOSDOp : public Message {
 
-  static const int HEAD_VERSION = 6;
+  static const int HEAD_VERSION = 7;
   static const int COMPAT_VERSION = 3;
 
 private:
@@ -48,6 +48,7 @@ private:
   pg_t pgid;
 public:
   vector<OSDOp> ops;
+  osd_optrace_t trace;  ///< sampled end-to-end trace; empty on most ops
 private:
 
   snapid_t snapid;
@@ -58,7 +59,31 @@ private:
 
   osd_reqid_t reqid; // reqid explicitly set by sender
 
+  // decode is split: decode_payload() only pulls out the fields fast
+  // dispatch needs, and the op vector, object name and snap context
+  // are materialized by finish_decode() on the sharded op threads
+  bool final_decode_needed;
+  bufferlist::iterator p; ///< resume point for finish_decode()
+
+  __u8 op_shape; ///< op vector shape, see classify_ops()
+
 public:
+  /**
+   * Op vector shapes, classified once at decode time.  rbd traffic is
+   * dominated by single-op reads and writes of identical shape;
+   * precomputing the classification lets the osd skip its per-op
+   * flag and dispatch scans for them (see OSD::init_op_flags and
+   * ReplicatedPG::do_osd_ops).
+   */
+  enum {
+    SHAPE_OTHER = 0,     ///< anything else: take the generic paths
+    SHAPE_SINGLE_READ,   ///< one READ or SYNC_READ
+    SHAPE_SINGLE_WRITE,  ///< one WRITE or WRITEFULL
+    SHAPE_WRITE_STAT,    ///< WRITE followed by STAT
+  };
+
+  int get_op_shape() const { return op_shape; }
+
   friend class MOSDOpReply;
 
   // read
@@ -101,7 +126,8 @@ public:
   utime_t get_mtime() { return mtime; }
 
   MOSDOp()
-    : Message(CEPH_MSG_OSD_OP, HEAD_VERSION, COMPAT_VERSION) { }
+    : Message(CEPH_MSG_OSD_OP, HEAD_VERSION, COMPAT_VERSION),
+      final_decode_needed(false), op_shape(SHAPE_OTHER) { }
   MOSDOp(int inc, long tid,
          object_t& _oid, object_locator_t& _oloc, pg_t& _pgid, epoch_t _osdmap_epoch,
 	 int _flags, uint64_t feat)
@@ -109,7 +135,8 @@ public:
       client_inc(inc),
       osdmap_epoch(_osdmap_epoch), flags(_flags), retry_attempt(-1),
       oid(_oid), oloc(_oloc), pgid(_pgid),
-      features(feat) {
+      features(feat),
+      final_decode_needed(false), op_shape(SHAPE_OTHER) {
     set_tid(tid);
   }
 private:
@@ -192,6 +219,18 @@ public:
     return retry_attempt;
   }
 
+  /**
+   * install a previously encoded payload and data segment, so that
+   * the next encode() skips encode_payload() entirely.  The caller
+   * must ensure the buffers match the current field values and were
+   * produced for a peer with CEPH_FEATURE_OBJECTLOCATOR.
+   */
+  void set_preencoded_payload(bufferlist& pl, const bufferlist& d) {
+    header.version = HEAD_VERSION;
+    payload.claim(pl);
+    data = d;
+  }
+
   // marshalling
   virtual void encode_payload(uint64_t features) {
 
@@ -272,11 +311,12 @@ struct ceph_osd_request_head {
       ::encode(retry_attempt, payload);
       ::encode(features, payload);
       ::encode(reqid, payload);
+      ::encode(trace, payload);
     }
   }
 
   virtual void decode_payload() {
-    bufferlist::iterator p = payload.begin();
+    p = payload.begin();
 
     if (header.version < 2) {
       // old decode
@@ -320,8 +360,13 @@ struct ceph_osd_request_head {
       retry_attempt = -1;
       features = 0;
       reqid = osd_reqid_t();
+
+      OSDOp::split_osd_op_vector_in_data(ops, data);
+      final_decode_needed = false;
+      classify_ops();
     } else {
-      // new decode 
+      // new decode: stop after the fields fast dispatch needs and
+      // leave the rest for finish_decode() on the op threads
       ::decode(client_inc, p);
       ::decode(osdmap_epoch, p);
       ::decode(flags, p);
@@ -338,36 +383,86 @@ struct ceph_osd_request_head {
 	::decode(pgid, p);
       }
 
-      ::decode(oid, p);
-
-      //::decode(ops, p);
-      __u16 num_ops;
-      ::decode(num_ops, p);
-      ops.resize(num_ops);
-      for (unsigned i = 0; i < num_ops; i++)
-	::decode(ops[i].op, p);
+      // sane values until finish_decode fills in the real ones
+      snapid = CEPH_NOSNAP;
+      snap_seq = 0;
+      retry_attempt = -1;
+      features = 0;
+      reqid = osd_reqid_t();
 
-      ::decode(snapid, p);
-      ::decode(snap_seq, p);
-      ::decode(snaps, p);
-
-      if (header.version >= 4)
-	::decode(retry_attempt, p);
-      else
-	retry_attempt = -1;
-
-      if (header.version >= 5)
-	::decode(features, p);
-      else
-	features = 0;
-
-      if (header.version >= 6)
-	::decode(reqid, p);
-      else
-	reqid = osd_reqid_t();
+      final_decode_needed = true;
     }
+  }
+
+  /**
+   * Finish the lazy half of the decode.
+   *
+   * decode_payload() only materializes the fields fast dispatch looks
+   * at; this pulls out the object name, the op vector and the snap
+   * context.  It is called from the sharded op threads, so the cost of
+   * decoding (and of copying op indata out of the message data buffer)
+   * stays off the messenger fast path.
+   *
+   * @return true if any work was done (i.e. the payload may now be
+   *         dropped), false if the message was already fully decoded
+   */
+  bool finish_decode() {
+    if (!final_decode_needed)
+      return false;
+
+    ::decode(oid, p);
+
+    __u16 num_ops;
+    ::decode(num_ops, p);
+    ops.resize(num_ops);
+    for (unsigned i = 0; i < num_ops; i++)
+      ::decode(ops[i].op, p);
+
+    ::decode(snapid, p);
+    ::decode(snap_seq, p);
+    ::decode(snaps, p);
+
+    if (header.version >= 4)
+      ::decode(retry_attempt, p);
+
+    if (header.version >= 5)
+      ::decode(features, p);
+
+    if (header.version >= 6)
+      ::decode(reqid, p);
+
+    if (header.version >= 7)
+      ::decode(trace, p);
 
     OSDOp::split_osd_op_vector_in_data(ops, data);
+    final_decode_needed = false;
+    classify_ops();
+    return true;
+  }
+
+  /// classify the op vector into one of the SHAPE_* patterns
+  void classify_ops() {
+    op_shape = SHAPE_OTHER;
+    if (ops.size() == 1) {
+      if (ops[0].soid.oid.name.length())
+	return;  // src oid: generic path
+      switch (ops[0].op.op) {
+      case CEPH_OSD_OP_READ:
+      case CEPH_OSD_OP_SYNC_READ:
+	op_shape = SHAPE_SINGLE_READ;
+	break;
+      case CEPH_OSD_OP_WRITE:
+      case CEPH_OSD_OP_WRITEFULL:
+	op_shape = SHAPE_SINGLE_WRITE;
+	break;
+      }
+    } else if (ops.size() == 2 &&
+	       ops[0].op.op == CEPH_OSD_OP_WRITE &&
+	       ops[1].op.op == CEPH_OSD_OP_STAT &&
+	       !ops[0].soid.oid.name.length() &&
+	       !ops[1].soid.oid.name.length()) {
+      op_shape = SHAPE_WRITE_STAT;
+    }
   }
 
   void clear_buffers() {
@@ -377,6 +472,15 @@ struct ceph_osd_request_head {
   const char *get_type_name() const { return "osd_op"; }
   void print(ostream& out) const {
     out << "osd_op(" << get_reqid();
+    if (final_decode_needed) {
+      // oid, ops and the snap context aren't decoded yet
+      out << " " << pgid
+	  << " (undecoded)"
+	  << " " << ceph_osd_flag_string(get_flags())
+	  << " e" << osdmap_epoch
+	  << ")";
+      return;
+    }
     out << " ";
     if (!oloc.nspace.empty())
       out << oloc.nspace << "/";
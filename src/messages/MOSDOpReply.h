@@ -32,7 +32,7 @@
 
 class MOSDOpReply : public Message {
 
-  static const int HEAD_VERSION = 6;
+  static const int HEAD_VERSION = 8;
   static const int COMPAT_VERSION = 2;
 
   object_t oid;
@@ -46,8 +46,11 @@ class MOSDOpReply : public Message {
   epoch_t osdmap_epoch;
   int32_t retry_attempt;
   request_redirect_t redirect;
+  __u32 queue_depth_hint;
 
 public:
+  osd_optrace_t trace;  ///< copied from the request, plus the osd stages
+
   const object_t& get_oid() const { return oid; }
   const pg_t&     get_pg() const { return pgid; }
   int      get_flags() const { return flags; }
@@ -95,6 +98,16 @@ public:
 
   void add_flags(int f) { flags |= f; }
 
+  /**
+   * queue depth hint
+   *
+   * Approximate number of ops queued on the OSD when this reply was
+   * sent; 0 if the OSD was idle or is too old to report it.  Clients
+   * can use it as a backpressure signal.
+   */
+  void set_queue_depth_hint(uint32_t d) { queue_depth_hint = d; }
+  uint32_t get_queue_depth_hint() const { return queue_depth_hint; }
+
   void claim_op_out_data(vector<OSDOp>& o) {
     assert(ops.size() == o.size());
     for (unsigned i = 0; i < o.size(); i++) {
@@ -124,10 +137,11 @@ public:
 
 public:
   MOSDOpReply()
-    : Message(CEPH_MSG_OSD_OPREPLY, HEAD_VERSION, COMPAT_VERSION) { }
+    : Message(CEPH_MSG_OSD_OPREPLY, HEAD_VERSION, COMPAT_VERSION),
+      queue_depth_hint(0) { }
   MOSDOpReply(MOSDOp *req, int r, epoch_t e, int acktype, bool ignore_out_data)
     : Message(CEPH_MSG_OSD_OPREPLY, HEAD_VERSION, COMPAT_VERSION),
-      oid(req->oid), pgid(req->pgid), ops(req->ops) {
+      oid(req->oid), pgid(req->pgid), ops(req->ops), queue_depth_hint(0) {
 
     set_tid(req->get_tid());
     result = r;
@@ -137,6 +151,11 @@ public:
     user_version = 0;
     retry_attempt = req->get_retry_attempt();
 
+    if (req->trace.enabled()) {
+      trace = req->trace;
+      trace.add(osd_optrace_t::STAGE_OSD_REPLY);
+    }
+
     // zero out ops payload_len and possibly out data
     for (unsigned i = 0; i < ops.size(); i++) {
       ops[i].op.payload_len = 0;
@@ -190,6 +209,8 @@ public:
       ::encode(replay_version, payload);
       ::encode(user_version, payload);
       ::encode(redirect, payload);
+      ::encode(trace, payload);
+      ::encode(queue_depth_hint, payload);
     }
   }
   virtual void decode_payload() {
@@ -245,6 +266,14 @@ public:
 
       if (header.version >= 6)
 	::decode(redirect, p);
+
+      if (header.version >= 7)
+	::decode(trace, p);
+
+      if (header.version >= 8)
+	::decode(queue_depth_hint, p);
+      else
+	queue_depth_hint = 0;
     }
   }
 
@@ -17,10 +17,11 @@
 #define CEPH_MOSDPGLOG_H
 
 #include "msg/Message.h"
+#include "include/ceph_features.h"
 
 class MOSDPGLog : public Message {
 
-  static const int HEAD_VERSION = 4;
+  static const int HEAD_VERSION = 5;
   static const int COMPAT_VERSION = 2;
 
   epoch_t epoch;
@@ -67,9 +68,19 @@ public:
   }
 
   void encode_payload(uint64_t features) {
+    // the v5 delta log encoding is only understood by peers with
+    // CEPH_FEATURE_OSD_PGLOG_DELTA; re-encodes for older peers fall
+    // back to the v4 per-entry layout
+    if (features & CEPH_FEATURE_OSD_PGLOG_DELTA)
+      header.version = HEAD_VERSION;
+    else
+      header.version = 4;
     ::encode(epoch, payload);
     ::encode(info, payload);
-    ::encode(log, payload);
+    if (header.version >= 5)
+      log.encode_compact(payload);
+    else
+      ::encode(log, payload);
     ::encode(missing, payload);
     ::encode(query_epoch, payload);
     ::encode(past_intervals, payload);
@@ -80,7 +91,10 @@ public:
     bufferlist::iterator p = payload.begin();
     ::decode(epoch, p);
     ::decode(info, p);
-    log.decode(p, info.pgid.pool());
+    if (header.version >= 5)
+      log.decode_compact(p);
+    else
+      log.decode(p, info.pgid.pool());
     missing.decode(p, info.pgid.pool());
     if (header.version >= 2) {
       ::decode(query_epoch, p);
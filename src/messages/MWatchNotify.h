@@ -34,7 +34,7 @@ class MWatchNotify : public Message {
 
   MWatchNotify()
     : Message(CEPH_MSG_WATCH_NOTIFY, HEAD_VERSION, COMPAT_VERSION) { }
-  MWatchNotify(uint64_t c, uint64_t v, uint64_t i, uint8_t o, bufferlist b)
+  MWatchNotify(uint64_t c, uint64_t v, uint64_t i, uint8_t o, const bufferlist& b)
     : Message(CEPH_MSG_WATCH_NOTIFY, HEAD_VERSION, COMPAT_VERSION),
       cookie(c),
       ver(v),
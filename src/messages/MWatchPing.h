@@ -0,0 +1,73 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * Copyright (C) 2004-2006 Sage Weil <sage@newdream.net>
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_MWATCHPING_H
+#define CEPH_MWATCHPING_H
+
+#include "msg/Message.h"
+
+/**
+ * Batched watch keepalive (client <-> osd)
+ *
+ * Instead of sending one CEPH_OSD_WATCH_OP_PING op per watch through
+ * the full op queue, a client may refresh every watch it holds on one
+ * OSD with a single MWatchPing listing the watch cookies.  The OSD
+ * answers with the same list plus a per-watch result: 0 if the ping was
+ * accepted, -ENOTCONN/-ETIMEDOUT if the client needs to reconnect that
+ * watch.  Each entry also carries the client's linger id, opaque to the
+ * OSD and echoed back so the client can match results without trusting
+ * the cookie.
+ */
+class MWatchPing : public Message {
+  static const int HEAD_VERSION = 1;
+
+public:
+  bool reply;          ///< false = ping, true = response
+  utime_t stamp;       ///< sender's send time, echoed in the response
+  vector<pair<uint64_t, uint64_t> > watches;  ///< (cookie, linger id)
+  vector<int32_t> results;   ///< response only; parallel to watches
+
+  MWatchPing()
+    : Message(MSG_OSD_WATCH_PING, HEAD_VERSION),
+      reply(false) { }
+  MWatchPing(bool reply, utime_t stamp)
+    : Message(MSG_OSD_WATCH_PING, HEAD_VERSION),
+      reply(reply),
+      stamp(stamp) { }
+private:
+  ~MWatchPing() {}
+
+public:
+  void decode_payload() {
+    bufferlist::iterator p = payload.begin();
+    ::decode(reply, p);
+    ::decode(stamp, p);
+    ::decode(watches, p);
+    ::decode(results, p);
+  }
+  void encode_payload(uint64_t features) {
+    ::encode(reply, payload);
+    ::encode(stamp, payload);
+    ::encode(watches, payload);
+    ::encode(results, payload);
+  }
+
+  const char *get_type_name() const { return "watch-ping"; }
+  void print(ostream& out) const {
+    out << "watch_ping(" << (reply ? "reply " : "")
+	<< watches.size() << " watches stamp " << stamp << ")";
+  }
+};
+
+#endif
@@ -343,15 +343,46 @@ bool LogMonitor::prepare_log(MonOpRequestRef op)
     return false;
   }
 
+  source_bucket_t *bucket = NULL;
+  double rate = g_conf->mon_cluster_log_source_rate;
+  if (rate > 0) {
+    utime_t now = ceph_clock_now(g_ceph_context);
+    bucket = &source_buckets[m->get_orig_source_inst()];
+    bucket->tokens += rate * (double)(now - bucket->last);
+    if (bucket->tokens > g_conf->mon_cluster_log_source_burst)
+      bucket->tokens = g_conf->mon_cluster_log_source_burst;
+    bucket->last = now;
+  }
+
+  int num_new = 0, num_dropped = 0;
   for (deque<LogEntry>::iterator p = m->entries.begin();
        p != m->entries.end();
        ++p) {
     dout(10) << " logging " << *p << dendl;
     if (!pending_summary.contains(p->key())) {
+      if (bucket) {
+	if (bucket->tokens < 1.0) {
+	  num_dropped++;
+	  continue;
+	}
+	bucket->tokens -= 1.0;
+      }
       pending_summary.add(*p);
       pending_log.insert(pair<utime_t,LogEntry>(p->stamp, *p));
+      num_new++;
     }
   }
+  if (num_dropped)
+    dout(1) << "prepare_log dropped " << num_dropped << " entries from "
+	    << m->get_orig_source_inst() << " (rate limited)" << dendl;
+
+  if (!num_new) {
+    // everything was a duplicate or rate limited; ack so the sender
+    // clears its queue, and skip the paxos round entirely
+    mon->send_reply(op, new MLogAck(m->fsid, m->entries.rbegin()->seq));
+    return false;
+  }
+
   wait_for_finished_proposal(op, new C_Log(this, op));
   return true;
 }
@@ -36,6 +36,20 @@ private:
   multimap<utime_t,LogEntry> pending_log;
   LogSummary pending_summary, summary;
 
+  /**
+   * Token bucket per log source, so one spamming daemon can't drive
+   * paxos commit traffic for everyone.  Refilled at
+   * mon_cluster_log_source_rate entries/sec up to a burst of
+   * mon_cluster_log_source_burst; entries that find the bucket empty
+   * are dropped (but still acked, so the sender doesn't resend them).
+   */
+  struct source_bucket_t {
+    utime_t last;
+    double tokens;
+    source_bucket_t() : tokens(0) {}
+  };
+  map<entity_inst_t, source_bucket_t> source_buckets;
+
   struct log_channel_info {
 
     map<string,string> log_to_syslog;
@@ -736,10 +736,17 @@ void MonClient::tick()
 
 void MonClient::schedule_tick()
 {
-  if (hunting)
-    timer.add_event_after(cct->_conf->mon_client_hunt_interval
-                          * reopen_interval_multiplier, new C_Tick(this));
-  else
+  if (hunting) {
+    double interval = cct->_conf->mon_client_hunt_interval
+                      * reopen_interval_multiplier;
+    double jitter = cct->_conf->mon_client_hunt_interval_jitter;
+    if (jitter > 0) {
+      // spread simultaneously restarted clients apart, so a mass
+      // cold-start doesn't rehunt (and reauthenticate) in lockstep
+      interval *= 1.0 + jitter * (2.0 * (rng() / (double)0xffffffffu) - 1.0);
+    }
+    timer.add_event_after(interval, new C_Tick(this));
+  } else
     timer.add_event_after(cct->_conf->mon_client_ping_interval, new C_Tick(this));
 }
 
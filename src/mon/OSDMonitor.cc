@@ -2309,6 +2309,26 @@ MOSDMap *OSDMonitor::build_latest_full()
   return r;
 }
 
+int OSDMonitor::get_version(version_t ver, bufferlist& bl)
+{
+  if (inc_osd_cache.lookup(ver, &bl))
+    return 0;
+  int ret = PaxosService::get_version(ver, bl);
+  if (!ret)
+    inc_osd_cache.add(ver, bl);
+  return ret;
+}
+
+int OSDMonitor::get_version_full(version_t ver, bufferlist& bl)
+{
+  if (full_osd_cache.lookup(ver, &bl))
+    return 0;
+  int ret = PaxosService::get_version_full(ver, bl);
+  if (!ret)
+    full_osd_cache.add(ver, bl);
+  return ret;
+}
+
 MOSDMap *OSDMonitor::build_incremental(epoch_t from, epoch_t to)
 {
   dout(10) << "build_incremental [" << from << ".." << to << "]" << dendl;
@@ -2815,7 +2835,8 @@ namespace {
     CACHE_TARGET_FULL_RATIO,
     CACHE_MIN_FLUSH_AGE, CACHE_MIN_EVICT_AGE,
     ERASURE_CODE_PROFILE, MIN_READ_RECENCY_FOR_PROMOTE,
-    WRITE_FADVISE_DONTNEED, MIN_WRITE_RECENCY_FOR_PROMOTE};
+    WRITE_FADVISE_DONTNEED, MIN_WRITE_RECENCY_FOR_PROMOTE,
+    COMPRESS, COMPRESS_ALGORITHM, COMPRESS_LEVEL};
 
   std::set<osd_pool_get_choices>
     subtract_second_from_first(const std::set<osd_pool_get_choices>& first,
@@ -3267,7 +3288,10 @@ bool OSDMonitor::preprocess_command(MonOpRequestRef op)
       ("erasure_code_profile", ERASURE_CODE_PROFILE)
       ("min_read_recency_for_promote", MIN_READ_RECENCY_FOR_PROMOTE)
       ("write_fadvise_dontneed", WRITE_FADVISE_DONTNEED)
-      ("min_write_recency_for_promote", MIN_WRITE_RECENCY_FOR_PROMOTE);
+      ("min_write_recency_for_promote", MIN_WRITE_RECENCY_FOR_PROMOTE)
+      ("compress", COMPRESS)
+      ("compress_algorithm", COMPRESS_ALGORITHM)
+      ("compress_level", COMPRESS_LEVEL);
 
     typedef std::set<osd_pool_get_choices> choices_set_t;
 
@@ -3420,6 +3444,17 @@ bool OSDMonitor::preprocess_command(MonOpRequestRef op)
 	    f->dump_int("min_write_recency_for_promote",
 			p->min_write_recency_for_promote);
 	    break;
+	  case COMPRESS:
+	    f->dump_string("compress",
+			   p->has_flag(pg_pool_t::FLAG_COMPRESS) ?
+			   "true" : "false");
+	    break;
+	  case COMPRESS_ALGORITHM:
+	    f->dump_string("compress_algorithm", p->compression_algorithm);
+	    break;
+	  case COMPRESS_LEVEL:
+	    f->dump_int("compress_level", p->compression_level);
+	    break;
 	}
 	f->close_section();
 	f->flush(rdata);
@@ -3515,6 +3550,17 @@ bool OSDMonitor::preprocess_command(MonOpRequestRef op)
 	    ss << "min_write_recency_for_promote: " <<
 	      p->min_write_recency_for_promote << "\n";
 	    break;
+	  case COMPRESS:
+	    ss << "compress: " <<
+	      (p->has_flag(pg_pool_t::FLAG_COMPRESS) ?
+	       "true" : "false") << "\n";
+	    break;
+	  case COMPRESS_ALGORITHM:
+	    ss << "compress_algorithm: " << p->compression_algorithm << "\n";
+	    break;
+	  case COMPRESS_LEVEL:
+	    ss << "compress_level: " << p->compression_level << "\n";
+	    break;
 	}
 	rdata.append(ss.str());
 	ss.str("");
@@ -4714,7 +4760,11 @@ int OSDMonitor::prepare_command_pool_set(map<string,cmd_vartype> &cmdmap,
     }
     p.crush_ruleset = n;
   } else if (var == "hashpspool" || var == "nodelete" || var == "nopgchange" ||
-	     var == "nosizechange") {
+	     var == "nosizechange" || var == "compress") {
+    if (var == "compress" && p.is_erasure()) {
+      ss << "compress is only supported on replicated pools";
+      return -EINVAL;
+    }
     uint64_t flag = pg_pool_t::get_flag_by_name(var);
     // make sure we only compare against 'n' if we didn't receive a string
     if (val == "true" || (interr.empty() && n == 1)) {
@@ -4848,6 +4898,23 @@ int OSDMonitor::prepare_command_pool_set(map<string,cmd_vartype> &cmdmap,
       return -EINVAL;
     }
     p.min_write_recency_for_promote = n;
+  } else if (var == "compress_algorithm") {
+    if (p.is_erasure()) {
+      ss << "compress_algorithm is only supported on replicated pools";
+      return -EINVAL;
+    }
+    if (val != "snappy" && val != "lz4" && val != "zstd") {
+      ss << "unrecognized compression algorithm '" << val
+	 << "' (snappy, lz4 or zstd)";
+      return -EINVAL;
+    }
+    p.compression_algorithm = val;
+  } else if (var == "compress_level") {
+    if (interr.length()) {
+      ss << "error parsing integer value '" << val << "': " << interr;
+      return -EINVAL;
+    }
+    p.compression_level = n;
   } else {
     ss << "unrecognized variable '" << var << "'";
     return -EINVAL;
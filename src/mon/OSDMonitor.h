@@ -43,6 +43,7 @@ class PGMap;
 
 #include "erasure-code/ErasureCodeInterface.h"
 
+#include "common/simple_cache.hpp"
 #include "common/TrackedOp.h"
 #include "mon/MonOpRequest.h"
 
@@ -136,6 +137,15 @@ private:
 
   map<int,double> osd_weight;
 
+  /*
+   * cache the encoded incremental and full map blobs we last read from
+   * the store; during flapping every osd and client asks for the same
+   * epochs, and the blobs are immutable once committed, so we can serve
+   * repeats without hitting leveldb per subscriber.
+   */
+  SimpleLRU<version_t, bufferlist> inc_osd_cache;
+  SimpleLRU<version_t, bufferlist> full_osd_cache;
+
   void check_failures(utime_t now);
   bool check_failure(utime_t now, int target_osd, failure_info_t& fi);
 
@@ -389,10 +399,16 @@ private:
  public:
   OSDMonitor(CephContext *cct, Monitor *mn, Paxos *p, string service_name)
   : PaxosService(mn, p, service_name),
+    inc_osd_cache(g_conf->mon_osd_cache_size),
+    full_osd_cache(g_conf->mon_osd_cache_size),
     thrash_map(0), thrash_last_up_osd(-1),
     op_tracker(cct, true, 1)
   { }
 
+  // cache-aware variants; shadow the PaxosService raw store reads
+  int get_version(version_t ver, bufferlist& bl);
+  int get_version_full(version_t ver, bufferlist& bl);
+
   void tick();  // check state, take actions
 
   int parse_osd_id(const char *s, stringstream *pss);
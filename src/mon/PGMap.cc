@@ -947,6 +947,70 @@ void PGMap::get_stuck_stats(int types, utime_t cutoff,
   }
 }
 
+/*
+ * counts for all five stuck categories in a single pass over pg_stat,
+ * for callers (health summary) that only need the totals and would
+ * otherwise scan once per category
+ */
+void PGMap::get_stuck_counts(utime_t cutoff, map<string,int>& note) const
+{
+  // the scan is O(pg) and health is polled constantly; reuse the last
+  // answer while the map and the cutoff second are unchanged
+  if (version == cached_stuck_version &&
+      cutoff.sec() == cached_stuck_cutoff.sec()) {
+    for (map<string,int>::const_iterator p = cached_stuck_counts.begin();
+	 p != cached_stuck_counts.end();
+	 ++p)
+      note[p->first] = p->second;
+    return;
+  }
+
+  int inactive = 0, unclean = 0, degraded = 0, undersized = 0, stale = 0;
+  for (ceph::unordered_map<pg_t, pg_stat_t>::const_iterator i = pg_stat.begin();
+       i != pg_stat.end();
+       ++i) {
+    if (! (i->second.state & PG_STATE_ACTIVE)) {
+      if (i->second.last_active < cutoff)
+        ++inactive;
+    }
+    if (! (i->second.state & PG_STATE_CLEAN)) {
+      if (i->second.last_clean < cutoff)
+        ++unclean;
+    }
+    if (i->second.state & PG_STATE_DEGRADED) {
+      if (i->second.last_undegraded < cutoff)
+        ++degraded;
+    }
+    if (i->second.state & PG_STATE_UNDERSIZED) {
+      if (i->second.last_fullsized < cutoff)
+        ++undersized;
+    }
+    if (i->second.state & PG_STATE_STALE) {
+      if (i->second.last_unstale < cutoff)
+        ++stale;
+    }
+  }
+
+  cached_stuck_counts.clear();
+  if (inactive)
+    cached_stuck_counts["stuck inactive"] = inactive;
+  if (unclean)
+    cached_stuck_counts["stuck unclean"] = unclean;
+  if (undersized)
+    cached_stuck_counts["stuck undersized"] = undersized;
+  if (degraded)
+    cached_stuck_counts["stuck degraded"] = degraded;
+  if (stale)
+    cached_stuck_counts["stuck stale"] = stale;
+  cached_stuck_version = version;
+  cached_stuck_cutoff = cutoff;
+
+  for (map<string,int>::const_iterator p = cached_stuck_counts.begin();
+       p != cached_stuck_counts.end();
+       ++p)
+    note[p->first] = p->second;
+}
+
 void PGMap::dump_stuck(Formatter *f, int types, utime_t cutoff) const
 {
   ceph::unordered_map<pg_t, pg_stat_t> stuck_pg_stats;
@@ -1413,6 +1477,23 @@ void PGMap::clear_delta()
 }
 
 void PGMap::print_summary(Formatter *f, ostream *out) const
+{
+  if (!f && out) {
+    // everything below is derived from state that only moves when the
+    // map version does, so the rendered text can be reused until then
+    if (version != cached_summary_version) {
+      std::ostringstream os;
+      print_summary_(NULL, &os);
+      cached_summary = os.str();
+      cached_summary_version = version;
+    }
+    *out << cached_summary;
+    return;
+  }
+  print_summary_(f, out);
+}
+
+void PGMap::print_summary_(Formatter *f, ostream *out) const
 {
   std::stringstream ss;
   if (f)
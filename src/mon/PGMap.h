@@ -123,6 +123,15 @@ public:
   ceph::unordered_map<int,int> blocked_by_sum;
   ceph::unordered_map<int,set<pg_t> > pg_by_osd;
 
+  // query-side caches.  status and health are polled every few seconds
+  // by monitoring; remember what we computed for this map version
+  // instead of redoing it per request
+  mutable version_t cached_stuck_version;
+  mutable utime_t cached_stuck_cutoff;
+  mutable map<string,int> cached_stuck_counts;
+  mutable version_t cached_summary_version;
+  mutable string cached_summary;
+
   utime_t stamp;
 
   // recent deltas, and summation
@@ -197,7 +206,9 @@ public:
       full_ratio(0), nearfull_ratio(0),
       num_pg(0),
       num_osd(0),
-      min_last_epoch_clean(0)
+      min_last_epoch_clean(0),
+      cached_stuck_version((version_t)-1),
+      cached_summary_version((version_t)-1)
   {}
 
   void set_full_ratios(float full, float nearfull) {
@@ -284,6 +295,7 @@ public:
 			   bool brief) const;
   void get_stuck_stats(int types, utime_t cutoff,
 		       ceph::unordered_map<pg_t, pg_stat_t>& stuck_pgs) const;
+  void get_stuck_counts(utime_t cutoff, map<string,int>& note) const;
   void dump_stuck(Formatter *f, int types, utime_t cutoff) const;
   void dump_stuck_plain(ostream& ss, int types, utime_t cutoff) const;
 
@@ -355,6 +367,7 @@ public:
                                   uint64_t poolid) const;
 
   void print_summary(Formatter *f, ostream *out) const;
+  void print_summary_(Formatter *f, ostream *out) const;
   void print_oneline_summary(Formatter *f, ostream *out) const;
 
   epoch_t get_min_last_epoch_clean() const {
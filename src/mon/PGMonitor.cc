@@ -1986,43 +1986,44 @@ void PGMonitor::get_health(list<pair<health_status_t,string> >& summary,
   utime_t now(ceph_clock_now(g_ceph_context));
   utime_t cutoff = now - utime_t(g_conf->mon_pg_stuck_threshold, 0);
 
-  pg_map.get_stuck_stats(PGMap::STUCK_INACTIVE, cutoff, stuck_pgs);
-  if (!stuck_pgs.empty()) {
-    note["stuck inactive"] = stuck_pgs.size();
-    if (detail)
+  if (!detail) {
+    // the health summary only needs the totals; get all five stuck
+    // categories in one pass instead of scanning pg_stat per category
+    pg_map.get_stuck_counts(cutoff, note);
+  } else {
+    pg_map.get_stuck_stats(PGMap::STUCK_INACTIVE, cutoff, stuck_pgs);
+    if (!stuck_pgs.empty()) {
+      note["stuck inactive"] = stuck_pgs.size();
       note_stuck_detail(PGMap::STUCK_INACTIVE, stuck_pgs, detail);
-  }
-  stuck_pgs.clear();
+    }
+    stuck_pgs.clear();
 
-  pg_map.get_stuck_stats(PGMap::STUCK_UNCLEAN, cutoff, stuck_pgs);
-  if (!stuck_pgs.empty()) {
-    note["stuck unclean"] = stuck_pgs.size();
-    if (detail)
+    pg_map.get_stuck_stats(PGMap::STUCK_UNCLEAN, cutoff, stuck_pgs);
+    if (!stuck_pgs.empty()) {
+      note["stuck unclean"] = stuck_pgs.size();
       note_stuck_detail(PGMap::STUCK_UNCLEAN, stuck_pgs, detail);
-  }
-  stuck_pgs.clear();
+    }
+    stuck_pgs.clear();
 
-  pg_map.get_stuck_stats(PGMap::STUCK_UNDERSIZED, cutoff, stuck_pgs);
-  if (!stuck_pgs.empty()) {
-    note["stuck undersized"] = stuck_pgs.size();
-    if (detail)
+    pg_map.get_stuck_stats(PGMap::STUCK_UNDERSIZED, cutoff, stuck_pgs);
+    if (!stuck_pgs.empty()) {
+      note["stuck undersized"] = stuck_pgs.size();
       note_stuck_detail(PGMap::STUCK_UNDERSIZED, stuck_pgs, detail);
-  }
-  stuck_pgs.clear();
+    }
+    stuck_pgs.clear();
 
-  pg_map.get_stuck_stats(PGMap::STUCK_DEGRADED, cutoff, stuck_pgs);
-  if (!stuck_pgs.empty()) {
-    note["stuck degraded"] = stuck_pgs.size();
-    if (detail)
+    pg_map.get_stuck_stats(PGMap::STUCK_DEGRADED, cutoff, stuck_pgs);
+    if (!stuck_pgs.empty()) {
+      note["stuck degraded"] = stuck_pgs.size();
       note_stuck_detail(PGMap::STUCK_DEGRADED, stuck_pgs, detail);
-  }
-  stuck_pgs.clear();
+    }
+    stuck_pgs.clear();
 
-  pg_map.get_stuck_stats(PGMap::STUCK_STALE, cutoff, stuck_pgs);
-  if (!stuck_pgs.empty()) {
-    note["stuck stale"] = stuck_pgs.size();
-    if (detail)
+    pg_map.get_stuck_stats(PGMap::STUCK_STALE, cutoff, stuck_pgs);
+    if (!stuck_pgs.empty()) {
+      note["stuck stale"] = stuck_pgs.size();
       note_stuck_detail(PGMap::STUCK_STALE, stuck_pgs, detail);
+    }
   }
 
   if (!note.empty()) {
@@ -1204,8 +1204,24 @@ void Paxos::trim()
   }
   t->put(get_name(), "first_committed", end);
   if (g_conf->mon_compact_on_trim) {
-    dout(10) << " compacting trimmed range" << dendl;
-    t->compact_range(get_name(), stringify(first_committed - 1), stringify(end));
+    // during heavy churn we trim every few commits, and compacting every
+    // trimmed range keeps leveldb permanently busy and stalls commits.
+    // batch the trimmed ranges and compact the accumulated range at most
+    // every mon_compact_on_trim_interval seconds (0 = every trim).
+    if (trim_compact_first == 0)
+      trim_compact_first = first_committed;
+    utime_t now = ceph_clock_now(NULL);
+    if (now - last_trim_compact >= g_conf->mon_compact_on_trim_interval) {
+      dout(10) << " compacting trimmed range [" << trim_compact_first
+	       << "," << end << ")" << dendl;
+      t->compact_range(get_name(), stringify(trim_compact_first - 1),
+		       stringify(end));
+      last_trim_compact = now;
+      trim_compact_first = 0;
+    } else {
+      dout(10) << " deferring compaction of trimmed range ["
+	       << trim_compact_first << "," << end << ")" << dendl;
+    }
   }
 
   trimming = true;
@@ -619,6 +619,14 @@ private:
    */
   bool trimming;
 
+  /**
+   * Start of the trimmed-but-not-yet-compacted range, and when we last
+   * scheduled a trim compaction, so trim() can pace the compactions
+   * instead of queueing one per trim.
+   */
+  version_t trim_compact_first;
+  utime_t last_trim_compact;
+
   /**
    * @defgroup Paxos_h_callbacks Callback classes.
    * @{
@@ -1106,7 +1114,8 @@ public:
 		   lease_timeout_event(0),
 		   accept_timeout_event(0),
 		   clock_drift_warned(0),
-		   trimming(false) { }
+		   trimming(false),
+		   trim_compact_first(0) { }
 
   const string get_name() const {
     return paxos_name;
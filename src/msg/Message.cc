@@ -15,6 +15,8 @@ using namespace std;
 
 #include "Message.h"
 
+#include "compressor/SnappyCompressor.h"
+
 #include "messages/MPGStats.h"
 
 #include "messages/MGenericMessage.h"
@@ -157,6 +159,7 @@ using namespace std;
 #include "messages/MLock.h"
 
 #include "messages/MWatchNotify.h"
+#include "messages/MWatchPing.h"
 #include "messages/MTimeCheck.h"
 
 #include "common/config.h"
@@ -249,6 +252,32 @@ void Message::dump(Formatter *f) const
   f->dump_string("summary", ss.str());
 }
 
+bool compress_message_data(CephContext *cct, int crcflags,
+			   ceph_msg_header &header,
+			   ceph_msg_footer &footer,
+			   bufferlist &data)
+{
+  SnappyCompressor cs;
+  bufferlist compressed;
+  if (cs.compress(data, compressed) < 0 ||
+      compressed.length() >= data.length()) {
+    ldout(cct, 20) << __func__ << " " << data.length()
+		   << " bytes did not shrink, sending raw" << dendl;
+    return false;
+  }
+  ldout(cct, 20) << __func__ << " " << data.length() << " -> "
+		 << compressed.length() << dendl;
+  data.swap(compressed);
+  header.data_len = data.length();
+  if (crcflags & MSG_CRC_HEADER)
+    header.crc = ceph_crc32c(0, (unsigned char*)&header,
+			     sizeof(header) - sizeof(header.crc));
+  if (crcflags & MSG_CRC_DATA)
+    footer.data_crc = data.crc32c(0);
+  footer.flags = (unsigned)footer.flags | CEPH_MSG_FOOTER_COMPRESSED;
+  return true;
+}
+
 Message *decode_message(CephContext *cct, int crcflags,
 			ceph_msg_header& header,
 			ceph_msg_footer& footer,
@@ -294,6 +323,22 @@ Message *decode_message(CephContext *cct, int crcflags,
     }
   }
 
+  // the crcs above cover the wire (compressed) bytes; only now recover
+  // the original data segment
+  if (footer.flags & CEPH_MSG_FOOTER_COMPRESSED) {
+    bufferlist raw;
+    SnappyCompressor cs;
+    if (cs.decompress(data, raw) < 0) {
+      if (cct)
+	ldout(cct, 0) << "failed to decompress " << data.length()
+		      << " byte data segment" << dendl;
+      return 0;
+    }
+    data.swap(raw);
+    header.data_len = data.length();
+    footer.flags = (unsigned)footer.flags & ~CEPH_MSG_FOOTER_COMPRESSED;
+  }
+
   // make message
   Message *m = 0;
   int type = header.type;
@@ -446,6 +491,10 @@ Message *decode_message(CephContext *cct, int crcflags,
     m = new MWatchNotify;
     break;
 
+  case MSG_OSD_WATCH_PING:
+    m = new MWatchPing;
+    break;
+
   case MSG_OSD_PG_NOTIFY:
     m = new MOSDPGNotify;
     break;
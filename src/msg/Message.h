@@ -117,6 +117,8 @@
 #define MSG_OSD_REPOP         112
 #define MSG_OSD_REPOPREPLY    113
 
+#define MSG_OSD_WATCH_PING    114
+
 
 // *** MDS ***
 
@@ -464,6 +466,18 @@ extern Message *decode_message(CephContext *cct, int crcflags,
 			       ceph_msg_header &header,
 			       ceph_msg_footer& footer, bufferlist& front,
 			       bufferlist& middle, bufferlist& data);
+
+/**
+ * Compress the data segment of an already encoded message in place,
+ * patching data_len and the crcs in the caller's copies of the header
+ * and footer.  Returns false (and leaves everything untouched) if the
+ * data did not shrink.  The wire codec is fixed to snappy: the peer
+ * only advertises CEPH_FEATURE_MSG_COMPRESS, not a codec choice.
+ */
+extern bool compress_message_data(CephContext *cct, int crcflags,
+				  ceph_msg_header &header,
+				  ceph_msg_footer &footer,
+				  bufferlist &data);
 inline ostream& operator<<(ostream& out, Message& m) {
   m.print(out);
   if (m.get_header().version)
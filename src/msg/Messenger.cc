@@ -4,12 +4,100 @@
 #include "include/types.h"
 #include "Messenger.h"
 
+#include "common/admin_socket.h"
+#include "common/ceph_context.h"
+#include "common/Cycles.h"
+#include "common/Formatter.h"
 #include "msg/simple/SimpleMessenger.h"
 #include "msg/async/AsyncMessenger.h"
 #ifdef HAVE_XIO
 #include "msg/xio/XioMessenger.h"
 #endif
 
+void ConnectionStats::dump(ceph::Formatter *f) const
+{
+  f->dump_unsigned("in_msgs", in_msgs.read());
+  f->dump_unsigned("in_bytes", in_bytes.read());
+  f->dump_unsigned("out_msgs", out_msgs.read());
+  f->dump_unsigned("out_bytes", out_bytes.read());
+  f->dump_unsigned("out_q_len", out_q_len.read());
+  f->dump_unsigned("out_q_max", out_q_max.read());
+  uint64_t stall = throttle_stall_cycles.read();
+  f->dump_unsigned("throttle_stall_cycles", stall);
+  f->dump_float("throttle_stall_seconds", Cycles::to_seconds(stall));
+}
+
+/**
+ * Process-wide registry of messengers backing the "dump_conn_stats"
+ * admin socket command.  A process can hold several messengers on one
+ * CephContext (e.g. the OSD's public, cluster and heartbeat
+ * messengers), so the command is registered once per context and the
+ * hook walks every live messenger.
+ */
+class MsgrConnStatsHook : public CephContext::AssociatedSingletonObject,
+			  public AdminSocketHook {
+  CephContext *cct;
+  Mutex lock;
+  set<Messenger*> msgrs;
+
+ public:
+  MsgrConnStatsHook(CephContext *c)
+    : cct(c), lock("MsgrConnStatsHook::lock") {
+    cct->get_admin_socket()->register_command(
+      "dump_conn_stats", "dump_conn_stats", this,
+      "show per-connection messenger traffic statistics");
+  }
+  ~MsgrConnStatsHook() {
+    cct->get_admin_socket()->unregister_command("dump_conn_stats");
+  }
+  void add(Messenger *m) {
+    Mutex::Locker l(lock);
+    msgrs.insert(m);
+  }
+  void remove(Messenger *m) {
+    Mutex::Locker l(lock);
+    msgrs.erase(m);
+  }
+  bool call(std::string command, cmdmap_t& cmdmap, std::string format,
+	    bufferlist& out) {
+    ceph::Formatter *f = ceph::Formatter::create(format, "json-pretty",
+						 "json-pretty");
+    f->open_array_section("messengers");
+    {
+      Mutex::Locker l(lock);
+      for (set<Messenger*>::iterator p = msgrs.begin();
+	   p != msgrs.end();
+	   ++p) {
+	f->open_object_section("messenger");
+	f->dump_stream("name") << (*p)->get_myname();
+	f->dump_stream("addr") << (*p)->get_myaddr();
+	(*p)->dump_conn_stats(f);
+	f->close_section();
+      }
+    }
+    f->close_section();
+    f->flush(out);
+    delete f;
+    return true;
+  }
+};
+
+void Messenger::register_conn_stats_hook()
+{
+  MsgrConnStatsHook *hook;
+  cct->lookup_or_create_singleton_object<MsgrConnStatsHook>(
+    hook, "msgr_conn_stats_hook");
+  hook->add(this);
+}
+
+void Messenger::unregister_conn_stats_hook()
+{
+  MsgrConnStatsHook *hook;
+  cct->lookup_or_create_singleton_object<MsgrConnStatsHook>(
+    hook, "msgr_conn_stats_hook");
+  hook->remove(this);
+}
+
 Messenger *Messenger::create(CephContext *cct, const string &type,
 			     entity_name_t name, string lname,
 			     uint64_t nonce, uint64_t features)
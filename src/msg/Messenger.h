@@ -22,6 +22,7 @@ using namespace std;
 
 #include "Message.h"
 #include "Dispatcher.h"
+#include "include/atomic.h"
 #include "common/Mutex.h"
 #include "common/Cond.h"
 #include "include/Context.h"
@@ -36,12 +37,43 @@ using namespace std;
 
 class Timer;
 
+/**
+ * Always-on per-connection traffic counters.
+ *
+ * Transports keep one of these per connection and update it on their
+ * fast paths with single atomic ops, so it is cheap enough to leave
+ * enabled in production.  The "dump_conn_stats" admin socket command
+ * samples them, so a peer responsible for an ingress or egress spike
+ * can be identified without resorting to tcpdump.
+ */
+struct ConnectionStats {
+  atomic64_t in_msgs, in_bytes;      ///< messages/bytes received
+  atomic64_t out_msgs, out_bytes;    ///< messages/bytes sent
+  atomic64_t out_q_len;              ///< messages currently queued for send
+  atomic64_t out_q_max;              ///< high-water mark of out_q_len
+  /// rdtsc cycles the reader spent stalled on the policy/dispatch throttles
+  atomic64_t throttle_stall_cycles;
+
+  /// note that @p n messages were queued and update the high-water mark
+  void queued(uint64_t n=1) {
+    out_q_len.add(n);
+    uint64_t l = out_q_len.read();
+    if (l > out_q_max.read())   // racy, but these are only statistics
+      out_q_max.set(l);
+  }
+  void dump(ceph::Formatter *f) const;
+};
 
 class Messenger {
 private:
   list<Dispatcher*> dispatchers;
   list <Dispatcher*> fast_dispatchers;
 
+  /// add/remove this messenger in the process-wide registry backing
+  /// the "dump_conn_stats" admin socket command
+  void register_conn_stats_hook();
+  void unregister_conn_stats_hook();
+
 protected:
   /// the "name" of the local daemon. eg client.99
   entity_inst_t my_inst;
@@ -74,6 +106,9 @@ public:
     bool standby;
     /// If true, we will try to detect session resets
     bool resetcheck;
+    /// If true, compress message data when the peer supports it.
+    /// Meant for WAN-facing connections where bandwidth is worth the CPU.
+    bool compress;
     /**
      *  The throttler is used to limit how much data is held by Messages from
      *  the associated Connection(s). When reading in a new Message, the Messenger
@@ -89,6 +124,7 @@ public:
 
     Policy()
       : lossy(false), server(false), standby(false), resetcheck(true),
+	compress(false),
 	throttler_bytes(NULL),
 	throttler_messages(NULL),
 	features_supported(CEPH_FEATURES_SUPPORTED_DEFAULT),
@@ -96,6 +132,7 @@ public:
   private:
     Policy(bool l, bool s, bool st, bool r, uint64_t sup, uint64_t req)
       : lossy(l), server(s), standby(st), resetcheck(r),
+	compress(false),
 	throttler_bytes(NULL),
 	throttler_messages(NULL),
 	features_supported(sup | CEPH_FEATURES_SUPPORTED_DEFAULT),
@@ -136,8 +173,11 @@ public:
       crcflags(get_default_crc_flags(cct->_conf))
   {
     my_inst.name = w;
+    register_conn_stats_hook();
+  }
+  virtual ~Messenger() {
+    unregister_conn_stats_hook();
   }
-  virtual ~Messenger() {}
 
   /**
    * create a new messenger
@@ -229,6 +269,14 @@ public:
    * (0 if the queue is empty)
    */
   virtual double get_dispatch_queue_max_age(utime_t now) = 0;
+
+  /**
+   * Dump the always-on per-connection traffic counters (see
+   * ConnectionStats) for every connection this messenger holds.
+   * Transports that do not keep them may leave this a no-op.
+   */
+  virtual void dump_conn_stats(ceph::Formatter *f) {}
+
   /**
    * Get the default crc flags for this messenger.
    * but not yet dispatched.
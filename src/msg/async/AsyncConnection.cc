@@ -19,6 +19,7 @@
 #include <unistd.h>
 
 #include "include/Context.h"
+#include "common/Cycles.h"
 #include "common/errno.h"
 #include "AsyncMessenger.h"
 #include "AsyncConnection.h"
@@ -178,7 +179,8 @@ AsyncConnection::AsyncConnection(CephContext *cct, AsyncMessenger *m, EventCente
     write_lock("AsyncConnection::write_lock"), can_write(NOWRITE),
     open_write(false), keepalive(false), lock("AsyncConnection::lock"), recv_buf(NULL),
     recv_max_prefetch(MIN(msgr->cct->_conf->ms_tcp_prefetch_max_size, TCP_PREFETCH_MIN_SIZE)),
-    recv_start(0), recv_end(0), got_bad_auth(false), authorizer(NULL), replacing(false),
+    recv_start(0), recv_end(0), throttle_stall_start(0),
+    got_bad_auth(false), authorizer(NULL), replacing(false),
     is_reset_from_peer(false), once_ready(false), state_buffer(NULL), state_offset(0), net(cct), center(c)
 {
   read_handler.reset(new C_handle_read(this));
@@ -199,6 +201,7 @@ AsyncConnection::~AsyncConnection()
 {
   assert(out_q.empty());
   assert(sent.empty());
+  async_msgr->release_worker(center);
   delete authorizer;
   if (recv_buf)
     delete[] recv_buf;
@@ -358,7 +361,7 @@ int AsyncConnection::_try_send(bufferlist &send_bl, bool send)
 //
 // return the remaining bytes, 0 means this buffer is finished
 // else return < 0 means error
-int AsyncConnection::read_until(uint64_t len, char *p)
+int AsyncConnection::read_until(uint64_t len, char *p, bool prefetch)
 {
   ldout(async_msgr->cct, 25) << __func__ << " len is " << len << " state_offset is "
                              << state_offset << dendl;
@@ -388,8 +391,10 @@ int AsyncConnection::read_until(uint64_t len, char *p)
 
   recv_end = recv_start = 0;
   /* nothing left in the prefetch buffer */
-  if (len > recv_max_prefetch) {
-    /* this was a large read, we don't prefetch for these */
+  if (len > recv_max_prefetch || !prefetch) {
+    /* large read, or the caller owns a destination buffer (message data
+     * payload): read straight into it instead of bouncing through
+     * recv_buf, which would just add a memcpy */
     do {
       r = read_bulk(sd, p+state_offset, left);
       ldout(async_msgr->cct, 25) << __func__ << " read_bulk left is " << left << " got " << r << dendl;
@@ -604,6 +609,8 @@ void AsyncConnection::process()
               ldout(async_msgr->cct, 1) << __func__ << " wants 1 message from policy throttle "
                                         << policy.throttler_messages->get_current() << "/"
                                         << policy.throttler_messages->get_max() << " failed, just wait." << dendl;
+              if (!throttle_stall_start)
+                throttle_stall_start = Cycles::rdtsc();
               // following thread pool deal with th full message queue isn't a
               // short time, so we can wait a ms.
               if (register_time_events.empty())
@@ -628,6 +635,8 @@ void AsyncConnection::process()
                 ldout(async_msgr->cct, 10) << __func__ << " wants " << message_size << " bytes from policy throttler "
                                            << policy.throttler_bytes->get_current() << "/"
                                            << policy.throttler_bytes->get_max() << " failed, just wait." << dendl;
+                if (!throttle_stall_start)
+                  throttle_stall_start = Cycles::rdtsc();
                 // following thread pool deal with th full message queue isn't a
                 // short time, so we can wait a ms.
                 if (register_time_events.empty())
@@ -637,6 +646,11 @@ void AsyncConnection::process()
             }
           }
 
+          if (throttle_stall_start) {
+            conn_stats.throttle_stall_cycles.add(Cycles::rdtsc() - throttle_stall_start);
+            throttle_stall_start = 0;
+          }
+
           throttle_stamp = ceph_clock_now(msgr->cct);
           state = STATE_OPEN_MESSAGE_READ_FRONT;
           break;
@@ -722,7 +736,10 @@ void AsyncConnection::process()
           while (msg_left > 0) {
             bufferptr bp = data_blp.get_current_ptr();
             uint64_t read = MIN(bp.length(), msg_left);
-            r = read_until(read, bp.c_str());
+            // data lands in its final (rx_buffers or page-aligned)
+            // destination; skip the prefetch bounce buffer even for
+            // sub-prefetch-sized head/tail chunks
+            r = read_until(read, bp.c_str(), false);
             if (r < 0) {
               ldout(async_msgr->cct, 1) << __func__ << " read data error " << dendl;
               goto fail;
@@ -858,6 +875,8 @@ void AsyncConnection::process()
           }
           logger->inc(l_msgr_recv_messages);
           logger->inc(l_msgr_recv_bytes, message_size + sizeof(ceph_msg_header) + sizeof(ceph_msg_footer));
+          conn_stats.in_msgs.inc();
+          conn_stats.in_bytes.add(message_size);
 
           break;
         }
@@ -1971,6 +1990,7 @@ int AsyncConnection::send_message(Message *m)
     m->put();
   } else {
     out_q[m->get_priority()].push_back(make_pair(bl, m));
+    conn_stats.queued();
     ldout(async_msgr->cct, 15) << __func__ << " inline write is denied, reschedule m=" << m << dendl;
     center->dispatch_event_external(write_handler);
   }
@@ -1984,13 +2004,16 @@ void AsyncConnection::requeue_sent()
     return;
 
   list<pair<bufferlist, Message*> >& rq = out_q[CEPH_MSG_PRIO_HIGHEST];
+  uint64_t requeued = 0;
   while (!sent.empty()) {
     Message* m = sent.back();
     sent.pop_back();
     ldout(async_msgr->cct, 10) << __func__ << " " << *m << " for resend "
                                << " (" << m->get_seq() << ")" << dendl;
     rq.push_front(make_pair(bufferlist(), m));
+    requeued++;
   }
+  conn_stats.queued(requeued);
 }
 
 void AsyncConnection::discard_requeued_up_to(uint64_t seq)
@@ -2008,6 +2031,7 @@ void AsyncConnection::discard_requeued_up_to(uint64_t seq)
                          << " <= " << seq << ", discarding" << dendl;
     p.second->put();
     rq.pop_front();
+    conn_stats.out_q_len.dec();
   }
   if (rq.empty())
     out_q.erase(CEPH_MSG_PRIO_HIGHEST);
@@ -2033,6 +2057,7 @@ void AsyncConnection::discard_out_queue()
       r->second->put();
     }
   out_q.clear();
+  conn_stats.out_q_len.set(0);
   outcoming_bl.clear();
 }
 
@@ -2216,9 +2241,6 @@ int AsyncConnection::write_message(Message *m, bufferlist& bl)
 
   m->calc_header_crc();
 
-  ceph_msg_header& header = m->get_header();
-  ceph_msg_footer& footer = m->get_footer();
-
   // TODO: let sign_message could be reentry?
   // Now that we have all the crcs calculated, handle the
   // digital signature for the message, if the AsyncConnection has session
@@ -2230,10 +2252,32 @@ int AsyncConnection::write_message(Message *m, bufferlist& bl)
   } else {
     if (session_security->sign_message(m)) {
       ldout(async_msgr->cct, 20) << __func__ << " failed to sign m="
-                                 << m << "): sig = " << footer.sig << dendl;
+                                 << m << "): sig = " << m->get_footer().sig << dendl;
     } else {
       ldout(async_msgr->cct, 20) << __func__ << " signed m=" << m
-                                 << "): sig = " << footer.sig << dendl;
+                                 << "): sig = " << m->get_footer().sig << dendl;
+    }
+  }
+
+  // local envelope copies so on-wire compression can patch them without
+  // touching the (possibly resent) message
+  ceph_msg_header header = m->get_header();
+  ceph_msg_footer footer = m->get_footer();
+
+  // bl is front + middle + data; the signature covers the raw crcs, so
+  // signed connections cannot compress
+  if (policy.compress &&
+      has_feature(CEPH_FEATURE_MSG_COMPRESS) &&
+      session_security.get() == NULL &&
+      header.data_len >= async_msgr->cct->_conf->ms_compress_min_size) {
+    bufferlist rest, data;
+    rest.substr_of(bl, 0, bl.length() - header.data_len);
+    data.substr_of(bl, bl.length() - header.data_len, header.data_len);
+    if (compress_message_data(async_msgr->cct, msgr->crcflags, header, footer,
+			      data)) {
+      bl.clear();
+      bl.claim_append(rest);
+      bl.claim_append(data);
     }
   }
 
@@ -2282,6 +2326,8 @@ int AsyncConnection::write_message(Message *m, bufferlist& bl)
   }
 
   logger->inc(l_msgr_send_bytes, complete_bl.length());
+  conn_stats.out_msgs.inc();
+  conn_stats.out_bytes.add(complete_bl.length());
   ldout(async_msgr->cct, 20) << __func__ << " sending " << m->get_seq()
                              << " " << m << dendl;
   int rc = _try_send(complete_bl);
@@ -55,7 +55,7 @@ class AsyncConnection : public Connection {
   int _try_send(bufferlist &bl, bool send=true);
   int _send(Message *m);
   void prepare_send_message(uint64_t features, Message *m, bufferlist &bl);
-  int read_until(uint64_t needed, char *p);
+  int read_until(uint64_t needed, char *p, bool prefetch=true);
   int _process_connection();
   void _connect();
   void _stop();
@@ -106,6 +106,7 @@ class AsyncConnection : public Connection {
         if (bl)
           bl->swap(p->first);
         it->second.erase(p);
+        conn_stats.out_q_len.dec();
       }
       if (it->second.empty())
         out_q.erase(it->first);
@@ -117,6 +118,9 @@ class AsyncConnection : public Connection {
   AsyncConnection(CephContext *cct, AsyncMessenger *m, EventCenter *c, PerfCounters *p);
   ~AsyncConnection();
 
+  /// always-on traffic counters, sampled by "dump_conn_stats"
+  ConnectionStats conn_stats;
+
   ostream& _conn_prefix(std::ostream *_dout);
 
   bool is_connected() {
@@ -261,6 +265,9 @@ class AsyncConnection : public Connection {
   // Open state
   utime_t recv_stamp;
   utime_t throttle_stamp;
+  /// rdtsc stamp of the first failed throttle get for the message
+  /// being read, or 0 if we are not stalled on a throttle
+  uint64_t throttle_stall_start;
   uint64_t msg_left;
   ceph_msg_header current_header;
   bufferlist data_buf;
@@ -25,6 +25,7 @@
 #include "include/str_list.h"
 #include "common/strtol.h"
 #include "common/config.h"
+#include "common/Formatter.h"
 #include "common/Timer.h"
 #include "common/errno.h"
 #include "auth/Crypto.h"
@@ -231,6 +232,10 @@ int Processor::start(Worker *w)
     worker = w;
     w->center.create_file_event(listen_sd, EVENT_READABLE,
                                 EventCallbackRef(new C_processor_accept(this)));
+  } else {
+    // not listening; don't let the load reference get_worker took
+    // stick to this worker forever
+    msgr->release_worker(&w->center);
   }
 
   return 0;
@@ -273,6 +278,8 @@ void Processor::stop()
     ::shutdown(listen_sd, SHUT_RDWR);
     ::close(listen_sd);
     listen_sd = -1;
+    msgr->release_worker(&worker->center);
+    worker = NULL;
   }
 }
 
@@ -314,10 +321,11 @@ void *Worker::entry()
  *******************/
 const string WorkerPool::name = "AsyncMessenger::WorkerPool";
 
-WorkerPool::WorkerPool(CephContext *c): cct(c), seq(0), started(false),
+WorkerPool::WorkerPool(CephContext *c): cct(c), started(false),
                                         barrier_lock("WorkerPool::WorkerPool::barrier_lock"),
                                         barrier_count(0)
 {
+  ceph_spin_init(&pool_spin);
   assert(cct->_conf->ms_async_op_threads > 0);
   for (int i = 0; i < cct->_conf->ms_async_op_threads; ++i) {
     Worker *w = new Worker(cct, this, i);
@@ -346,6 +354,7 @@ WorkerPool::~WorkerPool()
     }
     delete workers[i];
   }
+  ceph_spin_destroy(&pool_spin);
 }
 
 void WorkerPool::start()
@@ -744,3 +753,20 @@ void AsyncMessenger::learned_addr(const entity_addr_t &peer_addr_for_me)
   }
   lock.Unlock();
 }
+
+void AsyncMessenger::dump_conn_stats(ceph::Formatter *f)
+{
+  Mutex::Locker l(lock);
+  f->open_array_section("connections");
+  for (ceph::unordered_map<entity_addr_t, AsyncConnectionRef>::iterator p = conns.begin();
+       p != conns.end();
+       ++p) {
+    AsyncConnectionRef conn = p->second;
+    f->open_object_section("connection");
+    f->dump_stream("peer_addr") << conn->get_peer_addr();
+    f->dump_string("peer_type", ceph_entity_type_name(conn->get_peer_type()));
+    conn->conn_stats.dump(f);
+    f->close_section();
+  }
+  f->close_section();
+}
@@ -64,8 +64,13 @@ class Worker : public Thread {
 
  public:
   EventCenter center;
+  /// number of connections bound to this worker's event center; used
+  /// by WorkerPool::get_worker to steer new connections to the least
+  /// loaded event loop
+  atomic_t references;
   Worker(CephContext *c, WorkerPool *p, int i)
-    : cct(c), pool(p), done(false), id(i), perf_logger(NULL), center(c) {
+    : cct(c), pool(p), done(false), id(i), perf_logger(NULL), center(c),
+      references(0) {
     center.init(InitEventNumber);
     char name[128];
     sprintf(name, "AsyncMessenger::Worker-%d", id);
@@ -118,7 +123,10 @@ class WorkerPool: CephContext::AssociatedSingletonObject {
   WorkerPool(const WorkerPool &);
   WorkerPool& operator=(const WorkerPool &);
   CephContext *cct;
-  uint64_t seq;
+  // protects the load scan in get_worker/release_worker; the pool is
+  // a CephContext singleton shared by all messengers, so we can't
+  // rely on any one messenger's lock
+  ceph_spinlock_t pool_spin;
   vector<Worker*> workers;
   vector<int> coreids;
   // Used to indicate whether thread started
@@ -143,7 +151,32 @@ class WorkerPool: CephContext::AssociatedSingletonObject {
   virtual ~WorkerPool();
   void start();
   Worker *get_worker() {
-    return workers[(seq++)%workers.size()];
+    // steer the new connection to the least loaded event loop so a
+    // handful of busy peers can't pile up on one worker
+    ceph_spin_lock(&pool_spin);
+    Worker *best = workers[0];
+    for (vector<Worker*>::iterator it = workers.begin() + 1;
+	 it != workers.end(); ++it) {
+      if ((*it)->references.read() < best->references.read())
+	best = *it;
+    }
+    best->references.inc();
+    ceph_spin_unlock(&pool_spin);
+    return best;
+  }
+  /// drop the load reference taken by get_worker for the worker owning
+  /// event center c
+  void release_worker(EventCenter *c) {
+    ceph_spin_lock(&pool_spin);
+    for (vector<Worker*>::iterator it = workers.begin();
+	 it != workers.end(); ++it) {
+      if (&(*it)->center == c) {
+	assert((*it)->references.read() > 0);
+	(*it)->references.dec();
+	break;
+      }
+    }
+    ceph_spin_unlock(&pool_spin);
   }
   int get_cpuid(int id) {
     if (coreids.empty())
@@ -194,6 +227,8 @@ public:
   double get_dispatch_queue_max_age(utime_t now) {
     return 0;
   }
+
+  void dump_conn_stats(ceph::Formatter *f);
   /** @} Accessors */
 
   /**
@@ -496,6 +531,14 @@ public:
     Mutex::Locker l(deleted_lock);
     deleted_conns.insert(conn);
   }
+
+  /**
+   * Called by dying AsyncConnections (and the Processor) to drop the
+   * load reference get_worker took on their event center.
+   */
+  void release_worker(EventCenter *c) {
+    pool->release_worker(c);
+  }
   /**
    * @} // AsyncMessenger Internals
    */
@@ -217,21 +217,32 @@ uint64_t EventCenter::create_time_event(uint64_t microseconds, EventCallbackRef
   } else {
     expire = ceph_clock_now(cct);
     expire.copy_to_timeval(&tv);
-    tv.tv_sec += microseconds / 1000000;
-    tv.tv_usec += microseconds % 1000000;
+    uint64_t us = (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec +
+      microseconds;
+    if (time_bucket_us > 1) {
+      // round up to a shared bucket boundary, timer-wheel style, so
+      // the per-connection wakeups of thousands of mostly-idle
+      // connections collapse into a handful of map nodes
+      us = (us + time_bucket_us - 1) / time_bucket_us * time_bucket_us;
+    }
+    tv.tv_sec = us / 1000000;
+    tv.tv_usec = us % 1000000;
   }
   expire.set_from_timeval(&tv);
 
   event.id = id;
   event.time_cb = ctxt;
-  time_events[expire].push_back(event);
+  list<TimeEvent> &bucket = time_events[expire];
+  bucket.push_back(event);
+  list<TimeEvent>::iterator pos = bucket.end();
+  --pos;
+  event_map[id] = make_pair(expire, pos);
   if (expire < next_time)
     wakeup();
 
   return id;
 }
 
-// TODO: Ineffective implementation now!
 void EventCenter::delete_time_event(uint64_t id)
 {
   Mutex::Locker l(time_lock);
@@ -239,19 +250,18 @@ void EventCenter::delete_time_event(uint64_t id)
   if (id >= time_event_next_id)
     return ;
 
-
-  for (map<utime_t, list<TimeEvent> >::iterator it = time_events.begin();
-       it != time_events.end(); ++it) {
-    for (list<TimeEvent>::iterator j = it->second.begin();
-         j != it->second.end(); ++j) {
-      if (j->id == id) {
-        it->second.erase(j);
-        if (it->second.empty())
-          time_events.erase(it);
-        return ;
-      }
-    }
-  }
+  map<uint64_t, pair<utime_t, list<TimeEvent>::iterator> >::iterator p =
+    event_map.find(id);
+  if (p == event_map.end())
+    return ;  // already fired
+
+  map<utime_t, list<TimeEvent> >::iterator it =
+    time_events.find(p->second.first);
+  assert(it != time_events.end());
+  it->second.erase(p->second.second);
+  if (it->second.empty())
+    time_events.erase(it);
+  event_map.erase(p);
 }
 
 void EventCenter::wakeup()
@@ -284,12 +294,19 @@ int EventCenter::process_time_events()
    * processing events earlier is less dangerous than delaying them
    * indefinitely, and practice suggests it is. */
   if (now < last_time) {
-    map<utime_t, list<TimeEvent> > changed;
+    list<TimeEvent> all;
     for (map<utime_t, list<TimeEvent> >::iterator it = time_events.begin();
          it != time_events.end(); ++it) {
-      changed[utime_t()].swap(it->second);
+      all.splice(all.end(), it->second);
     }
-    time_events.swap(changed);
+    time_events.clear();
+    list<TimeEvent> &bucket = time_events[utime_t()];
+    bucket.swap(all);
+    // splice/swap leave the list nodes intact; only the bucket keys in
+    // the id index need rewriting
+    for (list<TimeEvent>::iterator j = bucket.begin();
+         j != bucket.end(); ++j)
+      event_map[j->id] = make_pair(utime_t(), j);
   }
   last_time = now;
 
@@ -299,6 +316,9 @@ int EventCenter::process_time_events()
        it != time_events.end(); ) {
     prev = it;
     if (cur >= it->first) {
+      for (list<TimeEvent>::iterator j = it->second.begin();
+           j != it->second.end(); ++j)
+        event_map.erase(j->id);
       need_process.splice(need_process.end(), it->second);
       ++it;
       time_events.erase(prev);
@@ -354,10 +374,22 @@ int EventCenter::process_events(int timeout_microseconds)
     }
   }
 
+  // announce we are about to sleep, then re-check for external events
+  // submitted in between.  dispatch_event_external only pays the wakeup
+  // pipe write when it observes us blocked; the fenced atomics on both
+  // sides guarantee at least one party sees the other (dekker style),
+  // so no submission can be stranded until the timeout.
+  blocked.compare_and_swap(0, 1);
+  if (external_num_events.read()) {
+    tv.tv_sec = 0;
+    tv.tv_usec = 0;
+  }
+
   ldout(cct, 10) << __func__ << " wait second " << tv.tv_sec << " usec " << tv.tv_usec << dendl;
   vector<FiredFileEvent> fired_events;
   next_time = shortest;
   numevents = driver->event_wait(fired_events, &tv);
+  blocked.set(0);
   for (int j = 0; j < numevents; j++) {
     int rfired = 0;
     FileEvent *event;
@@ -392,6 +424,7 @@ int EventCenter::process_events(int timeout_microseconds)
     deque<EventCallbackRef> cur_process;
     cur_process.swap(external_events);
     external_lock.Unlock();
+    external_num_events.sub(cur_process.size());
     while (!cur_process.empty()) {
       EventCallbackRef e = cur_process.front();
       if (e)
@@ -407,5 +440,10 @@ void EventCenter::dispatch_event_external(EventCallbackRef e)
   external_lock.Lock();
   external_events.push_back(e);
   external_lock.Unlock();
-  wakeup();
+  external_num_events.inc();
+  // only pay the pipe-write syscall if the loop is (about to be)
+  // sleeping in event_wait; a running loop drains external_events at
+  // the end of every iteration anyway
+  if (blocked.read())
+    wakeup();
 }
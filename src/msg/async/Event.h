@@ -107,7 +107,10 @@ class EventCenter {
   FileEvent *file_events;
   EventDriver *driver;
   map<utime_t, list<TimeEvent> > time_events;
+  /// id -> (bucket key, position) so delete_time_event need not scan
+  map<uint64_t, pair<utime_t, list<TimeEvent>::iterator> > event_map;
   uint64_t time_event_next_id;
+  uint64_t time_bucket_us; ///< coalesce expiries to this granularity (0 = exact)
   time_t last_time; // last time process time event
   utime_t next_time; // next wake up time
   int notify_receive_fd;
@@ -126,6 +129,8 @@ class EventCenter {
 
  public:
   atomic_t already_wakeup;
+  atomic_t external_num_events; ///< pending external events, for wakeup suppression
+  atomic_t blocked;             ///< event loop is sleeping in event_wait
 
   EventCenter(CephContext *c):
     cct(c), nevent(0),
@@ -134,7 +139,9 @@ class EventCenter {
     time_lock("AsyncMessenger::time_lock"),
     file_events(NULL),
     driver(NULL), time_event_next_id(0),
-    notify_receive_fd(-1), notify_send_fd(-1), net(c), owner(0), already_wakeup(0) {
+    time_bucket_us(c->_conf->ms_async_timer_coalesce_us),
+    notify_receive_fd(-1), notify_send_fd(-1), net(c), owner(0),
+    already_wakeup(0), external_num_events(0), blocked(0) {
     last_time = time(NULL);
   }
   ~EventCenter();
@@ -104,6 +104,14 @@ public:
     ::encode(_type, bl);
     ::encode(_num, bl);
   }
+  void bound_encode(size_t& p) const {
+    denc(_type, p);
+    denc(_num, p);
+  }
+  void encode(bufferlist::contiguous_appender& p) const {
+    denc(_type, p);
+    denc(_num, p);
+  }
   void decode(bufferlist::iterator& bl) {
     ::decode(_type, bl);
     ::decode(_num, bl);
@@ -112,7 +120,7 @@ public:
 
   static void generate_test_instances(list<entity_name_t*>& o);
 };
-WRITE_CLASS_ENCODER(entity_name_t)
+WRITE_CLASS_DENC(entity_name_t)
 
 inline bool operator== (const entity_name_t& l, const entity_name_t& r) { 
   return (l.type() == r.type()) && (l.num() == r.num()); }
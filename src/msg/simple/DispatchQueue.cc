@@ -16,6 +16,9 @@
 #include "DispatchQueue.h"
 #include "SimpleMessenger.h"
 #include "common/ceph_context.h"
+#include "common/admin_socket.h"
+#include "common/Formatter.h"
+#include "common/errno.h"
 
 #define dout_subsys ceph_subsys_ms
 #include "common/debug.h"
@@ -28,6 +31,45 @@
 #undef dout_prefix
 #define dout_prefix *_dout << "-- " << msgr->get_myaddr() << " "
 
+class DispatchQueueHook : public AdminSocketHook {
+  DispatchQueue *dq;
+public:
+  explicit DispatchQueueHook(DispatchQueue *dq) : dq(dq) {}
+  bool call(std::string command, cmdmap_t &cmdmap, std::string format,
+	    bufferlist& out) {
+    Formatter *f = Formatter::create(format, "json-pretty", "json-pretty");
+    f->open_object_section("dispatch_queue");
+    dq->dump_slow_dispatch(f);
+    f->close_section();
+    f->flush(out);
+    delete f;
+    return true;
+  }
+};
+
+void DispatchQueue::dump_slow_dispatch(ceph::Formatter *f) const
+{
+  Mutex::Locker l(lock);
+  utime_t now = ceph_clock_now(cct);
+  f->dump_unsigned("queue_len", mqueue.length());
+  f->dump_float("max_queued_age",
+		marrival.empty() ? 0.0 : now - marrival.begin()->first);
+  f->open_array_section("slow_dispatch_types");
+  for (map<int, TypeStat>::const_iterator p = slow_type_stats.begin();
+       p != slow_type_stats.end();
+       ++p) {
+    f->open_object_section("type");
+    f->dump_int("type", p->first);
+    f->dump_string("type_name", p->second.name);
+    f->dump_unsigned("count", p->second.count);
+    f->dump_unsigned("bytes", p->second.bytes);
+    f->dump_float("avg_residency", p->second.total_age / p->second.count);
+    f->dump_float("max_residency", p->second.max_age);
+    f->close_section();
+  }
+  f->close_section();
+}
+
 double DispatchQueue::get_max_age(utime_t now) const {
   Mutex::Locker l(lock);
   if (marrival.empty())
@@ -150,40 +192,70 @@ void DispatchQueue::run_local_delivery()
  */
 void DispatchQueue::entry()
 {
+  uint64_t batch_size = cct->_conf->ms_dispatch_batch_size;
+  if (!batch_size)
+    batch_size = 1;
   lock.Lock();
   while (true) {
     while (!mqueue.empty()) {
-      QueueItem qitem = mqueue.dequeue();
-      if (!qitem.is_code())
-	remove_arrival(qitem.get_message());
+      // pull a batch of items under a single lock hold; at high
+      // message rates the per-message lock acquire/release otherwise
+      // dominates the queue cost
+      list<QueueItem> batch;
+      utime_t now = ceph_clock_now(cct);
+      while (!mqueue.empty() && batch.size() < batch_size) {
+	QueueItem qitem = mqueue.dequeue();
+	if (!qitem.is_code()) {
+	  Message *m = qitem.get_message();
+	  remove_arrival(m);
+	  // account what reaches slow dispatch and for how long it sat
+	  // queued, so dump_slow_dispatch can say which types deserve a
+	  // fast_dispatch path
+	  TypeStat &ts = slow_type_stats[m->get_type()];
+	  if (!ts.count)
+	    ts.name = m->get_type_name();
+	  ++ts.count;
+	  ts.bytes += m->get_dispatch_throttle_size();
+	  double age = now - m->get_recv_stamp();
+	  ts.total_age += age;
+	  if (age > ts.max_age)
+	    ts.max_age = age;
+	}
+	batch.push_back(qitem);
+      }
       lock.Unlock();
 
-      if (qitem.is_code()) {
-	switch (qitem.get_code()) {
-	case D_BAD_REMOTE_RESET:
-	  msgr->ms_deliver_handle_remote_reset(qitem.get_connection());
-	  break;
-	case D_CONNECT:
-	  msgr->ms_deliver_handle_connect(qitem.get_connection());
-	  break;
-	case D_ACCEPT:
-	  msgr->ms_deliver_handle_accept(qitem.get_connection());
-	  break;
-	case D_BAD_RESET:
-	  msgr->ms_deliver_handle_reset(qitem.get_connection());
-	  break;
-	default:
-	  assert(0);
-	}
-      } else {
-	Message *m = qitem.get_message();
-	if (stop) {
-	  ldout(cct,10) << " stop flag set, discarding " << m << " " << *m << dendl;
-	  m->put();
+      while (!batch.empty()) {
+	QueueItem qitem = batch.front();
+	batch.pop_front();
+
+	if (qitem.is_code()) {
+	  switch (qitem.get_code()) {
+	  case D_BAD_REMOTE_RESET:
+	    msgr->ms_deliver_handle_remote_reset(qitem.get_connection());
+	    break;
+	  case D_CONNECT:
+	    msgr->ms_deliver_handle_connect(qitem.get_connection());
+	    break;
+	  case D_ACCEPT:
+	    msgr->ms_deliver_handle_accept(qitem.get_connection());
+	    break;
+	  case D_BAD_RESET:
+	    msgr->ms_deliver_handle_reset(qitem.get_connection());
+	    break;
+	  default:
+	    assert(0);
+	  }
 	} else {
-	  uint64_t msize = pre_dispatch(m);
-	  msgr->ms_deliver_dispatch(m);
-	  post_dispatch(m, msize);
+	  Message *m = qitem.get_message();
+	  if (stop) {
+	    ldout(cct,10) << " stop flag set, discarding " << m << " " << *m << dendl;
+	    m->put();
+	  } else {
+	    uint64_t msize = pre_dispatch(m);
+	    msgr->ms_deliver_dispatch(m);
+	    post_dispatch(m, msize);
+	  }
 	}
       }
 
@@ -219,12 +291,27 @@ void DispatchQueue::start()
   assert(!dispatch_thread.is_started());
   dispatch_thread.create();
   local_delivery_thread.create();
+
+  asok_hook = new DispatchQueueHook(this);
+  int r = cct->get_admin_socket()->register_command(
+    "dump_slow_dispatch_" + mname, "dump_slow_dispatch_" + mname, asok_hook,
+    "show per-type counts and queue residency of slow-dispatched messages");
+  /* Don't warn on EEXIST, happens if multiple messengers in one
+   * process share a name */
+  if (r < 0 && r != -EEXIST)
+    lderr(cct) << "error registering admin socket command: "
+	       << cpp_strerror(r) << dendl;
 }
 
 void DispatchQueue::wait()
 {
   local_delivery_thread.join();
   dispatch_thread.join();
+  if (asok_hook) {
+    cct->get_admin_socket()->unregister_command("dump_slow_dispatch_" + mname);
+    delete asok_hook;
+    asok_hook = NULL;
+  }
 }
 
 void DispatchQueue::shutdown()
@@ -25,12 +25,16 @@
 #include "common/Thread.h"
 #include "common/PrioritizedQueue.h"
 
+class AdminSocketHook;
 class CephContext;
 class DispatchQueue;
 class Pipe;
 class SimpleMessenger;
 class Message;
 struct Connection;
+namespace ceph {
+  class Formatter;
+}
 
 /**
  * The DispatchQueue contains all the Pipes which have Messages
@@ -89,7 +93,22 @@ class DispatchQueue {
   }
 
   uint64_t next_pipe_id;
-    
+
+  /// per message type accounting of what goes through slow dispatch,
+  /// for the dump_slow_dispatch asok command; protected by lock
+  struct TypeStat {
+    string name;
+    uint64_t count;
+    uint64_t bytes;
+    double total_age;  ///< cumulative queue residency (seconds)
+    double max_age;
+    TypeStat() : count(0), bytes(0), total_age(0), max_age(0) {}
+  };
+  map<int, TypeStat> slow_type_stats;
+
+  string mname;
+  AdminSocketHook *asok_hook;
+
   enum { D_CONNECT = 1, D_ACCEPT, D_BAD_REMOTE_RESET, D_BAD_RESET, D_NUM_CODES };
 
   /**
@@ -128,6 +147,7 @@ class DispatchQueue {
   void run_local_delivery();
 
   double get_max_age(utime_t now) const;
+  void dump_slow_dispatch(ceph::Formatter *f) const;
 
   int get_queue_len() const {
     Mutex::Locker l(lock);
@@ -190,12 +210,14 @@ class DispatchQueue {
   void shutdown();
   bool is_started() const {return dispatch_thread.is_started();}
 
-  DispatchQueue(CephContext *cct, SimpleMessenger *msgr)
+  DispatchQueue(CephContext *cct, SimpleMessenger *msgr, string mname)
     : cct(cct), msgr(msgr),
       lock("SimpleMessenger::DispatchQueue::lock"),
       mqueue(cct->_conf->ms_pq_max_tokens_per_priority,
 	     cct->_conf->ms_pq_min_cost),
       next_pipe_id(1),
+      mname(mname),
+      asok_hook(NULL),
       dispatch_thread(this),
       local_delivery_lock("SimpleMessenger::DispatchQueue::local_delivery_lock"),
       stop_local_delivery(false),
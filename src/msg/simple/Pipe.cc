@@ -23,6 +23,7 @@
 #include "Pipe.h"
 #include "SimpleMessenger.h"
 
+#include "common/Cycles.h"
 #include "common/debug.h"
 #include "common/errno.h"
 
@@ -118,6 +119,9 @@ Pipe::Pipe(SimpleMessenger *r, int st, PipeConnection *con)
 
   recv_max_prefetch = msgr->cct->_conf->ms_tcp_prefetch_max_size;
   recv_buf = new char[recv_max_prefetch];
+
+  reader_thread.set_role("ms_pipe_read");
+  writer_thread.set_role("ms_pipe_write");
 }
 
 Pipe::~Pipe()
@@ -693,8 +697,11 @@ int Pipe::accept()
     ldout(msgr->cct,10) << "accept re-queuing on out_seq " << out_seq << " in_seq " << in_seq << dendl;
     for (map<int, list<Message*> >::iterator p = existing->out_q.begin();
          p != existing->out_q.end();
-         ++p)
+         ++p) {
+      conn_stats.queued(p->second.size());
       out_q[p->first].splice(out_q[p->first].begin(), p->second);
+    }
+    existing->conn_stats.out_q_len.set(0);
   }
   existing->stop_and_wait();
   existing->pipe_lock.Unlock();
@@ -892,8 +899,11 @@ int Pipe::connect()
   char tag = -1;
   int rc;
   struct msghdr msg;
-  struct iovec msgvec[2];
+  struct iovec msgvec[4];
   int msglen;
+  ceph_msg_connect connect;
+  bool pipelined = false;
+  bool sent_connect = false;
   char banner[strlen(CEPH_BANNER) + 1];  // extra byte makes coverity happy
   entity_addr_t paddr;
   entity_addr_t peer_addr_for_me, socket_addr;
@@ -924,6 +934,56 @@ int Pipe::connect()
 
   set_socket_options();
 
+  // on a reconnect we already know our own address and have verified
+  // this peer's identity before, so push our entire half of the
+  // handshake (banner, addr, connect) in one burst instead of
+  // ping-ponging with the peer's half; the whole exchange then takes
+  // a single round trip.  if anything the peer sends back fails
+  // validation below we just fail and close as usual.
+  pipelined = (cseq > 0);
+  if (pipelined) {
+    authorizer = msgr->get_authorizer(peer_type, false);
+
+    connect.features = policy.features_supported;
+    connect.host_type = msgr->get_myinst().name.type();
+    connect.global_seq = gseq;
+    connect.connect_seq = cseq;
+    connect.protocol_version = msgr->get_proto_version(peer_type, true);
+    connect.authorizer_protocol = authorizer ? authorizer->protocol : 0;
+    connect.authorizer_len = authorizer ? authorizer->bl.length() : 0;
+    connect.flags = 0;
+    if (policy.lossy)
+      connect.flags |= CEPH_MSG_CONNECT_LOSSY;  // this is fyi, actually, server decides!
+
+    ::encode(msgr->my_inst.addr, myaddrbl);
+
+    memset(&msg, 0, sizeof(msg));
+    msgvec[0].iov_base = (char*)CEPH_BANNER;
+    msgvec[0].iov_len = strlen(CEPH_BANNER);
+    msgvec[1].iov_base = myaddrbl.c_str();
+    msgvec[1].iov_len = myaddrbl.length();
+    msgvec[2].iov_base = (char*)&connect;
+    msgvec[2].iov_len = sizeof(connect);
+    msg.msg_iov = msgvec;
+    msg.msg_iovlen = 3;
+    msglen = msgvec[0].iov_len + msgvec[1].iov_len + msgvec[2].iov_len;
+    if (authorizer) {
+      msgvec[3].iov_base = authorizer->bl.c_str();
+      msgvec[3].iov_len = authorizer->bl.length();
+      msg.msg_iovlen++;
+      msglen += msgvec[3].iov_len;
+    }
+    ldout(msgr->cct,10) << "connect sending reconnect burst gseq=" << gseq
+			<< " cseq=" << cseq
+			<< " proto=" << connect.protocol_version << dendl;
+    if (do_sendmsg(&msg, msglen)) {
+      ldout(msgr->cct,2) << "connect couldn't write reconnect burst, "
+			 << cpp_strerror(errno) << dendl;
+      goto fail;
+    }
+    sent_connect = true;
+  }
+
   // verify banner
   // FIXME: this should be non-blocking, or in some other way verify the banner as we get it.
   if (tcp_read((char*)&banner, strlen(CEPH_BANNER)) < 0) {
@@ -935,15 +995,17 @@ int Pipe::connect()
     goto fail;
   }
 
-  memset(&msg, 0, sizeof(msg));
-  msgvec[0].iov_base = banner;
-  msgvec[0].iov_len = strlen(CEPH_BANNER);
-  msg.msg_iov = msgvec;
-  msg.msg_iovlen = 1;
-  msglen = msgvec[0].iov_len;
-  if (do_sendmsg(&msg, msglen)) {
-    ldout(msgr->cct,2) << "connect couldn't write my banner, " << cpp_strerror(errno) << dendl;
-    goto fail;
+  if (!pipelined) {
+    memset(&msg, 0, sizeof(msg));
+    msgvec[0].iov_base = banner;
+    msgvec[0].iov_len = strlen(CEPH_BANNER);
+    msg.msg_iov = msgvec;
+    msg.msg_iovlen = 1;
+    msglen = msgvec[0].iov_len;
+    if (do_sendmsg(&msg, msglen)) {
+      ldout(msgr->cct,2) << "connect couldn't write my banner, " << cpp_strerror(errno) << dendl;
+      goto fail;
+    }
   }
 
   // identify peer
@@ -980,59 +1042,67 @@ int Pipe::connect()
 
   msgr->learned_addr(peer_addr_for_me);
 
-  ::encode(msgr->my_inst.addr, myaddrbl);
+  if (!pipelined) {
+    ::encode(msgr->my_inst.addr, myaddrbl);
 
-  memset(&msg, 0, sizeof(msg));
-  msgvec[0].iov_base = myaddrbl.c_str();
-  msgvec[0].iov_len = myaddrbl.length();
-  msg.msg_iov = msgvec;
-  msg.msg_iovlen = 1;
-  msglen = msgvec[0].iov_len;
-  if (do_sendmsg(&msg, msglen)) {
-    ldout(msgr->cct,2) << "connect couldn't write my addr, " << cpp_strerror(errno) << dendl;
-    goto fail;
+    memset(&msg, 0, sizeof(msg));
+    msgvec[0].iov_base = myaddrbl.c_str();
+    msgvec[0].iov_len = myaddrbl.length();
+    msg.msg_iov = msgvec;
+    msg.msg_iovlen = 1;
+    msglen = msgvec[0].iov_len;
+    if (do_sendmsg(&msg, msglen)) {
+      ldout(msgr->cct,2) << "connect couldn't write my addr, " << cpp_strerror(errno) << dendl;
+      goto fail;
+    }
+    ldout(msgr->cct,10) << "connect sent my addr " << msgr->my_inst.addr << dendl;
   }
-  ldout(msgr->cct,10) << "connect sent my addr " << msgr->my_inst.addr << dendl;
 
 
   while (1) {
-    delete authorizer;
-    authorizer = msgr->get_authorizer(peer_type, false);
     bufferlist authorizer_reply;
 
-    ceph_msg_connect connect;
-    connect.features = policy.features_supported;
-    connect.host_type = msgr->get_myinst().name.type();
-    connect.global_seq = gseq;
-    connect.connect_seq = cseq;
-    connect.protocol_version = msgr->get_proto_version(peer_type, true);
-    connect.authorizer_protocol = authorizer ? authorizer->protocol : 0;
-    connect.authorizer_len = authorizer ? authorizer->bl.length() : 0;
-    if (authorizer) 
-      ldout(msgr->cct,10) << "connect.authorizer_len=" << connect.authorizer_len
-	       << " protocol=" << connect.authorizer_protocol << dendl;
-    connect.flags = 0;
-    if (policy.lossy)
-      connect.flags |= CEPH_MSG_CONNECT_LOSSY;  // this is fyi, actually, server decides!
-    memset(&msg, 0, sizeof(msg));
-    msgvec[0].iov_base = (char*)&connect;
-    msgvec[0].iov_len = sizeof(connect);
-    msg.msg_iov = msgvec;
-    msg.msg_iovlen = 1;
-    msglen = msgvec[0].iov_len;
-    if (authorizer) {
-      msgvec[1].iov_base = authorizer->bl.c_str();
-      msgvec[1].iov_len = authorizer->bl.length();
-      msg.msg_iovlen++;
-      msglen += msgvec[1].iov_len;
-    }
+    // if we pipelined the connect with the banner we already sent the
+    // first attempt; retries (RETRY_GLOBAL, RESETSESSION, etc.) fall
+    // back to rebuilding and resending here.
+    if (!sent_connect) {
+      delete authorizer;
+      authorizer = msgr->get_authorizer(peer_type, false);
+
+      connect.features = policy.features_supported;
+      connect.host_type = msgr->get_myinst().name.type();
+      connect.global_seq = gseq;
+      connect.connect_seq = cseq;
+      connect.protocol_version = msgr->get_proto_version(peer_type, true);
+      connect.authorizer_protocol = authorizer ? authorizer->protocol : 0;
+      connect.authorizer_len = authorizer ? authorizer->bl.length() : 0;
+      if (authorizer)
+	ldout(msgr->cct,10) << "connect.authorizer_len=" << connect.authorizer_len
+		 << " protocol=" << connect.authorizer_protocol << dendl;
+      connect.flags = 0;
+      if (policy.lossy)
+	connect.flags |= CEPH_MSG_CONNECT_LOSSY;  // this is fyi, actually, server decides!
+      memset(&msg, 0, sizeof(msg));
+      msgvec[0].iov_base = (char*)&connect;
+      msgvec[0].iov_len = sizeof(connect);
+      msg.msg_iov = msgvec;
+      msg.msg_iovlen = 1;
+      msglen = msgvec[0].iov_len;
+      if (authorizer) {
+	msgvec[1].iov_base = authorizer->bl.c_str();
+	msgvec[1].iov_len = authorizer->bl.length();
+	msg.msg_iovlen++;
+	msglen += msgvec[1].iov_len;
+      }
 
-    ldout(msgr->cct,10) << "connect sending gseq=" << gseq << " cseq=" << cseq
-	     << " proto=" << connect.protocol_version << dendl;
-    if (do_sendmsg(&msg, msglen)) {
-      ldout(msgr->cct,2) << "connect couldn't write gseq, cseq, " << cpp_strerror(errno) << dendl;
-      goto fail;
+      ldout(msgr->cct,10) << "connect sending gseq=" << gseq << " cseq=" << cseq
+	       << " proto=" << connect.protocol_version << dendl;
+      if (do_sendmsg(&msg, msglen)) {
+	ldout(msgr->cct,2) << "connect couldn't write gseq, cseq, " << cpp_strerror(errno) << dendl;
+	goto fail;
+      }
     }
+    sent_connect = false;
 
     ldout(msgr->cct,20) << "connect wrote (self +) cseq, waiting for reply" << dendl;
     ceph_msg_connect_reply reply;
@@ -1276,6 +1346,7 @@ void Pipe::requeue_sent()
     return;
 
   list<Message*>& rq = out_q[CEPH_MSG_PRIO_HIGHEST];
+  uint64_t requeued = 0;
   while (!sent.empty()) {
     Message *m = sent.back();
     sent.pop_back();
@@ -1283,7 +1354,9 @@ void Pipe::requeue_sent()
 			<< " (" << m->get_seq() << ")" << dendl;
     rq.push_front(m);
     out_seq--;
+    requeued++;
   }
+  conn_stats.queued(requeued);
 }
 
 void Pipe::discard_requeued_up_to(uint64_t seq)
@@ -1300,6 +1373,7 @@ void Pipe::discard_requeued_up_to(uint64_t seq)
 			<< " <= " << seq << ", discarding" << dendl;
     m->put();
     rq.pop_front();
+    conn_stats.out_q_len.dec();
     out_seq++;
   }
   if (rq.empty())
@@ -1325,6 +1399,7 @@ void Pipe::discard_out_queue()
       (*r)->put();
     }
   out_q.clear();
+  conn_stats.out_q_len.set(0);
 }
 
 void Pipe::fault(bool onread)
@@ -1799,10 +1874,6 @@ void Pipe::writer()
 	// encode and copy out of *m
 	m->encode(features, msgr->crcflags);
 
-	// prepare everything
-	const ceph_msg_header& header = m->get_header();
-	const ceph_msg_footer& footer = m->get_footer();
-
 	// Now that we have all the crcs calculated, handle the
 	// digital signature for the message, if the pipe has session
 	// security set up.  Some session security options do not
@@ -1812,29 +1883,53 @@ void Pipe::writer()
 	  ldout(msgr->cct, 20) << "writer no session security" << dendl;
 	} else {
 	  if (session_security->sign_message(m)) {
-	    ldout(msgr->cct, 20) << "writer failed to sign seq # " << header.seq
-				 << "): sig = " << footer.sig << dendl;
+	    ldout(msgr->cct, 20) << "writer failed to sign seq # "
+				 << m->get_header().seq
+				 << "): sig = " << m->get_footer().sig << dendl;
 	  } else {
-	    ldout(msgr->cct, 20) << "writer signed seq # " << header.seq
-				 << "): sig = " << footer.sig << dendl;
+	    ldout(msgr->cct, 20) << "writer signed seq # "
+				 << m->get_header().seq
+				 << "): sig = " << m->get_footer().sig << dendl;
 	  }
 	}
 
+	// prepare everything; local envelope copies so on-wire compression
+	// can patch it without touching the (possibly resent) message
+	ceph_msg_header header = m->get_header();
+	ceph_msg_footer footer = m->get_footer();
+
 	bufferlist blist = m->get_payload();
 	blist.append(m->get_middle());
-	blist.append(m->get_data());
+	bufferlist data = m->get_data();
+	// the signature covers the raw crcs, so signed connections
+	// cannot compress
+	if (policy.compress &&
+	    connection_state->has_feature(CEPH_FEATURE_MSG_COMPRESS) &&
+	    session_security.get() == NULL &&
+	    data.length() >= msgr->cct->_conf->ms_compress_min_size)
+	  compress_message_data(msgr->cct, msgr->crcflags, header, footer,
+				data);
+	blist.append(data);
+
+	// if more messages are already queued behind this one, let the
+	// kernel coalesce them into fewer segments instead of pushing
+	// each one out as soon as it is written
+	bool more = !out_q.empty();
 
         pipe_lock.Unlock();
 
         ldout(msgr->cct,20) << "writer sending " << m->get_seq() << " " << m << dendl;
-	int rc = write_message(header, footer, blist);
+	int rc = write_message(header, footer, blist, more);
 
 	pipe_lock.Lock();
 	if (rc < 0) {
           ldout(msgr->cct,1) << "writer error sending " << m << ", "
 		  << cpp_strerror(errno) << dendl;
 	  fault();
-        }
+        } else {
+	  conn_stats.out_msgs.inc();
+	  conn_stats.out_bytes.add(blist.length());
+	}
 	m->put();
       }
       continue;
@@ -1941,6 +2036,8 @@ int Pipe::read_message(Message **pm, AuthSessionHandler* auth_handler)
   Message *message;
   utime_t recv_stamp = ceph_clock_now(msgr->cct);
 
+  uint64_t throttle_start = Cycles::rdtsc();
+
   if (policy.throttler_messages) {
     ldout(msgr->cct,10) << "reader wants " << 1 << " message from policy throttler "
 			<< policy.throttler_messages->get_current() << "/"
@@ -1967,6 +2064,8 @@ int Pipe::read_message(Message **pm, AuthSessionHandler* auth_handler)
     msgr->dispatch_throttler.get(message_size);
   }
 
+  conn_stats.throttle_stall_cycles.add(Cycles::rdtsc() - throttle_start);
+
   utime_t throttle_stamp = ceph_clock_now(msgr->cct);
 
   // read front
@@ -2104,6 +2203,9 @@ int Pipe::read_message(Message **pm, AuthSessionHandler* auth_handler)
   message->set_throttle_stamp(throttle_stamp);
   message->set_recv_complete_stamp(ceph_clock_now(msgr->cct));
 
+  conn_stats.in_msgs.inc();
+  conn_stats.in_bytes.add(message_size);
+
   *pm = message;
   return 0;
 
@@ -2239,7 +2341,8 @@ int Pipe::write_keepalive2(char tag, const utime_t& t)
 }
 
 
-int Pipe::write_message(const ceph_msg_header& header, const ceph_msg_footer& footer, bufferlist& blist)
+int Pipe::write_message(const ceph_msg_header& header, const ceph_msg_footer& footer,
+			bufferlist& blist, bool more)
 {
   int ret;
 
@@ -2352,7 +2455,7 @@ int Pipe::write_message(const ceph_msg_header& header, const ceph_msg_footer& fo
   }
 
   // send
-  if (do_sendmsg(&msg, msglen))
+  if (do_sendmsg(&msg, msglen, more))
     goto fail;
 
   ret = 0;
@@ -185,7 +185,10 @@ class DispatchQueue;
     int peer_type;
     entity_addr_t peer_addr;
     Messenger::Policy policy;
-    
+
+    /// always-on traffic counters, sampled by "dump_conn_stats"
+    ConnectionStats conn_stats;
+
     Mutex pipe_lock;
     int state;
     atomic_t state_closed; // non-zero iff state = STATE_CLOSED
@@ -230,7 +233,10 @@ class DispatchQueue;
 
     int read_message(Message **pm,
 		     AuthSessionHandler *session_security_copy);
-    int write_message(const ceph_msg_header& h, const ceph_msg_footer& f, bufferlist& body);
+    /// @param more another message is already queued behind this one,
+    ///   so ask the kernel to batch rather than push a segment now
+    int write_message(const ceph_msg_header& h, const ceph_msg_footer& f,
+		      bufferlist& body, bool more);
     /**
      * Write the given data (of length len) to the Pipe's socket. This function
      * will loop until all passed data has been written out.
@@ -295,6 +301,7 @@ class DispatchQueue;
     void _send(Message *m) {
       assert(pipe_lock.is_locked());
       out_q[m->get_priority()].push_back(m);
+      conn_stats.queued();
       cond.Signal();
     }
     void _send_keepalive() {
@@ -310,6 +317,7 @@ class DispatchQueue;
         if (!p->second.empty()) {
           m = p->second.front();
           p->second.pop_front();
+          conn_stats.out_q_len.dec();
         }
         if (p->second.empty())
           out_q.erase(p->first);
@@ -20,6 +20,7 @@
 #include "SimpleMessenger.h"
 
 #include "common/config.h"
+#include "common/Formatter.h"
 #include "common/Timer.h"
 #include "common/errno.h"
 #include "auth/Crypto.h"
@@ -41,7 +42,7 @@ SimpleMessenger::SimpleMessenger(CephContext *cct, entity_name_t name,
 				 string mname, uint64_t _nonce, uint64_t features)
   : SimplePolicyMessenger(cct, name,mname, _nonce),
     accepter(this, _nonce),
-    dispatch_queue(cct, this),
+    dispatch_queue(cct, this, mname),
     reaper_thread(this),
     nonce(_nonce),
     lock("SimpleMessenger::lock"), need_addr(true), did_bind(false),
@@ -714,3 +715,21 @@ void SimpleMessenger::init_local_connection()
   local_connection->set_features(local_features);
   ms_deliver_handle_fast_connect(local_connection.get());
 }
+
+void SimpleMessenger::dump_conn_stats(ceph::Formatter *f)
+{
+  Mutex::Locker l(lock);
+  f->open_array_section("connections");
+  for (ceph::unordered_map<entity_addr_t, Pipe*>::iterator p = rank_pipe.begin();
+       p != rank_pipe.end();
+       ++p) {
+    Pipe *pipe = p->second;
+    f->open_object_section("connection");
+    f->dump_stream("peer_addr") << pipe->peer_addr;
+    f->dump_string("peer_type", ceph_entity_type_name(pipe->peer_type));
+    f->dump_string("state", pipe->get_state_name(pipe->state));
+    pipe->conn_stats.dump(f);
+    f->close_section();
+  }
+  f->close_section();
+}
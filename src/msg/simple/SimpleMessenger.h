@@ -102,6 +102,8 @@ public:
   double get_dispatch_queue_max_age(utime_t now) {
     return dispatch_queue.get_max_age(now);
   }
+
+  void dump_conn_stats(ceph::Formatter *f);
   /** @} Accessors */
 
   /**
@@ -103,6 +103,7 @@ XioConnection::XioConnection(XioMessenger *m, XioConnection::type _type,
   int xopt;
 
   policy = m->get_policy(peer_type);
+  cstate.policy = policy; /* resetcheck, lossy, and the throttlers */
 
   if (policy.throttler_messages) {
     max_msgs = policy.throttler_messages->get_max();
@@ -263,6 +264,28 @@ int XioConnection::on_msg_req(struct xio_session *session,
     }
   }
 
+  /* take refs on the policy throttles.  unlike Pipe we cannot block
+   * here--the portal thread is shared--so take() unconditionally and
+   * rely on Accelio's credit scheme (the receive queue depths are
+   * sized from the same policy in our ctor) for the backpressure.
+   * this keeps xio traffic counted against the same global budgets
+   * as the other messengers. */
+  uint64_t msg_size = (uint64_t) header.front_len + header.middle_len +
+    header.data_len;
+  if (cstate.policy.throttler_messages) {
+    ldout(msgr->cct,10) << __func__ << " wants 1 message from policy throttler "
+      << cstate.policy.throttler_messages->get_current() << "/"
+      << cstate.policy.throttler_messages->get_max() << dendl;
+    cstate.policy.throttler_messages->take();
+  }
+  if (msg_size && cstate.policy.throttler_bytes) {
+    ldout(msgr->cct,10) << __func__ << " wants " << msg_size
+      << " bytes from policy throttler "
+      << cstate.policy.throttler_bytes->get_current() << "/"
+      << cstate.policy.throttler_bytes->get_max() << dendl;
+    cstate.policy.throttler_bytes->take(msg_size);
+  }
+
   unsigned int ix, blen, iov_len;
   struct xio_iovec_ex *msg_iov, *iovs;
   uint32_t take_len, left_len = 0;
@@ -385,6 +408,11 @@ int XioConnection::on_msg_req(struct xio_session *session,
     /* trace flag */
     m->set_magic(magic);
 
+    /* the throttle refs taken above are returned when the message is
+     * consumed (Message dtor) */
+    m->set_byte_throttler(cstate.policy.throttler_bytes);
+    m->set_message_throttler(cstate.policy.throttler_messages);
+
     /* update timestamps */
     m->set_recv_stamp(recv_stamp);
     m->set_recv_complete_stamp(ceph_clock_now(msgr->cct));
@@ -416,6 +444,12 @@ int XioConnection::on_msg_req(struct xio_session *session,
     /* dispatch it */
     msgr->ds_dispatch(m);
   } else {
+    /* give back the refs the message would have released */
+    if (cstate.policy.throttler_messages)
+      cstate.policy.throttler_messages->put();
+    if (msg_size && cstate.policy.throttler_bytes)
+      cstate.policy.throttler_bytes->put(msg_size);
+
     /* responds for undecoded messages and frees hook */
     ldout(msgr->cct,4) << "decode m failed" << dendl;
     m_hook->on_err_finalize(this);
@@ -33,6 +33,7 @@ atomic_t initialized;
 atomic_t XioMessenger::nInstances;
 
 struct xio_mempool *xio_msgr_noreg_mpool;
+struct xio_mempool *xio_msgr_reg_mpool;
 
 static struct xio_session_ops xio_msgr_ops;
 
@@ -358,6 +359,23 @@ XioMessenger::XioMessenger(CephContext *cct, entity_name_t name,
 				       cct->_conf->xio_mp_max_page,
 				       XMSG_MEMPOOL_QUANTUM, 0);
 
+      /* pre-registered pool backing buffer::create_reg() and the
+       * send-side bounce copy.  chunks here carry their mr, so data
+       * sent from them goes out without a per-send registration */
+      xio_msgr_reg_mpool =
+	xio_mempool_create(-1 /* nodeid */, XIO_MEMPOOL_FLAG_REG_MR);
+
+      (void) xio_mempool_add_slab(xio_msgr_reg_mpool, getpagesize(),
+				       cct->_conf->xio_mp_min,
+				       cct->_conf->xio_mp_max_page,
+				       XMSG_MEMPOOL_QUANTUM, 0);
+      (void) xio_mempool_add_slab(xio_msgr_reg_mpool, 65536,
+				       0, 1024, 64, 0);
+      (void) xio_mempool_add_slab(xio_msgr_reg_mpool, 262144,
+				       0, 256, 16, 0);
+      (void) xio_mempool_add_slab(xio_msgr_reg_mpool, 1048576,
+				       0, 64, 8, 0);
+
       /* initialize ops singleton */
       xio_msgr_ops.on_session_event = on_session_event;
       xio_msgr_ops.on_new_session = on_new_session;
@@ -832,6 +850,33 @@ int XioMessenger::_send_message_impl(Message* m, XioConnection* xcon)
   buffer::list &middle = m->get_middle();
   buffer::list &data = m->get_data();
 
+  /* if the data payload lives in unregistered memory, Accelio must
+   * register it with the NIC for every send.  for moderate sizes it
+   * is cheaper to copy into a slab from the pre-registered pool,
+   * which also coalesces the segment list.  the copy preserves the
+   * bytes, so the crc computed by encode() above still holds. */
+  uint64_t reg_copy_max = cct->_conf->xio_max_reg_copy;
+  if (xio_msgr_reg_mpool && reg_copy_max &&
+      data.length() && data.length() <= reg_copy_max) {
+    bool registered = true;
+    const std::list<buffer::ptr>& dbufs = data.buffers();
+    list<bufferptr>::const_iterator pb;
+    for (pb = dbufs.begin(); registered && pb != dbufs.end(); ++pb) {
+      if (! get_xio_mp(*pb))
+	registered = false;
+    }
+    if (! registered) {
+      buffer::raw* reg = buffer::create_reg(data.length());
+      if (reg) {
+	buffer::ptr bp(reg);
+	data.copy(0, data.length(), bp.c_str());
+	buffer::list reg_data;
+	reg_data.append(bp);
+	m->set_data(reg_data);
+      } /* else the pool is exhausted; register in place as before */
+    }
+  }
+
   int msg_off = 0;
   int req_off = 0;
   int req_size = 0;
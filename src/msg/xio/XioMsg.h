@@ -137,6 +137,7 @@ public:
 WRITE_CLASS_ENCODER(XioMsgHdr);
 
 extern struct xio_mempool *xio_msgr_noreg_mpool;
+extern struct xio_mempool *xio_msgr_reg_mpool;
 
 #define XIO_MSGR_IOVLEN 16
 
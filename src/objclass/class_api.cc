@@ -548,6 +548,61 @@ int cls_cxx_map_remove_key(cls_method_context_t hctx, const string &key)
   return (*pctx)->pg->do_osd_ops(*pctx, ops);
 }
 
+int cls_cxx_map_get_vals_by_keys(cls_method_context_t hctx,
+				 const set<string> &keys,
+				 map<string, bufferlist> *vals)
+{
+  ReplicatedPG::OpContext **pctx = (ReplicatedPG::OpContext **)hctx;
+  vector<OSDOp> ops(1);
+  OSDOp& op = ops[0];
+  int ret;
+
+  ::encode(keys, op.indata);
+
+  op.op.op = CEPH_OSD_OP_OMAPGETVALSBYKEYS;
+  ret = (*pctx)->pg->do_osd_ops(*pctx, ops);
+  if (ret < 0)
+    return ret;
+
+  bufferlist::iterator iter = op.outdata.begin();
+  try {
+    ::decode(*vals, iter);
+  } catch (buffer::error& e) {
+    return -EIO;
+  }
+  return vals->size();
+}
+
+int cls_cxx_map_remove_keys(cls_method_context_t hctx, const set<string> &keys)
+{
+  ReplicatedPG::OpContext **pctx = (ReplicatedPG::OpContext **)hctx;
+  vector<OSDOp> ops(1);
+  OSDOp& op = ops[0];
+  bufferlist& update_bl = op.indata;
+
+  ::encode(keys, update_bl);
+
+  op.op.op = CEPH_OSD_OP_OMAPRMKEYS;
+
+  return (*pctx)->pg->do_osd_ops(*pctx, ops);
+}
+
+int cls_cxx_map_scanner::next_chunk(map<string, bufferlist> *vals)
+{
+  vals->clear();
+  if (end)
+    return 0;
+  int ret = cls_cxx_map_get_vals(hctx, next_after, filter_prefix, chunk_size,
+				 vals);
+  if (ret < 0)
+    return ret;
+  if (vals->size() < chunk_size)
+    end = true;
+  else
+    next_after = vals->rbegin()->first;
+  return vals->size();
+}
+
 int cls_gen_random_bytes(char *buf, int size)
 {
   return get_random_bytes(buf, size);
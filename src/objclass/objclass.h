@@ -131,8 +131,42 @@ extern int cls_cxx_map_set_vals(cls_method_context_t hctx,
                                 const std::map<string, bufferlist> *map);
 extern int cls_cxx_map_write_header(cls_method_context_t hctx, bufferlist *inbl);
 extern int cls_cxx_map_remove_key(cls_method_context_t hctx, const string &key);
+extern int cls_cxx_map_get_vals_by_keys(cls_method_context_t hctx,
+                                        const std::set<string> &keys,
+                                        std::map<string, bufferlist> *vals);
+extern int cls_cxx_map_remove_keys(cls_method_context_t hctx,
+                                   const std::set<string> &keys);
 extern int cls_cxx_map_update(cls_method_context_t hctx, bufferlist *inbl);
 
+/*
+ * Streams a key range out of the object's omap in fixed-size chunks,
+ * costing one ObjectStore call per chunk instead of one per key.
+ * Typical use:
+ *
+ *   cls_cxx_map_scanner scan(hctx, marker, prefix, 128);
+ *   std::map<string, bufferlist> chunk;
+ *   while (!scan.at_end()) {
+ *     int r = scan.next_chunk(&chunk);
+ *     if (r < 0)
+ *       return r;
+ *     // process chunk
+ *   }
+ */
+class cls_cxx_map_scanner {
+  cls_method_context_t hctx;
+  string next_after;
+  string filter_prefix;
+  uint64_t chunk_size;
+  bool end;
+public:
+  cls_cxx_map_scanner(cls_method_context_t _hctx, const string &start_after,
+                      const string &_filter_prefix, uint64_t _chunk_size)
+    : hctx(_hctx), next_after(start_after), filter_prefix(_filter_prefix),
+      chunk_size(_chunk_size), end(false) {}
+  int next_chunk(std::map<string, bufferlist> *vals);
+  bool at_end() const { return end; }
+};
+
 /* utility functions */
 extern int cls_gen_random_bytes(char *buf, int size);
 extern int cls_gen_rand_base64(char *dest, int size); /* size should be the required string size + 1 */
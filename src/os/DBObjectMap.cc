@@ -230,6 +230,7 @@ int DBObjectMap::DBObjectMapIteratorImpl::init()
   if (ready) {
     return 0;
   }
+  map->maybe_flush_pending_batch();
   assert(!parent_iter);
   if (header->parent) {
     Header parent = map->lookup_parent(header);
@@ -442,7 +443,7 @@ int DBObjectMap::set_keys(const ghobject_t &oid,
 			  const map<string, bufferlist> &set,
 			  const SequencerPosition *spos)
 {
-  KeyValueDB::Transaction t = db->get_transaction();
+  KeyValueDB::Transaction t = get_mutation_transaction();
   MapHeaderLock hl(this, oid);
   Header header = lookup_create_map_header(hl, oid, t);
   if (!header)
@@ -452,14 +453,14 @@ int DBObjectMap::set_keys(const ghobject_t &oid,
 
   t->set(user_prefix(header), set);
 
-  return db->submit_transaction(t);
+  return submit_mutation_transaction(t);
 }
 
 int DBObjectMap::set_header(const ghobject_t &oid,
 			    const bufferlist &bl,
 			    const SequencerPosition *spos)
 {
-  KeyValueDB::Transaction t = db->get_transaction();
+  KeyValueDB::Transaction t = get_mutation_transaction();
   MapHeaderLock hl(this, oid);
   Header header = lookup_create_map_header(hl, oid, t);
   if (!header)
@@ -467,7 +468,7 @@ int DBObjectMap::set_header(const ghobject_t &oid,
   if (check_spos(oid, header, spos))
     return 0;
   _set_header(header, bl, t);
-  return db->submit_transaction(t);
+  return submit_mutation_transaction(t);
 }
 
 void DBObjectMap::_set_header(Header header, const bufferlist &bl,
@@ -492,6 +493,7 @@ int DBObjectMap::get_header(const ghobject_t &oid,
 int DBObjectMap::_get_header(Header header,
 			     bufferlist *bl)
 {
+  maybe_flush_pending_batch();
   map<string, bufferlist> out;
   while (true) {
     out.clear();
@@ -516,7 +518,7 @@ int DBObjectMap::_get_header(Header header,
 int DBObjectMap::clear(const ghobject_t &oid,
 		       const SequencerPosition *spos)
 {
-  KeyValueDB::Transaction t = db->get_transaction();
+  KeyValueDB::Transaction t = get_mutation_transaction();
   MapHeaderLock hl(this, oid);
   Header header = lookup_map_header(hl, oid);
   if (!header)
@@ -529,7 +531,7 @@ int DBObjectMap::clear(const ghobject_t &oid,
   int r = _clear(header, t);
   if (r < 0)
     return r;
-  return db->submit_transaction(t);
+  return submit_mutation_transaction(t);
 }
 
 int DBObjectMap::_clear(Header header,
@@ -642,12 +644,12 @@ int DBObjectMap::rm_keys(const ghobject_t &oid,
   Header header = lookup_map_header(hl, oid);
   if (!header)
     return -ENOENT;
-  KeyValueDB::Transaction t = db->get_transaction();
+  KeyValueDB::Transaction t = get_mutation_transaction();
   if (check_spos(oid, header, spos))
     return 0;
   t->rmkeys(user_prefix(header), to_clear);
   if (!header->parent) {
-    return db->submit_transaction(t);
+    return submit_mutation_transaction(t);
   }
 
   // Copy up keys from parent around to_clear
@@ -706,13 +708,13 @@ int DBObjectMap::rm_keys(const ghobject_t &oid,
     set_map_header(hl, oid, *header, t);
     t->rmkeys_by_prefix(complete_prefix(header));
   }
-  return db->submit_transaction(t);
+  return submit_mutation_transaction(t);
 }
 
 int DBObjectMap::clear_keys_header(const ghobject_t &oid,
 				   const SequencerPosition *spos)
 {
-  KeyValueDB::Transaction t = db->get_transaction();
+  KeyValueDB::Transaction t = get_mutation_transaction();
   MapHeaderLock hl(this, oid);
   Header header = lookup_map_header(hl, oid);
   if (!header)
@@ -721,6 +723,7 @@ int DBObjectMap::clear_keys_header(const ghobject_t &oid,
     return 0;
 
   // save old attrs
+  maybe_flush_pending_batch();
   KeyValueDB::Iterator iter = db->get_iterator(xattr_prefix(header));
   if (!iter)
     return -EINVAL;
@@ -743,7 +746,7 @@ int DBObjectMap::clear_keys_header(const ghobject_t &oid,
   set_map_header(hl, oid, *newheader, t);
   if (!attrs.empty())
     t->set(xattr_prefix(newheader), attrs);
-  return db->submit_transaction(t);
+  return submit_mutation_transaction(t);
 }
 
 int DBObjectMap::get(const ghobject_t &oid,
@@ -832,6 +835,7 @@ int DBObjectMap::get_xattrs(const ghobject_t &oid,
   Header header = lookup_map_header(hl, oid);
   if (!header)
     return -ENOENT;
+  maybe_flush_pending_batch();
   return db->get(xattr_prefix(header), to_get, out);
 }
 
@@ -842,6 +846,7 @@ int DBObjectMap::get_all_xattrs(const ghobject_t &oid,
   Header header = lookup_map_header(hl, oid);
   if (!header)
     return -ENOENT;
+  maybe_flush_pending_batch();
   KeyValueDB::Iterator iter = db->get_iterator(xattr_prefix(header));
   if (!iter)
     return -EINVAL;
@@ -854,7 +859,7 @@ int DBObjectMap::set_xattrs(const ghobject_t &oid,
 			    const map<string, bufferlist> &to_set,
 			    const SequencerPosition *spos)
 {
-  KeyValueDB::Transaction t = db->get_transaction();
+  KeyValueDB::Transaction t = get_mutation_transaction();
   MapHeaderLock hl(this, oid);
   Header header = lookup_create_map_header(hl, oid, t);
   if (!header)
@@ -862,14 +867,14 @@ int DBObjectMap::set_xattrs(const ghobject_t &oid,
   if (check_spos(oid, header, spos))
     return 0;
   t->set(xattr_prefix(header), to_set);
-  return db->submit_transaction(t);
+  return submit_mutation_transaction(t);
 }
 
 int DBObjectMap::remove_xattrs(const ghobject_t &oid,
 			       const set<string> &to_remove,
 			       const SequencerPosition *spos)
 {
-  KeyValueDB::Transaction t = db->get_transaction();
+  KeyValueDB::Transaction t = get_mutation_transaction();
   MapHeaderLock hl(this, oid);
   Header header = lookup_map_header(hl, oid);
   if (!header)
@@ -877,7 +882,7 @@ int DBObjectMap::remove_xattrs(const ghobject_t &oid,
   if (check_spos(oid, header, spos))
     return 0;
   t->rmkeys(xattr_prefix(header), to_remove);
-  return db->submit_transaction(t);
+  return submit_mutation_transaction(t);
 }
 
 int DBObjectMap::clone(const ghobject_t &oid,
@@ -898,7 +903,7 @@ int DBObjectMap::clone(const ghobject_t &oid,
     ltarget= &_l2;
   }
 
-  KeyValueDB::Transaction t = db->get_transaction();
+  KeyValueDB::Transaction t = get_mutation_transaction();
   {
     Header destination = lookup_map_header(*ltarget, target);
     if (destination) {
@@ -912,7 +917,7 @@ int DBObjectMap::clone(const ghobject_t &oid,
 
   Header parent = lookup_map_header(*lsource, oid);
   if (!parent)
-    return db->submit_transaction(t);
+    return submit_mutation_transaction(t);
 
   Header source = generate_new_header(oid, parent);
   Header destination = generate_new_header(target, parent);
@@ -925,6 +930,7 @@ int DBObjectMap::clone(const ghobject_t &oid,
   set_map_header(*ltarget, target, *destination, t);
 
   map<string, bufferlist> to_set;
+  maybe_flush_pending_batch();
   KeyValueDB::Iterator xattr_iter = db->get_iterator(xattr_prefix(parent));
   for (xattr_iter->seek_to_first();
        xattr_iter->valid();
@@ -933,7 +939,7 @@ int DBObjectMap::clone(const ghobject_t &oid,
   t->set(xattr_prefix(source), to_set);
   t->set(xattr_prefix(destination), to_set);
   t->rmkeys_by_prefix(xattr_prefix(parent));
-  return db->submit_transaction(t);
+  return submit_mutation_transaction(t);
 }
 
 int DBObjectMap::upgrade_to_v2()
@@ -1032,6 +1038,8 @@ int DBObjectMap::init(bool do_upgrade)
 
 int DBObjectMap::sync(const ghobject_t *oid,
 		      const SequencerPosition *spos) {
+  // commit boundary: merge out anything batched before the sync write
+  maybe_flush_pending_batch();
   KeyValueDB::Transaction t = db->get_transaction();
   if (oid) {
     assert(spos);
@@ -1060,6 +1068,63 @@ int DBObjectMap::sync(const ghobject_t *oid,
   }
 }
 
+KeyValueDB::Transaction DBObjectMap::get_mutation_transaction()
+{
+  if (!batch_max_ops)
+    return db->get_transaction();
+  return KeyValueDB::Transaction(new BufferedTransactionImpl());
+}
+
+int DBObjectMap::submit_mutation_transaction(KeyValueDB::Transaction t)
+{
+  if (!batch_max_ops)
+    return db->submit_transaction(t);
+  BufferedTransactionImpl *buffered =
+    static_cast<BufferedTransactionImpl*>(t.get());
+  Mutex::Locker l(batch_lock);
+  pending_batch_ops += buffered->ops.size();
+  pending_batch.splice(pending_batch.end(), buffered->ops);
+  if (pending_batch_ops >= batch_max_ops)
+    return _flush_pending_batch();
+  return 0;
+}
+
+int DBObjectMap::maybe_flush_pending_batch()
+{
+  if (!batch_max_ops)
+    return 0;
+  Mutex::Locker l(batch_lock);
+  return _flush_pending_batch();
+}
+
+int DBObjectMap::_flush_pending_batch()
+{
+  assert(batch_lock.is_locked());
+  if (pending_batch.empty())
+    return 0;
+  dout(20) << "_flush_pending_batch: merging " << pending_batch_ops
+	   << " ops into one transaction" << dendl;
+  KeyValueDB::Transaction t = db->get_transaction();
+  for (list<BufferedTransactionImpl::op_t>::iterator i = pending_batch.begin();
+       i != pending_batch.end();
+       ++i) {
+    switch (i->type) {
+    case BufferedTransactionImpl::OP_SET:
+      t->set(i->prefix, i->key, i->value);
+      break;
+    case BufferedTransactionImpl::OP_RMKEY:
+      t->rmkey(i->prefix, i->key);
+      break;
+    case BufferedTransactionImpl::OP_RMKEYS_BY_PREFIX:
+      t->rmkeys_by_prefix(i->prefix);
+      break;
+    }
+  }
+  pending_batch.clear();
+  pending_batch_ops = 0;
+  return db->submit_transaction(t);
+}
+
 int DBObjectMap::write_state(KeyValueDB::Transaction _t) {
   assert(header_lock.is_locked_by_me());
   dout(20) << "dbobjectmap: seq is " << state.seq << dendl;
@@ -1092,6 +1157,7 @@ DBObjectMap::Header DBObjectMap::_lookup_map_header(
   map<string, bufferlist> out;
   set<string> to_get;
   to_get.insert(map_header_key(oid));
+  maybe_flush_pending_batch();
   int r = db->get(HOBJECT_TO_SEQ, to_get, &out);
   if (r < 0 || out.empty()) {
     delete header;
@@ -1134,12 +1200,27 @@ DBObjectMap::Header DBObjectMap::lookup_parent(Header input)
   Mutex::Locker l(header_lock);
   while (in_use.count(input->parent))
     header_cond.Wait(header_lock);
+
+  {
+    _Header *cached = new _Header();
+    Mutex::Locker c(cache_lock);
+    if (parent_caches.lookup(input->parent, cached)) {
+      dout(20) << "lookup_parent: parent " << input->parent
+	   << " for seq " << input->seq << " (cached)" << dendl;
+      Header ret(cached, RemoveOnDelete(this));
+      in_use.insert(ret->seq);
+      return ret;
+    }
+    delete cached;
+  }
+
   map<string, bufferlist> out;
   set<string> keys;
   keys.insert(HEADER_KEY);
 
   dout(20) << "lookup_parent: parent " << input->parent
        << " for seq " << input->seq << dendl;
+  maybe_flush_pending_batch();
   int r = db->get(sys_parent_prefix(input), keys, &out);
   if (r < 0) {
     assert(0);
@@ -1156,6 +1237,10 @@ DBObjectMap::Header DBObjectMap::lookup_parent(Header input)
   header->decode(iter);
   dout(20) << "lookup_parent: parent seq is " << header->seq << " with parent "
        << header->parent << dendl;
+  {
+    Mutex::Locker c(cache_lock);
+    parent_caches.add(header->seq, *header);
+  }
   in_use.insert(header->seq);
   return header;
 }
@@ -1177,6 +1262,10 @@ DBObjectMap::Header DBObjectMap::lookup_create_map_header(
 void DBObjectMap::clear_header(Header header, KeyValueDB::Transaction t)
 {
   dout(20) << "clear_header: clearing seq " << header->seq << dendl;
+  {
+    Mutex::Locker c(cache_lock);
+    parent_caches.clear(header->seq);
+  }
   t->rmkeys_by_prefix(user_prefix(header));
   t->rmkeys_by_prefix(sys_prefix(header));
   t->rmkeys_by_prefix(complete_prefix(header));
@@ -1189,6 +1278,10 @@ void DBObjectMap::clear_header(Header header, KeyValueDB::Transaction t)
 void DBObjectMap::set_header(Header header, KeyValueDB::Transaction t)
 {
   dout(20) << "set_header: setting seq " << header->seq << dendl;
+  {
+    Mutex::Locker c(cache_lock);
+    parent_caches.add(header->seq, *header);
+  }
   map<string, bufferlist> to_write;
   header->encode(to_write[HEADER_KEY]);
   t->set(sys_prefix(header), to_write);
@@ -1253,6 +1346,7 @@ bool DBObjectMap::check_spos(const ghobject_t &oid,
 
 int DBObjectMap::list_objects(vector<ghobject_t> *out)
 {
+  maybe_flush_pending_batch();
   KeyValueDB::Iterator iter = db->get_iterator(HOBJECT_TO_SEQ);
   for (iter->seek_to_first(); iter->valid(); iter->next()) {
     bufferlist bl = iter->value();
@@ -115,9 +115,51 @@ public:
 
   DBObjectMap(KeyValueDB *db) : db(db), header_lock("DBOBjectMap"),
                                 cache_lock("DBObjectMap::CacheLock"),
-                                caches(g_conf->filestore_omap_header_cache_size)
+                                caches(g_conf->filestore_omap_header_cache_size),
+                                parent_caches(g_conf->filestore_omap_header_cache_size),
+                                batch_lock("DBObjectMap::BatchLock"),
+                                batch_max_ops(g_conf->filestore_omap_batch_max_ops),
+                                pending_batch_ops(0)
     {}
 
+  /**
+   * Captures mutations in memory instead of a backend WriteBatch so
+   * that several omap mutations can be merged into a single backend
+   * transaction.  @see submit_mutation_transaction
+   */
+  class BufferedTransactionImpl : public KeyValueDB::TransactionImpl {
+  public:
+    enum op_type_t { OP_SET, OP_RMKEY, OP_RMKEYS_BY_PREFIX };
+    struct op_t {
+      op_type_t type;
+      string prefix;
+      string key;
+      bufferlist value;
+    };
+    list<op_t> ops;
+    void set(const string &prefix, const string &k, const bufferlist &bl) {
+      ops.push_back(op_t());
+      op_t &op = ops.back();
+      op.type = OP_SET;
+      op.prefix = prefix;
+      op.key = k;
+      op.value = bl;
+    }
+    void rmkey(const string &prefix, const string &k) {
+      ops.push_back(op_t());
+      op_t &op = ops.back();
+      op.type = OP_RMKEY;
+      op.prefix = prefix;
+      op.key = k;
+    }
+    void rmkeys_by_prefix(const string &prefix) {
+      ops.push_back(op_t());
+      op_t &op = ops.back();
+      op.type = OP_RMKEYS_BY_PREFIX;
+      op.prefix = prefix;
+    }
+  };
+
   int set_keys(
     const ghobject_t &oid,
     const map<string, bufferlist> &set,
@@ -328,6 +370,27 @@ private:
   typedef ceph::shared_ptr<_Header> Header;
   Mutex cache_lock;
   SimpleLRU<ghobject_t, _Header, ghobject_t::BitwiseComparator> caches;
+  /// clone-chain parent headers by seq, so chain walks avoid point gets
+  SimpleLRU<uint64_t, _Header> parent_caches;
+
+  /**
+   * Mutation batching (filestore_omap_batch_max_ops > 0): mutation ops
+   * accumulate in pending_batch and are submitted as one merged backend
+   * transaction once the batch fills, on sync(), or before any read
+   * that could observe them.
+   */
+  Mutex batch_lock;
+  unsigned batch_max_ops;
+  list<BufferedTransactionImpl::op_t> pending_batch;
+  unsigned pending_batch_ops;
+
+  /// transaction for a mutation; buffered if batching is enabled
+  KeyValueDB::Transaction get_mutation_transaction();
+  /// queue (or directly submit) a mutation transaction
+  int submit_mutation_transaction(KeyValueDB::Transaction t);
+  /// submit any pending batched mutations; cheap no-op when disabled
+  int maybe_flush_pending_batch();
+  int _flush_pending_batch();  ///< batch_lock held
 
   string map_header_key(const ghobject_t &oid);
   string header_key(uint64_t seq);
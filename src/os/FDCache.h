@@ -52,11 +52,29 @@ public:
 private:
   CephContext *cct;
   const int registry_shards;
+  const uint32_t shard_mask;
   SharedLRU<ghobject_t, FD, ghobject_t::BitwiseComparator> *registry;
 
+  /// shard count <= 0 means scale with the op thread count
+  static int _derive_shards(CephContext *cct) {
+    int n = cct->_conf->filestore_fd_cache_shards;
+    if (n <= 0)
+      n = MAX(cct->_conf->filestore_op_threads * 2, 1);
+    // power of two so we can shard by mask instead of division
+    int p = 1;
+    while (p < n)
+      p <<= 1;
+    return p;
+  }
+
+  int shard_index(const ghobject_t &hoid) const {
+    return hoid.hobj.get_hash() & shard_mask;
+  }
+
 public:
   FDCache(CephContext *cct) : cct(cct),
-  registry_shards(cct->_conf->filestore_fd_cache_shards) {
+  registry_shards(_derive_shards(cct)),
+  shard_mask(registry_shards - 1) {
     assert(cct);
     cct->_conf->add_observer(this);
     registry = new SharedLRU<ghobject_t, FD, ghobject_t::BitwiseComparator>[registry_shards];
@@ -73,19 +91,16 @@ public:
   typedef ceph::shared_ptr<FD> FDRef;
 
   FDRef lookup(const ghobject_t &hoid) {
-    int registry_id = hoid.hobj.get_hash() % registry_shards;
-    return registry[registry_id].lookup(hoid);
+    return registry[shard_index(hoid)].lookup(hoid);
   }
 
   FDRef add(const ghobject_t &hoid, int fd, bool *existed) {
-    int registry_id = hoid.hobj.get_hash() % registry_shards;
-    return registry[registry_id].add(hoid, new FD(fd), existed);
+    return registry[shard_index(hoid)].add(hoid, new FD(fd), existed);
   }
 
   /// clear cached fd for hoid, subsequent lookups will get an empty FD
   void clear(const ghobject_t &hoid) {
-    int registry_id = hoid.hobj.get_hash() % registry_shards;
-    registry[registry_id].purge(hoid);
+    registry[shard_index(hoid)].purge(hoid);
   }
 
   /// md_config_obs_t
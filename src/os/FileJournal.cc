@@ -1587,12 +1587,82 @@ void FileJournal::submit_entry(uint64_t seq, bufferlist& e, int alignment,
     completions.push_back(
       completion_item(
 	seq, oncommit, ceph_clock_now(g_ceph_context), osd_op));
-    if (writeq.empty())
+    if (writeq.empty() && !direct_submit)
       writeq_cond.Signal();
     writeq.push_back(write_item(seq, e, alignment, osd_op));
   }
+#ifdef HAVE_LIBAIO
+  if (direct_submit)
+    try_direct_submit();
+#endif
 }
 
+#ifdef HAVE_LIBAIO
+/**
+ * submit queued entries via aio directly from the queueing context.
+ *
+ * At low queue depth the wakeup of write_thread costs more than the
+ * write itself; if the device is idle and nobody else is writing, issue
+ * the aio here and let write_finish_thread reap it as usual.  Any
+ * contended or exceptional case (aios in flight, write_lock held, full
+ * journal) falls back to waking write_thread, which preserves the
+ * adaptive batching and full-journal handling.
+ */
+void FileJournal::try_direct_submit()
+{
+  assert(direct_submit);
+  {
+    Mutex::Locker locker(aio_lock);
+    if (aio_num > 0) {
+      // in-flight io; let write_thread batch adaptively
+      Mutex::Locker l(writeq_lock);
+      writeq_cond.Signal();
+      return;
+    }
+  }
+  if (!write_lock.TryLock()) {
+    Mutex::Locker l(writeq_lock);
+    writeq_cond.Signal();
+    return;
+  }
+  if (write_stop || full_state != FULL_NOTFULL) {
+    write_lock.Unlock();
+    Mutex::Locker l(writeq_lock);
+    writeq_cond.Signal();
+    return;
+  }
+
+  uint64_t orig_ops = 0;
+  uint64_t orig_bytes = 0;
+  bufferlist bl;
+  int r = prepare_multi_write(bl, orig_ops, orig_bytes);
+  if (r == -ENOSPC) {
+    // defer full handling to write_thread
+    write_lock.Unlock();
+    Mutex::Locker l(writeq_lock);
+    writeq_cond.Signal();
+    return;
+  }
+  assert(r == 0);
+
+  if (logger) {
+    logger->inc(l_os_j_wr);
+    logger->inc(l_os_j_wr_bytes, bl.length());
+  }
+
+  dout(20) << "try_direct_submit writing " << bl.length() << " bytes" << dendl;
+  do_aio_write(bl);
+  put_throttle(orig_ops, orig_bytes);
+
+  bool more = !writeq_empty();
+  write_lock.Unlock();
+  if (more) {
+    Mutex::Locker l(writeq_lock);
+    writeq_cond.Signal();
+  }
+}
+#endif
+
 bool FileJournal::writeq_empty()
 {
   Mutex::Locker locker(writeq_lock);
@@ -224,6 +224,7 @@ private:
   off64_t max_size;
   size_t block_size;
   bool directio, aio, force_aio;
+  bool direct_submit;
   bool must_write_header;
   off64_t write_pos;      // byte where the next entry to be written will go
   off64_t read_pos;       //
@@ -318,6 +319,9 @@ private:
   void check_aio_completion();
   void do_aio_write(bufferlist& bl);
   int write_aio_bl(off64_t& pos, bufferlist& bl, uint64_t seq);
+#ifdef HAVE_LIBAIO
+  void try_direct_submit();
+#endif
 
 
   void align_bl(off64_t pos, bufferlist& bl);
@@ -370,6 +374,7 @@ private:
     zero_buf(NULL),
     max_size(0), block_size(0),
     directio(dio), aio(ai), force_aio(faio),
+    direct_submit(false),
     must_write_header(false),
     write_pos(0), read_pos(0),
     discard(false),
@@ -401,6 +406,14 @@ private:
         aio = false;
       }
 #endif
+      if (g_conf->journal_direct_submit) {
+	if (aio && directio)
+	  direct_submit = true;
+	else
+	  derr << "FileJournal: journal_direct_submit requires aio and directio; disabling" << dendl;
+      }
+      write_thread.set_role("journal_write");
+      write_finish_thread.set_role("journal_finish");
   }
   ~FileJournal() {
     assert(fd == -1);
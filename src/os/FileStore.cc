@@ -533,6 +533,9 @@ FileStore::FileStore(const std::string &base, const std::string &jdev, osflagbit
   op_tp(g_ceph_context, "FileStore::op_tp", g_conf->filestore_op_threads, "filestore_op_threads"),
   op_wq(this, g_conf->filestore_op_thread_timeout,
 	g_conf->filestore_op_thread_suicide_timeout, &op_tp),
+  read_tp(g_ceph_context, "FileStore::read_tp", g_conf->filestore_read_threads, "filestore_read_threads"),
+  read_wq(this, g_conf->filestore_op_thread_timeout,
+	  g_conf->filestore_op_thread_suicide_timeout, &read_tp),
   logger(NULL),
   read_error_lock("FileStore::read_error_lock"),
   m_filestore_commit_timeout(g_conf->filestore_commit_timeout),
@@ -544,6 +547,9 @@ FileStore::FileStore(const std::string &base, const std::string &jdev, osflagbit
   m_filestore_min_sync_interval(g_conf->filestore_min_sync_interval),
   m_filestore_fail_eio(g_conf->filestore_fail_eio),
   m_filestore_fadvise(g_conf->filestore_fadvise),
+  m_filestore_coalesce_ops(g_conf->filestore_coalesce_ops),
+  m_filestore_mmap_reads(g_conf->filestore_mmap_reads),
+  m_filestore_mmap_read_min(g_conf->filestore_mmap_read_min),
   do_update(do_update),
   m_journal_dio(g_conf->journal_dio),
   m_journal_aio(g_conf->journal_aio),
@@ -556,6 +562,7 @@ FileStore::FileStore(const std::string &base, const std::string &jdev, osflagbit
   m_filestore_queue_committing_max_bytes(g_conf->filestore_queue_committing_max_bytes),
   m_filestore_do_dump(false),
   m_filestore_dump_fmt(true),
+  m_filestore_do_record(false),
   m_filestore_sloppy_crc(g_conf->filestore_sloppy_crc),
   m_filestore_sloppy_crc_block_size(g_conf->filestore_sloppy_crc_block_size),
   m_filestore_max_alloc_hint_size(g_conf->filestore_max_alloc_hint_size),
@@ -602,6 +609,7 @@ FileStore::FileStore(const std::string &base, const std::string &jdev, osflagbit
   plb.add_time_avg(l_os_commit_len, "commitcycle_interval", "Average interval between commits");
   plb.add_time_avg(l_os_commit_lat, "commitcycle_latency", "Average latency of commit");
   plb.add_u64_counter(l_os_j_full, "journal_full", "Journal writes while full");
+  plb.add_u64_counter(l_os_coalesced_ops, "coalesced_ops", "Transaction ops folded into a preceding syscall");
   plb.add_time_avg(l_os_queue_lat, "queue_transaction_latency_avg", "Store operation queue latency");
 
   logger = plb.create_perf_counters();
@@ -1622,6 +1630,7 @@ int FileStore::mount()
   journal_start();
 
   op_tp.start();
+  read_tp.start();
   op_finisher.start();
   ondisk_finisher.start();
 
@@ -1708,6 +1717,7 @@ int FileStore::umount()
   sync_thread.join();
   wbthrottle.stop();
   op_tp.stop();
+  read_tp.stop();
 
   journal_stop();
   if (!(generic_flags & SKIP_JOURNAL_REPLAY))
@@ -1899,14 +1909,29 @@ struct C_JournaledAhead : public Context {
   FileStore::OpSequencer *osr;
   FileStore::Op *o;
   Context *ondisk;
+  Context *ondisk_sync;
 
-  C_JournaledAhead(FileStore *f, FileStore::OpSequencer *os, FileStore::Op *o, Context *ondisk):
-    fs(f), osr(os), o(o), ondisk(ondisk) { }
+  C_JournaledAhead(FileStore *f, FileStore::OpSequencer *os, FileStore::Op *o,
+		   Context *ondisk, Context *ondisk_sync):
+    fs(f), osr(os), o(o), ondisk(ondisk), ondisk_sync(ondisk_sync) { }
   void finish(int r) {
-    fs->_journaled_ahead(osr, o, ondisk);
+    fs->_journaled_ahead(osr, o, ondisk, ondisk_sync);
   }
 };
 
+// run the sync commit contexts ahead of the async ones when the branch
+// at hand has no earlier point to complete them at
+static Context *prepend_sync_context(Context *sync, Context *async)
+{
+  if (!sync)
+    return async;
+  C_Contexts *c = new C_Contexts(g_ceph_context);
+  c->add(sync);
+  if (async)
+    c->add(async);
+  return c;
+}
+
 int FileStore::queue_transactions(Sequencer *posr, list<Transaction*> &tls,
 				  TrackedOpRef osd_op,
 				  ThreadPool::TPHandle *handle)
@@ -1914,11 +1939,13 @@ int FileStore::queue_transactions(Sequencer *posr, list<Transaction*> &tls,
   Context *onreadable;
   Context *ondisk;
   Context *onreadable_sync;
+  Context *ondisk_sync;
   ObjectStore::Transaction::collect_contexts(
-    tls, &onreadable, &ondisk, &onreadable_sync);
+    tls, &onreadable, &ondisk, &onreadable_sync, &ondisk_sync);
   if (g_conf->filestore_blackhole) {
     dout(0) << "queue_transactions filestore_blackhole = TRUE, dropping transaction" << dendl;
     delete ondisk;
+    delete ondisk_sync;
     delete onreadable;
     delete onreadable_sync;
     return 0;
@@ -1955,21 +1982,26 @@ int FileStore::queue_transactions(Sequencer *posr, list<Transaction*> &tls,
 
     if (m_filestore_do_dump)
       dump_transactions(o->tls, o->op, osr);
+    if (m_filestore_do_record)
+      record_transactions(o->tls, o->op);
 
     if (m_filestore_journal_parallel) {
       dout(5) << "queue_transactions (parallel) " << o->op << " " << o->tls << dendl;
-      
-      _op_journal_transactions(tbl, data_align, o->op, ondisk, osd_op);
-      
+
+      _op_journal_transactions(tbl, data_align, o->op,
+			       prepend_sync_context(ondisk_sync, ondisk),
+			       osd_op);
+
       // queue inside submit_manager op submission lock
       queue_op(osr, o);
     } else if (m_filestore_journal_writeahead) {
       dout(5) << "queue_transactions (writeahead) " << o->op << " " << o->tls << dendl;
-      
+
       osr->queue_journal(o->op);
 
       _op_journal_transactions(tbl, data_align, o->op,
-			       new C_JournaledAhead(this, osr, o, ondisk),
+			       new C_JournaledAhead(this, osr, o, ondisk,
+						    ondisk_sync),
 			       osd_op);
     } else {
       assert(0);
@@ -1989,9 +2021,12 @@ int FileStore::queue_transactions(Sequencer *posr, list<Transaction*> &tls,
 
     if (m_filestore_do_dump)
       dump_transactions(o->tls, o->op, osr);
+    if (m_filestore_do_record)
+      record_transactions(o->tls, o->op);
 
     queue_op(osr, o);
 
+    ondisk = prepend_sync_context(ondisk_sync, ondisk);
     if (ondisk)
       apply_manager.add_waiter(op_num, ondisk);
     submit_manager.op_submit_finish(op_num);
@@ -2004,9 +2039,12 @@ int FileStore::queue_transactions(Sequencer *posr, list<Transaction*> &tls,
   int data_align = _op_journal_transactions_prepare(tls, tbl);
   uint64_t op = submit_manager.op_submit_start();
   dout(5) << "queue_transactions (trailing journal) " << op << " " << tls << dendl;
+  ondisk = prepend_sync_context(ondisk_sync, ondisk);
 
   if (m_filestore_do_dump)
     dump_transactions(tls, op, osr);
+  if (m_filestore_do_record)
+    record_transactions(tls, op);
 
   apply_manager.op_apply_start(op);
   int r = do_transactions(tls, op);
@@ -2030,7 +2068,8 @@ int FileStore::queue_transactions(Sequencer *posr, list<Transaction*> &tls,
   return r;
 }
 
-void FileStore::_journaled_ahead(OpSequencer *osr, Op *o, Context *ondisk)
+void FileStore::_journaled_ahead(OpSequencer *osr, Op *o, Context *ondisk,
+				 Context *ondisk_sync)
 {
   dout(5) << "_journaled_ahead " << o << " seq " << o->op << " " << *osr << " " << o->tls << dendl;
 
@@ -2040,6 +2079,14 @@ void FileStore::_journaled_ahead(OpSequencer *osr, Op *o, Context *ondisk)
   list<Context*> to_queue;
   osr->dequeue_journal(&to_queue);
 
+  // sync completions run right here in the journal finisher, ahead of
+  // the hop through the ondisk finisher; the registrant promised to be
+  // quick about it
+  if (ondisk_sync) {
+    dout(10) << " completing ondisk_sync " << ondisk_sync << dendl;
+    ondisk_sync->complete(0);
+  }
+
   // do ondisk completions async, to prevent any onreadable_sync completions
   // getting blocked behind an ondisk completion.
   if (ondisk) {
@@ -2380,6 +2427,27 @@ unsigned FileStore::_do_transaction(
         uint32_t fadvise_flags = i.get_fadvise_flags();
         bufferlist bl;
         i.decode_bl(bl);
+	// fold in any immediately following writes that continue this
+	// one; rbd small sequential writes commonly land in the same
+	// transaction as several contiguous OP_WRITEs.
+	while (m_filestore_coalesce_ops && i.have_op()) {
+	  Transaction::Op *nop = i.peek_op();
+	  if (nop->op != Transaction::OP_WRITE || nop->off != off + len)
+	    break;
+	  coll_t ncid = i.get_cid(nop->cid);
+	  ghobject_t noid = i.get_oid(nop->oid);
+	  _kludge_temp_object_collection(ncid, noid);
+	  if (ncid != cid || noid != oid)
+	    break;
+	  i.decode_op();
+	  bufferlist nbl;
+	  i.decode_bl(nbl);
+	  bl.claim_append(nbl);
+	  len += nop->len;
+	  spos.op++;
+	  if (logger)
+	    logger->inc(l_os_coalesced_ops);
+	}
         tracepoint(objectstore, write_enter, osr_name, off, len);
         if (_check_replay_guard(cid, oid, spos) > 0)
           r = _write(cid, oid, off, len, bl, fadvise_flags);
@@ -2440,10 +2508,30 @@ unsigned FileStore::_do_transaction(
         string name = i.decode_string();
         bufferlist bl;
         i.decode_bl(bl);
+        map<string, bufferptr> to_set;
+        to_set[name] = bufferptr(bl.c_str(), bl.length());
+	// batch immediately following setattrs on the same object into
+	// one chain_setxattrs pass
+	while (m_filestore_coalesce_ops && i.have_op()) {
+	  Transaction::Op *nop = i.peek_op();
+	  if (nop->op != Transaction::OP_SETATTR)
+	    break;
+	  coll_t ncid = i.get_cid(nop->cid);
+	  ghobject_t noid = i.get_oid(nop->oid);
+	  _kludge_temp_object_collection(ncid, noid);
+	  if (ncid != cid || noid != oid)
+	    break;
+	  i.decode_op();
+	  string nname = i.decode_string();
+	  bufferlist nbl;
+	  i.decode_bl(nbl);
+	  to_set[nname] = bufferptr(nbl.c_str(), nbl.length());
+	  spos.op++;
+	  if (logger)
+	    logger->inc(l_os_coalesced_ops);
+	}
         tracepoint(objectstore, setattr_enter, osr_name);
         if (_check_replay_guard(cid, oid, spos) > 0) {
-          map<string, bufferptr> to_set;
-          to_set[name] = bufferptr(bl.c_str(), bl.length());
           r = _setattrs(cid, oid, to_set, spos);
           if (r == -ENOSPC)
             dout(0) << " ENOSPC on setxattr on " << cid << "/" << oid
@@ -2936,16 +3024,47 @@ int FileStore::read(
     posix_fadvise(**fd, offset, len, POSIX_FADV_SEQUENTIAL);
 #endif
 
-  bufferptr bptr(len);  // prealloc space for entire read
-  got = safe_pread(**fd, bptr.c_str(), len, offset);
-  if (got < 0) {
-    dout(10) << "FileStore::read(" << cid << "/" << oid << ") pread error: " << cpp_strerror(got) << dendl;
-    lfn_close(fd);
-    assert(allow_eio || !m_filestore_fail_eio || got != -EIO);
-    return got;
+  bool mapped = false;
+  if (m_filestore_mmap_reads &&
+      len >= m_filestore_mmap_read_min &&
+      !(op_flags & (CEPH_OSD_OP_FLAG_FADVISE_DONTNEED |
+		    CEPH_OSD_OP_FLAG_FADVISE_NOCACHE))) {
+    // zero-copy: reference the file pages directly instead of copying
+    // them out; the mapping is clipped to eof (mapped pages beyond it
+    // would fault) and released when the last bufferptr referencing it
+    // goes away
+    struct stat st;
+    memset(&st, 0, sizeof(struct stat));
+    r = ::fstat(**fd, &st);
+    assert(r == 0);
+    got = 0;
+    if (offset < (uint64_t)st.st_size) {
+      size_t l = MIN(len, (uint64_t)st.st_size - offset);
+      try {
+	bl.push_back(bufferptr(buffer::create_mmap_file(l, **fd, offset)));
+	got = l;
+	mapped = true;
+      } catch (buffer::error_code &e) {
+	dout(10) << "FileStore::read(" << cid << "/" << oid
+		 << ") mmap error, falling back to pread: "
+		 << cpp_strerror(e.code) << dendl;
+      }
+    } else {
+      mapped = true;   // read past eof; nothing to map
+    }
+  }
+  if (!mapped) {
+    bufferptr bptr(len);  // prealloc space for entire read
+    got = safe_pread(**fd, bptr.c_str(), len, offset);
+    if (got < 0) {
+      dout(10) << "FileStore::read(" << cid << "/" << oid << ") pread error: " << cpp_strerror(got) << dendl;
+      lfn_close(fd);
+      assert(allow_eio || !m_filestore_fail_eio || got != -EIO);
+      return got;
+    }
+    bptr.set_length(got);   // properly size the buffer
+    bl.push_back(bptr);   // put it in the target bufferlist
   }
-  bptr.set_length(got);   // properly size the buffer
-  bl.push_back(bptr);   // put it in the target bufferlist
 
 #ifdef HAVE_POSIX_FADVISE
   if (op_flags & CEPH_OSD_OP_FLAG_FADVISE_DONTNEED)
@@ -2977,6 +3096,56 @@ int FileStore::read(
   }
 }
 
+void FileStore::read_async(
+  coll_t cid,
+  const ghobject_t& oid,
+  uint64_t offset,
+  size_t len,
+  uint32_t op_flags,
+  bufferlist *pbl,
+  Context *onfinish)
+{
+  dout(15) << "read_async " << cid << "/" << oid << " " << offset << "~"
+	   << len << dendl;
+  read_wq.queue(new AsyncReadItem(cid, oid, offset, len, op_flags,
+				  pbl, onfinish));
+}
+
+void FileStore::_do_async_read(AsyncReadItem *i)
+{
+  int r = read(i->cid, i->oid, i->offset, i->len, *i->pbl, i->op_flags);
+  Context *fin = i->onfinish;
+  delete i;
+  fin->complete(r);
+}
+
+int FileStore::readahead(
+  coll_t cid,
+  const ghobject_t& oid,
+  uint64_t offset,
+  size_t len)
+{
+  _kludge_temp_object_collection(cid, oid);
+
+  dout(15) << "readahead " << cid << "/" << oid << " " << offset << "~"
+	   << len << dendl;
+
+  FDRef fd;
+  int r = lfn_open(cid, oid, false, &fd);
+  if (r < 0) {
+    dout(10) << "FileStore::readahead(" << cid << "/" << oid
+	     << ") open error: " << cpp_strerror(r) << dendl;
+    return r;
+  }
+
+#ifdef HAVE_POSIX_FADVISE
+  posix_fadvise(**fd, offset, len, POSIX_FADV_WILLNEED);
+#endif
+
+  lfn_close(fd);
+  return 0;
+}
+
 int FileStore::_do_fiemap(int fd, uint64_t offset, size_t len,
                           map<uint64_t, uint64_t> *m)
 {
@@ -3168,8 +3337,6 @@ int FileStore::_write(coll_t cid, const ghobject_t& oid,
   dout(15) << "write " << cid << "/" << oid << " " << offset << "~" << len << dendl;
   int r;
 
-  int64_t actual;
-
   FDRef fd;
   r = lfn_open(cid, oid, true, &fd);
   if (r < 0) {
@@ -3178,24 +3345,9 @@ int FileStore::_write(coll_t cid, const ghobject_t& oid,
 	    << cpp_strerror(r) << dendl;
     goto out;
   }
-    
-  // seek
-  actual = ::lseek64(**fd, offset, SEEK_SET);
-  if (actual < 0) {
-    r = -errno;
-    dout(0) << "write lseek64 to " << offset << " failed: " << cpp_strerror(r) << dendl;
-    lfn_close(fd);
-    goto out;
-  }
-  if (actual != (int64_t)offset) {
-    dout(0) << "write lseek64 to " << offset << " gave bad offset " << actual << dendl;
-    r = -EIO;
-    lfn_close(fd);
-    goto out;
-  }
 
-  // write
-  r = bl.write_fd(**fd);
+  // write (positioned scatter-gather; no seek, no bufferlist rebuild)
+  r = bl.write_fd(**fd, offset);
   if (r == 0)
     r = bl.length();
 
@@ -5390,6 +5542,7 @@ const char** FileStore::get_tracked_conf_keys() const
     "filestore_queue_committing_max_bytes",
     "filestore_commit_timeout",
     "filestore_dump_file",
+    "filestore_record_file",
     "filestore_kill_at",
     "filestore_fail_eio",
     "filestore_fadvise",
@@ -5455,6 +5608,14 @@ void FileStore::handle_conf_change(const struct md_config_t *conf,
       dump_stop();
     }
   }
+  if (changed.count("filestore_record_file")) {
+    if (conf->filestore_record_file.length() &&
+	conf->filestore_record_file != "-") {
+      record_start(conf->filestore_record_file);
+    } else {
+      record_stop();
+    }
+  }
 }
 
 void FileStore::dump_start(const std::string& file)
@@ -5498,6 +5659,46 @@ void FileStore::dump_transactions(list<ObjectStore::Transaction*>& ls, uint64_t
   m_filestore_dump.flush();
 }
 
+void FileStore::record_start(const std::string& file)
+{
+  dout(10) << "record_start " << file << dendl;
+  if (m_filestore_do_record) {
+    record_stop();
+  }
+  m_filestore_record.open(file.c_str(),
+			  std::ios::out | std::ios::binary | std::ios::trunc);
+  m_filestore_do_record = true;
+}
+
+void FileStore::record_stop()
+{
+  dout(10) << "record_stop" << dendl;
+  m_filestore_do_record = false;
+  if (m_filestore_record.is_open()) {
+    m_filestore_record.flush();
+    m_filestore_record.close();
+  }
+}
+
+void FileStore::record_transactions(list<ObjectStore::Transaction*>& ls, uint64_t seq)
+{
+  // one length-prefixed batch per op: seq, transaction count, then the
+  // transactions themselves, replayable by ceph_filestoretxreplay
+  bufferlist bl;
+  ::encode(seq, bl);
+  uint32_t n = ls.size();
+  ::encode(n, bl);
+  for (list<ObjectStore::Transaction*>::iterator i = ls.begin(); i != ls.end(); ++i) {
+    (*i)->encode(bl);
+  }
+  bufferlist hdr;
+  uint32_t len = bl.length();
+  ::encode(len, hdr);
+  hdr.write_stream(m_filestore_record);
+  bl.write_stream(m_filestore_record);
+  m_filestore_record.flush();
+}
+
 void FileStore::set_xattr_limits_via_conf()
 {
   uint32_t fs_xattr_size;
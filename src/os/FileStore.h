@@ -369,6 +369,55 @@ private:
     }
   } op_wq;
 
+  /// a queued read_async request
+  struct AsyncReadItem {
+    coll_t cid;
+    ghobject_t oid;
+    uint64_t offset;
+    size_t len;
+    uint32_t op_flags;
+    bufferlist *pbl;
+    Context *onfinish;
+    AsyncReadItem(coll_t c, const ghobject_t &o, uint64_t off, size_t l,
+		  uint32_t flags, bufferlist *b, Context *fin)
+      : cid(c), oid(o), offset(off), len(l), op_flags(flags),
+	pbl(b), onfinish(fin) {}
+  };
+  deque<AsyncReadItem*> read_queue;
+  ThreadPool read_tp;
+  struct ReadWQ : public ThreadPool::WorkQueue<AsyncReadItem> {
+    FileStore *store;
+    ReadWQ(FileStore *fs, time_t timeout, time_t suicide_timeout, ThreadPool *tp)
+      : ThreadPool::WorkQueue<AsyncReadItem>("FileStore::ReadWQ", timeout, suicide_timeout, tp), store(fs) {}
+
+    bool _enqueue(AsyncReadItem *i) {
+      store->read_queue.push_back(i);
+      return true;
+    }
+    void _dequeue(AsyncReadItem *i) {
+      assert(0);
+    }
+    bool _empty() {
+      return store->read_queue.empty();
+    }
+    AsyncReadItem *_dequeue() {
+      if (store->read_queue.empty())
+	return NULL;
+      AsyncReadItem *i = store->read_queue.front();
+      store->read_queue.pop_front();
+      return i;
+    }
+    void _process(AsyncReadItem *i, ThreadPool::TPHandle &handle) {
+      store->_do_async_read(i);
+    }
+    using ThreadPool::WorkQueue<AsyncReadItem>::_process;
+    void _clear() {
+      assert(store->read_queue.empty());
+    }
+  } read_wq;
+
+  void _do_async_read(AsyncReadItem *i);
+
   void _do_op(OpSequencer *o, ThreadPool::TPHandle &handle);
   void _finish_op(OpSequencer *o);
   Op *build_op(list<Transaction*>& tls,
@@ -377,7 +426,8 @@ private:
   void queue_op(OpSequencer *osr, Op *o);
   void op_queue_reserve_throttle(Op *o, ThreadPool::TPHandle *handle = NULL);
   void op_queue_release_throttle(Op *o);
-  void _journaled_ahead(OpSequencer *osr, Op *o, Context *ondisk);
+  void _journaled_ahead(OpSequencer *osr, Op *o, Context *ondisk,
+			Context *ondisk_sync);
   friend struct C_JournaledAhead;
 
   void new_journal();
@@ -542,6 +592,19 @@ public:
     bufferlist& bl,
     uint32_t op_flags = 0,
     bool allow_eio = false);
+  void read_async(
+    coll_t cid,
+    const ghobject_t& oid,
+    uint64_t offset,
+    size_t len,
+    uint32_t op_flags,
+    bufferlist *pbl,
+    Context *onfinish);
+  int readahead(
+    coll_t cid,
+    const ghobject_t& oid,
+    uint64_t offset,
+    size_t len);
   int _do_fiemap(int fd, uint64_t offset, size_t len,
                  map<uint64_t, uint64_t> *m);
   int _do_seek_hole_data(int fd, uint64_t offset, size_t len,
@@ -672,6 +735,10 @@ public:
   void dump_stop();
   void dump_transactions(list<ObjectStore::Transaction*>& ls, uint64_t seq, OpSequencer *osr);
 
+  void record_start(const std::string& file);
+  void record_stop();
+  void record_transactions(list<ObjectStore::Transaction*>& ls, uint64_t seq);
+
 private:
   void _inject_failure();
 
@@ -706,6 +773,9 @@ private:
   double m_filestore_min_sync_interval;
   bool m_filestore_fail_eio;
   bool m_filestore_fadvise;
+  bool m_filestore_coalesce_ops;
+  bool m_filestore_mmap_reads;
+  uint64_t m_filestore_mmap_read_min;
   int do_update;
   bool m_journal_dio, m_journal_aio, m_journal_force_aio;
   std::string m_osd_rollback_to_cluster_snap;
@@ -717,6 +787,8 @@ private:
   bool m_filestore_do_dump;
   std::ofstream m_filestore_dump;
   JSONFormatter m_filestore_dump_fmt;
+  bool m_filestore_do_record;
+  std::ofstream m_filestore_record;
   atomic_t m_filestore_kill_at;
   bool m_filestore_sloppy_crc;
   int m_filestore_sloppy_crc_block_size;
@@ -65,6 +65,15 @@ int JournalingObjectStore::journal_replay(uint64_t fs_op_seq)
   replaying = true;
 
   int count = 0;
+  if (g_conf->journal_replay_threads > 1) {
+    count = _journal_replay_parallel(op_seq, g_conf->journal_replay_threads);
+    replaying = false;
+    submit_manager.set_op_seq(op_seq);
+    err = journal->make_writeable();
+    if (err < 0)
+      return err;
+    return count;
+  }
   while (1) {
     bufferlist bl;
     uint64_t seq = op_seq + 1;
@@ -114,6 +123,141 @@ int JournalingObjectStore::journal_replay(uint64_t fs_op_seq)
 }
 
 
+void JournalingObjectStore::_replay_lane(ReplayLane *lane)
+{
+  for (list<pair<uint64_t, list<ObjectStore::Transaction*> > >::iterator p =
+	 lane->entries.begin();
+       p != lane->entries.end();
+       ++p) {
+    uint64_t seq = p->first;
+    dout(3) << "_replay_lane: applying op seq " << seq << dendl;
+    apply_manager.op_apply_start(seq);
+    int r = do_transactions(p->second, seq);
+    apply_manager.op_apply_finish(seq);
+    dout(3) << "_replay_lane: op seq " << seq << " r = " << r << dendl;
+    while (!p->second.empty()) {
+      delete p->second.front();
+      p->second.pop_front();
+    }
+  }
+}
+
+/**
+ * replay committed-but-unapplied journal entries in parallel.
+ *
+ * Entries touching disjoint collection sets are independent: apply
+ * order only matters within a collection.  Buffer a window of entries,
+ * assign each to a lane that owns all of its collections (first touch
+ * claims ownership), and run the lanes on dedicated threads.  An entry
+ * whose collections are already spread over several lanes -- or whose
+ * collections cannot be determined (legacy encoding) -- acts as a
+ * barrier: the window is drained and the entry applied serially.
+ */
+int JournalingObjectStore::_journal_replay_parallel(uint64_t &op_seq, int nthreads)
+{
+  dout(10) << "_journal_replay_parallel from op_seq " << op_seq
+	   << " with " << nthreads << " threads" << dendl;
+
+  unsigned window = MAX(g_conf->journal_replay_window, nthreads);
+  bool done = false;
+  while (!done) {
+    vector<ReplayLane> lanes(nthreads);
+    map<coll_t, int> owner;
+    unsigned buffered = 0;
+    uint64_t barrier_seq = 0;
+    list<ObjectStore::Transaction*> barrier_tls;
+
+    while (buffered < window) {
+      bufferlist bl;
+      uint64_t seq = op_seq + 1;
+      if (!journal->read_entry(bl, seq)) {
+	dout(3) << "_journal_replay_parallel: end of journal, done." << dendl;
+	done = true;
+	break;
+      }
+      if (seq <= op_seq) {
+	dout(3) << "_journal_replay_parallel: skipping old op seq " << seq
+		<< " <= " << op_seq << dendl;
+	continue;
+      }
+      assert(op_seq == seq - 1);
+      op_seq = seq;
+
+      bufferlist::iterator p = bl.begin();
+      list<ObjectStore::Transaction*> tls;
+      while (!p.end()) {
+	Transaction *t = new Transaction(p);
+	tls.push_back(t);
+      }
+
+      set<coll_t> colls;
+      bool known = true;
+      for (list<ObjectStore::Transaction*>::iterator t = tls.begin();
+	   t != tls.end();
+	   ++t)
+	known = known && (*t)->get_collections(&colls);
+
+      int lane = -1;
+      if (known) {
+	set<int> owners;
+	for (set<coll_t>::iterator c = colls.begin(); c != colls.end(); ++c) {
+	  map<coll_t, int>::iterator o = owner.find(*c);
+	  if (o != owner.end())
+	    owners.insert(o->second);
+	}
+	if (owners.empty()) {
+	  // least loaded lane claims the new collections
+	  lane = 0;
+	  for (int l = 1; l < nthreads; ++l)
+	    if (lanes[l].entries.size() < lanes[lane].entries.size())
+	      lane = l;
+	} else if (owners.size() == 1) {
+	  lane = *owners.begin();
+	}
+      }
+      if (lane < 0) {
+	// spans lanes (or unknown): drain the window, then apply serially
+	dout(10) << "_journal_replay_parallel: op seq " << seq
+		 << " is a barrier" << dendl;
+	barrier_seq = seq;
+	barrier_tls.swap(tls);
+	break;
+      }
+      for (set<coll_t>::iterator c = colls.begin(); c != colls.end(); ++c)
+	owner[*c] = lane;
+      lanes[lane].entries.push_back(make_pair(seq, tls));
+      buffered++;
+    }
+
+    list<ReplayWorker*> workers;
+    for (int l = 0; l < nthreads; ++l) {
+      if (lanes[l].entries.empty())
+	continue;
+      ReplayWorker *w = new ReplayWorker(this, &lanes[l]);
+      w->create();
+      workers.push_back(w);
+    }
+    while (!workers.empty()) {
+      workers.front()->join();
+      delete workers.front();
+      workers.pop_front();
+    }
+
+    if (barrier_seq) {
+      apply_manager.op_apply_start(barrier_seq);
+      int r = do_transactions(barrier_tls, barrier_seq);
+      apply_manager.op_apply_finish(barrier_seq);
+      dout(3) << "_journal_replay_parallel: barrier op seq " << barrier_seq
+	      << " r = " << r << dendl;
+      while (!barrier_tls.empty()) {
+	delete barrier_tls.front();
+	barrier_tls.pop_front();
+      }
+    }
+  }
+  return 0;
+}
+
 // ------------------------------------
 
 uint64_t JournalingObjectStore::ApplyManager::op_apply_start(uint64_t op)
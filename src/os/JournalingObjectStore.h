@@ -18,6 +18,7 @@
 #include "ObjectStore.h"
 #include "Journal.h"
 #include "common/RWLock.h"
+#include "common/Thread.h"
 
 class JournalingObjectStore : public ObjectStore {
 protected:
@@ -114,6 +115,24 @@ protected:
   void journal_write_close();
   int journal_replay(uint64_t fs_op_seq);
 
+  /// ordered slice of replay entries touching a disjoint set of collections
+  struct ReplayLane {
+    list<pair<uint64_t, list<ObjectStore::Transaction*> > > entries;
+  };
+  class ReplayWorker : public Thread {
+    JournalingObjectStore *store;
+    ReplayLane *lane;
+  public:
+    ReplayWorker(JournalingObjectStore *s, ReplayLane *l)
+      : store(s), lane(l) {}
+    void *entry() {
+      store->_replay_lane(lane);
+      return 0;
+    }
+  };
+  void _replay_lane(ReplayLane *lane);
+  int _journal_replay_parallel(uint64_t &op_seq, int nthreads);
+
   int _op_journal_transactions_prepare(
     list<ObjectStore::Transaction*>& tls, bufferlist& tbl);
   void _op_journal_transactions(bufferlist& tls, int data_align, uint64_t op,
@@ -115,6 +115,15 @@ public:
     virtual int prev() = 0;
     virtual string key() = 0;
     virtual pair<string,string> raw_key() = 0;
+    /**
+     * true if the current raw key has the given prefix.  The default
+     * materializes raw_key(); backends should override with a check
+     * against the raw key bytes in place, since this runs on every
+     * step of a prefix-bounded scan.
+     */
+    virtual bool raw_key_is_prefixed(const string &prefix) {
+      return raw_key().first == prefix;
+    }
     virtual bufferlist value() = 0;
     virtual int status() = 0;
     virtual ~WholeSpaceIteratorImpl() { }
@@ -144,8 +153,7 @@ public:
     bool valid() {
       if (!generic_iter->valid())
 	return false;
-      pair<string,string> raw_key = generic_iter->raw_key();
-      return (raw_key.first.compare(0, prefix.length(), prefix) == 0);
+      return generic_iter->raw_key_is_prefixed(prefix);
     }
     int next() {
       if (valid())
@@ -174,7 +182,7 @@ public:
     return _get_iterator();
   }
 
-  Iterator get_iterator(const string &prefix) {
+  virtual Iterator get_iterator(const string &prefix) {
     return ceph::shared_ptr<IteratorImpl>(
       new IteratorImpl(prefix, get_iterator())
     );
@@ -184,7 +192,7 @@ public:
     return _get_snapshot_iterator();
   }
 
-  Iterator get_snapshot_iterator(const string &prefix) {
+  virtual Iterator get_snapshot_iterator(const string &prefix) {
     return ceph::shared_ptr<IteratorImpl>(
       new IteratorImpl(prefix, get_snapshot_iterator())
     );
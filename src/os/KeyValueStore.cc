@@ -548,6 +548,7 @@ KeyValueStore::KeyValueStore(const std::string &base,
   m_keyvaluestore_queue_max_ops(g_conf->keyvaluestore_queue_max_ops),
   m_keyvaluestore_queue_max_bytes(g_conf->keyvaluestore_queue_max_bytes),
   m_keyvaluestore_strip_size(g_conf->keyvaluestore_default_strip_size),
+  m_keyvaluestore_max_strip_size(g_conf->keyvaluestore_max_strip_size),
   m_keyvaluestore_max_expected_write_size(g_conf->keyvaluestore_max_expected_write_size),
   do_update(do_update),
   m_keyvaluestore_do_dump(false),
@@ -1900,6 +1901,34 @@ int KeyValueStore::_generic_write(StripObjectMap::StripObjectHeaderRef header,
   if (len > bl.length())
     len = bl.length();
 
+  // A write replacing the whole object lets us pick a new strip size:
+  // large contiguous data then lands in a few big values instead of
+  // many strip_size'd ones, and any existing small strips are coalesced
+  // on the way.
+  if (offset == 0 && len >= header->max_size &&
+      m_keyvaluestore_max_strip_size > header->strip_size) {
+    uint64_t new_strip_size = MIN((uint64_t)len, m_keyvaluestore_max_strip_size);
+    if (new_strip_size > header->strip_size) {
+      set<string> old_keys;
+      for (uint64_t i = 0; i < header->bits.size(); ++i) {
+        if (header->bits[i])
+          old_keys.insert(strip_object_key(i));
+      }
+      if (!old_keys.empty()) {
+        int r = t.remove_buffer_keys(header, OBJECT_STRIP_PREFIX, old_keys);
+        if (r < 0)
+          return r;
+      }
+      dout(10) << __func__ << " " << header->cid << "/" << header->oid
+               << " re-strip " << header->strip_size << " -> "
+               << new_strip_size << dendl;
+      header->strip_size = new_strip_size;
+      header->max_size = 0;
+      header->bits.clear();
+      header->updated = true;
+    }
+  }
+
   if (len + offset > header->max_size) {
     header->max_size = len + offset;
     header->bits.resize(header->max_size/header->strip_size+1);
@@ -2878,9 +2907,11 @@ int KeyValueStore::_set_alloc_hint(coll_t cid, const ghobject_t& oid,
 
   // Now only consider to change "strip_size" when the object is blank,
   // because set_alloc_hint is expected to be very lightweight<O(1)>
-  if (blank) {
-    // header->strip_size = MIN(expected_write_size, m_keyvaluestore_max_expected_write_size);
-    // dout(20) << __func__ << " hint " << header->strip_size << " success" << dendl;
+  if (blank &&
+      MIN(expected_write_size, m_keyvaluestore_max_strip_size) > header->strip_size) {
+    header->strip_size = MIN(expected_write_size, m_keyvaluestore_max_strip_size);
+    header->updated = true;
+    dout(20) << __func__ << " hint " << header->strip_size << " success" << dendl;
   }
 
   dout(10) << __func__ << "" << cid << "/" << oid << " object_size "
@@ -685,6 +685,7 @@ class KeyValueStore : public ObjectStore,
   int m_keyvaluestore_queue_max_ops;
   int m_keyvaluestore_queue_max_bytes;
   int m_keyvaluestore_strip_size;
+  uint64_t m_keyvaluestore_max_strip_size;
   uint64_t m_keyvaluestore_max_expected_write_size;
   int do_update;
   bool m_keyvaluestore_do_dump;
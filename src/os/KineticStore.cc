@@ -316,6 +316,14 @@ pair<string,string> KineticStore::KineticWholeSpaceIteratorImpl::raw_key() {
   return make_pair(prefix, key);
 }
 
+bool KineticStore::KineticWholeSpaceIteratorImpl::raw_key_is_prefixed(
+    const string &prefix) {
+  // check the combined key in place instead of splitting it
+  return keys_iter->size() > prefix.length() &&
+    (*keys_iter)[prefix.length()] == '\1' &&
+    keys_iter->compare(0, prefix.length(), prefix) == 0;
+}
+
 bufferlist KineticStore::KineticWholeSpaceIteratorImpl::value() {
   dout(30) << "kinetic iterator value()" << dendl;
   unique_ptr<kinetic::KineticRecord> record;
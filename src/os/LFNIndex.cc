@@ -23,6 +23,12 @@
 #include <sys/param.h>
 #endif
 
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 #include "osd/osd_types.h"
 #include "include/object.h"
 #include "common/config.h"
@@ -390,6 +396,103 @@ static int get_hobject_from_oinfo(const char *dir, const char *file,
 }
 
 
+#if defined(__linux__)
+struct linux_dirent64 {
+  uint64_t	 d_ino;
+  int64_t	 d_off;
+  unsigned short d_reclen;
+  unsigned char	 d_type;
+  char		 d_name[];
+};
+
+int LFNIndex::list_objects(const vector<string> &to_list, int max_objs,
+			   long *handle, map<string, ghobject_t> *out)
+{
+  string to_list_path = get_full_path_subdir(to_list);
+  int fd = ::open(to_list_path.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd < 0)
+    return -errno;
+
+  int64_t last_off = 0;
+  if (handle && *handle) {
+    if (::lseek(fd, *handle, SEEK_SET) < 0) {
+      int r = -errno;
+      VOID_TEMP_FAILURE_RETRY(::close(fd));
+      return r;
+    }
+    last_off = *handle;
+  }
+
+  // pull the directory in large getdents batches; one syscall covers
+  // hundreds of entries, and skipped entries (subdirs, stray files)
+  // never leave the batch buffer
+  char buf[65536];
+  int r = 0;
+  int listed = 0;
+  bool end = false;
+  bool stop = false;
+  while (!stop) {
+    int nread = syscall(SYS_getdents64, fd, buf, sizeof(buf));
+    if (nread < 0) {
+      r = -errno;
+      goto cleanup;
+    }
+    if (nread == 0) {
+      end = true;
+      break;
+    }
+    for (int bpos = 0; bpos < nread; ) {
+      struct linux_dirent64 *de =
+	reinterpret_cast<struct linux_dirent64*>(buf + bpos);
+      if (max_objs > 0 && listed >= max_objs) {
+	// entry not consumed; a resumed listing picks it up via last_off
+	stop = true;
+	break;
+      }
+      bpos += de->d_reclen;
+      last_off = de->d_off;
+      if (de->d_name[0] == '.')
+	continue;
+      // allocation-free classification of the entry name
+      size_t name_len = strlen(de->d_name);
+      bool hashed = name_len >= (size_t)FILENAME_SHORT_LEN &&
+	memcmp(de->d_name + name_len - FILENAME_COOKIE.size(),
+	       FILENAME_COOKIE.c_str(), FILENAME_COOKIE.size()) == 0;
+      if (!hashed &&
+	  strncmp(de->d_name, SUBDIR_PREFIX.c_str(),
+		  SUBDIR_PREFIX.size()) == 0)
+	continue;  // subdir
+      string short_name(de->d_name, name_len);
+      ghobject_t obj;
+      r = lfn_translate(to_list, short_name, &obj);
+      if (r < 0)
+	goto cleanup;
+      if (r == 0)
+	continue;
+      if (m_verify_name) {
+	string long_name = lfn_generate_object_name(obj);
+	if (!lfn_must_hash(long_name)) {
+	  assert(long_name == short_name);
+	}
+      }
+      if (index_version == HASH_INDEX_TAG)
+	get_hobject_from_oinfo(to_list_path.c_str(), short_name.c_str(), &obj);
+
+      out->insert(pair<string, ghobject_t>(short_name, obj));
+      ++listed;
+    }
+  }
+
+  if (handle && !end) {
+    *handle = last_off;
+  }
+
+  r = 0;
+ cleanup:
+  VOID_TEMP_FAILURE_RETRY(::close(fd));
+  return r;
+}
+#else
 int LFNIndex::list_objects(const vector<string> &to_list, int max_objs,
 			   long *handle, map<string, ghobject_t> *out)
 {
@@ -426,13 +529,15 @@ int LFNIndex::list_objects(const vector<string> &to_list, int max_objs,
 	r = -errno;
 	goto cleanup;
       } else if (r > 0) {
-	string long_name = lfn_generate_object_name(obj);
-	if (!lfn_must_hash(long_name)) {
-	  assert(long_name == short_name);
+	if (m_verify_name) {
+	  string long_name = lfn_generate_object_name(obj);
+	  if (!lfn_must_hash(long_name)) {
+	    assert(long_name == short_name);
+	  }
 	}
 	if (index_version == HASH_INDEX_TAG)
 	  get_hobject_from_oinfo(to_list_path.c_str(), short_name.c_str(), &obj);
-	  
+
 	out->insert(pair<string, ghobject_t>(short_name, obj));
 	++listed;
       } else {
@@ -450,6 +555,7 @@ int LFNIndex::list_objects(const vector<string> &to_list, int max_objs,
   ::closedir(dir);
   return r;
 }
+#endif
 
 int LFNIndex::list_subdirs(const vector<string> &to_list,
 			   vector<string> *out)
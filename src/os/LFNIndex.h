@@ -25,6 +25,7 @@
 
 #include "osd/osd_types.h"
 #include "include/object.h"
+#include "common/config.h"
 #include "common/ceph_crypto.h"
 
 #include "CollectionIndex.h"
@@ -102,6 +103,10 @@ class LFNIndex : public CollectionIndex {
 protected:
   const uint32_t index_version;
 
+  /// verify parsed names round-trip while listing (see
+  /// filestore_index_verify_name)
+  bool m_verify_name;
+
   /// true if retry injection is enabled
   struct RetryException : public exception {};
   bool error_injection_enabled;
@@ -131,9 +136,10 @@ public:
     const char *base_path, ///< [in] path to Index root
     uint32_t index_version,
     double _error_injection_probability=0)
-    : CollectionIndex(collection), 
+    : CollectionIndex(collection),
       base_path(base_path),
       index_version(index_version),
+      m_verify_name(g_conf->filestore_index_verify_name),
       error_injection_enabled(false),
       error_injection_on(_error_injection_probability != 0),
       error_injection_probability(_error_injection_probability),
@@ -276,6 +276,15 @@ public:
       split_key(dbiter->key(), &prefix, &key);
       return make_pair(prefix, key);
     }
+    bool raw_key_is_prefixed(const string &prefix) {
+      // compare against the slice in place; no need to split the key
+      leveldb::Slice key = dbiter->key();
+      if ((key.size() > prefix.length()) && (key[prefix.length()] == '\0')) {
+	return memcmp(key.data(), prefix.c_str(), prefix.length()) == 0;
+      } else {
+	return false;
+      }
+    }
     bufferlist value() {
       return to_bufferlist(dbiter->value());
     }
@@ -26,13 +26,107 @@
 class MemStore : public ObjectStore {
 public:
   struct Object {
-    bufferlist data;
+    /* Object data lives in fixed-size pages, each held by a bufferlist
+     * sharing the underlying buffers on clone.  A partial overwrite
+     * rebuilds only the pages it touches (copy-on-write); untouched
+     * pages stay shared with any clones.  Absent pages read as zero.
+     * Every present page is exactly page_size long, zero padded. */
+    static const uint64_t page_size = 64 * 1024;
+    uint64_t data_len;
+    map<uint64_t, bufferlist> data;  ///< page-aligned offset -> one page
     map<string,bufferptr> xattr;
     bufferlist omap_header;
     map<string,bufferlist> omap;
 
+    Object() : data_len(0) {}
+
+    uint64_t get_size() const { return data_len; }
+
+    /// read [offset, offset+len), which the caller has clipped to the
+    /// object size; holes read as zero
+    void read_data(uint64_t offset, uint64_t len, bufferlist *bl) const {
+      uint64_t end = offset + len;
+      while (offset < end) {
+	uint64_t page_off = offset & ~(page_size - 1);
+	uint64_t inner = offset - page_off;
+	uint64_t l = MIN(end - offset, page_size - inner);
+	map<uint64_t, bufferlist>::const_iterator p = data.find(page_off);
+	if (p == data.end()) {
+	  bl->append_zero(l);
+	} else {
+	  bufferlist t;
+	  t.substr_of(p->second, inner, l);
+	  bl->claim_append(t);
+	}
+	offset += l;
+      }
+    }
+
+    void write_data(uint64_t offset, const bufferlist &src) {
+      uint64_t end = offset + src.length();
+      uint64_t src_off = 0;
+      while (offset < end) {
+	uint64_t page_off = offset & ~(page_size - 1);
+	uint64_t inner = offset - page_off;
+	uint64_t l = MIN(end - offset, page_size - inner);
+	if (inner == 0 && l == page_size) {
+	  // full page; just reference the source buffers
+	  bufferlist &pbl = data[page_off];
+	  pbl.clear();
+	  pbl.substr_of(src, src_off, page_size);
+	} else {
+	  // partial page; rebuild it so clones sharing the old page
+	  // are unaffected
+	  bufferptr np(page_size);
+	  map<uint64_t, bufferlist>::iterator p = data.find(page_off);
+	  if (p != data.end())
+	    p->second.copy(0, page_size, np.c_str());
+	  else
+	    np.zero();
+	  src.copy(src_off, l, np.c_str() + inner);
+	  bufferlist nbl;
+	  nbl.push_back(np);
+	  data[page_off].swap(nbl);
+	}
+	offset += l;
+	src_off += l;
+      }
+      if (end > data_len)
+	data_len = end;
+    }
+
+    void truncate_data(uint64_t size) {
+      if (size < data_len) {
+	// drop pages entirely past the new size and zero the tail of
+	// the one straddling it; stale bytes must not reappear if the
+	// object grows again
+	uint64_t first_gone = (size + page_size - 1) & ~(page_size - 1);
+	data.erase(data.lower_bound(first_gone), data.end());
+	uint64_t inner = size & (page_size - 1);
+	if (inner) {
+	  map<uint64_t, bufferlist>::iterator p = data.find(size - inner);
+	  if (p != data.end()) {
+	    bufferptr np(page_size);
+	    p->second.copy(0, inner, np.c_str());
+	    memset(np.c_str() + inner, 0, page_size - inner);
+	    bufferlist nbl;
+	    nbl.push_back(np);
+	    p->second.swap(nbl);
+	  }
+	}
+      }
+      data_len = size;  // growing just declares zeros
+    }
+
+    /// share all pages with another object
+    void clone_data(const Object &o) {
+      data = o.data;
+      data_len = o.data_len;
+    }
+
     void encode(bufferlist& bl) const {
-      ENCODE_START(1, 1, bl);
+      ENCODE_START(2, 2, bl);
+      ::encode(data_len, bl);
       ::encode(data, bl);
       ::encode(xattr, bl);
       ::encode(omap_header, bl);
@@ -40,15 +134,25 @@ public:
       ENCODE_FINISH(bl);
     }
     void decode(bufferlist::iterator& p) {
-      DECODE_START(1, p);
-      ::decode(data, p);
+      DECODE_START(2, p);
+      if (struct_v >= 2) {
+	::decode(data_len, p);
+	::decode(data, p);
+      } else {
+	bufferlist flat;
+	::decode(flat, p);
+	data.clear();
+	data_len = 0;
+	if (flat.length())
+	  write_data(0, flat);
+      }
       ::decode(xattr, p);
       ::decode(omap_header, p);
       ::decode(omap, p);
       DECODE_FINISH(p);
     }
     void dump(Formatter *f) const {
-      f->dump_int("data_len", data.length());
+      f->dump_int("data_len", data_len);
       f->dump_int("omap_header_len", omap_header.length());
 
       f->open_array_section("xattrs");
@@ -128,7 +232,7 @@ public:
       for (map<ghobject_t, ObjectRef,ghobject_t::BitwiseComparator>::const_iterator p = object_map.begin();
 	   p != object_map.end();
 	   ++p) {
-        result += p->second->data.length();
+        result += p->second->get_size();
       }
 
       return result;
@@ -197,8 +301,6 @@ private:
 
   void _do_transaction(Transaction& t);
 
-  void _write_into_bl(const bufferlist& src, unsigned offset, bufferlist *dst);
-
   int _touch(coll_t cid, const ghobject_t& oid);
   int _write(coll_t cid, const ghobject_t& oid, uint64_t offset, size_t len,
 	      const bufferlist& bl, uint32_t fadvsie_flags = 0);
@@ -57,6 +57,7 @@ enum {
   l_os_j_wr,
   l_os_j_wr_bytes,
   l_os_j_full,
+  l_os_coalesced_ops,
   l_os_committing,
   l_os_commit,
   l_os_commit_len,
@@ -281,6 +282,14 @@ public:
    * committed to stable storage (i.e., are now software/hardware
    * crashproof).
    *
+   * "on_commit_sync" is to on_commit what on_applied_sync is to
+   * on_applied: it is invoked directly from the thread that learned of
+   * the commit (for FileStore, the journal completion path) rather
+   * than being requeued to the ondisk Finisher, saving a thread hop
+   * for latency-sensitive callers.  Like on_applied_sync it must
+   * execute quickly; anything it blocks on delays later commit
+   * notifications.
+   *
    * At the implementation level, each mutation primitive (and its
    * associated data) can be serialized to a single buffer.  That
    * serialization, however, does not copy any data, but (using the
@@ -447,6 +456,7 @@ public:
     list<Context *> on_applied;
     list<Context *> on_commit;
     list<Context *> on_applied_sync;
+    list<Context *> on_commit_sync;
 
   public:
 
@@ -463,6 +473,10 @@ public:
       if (!c) return;
       on_applied_sync.push_back(c);
     }
+    void register_on_commit_sync(Context *c) {
+      if (!c) return;
+      on_commit_sync.push_back(c);
+    }
     void register_on_complete(Context *c) {
       if (!c) return;
       RunOnDeleteRef _complete(new RunOnDelete(c));
@@ -474,21 +488,28 @@ public:
       list<Transaction *> &t,
       Context **out_on_applied,
       Context **out_on_commit,
-      Context **out_on_applied_sync) {
+      Context **out_on_applied_sync,
+      Context **out_on_commit_sync = NULL) {
       assert(out_on_applied);
       assert(out_on_commit);
       assert(out_on_applied_sync);
-      list<Context *> on_applied, on_commit, on_applied_sync;
+      list<Context *> on_applied, on_commit, on_applied_sync, on_commit_sync;
       for (list<Transaction *>::iterator i = t.begin();
 	   i != t.end();
 	   ++i) {
 	on_applied.splice(on_applied.end(), (*i)->on_applied);
 	on_commit.splice(on_commit.end(), (*i)->on_commit);
 	on_applied_sync.splice(on_applied_sync.end(), (*i)->on_applied_sync);
+	if (out_on_commit_sync)
+	  on_commit_sync.splice(on_commit_sync.end(), (*i)->on_commit_sync);
+	else // backend without a sync commit path; deliver via on_commit
+	  on_commit.splice(on_commit.end(), (*i)->on_commit_sync);
       }
       *out_on_applied = C_Contexts::list_to_context(on_applied);
       *out_on_commit = C_Contexts::list_to_context(on_commit);
       *out_on_applied_sync = C_Contexts::list_to_context(on_applied_sync);
+      if (out_on_commit_sync)
+	*out_on_commit_sync = C_Contexts::list_to_context(on_commit_sync);
     }
 
     Context *get_on_applied() {
@@ -500,6 +521,9 @@ public:
     Context *get_on_applied_sync() {
       return C_Contexts::list_to_context(on_applied_sync);
     }
+    Context *get_on_commit_sync() {
+      return C_Contexts::list_to_context(on_commit_sync);
+    }
 
     void set_fadvise_flags(uint32_t flags) {
       data.fadvise_flags = flags;
@@ -521,6 +545,7 @@ public:
       std::swap(on_applied, other.on_applied);
       std::swap(on_commit, other.on_commit);
       std::swap(on_applied_sync, other.on_applied_sync);
+      std::swap(on_commit_sync, other.on_commit_sync);
 
       std::swap(use_tbl, other.use_tbl);
       tbl.swap(other.tbl);
@@ -649,6 +674,7 @@ public:
       on_applied.splice(on_applied.end(), other.on_applied);
       on_commit.splice(on_commit.end(), other.on_commit);
       on_applied_sync.splice(on_applied_sync.end(), other.on_applied_sync);
+      on_commit_sync.splice(on_commit_sync.end(), other.on_commit_sync);
 
       //append coll_index & object_index
       vector<__le32> cm(other.coll_index.size());
@@ -811,6 +837,11 @@ public:
       bool have_op() {
         return ops > 0;
       }
+      /// examine the next op without consuming it
+      Op* peek_op() {
+        assert(ops > 0);
+        return reinterpret_cast<Op*>(op_buffer_p);
+      }
       Op* decode_op() {
         assert(ops > 0);
 
@@ -858,6 +889,18 @@ public:
       return iterator(this);
     }
 
+    /// list the collections this transaction touches; returns false if
+    /// they cannot be determined without replay (legacy tbl encoding)
+    bool get_collections(set<coll_t> *colls) const {
+      if (use_tbl)
+	return false;
+      for (map<coll_t, __le32>::const_iterator p = coll_index.begin();
+	   p != coll_index.end();
+	   ++p)
+	colls->insert(p->first);
+      return true;
+    }
+
 private:
     void _build_actions_from_tbl();
 
@@ -1873,6 +1916,58 @@ public:
     uint32_t op_flags = 0,
     bool allow_eio = false) = 0;
 
+  /**
+   * read_async -- read the contents of an object without blocking the caller
+   *
+   * onfinish is completed with the read() result once pbl has been
+   * filled in.  The default implementation simply reads synchronously
+   * and completes onfinish inline, so it is asynchronous in interface
+   * only; backends with a better option (a reader thread pool, real
+   * aio) should override it.  The completion may run on an arbitrary
+   * backend thread, so onfinish must take whatever locks it needs.
+   *
+   * @param cid collection for object
+   * @param oid oid of object
+   * @param offset location offset of first byte to be read
+   * @param len number of bytes to be read
+   * @param op_flags is CEPH_OSD_OP_FLAG_*
+   * @param pbl output bufferlist, which must live until completion
+   * @param onfinish completion context
+   */
+  virtual void read_async(
+    coll_t cid,
+    const ghobject_t& oid,
+    uint64_t offset,
+    size_t len,
+    uint32_t op_flags,
+    bufferlist *pbl,
+    Context *onfinish) {
+    int r = read(cid, oid, offset, len, *pbl, op_flags);
+    onfinish->complete(r);
+  }
+
+  /**
+   * readahead -- hint that a byte range will be read soon
+   *
+   * Ask the backend to start prefetching the given range so that a
+   * subsequent read() finds it in cache.  This is purely advisory and
+   * must not block on the actual I/O; implementations for which the
+   * hint makes no sense may ignore it.
+   *
+   * @param cid collection for object
+   * @param oid oid of object
+   * @param offset location offset of first byte to be prefetched
+   * @param len number of bytes to be prefetched
+   * @returns 0 on success, negative error code on failure.
+   */
+  virtual int readahead(
+    coll_t cid,
+    const ghobject_t& oid,
+    uint64_t offset,
+    size_t len) {
+    return 0;
+  }
+
   /**
    * fiemap -- get extent map of data of an object
    *
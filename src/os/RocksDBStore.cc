@@ -106,21 +106,121 @@ int RocksDBStore::init(string _options_str)
   return 0;
 }
 
+// parse rocksdb_partitions: semicolon-separated entries of the form
+// PREFIX or PREFIX:opt1=val1,opt2=val2
+static int parse_rocksdb_partitions(CephContext *cct,
+				    map<string,string> *partitions)
+{
+  const string &s = cct->_conf->rocksdb_partitions;
+  size_t pos = 0;
+  while (pos < s.size()) {
+    size_t end = s.find(';', pos);
+    if (end == string::npos)
+      end = s.size();
+    string entry = s.substr(pos, end - pos);
+    pos = end + 1;
+    if (entry.empty())
+      continue;
+    size_t colon = entry.find(':');
+    string name = entry.substr(0, colon);
+    string opts = colon == string::npos ? string() : entry.substr(colon + 1);
+    if (name.empty() || name == rocksdb::kDefaultColumnFamilyName) {
+      lderr(cct) << "invalid rocksdb partition name '" << name << "'" << dendl;
+      return -EINVAL;
+    }
+    (*partitions)[name] = opts;
+  }
+  return 0;
+}
+
 int RocksDBStore::do_open(ostream &out, bool create_if_missing)
 {
   rocksdb::Options opt;
   rocksdb::Status status;
 
-  int r = ParseOptionsFromString(options_str, opt); 
+  int r = ParseOptionsFromString(options_str, opt);
   if (r != 0) {
     return -EINVAL;
   }
   opt.create_if_missing = create_if_missing;
 
-  status = rocksdb::DB::Open(opt, path, &db);
-  if (!status.ok()) {
-    derr << status.ToString() << dendl;
-    return -EINVAL;
+  map<string,string> partitions;
+  r = parse_rocksdb_partitions(cct, &partitions);
+  if (r < 0)
+    return r;
+
+  std::vector<std::string> existing_cfs;
+  status = rocksdb::DB::ListColumnFamilies(rocksdb::DBOptions(opt), path,
+					   &existing_cfs);
+  bool db_exists = status.ok();
+
+  if (db_exists && existing_cfs.size() > 1) {
+    // the partition layout is fixed when the store is created; open with
+    // the column families that are actually present, applying any
+    // configured per-partition options to the ones that match
+    std::vector<rocksdb::ColumnFamilyDescriptor> descriptors;
+    for (std::vector<std::string>::iterator p = existing_cfs.begin();
+	 p != existing_cfs.end();
+	 ++p) {
+      rocksdb::ColumnFamilyOptions cf_opt(opt);
+      map<string,string>::iterator q = partitions.find(*p);
+      if (q != partitions.end() && !q->second.empty()) {
+	status = rocksdb::GetColumnFamilyOptionsFromString(cf_opt, q->second,
+							   &cf_opt);
+	if (!status.ok()) {
+	  derr << __func__ << " invalid options for partition '" << *p
+	       << "': " << status.ToString() << dendl;
+	  return -EINVAL;
+	}
+      }
+      descriptors.push_back(rocksdb::ColumnFamilyDescriptor(*p, cf_opt));
+    }
+    std::vector<rocksdb::ColumnFamilyHandle*> handles;
+    status = rocksdb::DB::Open(rocksdb::DBOptions(opt), path, descriptors,
+			       &handles, &db);
+    if (!status.ok()) {
+      derr << status.ToString() << dendl;
+      return -EINVAL;
+    }
+    for (unsigned i = 0; i < handles.size(); ++i) {
+      if (existing_cfs[i] == rocksdb::kDefaultColumnFamilyName)
+	default_cf = handles[i];
+      else
+	cf_handles.push_back(make_pair(existing_cfs[i], handles[i]));
+    }
+  } else {
+    status = rocksdb::DB::Open(opt, path, &db);
+    if (!status.ok()) {
+      derr << status.ToString() << dendl;
+      return -EINVAL;
+    }
+    if (!db_exists && !partitions.empty()) {
+      // brand new store: carve out the configured partitions
+      for (map<string,string>::iterator p = partitions.begin();
+	   p != partitions.end();
+	   ++p) {
+	rocksdb::ColumnFamilyOptions cf_opt(opt);
+	if (!p->second.empty()) {
+	  status = rocksdb::GetColumnFamilyOptionsFromString(cf_opt, p->second,
+							     &cf_opt);
+	  if (!status.ok()) {
+	    derr << __func__ << " invalid options for partition '" << p->first
+		 << "': " << status.ToString() << dendl;
+	    return -EINVAL;
+	  }
+	}
+	rocksdb::ColumnFamilyHandle *cf;
+	status = db->CreateColumnFamily(cf_opt, p->first, &cf);
+	if (!status.ok()) {
+	  derr << __func__ << " failed to create partition '" << p->first
+	       << "': " << status.ToString() << dendl;
+	  return -EINVAL;
+	}
+	cf_handles.push_back(make_pair(p->first, cf));
+	lgeneric_dout(cct, 0) << " created rocksdb partition " << p->first
+			      << dendl;
+      }
+    }
   }
 
   PerfCountersBuilder plb(g_ceph_context, "rocksdb", l_rocksdb_first, l_rocksdb_last);
@@ -160,9 +260,35 @@ RocksDBStore::~RocksDBStore()
   delete logger;
 
   // Ensure db is destroyed before dependent db_cache and filterpolicy
+  for (std::vector<std::pair<string, rocksdb::ColumnFamilyHandle*> >::iterator p =
+	 cf_handles.begin();
+       p != cf_handles.end();
+       ++p)
+    delete p->second;
+  cf_handles.clear();
+  delete default_cf;
   delete db;
 }
 
+rocksdb::ColumnFamilyHandle *RocksDBStore::get_cf_handle(const string &prefix)
+{
+  // longest matching partition wins, so that e.g. a partition named
+  // "_USER_" captures all of DBObjectMap's per-header user prefixes
+  rocksdb::ColumnFamilyHandle *cf = NULL;
+  size_t best = 0;
+  for (std::vector<std::pair<string, rocksdb::ColumnFamilyHandle*> >::iterator p =
+	 cf_handles.begin();
+       p != cf_handles.end();
+       ++p) {
+    if (p->first.length() >= best &&
+	prefix.compare(0, p->first.length(), p->first) == 0) {
+      cf = p->second;
+      best = p->first.length();
+    }
+  }
+  return cf;
+}
+
 void RocksDBStore::close()
 {
   // stop compaction thread
@@ -242,26 +368,41 @@ void RocksDBStore::RocksDBTransactionImpl::set(
   string key = combine_strings(prefix, k);
   //bufferlist::c_str() is non-constant, so we need to make a copy
   bufferlist val = to_set_bl;
-  bat->Delete(rocksdb::Slice(key));
-  bat->Put(rocksdb::Slice(key),
-	  rocksdb::Slice(val.c_str(), val.length()));
+  rocksdb::ColumnFamilyHandle *cf = db->get_cf_handle(prefix);
+  if (cf) {
+    bat->Delete(cf, rocksdb::Slice(key));
+    bat->Put(cf, rocksdb::Slice(key),
+	     rocksdb::Slice(val.c_str(), val.length()));
+  } else {
+    bat->Delete(rocksdb::Slice(key));
+    bat->Put(rocksdb::Slice(key),
+	     rocksdb::Slice(val.c_str(), val.length()));
+  }
 }
 
 void RocksDBStore::RocksDBTransactionImpl::rmkey(const string &prefix,
 					         const string &k)
 {
   string key = combine_strings(prefix, k);
-  bat->Delete(rocksdb::Slice(k));
+  rocksdb::ColumnFamilyHandle *cf = db->get_cf_handle(prefix);
+  if (cf)
+    bat->Delete(cf, rocksdb::Slice(key));
+  else
+    bat->Delete(rocksdb::Slice(k));
 }
 
 void RocksDBStore::RocksDBTransactionImpl::rmkeys_by_prefix(const string &prefix)
 {
+  rocksdb::ColumnFamilyHandle *cf = db->get_cf_handle(prefix);
   KeyValueDB::Iterator it = db->get_iterator(prefix);
   for (it->seek_to_first();
        it->valid();
        it->next()) {
     string key = combine_strings(prefix, it->key());
-    bat->Delete(key);
+    if (cf)
+      bat->Delete(cf, rocksdb::Slice(key));
+    else
+      bat->Delete(key);
   }
 }
 
@@ -320,6 +461,11 @@ void RocksDBStore::compact()
 {
   logger->inc(l_rocksdb_compact);
   db->CompactRange(NULL, NULL);
+  for (std::vector<std::pair<string, rocksdb::ColumnFamilyHandle*> >::iterator p =
+	 cf_handles.begin();
+       p != cf_handles.end();
+       ++p)
+    db->CompactRange(p->second, NULL, NULL);
 }
 
 
@@ -395,6 +541,15 @@ void RocksDBStore::compact_range(const string& start, const string& end)
     rocksdb::Slice cstart(start);
     rocksdb::Slice cend(end);
     db->CompactRange(&cstart, &cend);
+    for (std::vector<std::pair<string, rocksdb::ColumnFamilyHandle*> >::iterator p =
+	   cf_handles.begin();
+	 p != cf_handles.end();
+	 ++p) {
+      // only partitions whose combined-key range intersects [start, end)
+      if (combine_strings(p->first, string()) < end &&
+	  past_prefix(p->first) > start)
+	db->CompactRange(p->second, &cstart, &cend);
+    }
 }
 RocksDBStore::RocksDBWholeSpaceIteratorImpl::~RocksDBWholeSpaceIteratorImpl()
 {
@@ -474,6 +629,16 @@ pair<string,string> RocksDBStore::RocksDBWholeSpaceIteratorImpl::raw_key()
   split_key(dbiter->key(), &prefix, &key);
   return make_pair(prefix, key);
 }
+bool RocksDBStore::RocksDBWholeSpaceIteratorImpl::raw_key_is_prefixed(const string &prefix)
+{
+  // compare against the slice in place; no need to split the key
+  rocksdb::Slice key = dbiter->key();
+  if ((key.size() > prefix.length()) && (key[prefix.length()] == '\0')) {
+    return memcmp(key.data(), prefix.c_str(), prefix.length()) == 0;
+  } else {
+    return false;
+  }
+}
 bufferlist RocksDBStore::RocksDBWholeSpaceIteratorImpl::value()
 {
   return to_bufferlist(dbiter->value());
@@ -490,14 +655,219 @@ string RocksDBStore::past_prefix(const string &prefix)
   return limit;
 }
 
+int RocksDBStore::MergedWholeSpaceIteratorImpl::pick_smallest()
+{
+  cur = -1;
+  pair<string,string> best;
+  for (unsigned i = 0; i < iters.size(); ++i) {
+    if (!iters[i]->valid())
+      continue;
+    pair<string,string> k = iters[i]->raw_key();
+    if (cur < 0 || k < best) {
+      cur = i;
+      best = k;
+    }
+  }
+  forward = true;
+  return status();
+}
+
+int RocksDBStore::MergedWholeSpaceIteratorImpl::pick_largest()
+{
+  cur = -1;
+  pair<string,string> best;
+  for (unsigned i = 0; i < iters.size(); ++i) {
+    if (!iters[i]->valid())
+      continue;
+    pair<string,string> k = iters[i]->raw_key();
+    if (cur < 0 || k > best) {
+      cur = i;
+      best = k;
+    }
+  }
+  forward = false;
+  return status();
+}
+
+int RocksDBStore::MergedWholeSpaceIteratorImpl::seek_to_first()
+{
+  for (unsigned i = 0; i < iters.size(); ++i)
+    iters[i]->seek_to_first();
+  return pick_smallest();
+}
+
+int RocksDBStore::MergedWholeSpaceIteratorImpl::seek_to_first(const string &prefix)
+{
+  for (unsigned i = 0; i < iters.size(); ++i)
+    iters[i]->seek_to_first(prefix);
+  return pick_smallest();
+}
+
+int RocksDBStore::MergedWholeSpaceIteratorImpl::seek_to_last()
+{
+  for (unsigned i = 0; i < iters.size(); ++i)
+    iters[i]->seek_to_last();
+  return pick_largest();
+}
+
+int RocksDBStore::MergedWholeSpaceIteratorImpl::seek_to_last(const string &prefix)
+{
+  for (unsigned i = 0; i < iters.size(); ++i)
+    iters[i]->seek_to_last(prefix);
+  return pick_largest();
+}
+
+int RocksDBStore::MergedWholeSpaceIteratorImpl::upper_bound(const string &prefix,
+							    const string &after)
+{
+  for (unsigned i = 0; i < iters.size(); ++i)
+    iters[i]->upper_bound(prefix, after);
+  return pick_smallest();
+}
+
+int RocksDBStore::MergedWholeSpaceIteratorImpl::lower_bound(const string &prefix,
+							    const string &to)
+{
+  for (unsigned i = 0; i < iters.size(); ++i)
+    iters[i]->lower_bound(prefix, to);
+  return pick_smallest();
+}
+
+bool RocksDBStore::MergedWholeSpaceIteratorImpl::valid()
+{
+  return cur >= 0 && iters[cur]->valid();
+}
+
+int RocksDBStore::MergedWholeSpaceIteratorImpl::next()
+{
+  if (!valid())
+    return status();
+  if (!forward) {
+    // direction change: reposition every child past the current entry
+    pair<string,string> k = iters[cur]->raw_key();
+    for (unsigned i = 0; i < iters.size(); ++i)
+      iters[i]->upper_bound(k.first, k.second);
+  } else {
+    // the other children already sit on their first entry past the
+    // current one
+    iters[cur]->next();
+  }
+  return pick_smallest();
+}
+
+int RocksDBStore::MergedWholeSpaceIteratorImpl::prev()
+{
+  if (!valid())
+    return status();
+  if (forward) {
+    // direction change: reposition every child before the current entry
+    pair<string,string> k = iters[cur]->raw_key();
+    for (unsigned i = 0; i < iters.size(); ++i) {
+      iters[i]->lower_bound(k.first, k.second);
+      if (iters[i]->valid())
+	iters[i]->prev();
+      else
+	iters[i]->seek_to_last();
+    }
+  } else {
+    iters[cur]->prev();
+  }
+  return pick_largest();
+}
+
+string RocksDBStore::MergedWholeSpaceIteratorImpl::key()
+{
+  assert(cur >= 0);
+  return iters[cur]->key();
+}
+
+pair<string,string> RocksDBStore::MergedWholeSpaceIteratorImpl::raw_key()
+{
+  assert(cur >= 0);
+  return iters[cur]->raw_key();
+}
+
+bool RocksDBStore::MergedWholeSpaceIteratorImpl::raw_key_is_prefixed(const string &prefix)
+{
+  assert(cur >= 0);
+  return iters[cur]->raw_key_is_prefixed(prefix);
+}
+
+bufferlist RocksDBStore::MergedWholeSpaceIteratorImpl::value()
+{
+  assert(cur >= 0);
+  return iters[cur]->value();
+}
+
+int RocksDBStore::MergedWholeSpaceIteratorImpl::status()
+{
+  for (unsigned i = 0; i < iters.size(); ++i) {
+    if (iters[i]->status() < 0)
+      return -1;
+  }
+  return 0;
+}
+
+RocksDBStore::MergedSnapshotIteratorImpl::~MergedSnapshotIteratorImpl()
+{
+  iters.clear();
+  db->ReleaseSnapshot(snapshot);
+}
+
+KeyValueDB::Iterator RocksDBStore::get_iterator(const string &prefix)
+{
+  rocksdb::ColumnFamilyHandle *cf = get_cf_handle(prefix);
+  if (!cf)
+    return KeyValueDB::get_iterator(prefix);
+  return std::make_shared<IteratorImpl>(
+    prefix,
+    std::shared_ptr<KeyValueDB::WholeSpaceIteratorImpl>(
+      new RocksDBWholeSpaceIteratorImpl(
+	db->NewIterator(rocksdb::ReadOptions(), cf))));
+}
+
+KeyValueDB::Iterator RocksDBStore::get_snapshot_iterator(const string &prefix)
+{
+  rocksdb::ColumnFamilyHandle *cf = get_cf_handle(prefix);
+  if (!cf)
+    return KeyValueDB::get_snapshot_iterator(prefix);
+
+  const rocksdb::Snapshot *snapshot = db->GetSnapshot();
+  rocksdb::ReadOptions options;
+  options.snapshot = snapshot;
+
+  return std::make_shared<IteratorImpl>(
+    prefix,
+    std::shared_ptr<KeyValueDB::WholeSpaceIteratorImpl>(
+      new RocksDBSnapshotIteratorImpl(db, snapshot,
+	db->NewIterator(options, cf))));
+}
 
 RocksDBStore::WholeSpaceIterator RocksDBStore::_get_iterator()
 {
+  if (cf_handles.empty()) {
+    return std::shared_ptr<KeyValueDB::WholeSpaceIteratorImpl>(
+      new RocksDBWholeSpaceIteratorImpl(
+	db->NewIterator(rocksdb::ReadOptions())
+      )
+    );
+  }
+  vector<KeyValueDB::WholeSpaceIterator> iters;
+  iters.push_back(
+    std::shared_ptr<KeyValueDB::WholeSpaceIteratorImpl>(
+      new RocksDBWholeSpaceIteratorImpl(
+	db->NewIterator(rocksdb::ReadOptions()))));
+  for (std::vector<std::pair<string, rocksdb::ColumnFamilyHandle*> >::iterator p =
+	 cf_handles.begin();
+       p != cf_handles.end();
+       ++p) {
+    iters.push_back(
+      std::shared_ptr<KeyValueDB::WholeSpaceIteratorImpl>(
+	new RocksDBWholeSpaceIteratorImpl(
+	  db->NewIterator(rocksdb::ReadOptions(), p->second))));
+  }
   return std::shared_ptr<KeyValueDB::WholeSpaceIteratorImpl>(
-    new RocksDBWholeSpaceIteratorImpl(
-      db->NewIterator(rocksdb::ReadOptions())
-    )
-  );
+    new MergedWholeSpaceIteratorImpl(iters));
 }
 
 RocksDBStore::WholeSpaceIterator RocksDBStore::_get_snapshot_iterator()
@@ -508,10 +878,28 @@ RocksDBStore::WholeSpaceIterator RocksDBStore::_get_snapshot_iterator()
   snapshot = db->GetSnapshot();
   options.snapshot = snapshot;
 
+  if (cf_handles.empty()) {
+    return std::shared_ptr<KeyValueDB::WholeSpaceIteratorImpl>(
+      new RocksDBSnapshotIteratorImpl(db, snapshot,
+	db->NewIterator(options))
+    );
+  }
+  vector<KeyValueDB::WholeSpaceIterator> iters;
+  iters.push_back(
+    std::shared_ptr<KeyValueDB::WholeSpaceIteratorImpl>(
+      new RocksDBWholeSpaceIteratorImpl(
+	db->NewIterator(options))));
+  for (std::vector<std::pair<string, rocksdb::ColumnFamilyHandle*> >::iterator p =
+	 cf_handles.begin();
+       p != cf_handles.end();
+       ++p) {
+    iters.push_back(
+      std::shared_ptr<KeyValueDB::WholeSpaceIteratorImpl>(
+	new RocksDBWholeSpaceIteratorImpl(
+	  db->NewIterator(options, p->second))));
+  }
   return std::shared_ptr<KeyValueDB::WholeSpaceIteratorImpl>(
-    new RocksDBSnapshotIteratorImpl(db, snapshot,
-      db->NewIterator(options))
-  );
+    new MergedSnapshotIteratorImpl(db, snapshot, iters));
 }
 
 RocksDBStore::RocksDBSnapshotIteratorImpl::~RocksDBSnapshotIteratorImpl()
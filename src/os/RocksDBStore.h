@@ -10,6 +10,7 @@
 #include <map>
 #include <string>
 #include <memory>
+#include <vector>
 #include <boost/scoped_ptr.hpp>
 
 #include <errno.h>
@@ -38,6 +39,7 @@ enum {
 namespace rocksdb{
   class DB;
   class Cache;
+  class ColumnFamilyHandle;
   class FilterPolicy;
   class Snapshot;
   class Slice;
@@ -54,6 +56,10 @@ class RocksDBStore : public KeyValueDB {
   string path;
   rocksdb::DB *db;
   string options_str;
+  // prefix-partitioned column families; the layout is fixed when the
+  // store is created (see rocksdb_partitions)
+  std::vector<std::pair<string, rocksdb::ColumnFamilyHandle*> > cf_handles;
+  rocksdb::ColumnFamilyHandle *default_cf;
   int do_open(ostream &out, bool create_if_missing);
 
   // manage async compactions
@@ -103,11 +109,15 @@ public:
   }
   int get_info_log_level(string info_log_level);
 
+  /// column family serving a given key prefix, or NULL for the default
+  rocksdb::ColumnFamilyHandle *get_cf_handle(const string &prefix);
+
   RocksDBStore(CephContext *c, const string &path) :
     cct(c),
     logger(NULL),
     path(path),
     db(NULL),
+    default_cf(NULL),
     compact_queue_lock("RocksDBStore::compact_thread_lock"),
     compact_queue_stop(false),
     compact_thread(this),
@@ -182,6 +192,7 @@ public:
     int prev();
     string key();
     pair<string,string> raw_key();
+    bool raw_key_is_prefixed(const string &prefix);
     bufferlist value();
     int status();
   };
@@ -197,6 +208,54 @@ public:
     ~RocksDBSnapshotIteratorImpl();
   };
 
+  // merges the iterators of the default column family and the
+  // partitions into a single whole-space view; since each key lives in
+  // exactly one family, a k-way merge on the raw (prefix, key) pairs
+  // reproduces the combined-key order of an unpartitioned store
+  class MergedWholeSpaceIteratorImpl :
+    public KeyValueDB::WholeSpaceIteratorImpl {
+  protected:
+    vector<KeyValueDB::WholeSpaceIterator> iters;
+    int cur;       ///< index of the iterator holding the current entry
+    bool forward;  ///< direction of the last positioning operation
+    int pick_smallest();
+    int pick_largest();
+  public:
+    MergedWholeSpaceIteratorImpl(const vector<KeyValueDB::WholeSpaceIterator> &i) :
+      iters(i), cur(-1), forward(true) { }
+
+    int seek_to_first();
+    int seek_to_first(const string &prefix);
+    int seek_to_last();
+    int seek_to_last(const string &prefix);
+    int upper_bound(const string &prefix, const string &after);
+    int lower_bound(const string &prefix, const string &to);
+    bool valid();
+    int next();
+    int prev();
+    string key();
+    pair<string,string> raw_key();
+    bool raw_key_is_prefixed(const string &prefix);
+    bufferlist value();
+    int status();
+  };
+
+  class MergedSnapshotIteratorImpl : public MergedWholeSpaceIteratorImpl {
+    rocksdb::DB *db;
+    const rocksdb::Snapshot *snapshot;
+  public:
+    MergedSnapshotIteratorImpl(rocksdb::DB *db, const rocksdb::Snapshot *s,
+			       const vector<KeyValueDB::WholeSpaceIterator> &i) :
+      MergedWholeSpaceIteratorImpl(i), db(db), snapshot(s) { }
+
+    ~MergedSnapshotIteratorImpl();
+  };
+
+  using KeyValueDB::get_iterator;
+  using KeyValueDB::get_snapshot_iterator;
+  Iterator get_iterator(const string &prefix);
+  Iterator get_snapshot_iterator(const string &prefix);
+
   /// Utility
   static string combine_strings(const string &prefix, const string &value);
   static int split_key(rocksdb::Slice in, string *prefix, string *key);
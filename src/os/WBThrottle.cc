@@ -7,6 +7,11 @@
 #include "common/perf_counters.h"
 
 WBThrottle::WBThrottle(CephContext *cct) :
+  adaptive(false),
+  adaptive_target_lat(0),
+  adaptive_min_ratio(0),
+  limit_ratio(1.0),
+  paced_flush_interval(0),
   cur_ios(0), cur_size(0),
   cct(cct),
   logger(NULL),
@@ -28,10 +33,13 @@ WBThrottle::WBThrottle(CephContext *cct) :
   b.add_u64(l_wbthrottle_ios_wb, "ios_wb", "Written operations");
   b.add_u64(l_wbthrottle_inodes_dirtied, "inodes_dirtied", "Entries waiting for write");
   b.add_u64(l_wbthrottle_inodes_wb, "inodes_wb", "Written entries");
+  b.add_time_avg(l_wbthrottle_flush_lat, "flush_lat", "Flush latency");
+  b.add_u64(l_wbthrottle_limit_ratio, "limit_ratio", "Percent of configured limits currently applied");
   logger = b.create_perf_counters();
   cct->get_perfcounters_collection()->add(logger);
   for (unsigned i = l_wbthrottle_first + 1; i != l_wbthrottle_last; ++i)
     logger->set(i, 0);
+  logger->set(l_wbthrottle_limit_ratio, 100);
 
   cct->_conf->add_observer(this);
 }
@@ -78,6 +86,10 @@ const char** WBThrottle::get_tracked_conf_keys() const
     "filestore_wbthrottle_xfs_ios_hard_limit",
     "filestore_wbthrottle_xfs_inodes_start_flusher",
     "filestore_wbthrottle_xfs_inodes_hard_limit",
+    "filestore_wbthrottle_adaptive",
+    "filestore_wbthrottle_adaptive_target_lat",
+    "filestore_wbthrottle_adaptive_min_ratio",
+    "filestore_wbthrottle_paced_flush_interval",
     NULL
   };
   return KEYS;
@@ -87,34 +99,72 @@ void WBThrottle::set_from_conf()
 {
   assert(lock.is_locked());
   if (fs == BTRFS) {
-    size_limits.first =
+    size_limits_conf.first =
       cct->_conf->filestore_wbthrottle_btrfs_bytes_start_flusher;
-    size_limits.second =
+    size_limits_conf.second =
       cct->_conf->filestore_wbthrottle_btrfs_bytes_hard_limit;
-    io_limits.first =
+    io_limits_conf.first =
       cct->_conf->filestore_wbthrottle_btrfs_ios_start_flusher;
-    io_limits.second =
+    io_limits_conf.second =
       cct->_conf->filestore_wbthrottle_btrfs_ios_hard_limit;
-    fd_limits.first =
+    fd_limits_conf.first =
       cct->_conf->filestore_wbthrottle_btrfs_inodes_start_flusher;
-    fd_limits.second =
+    fd_limits_conf.second =
       cct->_conf->filestore_wbthrottle_btrfs_inodes_hard_limit;
   } else if (fs == XFS) {
-    size_limits.first =
+    size_limits_conf.first =
       cct->_conf->filestore_wbthrottle_xfs_bytes_start_flusher;
-    size_limits.second =
+    size_limits_conf.second =
       cct->_conf->filestore_wbthrottle_xfs_bytes_hard_limit;
-    io_limits.first =
+    io_limits_conf.first =
       cct->_conf->filestore_wbthrottle_xfs_ios_start_flusher;
-    io_limits.second =
+    io_limits_conf.second =
       cct->_conf->filestore_wbthrottle_xfs_ios_hard_limit;
-    fd_limits.first =
+    fd_limits_conf.first =
       cct->_conf->filestore_wbthrottle_xfs_inodes_start_flusher;
-    fd_limits.second =
+    fd_limits_conf.second =
       cct->_conf->filestore_wbthrottle_xfs_inodes_hard_limit;
   } else {
     assert(0 == "invalid value for fs");
   }
+  adaptive = cct->_conf->filestore_wbthrottle_adaptive;
+  adaptive_target_lat = cct->_conf->filestore_wbthrottle_adaptive_target_lat;
+  adaptive_min_ratio = cct->_conf->filestore_wbthrottle_adaptive_min_ratio;
+  paced_flush_interval = cct->_conf->filestore_wbthrottle_paced_flush_interval;
+  if (!adaptive)
+    limit_ratio = 1.0;
+  apply_limit_ratio();
+  cond.Signal();
+}
+
+void WBThrottle::apply_limit_ratio()
+{
+  assert(lock.is_locked());
+  size_limits.first = MAX((uint64_t)1, (uint64_t)(size_limits_conf.first * limit_ratio));
+  size_limits.second = MAX((uint64_t)1, (uint64_t)(size_limits_conf.second * limit_ratio));
+  io_limits.first = MAX((uint64_t)1, (uint64_t)(io_limits_conf.first * limit_ratio));
+  io_limits.second = MAX((uint64_t)1, (uint64_t)(io_limits_conf.second * limit_ratio));
+  fd_limits.first = MAX((uint64_t)1, (uint64_t)(fd_limits_conf.first * limit_ratio));
+  fd_limits.second = MAX((uint64_t)1, (uint64_t)(fd_limits_conf.second * limit_ratio));
+  logger->set(l_wbthrottle_limit_ratio, (uint64_t)(limit_ratio * 100));
+}
+
+void WBThrottle::adjust_limits(double flush_lat)
+{
+  assert(lock.is_locked());
+  if (!adaptive)
+    return;
+  // AIMD on the throttle targets: back off sharply when the device
+  // falls behind the latency target, creep back up while it keeps up
+  double new_ratio = limit_ratio;
+  if (flush_lat > adaptive_target_lat)
+    new_ratio = MAX(limit_ratio / 2, adaptive_min_ratio);
+  else if (flush_lat < adaptive_target_lat / 2)
+    new_ratio = MIN(limit_ratio + 0.05, 1.0);
+  if (new_ratio == limit_ratio)
+    return;
+  limit_ratio = new_ratio;
+  apply_limit_ratio();
   cond.Signal();
 }
 
@@ -135,11 +185,24 @@ bool WBThrottle::get_next_should_flush(
 {
   assert(lock.is_locked());
   assert(next);
-  while (!stopping && !beyond_limit())
-         cond.Wait(lock);
+  while (!stopping && !beyond_limit()) {
+    if (!(paced_flush_interval > 0) || pending_wbs.empty()) {
+      cond.Wait(lock);
+      continue;
+    }
+    // below the limits but dirty; trickle out the lru-oldest inode on
+    // a timer so the periodic commit sync finds little residual data
+    utime_t now = ceph_clock_now(cct);
+    utime_t next_flush = last_flush;
+    next_flush += paced_flush_interval;
+    if (now >= next_flush)
+      break;
+    cond.WaitInterval(cct, lock, next_flush - now);
+  }
   if (stopping)
     return false;
   assert(!pending_wbs.empty());
+  last_flush = ceph_clock_now(cct);
   ghobject_t obj(pop_object());
   
   ceph::unordered_map<ghobject_t, pair<PendingWB, FDRef> >::iterator i =
@@ -165,11 +228,14 @@ void *WBThrottle::entry()
     logger->dec(l_wbthrottle_inodes_dirtied);
     logger->inc(l_wbthrottle_inodes_wb);
     lock.Unlock();
+    utime_t start = ceph_clock_now(cct);
 #ifdef HAVE_FDATASYNC
     ::fdatasync(**wb.get<1>());
 #else
     ::fsync(**wb.get<1>());
 #endif
+    utime_t flush_lat = ceph_clock_now(cct) - start;
+    logger->tinc(l_wbthrottle_flush_lat, flush_lat);
 #ifdef HAVE_POSIX_FADVISE
     if (g_conf->filestore_fadvise && wb.get<2>().nocache) {
       int fa_r = posix_fadvise(**wb.get<1>(), 0, 0, POSIX_FADV_DONTNEED);
@@ -177,6 +243,7 @@ void *WBThrottle::entry()
     }
 #endif
     lock.Lock();
+    adjust_limits((double)flush_lat);
     clearing = ghobject_t();
     cond.Signal();
     wb = boost::tuple<ghobject_t, FDRef, PendingWB>();
@@ -209,7 +276,7 @@ void WBThrottle::queue_wb(
 
   wbiter->second.first.add(nocache, len, 1);
   insert_object(hoid);
-  if (beyond_limit())
+  if (beyond_limit() || paced_flush_interval > 0)
     cond.Signal();
 }
 
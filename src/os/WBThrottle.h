@@ -35,6 +35,8 @@ enum {
   l_wbthrottle_ios_wb,
   l_wbthrottle_inodes_dirtied,
   l_wbthrottle_inodes_wb,
+  l_wbthrottle_flush_lat,
+  l_wbthrottle_limit_ratio,
   l_wbthrottle_last
 };
 
@@ -58,6 +60,21 @@ class WBThrottle : Thread, public md_config_obs_t {
   /// Limits on unflushed objects
   pair<uint64_t, uint64_t> fd_limits;
 
+  /// Configured limits; *_limits above are these scaled by limit_ratio
+  pair<uint64_t, uint64_t> size_limits_conf;
+  pair<uint64_t, uint64_t> io_limits_conf;
+  pair<uint64_t, uint64_t> fd_limits_conf;
+
+  /// Feedback control of the limits from observed flush latency
+  bool adaptive;
+  double adaptive_target_lat;  ///< per-flush latency we aim for
+  double adaptive_min_ratio;   ///< floor for limit_ratio
+  double limit_ratio;          ///< current scale applied to the limits
+
+  /// Paced background flush of dirty inodes between sync points
+  double paced_flush_interval; ///< seconds between idle flushes (0 = off)
+  utime_t last_flush;          ///< when the flusher last popped an inode
+
   uint64_t cur_ios;  /// Currently unflushed IOs
   uint64_t cur_size; /// Currently unflushed bytes
 
@@ -129,6 +146,8 @@ private:
   FS fs;
 
   void set_from_conf();
+  void apply_limit_ratio();
+  void adjust_limits(double flush_lat);
   bool beyond_limit() const {
     if (cur_ios < io_limits.first &&
 	pending_wbs.size() < fd_limits.first &&
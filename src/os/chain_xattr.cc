@@ -98,149 +98,220 @@ done:
   return pos;
 }
 
+/*
+ * Find the number of chunks making up a chained xattr from a raw
+ * listxattr listing, instead of probing getxattr chunk by chunk until
+ * ENODATA.  Chunk 0 is assumed present; chained chunks show up as
+ * "<raw_base>@<id>".
+ */
+static int count_raw_chunks(const char *names, int len, const char *raw_base)
+{
+  size_t base_len = strlen(raw_base);
+  int chunks = 1;
+  const char *p = names;
+  const char *end = names + len;
 
-// setxattr
+  while (p < end) {
+    size_t l = strlen(p);
+    if (l > base_len + 1 &&
+	memcmp(p, raw_base, base_len) == 0 &&
+	p[base_len] == '@') {
+      int id = atoi(p + base_len + 1);
+      if (id + 1 > chunks)
+	chunks = id + 1;
+    }
+    p += l + 1;
+  }
+  return chunks;
+}
+
+static int get_xattr_chunks(const char *fn, const char *raw_base)
+{
+  int len = sys_listxattr(fn, 0, 0);
+  if (len < 0)
+    return len;
+
+  size_t total_len = len * 2; // should be enough
+  char *full_buf = (char *)malloc(total_len);
+  if (!full_buf)
+    return -ENOMEM;
+
+  len = sys_listxattr(fn, full_buf, total_len);
+  if (len < 0) {
+    free(full_buf);
+    return len;
+  }
+
+  int chunks = count_raw_chunks(full_buf, len, raw_base);
+  free(full_buf);
+  return chunks;
+}
+
+static int get_fxattr_chunks(int fd, const char *raw_base)
+{
+  int len = sys_flistxattr(fd, 0, 0);
+  if (len < 0)
+    return len;
+
+  size_t total_len = len * 2; // should be enough
+  char *full_buf = (char *)malloc(total_len);
+  if (!full_buf)
+    return -ENOMEM;
+
+  len = sys_flistxattr(fd, full_buf, total_len);
+  if (len < 0) {
+    free(full_buf);
+    return len;
+  }
+
+  int chunks = count_raw_chunks(full_buf, len, raw_base);
+  free(full_buf);
+  return chunks;
+}
+
+
+// getxattr
 
 static int getxattr_len(const char *fn, const char *name)
 {
-  int i = 0, total = 0;
   char raw_name[CHAIN_XATTR_MAX_NAME_LEN * 2 + 16];
-  int r;
+  int r, total;
 
-  do {
+  get_raw_xattr_name(name, 0, raw_name, sizeof(raw_name));
+  r = sys_getxattr(fn, raw_name, 0, 0);
+  if (r < 0)
+    return r;
+  total = r;
+  if (r != CHAIN_XATTR_MAX_BLOCK_LEN && r != CHAIN_XATTR_SHORT_BLOCK_LEN)
+    return total;
+
+  // may chain; list the raw names once and size the remaining chunks
+  int chunks = get_xattr_chunks(fn, raw_name);
+  if (chunks < 0)
+    return chunks;
+  for (int i = 1; i < chunks; i++) {
     get_raw_xattr_name(name, i, raw_name, sizeof(raw_name));
     r = sys_getxattr(fn, raw_name, 0, 0);
-    if (!i && r < 0)
-      return r;
-    if (r < 0)
+    if (r == -ENOATTR)  // raced with a rewrite; treat as end of chain
       break;
+    if (r < 0)
+      return r;
     total += r;
-    i++;
-  } while (r == CHAIN_XATTR_MAX_BLOCK_LEN ||
-	   r == CHAIN_XATTR_SHORT_BLOCK_LEN);
-
+  }
   return total;
 }
 
 int chain_getxattr(const char *fn, const char *name, void *val, size_t size)
 {
-  int i = 0, pos = 0;
   char raw_name[CHAIN_XATTR_MAX_NAME_LEN * 2 + 16];
-  int ret = 0;
+  int pos = 0;
   int r;
   size_t chunk_size;
 
   if (!size)
     return getxattr_len(fn, name);
 
-  do {
-    chunk_size = (size < CHAIN_XATTR_MAX_BLOCK_LEN ? size : CHAIN_XATTR_MAX_BLOCK_LEN);
+  // first chunk; anything that doesn't chain is a single syscall
+  get_raw_xattr_name(name, 0, raw_name, sizeof(raw_name));
+  chunk_size = (size < CHAIN_XATTR_MAX_BLOCK_LEN ? size : CHAIN_XATTR_MAX_BLOCK_LEN);
+  r = sys_getxattr(fn, raw_name, val, chunk_size);
+  if (r < 0)
+    return r;
+  pos = r;
+  if (r != CHAIN_XATTR_MAX_BLOCK_LEN && r != CHAIN_XATTR_SHORT_BLOCK_LEN)
+    return pos;
+
+  // may chain; list the raw names once and fetch the remaining chunks
+  // in order instead of probing until ENODATA
+  int chunks = get_xattr_chunks(fn, raw_name);
+  if (chunks < 0)
+    return chunks;
+  for (int i = 1; i < chunks; i++) {
+    if (size <= (size_t)pos)
+      return -ERANGE;  // more chunks than the caller's buffer
+    chunk_size = size - pos;
+    if (chunk_size > CHAIN_XATTR_MAX_BLOCK_LEN)
+      chunk_size = CHAIN_XATTR_MAX_BLOCK_LEN;
     get_raw_xattr_name(name, i, raw_name, sizeof(raw_name));
-
     r = sys_getxattr(fn, raw_name, (char *)val + pos, chunk_size);
-    if (i && r == -ENOATTR) {
-      ret = pos;
-      break;
-    }
-    if (r < 0) {
-      ret = r;
+    if (r == -ENOATTR)  // raced with a rewrite; treat as end of chain
       break;
-    }
-
-    if (r > 0) {
-      pos += r;
-      size -= r;
-    }
-
-    i++;
-  } while (size && (r == CHAIN_XATTR_MAX_BLOCK_LEN ||
-		    r == CHAIN_XATTR_SHORT_BLOCK_LEN));
-
-  if (r >= 0) {
-    ret = pos;
-    /* is there another chunk? that can happen if the last read size span over
-       exactly one block */
-    if (chunk_size == CHAIN_XATTR_MAX_BLOCK_LEN ||
-	chunk_size == CHAIN_XATTR_SHORT_BLOCK_LEN) {
-      get_raw_xattr_name(name, i, raw_name, sizeof(raw_name));
-      r = sys_getxattr(fn, raw_name, 0, 0);
-      if (r > 0) { // there's another chunk.. the original buffer was too small
-        ret = -ERANGE;
-      }
-    }
+    if (r < 0)
+      return r;
+    pos += r;
   }
-  return ret;
+  return pos;
 }
 
 static int chain_fgetxattr_len(int fd, const char *name)
 {
-  int i = 0, total = 0;
   char raw_name[CHAIN_XATTR_MAX_NAME_LEN * 2 + 16];
-  int r;
+  int r, total;
 
-  do {
+  get_raw_xattr_name(name, 0, raw_name, sizeof(raw_name));
+  r = sys_fgetxattr(fd, raw_name, 0, 0);
+  if (r < 0)
+    return r;
+  total = r;
+  if (r != CHAIN_XATTR_MAX_BLOCK_LEN && r != CHAIN_XATTR_SHORT_BLOCK_LEN)
+    return total;
+
+  // may chain; list the raw names once and size the remaining chunks
+  int chunks = get_fxattr_chunks(fd, raw_name);
+  if (chunks < 0)
+    return chunks;
+  for (int i = 1; i < chunks; i++) {
     get_raw_xattr_name(name, i, raw_name, sizeof(raw_name));
     r = sys_fgetxattr(fd, raw_name, 0, 0);
-    if (!i && r < 0)
-      return r;
-    if (r < 0)
+    if (r == -ENOATTR)  // raced with a rewrite; treat as end of chain
       break;
+    if (r < 0)
+      return r;
     total += r;
-    i++;
-  } while (r == CHAIN_XATTR_MAX_BLOCK_LEN ||
-	   r == CHAIN_XATTR_SHORT_BLOCK_LEN);
-
+  }
   return total;
 }
 
 int chain_fgetxattr(int fd, const char *name, void *val, size_t size)
 {
-  int i = 0, pos = 0;
   char raw_name[CHAIN_XATTR_MAX_NAME_LEN * 2 + 16];
-  int ret = 0;
+  int pos = 0;
   int r;
   size_t chunk_size;
 
   if (!size)
     return chain_fgetxattr_len(fd, name);
 
-  do {
-    chunk_size = (size < CHAIN_XATTR_MAX_BLOCK_LEN ? size : CHAIN_XATTR_MAX_BLOCK_LEN);
+  // first chunk; anything that doesn't chain is a single syscall
+  get_raw_xattr_name(name, 0, raw_name, sizeof(raw_name));
+  chunk_size = (size < CHAIN_XATTR_MAX_BLOCK_LEN ? size : CHAIN_XATTR_MAX_BLOCK_LEN);
+  r = sys_fgetxattr(fd, raw_name, val, chunk_size);
+  if (r < 0)
+    return r;
+  pos = r;
+  if (r != CHAIN_XATTR_MAX_BLOCK_LEN && r != CHAIN_XATTR_SHORT_BLOCK_LEN)
+    return pos;
+
+  // may chain; list the raw names once and fetch the remaining chunks
+  // in order instead of probing until ENODATA
+  int chunks = get_fxattr_chunks(fd, raw_name);
+  if (chunks < 0)
+    return chunks;
+  for (int i = 1; i < chunks; i++) {
+    if (size <= (size_t)pos)
+      return -ERANGE;  // more chunks than the caller's buffer
+    chunk_size = size - pos;
+    if (chunk_size > CHAIN_XATTR_MAX_BLOCK_LEN)
+      chunk_size = CHAIN_XATTR_MAX_BLOCK_LEN;
     get_raw_xattr_name(name, i, raw_name, sizeof(raw_name));
-
     r = sys_fgetxattr(fd, raw_name, (char *)val + pos, chunk_size);
-    if (i && r == -ENOATTR) {
-      ret = pos;
-      break;
-    }
-    if (r < 0) {
-      ret = r;
+    if (r == -ENOATTR)  // raced with a rewrite; treat as end of chain
       break;
-    }
-
-    if (r > 0) {
-      pos += r;
-      size -= r;
-    }
-
-    i++;
-  } while (size && (r == CHAIN_XATTR_MAX_BLOCK_LEN ||
-		    r == CHAIN_XATTR_SHORT_BLOCK_LEN));
-
-  if (r >= 0) {
-    ret = pos;
-    /* is there another chunk? that can happen if the last read size span over
-       exactly one block */
-    if (chunk_size == CHAIN_XATTR_MAX_BLOCK_LEN ||
-	chunk_size == CHAIN_XATTR_SHORT_BLOCK_LEN) {
-      get_raw_xattr_name(name, i, raw_name, sizeof(raw_name));
-      r = sys_fgetxattr(fd, raw_name, 0, 0);
-      if (r > 0) { // there's another chunk.. the original buffer was too small
-        ret = -ERANGE;
-      }
-    }
+    if (r < 0)
+      return r;
+    pos += r;
   }
-  return ret;
+  return pos;
 }
 
 
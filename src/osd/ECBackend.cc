@@ -822,8 +822,9 @@ void ECBackend::handle_sub_write(
   assert(!get_parent()->get_log().get_missing().is_missing(op.soid));
   if (!get_parent()->pgb_is_primary())
     get_parent()->update_stats(op.stats);
+  // localt never leaves this OSD; keep the in-memory op layout even if
+  // op.t was shipped in the encoded form for old peers
   ObjectStore::Transaction *localt = new ObjectStore::Transaction;
-  localt->set_use_tbl(op.t.get_use_tbl());
   if (!op.temp_added.empty()) {
     add_temp_objs(op.temp_added);
   }
@@ -1024,14 +1025,63 @@ shard_to_read_map.find(from);
 
   assert(rop.in_progress.count(from));
   rop.in_progress.erase(from);
-  if (!rop.in_progress.empty()) {
-    dout(10) << __func__ << " readop not complete: " << rop << dendl;
-  } else {
+  if (rop.in_progress.empty()) {
     dout(10) << __func__ << " readop complete: " << rop << dendl;
     complete_read_op(rop, m);
+  } else if (rop.hedged && read_op_can_complete(rop)) {
+    dout(10) << __func__ << " readop decodable, dropping stragglers "
+	     << rop.in_progress << ": " << rop << dendl;
+    // drop the remaining shards; their replies will find the tid gone
+    // and be ignored, just as if we had canceled them
+    for (set<pg_shard_t>::const_iterator i = rop.in_progress.begin();
+	 i != rop.in_progress.end();
+	 ++i) {
+      map<pg_shard_t, set<ceph_tid_t> >::iterator j =
+	shard_to_read_map.find(*i);
+      assert(j != shard_to_read_map.end());
+      j->second.erase(rop.tid);
+    }
+    rop.in_progress.clear();
+    complete_read_op(rop, m);
+  } else {
+    dout(10) << __func__ << " readop not complete: " << rop << dendl;
   }
 }
 
+bool ECBackend::read_op_can_complete(ReadOp &rop)
+{
+  set<int> want;
+  get_want_to_read_shards(&want);
+  for (map<hobject_t, read_request_t, hobject_t::BitwiseComparator>::iterator i =
+	 rop.to_read.begin();
+       i != rop.to_read.end();
+       ++i) {
+    if (i->second.want_attrs)
+      return false;
+    map<hobject_t, read_result_t, hobject_t::BitwiseComparator>::iterator res =
+      rop.complete.find(i->first);
+    if (res == rop.complete.end())
+      return false;
+    if (res->second.r != 0 || !res->second.errors.empty())
+      return false;
+    for (list<boost::tuple<uint64_t, uint64_t,
+			   map<pg_shard_t, bufferlist> > >::iterator j =
+	   res->second.returned.begin();
+	 j != res->second.returned.end();
+	 ++j) {
+      set<int> have;
+      for (map<pg_shard_t, bufferlist>::iterator k = j->get<2>().begin();
+	   k != j->get<2>().end();
+	   ++k)
+	have.insert(k->first.shard);
+      set<int> min;
+      if (ec_impl->minimum_to_decode(want, have, &min) < 0)
+	return false;
+    }
+  }
+  return true;
+}
+
 void ECBackend::complete_read_op(ReadOp &rop, RecoveryMessages *m)
 {
   map<hobject_t, read_request_t, hobject_t::BitwiseComparator>::iterator reqiter =
@@ -1324,6 +1374,10 @@ int ECBackend::get_min_avail_to_read_shards(
 
   set<int> have;
   map<shard_id_t, pg_shard_t> shards;
+  // relative read cost per shard: settled acting shards are cheaper
+  // to read from than shards that are busy backfilling or only known
+  // via missing_loc, so prefer them when the plugin has a choice
+  map<int, int> costs;
 
   for (set<pg_shard_t>::const_iterator i =
 	 get_parent()->get_acting_shards().begin();
@@ -1336,6 +1390,7 @@ int ECBackend::get_min_avail_to_read_shards(
       have.insert(i->shard);
       assert(!shards.count(i->shard));
       shards.insert(make_pair(i->shard, *i));
+      costs[i->shard] = 1;
     }
   }
 
@@ -1356,6 +1411,7 @@ int ECBackend::get_min_avail_to_read_shards(
 	  !missing.is_missing(hoid)) {
 	have.insert(i->shard);
 	shards.insert(make_pair(i->shard, *i));
+	costs[i->shard] = 2;
       }
     }
 
@@ -1371,12 +1427,14 @@ int ECBackend::get_min_avail_to_read_shards(
 	}
 	have.insert(i->shard);
 	shards.insert(make_pair(i->shard, *i));
+	if (!costs.count(i->shard))
+	  costs[i->shard] = 3;
       }
     }
   }
 
   set<int> need;
-  int r = ec_impl->minimum_to_decode(want, have, &need);
+  int r = ec_impl->minimum_to_decode_with_cost(want, costs, &need);
   if (r < 0)
     return r;
 
@@ -1392,10 +1450,41 @@ int ECBackend::get_min_avail_to_read_shards(
   return 0;
 }
 
+void ECBackend::get_want_to_read_shards(set<int> *want)
+{
+  const vector<int> &chunk_mapping = ec_impl->get_chunk_mapping();
+  for (int i = 0; i < (int)ec_impl->get_data_chunk_count(); ++i) {
+    int chunk = (int)chunk_mapping.size() > i ? chunk_mapping[i] : i;
+    want->insert(chunk);
+  }
+}
+
+void ECBackend::get_extra_read_shards(
+  const hobject_t &hoid,
+  const set<pg_shard_t> &already,
+  unsigned extra,
+  set<pg_shard_t> *to_read)
+{
+  for (set<pg_shard_t>::const_iterator i =
+	 get_parent()->get_acting_shards().begin();
+       i != get_parent()->get_acting_shards().end() && extra > 0;
+       ++i) {
+    if (already.count(*i))
+      continue;
+    const pg_missing_t &missing = get_parent()->get_shard_missing(*i);
+    if (missing.is_missing(hoid))
+      continue;
+    dout(10) << __func__ << ": adding extra shard " << *i << dendl;
+    to_read->insert(*i);
+    --extra;
+  }
+}
+
 void ECBackend::start_read_op(
   int priority,
   map<hobject_t, read_request_t, hobject_t::BitwiseComparator> &to_read,
-  OpRequestRef _op)
+  OpRequestRef _op,
+  bool hedged)
 {
   ceph_tid_t tid = get_parent()->get_tid();
   assert(!tid_to_read_map.count(tid));
@@ -1404,6 +1493,7 @@ void ECBackend::start_read_op(
   op.tid = tid;
   op.to_read.swap(to_read);
   op.op = _op;
+  op.hedged = hedged;
   dout(10) << __func__ << ": starting " << op << dendl;
 
   map<pg_shard_t, ECSubRead> messages;
@@ -1700,12 +1790,8 @@ void ECBackend::objects_read_async(
     offsets.push_back(boost::make_tuple(tmp.first, tmp.second, i->first.get<2>()));
   }
 
-  const vector<int> &chunk_mapping = ec_impl->get_chunk_mapping();
   set<int> want_to_read;
-  for (int i = 0; i < (int)ec_impl->get_data_chunk_count(); ++i) {
-    int chunk = (int)chunk_mapping.size() > i ? chunk_mapping[i] : i;
-    want_to_read.insert(chunk);
-  }
+  get_want_to_read_shards(&want_to_read);
   set<pg_shard_t> shards;
   int r = get_min_avail_to_read_shards(
     hoid,
@@ -1714,6 +1800,16 @@ void ECBackend::objects_read_async(
     &shards);
   assert(r == 0);
 
+  // optionally hedge against stragglers by reading extra shards and
+  // decoding as soon as a sufficient subset has replied
+  bool hedged = false;
+  uint64_t extra = cct->_conf->osd_ec_hedged_read_shards;
+  if (extra) {
+    set<pg_shard_t> min_shards(shards);
+    get_extra_read_shards(hoid, min_shards, extra, &shards);
+    hedged = shards.size() > min_shards.size();
+  }
+
   map<hobject_t, read_request_t, hobject_t::BitwiseComparator> for_read_op;
   for_read_op.insert(
     make_pair(
@@ -1728,7 +1824,8 @@ void ECBackend::objects_read_async(
   start_read_op(
     cct->_conf->osd_client_op_priority,
     for_read_op,
-    OpRequestRef());
+    OpRequestRef(),
+    hedged);
   return;
 }
 
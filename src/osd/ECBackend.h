@@ -294,19 +294,24 @@ public:
     void dump(Formatter *f) const;
 
     set<pg_shard_t> in_progress;
+
+    /// true if we read extra shards and may complete before all reply
+    bool hedged;
   };
   friend struct FinishReadOp;
   void filter_read_op(
     const OSDMapRef osdmap,
     ReadOp &op);
   void complete_read_op(ReadOp &rop, RecoveryMessages *m);
+  bool read_op_can_complete(ReadOp &rop);
   friend ostream &operator<<(ostream &lhs, const ReadOp &rhs);
   map<ceph_tid_t, ReadOp> tid_to_read_map;
   map<pg_shard_t, set<ceph_tid_t> > shard_to_read_map;
   void start_read_op(
     int priority,
     map<hobject_t, read_request_t, hobject_t::BitwiseComparator> &to_read,
-    OpRequestRef op);
+    OpRequestRef op,
+    bool hedged = false);
 
 
   /**
@@ -347,9 +352,12 @@ public:
     map<hobject_t, ECUtil::HashInfoRef, hobject_t::BitwiseComparator> unstable_hash_infos;
     ~Op() {
       delete t;
-      delete on_local_applied_sync;
-      delete on_all_applied;
-      delete on_all_commit;
+      if (on_local_applied_sync)
+	on_local_applied_sync->abandon();
+      if (on_all_applied)
+	on_all_applied->abandon();
+      if (on_all_commit)
+	on_all_commit->abandon();
     }
   };
   friend ostream &operator<<(ostream &lhs, const Op &rhs);
@@ -455,6 +463,17 @@ public:
     set<pg_shard_t> *to_read   ///< [out] shards to read
     ); ///< @return error code, 0 on success
 
+  /// Fills want with the data shard ids, respecting the chunk mapping
+  void get_want_to_read_shards(set<int> *want);
+
+  /// Adds up to extra additional available acting shards to to_read
+  void get_extra_read_shards(
+    const hobject_t &hoid,         ///< [in] object
+    const set<pg_shard_t> &already,///< [in] shards we already read
+    unsigned extra,                ///< [in] max shards to add
+    set<pg_shard_t> *to_read       ///< [out] gets the extra shards
+    );
+
   int objects_get_attrs(
     const hobject_t &hoid,
     map<string, bufferlist> *out);
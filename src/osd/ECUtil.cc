@@ -26,19 +26,35 @@ int ECUtil::decode(
   if (total_chunk_size == 0)
     return 0;
 
+  // The code kernels operate on each byte position independently, so
+  // instead of feeding the plugin one stripe at a time we hand it the
+  // full-length shard buffers in a single call and let it decode every
+  // stripe in one pass; the plugin then assembles and aligns each
+  // shard buffer at most once per object instead of once per stripe.
+  bufferlist decoded;
+  int r = ec_impl->decode_concat(to_decode, &decoded);
+  assert(r == 0);
+
+  uint64_t data_chunks = sinfo.get_stripe_width() / sinfo.get_chunk_size();
+  assert(decoded.length() == data_chunks * total_chunk_size);
+
+  if (total_chunk_size == sinfo.get_chunk_size()) {
+    // single stripe, already in logical order
+    out->claim_append(decoded);
+    return 0;
+  }
+
+  // decoded holds each data shard's chunks back to back; interleave
+  // them back into stripe order with zero-copy references
   for (uint64_t i = 0; i < total_chunk_size; i += sinfo.get_chunk_size()) {
-    map<int, bufferlist> chunks;
-    for (map<int, bufferlist>::iterator j = to_decode.begin();
-	 j != to_decode.end();
-	 ++j) {
-      chunks[j->first].substr_of(j->second, i, sinfo.get_chunk_size());
+    for (uint64_t j = 0; j < data_chunks; ++j) {
+      bufferlist chunk;
+      chunk.substr_of(decoded, j * total_chunk_size + i,
+		      sinfo.get_chunk_size());
+      out->claim_append(chunk);
     }
-    bufferlist bl;
-    int r = ec_impl->decode_concat(chunks, &bl);
-    assert(bl.length() == sinfo.get_stripe_width());
-    assert(r == 0);
-    out->claim_append(bl);
   }
+  assert(out->length() == data_chunks * total_chunk_size);
   return 0;
 }
 
@@ -71,28 +87,17 @@ int ECUtil::decode(
     need.insert(i->first);
   }
 
-  for (uint64_t i = 0; i < total_chunk_size; i += sinfo.get_chunk_size()) {
-    map<int, bufferlist> chunks;
-    for (map<int, bufferlist>::iterator j = to_decode.begin();
-	 j != to_decode.end();
-	 ++j) {
-      chunks[j->first].substr_of(j->second, i, sinfo.get_chunk_size());
-    }
-    map<int, bufferlist> out_bls;
-    int r = ec_impl->decode(need, chunks, &out_bls);
-    assert(r == 0);
-    for (map<int, bufferlist*>::iterator j = out.begin();
-	 j != out.end();
-	 ++j) {
-      assert(out_bls.count(j->first));
-      assert(out_bls[j->first].length() == sinfo.get_chunk_size());
-      j->second->claim_append(out_bls[j->first]);
-    }
-  }
-  for (map<int, bufferlist*>::iterator i = out.begin();
-       i != out.end();
-       ++i) {
-    assert(i->second->length() == total_chunk_size);
+  // decode all stripes with a single plugin call on the full-length
+  // shard buffers; see the comment in the overload above
+  map<int, bufferlist> out_bls;
+  int r = ec_impl->decode(need, to_decode, &out_bls);
+  assert(r == 0);
+  for (map<int, bufferlist*>::iterator j = out.begin();
+       j != out.end();
+       ++j) {
+    assert(out_bls.count(j->first));
+    assert(out_bls[j->first].length() == total_chunk_size);
+    j->second->claim_append(out_bls[j->first]);
   }
   return 0;
 }
@@ -69,6 +69,8 @@ public:
     virtual void dump(Formatter *f) const = 0;
     virtual Impl* clone() const = 0;
     virtual void seal() {}
+    /// try to absorb o's contents; false if the impls aren't mergeable
+    virtual bool try_merge(const Impl *o) { return false; }
     virtual ~Impl() {}
   };
 
@@ -158,6 +160,14 @@ public:
     sealed = true;
     impl->seal();
   }
+  /// merge o into this set if the impls are compatible
+  bool try_merge(const HitSet &o) {
+    if (!impl || !o.impl)
+      return false;
+    if (impl->get_type() != o.impl->get_type())
+      return false;
+    return impl->try_merge(o.impl.get());
+  }
 
   void encode(bufferlist &bl) const;
   void decode(bufferlist::iterator &bl);
@@ -443,10 +453,15 @@ public:
     return bloom.approx_unique_element_count();
   }
   void seal() {
-    // aim for a density of .5 (50% of bit set)
+    // aim for a density of .5 (50% of bit set); fold only to
+    // power-of-two divisors so sealed sets stay mergeable
     double pc = (double)bloom.density() * 2.0;
     if (pc < 1.0)
-      bloom.compress(pc);
+      bloom.compress_mergeable(pc);
+  }
+  bool try_merge(const HitSet::Impl *i) {
+    const BloomHitSet *o = static_cast<const BloomHitSet*>(i);
+    return bloom.try_merge(o->bloom);
   }
 
   void encode(bufferlist &bl) const {
@@ -45,6 +45,8 @@
 
 #include "os/ObjectStore.h"
 
+#include "compressor/AsyncCompressor.h"
+
 #include "ReplicatedPG.h"
 
 
@@ -101,6 +103,7 @@
 #include "messages/MPGStatsAck.h"
 
 #include "messages/MWatchNotify.h"
+#include "messages/MWatchPing.h"
 #include "messages/MOSDPGPush.h"
 #include "messages/MOSDPGPushReply.h"
 #include "messages/MOSDPGPull.h"
@@ -215,6 +218,7 @@ OSDService::OSDService(OSD *osd) :
   publish_lock("OSDService::publish_lock"),
   pre_publish_lock("OSDService::pre_publish_lock"),
   peer_map_epoch_lock("OSDService::peer_map_epoch_lock"),
+  op_path_conf_lock("OSDService::op_path_conf_lock"),
   sched_scrub_lock("OSDService::sched_scrub_lock"), scrubs_pending(0),
   scrubs_active(0),
   agent_lock("OSD::agent_lock"),
@@ -226,8 +230,12 @@ OSDService::OSDService(OSD *osd) :
   agent_stop_flag(false),
   agent_timer_lock("OSD::agent_timer_lock"),
   agent_timer(osd->client_messenger->cct, agent_timer_lock),
+  promote_lock("OSDService::promote_lock"),
+  promote_window_objects(0),
+  promote_window_bytes(0),
   objecter(new Objecter(osd->client_messenger->cct, osd->objecter_messenger, osd->monc, NULL, 0, 0)),
   objecter_finisher(osd->client_messenger->cct),
+  compressor_lock("OSDService::compressor_lock"),
   watch_lock("OSD::watch_lock"),
   watch_timer(osd->client_messenger->cct, watch_lock),
   next_notif_id(0),
@@ -260,11 +268,64 @@ OSDService::OSDService(OSD *osd) :
 #endif
 {
   objecter->init();
+  refresh_op_path_conf();
 }
 
 OSDService::~OSDService()
 {
   delete objecter;
+  for (map<pair<string,int>, AsyncCompressor*>::iterator p = compressors.begin();
+       p != compressors.end();
+       ++p)
+    delete p->second;
+  delete (OpPathConf*)op_path_conf_cur.read();
+  for (list<OpPathConf*>::iterator p = op_path_conf_retired.begin();
+       p != op_path_conf_retired.end();
+       ++p)
+    delete *p;
+}
+
+void OSDService::refresh_op_path_conf()
+{
+  // called at startup and from the conf observer; in the latter case
+  // the config lock is held, so the string read below cannot race a
+  // writer and the snapshot sees a fully applied change.
+  OpPathConf *nc = new OpPathConf;
+  Mutex::Locker l(op_path_conf_lock);
+  OpPathConf *old = (OpPathConf*)op_path_conf_cur.read();
+  nc->version = old ? old->version + 1 : 1;
+  nc->client_op_priority = cct->_conf->osd_client_op_priority;
+  nc->recovery_op_priority = cct->_conf->osd_recovery_op_priority;
+  nc->max_pgls = cct->_conf->osd_max_pgls;
+  nc->max_object_size = cct->_conf->osd_max_object_size;
+  nc->op_async_reads = cct->_conf->osd_op_async_reads;
+  nc->verify_sparse_read_holes = cct->_conf->osd_verify_sparse_read_holes;
+  nc->read_eio_on_bad_digest = cct->_conf->osd_read_eio_on_bad_digest;
+  nc->debug_op_order = cct->_conf->osd_debug_op_order;
+  nc->hit_set_namespace = cct->_conf->osd_hit_set_namespace;
+  op_path_conf_cur.set((uint64_t)(uintptr_t)nc);
+  if (old)
+    op_path_conf_retired.push_back(old);
+}
+
+AsyncCompressor *OSDService::get_compressor(const string &alg, int level)
+{
+  if (!cct->_conf->async_compressor_enabled)
+    return NULL;
+  Mutex::Locker l(compressor_lock);
+  pair<string,int> key(alg, level);
+  map<pair<string,int>, AsyncCompressor*>::iterator p = compressors.find(key);
+  if (p != compressors.end())
+    return p->second;
+  AsyncCompressor *ac = new AsyncCompressor(cct, alg, level);
+  if (!ac->valid()) {
+    derr << __func__ << " cannot load compression codec " << alg << dendl;
+    delete ac;
+    return NULL;
+  }
+  ac->init();
+  compressors[key] = ac;
+  return ac;
 }
 
 void OSDService::_start_split(spg_t parent, const set<spg_t> &children)
@@ -463,6 +524,15 @@ void OSDService::shutdown()
   objecter->shutdown();
   objecter_finisher.stop();
 
+  {
+    Mutex::Locker l(compressor_lock);
+    for (map<pair<string,int>, AsyncCompressor*>::iterator p =
+	   compressors.begin();
+	 p != compressors.end();
+	 ++p)
+      p->second->terminate();
+  }
+
   {
     Mutex::Locker l(backfill_request_lock);
     backfill_request_timer.shutdown();
@@ -582,6 +652,34 @@ void OSDService::agent_stop()
 
 // -------------------------------------
 
+bool OSDService::promote_throttle()
+{
+  Mutex::Locker l(promote_lock);
+  uint64_t max_objects = cct->_conf->osd_tier_promote_max_objects_sec;
+  uint64_t max_bytes = cct->_conf->osd_tier_promote_max_bytes_sec;
+  if (!max_objects && !max_bytes)
+    return false;  // throttle disabled
+  utime_t now = ceph_clock_now(cct);
+  if (now - promote_window_start >= utime_t(1, 0)) {
+    promote_window_start = now;
+    promote_window_objects = 0;
+    promote_window_bytes = 0;
+  }
+  if ((max_objects && promote_window_objects >= max_objects) ||
+      (max_bytes && promote_window_bytes >= max_bytes))
+    return true;
+  ++promote_window_objects;
+  return false;
+}
+
+void OSDService::promote_finish(uint64_t bytes)
+{
+  Mutex::Locker l(promote_lock);
+  promote_window_bytes += bytes;
+}
+
+// -------------------------------------
+
 float OSDService::get_full_ratio()
 {
   float full_ratio = cct->_conf->osd_failsafe_full_ratio;
@@ -684,6 +782,12 @@ void OSDService::update_osd_stat(vector<int>& hb_peers)
   dout(20) << "update_osd_stat " << osd_stat << dendl;
 }
 
+void OSDService::stamp_op_queue_depth(Message *m)
+{
+  MOSDOpReply *reply = static_cast<MOSDOpReply*>(m);
+  reply->set_queue_depth_hint(osd->op_shardedwq.get_sampled_depth());
+}
+
 void OSDService::send_message_osd_cluster(int peer, Message *m, epoch_t from_epoch)
 {
   OSDMapRef next_map = get_nextmap_reserved();
@@ -1620,6 +1724,7 @@ int OSD::pre_init()
   }
 
   cct->_conf->add_observer(this);
+  update_reserver_config();
   return 0;
 }
 
@@ -1670,6 +1775,9 @@ bool OSD::asok_command(string command, cmdmap_t& cmdmap, string format,
     } else {
       op_tracker.dump_historic_ops(f);
     }
+  } else if (command == "dump_op_latency") {
+    // histogram recording is always on, no tracking_enabled check
+    op_tracker.dump_op_latency(f);
   } else if (command == "dump_op_pq_state") {
     f->open_object_section("pq");
     op_shardedwq.dump(f);
@@ -1877,9 +1985,8 @@ int OSD::init()
     service.set_epochs(NULL, NULL, &bind_epoch);
   }
 
-  clear_temp_objects();
-
-  // load up pgs (as they previously existed)
+  // load up pgs (as they previously existed); each pg clears out its
+  // leftover temp objects as it is loaded
   load_pgs();
 
   dout(2) << "superblock: i am osd." << superblock.whoami << dendl;
@@ -1989,6 +2096,10 @@ void OSD::final_init()
 				     asok_hook,
 				     "show slowest recent ops");
   assert(r == 0);
+  r = admin_socket->register_command("dump_op_latency", "dump_op_latency",
+				     asok_hook,
+				     "show op latency histograms by op type");
+  assert(r == 0);
   r = admin_socket->register_command("dump_op_pq_state", "dump_op_pq_state",
 				     asok_hook,
 				     "dump op priority queue state");
@@ -2166,6 +2277,8 @@ void OSD::create_logger()
 
   osd_plb.add_u64(l_osd_loadavg, "loadavg", "CPU load");
   osd_plb.add_u64(l_osd_buf, "buffer_bytes", "Total allocated buffer size");       // total ceph::buffer bytes
+  osd_plb.add_u64(l_osd_buf_hugepage, "buffer_hugepage_bytes", "Hugepage arena backing live buffers");
+  osd_plb.add_u64(l_osd_buf_hugepage_total, "buffer_hugepage_total_bytes", "Hugepage arena reserved");
 
   osd_plb.add_u64(l_osd_pg, "numpg", "Placement groups");   // num pgs
   osd_plb.add_u64(l_osd_pg_primary, "numpg_primary", "Placement groups for which this osd is primary"); // num primary pgs
@@ -2176,6 +2289,9 @@ void OSD::create_logger()
   osd_plb.add_u64_counter(l_osd_map, "map_messages", "OSD map messages");           // osdmap messages
   osd_plb.add_u64_counter(l_osd_mape, "map_message_epochs", "OSD map epochs");         // osdmap epochs
   osd_plb.add_u64_counter(l_osd_mape_dup, "map_message_epoch_dups", "OSD map duplicates"); // dup osdmap epochs
+  osd_plb.add_u64_counter(l_osd_peering_fastpath, "peering_fastpath", "Peering rounds that skipped the info exchange");
+  osd_plb.add_u64_counter(l_osd_peering_full, "peering_full", "Peering rounds that probed peers for info");
+  osd_plb.add_time_avg(l_osd_pg_log_merge_lat, "pg_log_merge_lat", "Time merging peer pg logs during peering");
   osd_plb.add_u64_counter(l_osd_waiting_for_map, "messages_delayed_for_map", "Operations waiting for OSD map"); // dup osdmap epochs
 
   osd_plb.add_u64(l_osd_stat_bytes, "stat_bytes", "OSD size");
@@ -2305,6 +2421,7 @@ int OSD::shutdown()
   cct->get_admin_socket()->unregister_command("dump_ops_in_flight");
   cct->get_admin_socket()->unregister_command("ops");
   cct->get_admin_socket()->unregister_command("dump_historic_ops");
+  cct->get_admin_socket()->unregister_command("dump_op_latency");
   cct->get_admin_socket()->unregister_command("dump_op_pq_state");
   cct->get_admin_socket()->unregister_command("dump_blacklist");
   cct->get_admin_socket()->unregister_command("dump_watchers");
@@ -2467,49 +2584,40 @@ int OSD::read_superblock()
   return 0;
 }
 
-void OSD::clear_temp_objects()
+void OSD::clear_temp_objects(const coll_t& coll)
 {
-  dout(10) << __func__ << dendl;
-  vector<coll_t> ls;
-  store->list_collections(ls);
-  for (vector<coll_t>::iterator p = ls.begin(); p != ls.end(); ++p) {
-    spg_t pgid;
-    if (!p->is_pg(&pgid))
-      continue;
+  // list temp objects
+  dout(20) << __func__ << " clearing temps in " << coll << dendl;
 
-    // list temp objects
-    dout(20) << " clearing temps in " << *p << " pgid " << pgid << dendl;
-
-    vector<ghobject_t> temps;
-    ghobject_t next;
-    while (1) {
-      vector<ghobject_t> objects;
-      store->collection_list(*p, next, ghobject_t::get_max(), true,
-			     store->get_ideal_list_max(),
-			     &objects, &next);
-      if (objects.empty())
+  vector<ghobject_t> temps;
+  ghobject_t next;
+  while (1) {
+    vector<ghobject_t> objects;
+    store->collection_list(coll, next, ghobject_t::get_max(), true,
+			   store->get_ideal_list_max(),
+			   &objects, &next);
+    if (objects.empty())
+      break;
+    vector<ghobject_t>::iterator q;
+    for (q = objects.begin(); q != objects.end(); ++q) {
+      if (q->hobj.is_temp()) {
+	temps.push_back(*q);
+      } else {
 	break;
-      vector<ghobject_t>::iterator q;
-      for (q = objects.begin(); q != objects.end(); ++q) {
-	if (q->hobj.is_temp()) {
-	  temps.push_back(*q);
-	} else {
-	  break;
-	}
       }
-      // If we saw a non-temp object and hit the break above we can
-      // break out of the while loop too.
-      if (q != objects.end())
-	break;
     }
-    if (!temps.empty()) {
-      ObjectStore::Transaction t;
-      for (vector<ghobject_t>::iterator q = temps.begin(); q != temps.end(); ++q) {
-	dout(20) << "  removing " << *p << " object " << *q << dendl;
-	t.remove(*p, *q);
-      }
-      store->apply_transaction(t);
+    // If we saw a non-temp object and hit the break above we can
+    // break out of the while loop too.
+    if (q != objects.end())
+      break;
+  }
+  if (!temps.empty()) {
+    ObjectStore::Transaction t;
+    for (vector<ghobject_t>::iterator q = temps.begin(); q != temps.end(); ++q) {
+      dout(20) << "  removing " << coll << " object " << *q << dendl;
+      t.remove(coll, *q);
     }
+    store->apply_transaction(t);
   }
 }
 
@@ -2839,84 +2947,31 @@ void OSD::load_pgs()
     dout(10) << "load_pgs ignoring unrecognized " << *it << dendl;
   }
 
-  bool has_upgraded = false;
-  for (set<spg_t>::iterator i = pgs.begin(); i != pgs.end(); ++i) {
-    spg_t pgid(*i);
-
-    if (pgid.preferred() >= 0) {
-      dout(10) << __func__ << ": skipping localized PG " << pgid << dendl;
-      // FIXME: delete it too, eventually
-      continue;
-    }
-
-    dout(10) << "pgid " << pgid << " coll " << coll_t(pgid) << dendl;
-    bufferlist bl;
-    epoch_t map_epoch = PG::peek_map_epoch(store, pgid, &bl);
-
-    PG *pg = NULL;
-    if (map_epoch > 0) {
-      OSDMapRef pgosdmap = service.try_get_map(map_epoch);
-      if (!pgosdmap) {
-	if (!osdmap->have_pg_pool(pgid.pool())) {
-	  derr << __func__ << ": could not find map for epoch " << map_epoch
-	       << " on pg " << pgid << ", but the pool is not present in the "
-	       << "current map, so this is probably a result of bug 10617.  "
-	       << "Skipping the pg for now, you can use ceph_objectstore_tool "
-	       << "to clean it up later." << dendl;
-	  continue;
-	} else {
-	  derr << __func__ << ": have pgid " << pgid << " at epoch "
-	       << map_epoch << ", but missing map.  Crashing."
-	       << dendl;
-	  assert(0 == "Missing map in load_pgs");
-	}
-      }
-      pg = _open_lock_pg(pgosdmap, pgid);
-    } else {
-      pg = _open_lock_pg(osdmap, pgid);
-    }
-    // there can be no waiters here, so we don't call wake_pg_waiters
-
-    // read pg state, log
-    pg->read_state(store, bl);
-
-    if (pg->must_upgrade()) {
-      if (!pg->can_upgrade()) {
-	derr << "PG needs upgrade, but on-disk data is too old; upgrade to"
-	     << " an older version first." << dendl;
-	assert(0 == "PG too old to upgrade");
-      }
-      if (!has_upgraded) {
-	derr << "PGs are upgrading" << dendl;
-	has_upgraded = true;
-      }
-      dout(10) << "PG " << pg->info.pgid
-	       << " must upgrade..." << dendl;
-      pg->upgrade(store);
+  atomic_t has_upgraded;
+  vector<spg_t> pgids(pgs.begin(), pgs.end());
+  int nthreads = MIN((int)pgids.size(),
+		     MAX(1, cct->_conf->osd_load_pgs_threads));
+  if (nthreads > 1) {
+    // the pgs live in independent collections; fan the load out so a
+    // restart isn't serialized on one pg log read at a time
+    dout(1) << __func__ << " loading " << pgids.size() << " pgs with "
+	    << nthreads << " threads" << dendl;
+    atomic_t next;
+    list<PGLoaderThread*> threads;
+    for (int i = 0; i < nthreads; ++i) {
+      PGLoaderThread *t = new PGLoaderThread(this, &pgids, &next,
+					     &has_upgraded);
+      t->create();
+      threads.push_back(t);
+    }
+    while (!threads.empty()) {
+      threads.front()->join();
+      delete threads.front();
+      threads.pop_front();
     }
-
-    service.init_splits_between(pg->info.pgid, pg->get_osdmap(), osdmap);
-
-    // generate state for PG's current mapping
-    int primary, up_primary;
-    vector<int> acting, up;
-    pg->get_osdmap()->pg_to_up_acting_osds(
-      pgid.pgid, &up, &up_primary, &acting, &primary);
-    pg->init_primary_up_acting(
-      up,
-      acting,
-      up_primary,
-      primary);
-    int role = OSDMap::calc_pg_role(whoami, pg->acting);
-    pg->set_role(role);
-
-    pg->reg_next_scrub();
-
-    PG::RecoveryCtx rctx(0, 0, 0, 0, 0, 0);
-    pg->handle_loaded(&rctx);
-
-    dout(10) << "load_pgs loaded " << *pg << " " << pg->pg_log.get_log() << dendl;
-    pg->unlock();
+  } else {
+    for (vector<spg_t>::iterator i = pgids.begin(); i != pgids.end(); ++i)
+      load_pg(*i, &has_upgraded);
   }
   {
     RWLock::RLocker l(pg_map_lock);
@@ -2924,7 +2979,8 @@ void OSD::load_pgs()
   }
 
   // clean up old infos object?
-  if (has_upgraded && store->exists(coll_t::meta(), OSD::make_infos_oid())) {
+  if (has_upgraded.read() &&
+      store->exists(coll_t::meta(), OSD::make_infos_oid())) {
     dout(1) << __func__ << " removing legacy infos object" << dendl;
     ObjectStore::Transaction t;
     t.remove(coll_t::meta(), OSD::make_infos_oid());
@@ -2935,10 +2991,100 @@ void OSD::load_pgs()
       assert(0);
     }
   }
-  
+
   build_past_intervals_parallel();
 }
 
+void *OSD::PGLoaderThread::entry()
+{
+  while (true) {
+    size_t i = next->inc() - 1;
+    if (i >= pgids->size())
+      break;
+    osd->load_pg((*pgids)[i], has_upgraded);
+  }
+  return 0;
+}
+
+void OSD::load_pg(spg_t pgid, atomic_t *has_upgraded)
+{
+  // clear out any temp objects left over from an interrupted recovery
+  clear_temp_objects(coll_t(pgid));
+
+  if (pgid.preferred() >= 0) {
+    dout(10) << __func__ << ": skipping localized PG " << pgid << dendl;
+    // FIXME: delete it too, eventually
+    return;
+  }
+
+  dout(10) << "pgid " << pgid << " coll " << coll_t(pgid) << dendl;
+  bufferlist bl;
+  epoch_t map_epoch = PG::peek_map_epoch(store, pgid, &bl);
+
+  PG *pg = NULL;
+  if (map_epoch > 0) {
+    OSDMapRef pgosdmap = service.try_get_map(map_epoch);
+    if (!pgosdmap) {
+      if (!osdmap->have_pg_pool(pgid.pool())) {
+	derr << __func__ << ": could not find map for epoch " << map_epoch
+	     << " on pg " << pgid << ", but the pool is not present in the "
+	     << "current map, so this is probably a result of bug 10617.  "
+	     << "Skipping the pg for now, you can use ceph_objectstore_tool "
+	     << "to clean it up later." << dendl;
+	return;
+      } else {
+	derr << __func__ << ": have pgid " << pgid << " at epoch "
+	     << map_epoch << ", but missing map.  Crashing."
+	     << dendl;
+	assert(0 == "Missing map in load_pgs");
+      }
+    }
+    pg = _open_lock_pg(pgosdmap, pgid);
+  } else {
+    pg = _open_lock_pg(osdmap, pgid);
+  }
+  // there can be no waiters here, so we don't call wake_pg_waiters
+
+  // read pg state, log
+  pg->read_state(store, bl);
+
+  if (pg->must_upgrade()) {
+    if (!pg->can_upgrade()) {
+      derr << "PG needs upgrade, but on-disk data is too old; upgrade to"
+	   << " an older version first." << dendl;
+      assert(0 == "PG too old to upgrade");
+    }
+    if (has_upgraded->inc() == 1)
+      derr << "PGs are upgrading" << dendl;
+    dout(10) << "PG " << pg->info.pgid
+	     << " must upgrade..." << dendl;
+    pg->upgrade(store);
+  }
+
+  service.init_splits_between(pg->info.pgid, pg->get_osdmap(), osdmap);
+
+  // generate state for PG's current mapping
+  int primary, up_primary;
+  vector<int> acting, up;
+  pg->get_osdmap()->pg_to_up_acting_osds(
+    pgid.pgid, &up, &up_primary, &acting, &primary);
+  pg->init_primary_up_acting(
+    up,
+    acting,
+    up_primary,
+    primary);
+  int role = OSDMap::calc_pg_role(whoami, pg->acting);
+  pg->set_role(role);
+
+  pg->reg_next_scrub();
+
+  PG::RecoveryCtx rctx(0, 0, 0, 0, 0, 0);
+  pg->handle_loaded(&rctx);
+
+  dout(10) << "load_pgs loaded " << *pg << " " << pg->pg_log.get_log() << dendl;
+  pg->unlock();
+}
+
 
 /*
  * build past_intervals efficiently on old, degraded, and buried
@@ -3717,6 +3863,9 @@ void OSD::handle_osd_ping(MOSDPing *m)
 		   << " last_rx_back " << i->second.last_rx_back << " -> " << m->stamp
 		   << " last_rx_front " << i->second.last_rx_front
 		   << dendl;
+	  if (i->second.last_rx_back != utime_t() &&
+	      m->stamp > i->second.last_rx_back)
+	    i->second.note_rx_interval(m->stamp - i->second.last_rx_back);
 	  i->second.last_rx_back = m->stamp;
 	  // if there is no front con, set both stamps.
 	  if (i->second.con_front == NULL)
@@ -3744,7 +3893,7 @@ void OSD::handle_osd_ping(MOSDPing *m)
       }
 
       utime_t cutoff = ceph_clock_now(cct);
-      cutoff -= cct->_conf->osd_heartbeat_grace;
+      cutoff -= i->second.adjusted_grace(cct);
       if (i->second.is_healthy(cutoff)) {
 	// Cancel false reports
 	if (failure_queue.count(from)) {
@@ -3801,16 +3950,19 @@ void OSD::heartbeat_check()
   }
 
   // check for incoming heartbeats (move me elsewhere?)
-  utime_t cutoff = now;
-  cutoff -= cct->_conf->osd_heartbeat_grace;
   for (map<int,HeartbeatInfo>::iterator p = heartbeat_peers.begin();
        p != heartbeat_peers.end();
        ++p) {
+    // grace is per peer: the floor is osd_heartbeat_grace, widened by
+    // the reply interval distribution we have observed from this peer
+    utime_t cutoff = now;
+    cutoff -= p->second.adjusted_grace(cct);
     dout(25) << "heartbeat_check osd." << p->first
 	     << " first_tx " << p->second.first_tx
 	     << " last_tx " << p->second.last_tx
 	     << " last_rx_back " << p->second.last_rx_back
 	     << " last_rx_front " << p->second.last_rx_front
+	     << " cutoff " << cutoff
 	     << dendl;
     if (p->second.is_unhealthy(cutoff)) {
       if (p->second.last_rx_back == utime_t() ||
@@ -3951,6 +4103,8 @@ void OSD::tick()
   dout(5) << "tick" << dendl;
 
   logger->set(l_osd_buf, buffer::get_total_alloc());
+  logger->set(l_osd_buf_hugepage, buffer::get_hugepage_pool_inuse());
+  logger->set(l_osd_buf_hugepage_total, buffer::get_hugepage_pool_total());
 
   if (is_active() || is_waiting_for_healthy()) {
     map_lock.get_read();
@@ -4659,6 +4813,10 @@ void OSD::send_pg_stats(const utime_t &now)
     m->set_tid(++pg_stat_tid);
     m->osd_stat = cur_stat;
 
+    // Take refs on the queued pgs under the queue lock, but copy the
+    // (large) pg_stat_t values only after dropping it so that op threads
+    // publishing fresh stats don't stall behind the walk.
+    list<PG*> to_send;
     xlist<PG*>::iterator p = pg_stat_queue.begin();
     while (!p.end()) {
       PG *pg = *p;
@@ -4668,6 +4826,18 @@ void OSD::send_pg_stats(const utime_t &now)
 	pg->put("pg_stat_queue");
 	continue;
       }
+      pg->get("pg_stat_queue_send");
+      to_send.push_back(pg);
+    }
+
+    if (!outstanding_pg_stats) {
+      outstanding_pg_stats = true;
+      last_pg_stats_ack = ceph_clock_now(cct);
+    }
+    pg_stat_queue_lock.Unlock();
+
+    for (list<PG*>::iterator q = to_send.begin(); q != to_send.end(); ++q) {
+      PG *pg = *q;
       pg->pg_stats_publish_lock.Lock();
       if (pg->pg_stats_publish_valid) {
 	m->pg_stat[pg->info.pgid.pgid] = pg->pg_stats_publish;
@@ -4678,16 +4848,13 @@ void OSD::send_pg_stats(const utime_t &now)
 		 << pg->pg_stats_publish.reported_seq << ", not valid" << dendl;
       }
       pg->pg_stats_publish_lock.Unlock();
+      pg->put("pg_stat_queue_send");
     }
 
-    if (!outstanding_pg_stats) {
-      outstanding_pg_stats = true;
-      last_pg_stats_ack = ceph_clock_now(cct);
-    }
     monc->send_mon_message(m);
+  } else {
+    pg_stat_queue_lock.Unlock();
   }
-
-  pg_stat_queue_lock.Unlock();
 }
 
 void OSD::handle_pg_stats_ack(MPGStatsAck *ack)
@@ -4830,8 +4997,13 @@ COMMAND("pg " \
 	"name=offset,type=CephString,req=false",
 	"list missing objects on this pg, perhaps starting at an offset given in JSON",
 	"osd", "r", "cli")
+COMMAND("pg " \
+	"name=pgid,type=CephPgid " \
+	"name=cmd,type=CephChoices,strings=dump_temperature", \
+	"dump sampled object access frequency histogram for this pg",
+	"osd", "r", "cli")
 
-// new form: tell <pgid> <cmd> for both cli and rest 
+// new form: tell <pgid> <cmd> for both cli and rest
 
 COMMAND("query",
 	"show details of a specific pg", "osd", "r", "cli,rest")
@@ -4843,6 +5015,9 @@ COMMAND("list_missing " \
 	"name=offset,type=CephString,req=false",
 	"list missing objects on this pg, perhaps starting at an offset given in JSON",
 	"osd", "r", "cli,rest")
+COMMAND("dump_temperature",
+	"dump sampled object access frequency histogram for this pg",
+	"osd", "r", "cli,rest")
 
 // tell <osd.n> commands.  Validation of osd.n must be special-cased in client
 COMMAND("version", "report version of OSD", "osd", "r", "cli,rest")
@@ -4956,9 +5131,7 @@ void OSD::do_command(Connection *con, ceph_tid_t tid, vector<string>& cmd, buffe
     string args = argsvec.front();
     for (vector<string>::iterator a = ++argsvec.begin(); a != argsvec.end(); ++a)
       args += " " + *a;
-    osd_lock.Unlock();
     cct->_conf->injectargs(args, &ss);
-    osd_lock.Lock();
   }
   else if (prefix == "cluster_log") {
     vector<string> msg;
@@ -4989,7 +5162,8 @@ void OSD::do_command(Connection *con, ceph_tid_t tid, vector<string>& cmd, buffe
 	   (cmd_getval(cct, cmdmap, "pgid", pgidstr) &&
 	     (prefix == "query" ||
 	      prefix == "mark_unfound_lost" ||
-	      prefix == "list_missing")
+	      prefix == "list_missing" ||
+	      prefix == "dump_temperature")
 	   )) {
     pg_t pgid;
 
@@ -5001,7 +5175,10 @@ void OSD::do_command(Connection *con, ceph_tid_t tid, vector<string>& cmd, buffe
       r = -EINVAL;
     } else {
       spg_t pcand;
-      if (osdmap->get_primary_shard(pgid, &pcand) &&
+      // work against the published map; pg lookup is covered by
+      // pg_map_lock and the command itself by the pg lock alone
+      OSDMapRef curmap = service.get_osdmap();
+      if (curmap->get_primary_shard(pgid, &pcand) &&
 	  _have_pg(pcand)) {
 	PG *pg = _lookup_lock_pg(pcand);
 	assert(pg);
@@ -5015,7 +5192,7 @@ void OSD::do_command(Connection *con, ceph_tid_t tid, vector<string>& cmd, buffe
 
 	  // send them the latest diff to ensure they realize the mapping
 	  // has changed.
-	  service.send_incremental_map(osdmap->get_epoch() - 1, con, osdmap);
+	  service.send_incremental_map(curmap->get_epoch() - 1, con, curmap);
 
 	  // do not reply; they will get newer maps and realize they
 	  // need to resend.
@@ -5179,6 +5356,7 @@ void OSD::do_command(Connection *con, ceph_tid_t tid, vector<string>& cmd, buffe
   }
 
   else if (prefix == "flush_pg_stats") {
+    Mutex::Locker l(osd_lock);
     flush_pg_stats();
   }
   
@@ -5258,8 +5436,11 @@ void OSD::do_command(Connection *con, ceph_tid_t tid, vector<string>& cmd, buffe
     cct->_conf->apply_changes(NULL);
     ss << "kicking recovery queue. set osd_recovery_delay_start "
        << "to " << cct->_conf->osd_recovery_delay_start;
-    defer_recovery_until = ceph_clock_now(cct);
-    defer_recovery_until += cct->_conf->osd_recovery_delay_start;
+    {
+      Mutex::Locker l(osd_lock);
+      defer_recovery_until = ceph_clock_now(cct);
+      defer_recovery_until += cct->_conf->osd_recovery_delay_start;
+    }
     recovery_wq.wake();
   }
 
@@ -5589,7 +5770,10 @@ bool OSD::ms_verify_authorizer(Connection *con, int peer_type,
       else
 	dout(10) << " session " << s << " " << s->entity_name << " failed to parse caps '" << str << "'" << dendl;
     }
-    
+
+    // reconnects may arrive with different caps
+    s->invalidate_cap_cache();
+
     s->put();
   }
   return true;
@@ -5821,6 +6005,10 @@ void OSD::_dispatch(Message *m)
     handle_scrub(static_cast<MOSDScrub*>(m));
     break;
 
+  case MSG_OSD_WATCH_PING:
+    handle_watch_ping(static_cast<MWatchPing*>(m));
+    break;
+
     // -- need OSDMap --
 
   default:
@@ -5897,6 +6085,27 @@ void OSD::handle_scrub(MOSDScrub *m)
   m->put();
 }
 
+void OSD::handle_watch_ping(MWatchPing *m)
+{
+  dout(10) << "handle_watch_ping " << *m << dendl;
+  if (m->reply) {
+    // we only serve pings; replies go to clients
+    m->put();
+    return;
+  }
+  Session *session = static_cast<Session*>(m->get_connection()->get_priv());
+  if (!session) {
+    m->put();
+    return;
+  }
+  MWatchPing *reply = new MWatchPing(true, m->stamp);
+  reply->watches = m->watches;
+  session->wstate.ping(m->watches, ceph_clock_now(cct), &reply->results);
+  session->put();
+  m->get_connection()->send_message(reply);
+  m->put();
+}
+
 bool OSD::scrub_random_backoff()
 {
   bool coin_flip = (rand() % 3) == whoami % 3;
@@ -5907,17 +6116,32 @@ bool OSD::scrub_random_backoff()
   return false;
 }
 
-OSDService::ScrubJob::ScrubJob(const spg_t& pg, const utime_t& timestamp, bool must)
+OSDService::ScrubJob::ScrubJob(const spg_t& pg, const utime_t& timestamp,
+			       uint64_t pg_bytes, bool must)
   : pgid(pg),
     sched_time(timestamp),
     deadline(timestamp)
 {
-  // if not explicitly requested, postpone the scrub with a random delay
+  // if not explicitly requested, postpone the scrub into the interval
   if (!must) {
     sched_time += g_conf->osd_scrub_min_interval;
-    if (g_conf->osd_scrub_interval_randomize_ratio > 0) {
-      sched_time += rand() % (int)(g_conf->osd_scrub_min_interval *
-				   g_conf->osd_scrub_interval_randomize_ratio);
+    double spread = g_conf->osd_scrub_min_interval *
+      g_conf->osd_scrub_interval_randomize_ratio;
+    if (spread > 0) {
+      // place the pg at a stable, hashed spot in the window instead of
+      // re-rolling rand() on every registration: the population stays
+      // uniformly spread over the interval even when all the
+      // last-scrub stamps cluster together (fresh deployment, mass
+      // restart), which is what turned weekly scrubs into herds
+      uint32_t v[2] = { (uint32_t)pg.pgid.pool(), pg.pgid.ps() };
+      uint32_t h = ceph_str_hash_rjenkins((const char *)v, sizeof(v));
+      double offset = spread * ((double)h / (double)0xffffffffu);
+      // bigger pgs scrub longer; pull them toward the front of the
+      // window so they still finish inside the deadline
+      if (pg_bytes && g_conf->osd_scrub_rate_estimate > 0)
+	offset -= (double)pg_bytes / g_conf->osd_scrub_rate_estimate;
+      if (offset > 0)
+	sched_time += offset;
     }
     deadline += g_conf->osd_scrub_max_interval;
   }
@@ -7988,19 +8212,6 @@ void OSD::handle_op(OpRequestRef& op, OSDMapRef& osdmap)
     return;
   }
 
-  // we don't need encoded payload anymore
-  m->clear_payload();
-
-  // object name too long?
-  unsigned max_name_len = MIN(g_conf->osd_max_object_name_len,
-			      store->get_max_object_name_length());
-  if (m->get_oid().name.size() > max_name_len) {
-    dout(4) << "handle_op '" << m->get_oid().name << "' is longer than "
-	    << max_name_len << " bytes" << dendl;
-    service.reply_op_error(op, -ENAMETOOLONG);
-    return;
-  }
-
   // blacklisted?
   if (osdmap->is_blacklisted(m->get_source_addr())) {
     dout(4) << "handle_op " << m->get_source_addr() << " is blacklisted" << dendl;
@@ -8023,14 +8234,6 @@ void OSD::handle_op(OpRequestRef& op, OSDMapRef& osdmap)
     client_session->put();
   }
 
-  if (op->rmw_flags == 0) {
-    int r = init_op_flags(op);
-    if (r) {
-      service.reply_op_error(op, r);
-      return;
-    }
-  }
-
   if (cct->_conf->osd_debug_drop_op_probability > 0 &&
       !m->get_source().is_mds()) {
     if ((double)rand() / (double)RAND_MAX < cct->_conf->osd_debug_drop_op_probability) {
@@ -8039,35 +8242,6 @@ void OSD::handle_op(OpRequestRef& op, OSDMapRef& osdmap)
     }
   }
 
-  if (op->may_write()) {
-    // full?
-    if ((service.check_failsafe_full() ||
-	 osdmap->test_flag(CEPH_OSDMAP_FULL) ||
-	 m->get_map_epoch() < superblock.last_map_marked_full) &&
-	!m->get_source().is_mds()) {  // FIXME: we'll exclude mds writes for now.
-      // Drop the request, since the client will retry when the full
-      // flag is unset.
-      return;
-    }
-
-    // invalid?
-    if (m->get_snapid() != CEPH_NOSNAP) {
-      service.reply_op_error(op, -EINVAL);
-      return;
-    }
-
-    // too big?
-    if (cct->_conf->osd_max_write_size &&
-	m->get_data_len() > cct->_conf->osd_max_write_size << 20) {
-      // journal can't hold commit!
-      derr << "handle_op msg data len " << m->get_data_len()
-	   << " > osd_max_write_size " << (cct->_conf->osd_max_write_size << 20)
-	   << " on " << *m << dendl;
-      service.reply_op_error(op, -OSD_WRITETOOBIG);
-      return;
-    }
-  }
-
   // calc actual pgid
   pg_t _pgid = m->get_pg();
   int64_t pool = _pgid.pool();
@@ -8130,6 +8304,68 @@ void OSD::handle_op(OpRequestRef& op, OSDMapRef& osdmap)
   }
 }
 
+bool OSD::finish_op_decode(OpRequestRef& op)
+{
+  MOSDOp *m = static_cast<MOSDOp*>(op->get_req());
+  assert(m->get_type() == CEPH_MSG_OSD_OP);
+
+  if (m->finish_decode()) {
+    // we don't need encoded payload anymore
+    m->clear_payload();
+  }
+
+  // object name too long?
+  unsigned max_name_len = MIN(g_conf->osd_max_object_name_len,
+			      store->get_max_object_name_length());
+  if (m->get_oid().name.size() > max_name_len) {
+    dout(4) << __func__ << " '" << m->get_oid().name << "' is longer than "
+	    << max_name_len << " bytes" << dendl;
+    service.reply_op_error(op, -ENAMETOOLONG);
+    return false;
+  }
+
+  if (op->rmw_flags == 0) {
+    int r = init_op_flags(op);
+    if (r) {
+      service.reply_op_error(op, r);
+      return false;
+    }
+  }
+
+  if (op->may_write()) {
+    OSDMapRef next_map = service.get_osdmap();
+
+    // full?
+    if ((service.check_failsafe_full() ||
+	 next_map->test_flag(CEPH_OSDMAP_FULL) ||
+	 m->get_map_epoch() < superblock.last_map_marked_full) &&
+	!m->get_source().is_mds()) {  // FIXME: we'll exclude mds writes for now.
+      // Drop the request, since the client will retry when the full
+      // flag is unset.
+      return false;
+    }
+
+    // invalid?
+    if (m->get_snapid() != CEPH_NOSNAP) {
+      service.reply_op_error(op, -EINVAL);
+      return false;
+    }
+
+    // too big?
+    if (cct->_conf->osd_max_write_size &&
+	m->get_data_len() > cct->_conf->osd_max_write_size << 20) {
+      // journal can't hold commit!
+      derr << __func__ << " msg data len " << m->get_data_len()
+	   << " > osd_max_write_size " << (cct->_conf->osd_max_write_size << 20)
+	   << " on " << *m << dendl;
+      service.reply_op_error(op, -OSD_WRITETOOBIG);
+      return false;
+    }
+  }
+
+  return true;
+}
+
 template<typename T, int MSGTYPE>
 void OSD::handle_replica_op(OpRequestRef& op, OSDMapRef& osdmap)
 {
@@ -8206,20 +8442,28 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb )
   ShardData* sdata = shard_list[shard_index];
   assert(NULL != sdata);
   sdata->sdata_op_ordering_lock.Lock();
-  if (sdata->pqueue.empty()) {
+  sdata->drain_staging();
+  if (sdata->pqueue->empty()) {
     sdata->sdata_op_ordering_lock.Unlock();
     osd->cct->get_heartbeat_map()->reset_timeout(hb, 4, 0);
     sdata->sdata_lock.Lock();
-    sdata->sdata_cond.WaitInterval(osd->cct, sdata->sdata_lock, utime_t(2, 0));
+    // announce ourselves before the final staging check; producers only
+    // signal when they see a waiter
+    sdata->sdata_waiters.inc();
+    if (sdata->staging_empty())
+      sdata->sdata_cond.WaitInterval(osd->cct, sdata->sdata_lock, utime_t(2, 0));
+    sdata->sdata_waiters.dec();
     sdata->sdata_lock.Unlock();
     sdata->sdata_op_ordering_lock.Lock();
-    if(sdata->pqueue.empty()) {
+    sdata->drain_staging();
+    if(sdata->pqueue->empty()) {
       sdata->sdata_op_ordering_lock.Unlock();
       return;
     }
   }
-  pair<PGRef, PGQueueable> item = sdata->pqueue.dequeue();
+  pair<PGRef, PGQueueable> item = sdata->pqueue->dequeue();
   sdata->pg_for_processing[&*(item.first)].push_back(item.second);
+  sdata->sampled_depth.set(sdata->pqueue->length());
   sdata->sdata_op_ordering_lock.Unlock();
   ThreadPool::TPHandle tp_handle(osd->cct, hb, timeout_interval, 
     suicide_interval);
@@ -8284,23 +8528,20 @@ void OSD::ShardedOpWQ::_enqueue(pair<PGRef, PGQueueable> item) {
 
   ShardData* sdata = shard_list[shard_index];
   assert (NULL != sdata);
-  unsigned priority = item.second.get_priority();
-  unsigned cost = item.second.get_cost();
-  sdata->sdata_op_ordering_lock.Lock();
- 
-  if (priority >= CEPH_MSG_PRIO_LOW)
-    sdata->pqueue.enqueue_strict(
-      item.second.get_owner(), priority, item);
-  else
-    sdata->pqueue.enqueue(
-      item.second.get_owner(),
-      priority, cost, item);
-  sdata->sdata_op_ordering_lock.Unlock();
 
-  sdata->sdata_lock.Lock();
-  sdata->sdata_cond.SignalOne();
-  sdata->sdata_lock.Unlock();
+  // stage the item instead of taking the ordering lock; the shard's
+  // workers splice staged items into the pqueue
+  sdata->sdata_staging_lock.lock();
+  sdata->staging.push_back(item);
+  sdata->sdata_staging_lock.unlock();
 
+  // only pay for the wakeup handshake when a worker is actually parked;
+  // a racing worker that misses the signal is bounded by its 2s poll
+  if (sdata->sdata_waiters.read()) {
+    sdata->sdata_lock.Lock();
+    sdata->sdata_cond.SignalOne();
+    sdata->sdata_lock.Unlock();
+  }
 }
 
 void OSD::ShardedOpWQ::_enqueue_front(pair<PGRef, PGQueueable> item) {
@@ -8318,11 +8559,11 @@ void OSD::ShardedOpWQ::_enqueue_front(pair<PGRef, PGQueueable> item) {
   unsigned priority = item.second.get_priority();
   unsigned cost = item.second.get_cost();
   if (priority >= CEPH_MSG_PRIO_LOW)
-    sdata->pqueue.enqueue_strict_front(
+    sdata->pqueue->enqueue_strict_front(
       item.second.get_owner(),
       priority, item);
   else
-    sdata->pqueue.enqueue_front(
+    sdata->pqueue->enqueue_front(
       item.second.get_owner(),
       priority, cost, item);
 
@@ -8372,6 +8613,12 @@ void OSD::dequeue_op(
   if (pg->deleting)
     return;
 
+  // materialize the rest of a lazily decoded MOSDOp here, on the op
+  // shard thread, and run the checks that need the op vector
+  if (op->get_req()->get_type() == CEPH_MSG_OSD_OP &&
+      !finish_op_decode(op))
+    return;
+
   op->mark_reached_pg();
 
   pg->do_request(op, handle);
@@ -8471,6 +8718,9 @@ const char** OSD::get_tracked_conf_keys() const
   static const char* KEYS[] = {
     "osd_max_backfills",
     "osd_min_recovery_priority",
+    "osd_reserver_age_interval",
+    "osd_reserver_pool_shares",
+    "osd_reserver_pool_priority",
     "osd_op_complaint_time", "osd_op_log_threshold",
     "osd_op_history_size", "osd_op_history_duration",
     "osd_map_cache_size",
@@ -8478,6 +8728,16 @@ const char** OSD::get_tracked_conf_keys() const
     "osd_pg_epoch_persisted_max_stale",
     "osd_disk_thread_ioprio_class",
     "osd_disk_thread_ioprio_priority",
+    // op-path config snapshot
+    "osd_client_op_priority",
+    "osd_recovery_op_priority",
+    "osd_max_pgls",
+    "osd_max_object_size",
+    "osd_op_async_reads",
+    "osd_verify_sparse_read_holes",
+    "osd_read_eio_on_bad_digest",
+    "osd_debug_op_order",
+    "osd_hit_set_namespace",
     // clog & admin clog
     "clog_to_monitors",
     "clog_to_syslog",
@@ -8499,6 +8759,11 @@ void OSD::handle_conf_change(const struct md_config_t *conf,
     service.local_reserver.set_min_priority(cct->_conf->osd_min_recovery_priority);
     service.remote_reserver.set_min_priority(cct->_conf->osd_min_recovery_priority);
   }
+  if (changed.count("osd_reserver_age_interval") ||
+      changed.count("osd_reserver_pool_shares") ||
+      changed.count("osd_reserver_pool_priority")) {
+    update_reserver_config();
+  }
   if (changed.count("osd_op_complaint_time") ||
       changed.count("osd_op_log_threshold")) {
     op_tracker.set_complaint_and_threshold(cct->_conf->osd_op_complaint_time,
@@ -8518,6 +8783,17 @@ void OSD::handle_conf_change(const struct md_config_t *conf,
     service.map_bl_cache.set_size(cct->_conf->osd_map_cache_size);
     service.map_bl_inc_cache.set_size(cct->_conf->osd_map_cache_size);
   }
+  if (changed.count("osd_client_op_priority") ||
+      changed.count("osd_recovery_op_priority") ||
+      changed.count("osd_max_pgls") ||
+      changed.count("osd_max_object_size") ||
+      changed.count("osd_op_async_reads") ||
+      changed.count("osd_verify_sparse_read_holes") ||
+      changed.count("osd_read_eio_on_bad_digest") ||
+      changed.count("osd_debug_op_order") ||
+      changed.count("osd_hit_set_namespace")) {
+    service.refresh_op_path_conf();
+  }
   if (changed.count("clog_to_monitors") ||
       changed.count("clog_to_syslog") ||
       changed.count("clog_to_syslog_level") ||
@@ -8528,6 +8804,37 @@ void OSD::handle_conf_change(const struct md_config_t *conf,
   check_config();
 }
 
+// parse "poolid:value[,poolid:value]*" into a map; malformed entries
+// are skipped
+static void parse_pool_value_map(const string& s, map<uint64_t, unsigned> *out)
+{
+  out->clear();
+  list<string> items;
+  get_str_list(s, ",", items);
+  for (list<string>::iterator i = items.begin(); i != items.end(); ++i) {
+    size_t colon = i->find(':');
+    if (colon == string::npos)
+      continue;
+    string pool = i->substr(0, colon);
+    string value = i->substr(colon + 1);
+    if (pool.empty() || value.empty())
+      continue;
+    (*out)[strtoull(pool.c_str(), NULL, 10)] =
+      strtoul(value.c_str(), NULL, 10);
+  }
+}
+
+void OSD::update_reserver_config()
+{
+  map<uint64_t, unsigned> shares, bonuses;
+  parse_pool_value_map(cct->_conf->osd_reserver_pool_shares, &shares);
+  parse_pool_value_map(cct->_conf->osd_reserver_pool_priority, &bonuses);
+  service.local_reserver.set_group_config(shares, bonuses);
+  service.remote_reserver.set_group_config(shares, bonuses);
+  service.local_reserver.set_age_interval(cct->_conf->osd_reserver_age_interval);
+  service.remote_reserver.set_age_interval(cct->_conf->osd_reserver_age_interval);
+}
+
 void OSD::update_log_config()
 {
   map<string,string> log_to_monitors;
@@ -8590,6 +8897,16 @@ void OSD::get_latest_osdmap()
 
 // --------------------------------
 
+bool OSD::pool_requires_promote_for_overwrite(int64_t poolid)
+{
+  const pg_pool_t *pool = osdmap->get_pg_pool(poolid);
+  if (!pool || !pool->is_tier())
+    return false;
+  const pg_pool_t *base_pool = osdmap->get_pg_pool(pool->tier_of);
+  assert(base_pool);
+  return base_pool->is_erasure();
+}
+
 int OSD::init_op_flags(OpRequestRef& op)
 {
   MOSDOp *m = static_cast<MOSDOp*>(op->get_req());
@@ -8598,6 +8915,31 @@ int OSD::init_op_flags(OpRequestRef& op)
   // client flags have no bearing on whether an op is a read, write, etc.
   op->rmw_flags = 0;
 
+  // the common shapes were classified at decode time; no need to scan
+  // the op vector for them.  classification cannot see the osdmap, so
+  // the shapes containing WRITE (a partial overwrite, unlike WRITEFULL)
+  // still get the ec-tier promotion check here: proxying a partial
+  // overwrite to an erasure-coded base would fail it.
+  switch (m->get_op_shape()) {
+  case MOSDOp::SHAPE_SINGLE_READ:
+    op->set_read();
+    return 0;
+  case MOSDOp::SHAPE_SINGLE_WRITE:
+    op->set_write();
+    if (m->ops[0].op.op == CEPH_OSD_OP_WRITE &&
+	pool_requires_promote_for_overwrite(m->get_pg().pool()))
+      op->set_promote();
+    return 0;
+  case MOSDOp::SHAPE_WRITE_STAT:
+    op->set_write();
+    op->set_read();
+    if (pool_requires_promote_for_overwrite(m->get_pg().pool()))
+      op->set_promote();
+    return 0;
+  default:
+    break;
+  }
+
   // set bits based on op codes, called methods.
   for (iter = m->ops.begin(); iter != m->ops.end(); ++iter) {
     if (ceph_osd_op_mode_modify(iter->op.op))
@@ -8695,17 +9037,8 @@ int OSD::init_op_flags(OpRequestRef& op)
     case CEPH_OSD_OP_ZERO:
     case CEPH_OSD_OP_TRUNCATE:
       // always force promotion for object overwrites on a ec base pool
-      {
-        int64_t poolid = m->get_pg().pool();
-        const pg_pool_t *pool = osdmap->get_pg_pool(poolid);
-        if (pool->is_tier()) {
-          const pg_pool_t *base_pool = osdmap->get_pg_pool(pool->tier_of);
-          assert(base_pool);
-          if (base_pool->is_erasure()) {
-            op->set_promote();
-          }
-        }
-      }
+      if (pool_requires_promote_for_overwrite(m->get_pg().pool()))
+	op->set_promote();
       break;
 
     default:
@@ -53,6 +53,9 @@ using namespace std;
 #include "common/simple_cache.hpp"
 #include "common/sharedptr_registry.hpp"
 #include "common/PrioritizedQueue.h"
+#include "common/WeightedRoundRobinQueue.h"
+#include "common/MClockQueue.h"
+#include "include/Spinlock.h"
 #include "messages/MOSDOp.h"
 
 #define CEPH_OSD_PROTOCOL    10 /* cluster internal */
@@ -105,6 +108,8 @@ enum {
 
   l_osd_loadavg,
   l_osd_buf,
+  l_osd_buf_hugepage,
+  l_osd_buf_hugepage_total,
 
   l_osd_pg,
   l_osd_pg_primary,
@@ -116,6 +121,10 @@ enum {
   l_osd_mape,
   l_osd_mape_dup,
 
+  l_osd_peering_fastpath,
+  l_osd_peering_full,
+  l_osd_pg_log_merge_lat,
+
   l_osd_waiting_for_map,
 
   l_osd_stat_bytes,
@@ -198,6 +207,7 @@ class MLog;
 class MClass;
 class MOSDPGMissing;
 class Objecter;
+class AsyncCompressor;
 
 class Watch;
 class Notification;
@@ -333,16 +343,40 @@ struct PGSnapTrim {
 };
 
 class PGQueueable {
+public:
+  /// service classes for the mclock op queue (see osd_op_queue)
+  enum {
+    SCHED_CLASS_CLIENT = 0,
+    SCHED_CLASS_RECOVERY,
+    SCHED_CLASS_SCRUB,
+    SCHED_CLASS_SNAPTRIM,
+    SCHED_CLASS_MAX
+  };
+private:
   typedef boost::variant<
     OpRequestRef,
     PGSnapTrim,
     PGScrub
     > QVariant;
   QVariant qvariant;
-  int cost; 
+  int cost;
   unsigned priority;
   utime_t start_time;
   entity_inst_t owner;
+  unsigned sched_class;
+
+  static unsigned sched_class_of(const OpRequestRef& op) {
+    switch (op->get_req()->get_type()) {
+    case MSG_OSD_PG_PUSH:
+    case MSG_OSD_PG_PULL:
+    case MSG_OSD_PG_PUSH_REPLY:
+    case MSG_OSD_PG_SCAN:
+    case MSG_OSD_PG_BACKFILL:
+      return SCHED_CLASS_RECOVERY;
+    default:
+      return SCHED_CLASS_CLIENT;
+    }
+  }
   struct RunVis : public boost::static_visitor<> {
     OSD *osd;
     PGRef &pg;
@@ -358,18 +392,19 @@ public:
     : qvariant(op), cost(op->get_req()->get_cost()),
       priority(op->get_req()->get_priority()),
       start_time(op->get_req()->get_recv_stamp()),
-      owner(op->get_req()->get_source_inst())
+      owner(op->get_req()->get_source_inst()),
+      sched_class(sched_class_of(op))
     {}
   PGQueueable(
     const PGSnapTrim &op, int cost, unsigned priority, utime_t start_time,
     const entity_inst_t &owner)
     : qvariant(op), cost(cost), priority(priority), start_time(start_time),
-      owner(owner) {}
+      owner(owner), sched_class(SCHED_CLASS_SNAPTRIM) {}
   PGQueueable(
     const PGScrub &op, int cost, unsigned priority, utime_t start_time,
     const entity_inst_t &owner)
     : qvariant(op), cost(cost), priority(priority), start_time(start_time),
-      owner(owner) {}
+      owner(owner), sched_class(SCHED_CLASS_SCRUB) {}
   boost::optional<OpRequestRef> maybe_get_op() {
     OpRequestRef *op = boost::get<OpRequestRef>(&qvariant);
     return op ? *op : boost::optional<OpRequestRef>();
@@ -382,6 +417,7 @@ public:
   int get_cost() const { return cost; }
   utime_t get_start_time() const { return start_time; }
   entity_inst_t get_owner() const { return owner; }
+  unsigned get_scheduler_class() const { return sched_class; }
 };
 
 class OSDService {
@@ -566,20 +602,72 @@ public:
   void send_message_osd_cluster(Message *m, const ConnectionRef& con) {
     con->send_message(m);
   }
+  /// stamp an op reply with the current op queue depth (backpressure
+  /// hint for adaptive clients)
+  void stamp_op_queue_depth(Message *m);
   void send_message_osd_client(Message *m, Connection *con) {
+    if (m->get_type() == CEPH_MSG_OSD_OPREPLY)
+      stamp_op_queue_depth(m);
     con->send_message(m);
   }
   void send_message_osd_client(Message *m, const ConnectionRef& con) {
+    if (m->get_type() == CEPH_MSG_OSD_OPREPLY)
+      stamp_op_queue_depth(m);
     con->send_message(m);
   }
   entity_name_t get_cluster_msgr_name() {
     return cluster_messenger->get_myname();
   }
 
+  // -- op-path config snapshot --
+  /**
+   * frozen copy of the config options the client op path consults on
+   * every request.  direct g_conf member reads are lock free for PODs
+   * but racy for strings, and a multi-option injectargs can be seen
+   * half applied; refresh_op_path_conf() rebuilds a fresh snapshot
+   * (from the conf observer, so under the config lock) and publishes
+   * it with a pointer swap.  readers grab the pointer once and see a
+   * single consistent version without touching any lock.  retired
+   * snapshots are parked instead of freed - a reader may still hold
+   * one, config changes are rare and the struct is tiny.
+   */
+  struct OpPathConf {
+    uint64_t version;
+    unsigned client_op_priority;    ///< osd_client_op_priority
+    unsigned recovery_op_priority;  ///< osd_recovery_op_priority
+    uint64_t max_pgls;              ///< osd_max_pgls
+    uint64_t max_object_size;       ///< osd_max_object_size
+    bool op_async_reads;            ///< osd_op_async_reads
+    bool verify_sparse_read_holes;  ///< osd_verify_sparse_read_holes
+    bool read_eio_on_bad_digest;    ///< osd_read_eio_on_bad_digest
+    bool debug_op_order;            ///< osd_debug_op_order
+    string hit_set_namespace;       ///< osd_hit_set_namespace
+  };
+  atomic64_t op_path_conf_cur;      ///< current OpPathConf*
+  Mutex op_path_conf_lock;          ///< serializes refresh, not reads
+  list<OpPathConf*> op_path_conf_retired;
+  const OpPathConf *op_conf() {
+    return (const OpPathConf*)op_path_conf_cur.read();
+  }
+  void refresh_op_path_conf();
+
   // -- scrub scheduling --
   Mutex sched_scrub_lock;
   int scrubs_pending;
   int scrubs_active;
+
+  /// EWMA of client op latency in microseconds, fed by log_op_stats
+  /// and read by scrub to decide how hard it may lean on the disk.
+  /// updates race benignly: a lost sample only blurs the average.
+  atomic64_t recent_op_latency_us;
+  void observe_op_latency(const utime_t& lat) {
+    uint64_t us = lat.to_nsec() / 1000;
+    uint64_t avg = recent_op_latency_us.read();
+    recent_op_latency_us.set(avg - avg / 16 + us / 16);
+  }
+  uint64_t get_recent_op_latency_us() {
+    return recent_op_latency_us.read();
+  }
   struct ScrubJob {
     /// pg to be scrubbed
     spg_t pgid;
@@ -589,15 +677,16 @@ public:
     /// the hard upper bound of scrub time
     utime_t deadline;
     ScrubJob() {}
-    explicit ScrubJob(const spg_t& pg, const utime_t& timestamp, bool must = true);
+    explicit ScrubJob(const spg_t& pg, const utime_t& timestamp,
+		      uint64_t pg_bytes = 0, bool must = true);
     /// order the jobs by sched_time
     bool operator<(const ScrubJob& rhs) const;
   };
   set<ScrubJob> sched_scrub_pg;
 
   /// @returns the scrub_reg_stamp used for unregister the scrub job
-  utime_t reg_pg_scrub(spg_t pgid, utime_t t, bool must) {
-    ScrubJob scrub(pgid, t, must);
+  utime_t reg_pg_scrub(spg_t pgid, utime_t t, uint64_t pg_bytes, bool must) {
+    ScrubJob scrub(pgid, t, pg_bytes, must);
     Mutex::Locker l(sched_scrub_lock);
     sched_scrub_pg.insert(scrub);
     return scrub.sched_time;
@@ -750,11 +839,28 @@ public:
     flush_mode_high_count --;
   }
 
+  // -- promotion throttle --
+  Mutex promote_lock;
+  utime_t promote_window_start;   ///< start of the current 1s window
+  uint64_t promote_window_objects;
+  uint64_t promote_window_bytes;
+
+  /// true if starting another promotion now would exceed the configured rate
+  bool promote_throttle();
+  /// account the bytes a completed promotion actually copied
+  void promote_finish(uint64_t bytes);
 
   // -- Objecter, for teiring reads/writes from/to other OSDs --
   Objecter *objecter;
   Finisher objecter_finisher;
 
+  // -- transparent compression (pools with the compress flag) --
+  // one AsyncCompressor per (codec, level) in use; lazily created,
+  // always NULL unless async_compressor_enabled is set
+  Mutex compressor_lock;
+  map<pair<string,int>, AsyncCompressor*> compressors;
+  AsyncCompressor *get_compressor(const string &alg, int level);
+
 
   // -- Watch --
   Mutex watch_lock;
@@ -1027,6 +1133,7 @@ public:
   virtual void handle_conf_change(const struct md_config_t *conf,
 				  const std::set <std::string> &changed);
   void update_log_config();
+  void update_reserver_config();
   void check_config();
 
 protected:
@@ -1165,7 +1272,7 @@ private:
   void write_superblock(ObjectStore::Transaction& t);
   int read_superblock();
 
-  void clear_temp_objects();
+  void clear_temp_objects(const coll_t& coll);
 
   CompatSet osd_compat;
 
@@ -1276,14 +1383,29 @@ public:
     Mutex received_map_lock;
     epoch_t received_map_epoch; // largest epoch seen in MOSDMap from here
 
+    /// memoized OSDCap::is_capable() results, keyed by (pool, namespace)
+    /// with one checked/allowed bit per rwxc flag combination.  Only
+    /// populated while caps has no object name constraints; entries are
+    /// dropped when the map epoch moves (pool names/auids may change)
+    /// or when the caps are renegotiated.
+    Mutex cap_cache_lock;
+    epoch_t cap_cache_epoch;
+    map<pair<int64_t,string>, pair<uint16_t,uint16_t> > cap_cache;
+
     Session(CephContext *cct) :
       RefCountedObject(cct),
       auid(-1), con(0),
       session_dispatch_lock("Session::session_dispatch_lock"),
       sent_epoch_lock("Session::sent_epoch_lock"), last_sent_epoch(0),
-      received_map_lock("Session::received_map_lock"), received_map_epoch(0)
+      received_map_lock("Session::received_map_lock"), received_map_epoch(0),
+      cap_cache_lock("Session::cap_cache_lock"), cap_cache_epoch(0)
     {}
 
+    void invalidate_cap_cache() {
+      Mutex::Locker l(cap_cache_lock);
+      cap_cache.clear();
+      cap_cache_epoch = 0;
+    }
 
   };
   void update_waiting_for_pg(Session *session, OSDMapRef osdmap);
@@ -1458,6 +1580,37 @@ private:
     utime_t last_rx_back;   ///< last time we got a ping reply on the back side
     epoch_t epoch;      ///< most recent epoch we wanted this peer
 
+    // inter-arrival statistics of (back side) ping replies, for the
+    // adaptive grace below; zero-initialized by the map insert
+    uint64_t ping_samples;       ///< replies observed
+    double ping_interval_mean;   ///< running mean of reply intervals
+    double ping_interval_m2;     ///< sum of squared deviations (Welford)
+
+    void note_rx_interval(double interval) {
+      ++ping_samples;
+      double delta = interval - ping_interval_mean;
+      ping_interval_mean += delta / ping_samples;
+      ping_interval_m2 += delta * (interval - ping_interval_mean);
+    }
+
+    /**
+     * grace widened to cover the reply interval distribution we have
+     * actually been seeing from this peer (accrual-style), so a peer
+     * that is merely slow under recovery load is not declared dead.
+     * The configured grace remains the floor.
+     */
+    double adjusted_grace(CephContext *cct) const {
+      double grace = cct->_conf->osd_heartbeat_grace;
+      if (!cct->_conf->osd_heartbeat_use_adaptive_grace ||
+	  ping_samples <
+	    (uint64_t)cct->_conf->osd_heartbeat_adaptive_grace_min_samples)
+	return grace;
+      double stddev = sqrt(ping_interval_m2 / ping_samples);
+      double accrual = ping_interval_mean +
+	cct->_conf->osd_heartbeat_adaptive_grace_factor * stddev;
+      return MAX(grace, accrual);
+    }
+
     bool is_unhealthy(utime_t cutoff) {
       return
 	! ((last_rx_front > cutoff ||
@@ -1582,15 +1735,94 @@ private:
     struct ShardData {
       Mutex sdata_lock;
       Cond sdata_cond;
+      atomic_t sdata_waiters;  ///< threads blocked on sdata_cond
       Mutex sdata_op_ordering_lock;
+
+      /* Incoming ops land on a spinlock-guarded staging list so the
+       * producers (fast dispatch threads) never contend on
+       * sdata_op_ordering_lock with a running worker; the shard's
+       * workers splice it into the pqueue before dequeueing. */
+      Spinlock sdata_staging_lock;
+      list<pair<PGRef, PGQueueable> > staging;
+
       map<PG*, list<PGQueueable> > pg_for_processing;
-      PrioritizedQueue< pair<PGRef, PGQueueable>, entity_inst_t> pqueue;
+      /// implementation chosen by osd_op_queue
+      OpQueue< pair<PGRef, PGQueueable>, entity_inst_t> *pqueue;
+
+      /// pqueue length observed by the last worker pass; sampled
+      /// rather than exact so readers never take the ordering lock
+      atomic_t sampled_depth;
+
+      /// service class of an item, for the mclock queue
+      static unsigned get_item_class(const pair<PGRef, PGQueueable> &item) {
+	return item.second.get_scheduler_class();
+      }
+
       ShardData(
 	string lock_name, string ordering_lock,
-	uint64_t max_tok_per_prio, uint64_t min_cost)
+	CephContext *cct)
 	: sdata_lock(lock_name.c_str()),
-	  sdata_op_ordering_lock(ordering_lock.c_str()),
-	  pqueue(max_tok_per_prio, min_cost) {}
+	  sdata_op_ordering_lock(ordering_lock.c_str()) {
+	typedef MClockQueue< pair<PGRef, PGQueueable>, entity_inst_t> MClockQ;
+	const string& opqueue = cct->_conf->osd_op_queue;
+	if (opqueue == "mclock") {
+	  vector<MClockQ::ClassParams> params(PGQueueable::SCHED_CLASS_MAX);
+	  params[PGQueueable::SCHED_CLASS_CLIENT] = MClockQ::ClassParams(
+	    cct->_conf->osd_op_queue_mclock_client_res,
+	    cct->_conf->osd_op_queue_mclock_client_wgt,
+	    cct->_conf->osd_op_queue_mclock_client_lim);
+	  params[PGQueueable::SCHED_CLASS_RECOVERY] = MClockQ::ClassParams(
+	    cct->_conf->osd_op_queue_mclock_recov_res,
+	    cct->_conf->osd_op_queue_mclock_recov_wgt,
+	    cct->_conf->osd_op_queue_mclock_recov_lim);
+	  params[PGQueueable::SCHED_CLASS_SCRUB] = MClockQ::ClassParams(
+	    cct->_conf->osd_op_queue_mclock_scrub_res,
+	    cct->_conf->osd_op_queue_mclock_scrub_wgt,
+	    cct->_conf->osd_op_queue_mclock_scrub_lim);
+	  params[PGQueueable::SCHED_CLASS_SNAPTRIM] = MClockQ::ClassParams(
+	    cct->_conf->osd_op_queue_mclock_snap_res,
+	    cct->_conf->osd_op_queue_mclock_snap_wgt,
+	    cct->_conf->osd_op_queue_mclock_snap_lim);
+	  pqueue = new MClockQ(params, get_item_class);
+	} else if (opqueue == "wrr") {
+	  pqueue = new WeightedRoundRobinQueue< pair<PGRef, PGQueueable>, entity_inst_t>(
+	    cct->_conf->osd_op_pq_max_tokens_per_priority,
+	    cct->_conf->osd_op_pq_min_cost);
+	} else {
+	  pqueue = new PrioritizedQueue< pair<PGRef, PGQueueable>, entity_inst_t>(
+	    cct->_conf->osd_op_pq_max_tokens_per_priority,
+	    cct->_conf->osd_op_pq_min_cost);
+	}
+      }
+      ~ShardData() {
+	delete pqueue;
+      }
+
+      /// splice staged items into the pqueue; caller holds
+      /// sdata_op_ordering_lock
+      void drain_staging() {
+	list<pair<PGRef, PGQueueable> > ls;
+	sdata_staging_lock.lock();
+	ls.swap(staging);
+	sdata_staging_lock.unlock();
+	while (!ls.empty()) {
+	  pair<PGRef, PGQueueable> &item = ls.front();
+	  unsigned priority = item.second.get_priority();
+	  unsigned cost = item.second.get_cost();
+	  if (priority >= CEPH_MSG_PRIO_LOW)
+	    pqueue->enqueue_strict(
+	      item.second.get_owner(), priority, item);
+	  else
+	    pqueue->enqueue(
+	      item.second.get_owner(), priority, cost, item);
+	  ls.pop_front();
+	}
+      }
+
+      bool staging_empty() {
+	Spinlock::Locker l(sdata_staging_lock);
+	return staging.empty();
+      }
     };
     
     vector<ShardData*> shard_list;
@@ -1609,9 +1841,7 @@ private:
 	  order_lock, sizeof(order_lock), "%s.%d",
 	  "OSD:ShardedOpWQ:order:", i);
 	ShardData* one_shard = new ShardData(
-	  lock_name, order_lock,
-	  osd->cct->_conf->osd_op_pq_max_tokens_per_priority, 
-	  osd->cct->_conf->osd_op_pq_min_cost);
+	  lock_name, order_lock, osd->cct);
 	shard_list.push_back(one_shard);
       }
     }
@@ -1645,16 +1875,16 @@ private:
 	assert (NULL != sdata);
 	sdata->sdata_op_ordering_lock.Lock();
 	f->open_object_section(lock_name);
-	sdata->pqueue.dump(f);
+	sdata->pqueue->dump(f);
 	f->close_section();
 	sdata->sdata_op_ordering_lock.Unlock();
       }
     }
 
-    struct Pred {
+    struct Pred : public OpQueue< pair<PGRef, PGQueueable>, entity_inst_t>::Filter {
       PG *pg;
       Pred(PG *pg) : pg(pg) {}
-      bool operator()(const pair<PGRef, PGQueueable> &op) {
+      bool operator()(const pair<PGRef, PGQueueable> &op) const {
 	return op.first == pg;
       }
     };
@@ -1666,7 +1896,8 @@ private:
       sdata = shard_list[shard_index];
       assert(sdata != NULL);
       sdata->sdata_op_ordering_lock.Lock();
-      sdata->pqueue.remove_by_filter(Pred(pg));
+      sdata->drain_staging();
+      sdata->pqueue->remove_by_filter(Pred(pg));
       sdata->pg_for_processing.erase(pg);
       sdata->sdata_op_ordering_lock.Unlock();
     }
@@ -1680,7 +1911,8 @@ private:
       assert(dequeued);
       list<pair<PGRef, PGQueueable> > _dequeued;
       sdata->sdata_op_ordering_lock.Lock();
-      sdata->pqueue.remove_by_filter(Pred(pg), &_dequeued);
+      sdata->drain_staging();
+      sdata->pqueue->remove_by_filter(Pred(pg), &_dequeued);
       for (list<pair<PGRef, PGQueueable> >::iterator i = _dequeued.begin();
 	   i != _dequeued.end(); ++i) {
 	boost::optional<OpRequestRef> mop = i->second.maybe_get_op();
@@ -1703,11 +1935,19 @@ private:
     }
  
     bool is_shard_empty(uint32_t thread_index) {
-      uint32_t shard_index = thread_index % num_shards; 
+      uint32_t shard_index = thread_index % num_shards;
       ShardData* sdata = shard_list[shard_index];
       assert(NULL != sdata);
       Mutex::Locker l(sdata->sdata_op_ordering_lock);
-      return sdata->pqueue.empty();
+      return sdata->pqueue->empty() && sdata->staging_empty();
+    }
+
+    /// approximate queued item count, summed over the worker samples
+    unsigned get_sampled_depth() {
+      unsigned depth = 0;
+      for (uint32_t i = 0; i < num_shards; i++)
+	depth += shard_list[i]->sampled_depth.read();
+      return depth;
     }
   } op_shardedwq;
 
@@ -1890,6 +2130,16 @@ protected:
     PG::CephPeeringEvtRef evt);
   
   void load_pgs();
+  void load_pg(spg_t pgid, atomic_t *has_upgraded);
+  struct PGLoaderThread : public Thread {
+    OSD *osd;
+    const vector<spg_t> *pgids;
+    atomic_t *next;          ///< next index in pgids to claim
+    atomic_t *has_upgraded;
+    PGLoaderThread(OSD *o, const vector<spg_t> *p, atomic_t *n, atomic_t *u)
+      : osd(o), pgids(p), next(n), has_upgraded(u) {}
+    void *entry();
+  };
   void build_past_intervals_parallel();
 
   void calc_priors_during(
@@ -2124,14 +2374,15 @@ protected:
       return c;
     }
     void _process(Command *c) {
-      osd->osd_lock.Lock();
+      // run without osd_lock: commands work against the published
+      // osdmap and per-structure locks, and do_command takes osd_lock
+      // itself for the few subcommands that touch protected OSD state.
+      // a long pg query or bench thus no longer stalls dispatch/tick.
       if (osd->is_stopping()) {
-	osd->osd_lock.Unlock();
 	delete c;
 	return;
       }
       osd->do_command(c->con.get(), c->tid, c->cmd, c->indata);
-      osd->osd_lock.Unlock();
       delete c;
     }
     void _process(Command *c, ThreadPool::TPHandle &tp) {
@@ -2327,6 +2578,7 @@ private:
 			uuid_d& cluster_fsid, uuid_d& osd_fsid, int whoami);
 
   void handle_scrub(struct MOSDScrub *m);
+  void handle_watch_ping(class MWatchPing *m);
   void handle_osd_ping(class MOSDPing *m);
   void handle_op(OpRequestRef& op, OSDMapRef& osdmap);
 
@@ -2334,6 +2586,13 @@ private:
   void handle_replica_op(OpRequestRef& op, OSDMapRef& osdmap);
 
   int init_op_flags(OpRequestRef& op);
+  /// true if an object overwrite on this pool must be promoted because
+  /// it is a cache tier over an erasure-coded base
+  bool pool_requires_promote_for_overwrite(int64_t poolid);
+
+  /// finish lazy MOSDOp decode and run the checks that need the op
+  /// vector; returns false if the op was rejected or dropped
+  bool finish_op_decode(OpRequestRef& op);
 
 public:
   static int peek_meta(ObjectStore *store, string& magic,
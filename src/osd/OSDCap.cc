@@ -150,6 +150,16 @@ bool OSDCap::is_capable(const string& pool_name, const string& ns, int64_t pool_
   return false;
 }
 
+bool OSDCap::is_object_constrained() const
+{
+  for (vector<OSDCapGrant>::const_iterator p = grants.begin();
+       p != grants.end(); ++p) {
+    if (p->match.object_prefix.length())
+      return true;
+  }
+  return false;
+}
+
 
 // grammar
 namespace qi = boost::spirit::qi;
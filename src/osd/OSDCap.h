@@ -147,6 +147,14 @@ struct OSDCap {
   bool is_capable(const string& pool_name, const string& ns, int64_t pool_auid,
 		  const string& object, bool op_may_read, bool op_may_write,
 		  bool op_may_class_read, bool op_may_class_write) const;
+
+  /**
+   * check if any grant constrains the object name
+   *
+   * If not, is_capable() is independent of the object argument and its
+   * result can be memoized per (pool, namespace).
+   */
+  bool is_object_constrained() const;
 };
 
 static inline ostream& operator<<(ostream& out, const OSDCap& cap) 
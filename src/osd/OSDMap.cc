@@ -1444,6 +1444,7 @@ int OSDMap::apply_incremental(const Incremental &inc)
     bufferlist::iterator blp = bl.begin();
     crush.reset(new CrushWrapper);
     crush->decode(blp);
+    cached_crush_bl = inc.crush;
   }
 
   calc_num_osds();
@@ -1722,6 +1723,65 @@ void OSDMap::_pg_to_up_acting_osds(const pg_t& pg, vector<int> *up, int *up_prim
     *acting_primary = _acting_primary;
 }
 
+// don't let a pathological workload (e.g. listing every pg of a huge
+// cluster) grow the cache without bound; a wholesale clear is cheap
+// and the hot working set refills quickly.
+#define MAX_CACHED_PG_MAPPINGS  65536
+
+void OSDMap::pg_to_up_acting_osds(pg_t pg, vector<int> *up, int *up_primary,
+				  vector<int> *acting, int *acting_primary) const
+{
+  {
+    Mutex::Locker l(pg_mapping_cache->lock);
+    if (pg_mapping_cache->epoch == epoch) {
+      ceph::unordered_map<pg_t,pg_mapping_t>::const_iterator p =
+	pg_mapping_cache->mappings.find(pg);
+      if (p != pg_mapping_cache->mappings.end()) {
+	*up = p->second.up;
+	*up_primary = p->second.up_primary;
+	*acting = p->second.acting;
+	*acting_primary = p->second.acting_primary;
+	return;
+      }
+    }
+  }
+
+  // compute outside the lock; crush is the expensive part and other
+  // threads mapping different pgs shouldn't serialize behind it.
+  pg_mapping_t m;
+  _pg_to_up_acting_osds(pg, &m.up, &m.up_primary, &m.acting, &m.acting_primary);
+
+  {
+    Mutex::Locker l(pg_mapping_cache->lock);
+    if (pg_mapping_cache->epoch != epoch) {
+      // entries were computed against an older incarnation of this map
+      pg_mapping_cache->mappings.clear();
+      pg_mapping_cache->epoch = epoch;
+    } else if (pg_mapping_cache->mappings.size() >= MAX_CACHED_PG_MAPPINGS) {
+      pg_mapping_cache->mappings.clear();
+    }
+    pg_mapping_cache->mappings[pg] = m;
+  }
+
+  up->swap(m.up);
+  *up_primary = m.up_primary;
+  acting->swap(m.acting);
+  *acting_primary = m.acting_primary;
+}
+
+int OSDMap::pg_to_acting_osds(const pg_t& pg, vector<int> *acting,
+			      int *acting_primary) const
+{
+  // route through the cached variant; the internals compute the up set
+  // regardless, so this costs nothing on a miss and wins on a hit.
+  vector<int> up;
+  int up_primary, _acting_primary;
+  pg_to_up_acting_osds(pg, &up, &up_primary, acting, &_acting_primary);
+  if (acting_primary)
+    *acting_primary = _acting_primary;
+  return acting->size();
+}
+
 int OSDMap::calc_pg_rank(int osd, const vector<int>& acting, int nrep)
 {
   if (!nrep)
@@ -1813,9 +1873,9 @@ void OSDMap::encode_client_old(bufferlist& bl) const
   }
 
   // crush
-  bufferlist cbl;
-  crush->encode(cbl);
-  ::encode(cbl, bl);
+  if (!cached_crush_bl.length())
+    crush->encode(cached_crush_bl);
+  ::encode(cached_crush_bl, bl);
 }
 
 void OSDMap::encode_classic(bufferlist& bl, uint64_t features) const
@@ -1848,9 +1908,9 @@ void OSDMap::encode_classic(bufferlist& bl, uint64_t features) const
   ::encode(*pg_temp, bl);
 
   // crush
-  bufferlist cbl;
-  crush->encode(cbl);
-  ::encode(cbl, bl);
+  if (!cached_crush_bl.length())
+    crush->encode(cached_crush_bl);
+  ::encode(cached_crush_bl, bl);
 
   // extended
   __u16 ev = 10;
@@ -1916,9 +1976,9 @@ void OSDMap::encode(bufferlist& bl, uint64_t features) const
     }
 
     // crush
-    bufferlist cbl;
-    crush->encode(cbl);
-    ::encode(cbl, bl);
+    if (!cached_crush_bl.length())
+      crush->encode(cached_crush_bl);
+    ::encode(cached_crush_bl, bl);
     ::encode(erasure_code_profiles, bl);
     ENCODE_FINISH(bl); // client-usable data
   }
@@ -2043,6 +2103,7 @@ void OSDMap::decode_classic(bufferlist::iterator& p)
   ::decode(cbl, p);
   bufferlist::iterator cblp = cbl.begin();
   crush->decode(cblp);
+  cached_crush_bl = cbl;
 
   // extended
   __u16 ev = 0;
@@ -2142,6 +2203,7 @@ void OSDMap::decode(bufferlist::iterator& bl)
     ::decode(cbl, bl);
     bufferlist::iterator cblp = cbl.begin();
     crush->decode(cblp);
+    cached_crush_bl = cbl;
     if (struct_v >= 3) {
       ::decode(erasure_code_profiles, bl);
     } else {
@@ -2669,6 +2731,7 @@ int OSDMap::build_simple(CephContext *cct, epoch_t e, uuid_d &fsid,
   else
     r = build_simple_crush_map_from_conf(cct, *crush, &ss);
   assert(r == 0);
+  invalidate_cached_crush();
 
   int poolbase = get_max_osd() ? get_max_osd() : 1;
 
@@ -250,12 +250,39 @@ private:
   mutable bool crc_defined;
   mutable uint32_t crc;
 
+  /// encoding of the current crush map, so that re-encoding the map
+  /// after an incremental that did not touch crush can reuse the old
+  /// buffers instead of walking the whole hierarchy again
+  mutable bufferlist cached_crush_bl;
+
+  /**
+   * cache of computed pg -> up/acting mappings.  crush output for a pg
+   * only changes with the map itself, so an entry stays valid as long
+   * as it was computed against the current epoch; any mutation that
+   * bumps the epoch (apply_incremental, decode) implicitly flushes the
+   * cache, and deepish_copy_from gives the copy a fresh one.
+   */
+  struct pg_mapping_t {
+    vector<int> up, acting;
+    int up_primary, acting_primary;
+  };
+  struct pg_mapping_cache_t {
+    Mutex lock;
+    epoch_t epoch;    ///< epoch the cached entries were computed against
+    ceph::unordered_map<pg_t,pg_mapping_t> mappings;
+    pg_mapping_cache_t() : lock("OSDMap::pg_mapping_cache_t::lock"), epoch(0) {}
+  };
+  ceph::shared_ptr<pg_mapping_cache_t> pg_mapping_cache;
+
   void _calc_up_osd_features();
 
  public:
   bool have_crc() const { return crc_defined; }
   uint32_t get_crc() const { return crc; }
 
+  /// anyone who modifies *crush in place must drop the cached encoding
+  void invalidate_cached_crush() { cached_crush_bl.clear(); }
+
   ceph::shared_ptr<CrushWrapper> crush;       // hierarchical map
 
   friend class OSDMonitor;
@@ -274,6 +301,7 @@ private:
 	     new_blacklist_entries(false),
 	     cached_up_osd_features(0),
 	     crc_defined(false), crc(0),
+	     pg_mapping_cache(new pg_mapping_cache_t),
 	     crush(new CrushWrapper) {
     memset(&fsid, 0, sizeof(fsid));
   }
@@ -295,6 +323,10 @@ public:
     // NOTE: this still references shared entity_addr_t's.
     osd_addrs.reset(new addrs_s(*o.osd_addrs));
 
+    // give the copy its own mapping cache; sharing one across maps
+    // that can diverge would serve stale mappings.
+    pg_mapping_cache.reset(new pg_mapping_cache_t);
+
     // NOTE: we do not copy crush.  note that apply_incremental will
     // allocate a new CrushWrapper, though.
   }
@@ -652,10 +684,7 @@ public:
   int pg_to_osds(pg_t pg, vector<int> *raw, int *primary) const;
   /// map a pg to its acting set. @return acting set size
   int pg_to_acting_osds(const pg_t& pg, vector<int> *acting,
-                        int *acting_primary) const {
-    _pg_to_up_acting_osds(pg, NULL, NULL, acting, acting_primary);
-    return acting->size();
-  }
+                        int *acting_primary) const;
   int pg_to_acting_osds(pg_t pg, vector<int>& acting) const {
     return pg_to_acting_osds(pg, &acting, NULL);
   }
@@ -670,11 +699,13 @@ public:
    * also find the up set useful for things like deciding what to
    * set as pg_temp.
    * Each of these pointers must be non-NULL.
+   *
+   * Results are cached per pg (see pg_mapping_cache) since the op and
+   * peering paths recompute the same mappings over and over against a
+   * given map.
    */
   void pg_to_up_acting_osds(pg_t pg, vector<int> *up, int *up_primary,
-                            vector<int> *acting, int *acting_primary) const {
-    _pg_to_up_acting_osds(pg, up, up_primary, acting, acting_primary);
-  }
+                            vector<int> *acting, int *acting_primary) const;
   void pg_to_up_acting_osds(pg_t pg, vector<int>& up, vector<int>& acting) const {
     int up_primary, acting_primary;
     pg_to_up_acting_osds(pg, &up, &up_primary, &acting, &acting_primary);
@@ -24,7 +24,7 @@ OpRequest::OpRequest(Message *req, OpTracker *tracker) :
   rmw_flags(0), request(req),
   hit_flag_points(0), latest_flag_point(0),
   send_map_update(false), sent_epoch(0),
-  hitset_inserted(false) {
+  hitset_inserted(false), temp_sampled(false) {
   if (req->get_priority() < tracker->cct->_conf->osd_client_op_priority) {
     // don't warn as quickly for low priority ops
     warn_interval_multiplier = tracker->cct->_conf->osd_recovery_op_warn_multiple;
@@ -108,6 +108,14 @@ bool OpRequest::need_skip_promote() {
   return check_rmw(CEPH_OSD_RMW_FLAG_SKIP_PROMOTE);
 }
 
+int OpRequest::get_latency_type() const {
+  if (rmw_flags & (CEPH_OSD_RMW_FLAG_WRITE | CEPH_OSD_RMW_FLAG_CLASS_WRITE))
+    return OpLatencyHistogram::TYPE_WRITE;
+  if (rmw_flags & (CEPH_OSD_RMW_FLAG_READ | CEPH_OSD_RMW_FLAG_CLASS_READ))
+    return OpLatencyHistogram::TYPE_READ;
+  return OpLatencyHistogram::TYPE_OTHER;
+}
+
 void OpRequest::set_rmw_flags(int flags) {
 #ifdef WITH_LTTNG
   int old_rmw_flags = rmw_flags;
@@ -40,11 +40,13 @@ struct osd_reqid_t {
     : name(a), tid(t), inc(i) {}
 
   void encode(bufferlist &bl) const;
+  void bound_encode(size_t &p) const;
+  void encode(bufferlist::contiguous_appender &p) const;
   void decode(bufferlist::iterator &bl);
   void dump(Formatter *f) const;
   static void generate_test_instances(list<osd_reqid_t*>& o);
 };
-WRITE_CLASS_ENCODER(osd_reqid_t)
+WRITE_CLASS_DENC(osd_reqid_t)
 
 /**
  * The OpRequest takes in a Message* and takes over a single reference
@@ -80,6 +82,8 @@ struct OpRequest : public TrackedOp {
 
   void _dump(utime_t now, Formatter *f) const;
 
+  int get_latency_type() const;
+
   bool has_feature(uint64_t f) const {
     return request->get_connection()->has_feature(f);
   }
@@ -110,6 +114,7 @@ public:
   bool send_map_update;
   epoch_t sent_epoch;
   bool hitset_inserted;
+  bool temp_sampled;
   Message *get_req() const { return request; }
   bool been_queued_for_pg() { return hit_flag_points & flag_queued_for_pg; }
   bool been_reached_pg() { return hit_flag_points & flag_reached_pg; }
@@ -202,6 +202,7 @@ PG::PG(OSDService *o, OSDMapRef curmap,
   send_notify(false),
   pg_whoami(osd->whoami, p.shard),
   need_up_thru(false),
+  peering_fastpath(false),
   last_peering_reset(0),
   heartbeat_peer_lock("PG::heartbeat_peer_lock"),
   backfill_reserved(false),
@@ -301,7 +302,9 @@ void PG::proc_replica_log(
   dout(10) << "proc_replica_log for osd." << from << ": "
 	   << oinfo << " " << olog << " " << omissing << dendl;
 
+  utime_t start = ceph_clock_now(cct);
   pg_log.proc_replica_log(t, oinfo, olog, omissing, from);
+  osd->logger->tinc(l_osd_pg_log_merge_lat, ceph_clock_now(cct) - start);
 
   peer_info[from] = oinfo;
   dout(10) << " peer osd." << from << " now " << oinfo << " " << omissing << dendl;
@@ -396,9 +399,11 @@ void PG::merge_log(
   ObjectStore::Transaction& t, pg_info_t &oinfo, pg_log_t &olog, pg_shard_t from)
 {
   PGLogEntryHandler rollbacker;
+  utime_t start = ceph_clock_now(cct);
   pg_log.merge_log(
     t, oinfo, olog, from, info, &rollbacker, dirty_info, dirty_big_info);
   rollbacker.apply(this, &t);
+  osd->logger->tinc(l_osd_pg_log_merge_lat, ceph_clock_now(cct) - start);
 }
 
 void PG::rewind_divergent_log(ObjectStore::Transaction& t, eversion_t newhead)
@@ -1821,18 +1826,52 @@ bool PG::op_has_sufficient_caps(OpRequestRef& op)
     return false;
   }
   OSDCap& caps = session->caps;
-  session->put();
 
   string key = req->get_object_locator().key;
   if (key.length() == 0)
     key = req->get_oid().name;
 
-  bool cap = caps.is_capable(pool.name, req->get_object_locator().nspace,
-                             pool.auid, key,
-			     op->need_read_cap(),
-			     op->need_write_cap(),
-			     op->need_class_read_cap(),
-			     op->need_class_write_cap());
+  const string &nspace = req->get_object_locator().nspace;
+  unsigned combo =
+    (op->need_read_cap() ? 1 : 0) |
+    (op->need_write_cap() ? 2 : 0) |
+    (op->need_class_read_cap() ? 4 : 0) |
+    (op->need_class_write_cap() ? 8 : 0);
+  uint16_t bit = 1 << combo;
+
+  bool cap;
+  if (!caps.is_object_constrained()) {
+    // no grant looks at the object name, so repeat ops against the same
+    // (pool, namespace) can reuse the last evaluation
+    Mutex::Locker l(session->cap_cache_lock);
+    epoch_t cur_epoch = get_osdmap()->get_epoch();
+    if (session->cap_cache_epoch != cur_epoch ||
+	session->cap_cache.size() > 128) {
+      session->cap_cache.clear();
+      session->cap_cache_epoch = cur_epoch;
+    }
+    pair<uint16_t,uint16_t>& e = session->cap_cache[make_pair(pool.id,
+							      nspace)];
+    if (e.first & bit) {
+      cap = e.second & bit;
+    } else {
+      cap = caps.is_capable(pool.name, nspace, pool.auid, key,
+			    op->need_read_cap(),
+			    op->need_write_cap(),
+			    op->need_class_read_cap(),
+			    op->need_class_write_cap());
+      e.first |= bit;
+      if (cap)
+	e.second |= bit;
+    }
+  } else {
+    cap = caps.is_capable(pool.name, nspace, pool.auid, key,
+			  op->need_read_cap(),
+			  op->need_write_cap(),
+			  op->need_class_read_cap(),
+			  op->need_class_write_cap());
+  }
+  session->put();
 
   dout(20) << "op_has_sufficient_caps pool=" << pool.id << " (" << pool.name
 		   << " " << req->get_object_locator().nspace
@@ -3279,6 +3318,7 @@ void PG::reg_next_scrub()
   // later on.
   scrubber.scrub_reg_stamp = osd->reg_pg_scrub(info.pgid,
 					       reg_stamp,
+					       info.stats.stats.sum.num_bytes,
 					       scrubber.must_scrub);
 }
 
@@ -3327,7 +3367,7 @@ void PG::sub_op_scrub_map(OpRequestRef op)
 void PG::_request_scrub_map(
   pg_shard_t replica, eversion_t version,
   hobject_t start, hobject_t end,
-  bool deep, uint32_t seed)
+  bool deep, uint32_t seed, eversion_t skip_unmodified_since)
 {
   assert(replica != pg_whoami);
   dout(10) << "scrub  requesting scrubmap from osd." << replica
@@ -3335,7 +3375,7 @@ void PG::_request_scrub_map(
   MOSDRepScrub *repscrubop = new MOSDRepScrub(
     spg_t(info.pgid.pgid, replica.shard), version,
     get_osdmap()->get_epoch(),
-    start, end, deep, seed);
+    start, end, deep, seed, skip_unmodified_since);
   // default priority, we want the rep scrub processed prior to any recovery
   // or client io messages (we are holding a lock!)
   osd->send_message_osd_cluster(
@@ -3603,6 +3643,7 @@ void PG::_scan_snaps(ScrubMap &smap)
 int PG::build_scrub_map_chunk(
   ScrubMap &map,
   hobject_t start, hobject_t end, bool deep, uint32_t seed,
+  eversion_t skip_unmodified_since,
   ThreadPool::TPHandle &handle)
 {
   dout(10) << __func__ << " [" << start << "," << end << ") "
@@ -3625,7 +3666,8 @@ int PG::build_scrub_map_chunk(
   }
 
 
-  get_pgbackend()->be_scan_list(map, ls, deep, seed, handle);
+  get_pgbackend()->be_scan_list(map, ls, deep, seed, skip_unmodified_since,
+				handle);
   _scan_rollback_obs(rollback_obs, handle);
   _scan_snaps(map);
 
@@ -3707,6 +3749,7 @@ void PG::replica_scrub(
 
   build_scrub_map_chunk(
     map, msg->start, msg->end, msg->deep, msg->seed,
+    msg->skip_unmodified_since,
     handle);
 
   vector<OSDOp> scrub(1);
@@ -3737,13 +3780,25 @@ void PG::replica_scrub(
  */
 void PG::scrub(epoch_t queued, ThreadPool::TPHandle &handle)
 {
-  if (g_conf->osd_scrub_sleep > 0 &&
+  double scrub_sleep = g_conf->osd_scrub_sleep;
+  if (g_conf->osd_scrub_latency_target > 0) {
+    double over = (osd->get_recent_op_latency_us() / 1000000.0) /
+      g_conf->osd_scrub_latency_target;
+    if (over > 1.0) {
+      // clients are over the latency target; stretch (or introduce)
+      // the inter-chunk pause in proportion
+      if (over > 10.0)
+	over = 10.0;
+      scrub_sleep = (scrub_sleep > 0 ? scrub_sleep : 0.1) * over;
+    }
+  }
+  if (scrub_sleep > 0 &&
       (scrubber.state == PG::Scrubber::NEW_CHUNK ||
        scrubber.state == PG::Scrubber::INACTIVE)) {
     dout(20) << __func__ << " state is INACTIVE|NEW_CHUNK, sleeping" << dendl;
     unlock();
     utime_t t;
-    t.set_from_double(g_conf->osd_scrub_sleep);
+    t.set_from_double(scrub_sleep);
     t.sleep();
     lock();
     dout(20) << __func__ << " slept for " << t << dendl;
@@ -3901,6 +3956,15 @@ void PG::chunky_scrub(ThreadPool::TPHandle &handle)
 	else
 	  scrubber.seed = 0;  // compat
 
+	// stored oi digests were computed with seed -1, so we can only
+	// substitute them for a reread when that is the seed in use
+	if (scrubber.deep &&
+	    scrubber.seed == (uint32_t)-1 &&
+	    cct->_conf->osd_deep_scrub_skip_unmodified)
+	  scrubber.skip_unmodified_since = info.history.last_deep_scrub;
+	else
+	  scrubber.skip_unmodified_since = eversion_t();
+
         break;
 
       case PG::Scrubber::NEW_CHUNK:
@@ -3917,6 +3981,19 @@ void PG::chunky_scrub(ThreadPool::TPHandle &handle)
           // boundary. If there's no boundary, we request a list after the first
           // list, and so forth.
 
+          int chunk_max = cct->_conf->osd_scrub_chunk_max;
+          if (cct->_conf->osd_scrub_latency_target > 0) {
+            // shrink chunks toward the minimum as measured client
+            // latency eats into the target
+            double headroom = 1.0 -
+              (osd->get_recent_op_latency_us() / 1000000.0) /
+              cct->_conf->osd_scrub_latency_target;
+            if (headroom < 0)
+              headroom = 0;
+            chunk_max = cct->_conf->osd_scrub_chunk_min +
+              (int)((chunk_max - cct->_conf->osd_scrub_chunk_min) * headroom);
+          }
+
           bool boundary_found = false;
           hobject_t start = scrubber.start;
           while (!boundary_found) {
@@ -3924,7 +4001,7 @@ void PG::chunky_scrub(ThreadPool::TPHandle &handle)
             ret = get_pgbackend()->objects_list_partial(
 	      start,
 	      cct->_conf->osd_scrub_chunk_min,
-	      cct->_conf->osd_scrub_chunk_max,
+	      chunk_max,
 	      &objects,
 	      &candidate_end);
             assert(ret >= 0);
@@ -3982,7 +4059,7 @@ void PG::chunky_scrub(ThreadPool::TPHandle &handle)
 	  if (*i == pg_whoami) continue;
           _request_scrub_map(*i, scrubber.subset_last_update,
                              scrubber.start, scrubber.end, scrubber.deep,
-			     scrubber.seed);
+			     scrubber.seed, scrubber.skip_unmodified_since);
           scrubber.waiting_on_whom.insert(*i);
           ++scrubber.waiting_on;
         }
@@ -4017,6 +4094,7 @@ void PG::chunky_scrub(ThreadPool::TPHandle &handle)
         ret = build_scrub_map_chunk(scrubber.primary_scrubmap,
                                     scrubber.start, scrubber.end,
                                     scrubber.deep, scrubber.seed,
+				    scrubber.skip_unmodified_since,
 				    handle);
         if (ret < 0) {
           dout(5) << "error building scrub map: " << ret << ", aborting" << dendl;
@@ -4652,6 +4730,7 @@ void PG::start_peering_interval(
   pg_shard_t old_acting_primary = get_primary();
   pg_shard_t old_up_primary = up_primary;
   bool was_old_primary = is_primary();
+  bool was_active_clean = is_active() && is_clean();
 
   acting.swap(oldacting);
   up.swap(oldup);
@@ -4745,6 +4824,26 @@ void PG::start_peering_interval(
 	   << " upacting " << upacting_features
 	   << dendl;
 
+  // membership-neutral interval change (e.g. a map flap that touched
+  // only pool metadata): up, acting and both primaries are unchanged
+  // and we were fully clean, so every peer's info is provably still
+  // valid.  keep peer_info across the reset so GetInfo finds everything
+  // it needs already on hand and can skip the info/log exchange.
+  //
+  // peer_info is advanced optimistically when a repop is issued, and a
+  // repop still in flight at the map flip is discarded by the replicas'
+  // interval checks, so the kept infos would over-state what replicas
+  // hold.  only take the fast path once every issued repop has been
+  // fully acked, which is when peer_info matches reality again.
+  peering_fastpath =
+    lastmap &&
+    was_old_primary && is_primary() &&
+    old_acting_primary == get_primary() &&
+    old_up_primary == up_primary &&
+    oldup == up && oldacting == acting &&
+    was_active_clean &&
+    !has_unacked_repops();
+
   // deactivate.
   state_clear(PG_STATE_ACTIVE);
   state_clear(PG_STATE_PEERED);
@@ -4758,13 +4857,20 @@ void PG::start_peering_interval(
   snap_trim_queued = false;
   scrub_queued = false;
 
+  map<pg_shard_t, pg_info_t> last_peer_info;
+  if (peering_fastpath)
+    last_peer_info.swap(peer_info);
+
   // reset primary state?
   if (was_old_primary || is_primary()) {
     osd->remove_want_pg_temp(info.pgid.pgid);
   }
   clear_primary_state();
 
-    
+  if (peering_fastpath)
+    peer_info.swap(last_peer_info);
+
+
   // pg->on_*
   on_change(t);
 
@@ -5878,7 +5984,8 @@ PG::RecoveryState::WaitLocalBackfillReserved::WaitLocalBackfillReserved(my_conte
     new QueuePeeringEvt<LocalBackfillReserved>(
       pg, pg->get_osdmap()->get_epoch(),
       LocalBackfillReserved()),
-    pg->get_backfill_priority());
+    pg->get_backfill_priority(),
+    pg->info.pgid.pool());
 }
 
 void PG::RecoveryState::WaitLocalBackfillReserved::exit()
@@ -5946,7 +6053,8 @@ PG::RecoveryState::RepWaitRecoveryReserved::RepWaitRecoveryReserved(my_context c
     new QueuePeeringEvt<RemoteRecoveryReserved>(
       pg, pg->get_osdmap()->get_epoch(),
       RemoteRecoveryReserved()),
-    pg->get_recovery_priority());
+    pg->get_recovery_priority(),
+    pg->info.pgid.pool());
 }
 
 boost::statechart::result
@@ -6000,7 +6108,8 @@ PG::RecoveryState::RepNotRecovering::react(const RequestBackfillPrio &evt)
       pg->info.pgid,
       new QueuePeeringEvt<RemoteBackfillReserved>(
         pg, pg->get_osdmap()->get_epoch(),
-        RemoteBackfillReserved()), evt.priority);
+        RemoteBackfillReserved()), evt.priority,
+      pg->info.pgid.pool());
   }
   return transit<RepWaitBackfillReserved>();
 }
@@ -6107,7 +6216,8 @@ PG::RecoveryState::WaitLocalRecoveryReserved::WaitLocalRecoveryReserved(my_conte
     new QueuePeeringEvt<LocalRecoveryReserved>(
       pg, pg->get_osdmap()->get_epoch(),
       LocalRecoveryReserved()),
-    pg->get_recovery_priority());
+    pg->get_recovery_priority(),
+    pg->info.pgid.pool());
 }
 
 void PG::RecoveryState::WaitLocalRecoveryReserved::exit()
@@ -6837,7 +6947,16 @@ PG::RecoveryState::GetInfo::GetInfo(my_context ctx)
   pg->reset_min_peer_features();
   get_infos();
   if (peer_info_requested.empty() && !prior_set->pg_down) {
+    if (pg->peering_fastpath)
+      pg->osd->logger->inc(l_osd_peering_fastpath);
+    else
+      pg->osd->logger->inc(l_osd_peering_full);
     post_event(GotInfo());
+  } else {
+    // had to probe after all, e.g. the prior set reaches beyond the
+    // infos we kept across the interval change
+    pg->peering_fastpath = false;
+    pg->osd->logger->inc(l_osd_peering_full);
   }
 }
 
@@ -614,6 +614,16 @@ protected:
    */
   
   bool        need_up_thru;
+
+  /**
+   * set by start_peering_interval when the new interval left up, acting
+   * and the primary untouched, the pg was active+clean and no repop was
+   * in flight (peer_info is projected at issue time, so unacked repops
+   * would make the kept infos over-state the replicas).  peer_info is
+   * preserved in that case, so GetInfo finds everything it needs
+   * already on hand and reactivates without the info/log exchange.
+   */
+  bool        peering_fastpath;
   set<pg_shard_t>    stray_set;   // non-acting osds that have PG data.
   eversion_t  oldest_update; // acting: lowest (valid) last_update in active set
   map<pg_shard_t, pg_info_t>    peer_info;   // info from peers (stray or prior)
@@ -1127,6 +1137,9 @@ public:
     // deep scrub
     bool deep;
     uint32_t seed;
+    /// objects unmodified since this version may be verified by their
+    /// stored whole-object digests instead of being reread
+    eversion_t skip_unmodified_since;
 
     list<Context*> callbacks;
     void add_callback(Context *context) {
@@ -1195,6 +1208,7 @@ public:
       fixed = 0;
       deep = false;
       seed = 0;
+      skip_unmodified_since = eversion_t();
       run_callbacks();
       inconsistent.clear();
       missing.clear();
@@ -1224,10 +1238,11 @@ public:
     ThreadPool::TPHandle &handle);
   void _request_scrub_map(pg_shard_t replica, eversion_t version,
                           hobject_t start, hobject_t end, bool deep,
-			  uint32_t seed);
+			  uint32_t seed, eversion_t skip_unmodified_since);
   int build_scrub_map_chunk(
     ScrubMap &map,
     hobject_t start, hobject_t end, bool deep, uint32_t seed,
+    eversion_t skip_unmodified_since,
     ThreadPool::TPHandle &handle);
   /**
    * returns true if [begin, end) is good to scrub at this time
@@ -2305,6 +2320,8 @@ public:
   virtual void on_role_change() = 0;
   virtual void on_pool_change() = 0;
   virtual void on_change(ObjectStore::Transaction *t) = 0;
+  /// true if repops are still in flight (issued but not fully acked)
+  virtual bool has_unacked_repops() const = 0;
   virtual void on_activate() = 0;
   virtual void on_flushed() = 0;
   virtual void on_shutdown() = 0;
@@ -311,6 +311,7 @@ PGBackend *PGBackend::build_pg_backend(
  */
 void PGBackend::be_scan_list(
   ScrubMap &map, const vector<hobject_t> &ls, bool deep, uint32_t seed,
+  eversion_t skip_unmodified_since,
   ThreadPool::TPHandle &handle)
 {
   dout(10) << __func__ << " scanning " << ls.size() << " objects"
@@ -341,7 +342,34 @@ void PGBackend::be_scan_list(
 
       // calculate the CRC32 on deep scrubs
       if (deep) {
-	be_deep_scrub(*p, seed, o, handle);
+	bool reread = true;
+	// an object that has not been written since the last deep
+	// scrub can instead be verified by the whole-object digests
+	// recorded in its object_info_t
+	if (skip_unmodified_since != eversion_t() &&
+	    o.attrs.count(OI_ATTR)) {
+	  object_info_t oi;
+	  bufferlist bl;
+	  bl.push_back(o.attrs.find(OI_ATTR)->second);
+	  bufferlist::iterator bliter = bl.begin();
+	  try {
+	    ::decode(oi, bliter);
+	    if (oi.version <= skip_unmodified_since &&
+		oi.is_data_digest() && oi.is_omap_digest()) {
+	      o.digest = oi.data_digest;
+	      o.digest_present = true;
+	      o.omap_digest = oi.omap_digest;
+	      o.omap_digest_present = true;
+	      reread = false;
+	      dout(25) << __func__ << "  " << poid << " unmodified since "
+		       << oi.version << ", using stored digests" << dendl;
+	    }
+	  } catch (...) {
+	    // corrupt oi attr; reread and let the scrub sort it out
+	  }
+	}
+	if (reread)
+	  be_deep_scrub(*p, seed, o, handle);
       }
 
       dout(25) << __func__ << "  " << poid << dendl;
@@ -494,7 +522,7 @@ map<pg_shard_t, ScrubMap *>::const_iterator
     auth = j;
     *auth_oi = oi;
 
-    uint64_t correct_size = be_get_ondisk_size(oi.size);
+    uint64_t correct_size = be_get_ondisk_size(oi.ondisk_size());
     if (correct_size != i->second.size) {
       // invalid size, probably corrupt
       dout(10) << __func__ << ": rejecting osd " << j->first
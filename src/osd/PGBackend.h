@@ -550,6 +550,7 @@
    virtual bool scrub_supported() { return false; }
    void be_scan_list(
      ScrubMap &map, const vector<hobject_t> &ls, bool deep, uint32_t seed,
+     eversion_t skip_unmodified_since,
      ThreadPool::TPHandle &handle);
    enum scrub_error_type be_compare_scrub_objects(
      pg_shard_t auth_shard,
@@ -150,6 +150,7 @@ void PGLog::clear() {
   missing.clear();
   log.clear();
   log_keys_debug.clear();
+  rollback_info_on_disk = false;
   undirty();
 }
 
@@ -267,8 +268,21 @@ void PGLog::proc_replica_log(
   }
 
 
+  // _merge_divergent_entries only consults folog.objects for the
+  // divergent soids; index just those objects' pre-divergence entries
+  // instead of copying and hashing the whole overlap region
+  set<hobject_t, hobject_t::BitwiseComparator> divergent_soids;
+  for (list<pg_log_entry_t>::const_iterator i = divergent.begin();
+       i != divergent.end();
+       ++i)
+    divergent_soids.insert(i->soid);
   IndexedLog folog;
-  folog.log.insert(folog.log.begin(), olog.log.begin(), pp);
+  for (list<pg_log_entry_t>::const_iterator i = olog.log.begin();
+       i != pp;
+       ++i) {
+    if (divergent_soids.count(i->soid))
+      folog.log.push_back(*i);
+  }
   folog.index();
   _merge_divergent_entries(
     folog,
@@ -670,9 +684,17 @@ void PGLog::merge_log(ObjectStore::Transaction& t,
     }
 
     // splice
-    log.log.splice(log.log.end(), 
+    log.log.splice(log.log.end(),
 		   olog.log, from, to);
-    log.index();   
+    if (divergent.empty()) {
+      // the spliced entries were already indexed above and splice
+      // leaves their addresses intact; only the trimmed-to cursor
+      // needs to catch up with the new head
+      log.reset_rollback_info_trimmed_to_riter();
+    } else {
+      // popping divergent entries invalidated parts of the index
+      log.index();
+    }
 
     info.last_update = log.head = olog.head;
 
@@ -751,6 +773,11 @@ void PGLog::write_log(
 	     << ", writeout_from: " << writeout_from
 	     << ", trimmed: " << trimmed
 	     << dendl;
+    // only rewrite the rollback info keys if their values changed since
+    // we last wrote them out
+    bool dirty_rollback_info = !rollback_info_on_disk ||
+      can_rollback_to_on_disk != log.can_rollback_to ||
+      rollback_info_trimmed_to_on_disk != log.rollback_info_trimmed_to;
     _write_log(
       t, km, log, coll, log_oid, divergent_priors,
       dirty_to,
@@ -758,8 +785,12 @@ void PGLog::write_log(
       writeout_from,
       trimmed,
       dirty_divergent_priors,
+      dirty_rollback_info,
       !touched_log,
       (pg_log_debug ? &log_keys_debug : 0));
+    rollback_info_on_disk = true;
+    can_rollback_to_on_disk = log.can_rollback_to;
+    rollback_info_trimmed_to_on_disk = log.rollback_info_trimmed_to;
     undirty();
   } else {
     dout(10) << "log is not dirty" << dendl;
@@ -777,7 +808,7 @@ void PGLog::write_log(
     t, km, log, coll, log_oid,
     divergent_priors, eversion_t::max(), eversion_t(), eversion_t(),
     set<eversion_t>(),
-    true, true, 0);
+    true, true, true, 0);
 }
 
 void PGLog::_write_log(
@@ -791,6 +822,7 @@ void PGLog::_write_log(
   eversion_t writeout_from,
   const set<eversion_t> &trimmed,
   bool dirty_divergent_priors,
+  bool dirty_rollback_info,
   bool touch_log,
   set<string> *log_keys_debug
   )
@@ -856,8 +888,11 @@ void PGLog::_write_log(
     //dout(10) << "write_log: writing divergent_priors" << dendl;
     ::encode(divergent_priors, (*km)["divergent_priors"]);
   }
-  ::encode(log.can_rollback_to, (*km)["can_rollback_to"]);
-  ::encode(log.rollback_info_trimmed_to, (*km)["rollback_info_trimmed_to"]);
+  if (dirty_rollback_info) {
+    ::encode(log.can_rollback_to, (*km)["can_rollback_to"]);
+    ::encode(log.rollback_info_trimmed_to,
+	     (*km)["rollback_info_trimmed_to"]);
+  }
 
   if (!to_remove.empty())
     t.omap_rmkeys(coll, log_oid, to_remove);
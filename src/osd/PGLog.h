@@ -18,7 +18,8 @@
 #define CEPH_PG_LOG_H
 
 // re-include our assert to clobber boost's
-#include "include/assert.h" 
+#include "include/assert.h"
+#include "include/unordered_set.h"
 #include "osd_types.h"
 #include "os/ObjectStore.h"
 #include "common/ceph_context.h"
@@ -50,6 +51,51 @@ struct PGLog {
     char buf[512];
   };
 
+  /**
+   * StringInternPool - share the string components of the hobject_ts
+   * held by in-memory log entries.
+   *
+   * A pg log holds thousands of entries, and a busy object accounts
+   * for many of them; each entry carries its own copy of the object
+   * name, locator key and namespace.  With the refcounted
+   * (copy-on-write) libstdc++ string this tree builds against,
+   * assigning a pooled copy into an entry shares a single heap buffer
+   * among all entries for the same object, and the missing set
+   * inherits the sharing when its keys are copied out of log entries.
+   * Trimming an entry simply drops its reference.  The pool pins one
+   * copy of each distinct string and is cleared wholesale when it
+   * grows too large, which is safe: live entries keep their shared
+   * buffers alive.
+   *
+   * With a non-refcounted std::string (_GLIBCXX_USE_CXX11_ABI=1, or a
+   * non-GNU library) assignment copies, so interning is compiled out.
+   */
+  struct StringInternPool {
+#if defined(__GLIBCXX__) && (!defined(_GLIBCXX_USE_CXX11_ABI) || _GLIBCXX_USE_CXX11_ABI == 0)
+    ceph::unordered_set<string> pool;
+    static const size_t max_pool_size = 32768;
+    void intern(string &s) {
+      if (s.empty())
+	return;
+      if (pool.size() >= max_pool_size)
+	pool.clear();
+      s = *pool.insert(s).first;
+    }
+    void intern(hobject_t &o) {
+      intern(o.oid.name);
+      intern(o.nspace);
+      if (!o.get_key().empty()) {
+	string k = o.get_key();
+	intern(k);
+	o.set_key(k);
+      }
+    }
+#else
+    void intern(string &s) {}
+    void intern(hobject_t &o) {}
+#endif
+  };
+
   /**
    * IndexLog - adds in-memory index of the log, by oid.
    * plus some methods to manipulate it all.
@@ -58,6 +104,7 @@ struct PGLog {
     ceph::unordered_map<hobject_t,pg_log_entry_t*> objects;  // ptrs into log.  be careful!
     ceph::unordered_map<osd_reqid_t,pg_log_entry_t*> caller_ops;
     ceph::unordered_multimap<osd_reqid_t,pg_log_entry_t*> extra_caller_ops;
+    StringInternPool string_pool;  ///< shares hobject_t strings across entries
 
     // recovery pointers
     list<pg_log_entry_t>::iterator complete_to;  // not inclusive of referenced item
@@ -190,6 +237,7 @@ struct PGLog {
       for (list<pg_log_entry_t>::iterator i = log.begin();
            i != log.end();
            ++i) {
+	string_pool.intern(i->soid);
         objects[i->soid] = &(*i);
 	if (i->reqid_is_indexed()) {
 	  //assert(caller_ops.count(i->reqid) == 0);  // divergent merge_log indexes new before unindexing old
@@ -203,6 +251,10 @@ struct PGLog {
 	}
       }
 
+      reset_rollback_info_trimmed_to_riter();
+    }
+
+    void reset_rollback_info_trimmed_to_riter() {
       rollback_info_trimmed_to_riter = log.rbegin();
       while (rollback_info_trimmed_to_riter != log.rend() &&
 	     rollback_info_trimmed_to_riter->version > rollback_info_trimmed_to)
@@ -210,7 +262,8 @@ struct PGLog {
     }
 
     void index(pg_log_entry_t& e) {
-      if (objects.count(e.soid) == 0 || 
+      string_pool.intern(e.soid);
+      if (objects.count(e.soid) == 0 ||
           objects[e.soid]->version < e.version)
         objects[e.soid] = &e;
       if (e.reqid_is_indexed()) {
@@ -259,6 +312,9 @@ struct PGLog {
       // add to log
       log.push_back(e);
 
+      // share string storage with the other entries for this object
+      string_pool.intern(log.back().soid);
+
       /**
        * Make sure we don't keep around more than we need to in the
        * in-memory log
@@ -273,8 +329,9 @@ struct PGLog {
       assert(head.version == 0 || e.version.version > head.version);
       head = e.version;
 
-      // to our index
-      objects[e.soid] = &(log.back());
+      // to our index.  use the interned soid for the key so the map
+      // shares the entry's string buffers too.
+      objects[log.back().soid] = &(log.back());
       if (e.reqid_is_indexed()) {
 	caller_ops[e.reqid] = &(log.back());
       }
@@ -312,6 +369,10 @@ protected:
   eversion_t writeout_from;    ///< must writout keys >= writeout_from
   set<eversion_t> trimmed;     ///< must clear keys in trimmed
   bool dirty_divergent_priors;
+  /// true if the *_on_disk values below reflect what is stored in the omap
+  bool rollback_info_on_disk;
+  eversion_t can_rollback_to_on_disk;
+  eversion_t rollback_info_trimmed_to_on_disk;
   CephContext *cct;
 
   bool is_dirty() const {
@@ -378,7 +439,8 @@ public:
     pg_log_debug(!(cct && !(cct->_conf->osd_debug_pg_log_writeout))),
     touched_log(false), dirty_from(eversion_t::max()),
     writeout_from(eversion_t::max()),
-    dirty_divergent_priors(false), cct(cct) {}
+    dirty_divergent_priors(false), rollback_info_on_disk(false),
+    cct(cct) {}
 
 
   void reset_backfill();
@@ -666,6 +728,7 @@ public:
     eversion_t writeout_from,
     const set<eversion_t> &trimmed,
     bool dirty_divergent_priors,
+    bool dirty_rollback_info,
     bool touch_log,
     set<string> *log_keys_debug
     );
@@ -241,9 +241,9 @@ void ReplicatedBackend::on_change()
        i != in_progress_ops.end();
        in_progress_ops.erase(i++)) {
     if (i->second.on_commit)
-      delete i->second.on_commit;
+      i->second.on_commit->abandon();
     if (i->second.on_applied)
-      delete i->second.on_applied;
+      i->second.on_applied->abandon();
   }
   clear_recovery_state();
 }
@@ -274,32 +274,64 @@ struct AsyncReadCallback : public GenContext<ThreadPool::TPHandle&> {
     delete c;
   }
 };
+/**
+ * Completion for a single store read_async extent: delivers the per-read
+ * fixup callback (if any) back through the gen work queue, then completes
+ * the gather sub with the read result.  Runs on a store reader thread.
+ */
+struct C_StoreReadDone : public Context {
+  PGBackend::Listener *parent;
+  Context *cb;    ///< per-read fixup callback, may be NULL
+  Context *sub;   ///< gather sub feeding the final on_complete
+  C_StoreReadDone(PGBackend::Listener *parent, Context *cb, Context *sub)
+    : parent(parent), cb(cb), sub(sub) {}
+  void finish(int r) {
+    if (cb)
+      parent->schedule_recovery_work(
+	parent->bless_gencontext(
+	  new AsyncReadCallback(r, cb)));
+    sub->complete(r);
+  }
+};
+
+/// gather finisher: route the aggregated result onto the gen work queue
+struct C_StoreReadsComplete : public Context {
+  PGBackend::Listener *parent;
+  Context *on_complete;
+  C_StoreReadsComplete(PGBackend::Listener *parent, Context *c)
+    : parent(parent), on_complete(c) {}
+  void finish(int r) {
+    parent->schedule_recovery_work(
+      parent->bless_gencontext(
+	new AsyncReadCallback(r, on_complete)));
+  }
+};
+
 void ReplicatedBackend::objects_read_async(
   const hobject_t &hoid,
   const list<pair<boost::tuple<uint64_t, uint64_t, uint32_t>,
 		  pair<bufferlist*, Context*> > > &to_read,
   Context *on_complete)
 {
-  int r = 0;
+  // Hand every extent to the store at once instead of reading them
+  // synchronously here; the per-read fixups and the final completion
+  // still arrive through the gen work queue (under the pg lock) exactly
+  // as before, this thread just doesn't wait out the disk latency.
+  C_GatherBuilder gather(cct,
+			 new C_StoreReadsComplete(get_parent(), on_complete));
   for (list<pair<boost::tuple<uint64_t, uint64_t, uint32_t>,
 		 pair<bufferlist*, Context*> > >::const_iterator i =
 	   to_read.begin();
-       i != to_read.end() && r >= 0;
+       i != to_read.end();
        ++i) {
-    int _r = store->read(coll, ghobject_t(hoid), i->first.get<0>(),
-			 i->first.get<1>(), *(i->second.first),
-			 i->first.get<2>());
-    if (i->second.second) {
-      get_parent()->schedule_recovery_work(
-	get_parent()->bless_gencontext(
-	  new AsyncReadCallback(_r, i->second.second)));
-    }
-    if (_r < 0)
-      r = _r;
-  }
-  get_parent()->schedule_recovery_work(
-    get_parent()->bless_gencontext(
-      new AsyncReadCallback(r, on_complete)));
+    store->read_async(coll, ghobject_t(hoid),
+		      i->first.get<0>(), i->first.get<1>(), i->first.get<2>(),
+		      i->second.first,
+		      new C_StoreReadDone(get_parent(), i->second.second,
+					  gather.new_sub()));
+  }
+  assert(gather.has_subs());
+  gather.activate();
 }
 
 
@@ -585,8 +617,9 @@ void ReplicatedBackend::submit_transaction(
     &op,
     op_t);
 
+  // local_t never leaves this OSD; keep the in-memory op layout even if
+  // op_t had to fall back to the encoded form for old peers
   ObjectStore::Transaction *local_t = new ObjectStore::Transaction;
-  local_t->set_use_tbl(op_t->get_use_tbl());
   if (!(t->get_temp_added().empty())) {
     add_temp_objs(t->get_temp_added());
   }
@@ -608,9 +641,19 @@ void ReplicatedBackend::submit_transaction(
     new ObjectStore::C_DeleteTransaction(op_t));
   op_t->register_on_applied(
     new ObjectStore::C_DeleteTransaction(local_t));
-  op_t->register_on_commit(
-    parent->bless_context(
-      new C_OSD_OnOpCommit(this, &op)));
+  if (cct->_conf->osd_fast_ondisk_ack) {
+    // run the commit handler (and so the client's ondisk reply)
+    // directly from the journal completion path instead of hopping
+    // through the ondisk finisher; it takes the pg lock, so commit
+    // delivery for later ops stalls if the pg lock is busy
+    op_t->register_on_commit_sync(
+      parent->bless_context(
+	new C_OSD_OnOpCommit(this, &op)));
+  } else {
+    op_t->register_on_commit(
+      parent->bless_context(
+	new C_OSD_OnOpCommit(this, &op)));
+  }
 
   list<ObjectStore::Transaction*> tls;
   tls.push_back(local_t);
@@ -1148,7 +1191,7 @@ void ReplicatedBackend::sub_op_modify_impl(OpRequestRef op)
 
   bufferlist::iterator p = m->get_data().begin();
   ::decode(rm->opt, p);
-  rm->localt.set_use_tbl(rm->opt.get_use_tbl());
+  // rm->localt is consumed in-process; leave it in the in-memory op layout
 
   if (m->new_temp_oid != hobject_t()) {
     dout(20) << __func__ << " start tracking temp " << m->new_temp_oid << dendl;
@@ -1298,10 +1341,17 @@ void ReplicatedBackend::calc_head_subsets(
   dout(10) << "calc_head_subsets " << head
 	   << " clone_overlap " << snapset.clone_overlap << dendl;
 
-  uint64_t size = obc->obs.oi.size;
+  uint64_t size = obc->obs.oi.ondisk_size();
   if (size)
     data_subset.insert(0, size);
 
+  if (obc->obs.oi.is_compressed()) {
+    // on-disk bytes don't line up with logical clone overlap
+    dout(10) << __func__ << ": " << head
+	     << " is stored compressed, skipping clone subsets" << dendl;
+    return;
+  }
+
   if (get_parent()->get_pool().allow_incomplete_clones()) {
     dout(10) << __func__ << ": caching (was) enabled, skipping clone subsets" << dendl;
     return;
@@ -1363,6 +1413,14 @@ void ReplicatedBackend::calc_clone_subsets(
   if (size)
     data_subset.insert(0, size);
 
+  if (get_parent()->get_pool().has_flag(pg_pool_t::FLAG_COMPRESS)) {
+    // clones may be stored compressed; their on-disk bytes don't line
+    // up with the logical clone overlap, so push/pull them whole
+    dout(10) << __func__ << ": " << soid
+	     << " pool has compress flag, skipping clone subsets" << dendl;
+    return;
+  }
+
   if (get_parent()->get_pool().allow_incomplete_clones()) {
     dout(10) << __func__ << ": caching (was) enabled, skipping clone subsets" << dendl;
     return;
@@ -1597,8 +1655,8 @@ void ReplicatedBackend::prep_push(ObjectContextRef obc,
 			     PushOp *pop)
 {
   interval_set<uint64_t> data_subset;
-  if (obc->obs.oi.size)
-    data_subset.insert(0, obc->obs.oi.size);
+  if (obc->obs.oi.ondisk_size())
+    data_subset.insert(0, obc->obs.oi.ondisk_size());
   map<hobject_t, interval_set<uint64_t>, hobject_t::BitwiseComparator> clone_subsets;
 
   prep_push(obc, soid, peer,
@@ -1619,7 +1677,7 @@ void ReplicatedBackend::prep_push(
   // take note.
   PushInfo &pi = pushing[soid][peer];
   pi.obc = obc;
-  pi.recovery_info.size = obc->obs.oi.size;
+  pi.recovery_info.size = obc->obs.oi.ondisk_size();
   pi.recovery_info.copy_subset = data_subset;
   pi.recovery_info.clone_subset = clone_subsets;
   pi.recovery_info.soid = soid;
@@ -2025,20 +2083,43 @@ int ReplicatedBackend::build_push_op(const ObjectRecoveryInfo &recovery_info,
   if (available > 0) {
     if (!recovery_info.copy_subset.empty()) {
       interval_set<uint64_t> copy_subset = recovery_info.copy_subset;
-      bufferlist bl;
-      int r = store->fiemap(coll, ghobject_t(recovery_info.soid), 0,
-                            copy_subset.range_end(), bl);
-      if (r >= 0)  {
-        interval_set<uint64_t> fiemap_included;
-        map<uint64_t, uint64_t> m;
-        bufferlist::iterator iter = bl.begin();
-        ::decode(m, iter);
-        map<uint64_t, uint64_t>::iterator miter;
-        for (miter = m.begin(); miter != m.end(); ++miter) {
-          fiemap_included.insert(miter->first, miter->second);
-        }
-
-        copy_subset.intersection_of(fiemap_included);
+      // map the allocated extents of what is left to push so the holes
+      // of a thin object are never read or shipped.  query only from
+      // data_recovered_to: everything below it went out in earlier
+      // chunks, and refusing to re-map it keeps the per-chunk cost
+      // proportional to what remains.
+      uint64_t map_from = progress.data_recovered_to;
+      if (map_from < copy_subset.range_end()) {
+	bufferlist bl;
+	int r = store->fiemap(coll, ghobject_t(recovery_info.soid), map_from,
+			      copy_subset.range_end() - map_from, bl);
+	if (r >= 0)  {
+	  interval_set<uint64_t> fiemap_included;
+	  map<uint64_t, uint64_t> m;
+	  bufferlist::iterator iter = bl.begin();
+	  ::decode(m, iter);
+	  map<uint64_t, uint64_t>::iterator miter;
+	  // FIEMAP reports whole blocks, so neighbouring extents may
+	  // overlap; clamp them rather than letting insert() assert
+	  uint64_t last_end = 0;
+	  for (miter = m.begin(); miter != m.end(); ++miter) {
+	    uint64_t ex_off = miter->first;
+	    uint64_t ex_len = miter->second;
+	    if (ex_off < last_end) {
+	      uint64_t dup = last_end - ex_off;
+	      if (ex_len <= dup)
+		continue;
+	      ex_off += dup;
+	      ex_len -= dup;
+	    }
+	    if (!ex_len)
+	      continue;
+	    fiemap_included.insert(ex_off, ex_len);
+	    last_end = ex_off + ex_len;
+	  }
+
+	  copy_subset.intersection_of(fiemap_included);
+	}
       }
       out_op->data_included.span_of(copy_subset, progress.data_recovered_to,
                                     available);
@@ -2079,6 +2160,25 @@ int ReplicatedBackend::build_push_op(const ObjectRecoveryInfo &recovery_info,
     out_op->data.claim_append(bit);
   }
 
+  uint64_t readahead_chunks = cct->_conf->osd_recovery_readahead_chunks;
+  if (readahead_chunks && !cache_dont_need &&
+      !new_progress.data_complete &&
+      !recovery_info.copy_subset.empty() &&
+      new_progress.data_recovered_to <
+	recovery_info.copy_subset.range_end()) {
+    // hint the next chunk(s) into the cache so the reads for the next
+    // push proceed while this one is on the wire
+    interval_set<uint64_t> next;
+    next.span_of(recovery_info.copy_subset,
+		 new_progress.data_recovered_to,
+		 readahead_chunks * cct->_conf->osd_recovery_max_chunk);
+    for (interval_set<uint64_t>::iterator p = next.begin();
+	 p != next.end();
+	 ++p)
+      store->readahead(coll, ghobject_t(recovery_info.soid),
+		       p.get_start(), p.get_len());
+  }
+
   if (new_progress.is_complete(recovery_info)) {
     new_progress.data_complete = true;
     if (stat)
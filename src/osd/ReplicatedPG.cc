@@ -24,6 +24,8 @@
 #include "common/errno.h"
 #include "common/perf_counters.h"
 
+#include "compressor/AsyncCompressor.h"
+
 #include "messages/MOSDOp.h"
 #include "messages/MOSDOpReply.h"
 #include "messages/MOSDSubOp.h"
@@ -388,11 +390,11 @@ void ReplicatedPG::maybe_kick_recovery(
     PGBackend::RecoveryHandle *h = pgbackend->open_recovery_op();
     h->cache_dont_need = false;
     if (is_missing_object(soid)) {
-      recover_missing(soid, v, cct->_conf->osd_client_op_priority, h);
+      recover_missing(soid, v, osd->op_conf()->client_op_priority, h);
     } else {
       prep_object_replica_pushes(soid, v, h);
     }
-    pgbackend->run_recovery_op(h, cct->_conf->osd_client_op_priority);
+    pgbackend->run_recovery_op(h, osd->op_conf()->client_op_priority);
   }
 }
 
@@ -758,6 +760,16 @@ int ReplicatedPG::do_command(cmdmap_t cmdmap, ostream& ss,
     f->close_section();
     f->flush(odata);
     return 0;
+  }
+  else if (command == "dump_temperature") {
+    f->open_object_section("temperature");
+    f->dump_int("enabled", temp_sampler.enabled());
+    if (!temp_sampler.enabled())
+      ss << "sampling disabled; set osd_object_temp_sample_size > 0";
+    temp_sampler.dump(f.get());
+    f->close_section();
+    f->flush(odata);
+    return 0;
   };
 
   ss << "unknown pg command " << prefix;
@@ -829,7 +841,7 @@ void ReplicatedPG::do_pg_op(OpRequestRef op)
         dout(10) << " pgnls pg=" << m->get_pg() << " != " << info.pgid << dendl;
 	result = 0; // hmm?
       } else {
-	unsigned list_size = MIN(cct->_conf->osd_max_pgls, p->op.pgls.count);
+	unsigned list_size = MIN(osd->op_conf()->max_pgls, p->op.pgls.count);
 
         dout(10) << " pgnls pg=" << m->get_pg() << " count " << list_size << dendl;
 	// read into a buffer
@@ -934,7 +946,7 @@ void ReplicatedPG::do_pg_op(OpRequestRef op)
 	  }
 
 	  // skip internal namespace
-	  if (candidate.get_namespace() == cct->_conf->osd_hit_set_namespace)
+	  if (candidate.get_namespace() == osd->op_conf()->hit_set_namespace)
 	    continue;
 
 	  // skip wrong namespace
@@ -992,7 +1004,7 @@ void ReplicatedPG::do_pg_op(OpRequestRef op)
         dout(10) << " pgls pg=" << m->get_pg() << " != " << info.pgid << dendl;
 	result = 0; // hmm?
       } else {
-	unsigned list_size = MIN(cct->_conf->osd_max_pgls, p->op.pgls.count);
+	unsigned list_size = MIN(osd->op_conf()->max_pgls, p->op.pgls.count);
 
         dout(10) << " pgls pg=" << m->get_pg() << " count " << list_size << dendl;
 	// read into a buffer
@@ -1239,7 +1251,9 @@ ReplicatedPG::ReplicatedPG(OSDService *o, OSDMapRef curmap,
   pgbackend(
     PGBackend::build_pg_backend(
       _pool.info, curmap, this, coll_t(p), o->store, cct)),
-  object_contexts(o->cct, g_conf->osd_pg_object_context_cache_count),
+  temp_sampler(o->cct->_conf->osd_object_temp_sample_size),
+  object_contexts(o->cct, g_conf->osd_pg_object_context_cache_count,
+		  g_conf->osd_pg_object_context_cache_shards),
   snapset_contexts_lock("ReplicatedPG::snapset_contexts"),
   backfills_in_flight(hobject_t::Comparator(true)),
   pending_backfill_updates(hobject_t::Comparator(true)),
@@ -1401,6 +1415,10 @@ void ReplicatedPG::do_op(OpRequestRef& op)
 {
   MOSDOp *m = static_cast<MOSDOp*>(op->get_req());
   assert(m->get_type() == CEPH_MSG_OSD_OP);
+
+  if (m->trace.enabled())
+    m->trace.add(osd_optrace_t::STAGE_OSD_DEQUEUE);
+
   if (op->includes_pg_op()) {
     if (pg_op_must_wait(m)) {
       wait_for_all_missing(op);
@@ -1602,6 +1620,11 @@ void ReplicatedPG::do_op(OpRequestRef& op)
     }
   }
 
+  if (temp_sampler.enabled() && !op->temp_sampled) {
+    temp_sampler.access(oid, m->get_recv_stamp());
+    op->temp_sampled = true;
+  }
+
   if (agent_state) {
     if (agent_choose_mode(false, op))
       return;
@@ -1937,7 +1960,7 @@ bool ReplicatedPG::maybe_handle_cache(OpRequestRef op,
                                   OpRequestRef());
       }
       // purge the object in the cache if not promoting
-      if (!promoting) {
+      if (!promoting && obc.get()) {
 	object_contexts.purge(obc->obs.oi.soid);
       }
     } else {
@@ -2035,47 +2058,50 @@ bool ReplicatedPG::maybe_promote(ObjectContextRef obc,
 
   switch (recency) {
   case 0:
-    promote_object(obc, missing_oid, oloc, promote_op);
     break;
   case 1:
     // Check if in the current hit set
-    if (in_hit_set) {
-      promote_object(obc, missing_oid, oloc, promote_op);
-    } else {
+    if (!in_hit_set) {
       // not promoting
       return false;
     }
     break;
   default:
-    if (in_hit_set) {
-      promote_object(obc, missing_oid, oloc, promote_op);
-    } else {
+    if (!in_hit_set) {
       // Check if in other hit sets
-      map<time_t,HitSetRef>::iterator itor;
+      const hobject_t &soid = obc.get() ? obc->obs.oi.soid : missing_oid;
       bool in_other_hit_sets = false;
-      for (itor = agent_state->hit_set_map.begin(); itor != agent_state->hit_set_map.end(); ++itor) {
-        if (obc.get()) {
-          if (obc->obs.oi.soid != hobject_t() && itor->second->contains(obc->obs.oi.soid)) {
-            in_other_hit_sets = true;
-            break;
-          }
-        } else {
-          if (missing_oid != hobject_t() && itor->second->contains(missing_oid)) {
-            in_other_hit_sets = true;
-            break;
-          }
-        }
+      if (soid != hobject_t()) {
+	HitSetRef hsu = agent_state->get_hit_set_union();
+	if (hsu) {
+	  // one containment query against the merged set
+	  in_other_hit_sets = hsu->contains(soid);
+	} else {
+	  // sets aren't mergeable (mixed types or legacy folds)
+	  map<time_t,HitSetRef>::iterator itor;
+	  for (itor = agent_state->hit_set_map.begin();
+	       itor != agent_state->hit_set_map.end();
+	       ++itor) {
+	    if (itor->second->contains(soid)) {
+	      in_other_hit_sets = true;
+	      break;
+	    }
+	  }
+	}
       }
-      if (in_other_hit_sets) {
-        promote_object(obc, missing_oid, oloc, promote_op);
-      } else {
+      if (!in_other_hit_sets) {
 	// not promoting
-        return false;
+	return false;
       }
     }
     break;
   }
 
+  if (osd->promote_throttle()) {
+    dout(10) << __func__ << " promote throttled" << dendl;
+    return false;
+  }
+  promote_object(obc, missing_oid, oloc, promote_op);
   return true;
 }
 
@@ -2649,7 +2675,7 @@ void ReplicatedPG::execute_ctx(OpContext *ctx)
   calc_trim_to();
 
   // verify that we are doing this in order?
-  if (cct->_conf->osd_debug_op_order && m->get_source().is_client() &&
+  if (osd->op_conf()->debug_op_order && m->get_source().is_client() &&
       !pool.info.is_tier() && !pool.info.has_tiers()) {
     map<client_t,ceph_tid_t>& cm = debug_op_order[obc->obs.oi.soid];
     ceph_tid_t t = m->get_tid();
@@ -2721,6 +2747,7 @@ void ReplicatedPG::log_op_stats(OpContext *ctx)
   osd->logger->inc(l_osd_op_inb, inb);
   osd->logger->tinc(l_osd_op_lat, latency);
   osd->logger->tinc(l_osd_op_process_lat, process_latency);
+  osd->observe_op_latency(latency);
 
   if (op->may_read() && op->may_write()) {
     osd->logger->inc(l_osd_op_rw);
@@ -2898,7 +2925,7 @@ void ReplicatedPG::do_backfill(OpRequestRef op)
 	get_osdmap()->get_epoch(),
 	m->query_epoch,
 	spg_t(info.pgid.pgid, primary.shard));
-      reply->set_priority(cct->_conf->osd_recovery_op_priority);
+      reply->set_priority(osd->op_conf()->recovery_op_priority);
       osd->send_message_osd_cluster(reply, m->get_connection());
       queue_peering_event(
 	CephPeeringEvtRef(
@@ -3576,6 +3603,46 @@ struct FillInExtent : public Context {
   }
 };
 
+/**
+ * Like FillInExtent, but for replicated-pool async reads: also records
+ * the per-op result and, for whole-object reads, verifies the stored
+ * data digest just as the synchronous path does.
+ */
+struct FillInVerifyExtent : public Context {
+  ceph_le64 *r;
+  int32_t *rval;
+  bufferlist *outdatap;
+  boost::optional<uint32_t> maybe_crc;
+  uint64_t size;
+  OSDService *osd;
+  hobject_t soid;
+  FillInVerifyExtent(ceph_le64 *r, int32_t *rv, bufferlist *blp,
+		     boost::optional<uint32_t> mc, uint64_t size,
+		     OSDService *osd, hobject_t soid)
+    : r(r), rval(rv), outdatap(blp), maybe_crc(mc),
+      size(size), osd(osd), soid(soid) {}
+  void finish(int len) {
+    if (len < 0) {
+      *rval = len;
+      return;
+    }
+    *r = len;
+    *rval = 0;
+    // whole object?  can we verify the checksum?
+    if (maybe_crc && (uint64_t)len == size && size > 0) {
+      uint32_t crc = outdatap->crc32c(-1);
+      if (maybe_crc != crc) {
+	osd->clog->error() << std::hex << "full-object read crc 0x" << crc
+			   << " != expected 0x" << *maybe_crc
+			   << std::dec << " on " << soid;
+	// FIXME fall back to replica or something?
+	if (osd->op_conf()->read_eio_on_bad_digest)
+	  *rval = -EIO;
+      }
+    }
+  }
+};
+
 template<typename V>
 static string list_keys(const map<string, V>& m) {
   string s;
@@ -3616,6 +3683,96 @@ bool ReplicatedPG::maybe_create_new_object(OpContext *ctx)
   return false;
 }
 
+bool ReplicatedPG::maybe_compress_for_writefull(bufferlist& in, bufferlist *out,
+						string *alg)
+{
+  if (!pool.info.has_flag(pg_pool_t::FLAG_COMPRESS) ||
+      pool.info.require_rollback())
+    return false;
+  *alg = pool.info.compression_algorithm.empty() ?
+    cct->_conf->async_compressor_type : pool.info.compression_algorithm;
+  AsyncCompressor *ac = osd->get_compressor(*alg, pool.info.compression_level);
+  if (!ac)
+    return false;
+  if (in.length() < cct->_conf->osd_compress_min_size)
+    return false;
+  bool finished;
+  uint64_t id = ac->async_compress(in);
+  if (ac->get_compress_data(id, *out, true, &finished) < 0) {
+    dout(10) << __func__ << " compress job failed, storing raw" << dendl;
+    out->clear();
+    return false;
+  }
+  if (out->length() >= in.length()) {
+    // incompressible; not worth the decompress on every read
+    out->clear();
+    return false;
+  }
+  return true;
+}
+
+int ReplicatedPG::decompress_object_data(const object_info_t& oi,
+					 bufferlist& cbl,
+					 bufferlist *out)
+{
+  assert(oi.is_compressed());
+  string alg = oi.compression_algorithm.empty() ?
+    cct->_conf->async_compressor_type : oi.compression_algorithm;
+  AsyncCompressor *ac = osd->get_compressor(alg, 0);
+  if (!ac) {
+    osd->clog->error() << "cannot decompress " << oi.soid
+		       << ": codec " << alg << " unavailable";
+    return -EIO;
+  }
+  if (oi.is_data_digest()) {
+    // the digest covers the on-disk (compressed) bytes
+    uint32_t crc = cbl.crc32c(-1);
+    if (crc != oi.data_digest) {
+      osd->clog->error() << info.pgid << std::hex
+			 << " compressed read crc 0x" << crc
+			 << " != expected 0x" << oi.data_digest
+			 << std::dec << " on " << oi.soid;
+      if (osd->op_conf()->read_eio_on_bad_digest)
+	return -EIO;
+    }
+  }
+  bool finished;
+  uint64_t id = ac->async_decompress(cbl);
+  int r = ac->get_decompress_data(id, *out, true, &finished);
+  if (r < 0) {
+    osd->clog->error() << "failed to decompress " << oi.soid;
+    return -EIO;
+  }
+  if (out->length() != oi.size) {
+    osd->clog->error() << "decompressed " << oi.soid << " to "
+		       << out->length() << " bytes, expected " << oi.size;
+    return -EIO;
+  }
+  return 0;
+}
+
+int ReplicatedPG::maybe_decompress_for_write(OpContext *ctx)
+{
+  ObjectState& obs = ctx->new_obs;
+  object_info_t& oi = obs.oi;
+  if (!oi.is_compressed())
+    return 0;
+  bufferlist cbl, raw;
+  int r = pgbackend->objects_read_sync(oi.soid, 0, oi.compressed_size, 0, &cbl);
+  if (r < 0)
+    return r;
+  r = decompress_object_data(oi, cbl, &raw);
+  if (r < 0)
+    return r;
+  dout(10) << __func__ << " " << oi.soid << " rewriting raw "
+	   << oi.compressed_size << " -> " << raw.length() << dendl;
+  ctx->mod_desc.mark_unrollbackable();
+  ctx->op_t->write(oi.soid, 0, raw.length(), raw, 0);
+  oi.clear_compressed();
+  oi.set_data_digest(raw.crc32c(-1));
+  return 0;
+}
+
 int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 {
   int result = 0;
@@ -3630,6 +3787,38 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 
   dout(10) << "do_osd_op " << soid << " " << ops << dendl;
 
+  // shape classified at decode time: the dominant single-op read and
+  // write patterns carry no multi ops and a fixed user_modify answer,
+  // so the per-op classification below can be skipped for them
+  int op_shape = MOSDOp::SHAPE_OTHER;
+  if (ctx->op) {
+    MOSDOp *m = static_cast<MOSDOp *>(ctx->op->get_req());
+    op_shape = m->get_op_shape();
+    // internal callers hand us synthesized op vectors; make sure this
+    // is really the client's classified vector
+    switch (op_shape) {
+    case MOSDOp::SHAPE_SINGLE_READ:
+      if (ops.size() != 1 ||
+	  (ops[0].op.op != CEPH_OSD_OP_READ &&
+	   ops[0].op.op != CEPH_OSD_OP_SYNC_READ))
+	op_shape = MOSDOp::SHAPE_OTHER;
+      break;
+    case MOSDOp::SHAPE_SINGLE_WRITE:
+      if (ops.size() != 1 ||
+	  (ops[0].op.op != CEPH_OSD_OP_WRITE &&
+	   ops[0].op.op != CEPH_OSD_OP_WRITEFULL))
+	op_shape = MOSDOp::SHAPE_OTHER;
+      break;
+    case MOSDOp::SHAPE_WRITE_STAT:
+      if (ops.size() != 2 || ops[0].op.op != CEPH_OSD_OP_WRITE)
+	op_shape = MOSDOp::SHAPE_OTHER;
+      break;
+    }
+  }
+  if (op_shape == MOSDOp::SHAPE_SINGLE_WRITE ||
+      op_shape == MOSDOp::SHAPE_WRITE_STAT)
+    ctx->user_modify = true;
+
   for (vector<OSDOp>::iterator p = ops.begin(); p != ops.end(); ++p, ctx->current_osd_subop_num++) {
     OSDOp& osd_op = *p;
     ceph_osd_op& op = osd_op.op;
@@ -3644,23 +3833,25 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 
     bufferlist::iterator bp = osd_op.indata.begin();
 
-    // user-visible modifcation?
-    switch (op.op) {
-      // non user-visible modifications
-    case CEPH_OSD_OP_WATCH:
-    case CEPH_OSD_OP_CACHE_EVICT:
-    case CEPH_OSD_OP_CACHE_FLUSH:
-    case CEPH_OSD_OP_CACHE_TRY_FLUSH:
-    case CEPH_OSD_OP_UNDIRTY:
-    case CEPH_OSD_OP_COPY_FROM:  // we handle user_version update explicitly
-      break;
-    default:
-      if (op.op & CEPH_OSD_OP_MODE_WR)
-	ctx->user_modify = true;
+    // user-visible modifcation?  (precomputed for the classified shapes)
+    if (op_shape == MOSDOp::SHAPE_OTHER) {
+      switch (op.op) {
+	// non user-visible modifications
+      case CEPH_OSD_OP_WATCH:
+      case CEPH_OSD_OP_CACHE_EVICT:
+      case CEPH_OSD_OP_CACHE_FLUSH:
+      case CEPH_OSD_OP_CACHE_TRY_FLUSH:
+      case CEPH_OSD_OP_UNDIRTY:
+      case CEPH_OSD_OP_COPY_FROM:  // we handle user_version update explicitly
+	break;
+      default:
+	if (op.op & CEPH_OSD_OP_MODE_WR)
+	  ctx->user_modify = true;
+      }
     }
 
     ObjectContextRef src_obc;
-    if (ceph_osd_op_type_multi(op.op)) {
+    if (op_shape == MOSDOp::SHAPE_OTHER && ceph_osd_op_type_multi(op.op)) {
       MOSDOp *m = static_cast<MOSDOp *>(ctx->op->get_req());
       object_locator_t src_oloc;
       get_src_oloc(soid.oid, m->get_object_locator(), src_oloc);
@@ -3682,9 +3873,9 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
     // munge ZERO -> TRUNCATE?  (don't munge to DELETE or we risk hosing attributes)
     if (op.op == CEPH_OSD_OP_ZERO &&
 	obs.exists &&
-	op.extent.offset < cct->_conf->osd_max_object_size &&
+	op.extent.offset < osd->op_conf()->max_object_size &&
 	op.extent.length >= 1 &&
-	op.extent.length <= cct->_conf->osd_max_object_size &&
+	op.extent.length <= osd->op_conf()->max_object_size &&
 	op.extent.offset + op.extent.length >= oi.size) {
       if (op.extent.offset >= oi.size) {
         // no-op
@@ -3737,6 +3928,41 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	      boost::make_tuple(op.extent.offset, op.extent.length, op.flags),
 	      make_pair(&osd_op.outdata, new FillInExtent(&op.extent.length))));
 	  dout(10) << " async_read noted for " << soid << dendl;
+	} else if (op.op == CEPH_OSD_OP_READ &&
+		   !oi.is_compressed() &&
+		   osd->op_conf()->op_async_reads) {
+	  // free up this op thread while the disk seeks; the whole-object
+	  // digest check moves into the completion callback
+	  boost::optional<uint32_t> maybe_crc;
+	  if (oi.is_data_digest() && op.extent.offset == 0 &&
+	      op.extent.length == oi.size)
+	    maybe_crc = oi.data_digest;
+	  ctx->pending_async_reads.push_back(
+	    make_pair(
+	      boost::make_tuple(op.extent.offset, op.extent.length, op.flags),
+	      make_pair(&osd_op.outdata,
+			new FillInVerifyExtent(&op.extent.length, &osd_op.rval,
+					       &osd_op.outdata, maybe_crc,
+					       oi.size, osd, soid))));
+	  dout(10) << " async_read noted for " << soid << dendl;
+	} else if (oi.is_compressed()) {
+	  // must read and decompress the whole object to serve any extent
+	  bufferlist cbl, raw;
+	  int r = pgbackend->objects_read_sync(
+	    soid, 0, oi.compressed_size, op.flags, &cbl);
+	  if (r >= 0)
+	    r = decompress_object_data(oi, cbl, &raw);
+	  if (r < 0) {
+	    result = r;
+	    op.extent.length = 0;
+	  } else {
+	    if (op.extent.length == 0)  // zero length read: to the end
+	      op.extent.length = size - op.extent.offset;
+	    osd_op.outdata.substr_of(raw, op.extent.offset, op.extent.length);
+	  }
+	  dout(10) << " read " << op.extent.length << "@" << op.extent.offset
+		   << " of compressed obj " << soid
+		   << " (" << oi.compressed_size << " ondisk)" << dendl;
 	} else {
 	  int r = pgbackend->objects_read_sync(
 	    soid, op.extent.offset, op.extent.length, op.flags, &osd_op.outdata);
@@ -3760,7 +3986,7 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 				 << " != expected 0x" << oi.data_digest
 				 << std::dec << " on " << soid;
 	      // FIXME fall back to replica or something?
-	      if (g_conf->osd_read_eio_on_bad_digest)
+	      if (osd->op_conf()->read_eio_on_bad_digest)
 		result = -EIO;
 	    }
 	  }
@@ -3782,6 +4008,11 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	result = -EOPNOTSUPP;
 	break;
       }
+      if (oi.is_compressed()) {
+	// on-disk extents don't correspond to logical offsets
+	result = -EOPNOTSUPP;
+	break;
+      }
       ++ctx->num_read;
       {
 	// read into a buffer
@@ -3806,6 +4037,11 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	result = -EOPNOTSUPP;
 	break;
       }
+      if (oi.is_compressed()) {
+	// on-disk extents don't correspond to logical offsets
+	result = -EOPNOTSUPP;
+	break;
+      }
       ++ctx->num_read;
       {
         if (op.extent.truncate_seq) {
@@ -3831,7 +4067,7 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	uint64_t last = op.extent.offset;
         for (miter = m.begin(); miter != m.end(); ++miter) {
 	  // verify hole?
-	  if (cct->_conf->osd_verify_sparse_read_holes &&
+	  if (osd->op_conf()->verify_sparse_read_holes &&
 	      last < miter->first) {
 	    bufferlist t;
 	    uint64_t len = miter->first - last;
@@ -3856,7 +4092,7 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
         }
 
 	// verify trailing hole?
-	if (cct->_conf->osd_verify_sparse_read_holes) {
+	if (osd->op_conf()->verify_sparse_read_holes) {
 	  uint64_t end = MIN(op.extent.offset + op.extent.length, oi.size);
 	  if (last < end) {
 	    bufferlist t;
@@ -4273,7 +4509,7 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 
           dout(20) << " clone " << *clone_iter << " snaps " << ci.snaps << dendl;
 
-          map<snapid_t, interval_set<uint64_t> >::const_iterator coi;
+          map<snapid_t, flat_interval_set<uint64_t> >::const_iterator coi;
           coi = ssc->snapset.clone_overlap.find(ci.cloneid);
           if (coi == ssc->snapset.clone_overlap.end()) {
             osd->clog->error() << "osd." << osd->whoami << ": inconsistent clone_overlap found for oid "
@@ -4281,9 +4517,9 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
             result = -EINVAL;
             break;
           }
-          const interval_set<uint64_t> &o = coi->second;
+          const flat_interval_set<uint64_t> &o = coi->second;
           ci.overlap.reserve(o.num_intervals());
-          for (interval_set<uint64_t>::const_iterator r = o.begin();
+          for (flat_interval_set<uint64_t>::const_iterator r = o.begin();
                r != o.end(); ++r) {
             ci.overlap.push_back(pair<uint64_t,uint64_t>(r.get_start(), r.get_len()));
           }
@@ -4432,6 +4668,18 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	  break;
 	}
 
+	if (obs.exists && oi.is_compressed()) {
+	  if (op.extent.offset == 0 && op.extent.length >= oi.size) {
+	    // full overwrite; the old compressed bytes are fully covered
+	    oi.clear_compressed();
+	  } else {
+	    // partial overwrite; rewrite the object raw first
+	    result = maybe_decompress_for_write(ctx);
+	    if (result < 0)
+	      break;
+	  }
+	}
+
 	if (!obs.exists) {
 	  if (pool.info.require_rollback() && op.extent.offset) {
 	    result = -EOPNOTSUPP;
@@ -4505,6 +4753,10 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
       { // write full object
 	tracepoint(osd, do_osd_op_pre_writefull, soid.oid.name.c_str(), soid.snap.val, oi.size, 0, op.extent.length);
 
+	ctx->full_overwrite = true;
+
+	bufferlist cbl;  // compressed blob, if we end up storing one
+	string calg;     // and the codec it was compressed with
 	if (op.extent.length != osd_op.indata.length()) {
 	  result = -EINVAL;
 	  break;
@@ -4544,13 +4796,28 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	  }
 	} else {
 	  ctx->mod_desc.mark_unrollbackable();
-	  t->write(soid, 0, op.extent.length, osd_op.indata, op.flags);
-	  if (obs.exists && op.extent.length < oi.size) {
-	    t->truncate(soid, op.extent.length);
+	  uint64_t old_ondisk = obs.exists ? oi.ondisk_size() : 0;
+	  if (maybe_compress_for_writefull(osd_op.indata, &cbl, &calg)) {
+	    dout(10) << " writefull compressed " << op.extent.length
+		     << " -> " << cbl.length() << " on " << soid << dendl;
+	    t->write(soid, 0, cbl.length(), cbl, op.flags);
+	    if (obs.exists && cbl.length() < old_ondisk)
+	      t->truncate(soid, cbl.length());
+	  } else {
+	    t->write(soid, 0, op.extent.length, osd_op.indata, op.flags);
+	    if (obs.exists && op.extent.length < old_ondisk)
+	      t->truncate(soid, op.extent.length);
 	  }
 	}
 	maybe_create_new_object(ctx);
-	obs.oi.set_data_digest(osd_op.indata.crc32c(-1));
+	if (cbl.length()) {
+	  // the digest covers the on-disk (compressed) bytes
+	  obs.oi.set_compressed(cbl.length(), calg);
+	  obs.oi.set_data_digest(cbl.crc32c(-1));
+	} else {
+	  obs.oi.clear_compressed();
+	  obs.oi.set_data_digest(osd_op.indata.crc32c(-1));
+	}
 
 	write_update_size_and_usage(ctx->delta_stats, oi, ctx->modified_ranges,
 	    0, op.extent.length, true, op.extent.length != oi.size ? true : false);
@@ -4577,6 +4844,11 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	assert(op.extent.length);
 	if (obs.exists && !oi.is_whiteout()) {
 	  ctx->mod_desc.mark_unrollbackable();
+	  if (oi.is_compressed()) {
+	    result = maybe_decompress_for_write(ctx);
+	    if (result < 0)
+	      break;
+	  }
 	  t->zero(soid, op.extent.offset, op.extent.length);
 	  interval_set<uint64_t> ch;
 	  ch.insert(op.extent.offset, op.extent.length);
@@ -4656,6 +4928,17 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	  oi.truncate_size = op.extent.truncate_size;
 	}
 
+	if (oi.is_compressed()) {
+	  if (op.extent.offset == 0) {
+	    // nothing survives the truncate
+	    oi.clear_compressed();
+	  } else {
+	    result = maybe_decompress_for_write(ctx);
+	    if (result < 0)
+	      break;
+	  }
+	}
+
 	t->truncate(soid, op.extent.offset);
 	if (oi.size > op.extent.offset) {
 	  interval_set<uint64_t> trim;
@@ -4687,9 +4970,19 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	result = -EOPNOTSUPP;
 	break;
       }
+      if (src_obc->obs.oi.is_compressed()) {
+	// source bytes on disk are not the logical bytes
+	result = -EOPNOTSUPP;
+	break;
+      }
       ++ctx->num_read;
       ++ctx->num_write;
       {
+	if (obs.exists && oi.is_compressed()) {
+	  result = maybe_decompress_for_write(ctx);
+	  if (result < 0)
+	    break;
+	}
 	if (maybe_create_new_object(ctx)) {
 	  t->touch(obs.oi.soid);
 	}
@@ -5468,6 +5761,7 @@ inline int ReplicatedPG::_delete_oid(OpContext *ctx, bool no_whiteout)
     ctx->delta_stats.num_bytes -= oi.size;
   }
   oi.size = 0;
+  oi.clear_compressed();
   oi.new_object();
 
   // disconnect all watchers
@@ -5591,9 +5885,9 @@ int ReplicatedPG::_rollback_to(OpContext *ctx, ceph_osd_op& op)
       t->clone(rollback_to_sobject, soid);
       snapset.head_exists = true;
 
-      map<snapid_t, interval_set<uint64_t> >::iterator iter =
+      map<snapid_t, flat_interval_set<uint64_t> >::iterator iter =
 	snapset.clone_overlap.lower_bound(snapid);
-      interval_set<uint64_t> overlaps = iter->second;
+      flat_interval_set<uint64_t> overlaps = iter->second;
       assert(iter != snapset.clone_overlap.end());
       for ( ;
 	    iter != snapset.clone_overlap.end();
@@ -5621,6 +5915,12 @@ int ReplicatedPG::_rollback_to(OpContext *ctx, ceph_osd_op& op)
 	obs.oi.set_omap_digest(rollback_to->obs.oi.omap_digest);
       else
 	obs.oi.clear_omap_digest();
+      // the clone's bytes (and thus its compression state) are now ours
+      if (rollback_to->obs.oi.is_compressed())
+	obs.oi.set_compressed(rollback_to->obs.oi.compressed_size,
+			      rollback_to->obs.oi.compression_algorithm);
+      else
+	obs.oi.clear_compressed();
       snapset.head_exists = true;
     }
   }
@@ -5642,6 +5942,31 @@ void ReplicatedPG::_make_clone(
   rmattr_maybe_cache(obc, ctx, t, SS_ATTR);
 }
 
+void ReplicatedPG::_rename_into_clone(
+  OpContext *ctx,
+  PGBackend::PGTransaction* t,
+  ObjectContextRef obc,
+  const hobject_t& head, const hobject_t& coid,
+  object_info_t *poi,
+  map<string, bufferlist>& head_attrs)
+{
+  bufferlist bv;
+  ::encode(*poi, bv);
+
+  // the head's bytes exist only to become the clone; rename them into
+  // place instead of copying them, and recreate the head so the op
+  // transaction appended after us can fill it back in
+  t->rename(head, coid);
+  setattr_maybe_cache(obc, ctx, t, OI_ATTR, bv);
+  rmattr_maybe_cache(obc, ctx, t, SS_ATTR);
+
+  t->touch(head);
+  head_attrs.erase(OI_ATTR);   // finish_ctx writes fresh OI and SS attrs
+  head_attrs.erase(SS_ATTR);
+  if (!head_attrs.empty())
+    t->setattrs(head, head_attrs);
+}
+
 void ReplicatedPG::make_writeable(OpContext *ctx)
 {
   const hobject_t& soid = ctx->obs->oi.soid;
@@ -5737,9 +6062,38 @@ void ReplicatedPG::make_writeable(OpContext *ctx)
     snap_oi->copy_user_bits(ctx->obs->oi);
     snap_oi->snaps = snaps;
 
+    // If a single op is about to replace the entire object, the head's
+    // current content exists only to become the clone; rename the head
+    // into place instead of copying every byte.  Skip objects with omap
+    // (the overwrite would not restore it) and ec-backed pools (rollback
+    // relies on the stashed generations).
+    bool clone_by_rename = false;
+    map<string, bufferlist> head_attrs;
+    if (ctx->full_overwrite &&
+	ctx->ops.size() == 1 &&
+	ctx->new_obs.exists &&
+	!ctx->obs->oi.is_omap() &&
+	!pool.info.require_rollback()) {
+      // a prior write on this object may still be journaled but
+      // unapplied, and a pure-write op takes no ondisk_read_lock in
+      // execute_ctx; take it here so the store read cannot return
+      // stale attrs that the recreated head would then inherit
+      ctx->obc->ondisk_read_lock();
+      int r = pgbackend->objects_get_attrs(soid, &head_attrs);
+      ctx->obc->ondisk_read_unlock();
+      clone_by_rename = (r == 0);
+    }
+
     // prepend transaction to op_t
     PGBackend::PGTransaction *t = pgbackend->get_transaction();
-    _make_clone(ctx, t, ctx->clone_obc, soid, coid, snap_oi);
+    if (clone_by_rename) {
+      dout(10) << " renaming head into clone " << coid
+	       << " instead of copying" << dendl;
+      _rename_into_clone(ctx, t, ctx->clone_obc, soid, coid, snap_oi,
+			 head_attrs);
+    } else {
+      _make_clone(ctx, t, ctx->clone_obc, soid, coid, snap_oi);
+    }
     t->append(ctx->op_t);
     delete ctx->op_t;
     ctx->op_t = t;
@@ -5782,7 +6136,7 @@ void ReplicatedPG::make_writeable(OpContext *ctx)
     hobject_t last_clone_oid = soid;
     last_clone_oid.snap = ctx->new_snapset.clone_overlap.rbegin()->first;
     if (is_present_clone(last_clone_oid)) {
-      interval_set<uint64_t> &newest_overlap = ctx->new_snapset.clone_overlap.rbegin()->second;
+      flat_interval_set<uint64_t> &newest_overlap = ctx->new_snapset.clone_overlap.rbegin()->second;
       ctx->modified_ranges.intersection_of(newest_overlap);
       // modified_ranges is still in use by the clone
       add_interval_usage(ctx->modified_ranges, ctx->delta_stats);
@@ -6189,6 +6543,11 @@ void ReplicatedPG::complete_read_ctx(int result, OpContext *ctx)
   assert(ctx->async_reads_complete());
 
   for (vector<OSDOp>::iterator p = ctx->ops.begin(); p != ctx->ops.end(); ++p) {
+    // errors from the async read callbacks surface via per-op rvals;
+    // errors already folded into result by do_osd_ops stay as they were
+    if (result >= 0 && p->rval < 0 &&
+	!(p->op.flags & CEPH_OSD_OP_FLAG_FAILOK))
+      result = p->rval;
     ctx->bytes_read += p->outdata.length();
   }
   ctx->reply->claim_op_out_data(ctx->ops);
@@ -6311,7 +6670,9 @@ int ReplicatedPG::fill_in_copy_get(
     assert(obc->ssc);
     reply_obj.snap_seq = obc->ssc->snapset.seq;
   }
-  if (oi.is_data_digest()) {
+  if (oi.is_data_digest() && !oi.is_compressed()) {
+    // for compressed objects the digest covers the on-disk bytes, not
+    // the logical data we are returning here
     reply_obj.flags |= object_copy_data_t::FLAG_DATA_DIGEST;
     reply_obj.data_digest = oi.data_digest;
   }
@@ -6352,6 +6713,16 @@ int ReplicatedPG::fill_in_copy_get(
 	    make_pair(&bl, cb)));
         result = left;
 	cb->len = result;
+      } else if (oi.is_compressed()) {
+	bufferlist cbl, raw;
+	result = pgbackend->objects_read_sync(
+	  oi.soid, 0, oi.compressed_size, osd_op.op.flags, &cbl);
+	if (result >= 0)
+	  result = decompress_object_data(oi, cbl, &raw);
+	if (result < 0)
+	  return result;
+	bl.substr_of(raw, cursor.data_offset, left);
+	result = left;
       } else {
 	result = pgbackend->objects_read_sync(
 	  oi.soid, cursor.data_offset, left, osd_op.op.flags, &bl);
@@ -6848,6 +7219,7 @@ void ReplicatedPG::finish_copyfrom(OpContext *ctx)
   // CopyFromCallback fills this in for us
   obs.oi.user_version = ctx->user_at_version;
 
+  obs.oi.clear_compressed();  // copied data is written raw
   obs.oi.set_data_digest(cb->results->data_digest);
   obs.oi.set_omap_digest(cb->results->omap_digest);
 
@@ -7027,6 +7399,7 @@ void ReplicatedPG::finish_promote(int r, CopyResults *results,
     }
     tctx->new_obs.oi.size = results->object_size;
     tctx->new_obs.oi.user_version = results->user_version;
+    tctx->new_obs.oi.clear_compressed();  // promoted data is written raw
     // Don't care src object whether have data or omap digest
     if (results->object_size)
       tctx->new_obs.oi.set_data_digest(results->data_digest);
@@ -7066,6 +7439,7 @@ void ReplicatedPG::finish_promote(int r, CopyResults *results,
   simple_repop_submit(repop);
 
   osd->logger->inc(l_osd_tier_promote);
+  osd->promote_finish(results->object_size);
 }
 
 void ReplicatedPG::cancel_copy(CopyOpRef cop, bool requeue)
@@ -7556,16 +7930,22 @@ bool ReplicatedPG::is_present_clone(hobject_t coid)
 // ========================================================================
 // rep op gather
 
-class C_OSD_RepopApplied : public Context {
-  ReplicatedPGRef pg;
-  boost::intrusive_ptr<ReplicatedPG::RepGather> repop;
-public:
-  C_OSD_RepopApplied(ReplicatedPG *pg, ReplicatedPG::RepGather *repop)
-  : pg(pg), repop(repop) {}
-  void finish(int) {
-    pg->repop_all_applied(repop.get());
-  }
-};
+void ReplicatedPG::RepGather::AppliedFrame::finish(int)
+{
+  RepGather *r = repop;
+  repop = NULL;
+  pg->repop_all_applied(r);
+  pg = ReplicatedPGRef();
+  r->put();   // may free the RepGather (and this frame); touch nothing after
+}
+
+void ReplicatedPG::RepGather::AppliedFrame::abandon()
+{
+  RepGather *r = repop;
+  repop = NULL;
+  pg = ReplicatedPGRef();
+  r->put();
+}
 
 
 void ReplicatedPG::repop_all_applied(RepGather *repop)
@@ -7573,6 +7953,11 @@ void ReplicatedPG::repop_all_applied(RepGather *repop)
   dout(10) << __func__ << ": repop tid " << repop->rep_tid << " all applied "
 	   << dendl;
   repop->all_applied = true;
+  if (repop->ctx->op) {
+    MOSDOp *m = static_cast<MOSDOp *>(repop->ctx->op->get_req());
+    if (m->trace.enabled())
+      m->trace.add(osd_optrace_t::STAGE_OSD_APPLIED);
+  }
   if (!repop->rep_aborted) {
     eval_repop(repop);
     if (repop->on_applied) {
@@ -7582,22 +7967,58 @@ void ReplicatedPG::repop_all_applied(RepGather *repop)
   }
 }
 
-class C_OSD_RepopCommit : public Context {
-  ReplicatedPGRef pg;
-  boost::intrusive_ptr<ReplicatedPG::RepGather> repop;
-public:
-  C_OSD_RepopCommit(ReplicatedPG *pg, ReplicatedPG::RepGather *repop)
-    : pg(pg), repop(repop) {}
-  void finish(int) {
-    pg->repop_all_committed(repop.get());
-  }
-};
+void ReplicatedPG::RepGather::CommitFrame::finish(int)
+{
+  RepGather *r = repop;
+  repop = NULL;
+  pg->repop_all_committed(r);
+  pg = ReplicatedPGRef();
+  r->put();   // may free the RepGather (and this frame); touch nothing after
+}
+
+void ReplicatedPG::RepGather::CommitFrame::abandon()
+{
+  RepGather *r = repop;
+  repop = NULL;
+  pg = ReplicatedPGRef();
+  r->put();
+}
+
+void ReplicatedPG::RepGather::OndiskUnlockFrame::finish(int)
+{
+  obc->ondisk_write_unlock();
+  if (clone_obc)
+    clone_obc->ondisk_write_unlock();
+  if (snapset_obc)
+    snapset_obc->ondisk_write_unlock();
+  for (list<ObjectContextRef>::iterator i = extra_obcs.begin();
+       i != extra_obcs.end();
+       ++i)
+    (*i)->ondisk_write_unlock();
+  abandon();   // drops the obc refs and repop ref
+}
+
+void ReplicatedPG::RepGather::OndiskUnlockFrame::abandon()
+{
+  obc = ObjectContextRef();
+  clone_obc = ObjectContextRef();
+  snapset_obc = ObjectContextRef();
+  extra_obcs.clear();
+  RepGather *r = repop;
+  repop = NULL;
+  r->put();   // may free the RepGather (and this frame); touch nothing after
+}
 
 void ReplicatedPG::repop_all_committed(RepGather *repop)
 {
   dout(10) << __func__ << ": repop tid " << repop->rep_tid << " all committed "
 	   << dendl;
   repop->all_committed = true;
+  if (repop->ctx->op) {
+    MOSDOp *m = static_cast<MOSDOp *>(repop->ctx->op->get_req());
+    if (m->trace.enabled())
+      m->trace.add(osd_optrace_t::STAGE_OSD_COMMITTED);
+  }
 
   if (!repop->rep_aborted) {
     if (repop->v != eversion_t()) {
@@ -7695,6 +8116,12 @@ void ReplicatedPG::eval_repop(RepGather *repop)
 				  repop->ctx->user_at_version);
       }
       reply->add_flags(CEPH_OSD_FLAG_ACK | CEPH_OSD_FLAG_ONDISK);
+      if (m->trace.enabled()) {
+	// a preconstructed reply copied the trace before the journal and
+	// apply stamps existed; refresh it
+	reply->trace = m->trace;
+	reply->trace.add(osd_optrace_t::STAGE_OSD_REPLY);
+      }
       dout(10) << " sending commit on " << *repop << " " << reply << dendl;
       osd->send_message_osd_client(reply, m->get_connection());
       repop->sent_disk = true;
@@ -7733,6 +8160,10 @@ void ReplicatedPG::eval_repop(RepGather *repop)
 				  repop->ctx->user_at_version);
       }
       reply->add_flags(CEPH_OSD_FLAG_ACK);
+      if (m->trace.enabled()) {
+	reply->trace = m->trace;
+	reply->trace.add(osd_optrace_t::STAGE_OSD_REPLY);
+      }
       dout(10) << " sending ack on " << *repop << " " << reply << dendl;
       osd->send_message_osd_client(reply, m->get_connection());
       repop->sent_ack = true;
@@ -7806,6 +8237,10 @@ void ReplicatedPG::issue_repop(RepGather *repop)
   repop->obc->ondisk_write_lock();
   if (repop->ctx->clone_obc)
     repop->ctx->clone_obc->ondisk_write_lock();
+  for (list<ObjectContextRef>::iterator i = repop->ctx->extra_evict_obcs.begin();
+       i != repop->ctx->extra_evict_obcs.end();
+       ++i)
+    (*i)->ondisk_write_lock();
 
   bool unlock_snapset_obc = false;
   if (repop->ctx->snapset_obc && repop->ctx->snapset_obc->obs.oi.soid !=
@@ -7825,12 +8260,21 @@ void ReplicatedPG::issue_repop(RepGather *repop)
     }
   }
 
-  Context *on_all_commit = new C_OSD_RepopCommit(this, repop);
-  Context *on_all_applied = new C_OSD_RepopApplied(this, repop);
-  Context *onapplied_sync = new C_OSD_OndiskWriteUnlock(
-    repop->obc,
-    repop->ctx->clone_obc,
-    unlock_snapset_obc ? repop->ctx->snapset_obc : ObjectContextRef());
+  // arm the inline completion frames; each holds a repop ref that its
+  // finish() drops
+  repop->commit_frame.pg = this;
+  repop->commit_frame.repop = repop->get();
+  repop->applied_frame.pg = this;
+  repop->applied_frame.repop = repop->get();
+  repop->unlock_frame.obc = repop->obc;
+  repop->unlock_frame.clone_obc = repop->ctx->clone_obc;
+  if (unlock_snapset_obc)
+    repop->unlock_frame.snapset_obc = repop->ctx->snapset_obc;
+  repop->unlock_frame.extra_obcs = repop->ctx->extra_evict_obcs;
+  repop->unlock_frame.repop = repop->get();
+  Context *on_all_commit = &repop->commit_frame;
+  Context *on_all_applied = &repop->applied_frame;
+  Context *onapplied_sync = &repop->unlock_frame;
   pgbackend->submit_transaction(
     soid,
     repop->ctx->at_version,
@@ -8451,8 +8895,8 @@ void ReplicatedPG::add_object_context_to_pg_stat(ObjectContextRef obc, pg_stat_t
 
     // subtract off clone overlap
     if (obc->ssc->snapset.clone_overlap.count(oi.soid.snap)) {
-      interval_set<uint64_t>& o = obc->ssc->snapset.clone_overlap[oi.soid.snap];
-      for (interval_set<uint64_t>::const_iterator r = o.begin();
+      flat_interval_set<uint64_t>& o = obc->ssc->snapset.clone_overlap[oi.soid.snap];
+      for (flat_interval_set<uint64_t>::const_iterator r = o.begin();
 	   r != o.end();
 	   ++r) {
 	stat.num_bytes -= r.get_len();
@@ -10530,7 +10974,7 @@ hobject_t ReplicatedPG::get_hit_set_current_object(utime_t stamp)
   ss << "hit_set_" << info.pgid.pgid << "_current_" << stamp;
   hobject_t hoid(sobject_t(ss.str(), CEPH_NOSNAP), "",
 		 info.pgid.ps(), info.pgid.pool(),
-		 cct->_conf->osd_hit_set_namespace);
+		 osd->op_conf()->hit_set_namespace);
   dout(20) << __func__ << " " << hoid << dendl;
   return hoid;
 }
@@ -10541,7 +10985,7 @@ hobject_t ReplicatedPG::get_hit_set_archive_object(utime_t start, utime_t end)
   ss << "hit_set_" << info.pgid.pgid << "_archive_" << start << "_" << end;
   hobject_t hoid(sobject_t(ss.str(), CEPH_NOSNAP), "",
 		 info.pgid.ps(), info.pgid.pool(),
-		 cct->_conf->osd_hit_set_namespace);
+		 osd->op_conf()->hit_set_namespace);
   dout(20) << __func__ << " " << hoid << dendl;
   return hoid;
 }
@@ -10824,6 +11268,7 @@ void ReplicatedPG::hit_set_persist()
   obc->obs.oi.mtime = now;
   obc->obs.oi.size = bl.length();
   obc->obs.exists = true;
+  obc->obs.oi.clear_compressed();
   obc->obs.oi.set_data_digest(bl.crc32c(-1));
 
   ctx->new_obs = obc->obs;
@@ -11012,6 +11457,15 @@ bool ReplicatedPG::agent_work(int start_max, int agent_flush_quota)
   int ls_min = 1;
   int ls_max = 10; // FIXME?
 
+  // group simple evictions into a single repop; list enough objects to
+  // be able to fill a batch in one pass
+  list<ObjectContextRef> evict_batch;
+  int evict_batch_max = cct->_conf->osd_agent_max_evict_batch;
+  if (evict_batch_max < 1)
+    evict_batch_max = 1;
+  if (agent_state->evict_mode != TierAgentState::EVICT_MODE_IDLE)
+    ls_max = MAX(ls_max, evict_batch_max);
+
   // list some objects.  this conveniently lists clones (oldest to
   // newest) before heads... the same order we want to flush in.
   //
@@ -11027,7 +11481,7 @@ bool ReplicatedPG::agent_work(int start_max, int agent_flush_quota)
   for (vector<hobject_t>::iterator p = ls.begin();
        p != ls.end();
        ++p) {
-    if (p->nspace == cct->_conf->osd_hit_set_namespace) {
+    if (p->nspace == osd->op_conf()->hit_set_namespace) {
       dout(20) << __func__ << " skip (hit set) " << *p << dendl;
       osd->logger->inc(l_osd_agent_skip);
       continue;
@@ -11083,9 +11537,18 @@ bool ReplicatedPG::agent_work(int start_max, int agent_flush_quota)
       ++started;
       --agent_flush_quota;
     }
-    if (agent_state->evict_mode != TierAgentState::EVICT_MODE_IDLE &&
-	agent_maybe_evict(obc))
-      ++started;
+    if (agent_state->evict_mode != TierAgentState::EVICT_MODE_IDLE) {
+      size_t batched = evict_batch.size();
+      if (agent_maybe_evict(obc, &evict_batch)) {
+	if (evict_batch.size() == batched) {
+	  ++started;  // evicted as its own repop
+	} else if ((int)evict_batch.size() >= evict_batch_max) {
+	  agent_evict_batch(evict_batch);
+	  evict_batch.clear();
+	  ++started;  // one repop for the whole batch
+	}
+      }
+    }
     if (started >= start_max) {
       // If finishing early, set "next" to the next object
       if (++p != ls.end())
@@ -11094,6 +11557,12 @@ bool ReplicatedPG::agent_work(int start_max, int agent_flush_quota)
     }
   }
 
+  if (!evict_batch.empty()) {
+    agent_evict_batch(evict_batch);
+    evict_batch.clear();
+    ++started;
+  }
+
   if (++agent_state->hist_age > g_conf->osd_agent_hist_halflife) {
     dout(20) << __func__ << " resetting atime and temp histograms" << dendl;
     agent_state->hist_age = 0;
@@ -11259,7 +11728,8 @@ bool ReplicatedPG::agent_maybe_flush(ObjectContextRef& obc)
   return true;
 }
 
-bool ReplicatedPG::agent_maybe_evict(ObjectContextRef& obc)
+bool ReplicatedPG::agent_maybe_evict(ObjectContextRef& obc,
+				     list<ObjectContextRef> *evict_batch)
 {
   const hobject_t& soid = obc->obs.oi.soid;
   if (obc->obs.oi.is_dirty()) {
@@ -11344,6 +11814,18 @@ bool ReplicatedPG::agent_maybe_evict(ObjectContextRef& obc)
     return false;
   }
 
+  // simple heads (no clones, no snapdir involvement) can share one
+  // repop; everything else goes through the single-object path below
+  if (evict_batch &&
+      soid.snap == CEPH_NOSNAP &&
+      obc->ssc &&
+      obc->ssc->snapset.clones.empty() &&
+      !pool.info.require_rollback()) {
+    dout(10) << __func__ << " batching evict of " << obc->obs.oi << dendl;
+    evict_batch->push_back(obc);
+    return true;
+  }
+
   dout(10) << __func__ << " evicting " << obc->obs.oi << dendl;
   RepGather *repop = simple_repop_create(obc);
   OpContext *ctx = repop->ctx;
@@ -11363,6 +11845,61 @@ bool ReplicatedPG::agent_maybe_evict(ObjectContextRef& obc)
   return true;
 }
 
+/*
+ * Evict a batch of clean objects with one repop: the deletions share a
+ * single transaction and replication round trip, with one pg log entry
+ * per object at consecutive versions.  All victims hold write locks
+ * (taken in agent_maybe_evict) that are tracked in extra_evict_obcs and
+ * released when the repop completes.  Only simple heads are batched, so
+ * finish_ctx never touches a clone or snapdir while the ctx is pointed
+ * at each victim in turn.
+ */
+void ReplicatedPG::agent_evict_batch(list<ObjectContextRef>& victims)
+{
+  assert(!victims.empty());
+  dout(10) << __func__ << " evicting " << victims.size() << " objects" << dendl;
+
+  ObjectContextRef first = victims.front();
+  RepGather *repop = simple_repop_create(first);
+  OpContext *ctx = repop->ctx;
+  ctx->lock_to_release = OpContext::W_LOCK;
+  ctx->at_version = get_next_version();
+
+  for (list<ObjectContextRef>::iterator p = victims.begin();
+       p != victims.end();
+       ++p) {
+    ObjectContextRef obc = *p;
+    if (obc != first) {
+      ctx->extra_evict_obcs.push_back(obc);
+      ctx->obc = obc;
+      ctx->obs = &obc->obs;
+      ctx->reset_obs(obc);
+      ctx->mod_desc = ObjectModDesc();
+      ctx->at_version.version = ctx->log.back().version.version + 1;
+    }
+    assert(ctx->new_obs.exists);
+    int r = _delete_oid(ctx, true);
+    assert(r == 0);
+    if (obc->obs.oi.is_omap())
+      ctx->delta_stats.num_objects_omap--;
+    ctx->delta_stats.num_evict++;
+    ctx->delta_stats.num_evict_kb += SHIFT_ROUND_UP(obc->obs.oi.size, 10);
+    finish_ctx(ctx, pg_log_entry_t::DELETE, false);
+    // finish_ctx folded delta_stats into the pg stats; start the next
+    // victim's delta from scratch
+    ctx->delta_stats = object_stat_sum_t();
+    osd->logger->inc(l_osd_tier_evict);
+    osd->logger->inc(l_osd_agent_evict);
+  }
+
+  // leave the ctx pointed back at the object the repop was created on;
+  // the other victims' locks are tracked in extra_evict_obcs
+  ctx->obc = first;
+  ctx->obs = &first->obs;
+
+  simple_repop_submit(repop);
+}
+
 void ReplicatedPG::agent_stop()
 {
   dout(20) << __func__ << dendl;
@@ -11709,7 +12246,7 @@ void ReplicatedPG::_scrub(
     if (soid.snap != CEPH_SNAPDIR)
       stat.num_objects++;
 
-    if (soid.nspace == cct->_conf->osd_hit_set_namespace)
+    if (soid.nspace == osd->op_conf()->hit_set_namespace)
       stat.num_objects_hit_set_archive++;
 
     // new snapset?
@@ -11756,12 +12293,12 @@ void ReplicatedPG::_scrub(
     bv.push_back(p->second.attrs[OI_ATTR]);
     object_info_t oi(bv);
 
-    if (pgbackend->be_get_ondisk_size(oi.size) != p->second.size) {
+    if (pgbackend->be_get_ondisk_size(oi.ondisk_size()) != p->second.size) {
       osd->clog->error() << mode << " " << info.pgid << " " << soid
 			<< " on disk size (" << p->second.size
 			<< ") does not match object info size ("
 			<< oi.size << ") adjusted for ondisk to ("
-			<< pgbackend->be_get_ondisk_size(oi.size)
+			<< pgbackend->be_get_ondisk_size(oi.ondisk_size())
 			<< ")";
       ++scrubber.shallow_errors;
     }
@@ -11773,7 +12310,7 @@ void ReplicatedPG::_scrub(
     } else {
       stat.num_bytes += oi.size;
     }
-    if (soid.nspace == cct->_conf->osd_hit_set_namespace)
+    if (soid.nspace == osd->op_conf()->hit_set_namespace)
       stat.num_bytes_hit_set_archive += oi.size;
 
     if (!soid.is_snapdir()) {
@@ -12077,17 +12614,32 @@ boost::statechart::result ReplicatedPG::TrimmingObjects::react(const SnapTrim&)
   }
 
   while (repops.size() < g_conf->osd_pg_max_concurrent_snap_trims) {
-    // Get next
-    hobject_t old_pos = pos;
-    int r = pg->snap_mapper.get_next_object_to_trim(snap_to_trim, &pos);
-    if (r != 0 && r != -ENOENT) {
-      derr << __func__ << ": get_next returned " << cpp_strerror(r) << dendl;
-      assert(0);
-    } else if (r == -ENOENT) {
-      // Done!
-      dout(10) << "TrimmingObjects: got ENOENT" << dendl;
-      post_event(SnapTrim());
-      return transit< WaitingOnReplicas >();
+    // Refill the batch with one range scan instead of re-seeking the
+    // snap prefix for every object
+    if (to_trim.empty()) {
+      int r = pg->snap_mapper.get_next_objects_to_trim(
+	snap_to_trim,
+	g_conf->osd_pg_snap_trim_batch,
+	&to_trim);
+      if (r != 0 && r != -ENOENT) {
+	derr << __func__ << ": get_next returned " << cpp_strerror(r) << dendl;
+	assert(0);
+      } else if (r == -ENOENT) {
+	// Done!
+	dout(10) << "TrimmingObjects: got ENOENT" << dendl;
+	post_event(SnapTrim());
+	return transit< WaitingOnReplicas >();
+      }
+    }
+    pos = to_trim.front();
+
+    // the mapping may have been removed since the batch was fetched
+    // (e.g. by the tier agent evicting the clone); skip if so
+    if (pg->snap_mapper.get_snaps(pos, (std::set<snapid_t>*)NULL) ==
+	-ENOENT) {
+      dout(10) << "TrimmingObjects: " << pos << " no longer mapped" << dendl;
+      to_trim.pop_front();
+      continue;
     }
 
     dout(10) << "TrimmingObjects react trimming " << pos << dendl;
@@ -12095,12 +12647,12 @@ boost::statechart::result ReplicatedPG::TrimmingObjects::react(const SnapTrim&)
     if (!repop) {
       dout(10) << __func__ << " could not get write lock on obj "
 	       << pos << dendl;
-      pos = old_pos;
       return discard_event();
     }
     assert(repop);
     repop->queue_snap_trimmer = true;
 
+    to_trim.pop_front();
     repops.insert(repop->get());
     pg->simple_repop_submit(repop);
   }
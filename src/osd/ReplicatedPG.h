@@ -29,6 +29,7 @@
 #include "Watch.h"
 #include "OpRequest.h"
 #include "TierAgentState.h"
+#include "TempSampler.h"
 
 #include "messages/MOSDOp.h"
 #include "messages/MOSDOpReply.h"
@@ -533,6 +534,7 @@ public:
     bool user_modify;     // user-visible modification
     bool undirty;         // user explicitly un-dirtying this object
     bool cache_evict;     ///< true if this is a cache eviction
+    bool full_overwrite;  ///< true if a single op replaces the entire object content
     bool ignore_cache;    ///< true if IGNORE_CACHE flag is set
     bool ignore_log_op_stats;  // don't log op stats
 
@@ -577,6 +579,7 @@ public:
     map<hobject_t,ObjectContextRef, hobject_t::BitwiseComparator> src_obc;
     ObjectContextRef clone_obc;    // if we created a clone
     ObjectContextRef snapset_obc;  // if we created/deleted a snapdir
+    list<ObjectContextRef> extra_evict_obcs; // other objects deleted by this repop (batched eviction)
 
     int data_off;        // FIXME: we may want to kill this msgr hint off at some point!
 
@@ -651,6 +654,7 @@ public:
       snapset(0),
       new_obs(obs->oi, obs->exists),
       modify(false), user_modify(false), undirty(false), cache_evict(false),
+      full_overwrite(false),
       ignore_cache(false), ignore_log_op_stats(false),
       bytes_written(0), bytes_read(0), user_at_version(0),
       current_osd_subop_num(0),
@@ -674,6 +678,7 @@ public:
               vector<OSDOp>& _ops, ReplicatedPG *_pg) :
       op(_op), reqid(_reqid), ops(_ops), obs(NULL), snapset(0),
       modify(false), user_modify(false), undirty(false), cache_evict(false),
+      full_overwrite(false),
       ignore_cache(false), ignore_log_op_stats(false),
       bytes_written(0), bytes_read(0), user_at_version(0),
       current_osd_subop_num(0),
@@ -749,7 +754,38 @@ public:
 
     Context *on_applied;
     bool log_op_stat;
-    
+
+    /**
+     * Inline completion frames, armed by issue_repop().  They replace
+     * the per-op C_OSD_RepopApplied/C_OSD_RepopCommit/
+     * C_OSD_OndiskWriteUnlock heap allocations: the RepGather is
+     * already allocated and refcounted, so the frames ride along in
+     * it.  Each armed frame holds a repop ref (via get()) which its
+     * finish() or abandon() drops as its very last action.
+     */
+    struct AppliedFrame : public EmbeddedContext {
+      RepGather *repop;
+      ReplicatedPGRef pg;
+      AppliedFrame() : repop(NULL) {}
+      void finish(int r);
+      void abandon();
+    } applied_frame;
+    struct CommitFrame : public EmbeddedContext {
+      RepGather *repop;
+      ReplicatedPGRef pg;
+      CommitFrame() : repop(NULL) {}
+      void finish(int r);
+      void abandon();
+    } commit_frame;
+    struct OndiskUnlockFrame : public EmbeddedContext {
+      RepGather *repop;
+      ObjectContextRef obc, clone_obc, snapset_obc;
+      list<ObjectContextRef> extra_obcs;
+      OndiskUnlockFrame() : repop(NULL) {}
+      void finish(int r);
+      void abandon();
+    } unlock_frame;
+
     RepGather(OpContext *c, ObjectContextRef pi, ceph_tid_t rt,
 	      eversion_t lc) :
       queue_item(this),
@@ -852,6 +888,8 @@ protected:
     bool requeue_snaptrimmer = false;
     bool requeue_snaptrimmer_clone = false;
     bool requeue_snaptrimmer_snapset = false;
+    bool requeue_recovery_extra = false;
+    bool requeue_snaptrimmer_extra = false;
     switch (ctx->lock_to_release) {
     case OpContext::W_LOCK:
       if (ctx->snapset_obc && ctx->release_snapset_obc) {
@@ -870,6 +908,14 @@ protected:
 	  &to_req,
 	  &requeue_recovery_clone,
 	  &requeue_snaptrimmer_clone);
+      for (list<ObjectContextRef>::iterator i = ctx->extra_evict_obcs.begin();
+	   i != ctx->extra_evict_obcs.end();
+	   ++i)
+	(*i)->put_write(
+	  &to_req,
+	  &requeue_recovery_extra,
+	  &requeue_snaptrimmer_extra);
+      ctx->extra_evict_obcs.clear();
       break;
     case OpContext::E_LOCK:
       if (ctx->snapset_obc && ctx->release_snapset_obc) {
@@ -903,11 +949,13 @@ protected:
     };
     assert(ctx->release_snapset_obc == false);
     ctx->lock_to_release = OpContext::NONE;
-    if (requeue_recovery || requeue_recovery_clone || requeue_recovery_snapset)
+    if (requeue_recovery || requeue_recovery_clone || requeue_recovery_snapset ||
+	requeue_recovery_extra)
       osd->recovery_wq.queue(this);
     if (requeue_snaptrimmer ||
 	requeue_snaptrimmer_clone ||
-	requeue_snaptrimmer_snapset)
+	requeue_snaptrimmer_snapset ||
+	requeue_snaptrimmer_extra)
       queue_snap_trim();
 
     if (!to_req.empty()) {
@@ -931,8 +979,10 @@ protected:
   xlist<RepGather*> repop_queue;
   map<ceph_tid_t, RepGather*> repop_map;
 
-  friend class C_OSD_RepopApplied;
-  friend class C_OSD_RepopCommit;
+  bool has_unacked_repops() const {
+    return !repop_queue.empty();
+  }
+
   void repop_all_applied(RepGather *repop);
   void repop_all_committed(RepGather *repop);
   void eval_repop(RepGather*);
@@ -961,6 +1011,8 @@ protected:
   hobject_t get_hit_set_current_object(utime_t stamp);
   hobject_t get_hit_set_archive_object(utime_t start, utime_t end);
 
+  TempSampler temp_sampler; ///< sampled access frequencies, for dump_temperature
+
   // agent
   boost::scoped_ptr<TierAgentState> agent_state;
 
@@ -974,7 +1026,9 @@ protected:
   }
   bool agent_work(int max, int agent_flush_quota);
   bool agent_maybe_flush(ObjectContextRef& obc);  ///< maybe flush
-  bool agent_maybe_evict(ObjectContextRef& obc);  ///< maybe evict
+  bool agent_maybe_evict(ObjectContextRef& obc,
+			 list<ObjectContextRef> *evict_batch);  ///< maybe evict
+  void agent_evict_batch(list<ObjectContextRef>& victims); ///< evict a batch in one repop
 
   void agent_load_hit_sets();  ///< load HitSets, if needed
 
@@ -1028,8 +1082,10 @@ protected:
     return true;
   }
 
-  // projected object info
-  SharedLRU<hobject_t, ObjectContext, hobject_t::ComparatorWithDefault> object_contexts;
+  // projected object info; sharded so ops on distinct objects contend
+  // on different locks
+  ShardedSharedLRU<hobject_t, ObjectContext,
+		   hobject_t::ComparatorWithDefault> object_contexts;
   // map from oid.snapdir() to SnapSetContext *
   map<hobject_t, SnapSetContext*, hobject_t::BitwiseComparator> snapset_contexts;
   Mutex snapset_contexts_lock;
@@ -1194,6 +1250,13 @@ protected:
     ObjectContextRef obc,
     const hobject_t& head, const hobject_t& coid,
     object_info_t *poi);
+  void _rename_into_clone(
+    OpContext *ctx,
+    PGBackend::PGTransaction* t,
+    ObjectContextRef obc,
+    const hobject_t& head, const hobject_t& coid,
+    object_info_t *poi,
+    map<string, bufferlist>& head_attrs);
   void execute_ctx(OpContext *ctx);
   void finish_ctx(OpContext *ctx, int log_op_type, bool maintain_ssc=true,
 		  bool scrub_ok=false);
@@ -1546,6 +1609,7 @@ private:
       boost::statechart::transition< Reset, NotTrimming >
       > reactions;
     hobject_t pos;
+    list<hobject_t> to_trim;  ///< batch of objects left to trim
     TrimmingObjects(my_context ctx);
     void exit();
     boost::statechart::result react(const SnapTrim&);
@@ -1576,6 +1640,12 @@ private:
   // return true if we're creating a local object, false for a
   // whiteout or no change.
   bool maybe_create_new_object(OpContext *ctx);
+  // transparent compression for pools with the compress flag
+  bool maybe_compress_for_writefull(bufferlist& in, bufferlist *out,
+				    string *alg);
+  int decompress_object_data(const object_info_t& oi, bufferlist& cbl,
+			     bufferlist *out);
+  int maybe_decompress_for_write(OpContext *ctx);
   int _delete_oid(OpContext *ctx, bool no_whiteout);
   int _rollback_to(OpContext *ctx, ceph_osd_op& op);
 public:
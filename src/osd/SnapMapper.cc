@@ -50,6 +50,25 @@ int OSDriver::get_next(
   }
 }
 
+int OSDriver::get_next_batch(
+  const std::string &key,
+  unsigned max,
+  std::map<std::string, bufferlist> *out)
+{
+  ObjectMap::ObjectMapIterator iter =
+    os->get_omap_iterator(cid, hoid);
+  if (!iter) {
+    assert(0);
+    return -EINVAL;
+  }
+  for (iter->upper_bound(key);
+       iter->valid() && out->size() < max;
+       iter->next()) {
+    out->insert(make_pair(iter->key(), iter->value()));
+  }
+  return out->empty() ? -ENOENT : 0;
+}
+
 struct Mapping {
   snapid_t snap;
   hobject_t hoid;
@@ -273,6 +292,53 @@ int SnapMapper::get_next_object_to_trim(
   return -ENOENT;
 }
 
+int SnapMapper::get_next_objects_to_trim(
+  snapid_t snap,
+  unsigned max,
+  std::list<hobject_t> *out)
+{
+  assert(out);
+  assert(out->empty());
+  for (set<string>::iterator i = prefixes.begin();
+       i != prefixes.end() && out->size() < max;
+       ++i) {
+    string list_after(get_prefix(snap) + *i);
+    string key(list_after);
+
+    while (out->size() < max) {
+      map<string, bufferlist> next;
+      int r = backend.get_next_batch(key, max - out->size(), &next);
+      if (r < 0) {
+	break; // Done
+      }
+
+      bool done = false;
+      for (map<string, bufferlist>::iterator j = next.begin();
+	   j != next.end();
+	   ++j) {
+	if (j->first.substr(0, list_after.size()) != list_after) {
+	  done = true; // Done with this prefix
+	  break;
+	}
+
+	assert(is_mapping(j->first));
+
+	pair<snapid_t, hobject_t> next_decoded(from_raw(*j));
+	assert(next_decoded.first == snap);
+	assert(check(next_decoded.second));
+
+	out->push_back(next_decoded.second);
+      }
+      if (done || next.empty())
+	break;
+      key = next.rbegin()->first;
+    }
+  }
+  if (out->empty())
+    return -ENOENT;
+  return 0;
+}
+
 
 int SnapMapper::remove_oid(
   const hobject_t &oid,
@@ -17,6 +17,7 @@
 
 #include <string>
 #include <set>
+#include <list>
 #include <utility>
 #include <string.h>
 
@@ -71,6 +72,10 @@ public:
   int get_next(
     const std::string &key,
     pair<std::string, bufferlist> *next);
+  int get_next_batch(
+    const std::string &key,
+    unsigned max,
+    std::map<std::string, bufferlist> *out);
 };
 
 /**
@@ -216,6 +221,13 @@ public:
     hobject_t *hoid             ///< [out] next hoid to trim
     );  ///< @return error, -ENOENT if no more objects
 
+  /// Returns up to max objects with snap as a snap in one range scan
+  int get_next_objects_to_trim(
+    snapid_t snap,              ///< [in] snap to check
+    unsigned max,               ///< [in] max objects to return
+    std::list<hobject_t> *out   ///< [out] next objects to trim
+    );  ///< @return error, -ENOENT if no more objects
+
   /// Remove mapping for oid
   int remove_oid(
     const hobject_t &oid,    ///< [in] oid to remove
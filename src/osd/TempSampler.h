@@ -0,0 +1,108 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * Copyright (C) 2004-2006 Sage Weil <sage@newdream.net>
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_OSD_TEMPSAMPLER_H
+#define CEPH_OSD_TEMPSAMPLER_H
+
+#include "common/Formatter.h"
+#include "common/histogram.h"
+#include "common/hobject.h"
+
+/**
+ * reservoir sampler of per-object access frequency
+ *
+ * Tracks a bounded reservoir of objects chosen uniformly from the
+ * stream of client accesses (Vitter's algorithm R) and counts further
+ * hits on the sampled objects.  Unlike a HitSet this keeps frequency,
+ * not just membership, so the resulting hit-count histogram
+ * approximates the pg's object temperature distribution -- useful for
+ * modeling cache tier hit rates before one exists.  Protected by the
+ * pg lock, like the HitSet it complements.
+ */
+struct TempSampler {
+  struct Sample {
+    uint32_t hits;
+    utime_t first_access;
+    utime_t last_access;
+    Sample() : hits(0) {}
+  };
+
+  size_t max_size;           ///< reservoir capacity (0 = disabled)
+  uint64_t total_accesses;   ///< accesses offered to the sampler
+  map<hobject_t, Sample, hobject_t::BitwiseComparator> samples;
+  vector<hobject_t> reservoir;  ///< slot -> sampled oid
+
+  explicit TempSampler(size_t max_size)
+    : max_size(max_size), total_accesses(0) {}
+
+  bool enabled() const {
+    return max_size > 0;
+  }
+
+  void access(const hobject_t& oid, const utime_t& now) {
+    if (!enabled())
+      return;
+    ++total_accesses;
+    map<hobject_t, Sample, hobject_t::BitwiseComparator>::iterator p =
+      samples.find(oid);
+    if (p != samples.end()) {
+      ++p->second.hits;
+      p->second.last_access = now;
+      return;
+    }
+    size_t slot;
+    if (reservoir.size() < max_size) {
+      slot = reservoir.size();
+      reservoir.push_back(oid);
+    } else {
+      uint64_t j = rand() % total_accesses;
+      if (j >= max_size)
+	return;
+      slot = j;
+      samples.erase(reservoir[slot]);
+      reservoir[slot] = oid;
+    }
+    Sample& s = samples[oid];
+    s.hits = 1;
+    s.first_access = s.last_access = now;
+  }
+
+  void dump(Formatter *f) const {
+    f->dump_unsigned("reservoir_size", max_size);
+    f->dump_unsigned("sampled_objects", samples.size());
+    f->dump_unsigned("total_accesses", total_accesses);
+    pow2_hist_t hist;
+    uint64_t sampled_hits = 0;
+    utime_t oldest, newest;
+    for (map<hobject_t, Sample, hobject_t::BitwiseComparator>::const_iterator
+	   p = samples.begin();
+	 p != samples.end();
+	 ++p) {
+      hist.add(p->second.hits);
+      sampled_hits += p->second.hits;
+      if (oldest.is_zero() || p->second.first_access < oldest)
+	oldest = p->second.first_access;
+      if (p->second.last_access > newest)
+	newest = p->second.last_access;
+    }
+    f->dump_unsigned("sampled_accesses", sampled_hits);
+    f->dump_stream("oldest_sample") << oldest;
+    f->dump_stream("newest_sample") << newest;
+    f->open_object_section("access_frequency_histogram");
+    hist.dump(f);
+    f->close_section();
+  }
+};
+
+#endif
@@ -30,6 +30,11 @@ struct TierAgentState {
   /// past HitSet(s) (not current)
   map<time_t,HitSetRef> hit_set_map;
 
+  /// union of hit_set_map for containment-only queries, built lazily;
+  /// NULL if the archived sets could not be merged
+  HitSetRef hit_set_union;
+  bool hit_set_union_valid;
+
   /// a few recent things we've seen that are clean
   list<hobject_t> recent_clean;
 
@@ -72,7 +77,8 @@ struct TierAgentState {
   unsigned evict_effort;
 
   TierAgentState()
-    : started(0),
+    : hit_set_union_valid(false),
+      started(0),
       delaying(false),
       hist_age(0),
       flush_mode(FLUSH_MODE_IDLE),
@@ -91,17 +97,46 @@ struct TierAgentState {
   /// add archived HitSet
   void add_hit_set(time_t start, HitSetRef hs) {
     hit_set_map.insert(make_pair(start, hs));
+    invalidate_hit_set_union();
   }
 
   /// remove old/trimmed HitSet
   void remove_oldest_hit_set() {
-    if (!hit_set_map.empty())
+    if (!hit_set_map.empty()) {
       hit_set_map.erase(hit_set_map.begin());
+      invalidate_hit_set_union();
+    }
   }
 
   /// discard all open hit sets
   void discard_hit_sets() {
     hit_set_map.clear();
+    invalidate_hit_set_union();
+  }
+
+  void invalidate_hit_set_union() {
+    hit_set_union.reset();
+    hit_set_union_valid = false;
+  }
+
+  /// union of the archived sets, for "hit in any period" queries;
+  /// NULL if they cannot be merged (caller should scan hit_set_map)
+  HitSetRef get_hit_set_union() {
+    if (!hit_set_union_valid) {
+      hit_set_union_valid = true;
+      hit_set_union.reset();
+      for (map<time_t,HitSetRef>::iterator p = hit_set_map.begin();
+	   p != hit_set_map.end();
+	   ++p) {
+	if (p == hit_set_map.begin()) {
+	  hit_set_union.reset(new HitSet(*p->second));
+	} else if (!hit_set_union->try_merge(*p->second)) {
+	  hit_set_union.reset();
+	  break;
+	}
+      }
+    }
+    return hit_set_union;
   }
 
   void dump(Formatter *f) const {
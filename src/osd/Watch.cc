@@ -246,8 +246,19 @@ public:
     osd->watch_lock.Unlock();
     pg->lock();
     watch->cb = NULL;
-    if (!watch->is_discarded() && !canceled)
-      watch->pg->handle_watch_timeout(watch);
+    if (!watch->is_discarded() && !canceled) {
+      // pings only record their arrival time; check it here and re-arm
+      // for the remaining interval instead of cancelling and re-adding
+      // a timer event on every ping
+      utime_t now = ceph_clock_now(NULL);
+      utime_t cutoff = now;
+      cutoff.sec_ref() -= watch->timeout;
+      if (watch->will_ping && watch->is_connected() &&
+	  watch->last_ping > cutoff)
+	watch->register_cb((double)(watch->last_ping - cutoff));
+      else
+	watch->pg->handle_watch_timeout(watch);
+    }
     delete this; // ~Watch requires pg lock!
     pg->unlock();
     osd->watch_lock.Lock();
@@ -319,19 +330,21 @@ Context *Watch::get_delayed_cb()
   return cb;
 }
 
-void Watch::register_cb()
+void Watch::register_cb(double delay)
 {
   Mutex::Locker l(osd->watch_lock);
+  if (delay < 0)
+    delay = timeout;
   if (cb) {
-    dout(15) << "re-registering callback, timeout: " << timeout << dendl;
+    dout(15) << "re-registering callback, delay: " << delay << dendl;
     cb->cancel();
     osd->watch_timer.cancel_event(cb);
   } else {
-    dout(15) << "registering callback, timeout: " << timeout << dendl;
+    dout(15) << "registering callback, delay: " << delay << dendl;
   }
   cb = new HandleWatchTimeout(self.lock());
   osd->watch_timer.add_event_after(
-    timeout,
+    delay,
     cb);
 }
 
@@ -352,7 +365,9 @@ void Watch::unregister_cb()
 void Watch::got_ping(utime_t t)
 {
   last_ping = t;
-  if (conn) {
+  // the timeout callback re-arms itself from last_ping when it fires,
+  // so an already-registered event does not need to be rescheduled here
+  if (conn && !cb) {
     register_cb();
   }
 }
@@ -475,6 +490,8 @@ void Watch::cancel_notify(NotifyRef notif)
 void Watch::send_notify(NotifyRef notif)
 {
   dout(10) << "send_notify" << dendl;
+  // the payload buffers are refcounted and shared by every message in
+  // the fan-out, not copied per watcher
   MWatchNotify *notify_msg = new MWatchNotify(
     cookie, notif->version, notif->notify_id,
     CEPH_WATCH_EVENT_NOTIFY, notif->payload);
@@ -513,6 +530,40 @@ void WatchConState::removeWatch(WatchRef watch)
   watches.erase(watch);
 }
 
+void WatchConState::ping(
+  const vector<pair<uint64_t, uint64_t> > &pings,
+  utime_t now,
+  vector<int32_t> *results)
+{
+  map<uint64_t, WatchRef> by_cookie;
+  {
+    Mutex::Locker l(lock);
+    for (set<WatchRef>::iterator i = watches.begin();
+	 i != watches.end();
+	 ++i)
+      by_cookie[(*i)->get_cookie()] = *i;
+  }
+  for (vector<pair<uint64_t, uint64_t> >::const_iterator i = pings.begin();
+       i != pings.end();
+       ++i) {
+    map<uint64_t, WatchRef>::iterator w = by_cookie.find(i->first);
+    int32_t r = 0;
+    if (w == by_cookie.end()) {
+      // client needs to reconnect
+      r = -ENOTCONN;
+    } else {
+      boost::intrusive_ptr<ReplicatedPG> pg(w->second->get_pg());
+      pg->lock();
+      if (!w->second->is_discarded() && w->second->is_connected())
+	w->second->got_ping(now);
+      else
+	r = -ETIMEDOUT;
+      pg->unlock();
+    }
+    results->push_back(r);
+  }
+}
+
 void WatchConState::reset()
 {
   set<WatchRef> _watches;
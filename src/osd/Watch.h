@@ -181,8 +181,9 @@ class Watch {
     uint64_t cookie, entity_name_t entity,
     const entity_addr_t& addr);
 
-  /// Registers the timeout callback with watch_timer
-  void register_cb();
+  /// Registers the timeout callback with watch_timer; delay < 0 means
+  /// the full watch timeout
+  void register_cb(double delay = -1);
 
   /// send a Notify message when connected for notif
   void send_notify(NotifyRef notif);
@@ -291,6 +292,13 @@ public:
 
   /// Called on session reset, disconnects watchers
   void reset();
+
+  /// Handle a batched keepalive (MWatchPing) for this connection's watches
+  void ping(
+    const vector<pair<uint64_t, uint64_t> > &pings, ///< [in] (cookie, client token)
+    utime_t now,                                    ///< [in] ping receipt time
+    vector<int32_t> *results                        ///< [out] per-entry result
+    );
 };
 
 #endif
@@ -151,6 +151,24 @@ void osd_reqid_t::encode(bufferlist &bl) const
   ENCODE_FINISH(bl);
 }
 
+void osd_reqid_t::bound_encode(size_t &p) const
+{
+  DENC_START(2, 2, p);
+  denc(name, p);
+  denc(tid, p);
+  denc(inc, p);
+  DENC_FINISH(p);
+}
+
+void osd_reqid_t::encode(bufferlist::contiguous_appender &p) const
+{
+  DENC_START(2, 2, p);
+  denc(name, p);
+  denc(tid, p);
+  denc(inc, p);
+  DENC_FINISH(p);
+}
+
 void osd_reqid_t::decode(bufferlist::iterator &bl)
 {
   DECODE_START_LEGACY_COMPAT_LEN(2, 2, 2, bl);
@@ -272,6 +290,75 @@ void request_redirect_t::generate_test_instances(list<request_redirect_t*>& o)
   o.push_back(new request_redirect_t(loc));
 }
 
+// -- osd_optrace_t --
+const char *osd_optrace_t::get_stage_name(int stage)
+{
+  switch (stage) {
+  case STAGE_CLIENT_SUBMIT: return "client_submit";
+  case STAGE_CLIENT_SEND: return "client_send";
+  case STAGE_OSD_DEQUEUE: return "osd_dequeue";
+  case STAGE_OSD_APPLIED: return "osd_applied";
+  case STAGE_OSD_COMMITTED: return "osd_committed";
+  case STAGE_OSD_REPLY: return "osd_reply";
+  case STAGE_CLIENT_RECV: return "client_recv";
+  default: return "unknown";
+  }
+}
+
+void osd_optrace_t::encode(bufferlist& bl) const
+{
+  ENCODE_START(1, 1, bl);
+  ::encode(events, bl);
+  ENCODE_FINISH(bl);
+}
+
+void osd_optrace_t::decode(bufferlist::iterator& bl)
+{
+  DECODE_START(1, bl);
+  ::decode(events, bl);
+  DECODE_FINISH(bl);
+}
+
+void osd_optrace_t::dump(Formatter *f) const
+{
+  Cycles::init();
+  f->open_array_section("events");
+  uint64_t prev = 0;
+  for (vector<pair<__u8, uint64_t> >::const_iterator p = events.begin();
+       p != events.end();
+       ++p) {
+    f->open_object_section("event");
+    f->dump_string("stage", get_stage_name(p->first));
+    f->dump_unsigned("tsc", p->second);
+    if (prev && p->second > prev)
+      f->dump_unsigned("delta_ns", Cycles::to_nanoseconds(p->second - prev));
+    prev = p->second;
+    f->close_section();
+  }
+  f->close_section();
+}
+
+void osd_optrace_t::generate_test_instances(list<osd_optrace_t*>& o)
+{
+  o.push_back(new osd_optrace_t());
+  o.push_back(new osd_optrace_t());
+  o.back()->events.push_back(make_pair((__u8)STAGE_CLIENT_SUBMIT, 1ull));
+  o.back()->events.push_back(make_pair((__u8)STAGE_OSD_DEQUEUE, 2ull));
+}
+
+ostream& operator<<(ostream& out, const osd_optrace_t& trace)
+{
+  out << "optrace[";
+  for (vector<pair<__u8, uint64_t> >::const_iterator p = trace.events.begin();
+       p != trace.events.end();
+       ++p) {
+    if (p != trace.events.begin())
+      out << ",";
+    out << osd_optrace_t::get_stage_name(p->first) << "=" << p->second;
+  }
+  return out << "]";
+}
+
 void objectstore_perf_stat_t::dump(Formatter *f) const
 {
   f->dump_unsigned("commit_latency_ms", filestore_commit_latency);
@@ -946,6 +1033,8 @@ void pg_pool_t::dump(Formatter *f) const
   f->dump_unsigned("min_write_recency_for_promote", min_write_recency_for_promote);
   f->dump_unsigned("stripe_width", get_stripe_width());
   f->dump_unsigned("expected_num_objects", expected_num_objects);
+  f->dump_string("compression_algorithm", compression_algorithm);
+  f->dump_int("compression_level", compression_level);
 }
 
 void pg_pool_t::convert_to_pg_shards(const vector<int> &from, set<pg_shard_t>* to) const {
@@ -1255,7 +1344,7 @@ void pg_pool_t::encode(bufferlist& bl, uint64_t features) const
     return;
   }
 
-  ENCODE_START(20, 5, bl);
+  ENCODE_START(21, 5, bl);
   ::encode(type, bl);
   ::encode(size, bl);
   ::encode(crush_ruleset, bl);
@@ -1299,12 +1388,14 @@ void pg_pool_t::encode(bufferlist& bl, uint64_t features) const
   ::encode(expected_num_objects, bl);
   ::encode(cache_target_dirty_high_ratio_micro, bl);
   ::encode(min_write_recency_for_promote, bl);
+  ::encode(compression_algorithm, bl);
+  ::encode(compression_level, bl);
   ENCODE_FINISH(bl);
 }
 
 void pg_pool_t::decode(bufferlist::iterator& bl)
 {
-  DECODE_START_LEGACY_COMPAT_LEN(20, 5, 5, bl);
+  DECODE_START_LEGACY_COMPAT_LEN(21, 5, 5, bl);
   ::decode(type, bl);
   ::decode(size, bl);
   ::decode(crush_ruleset, bl);
@@ -1426,6 +1517,13 @@ void pg_pool_t::decode(bufferlist::iterator& bl)
   } else {
     min_write_recency_for_promote = 1;
   }
+  if (struct_v >= 21) {
+    ::decode(compression_algorithm, bl);
+    ::decode(compression_level, bl);
+  } else {
+    compression_algorithm.clear();
+    compression_level = 0;
+  }
   DECODE_FINISH(bl);
   calc_pg_masks();
 }
@@ -1483,6 +1581,8 @@ void pg_pool_t::generate_test_instances(list<pg_pool_t*>& o)
   a.cache_min_evict_age = 2321;
   a.erasure_code_profile = "profile in osdmap";
   a.expected_num_objects = 123456;
+  a.compression_algorithm = "snappy";
+  a.compression_level = 1;
   o.push_back(new pg_pool_t(a));
 }
 
@@ -1534,6 +1634,10 @@ ostream& operator<<(ostream& out, const pg_pool_t& p)
   out << " stripe_width " << p.get_stripe_width();
   if (p.expected_num_objects)
     out << " expected_num_objects " << p.expected_num_objects;
+  if (p.compression_algorithm.length())
+    out << " compression_algorithm " << p.compression_algorithm;
+  if (p.compression_level)
+    out << " compression_level " << p.compression_level;
   return out;
 }
 
@@ -2421,9 +2525,13 @@ void pg_info_t::encode(bufferlist &bl) const
 {
   ENCODE_START(31, 26, bl);
   ::encode(pgid.pgid, bl);
-  ::encode(last_update, bl);
-  ::encode(last_complete, bl);
-  ::encode(log_tail, bl);
+  {
+    // batch the eversions through one reserved chunk
+    bufferlist::contiguous_appender ap(bl, 3 * sizeof(eversion_t));
+    ::encode(last_update, ap);
+    ::encode(last_complete, ap);
+    ::encode(log_tail, ap);
+  }
   if (last_backfill_bitwise && last_backfill != last_backfill.get_max()) {
     ::encode(hobject_t(), bl);
   } else {
@@ -2432,8 +2540,12 @@ void pg_info_t::encode(bufferlist &bl) const
   ::encode(stats, bl);
   history.encode(bl);
   ::encode(purged_snaps, bl);
-  ::encode(last_epoch_started, bl);
-  ::encode(last_user_version, bl);
+  {
+    bufferlist::contiguous_appender ap(bl, sizeof(last_epoch_started) +
+				       sizeof(last_user_version));
+    ::encode(last_epoch_started, ap);
+    ::encode(last_user_version, ap);
+  }
   ::encode(hit_set, bl);
   ::encode(pgid.shard, bl);
   ::encode(last_backfill, bl);
@@ -3097,24 +3209,32 @@ void pg_log_entry_t::encode(bufferlist &bl) const
   ENCODE_START(10, 4, bl);
   ::encode(op, bl);
   ::encode(soid, bl);
-  ::encode(version, bl);
-
-  /**
-   * Added with reverting_to:
-   * Previous code used prior_version to encode
-   * what we now call reverting_to.  This will
-   * allow older code to decode reverting_to
-   * into prior_version as expected.
-   */
-  if (op == LOST_REVERT)
-    ::encode(reverting_to, bl);
-  else
-    ::encode(prior_version, bl);
+  {
+    // write the fixed-size fields through one reserved chunk instead
+    // of a capacity-checked append() each
+    bufferlist::contiguous_appender ap(bl, 2 * sizeof(eversion_t));
+    ::encode(version, ap);
+
+    /**
+     * Added with reverting_to:
+     * Previous code used prior_version to encode
+     * what we now call reverting_to.  This will
+     * allow older code to decode reverting_to
+     * into prior_version as expected.
+     */
+    if (op == LOST_REVERT)
+      ::encode(reverting_to, ap);
+    else
+      ::encode(prior_version, ap);
+  }
 
   ::encode(reqid, bl);
-  ::encode(mtime, bl);
-  if (op == LOST_REVERT)
-    ::encode(prior_version, bl);
+  {
+    bufferlist::contiguous_appender ap(bl, sizeof(utime_t) + sizeof(eversion_t));
+    ::encode(mtime, ap);
+    if (op == LOST_REVERT)
+      ::encode(prior_version, ap);
+  }
   ::encode(snaps, bl);
   ::encode(user_version, bl);
   ::encode(mod_desc, bl);
@@ -3324,6 +3444,148 @@ void pg_log_t::decode(bufferlist::iterator &bl, int64_t pool)
   }
 }
 
+// per-entry flag bits for the compact wire encoding below
+enum {
+  PGLOG_COMPACT_SAME_POOL   = 1,  // soid.pool matches previous entry
+  PGLOG_COMPACT_SAME_NSPACE = 2,  // soid.nspace matches previous entry
+  PGLOG_COMPACT_HAS_KEY     = 4,  // soid carries an explicit locator key
+  PGLOG_COMPACT_SAME_CLIENT = 8,  // reqid.name matches previous entry
+  PGLOG_COMPACT_IMPLIED_UV  = 16, // user_version == version.version
+  PGLOG_COMPACT_HAS_SNAPS   = 32, // clone entry with snaps payload
+  PGLOG_COMPACT_HAS_EXTRA   = 64, // extra_reqids non-empty
+};
+
+void pg_log_t::encode_compact(bufferlist& bl) const
+{
+  ENCODE_START(1, 1, bl);
+  ::encode(head, bl);
+  ::encode(tail, bl);
+  ::encode(can_rollback_to, bl);
+  ::encode(rollback_info_trimmed_to, bl);
+  __u32 n = log.size();
+  ::encode(n, bl);
+  const pg_log_entry_t *prev = 0;
+  for (list<pg_log_entry_t>::const_iterator p = log.begin();
+       p != log.end();
+       ++p) {
+    assert(!p->soid.is_max());
+    __u8 flags = 0;
+    if (p->soid.get_key().length())
+      flags |= PGLOG_COMPACT_HAS_KEY;
+    if (p->user_version == p->version.version)
+      flags |= PGLOG_COMPACT_IMPLIED_UV;
+    if (p->snaps.length())
+      flags |= PGLOG_COMPACT_HAS_SNAPS;
+    if (!p->extra_reqids.empty())
+      flags |= PGLOG_COMPACT_HAS_EXTRA;
+    if (prev) {
+      if (p->soid.pool == prev->soid.pool)
+	flags |= PGLOG_COMPACT_SAME_POOL;
+      if (p->soid.nspace == prev->soid.nspace)
+	flags |= PGLOG_COMPACT_SAME_NSPACE;
+      if (p->reqid.name == prev->reqid.name)
+	flags |= PGLOG_COMPACT_SAME_CLIENT;
+    }
+    ::encode(flags, bl);
+    ::encode(p->op, bl);
+    ::encode(p->soid.oid, bl);
+    ::encode(p->soid.snap, bl);
+    __u32 hash = p->soid.get_hash();
+    ::encode(hash, bl);
+    if (!(flags & PGLOG_COMPACT_SAME_POOL))
+      ::encode(p->soid.pool, bl);
+    if (!(flags & PGLOG_COMPACT_SAME_NSPACE))
+      ::encode(p->soid.nspace, bl);
+    if (flags & PGLOG_COMPACT_HAS_KEY)
+      ::encode(p->soid.get_key(), bl);
+    ::encode(p->version, bl);
+    ::encode(p->prior_version, bl);
+    if (p->op == pg_log_entry_t::LOST_REVERT)
+      ::encode(p->reverting_to, bl);
+    if (!(flags & PGLOG_COMPACT_SAME_CLIENT))
+      ::encode(p->reqid.name, bl);
+    ::encode(p->reqid.tid, bl);
+    ::encode(p->reqid.inc, bl);
+    ::encode(p->mtime, bl);
+    if (!(flags & PGLOG_COMPACT_IMPLIED_UV))
+      ::encode(p->user_version, bl);
+    if (flags & PGLOG_COMPACT_HAS_SNAPS)
+      ::encode(p->snaps, bl);
+    ::encode(p->mod_desc, bl);
+    if (flags & PGLOG_COMPACT_HAS_EXTRA)
+      ::encode(p->extra_reqids, bl);
+    prev = &*p;
+  }
+  ENCODE_FINISH(bl);
+}
+
+void pg_log_t::decode_compact(bufferlist::iterator& bl)
+{
+  DECODE_START(1, bl);
+  ::decode(head, bl);
+  ::decode(tail, bl);
+  ::decode(can_rollback_to, bl);
+  ::decode(rollback_info_trimmed_to, bl);
+  __u32 n;
+  ::decode(n, bl);
+  log.clear();
+  const pg_log_entry_t *prev = 0;
+  while (n--) {
+    __u8 flags;
+    ::decode(flags, bl);
+    pg_log_entry_t e;
+    ::decode(e.op, bl);
+    object_t oid;
+    snapid_t snap;
+    __u32 hash;
+    int64_t pool;
+    string nspace, key;
+    ::decode(oid, bl);
+    ::decode(snap, bl);
+    ::decode(hash, bl);
+    if (flags & PGLOG_COMPACT_SAME_POOL) {
+      assert(prev);
+      pool = prev->soid.pool;
+    } else {
+      ::decode(pool, bl);
+    }
+    if (flags & PGLOG_COMPACT_SAME_NSPACE) {
+      assert(prev);
+      nspace = prev->soid.nspace;
+    } else {
+      ::decode(nspace, bl);
+    }
+    if (flags & PGLOG_COMPACT_HAS_KEY)
+      ::decode(key, bl);
+    e.soid = hobject_t(oid, key, snap, hash, pool, nspace);
+    ::decode(e.version, bl);
+    ::decode(e.prior_version, bl);
+    if (e.op == pg_log_entry_t::LOST_REVERT)
+      ::decode(e.reverting_to, bl);
+    if (flags & PGLOG_COMPACT_SAME_CLIENT) {
+      assert(prev);
+      e.reqid.name = prev->reqid.name;
+    } else {
+      ::decode(e.reqid.name, bl);
+    }
+    ::decode(e.reqid.tid, bl);
+    ::decode(e.reqid.inc, bl);
+    ::decode(e.mtime, bl);
+    if (flags & PGLOG_COMPACT_IMPLIED_UV)
+      e.user_version = e.version.version;
+    else
+      ::decode(e.user_version, bl);
+    if (flags & PGLOG_COMPACT_HAS_SNAPS)
+      ::decode(e.snaps, bl);
+    ::decode(e.mod_desc, bl);
+    if (flags & PGLOG_COMPACT_HAS_EXTRA)
+      ::decode(e.extra_reqids, bl);
+    log.push_back(e);
+    prev = &log.back();
+  }
+  DECODE_FINISH(bl);
+}
+
 void pg_log_t::dump(Formatter *f) const
 {
   f->dump_stream("head") << head;
@@ -3465,6 +3727,17 @@ void pg_missing_t::decode(bufferlist::iterator &bl, int64_t pool)
        it != missing.end();
        ++it)
     rmissing[it->second.need.version] = it->first;
+  filter_rebuild();
+}
+
+void pg_missing_t::filter_rebuild()
+{
+  filter_clear();
+  for (map<hobject_t,item, hobject_t::ComparatorWithDefault>::const_iterator it =
+	 missing.begin();
+       it != missing.end();
+       ++it)
+    filter_insert(it->first);
 }
 
 void pg_missing_t::dump(Formatter *f) const
@@ -3517,15 +3790,21 @@ void pg_missing_t::swap(pg_missing_t& o)
 {
   missing.swap(o.missing);
   rmissing.swap(o.rmissing);
+  for (unsigned i = 0; i < sizeof(filter) / sizeof(filter[0]); i++)
+    std::swap(filter[i], o.filter[i]);
 }
 
 bool pg_missing_t::is_missing(const hobject_t& oid) const
 {
+  if (!filter_may_contain(oid))
+    return false;
   return (missing.find(oid) != missing.end());
 }
 
 bool pg_missing_t::is_missing(const hobject_t& oid, eversion_t v) const
 {
+  if (!filter_may_contain(oid))
+    return false;
   map<hobject_t, item, hobject_t::ComparatorWithDefault>::const_iterator m = missing.find(oid);
   if (m == missing.end())
     return false;
@@ -3559,8 +3838,10 @@ void pg_missing_t::add_next_event(const pg_log_entry_t& e)
       if (is_missing_divergent_item) {  // use iterator
         rmissing.erase((missing_it->second).need.version);
         missing_it->second = item(e.version, eversion_t());  // .have = nil
-      } else  // create new element in missing map
+      } else {  // create new element in missing map
         missing[e.soid] = item(e.version, eversion_t());     // .have = nil
+        filter_insert(e.soid);
+      }
     } else if (is_missing_divergent_item) {
       // already missing (prior).
       rmissing.erase((missing_it->second).need.version);
@@ -3572,6 +3853,7 @@ void pg_missing_t::add_next_event(const pg_log_entry_t& e)
       // not missing, we must have prior_version (if any)
       assert(!is_missing_divergent_item);
       missing[e.soid] = item(e.version, e.prior_version);
+      filter_insert(e.soid);
     }
     rmissing[e.version.version] = e.soid;
   } else
@@ -3585,6 +3867,7 @@ void pg_missing_t::revise_need(hobject_t oid, eversion_t need)
     missing[oid].need = need;            // no not adjust .have
   } else {
     missing[oid] = item(need, eversion_t());
+    filter_insert(oid);
   }
   rmissing[need.version] = oid;
 }
@@ -3599,6 +3882,7 @@ void pg_missing_t::revise_have(hobject_t oid, eversion_t have)
 void pg_missing_t::add(const hobject_t& oid, eversion_t need, eversion_t have)
 {
   missing[oid] = item(need, have);
+  filter_insert(oid);
   rmissing[need.version] = oid;
 }
 
@@ -3613,6 +3897,8 @@ void pg_missing_t::rm(const std::map<hobject_t, pg_missing_t::item, hobject_t::C
 {
   rmissing.erase(m->second.need.version);
   missing.erase(m);
+  if (missing.empty())
+    filter_clear();   // drop any stale bits removals left behind
 }
 
 void pg_missing_t::got(const hobject_t& oid, eversion_t v)
@@ -3627,6 +3913,8 @@ void pg_missing_t::got(const std::map<hobject_t, pg_missing_t::item, hobject_t::
 {
   rmissing.erase(m->second.need.version);
   missing.erase(m);
+  if (missing.empty())
+    filter_clear();   // drop any stale bits removals left behind
 }
 
 void pg_missing_t::split_into(
@@ -4245,8 +4533,8 @@ uint64_t SnapSet::get_clone_bytes(snapid_t clone) const
   assert(clone_size.count(clone));
   uint64_t size = clone_size.find(clone)->second;
   assert(clone_overlap.count(clone));
-  const interval_set<uint64_t> &overlap = clone_overlap.find(clone)->second;
-  for (interval_set<uint64_t>::const_iterator i = overlap.begin();
+  const flat_interval_set<uint64_t> &overlap = clone_overlap.find(clone)->second;
+  for (flat_interval_set<uint64_t>::const_iterator i = overlap.begin();
        i != overlap.end();
        ++i) {
     assert(size >= i.get_len());
@@ -4342,6 +4630,8 @@ void object_info_t::copy_user_bits(const object_info_t& other)
   user_version = other.user_version;
   data_digest = other.data_digest;
   omap_digest = other.omap_digest;
+  compressed_size = other.compressed_size;
+  compression_algorithm = other.compression_algorithm;
 }
 
 ps_t object_info_t::legacy_object_locator_to_ps(const object_t &oid, 
@@ -4367,41 +4657,61 @@ void object_info_t::encode(bufferlist& bl) const
        ++i) {
     old_watchers.insert(make_pair(i->first.second, i->second));
   }
-  ENCODE_START(15, 8, bl);
+  ENCODE_START(17, 8, bl);
   ::encode(soid, bl);
   ::encode(myoloc, bl);	//Retained for compatibility
   ::encode((__u32)0, bl); // was category, no longer used
-  ::encode(version, bl);
-  ::encode(prior_version, bl);
+  {
+    // fixed-size fields go through a contiguous_appender; the
+    // variable-length and versioned fields stay on the regular path
+    bufferlist::contiguous_appender ap(bl, 2 * sizeof(eversion_t));
+    ::encode(version, ap);
+    ::encode(prior_version, ap);
+  }
   ::encode(last_reqid, bl);
-  ::encode(size, bl);
-  ::encode(mtime, bl);
+  {
+    bufferlist::contiguous_appender ap(bl, sizeof(size) + sizeof(utime_t));
+    ::encode(size, ap);
+    ::encode(mtime, ap);
+  }
   if (soid.snap == CEPH_NOSNAP)
     ::encode(osd_reqid_t(), bl);  // used to be wrlock_by
   else
     ::encode(snaps, bl);
-  ::encode(truncate_seq, bl);
-  ::encode(truncate_size, bl);
-  ::encode(is_lost(), bl);
+  {
+    bufferlist::contiguous_appender ap(bl, 2 * sizeof(uint64_t) + 1);
+    ::encode(truncate_seq, ap);
+    ::encode(truncate_size, ap);
+    ::encode(is_lost(), ap);
+  }
   ::encode(old_watchers, bl);
   /* shenanigans to avoid breaking backwards compatibility in the disk format.
    * When we can, switch this out for simply putting the version_t on disk. */
   eversion_t user_eversion(0, user_version);
-  ::encode(user_eversion, bl);
-  ::encode(test_flag(FLAG_USES_TMAP), bl);
+  {
+    bufferlist::contiguous_appender ap(bl, sizeof(eversion_t) + 1);
+    ::encode(user_eversion, ap);
+    ::encode(test_flag(FLAG_USES_TMAP), ap);
+  }
   ::encode(watchers, bl);
   __u32 _flags = flags;
-  ::encode(_flags, bl);
-  ::encode(local_mtime, bl);
-  ::encode(data_digest, bl);
-  ::encode(omap_digest, bl);
+  {
+    bufferlist::contiguous_appender ap(bl, sizeof(_flags) + sizeof(utime_t) +
+				       2 * sizeof(__u32));
+    ::encode(_flags, ap);
+    ::encode(local_mtime, ap);
+    ::encode(data_digest, ap);
+    ::encode(omap_digest, ap);
+  }
+  ::encode(compressed_size, bl);
+  ::encode(compression_algorithm, bl);
   ENCODE_FINISH(bl);
 }
 
 void object_info_t::decode(bufferlist::iterator& bl)
 {
   object_locator_t myoloc;
-  DECODE_START_LEGACY_COMPAT_LEN(14, 8, 8, bl);
+  DECODE_START_LEGACY_COMPAT_LEN(17, 8, 8, bl);
   map<entity_name_t, watch_info_t> old_watchers;
   ::decode(soid, bl);
   ::decode(myoloc, bl);
@@ -4474,6 +4784,17 @@ void object_info_t::decode(bufferlist::iterator& bl)
     clear_flag(FLAG_DATA_DIGEST);
     clear_flag(FLAG_OMAP_DIGEST);
   }
+  if (struct_v >= 16) {
+    ::decode(compressed_size, bl);
+  } else {
+    compressed_size = 0;
+    clear_flag(FLAG_COMPRESSED);
+  }
+  if (struct_v >= 17) {
+    ::decode(compression_algorithm, bl);
+  } else {
+    compression_algorithm.clear();
+  }
   DECODE_FINISH(bl);
 }
 
@@ -4499,6 +4820,8 @@ void object_info_t::dump(Formatter *f) const
   f->dump_unsigned("truncate_size", truncate_size);
   f->dump_unsigned("data_digest", data_digest);
   f->dump_unsigned("omap_digest", omap_digest);
+  f->dump_unsigned("compressed_size", compressed_size);
+  f->dump_string("compression_algorithm", compression_algorithm);
   f->open_object_section("watchers");
   for (map<pair<uint64_t, entity_name_t>,watch_info_t>::const_iterator p =
          watchers.begin(); p != watchers.end(); ++p) {
@@ -4533,6 +4856,11 @@ ostream& operator<<(ostream& out, const object_info_t& oi)
     out << " dd " << std::hex << oi.data_digest << std::dec;
   if (oi.is_omap_digest())
     out << " od " << std::hex << oi.omap_digest << std::dec;
+  if (oi.is_compressed()) {
+    out << " cs " << oi.compressed_size;
+    if (oi.compression_algorithm.length())
+      out << "/" << oi.compression_algorithm;
+  }
 
   out << ")";
   return out;
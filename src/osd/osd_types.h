@@ -32,8 +32,10 @@
 #include "include/CompatSet.h"
 #include "common/histogram.h"
 #include "include/interval_set.h"
+#include "include/flat_interval_set.h"
 #include "common/Formatter.h"
 #include "common/bloom_filter.hpp"
+#include "common/Cycles.h"
 #include "common/hobject.h"
 #include "common/snap_types.h"
 #include "HitSet.h"
@@ -251,6 +253,44 @@ inline ostream& operator<<(ostream& out, const request_redirect_t& redir) {
   return out;
 }
 
+/**
+ * osd_optrace_t - sampled end-to-end op trace
+ *
+ * Carried by one in every objecter_trace_every MOSDOps (and copied into
+ * the matching MOSDOpReply), so that tail latency can be attributed to a
+ * stage without correlating client and OSD logs by hand.  Each stage
+ * appends a (stage, Cycles::rdtsc()) pair; TSC stamps are cheap enough
+ * to take unconditionally on the sampled ops, but are only comparable
+ * between stamps taken on the same host.
+ */
+struct osd_optrace_t {
+  enum {
+    STAGE_CLIENT_SUBMIT = 1,  ///< objecter prepared the op
+    STAGE_CLIENT_SEND = 2,    ///< objecter handed the op to the messenger
+    STAGE_OSD_DEQUEUE = 3,    ///< op thread picked the op off the pg queue
+    STAGE_OSD_APPLIED = 4,    ///< objectstore applied the transaction
+    STAGE_OSD_COMMITTED = 5,  ///< objectstore committed the transaction
+    STAGE_OSD_REPLY = 6,      ///< reply constructed
+    STAGE_CLIENT_RECV = 7,    ///< objecter received the reply
+  };
+
+  vector<pair<__u8, uint64_t> > events;
+
+  bool enabled() const { return !events.empty(); }
+  void add(__u8 stage) {
+    events.push_back(make_pair(stage, Cycles::rdtsc()));
+  }
+  static const char *get_stage_name(int stage);
+
+  void encode(bufferlist& bl) const;
+  void decode(bufferlist::iterator& bl);
+  void dump(Formatter *f) const;
+  static void generate_test_instances(list<osd_optrace_t*>& o);
+};
+WRITE_CLASS_ENCODER(osd_optrace_t)
+
+ostream& operator<<(ostream& out, const osd_optrace_t& trace);
+
 // Internal OSD op flags - set by the OSD based on the op types
 enum {
   CEPH_OSD_RMW_FLAG_READ        = (1 << 1),
@@ -354,6 +394,18 @@ struct pg_t {
     ::encode(m_seed, bl);
     ::encode(m_preferred, bl);
   }
+  void bound_encode(size_t& p) const {
+    denc((__u8)1, p);
+    denc(m_pool, p);
+    denc(m_seed, p);
+    denc(m_preferred, p);
+  }
+  void encode(bufferlist::contiguous_appender& p) const {
+    denc((__u8)1, p);
+    denc(m_pool, p);
+    denc(m_seed, p);
+    denc(m_preferred, p);
+  }
   void decode(bufferlist::iterator& bl) {
     __u8 v;
     ::decode(v, bl);
@@ -369,7 +421,7 @@ struct pg_t {
   void dump(Formatter *f) const;
   static void generate_test_instances(list<pg_t*>& o);
 };
-WRITE_CLASS_ENCODER(pg_t)
+WRITE_CLASS_DENC(pg_t)
 
 inline bool operator<(const pg_t& l, const pg_t& r) {
   return l.pool() < r.pool() ||
@@ -468,6 +520,18 @@ struct spg_t {
     ::encode(shard, bl);
     ENCODE_FINISH(bl);
   }
+  void bound_encode(size_t &p) const {
+    DENC_START(1, 1, p);
+    denc(pgid, p);
+    denc(shard, p);
+    DENC_FINISH(p);
+  }
+  void encode(bufferlist::contiguous_appender &p) const {
+    DENC_START(1, 1, p);
+    denc(pgid, p);
+    denc(shard, p);
+    DENC_FINISH(p);
+  }
   void decode(bufferlist::iterator &bl) {
     DECODE_START(1, bl);
     ::decode(pgid, bl);
@@ -481,7 +545,7 @@ struct spg_t {
 		     hobject_t::POOL_TEMP_START - pgid.pool(), "");
   }
 };
-WRITE_CLASS_ENCODER(spg_t)
+WRITE_CLASS_DENC(spg_t)
 WRITE_EQ_OPERATORS_2(spg_t, pgid, shard)
 WRITE_CMP_OPERATORS_2(spg_t, pgid, shard)
 
@@ -699,6 +763,14 @@ public:
     ::encode(version, bl);
     ::encode(epoch, bl);
   }
+  void bound_encode(size_t &p) const {
+    denc(version, p);
+    denc(epoch, p);
+  }
+  void encode(bufferlist::contiguous_appender &p) const {
+    denc(version, p);
+    denc(epoch, p);
+  }
   void decode(bufferlist::iterator &bl) {
     ::decode(version, bl);
     ::decode(epoch, bl);
@@ -708,7 +780,7 @@ public:
     decode(p);
   }
 };
-WRITE_CLASS_ENCODER(eversion_t)
+WRITE_CLASS_DENC(eversion_t)
 
 inline bool operator==(const eversion_t& l, const eversion_t& r) {
   return (l.epoch == r.epoch) && (l.version == r.version);
@@ -922,6 +994,7 @@ struct pg_pool_t {
     FLAG_NOPGCHANGE = 1<<5, // pool's pg and pgp num can't be changed
     FLAG_NOSIZECHANGE = 1<<6, // pool's size and min size can't be changed
     FLAG_WRITE_FADVISE_DONTNEED = 1<<7, // write mode with LIBRADOS_OP_FLAG_FADVISE_DONTNEED
+    FLAG_COMPRESS = 1<<8, // transparently compress full-object writes
   };
 
   static const char *get_flag_name(int f) {
@@ -934,6 +1007,7 @@ struct pg_pool_t {
     case FLAG_NOPGCHANGE: return "nopgchange";
     case FLAG_NOSIZECHANGE: return "nosizechange";
     case FLAG_WRITE_FADVISE_DONTNEED: return "write_fadvise_dontneed";
+    case FLAG_COMPRESS: return "compress";
     default: return "???";
     }
   }
@@ -968,6 +1042,8 @@ struct pg_pool_t {
       return FLAG_NOSIZECHANGE;
     if (name == "write_fadvise_dontneed")
       return FLAG_WRITE_FADVISE_DONTNEED;
+    if (name == "compress")
+      return FLAG_COMPRESS;
     return 0;
   }
 
@@ -1119,6 +1195,9 @@ public:
   uint64_t expected_num_objects; ///< expected number of objects on this pool, a value of 0 indicates
                                  ///< user does not specify any expected value
 
+  string compression_algorithm;  ///< codec for FLAG_COMPRESS pools; "" means async_compressor_type
+  int32_t compression_level;     ///< codec level, 0 = codec default
+
   pg_pool_t()
     : flags(0), type(0), size(0), min_size(0),
       crush_ruleset(0), object_hash(0),
@@ -1144,7 +1223,8 @@ public:
       min_read_recency_for_promote(0),
       min_write_recency_for_promote(0),
       stripe_width(0),
-      expected_num_objects(0)
+      expected_num_objects(0),
+      compression_level(0)
   { }
 
   void dump(Formatter *f) const;
@@ -2472,6 +2552,17 @@ struct pg_log_t {
 
   void encode(bufferlist &bl) const;
   void decode(bufferlist::iterator &bl, int64_t pool = -1);
+
+  /**
+   * delta wire form of encode()/decode()
+   *
+   * Elides per-entry hobject_t and reqid fields that repeat across a
+   * contiguous log segment.  Used by MOSDPGLog between peers with
+   * CEPH_FEATURE_OSD_PGLOG_DELTA; the on-disk log always uses encode().
+   */
+  void encode_compact(bufferlist &bl) const;
+  void decode_compact(bufferlist::iterator &bl);
+
   void dump(Formatter *f) const;
   static void generate_test_instances(list<pg_log_t*>& o);
 };
@@ -2522,6 +2613,33 @@ struct pg_missing_t {
   map<hobject_t, item, hobject_t::ComparatorWithDefault> missing;  // oid -> (need v, have v)
   map<version_t, hobject_t> rmissing;  // v -> oid
 
+  /// compact front filter over the missing set: two bits per object in
+  /// a 1024-bit table.  a clear probe proves the object is not
+  /// missing, which is the overwhelmingly common case on the client op
+  /// path while the pg is degraded, and costs two cache lines instead
+  /// of a map walk.  inserts only: removals leave stale bits behind
+  /// (a hit still consults the map), and the table empties itself
+  /// whenever the set does, which is where recovery always ends up.
+  uint64_t filter[16];
+
+  pg_missing_t() {
+    filter_clear();
+  }
+  void filter_clear() {
+    memset(filter, 0, sizeof(filter));
+  }
+  void filter_insert(const hobject_t& oid) {
+    uint64_t x = (uint64_t)oid.get_hash() * 0x9e3779b97f4a7c15ull;
+    filter[(x >> 6) & 15] |= (uint64_t)1 << (x & 63);
+    filter[(x >> 38) & 15] |= (uint64_t)1 << ((x >> 32) & 63);
+  }
+  bool filter_may_contain(const hobject_t& oid) const {
+    uint64_t x = (uint64_t)oid.get_hash() * 0x9e3779b97f4a7c15ull;
+    return (filter[(x >> 6) & 15] & ((uint64_t)1 << (x & 63))) &&
+	   (filter[(x >> 38) & 15] & ((uint64_t)1 << ((x >> 32) & 63)));
+  }
+  void filter_rebuild();
+
   unsigned int num_missing() const;
   bool have_missing() const;
   void swap(pg_missing_t& o);
@@ -2541,6 +2659,7 @@ struct pg_missing_t {
   void clear() {
     missing.clear();
     rmissing.clear();
+    filter_clear();
   }
 
   void resort(bool sort_bitwise);
@@ -2878,7 +2997,7 @@ struct SnapSet {
   bool head_exists;
   vector<snapid_t> snaps;    // descending
   vector<snapid_t> clones;   // ascending
-  map<snapid_t, interval_set<uint64_t> > clone_overlap;  // overlap w/ next newest
+  map<snapid_t, flat_interval_set<uint64_t> > clone_overlap;  // overlap w/ next newest
   map<snapid_t, uint64_t> clone_size;
 
   SnapSet() : seq(0), head_exists(false) {}
@@ -2988,6 +3107,7 @@ struct object_info_t {
     FLAG_OMAP     = 1 << 3,  // has (or may have) some/any omap data
     FLAG_DATA_DIGEST = 1 << 4,  // has data crc
     FLAG_OMAP_DIGEST = 1 << 5,  // has omap crc
+    FLAG_COMPRESSED = 1 << 6,  // on-disk data is compressed; see compressed_size
     // ...
     FLAG_USES_TMAP = 1<<8,  // deprecated; no longer used.
   } flag_t;
@@ -3010,6 +3130,8 @@ struct object_info_t {
       s += "|data_digest";
     if (flags & FLAG_OMAP_DIGEST)
       s += "|omap_digest";
+    if (flags & FLAG_COMPRESSED)
+      s += "|compressed";
     if (s.length())
       return s.substr(1);
     return s;
@@ -3028,6 +3150,14 @@ struct object_info_t {
   __u32 data_digest;  ///< data crc32c
   __u32 omap_digest;  ///< omap crc32c
 
+  // on-disk length of the compressed blob; only meaningful (and
+  // nonzero) while FLAG_COMPRESSED is set.  size above remains the
+  // logical (uncompressed) object size.
+  uint64_t compressed_size;
+  // codec the blob was written with, so reads keep working after the
+  // pool's codec is changed; "" means async_compressor_type
+  string compression_algorithm;
+
   void copy_user_bits(const object_info_t& other);
 
   static ps_t legacy_object_locator_to_ps(const object_t &oid, 
@@ -3060,6 +3190,24 @@ struct object_info_t {
   bool is_omap_digest() const {
     return test_flag(FLAG_OMAP_DIGEST);
   }
+  bool is_compressed() const {
+    return test_flag(FLAG_COMPRESSED);
+  }
+
+  /// bytes the object actually occupies on disk
+  uint64_t ondisk_size() const {
+    return is_compressed() ? compressed_size : size;
+  }
+  void set_compressed(uint64_t cs, const string &alg) {
+    set_flag(FLAG_COMPRESSED);
+    compressed_size = cs;
+    compression_algorithm = alg;
+  }
+  void clear_compressed() {
+    clear_flag(FLAG_COMPRESSED);
+    compressed_size = 0;
+    compression_algorithm.clear();
+  }
 
   void set_data_digest(__u32 d) {
     set_flag(FLAG_DATA_DIGEST);
@@ -3094,14 +3242,14 @@ struct object_info_t {
   explicit object_info_t()
     : user_version(0), size(0), flags((flag_t)0),
       truncate_seq(0), truncate_size(0),
-      data_digest(-1), omap_digest(-1)
+      data_digest(-1), omap_digest(-1), compressed_size(0)
   {}
 
   object_info_t(const hobject_t& s)
     : soid(s),
       user_version(0), size(0), flags((flag_t)0),
       truncate_seq(0), truncate_size(0),
-      data_digest(-1), omap_digest(-1)
+      data_digest(-1), omap_digest(-1), compressed_size(0)
   {}
 
   object_info_t(bufferlist& bl) {
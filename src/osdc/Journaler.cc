@@ -1087,15 +1087,18 @@ void Journaler::_finish_erase(int data_result, C_OnFinisher *completion)
  *  read entry into bl if it's ready.
  *  otherwise, do nothing.
  */
-bool Journaler::try_read_entry(bufferlist& bl)
+bool Journaler::_try_read_entry(bufferlist& bl, uint64_t *start_off,
+				uint64_t *end_off)
 {
-  Mutex::Locker l(lock);
+  assert(lock.is_locked_by_me());
 
   if (!readable) {
     ldout(cct, 10) << "try_read_entry at " << read_pos << " not readable" << dendl;
     return false;
   }
 
+  *start_off = read_pos;
+
   uint64_t start_ptr;
   size_t consumed;
   try {
@@ -1109,10 +1112,11 @@ bool Journaler::try_read_entry(bufferlist& bl)
     return false;
   }
 
-  ldout(cct, 10) << "try_read_entry at " << read_pos << " read " 
+  ldout(cct, 10) << "try_read_entry at " << read_pos << " read "
 	   << read_pos << "~" << consumed << " (have " << read_buf.length() << ")" << dendl;
 
   read_pos += consumed;
+  *end_off = read_pos;
   try {
     // We were readable, we might not be any more
     readable = _is_readable();
@@ -1122,11 +1126,48 @@ bool Journaler::try_read_entry(bufferlist& bl)
     return false;
   }
 
+  return true;
+}
+
+bool Journaler::try_read_entry(bufferlist& bl)
+{
+  Mutex::Locker l(lock);
+
+  uint64_t start_off, end_off;
+  if (!_try_read_entry(bl, &start_off, &end_off))
+    return false;
+
   // prefetch?
   _prefetch();
   return true;
 }
 
+/* try_read_entries(entries, max)
+ *  drain up to max (0 == no limit) already-fetched entries.  entries
+ *  become readable in batches as prefetched objects arrive, so taking
+ *  them all under one lock hold saves a lock/prefetch round trip per
+ *  entry.  the payload bufferlists share the read buffer's pages.
+ */
+size_t Journaler::try_read_entries(std::list<Entry>& entries, size_t max)
+{
+  Mutex::Locker l(lock);
+
+  size_t n = 0;
+  while (readable && (max == 0 || n < max)) {
+    entries.push_back(Entry());
+    Entry &e = entries.back();
+    if (!_try_read_entry(e.bl, &e.start_off, &e.end_off)) {
+      entries.pop_back();
+      break;
+    }
+    n++;
+  }
+
+  // prefetch?
+  _prefetch();
+  return n;
+}
+
 void Journaler::wait_for_readable(Context *onreadable)
 {
   Mutex::Locker l(lock);
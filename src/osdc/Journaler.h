@@ -364,6 +364,7 @@ private:
   void handle_write_error(int r);
 
   bool _is_readable();
+  bool _try_read_entry(bufferlist& bl, uint64_t *start_off, uint64_t *end_off);
 
   void _finish_erase(int data_result, C_OnFinisher *completion);
   class C_EraseFinish;
@@ -488,7 +489,20 @@ public:
   bool is_readonly() { return readonly; }
   bool is_readable();
   bool try_read_entry(bufferlist& bl);
+
+  /**
+   * An entry drained by try_read_entries().  The payload bufferlist
+   * references the pages of the read buffer; no data copy is made.
+   */
+  struct Entry {
+    uint64_t start_off;  ///< journal offset of the entry envelope
+    uint64_t end_off;    ///< journal offset one past the entry
+    bufferlist bl;       ///< entry payload
+  };
+  size_t try_read_entries(std::list<Entry>& entries, size_t max=0);
+
   uint64_t get_write_pos() const { return write_pos; }
+  uint64_t get_flush_pos() const { return flush_pos; }
   uint64_t get_write_safe_pos() const { return safe_pos; }
   uint64_t get_read_pos() const { return read_pos; }
   uint64_t get_expire_pos() const { return expire_pos; }
@@ -531,6 +531,7 @@ ObjectCacher::ObjectCacher(CephContext *cct_, string name, WritebackHandler& wb,
     max_dirty(max_dirty), target_dirty(target_dirty),
     max_size(max_bytes), max_objects(max_objects),
     block_writes_upfront(block_writes_upfront),
+    flush_candidates(cct_->_conf->client_oc_flush_candidates),
     flush_set_callback(flush_callback), flush_set_callback_arg(flush_callback_arg),
     last_read_tid(0),
     flusher_stop(false), flusher_thread(this), finisher(cct),
@@ -861,14 +862,135 @@ void ObjectCacher::bh_write(BufferHead *bh)
   mark_tx(bh);
 }
 
+void ObjectCacher::bh_write_scattered(list<BufferHead*>& blist)
+{
+  assert(lock.is_locked());
+  assert(!blist.empty());
+
+  Object *ob = blist.front()->ob;
+  ob->get();
+
+  utime_t last_write;
+  SnapContext snapc;
+  vector<pair<loff_t, uint64_t> > ranges;
+  vector<pair<uint64_t, bufferlist> > io_vec;
+
+  ranges.reserve(blist.size());
+  io_vec.reserve(blist.size());
+
+  uint64_t total_len = 0;
+  for (list<BufferHead*>::iterator p = blist.begin(); p != blist.end(); ++p) {
+    BufferHead *bh = *p;
+    ldout(cct, 7) << "bh_write_scattered " << *bh << dendl;
+    assert(bh->ob == ob);
+    assert(bh->bl.length() == bh->length());
+    ranges.push_back(make_pair(bh->start(), bh->length()));
+
+    int n = io_vec.size();
+    io_vec.resize(n + 1);
+    io_vec[n].first = bh->start();
+    io_vec[n].second = bh->bl;
+
+    total_len += bh->length();
+    if (bh->snapc.seq > snapc.seq)
+      snapc = bh->snapc;
+    if (bh->last_write > last_write)
+      last_write = bh->last_write;
+  }
+
+  C_WriteCommit *oncommit = new C_WriteCommit(this, ob->oloc.pool,
+					      ob->get_soid(), ranges);
+
+  ceph_tid_t tid = writeback_handler.write_scattered(ob->get_oid(),
+						     ob->get_oloc(), io_vec,
+						     snapc, last_write,
+						     ob->truncate_size,
+						     ob->truncate_seq,
+						     oncommit);
+  ldout(cct, 20) << " tid " << tid << " on " << ob->get_oid() << dendl;
+
+  oncommit->tid = tid;
+  ob->last_write_tid = tid;
+  for (list<BufferHead*>::iterator p = blist.begin(); p != blist.end(); ++p) {
+    BufferHead *bh = *p;
+    bh->last_write_tid = tid;
+    mark_tx(bh);
+  }
+
+  if (perfcounter) {
+    perfcounter->inc(l_objectcacher_data_flushed, total_len);
+  }
+}
+
+/*
+ * Start writeback on bh plus any other dirty buffers belonging to the
+ * same object, so the writeback handler can merge them into a single
+ * osd op.  All buffers in one op must share bh's snap context.  Returns
+ * the number of buffers written; *wrote (if non-NULL) gets the byte
+ * count.  max_amount==0 means no byte limit.
+ */
+int ObjectCacher::bh_write_adjacencies(BufferHead *bh, utime_t cutoff,
+				       loff_t max_amount, loff_t *wrote)
+{
+  assert(lock.is_locked());
+  list<BufferHead*> blist;
+  int count = 0;
+  loff_t total_len = 0;
+
+  Object *ob = bh->ob;
+  map<loff_t,BufferHead*>::iterator it = ob->data.find(bh->start());
+  assert(it != ob->data.end());
+
+  for (map<loff_t,BufferHead*>::iterator p = it; p != ob->data.end(); ++p) {
+    BufferHead *obh = p->second;
+    if (obh != bh &&
+	(!obh->is_dirty() || obh->last_write > cutoff ||
+	 obh->snapc.seq != bh->snapc.seq))
+      continue;
+    blist.push_back(obh);
+    ++count;
+    total_len += obh->length();
+    if (max_amount && total_len >= max_amount)
+      break;
+  }
+  if (!max_amount || total_len < max_amount) {
+    for (map<loff_t,BufferHead*>::iterator p = it; p != ob->data.begin(); ) {
+      --p;
+      BufferHead *obh = p->second;
+      if (!obh->is_dirty() || obh->last_write > cutoff ||
+	  obh->snapc.seq != bh->snapc.seq)
+	continue;
+      blist.push_front(obh);
+      ++count;
+      total_len += obh->length();
+      if (max_amount && total_len >= max_amount)
+	break;
+    }
+  }
+
+  bh_write_scattered(blist);
+  if (wrote)
+    *wrote = total_len;
+  return count;
+}
+
 void ObjectCacher::bh_write_commit(int64_t poolid, sobject_t oid, loff_t start,
 				   uint64_t length, ceph_tid_t tid, int r)
+{
+  vector<pair<loff_t, uint64_t> > ranges;
+  ranges.push_back(make_pair(start, length));
+  bh_write_commit(poolid, oid, ranges, tid, r);
+}
+
+void ObjectCacher::bh_write_commit(int64_t poolid, sobject_t oid,
+				   vector<pair<loff_t, uint64_t> >& ranges,
+				   ceph_tid_t tid, int r)
 {
   assert(lock.is_locked());
-  ldout(cct, 7) << "bh_write_commit " 
-		<< oid 
+  ldout(cct, 7) << "bh_write_commit "
+		<< oid
 		<< " tid " << tid
-		<< " " << start << "~" << length
+		<< " ranges " << ranges
 		<< " returned " << r
 		<< dendl;
 
@@ -877,66 +999,73 @@ void ObjectCacher::bh_write_commit(int64_t poolid, sobject_t oid, loff_t start,
   } else {
     Object *ob = objects[poolid][oid];
     int was_dirty_or_tx = ob->oset->dirty_or_tx;
-    
-    if (!ob->exists) {
-      ldout(cct, 10) << "bh_write_commit marking exists on " << *ob << dendl;
-      ob->exists = true;
 
-      if (writeback_handler.may_copy_on_write(ob->get_oid(), start, length, ob->get_snap())) {
-	ldout(cct, 10) << "bh_write_commit may copy on write, clearing complete on " << *ob << dendl;
-	ob->complete = false;
-      }
-    }
+    for (vector<pair<loff_t, uint64_t> >::iterator q = ranges.begin();
+	 q != ranges.end();
+	 ++q) {
+      loff_t start = q->first;
+      uint64_t length = q->second;
 
-    list <BufferHead*> hit;
-    // apply to bh's!
-    for (map<loff_t, BufferHead*>::iterator p = ob->data_lower_bound(start);
-         p != ob->data.end();
-         ++p) {
-      BufferHead *bh = p->second;
-      
-      if (bh->start() > start+(loff_t)length)
-	break;
+      if (!ob->exists) {
+	ldout(cct, 10) << "bh_write_commit marking exists on " << *ob << dendl;
+	ob->exists = true;
 
-      if (bh->start() < start &&
-          bh->end() > start+(loff_t)length) {
-        ldout(cct, 20) << "bh_write_commit skipping " << *bh << dendl;
-        continue;
-      }
-      
-      // make sure bh is tx
-      if (!bh->is_tx()) {
-        ldout(cct, 10) << "bh_write_commit skipping non-tx " << *bh << dendl;
-        continue;
-      }
-      
-      // make sure bh tid matches
-      if (bh->last_write_tid != tid) {
-        assert(bh->last_write_tid > tid);
-        ldout(cct, 10) << "bh_write_commit newer tid on " << *bh << dendl;
-        continue;
+	if (writeback_handler.may_copy_on_write(ob->get_oid(), start, length, ob->get_snap())) {
+	  ldout(cct, 10) << "bh_write_commit may copy on write, clearing complete on " << *ob << dendl;
+	  ob->complete = false;
+	}
       }
 
-      if (r >= 0) {
-	// ok!  mark bh clean and error-free
-	mark_clean(bh);
-	if (bh->get_nocache())
-	  bh_lru_rest.lru_bottouch(bh);
-	hit.push_back(bh);
-	ldout(cct, 10) << "bh_write_commit clean " << *bh << dendl;
-      } else {
-	mark_dirty(bh);
-	ldout(cct, 10) << "bh_write_commit marking dirty again due to error "
-		       << *bh << " r = " << r << " " << cpp_strerror(-r)
-		       << dendl;
+      list <BufferHead*> hit;
+      // apply to bh's!
+      for (map<loff_t, BufferHead*>::iterator p = ob->data_lower_bound(start);
+	   p != ob->data.end();
+	   ++p) {
+	BufferHead *bh = p->second;
+
+	if (bh->start() > start+(loff_t)length)
+	  break;
+
+	if (bh->start() < start &&
+	    bh->end() > start+(loff_t)length) {
+	  ldout(cct, 20) << "bh_write_commit skipping " << *bh << dendl;
+	  continue;
+	}
+
+	// make sure bh is tx
+	if (!bh->is_tx()) {
+	  ldout(cct, 10) << "bh_write_commit skipping non-tx " << *bh << dendl;
+	  continue;
+	}
+
+	// make sure bh tid matches
+	if (bh->last_write_tid != tid) {
+	  assert(bh->last_write_tid > tid);
+	  ldout(cct, 10) << "bh_write_commit newer tid on " << *bh << dendl;
+	  continue;
+	}
+
+	if (r >= 0) {
+	  // ok!  mark bh clean and error-free
+	  mark_clean(bh);
+	  if (bh->get_nocache())
+	    bh_lru_rest.lru_bottouch(bh);
+	  hit.push_back(bh);
+	  ldout(cct, 10) << "bh_write_commit clean " << *bh << dendl;
+	} else {
+	  mark_dirty(bh);
+	  ldout(cct, 10) << "bh_write_commit marking dirty again due to error "
+			 << *bh << " r = " << r << " " << cpp_strerror(-r)
+			 << dendl;
+	}
       }
-    }
 
-    for (list<BufferHead*>::iterator bh = hit.begin();
-	bh != hit.end();
-	++bh) {
-      assert(*bh);
-      ob->try_merge_bh(*bh);
+      for (list<BufferHead*>::iterator bh = hit.begin();
+	   bh != hit.end();
+	   ++bh) {
+	assert(*bh);
+	ob->try_merge_bh(*bh);
+      }
     }
 
     // update last_commit.
@@ -965,13 +1094,31 @@ void ObjectCacher::bh_write_commit(int64_t poolid, sobject_t oid, loff_t start,
   }
 }
 
+// dirty bytes in bh's object that a scattered write starting at bh
+// would merge (same eligibility rules as bh_write_adjacencies)
+loff_t ObjectCacher::dirty_run_length(BufferHead *bh, utime_t cutoff)
+{
+  loff_t total = 0;
+  Object *ob = bh->ob;
+  for (map<loff_t,BufferHead*>::iterator p = ob->data.begin();
+       p != ob->data.end();
+       ++p) {
+    BufferHead *obh = p->second;
+    if (obh == bh ||
+	(obh->is_dirty() && obh->last_write <= cutoff &&
+	 obh->snapc.seq == bh->snapc.seq))
+      total += obh->length();
+  }
+  return total;
+}
+
 void ObjectCacher::flush(loff_t amount)
 {
   assert(lock.is_locked());
   utime_t cutoff = ceph_clock_now(cct);
 
   ldout(cct, 10) << "flush " << amount << dendl;
-  
+
   /*
    * NOTE: we aren't actually pulling things off the LRU here, just looking at the
    * tail item.  Then we call bh_write, which moves it to the other LRU, so that we
@@ -983,9 +1130,37 @@ void ObjectCacher::flush(loff_t amount)
     if (!bh) break;
     if (bh->last_write > cutoff) break;
 
-    did += bh->length();
-    bh_write(bh);
-  }    
+    if (writeback_handler.can_scattered_write()) {
+      // among the oldest dirty bhs, start with the one whose object
+      // holds the most mergeable dirty data, so we issue the largest
+      // scattered writes first instead of shredding sequential data
+      // into lru order
+      if (flush_candidates > 1) {
+	vector<LRUObject*> cands;
+	bh_lru_dirty.lru_peek_expire_candidates(flush_candidates, cands);
+	loff_t best_len = dirty_run_length(bh, cutoff);
+	for (unsigned i = 0; i < cands.size(); ++i) {
+	  BufferHead *cand = static_cast<BufferHead*>(cands[i]);
+	  if (cand == bh || cand->last_write > cutoff)
+	    continue;
+	  loff_t len = dirty_run_length(cand, cutoff);
+	  if (len > best_len) {
+	    best_len = len;
+	    bh = cand;
+	  }
+	}
+	ldout(cct, 20) << "flush picked bh " << *bh << " with run "
+		       << best_len << " from " << cands.size()
+		       << " candidates" << dendl;
+      }
+      loff_t wrote = 0;
+      bh_write_adjacencies(bh, cutoff, amount > 0 ? amount - did : 0, &wrote);
+      did += wrote;
+    } else {
+      did += bh->length();
+      bh_write(bh);
+    }
+  }
 }
 
 
@@ -1102,15 +1277,19 @@ int ObjectCacher::_readx(OSDRead *rd, ObjectSet *oset, Context *onfinish,
       if (writeback_handler.may_copy_on_write(soid.oid, ex_it->offset, ex_it->length, soid.snap)) {
 	ldout(cct, 20) << "readx  may copy on write" << dendl;
 	bool wait = false;
-	for (map<loff_t, BufferHead*>::iterator bh_it = o->data.begin();
-	     bh_it != o->data.end();
-	     ++bh_it) {
-	  BufferHead *bh = bh_it->second;
-	  if (bh->is_dirty() || bh->is_tx()) {
-	    ldout(cct, 10) << "readx  flushing " << *bh << dendl;
-	    wait = true;
-	    if (bh->is_dirty())
-	      bh_write(bh);
+	if (writeback_handler.can_scattered_write()) {
+	  wait = !flush(o, 0, 0);
+	} else {
+	  for (map<loff_t, BufferHead*>::iterator bh_it = o->data.begin();
+	       bh_it != o->data.end();
+	       ++bh_it) {
+	    BufferHead *bh = bh_it->second;
+	    if (bh->is_dirty() || bh->is_tx()) {
+	      ldout(cct, 10) << "readx  flushing " << *bh << dendl;
+	      wait = true;
+	      if (bh->is_dirty())
+		bh_write(bh);
+	    }
 	  }
 	}
 	if (wait) {
@@ -1563,11 +1742,16 @@ void ObjectCacher::flusher_entry()
       int max = MAX_FLUSH_UNDER_LOCK;
       while ((bh = static_cast<BufferHead*>(bh_lru_dirty.lru_get_next_expire())) != 0 &&
 	     bh->last_write < cutoff &&
-	     --max > 0) {
+	     max > 0) {
 	ldout(cct, 10) << "flusher flushing aged dirty bh " << *bh << dendl;
-	bh_write(bh);
+	if (writeback_handler.can_scattered_write()) {
+	  max -= bh_write_adjacencies(bh, cutoff, 0, NULL);
+	} else {
+	  bh_write(bh);
+	  --max;
+	}
       }
-      if (!max) {
+      if (max <= 0) {
 	// back off the lock to avoid starving other threads
 	lock.Unlock();
         writeback_handler.put_client_lock();
@@ -1682,6 +1866,8 @@ bool ObjectCacher::flush(Object *ob, loff_t offset, loff_t length)
 {
   assert(lock.is_locked());
   bool clean = true;
+  bool scattered_write = writeback_handler.can_scattered_write();
+  list<BufferHead*> blist;
   ldout(cct, 10) << "flush " << *ob << " " << offset << "~" << length << dendl;
   for (map<loff_t,BufferHead*>::iterator p = ob->data_lower_bound(offset); p != ob->data.end(); ++p) {
     BufferHead *bh = p->second;
@@ -1696,9 +1882,21 @@ bool ObjectCacher::flush(Object *ob, loff_t offset, loff_t length)
     if (!bh->is_dirty()) {
       continue;
     }
-    bh_write(bh);
+    if (scattered_write) {
+      // a merged op carries a single snap context; flush buffers from
+      // an older context before starting a batch for a newer one
+      if (!blist.empty() && blist.front()->snapc.seq != bh->snapc.seq) {
+	bh_write_scattered(blist);
+	blist.clear();
+      }
+      blist.push_back(bh);
+    } else {
+      bh_write(bh);
+    }
     clean = false;
   }
+  if (!blist.empty())
+    bh_write_scattered(blist);
   return clean;
 }
 
@@ -1734,17 +1932,30 @@ bool ObjectCacher::flush_set(ObjectSet *oset, Context *onfinish)
   C_GatherBuilder gather(cct);
   set<Object*> waitfor_commit;
 
-  set<BufferHead*>::iterator next, it;
-  next = it = dirty_or_tx_bh.begin();
-  while (it != dirty_or_tx_bh.end()) {
-    ++next;
-    BufferHead *bh = *it;
-    waitfor_commit.insert(bh->ob);
-
-    if (bh->is_dirty())
-      bh_write(bh);
+  if (writeback_handler.can_scattered_write()) {
+    // gather the objects up front so each one can flush its dirty
+    // buffers as a single merged op
+    for (set<BufferHead*>::iterator it = dirty_or_tx_bh.begin();
+	 it != dirty_or_tx_bh.end();
+	 ++it)
+      waitfor_commit.insert((*it)->ob);
+    for (set<Object*>::iterator i = waitfor_commit.begin();
+	 i != waitfor_commit.end();
+	 ++i)
+      flush(*i, 0, 0);
+  } else {
+    set<BufferHead*>::iterator next, it;
+    next = it = dirty_or_tx_bh.begin();
+    while (it != dirty_or_tx_bh.end()) {
+      ++next;
+      BufferHead *bh = *it;
+      waitfor_commit.insert(bh->ob);
+
+      if (bh->is_dirty())
+	bh_write(bh);
 
-    it = next;
+      it = next;
+    }
   }
 
   for (set<Object*>::iterator i = waitfor_commit.begin();
@@ -201,6 +201,7 @@ class ObjectCacher {
 
   public:
     map<loff_t, BufferHead*>     data;
+    map<loff_t, BufferHead*>::iterator data_hint;  ///< last lookup result
 
     ceph_tid_t last_write_tid;  // version of bh (if non-zero)
     ceph_tid_t last_commit_tid; // last update commited.
@@ -221,6 +222,7 @@ class ObjectCacher {
       oid(o), object_no(ono), oset(os), set_item(this), oloc(l),
       truncate_size(ts), truncate_seq(tq),
       complete(false), exists(true),
+      data_hint(data.end()),
       last_write_tid(0), last_commit_tid(0),
       dirty_or_tx(0) {
       // add to set
@@ -264,18 +266,32 @@ class ObjectCacher {
     /**
      * find first buffer that includes or follows an offset
      *
+     * Buffers are non-overlapping, so this is the first buffer ending
+     * past the offset.  Sequential and repeated accesses usually land
+     * on or just past the previous result, so try a short walk from
+     * the remembered hint before paying for a full tree descent.
+     *
      * @param offset object byte offset
      * @return iterator pointing to buffer, or data.end()
      */
     map<loff_t,BufferHead*>::iterator data_lower_bound(loff_t offset) {
-      map<loff_t,BufferHead*>::iterator p = data.lower_bound(offset);
+      map<loff_t,BufferHead*>::iterator p;
+      if (data_hint != data.end() && data_hint->first <= offset) {
+	p = data_hint;
+	int steps = 4;
+	while (p != data.end() && p->second->end() <= offset && steps-- > 0)
+	  ++p;
+	if (p == data.end() || p->second->end() > offset)
+	  return data_hint = p;
+      }
+      p = data.lower_bound(offset);
       if (p != data.begin() &&
 	  (p == data.end() || p->first > offset)) {
 	--p;     // might overlap!
 	if (p->first + p->second->length() <= offset)
 	  ++p;   // doesn't overlap.
       }
-      return p;
+      return data_hint = p;
     }
 
     // bh
@@ -288,6 +304,8 @@ class ObjectCacher {
     }
     void remove_bh(BufferHead *bh) {
       assert(data.count(bh->start()));
+      if (data_hint != data.end() && data_hint->first == bh->start())
+	++data_hint;
       data.erase(bh->start());
       if (data.empty())
 	put();
@@ -358,6 +376,8 @@ class ObjectCacher {
   uint64_t max_dirty, target_dirty, max_size, max_objects;
   utime_t max_dirty_age;
   bool block_writes_upfront;
+  /// oldest dirty bhs examined per flush to find the largest mergeable run
+  uint32_t flush_candidates;
 
   flush_set_callback_t flush_set_callback;
   void *flush_set_callback_arg;
@@ -465,6 +485,10 @@ class ObjectCacher {
   // io
   void bh_read(BufferHead *bh, int op_flags);
   void bh_write(BufferHead *bh);
+  void bh_write_scattered(list<BufferHead*>& blist);
+  int bh_write_adjacencies(BufferHead *bh, utime_t cutoff,
+			   loff_t max_amount, loff_t *wrote);
+  loff_t dirty_run_length(BufferHead *bh, utime_t cutoff);
 
   void trim();
   void flush(loff_t amount=0);
@@ -498,6 +522,9 @@ class ObjectCacher {
 		      bool trust_enoent);
   void bh_write_commit(int64_t poolid, sobject_t oid, loff_t offset,
 		       uint64_t length, ceph_tid_t t, int r);
+  void bh_write_commit(int64_t poolid, sobject_t oid,
+		       vector<pair<loff_t, uint64_t> >& ranges,
+		       ceph_tid_t t, int r);
 
   class C_ReadFinish : public Context {
     ObjectCacher *oc;
@@ -539,10 +566,19 @@ class ObjectCacher {
     uint64_t length;
   public:
     ceph_tid_t tid;
+    vector<pair<loff_t, uint64_t> > ranges;
     C_WriteCommit(ObjectCacher *c, int64_t _poolid, sobject_t o, loff_t s, uint64_t l) :
       oc(c), poolid(_poolid), oid(o), start(s), length(l), tid(0) {}
+    C_WriteCommit(ObjectCacher *c, int64_t _poolid, sobject_t o,
+		  vector<pair<loff_t, uint64_t> >& _ranges) :
+      oc(c), poolid(_poolid), oid(o), start(0), length(0), tid(0) {
+      ranges.swap(_ranges);
+    }
     void finish(int r) {
-      oc->bh_write_commit(poolid, oid, start, length, tid, r);
+      if (ranges.empty())
+	oc->bh_write_commit(poolid, oid, start, length, tid, r);
+      else
+	oc->bh_write_commit(poolid, oid, ranges, tid, r);
     }
   };
 
@@ -41,6 +41,7 @@
 #include "messages/MCommandReply.h"
 
 #include "messages/MWatchNotify.h"
+#include "messages/MWatchPing.h"
 
 #include <errno.h>
 
@@ -284,6 +285,15 @@ void Objecter::init()
 	       << cpp_strerror(ret) << dendl;
   }
 
+  ret = admin_socket->register_command("objecter_traces",
+				       "objecter_traces",
+				       m_request_state_hook,
+				       "show recent sampled end-to-end op traces");
+  if (ret < 0 && ret != -EEXIST) {
+    lderr(cct) << "error registering admin socket command: "
+	       << cpp_strerror(ret) << dendl;
+  }
+
   timer_lock.Lock();
   timer.init();
   timer_lock.Unlock();
@@ -403,6 +413,7 @@ void Objecter::shutdown()
   if (m_request_state_hook) {
     AdminSocket* admin_socket = cct->get_admin_socket();
     admin_socket->unregister_command("objecter_requests");
+    admin_socket->unregister_command("objecter_traces");
     delete m_request_state_hook;
     m_request_state_hook = NULL;
   }
@@ -611,6 +622,29 @@ void Objecter::_linger_ping(LingerOp *info, int r, utime_t sent,
   }
 }
 
+void Objecter::handle_watch_ping(MWatchPing *m)
+{
+  ldout(cct, 10) << __func__ << " " << *m << dendl;
+  if (!m->reply || m->results.size() != m->watches.size()) {
+    ldout(cct, 0) << __func__ << " malformed " << *m << dendl;
+    return;
+  }
+  RWLock::RLocker rl(rwlock);
+  for (unsigned i = 0; i < m->watches.size(); ++i) {
+    map<uint64_t, LingerOp*>::iterator p =
+      linger_ops.find(m->watches[i].second);
+    if (p == linger_ops.end())
+      continue;
+    LingerOp *info = p->second;
+    if (info->get_cookie() != m->watches[i].first)
+      continue;
+    // unlike the per-op path we do not snapshot register_gen at send
+    // time; a watch re-registered since the ping went out is fresh
+    // anyway, so matching against the current gen is fine
+    _linger_ping(info, m->results[i], m->stamp, info->register_gen);
+  }
+}
+
 int Objecter::linger_check(LingerOp *info)
 {
   RWLock::RLocker l(info->watch_lock);
@@ -852,6 +886,11 @@ bool Objecter::ms_dispatch(Message *m)
     m->put();
     return true;
 
+  case MSG_OSD_WATCH_PING:
+    handle_watch_ping(static_cast<MWatchPing*>(m));
+    m->put();
+    return true;
+
   case MSG_COMMAND_REPLY:
     if (m->get_source().type() == CEPH_ENTITY_TYPE_OSD) {
       handle_command_reply(static_cast<MCommandReply*>(m));
@@ -1025,6 +1064,7 @@ void Objecter::handle_osd_map(MOSDMap *m)
 
     if (osdmap->get_epoch()) {
       bool skipped_map = false;
+      const epoch_t first_epoch = osdmap->get_epoch();
       // we want incrementals
       for (epoch_t e = osdmap->get_epoch() + 1;
 	   e <= m->get_last();
@@ -1060,17 +1100,13 @@ void Objecter::handle_osd_map(MOSDMap *m)
 	logger->set(l_osdc_map_epoch, osdmap->get_epoch());
 
 	was_full = was_full || _osdmap_full_flag();
-	_scan_requests(homeless_session, skipped_map, was_full,
-		       need_resend, need_resend_linger,
-		       need_resend_command);
 
-	// osd addr changes?
+	// osd addr changes?  close sessions to osds that restarted or
+	// moved at the epoch that saw the change, before a later epoch
+	// can bring the osd back at the same address.
 	for (map<int,OSDSession*>::iterator p = osd_sessions.begin();
 	     p != osd_sessions.end(); ) {
 	  OSDSession *s = p->second;
-	  _scan_requests(s, skipped_map, was_full,
-			 need_resend, need_resend_linger,
-			 need_resend_command);
 	  ++p;
 	  if (!osdmap->is_up(s->osd) ||
 	      (s->con &&
@@ -1081,7 +1117,22 @@ void Objecter::handle_osd_map(MOSDMap *m)
 
 	assert(e == osdmap->get_epoch());
       }
-      
+
+      // Scan requests once against the final map instead of at every
+      // epoch; ops only ever need to end up where the newest map says,
+      // and a single MOSDMap routinely carries tens of epochs.
+      if (osdmap->get_epoch() > first_epoch) {
+	_scan_requests(homeless_session, skipped_map, was_full,
+		       need_resend, need_resend_linger,
+		       need_resend_command);
+	for (map<int,OSDSession*>::iterator p = osd_sessions.begin();
+	     p != osd_sessions.end(); ++p) {
+	  _scan_requests(p->second, skipped_map, was_full,
+			 need_resend, need_resend_linger,
+			 need_resend_command);
+	}
+      }
+
     } else {
       // first map.  we want the full thing.
       if (m->maps.count(m->get_last())) {
@@ -1107,6 +1158,9 @@ void Objecter::handle_osd_map(MOSDMap *m)
     }
   }
 
+  // publish the new epoch for lock-free readers (have_map())
+  cached_epoch.set(osdmap->get_epoch());
+
   bool pauserd = osdmap->test_flag(CEPH_OSDMAP_PAUSERD);
   bool pausewr = osdmap->test_flag(CEPH_OSDMAP_PAUSEWR) || _osdmap_full_flag();
 
@@ -1748,12 +1802,9 @@ void Objecter::_wait_for_new_map(Context *c, epoch_t epoch, int err)
  */
 bool Objecter::have_map(const epoch_t epoch)
 {
-  RWLock::RLocker rl(rwlock);
-  if (osdmap->get_epoch() >= epoch) {
-    return true;
-  } else {
-    return false;
-  }
+  // lock-free: cached_epoch is published under rwlock whenever osdmap
+  // changes, and as a pre-check a slightly stale answer is harmless.
+  return cached_epoch.read() >= epoch;
 }
 
 bool Objecter::wait_for_map(epoch_t epoch, Context *c, int err)
@@ -1888,6 +1939,7 @@ void Objecter::tick()
           ++laggy_ops;
         }
       }
+      vector<pair<uint64_t, uint64_t> > batch_pings;
       for (map<uint64_t,LingerOp*>::iterator p = s->linger_ops.begin();
            p != s->linger_ops.end();
            ++p) {
@@ -1896,8 +1948,21 @@ void Objecter::tick()
         assert(op->session);
         ldout(cct, 10) << " pinging osd that serves lingering tid " << p->first << " (osd." << op->session->osd << ")" << dendl;
         toping.insert(op->session);
-	if (op->is_watch && op->registered && !op->last_error)
-	  _send_linger_ping(op);
+	if (op->is_watch && op->registered && !op->last_error) {
+	  if (cct->_conf->objecter_batch_watch_pings)
+	    batch_pings.push_back(make_pair(op->get_cookie(), op->linger_id));
+	  else
+	    _send_linger_ping(op);
+	}
+      }
+      if (!batch_pings.empty()) {
+	// one keepalive for every watch this session holds
+	ldout(cct, 10) << " batch pinging " << batch_pings.size()
+		       << " watches on osd." << s->osd << dendl;
+	MWatchPing *m = new MWatchPing(false, ceph_clock_now(cct));
+	m->watches.swap(batch_pings);
+	logger->inc(l_osdc_linger_ping, m->watches.size());
+	s->con->send_message(m);
       }
       for (map<uint64_t,CommandOp*>::iterator p = s->command_ops.begin();
            p != s->command_ops.end();
@@ -1998,6 +2063,20 @@ ceph_tid_t Objecter::op_submit(Op *op, int *ctx_budget)
   return _op_submit_with_budget(op, lc, ctx_budget);
 }
 
+void Objecter::op_submit_batch(vector<Op*>& ops, vector<ceph_tid_t> *ptids)
+{
+  // take the lock once for the whole batch; each op is still targeted
+  // and budgeted individually, but the osdmap and session table are
+  // consulted under a single lock hold instead of one per op.
+  RWLock::RLocker rl(rwlock);
+  RWLock::Context lc(rwlock, RWLock::Context::TakenForRead);
+  for (vector<Op*>::iterator p = ops.begin(); p != ops.end(); ++p) {
+    ceph_tid_t tid = _op_submit_with_budget(*p, lc);
+    if (ptids)
+      ptids->push_back(tid);
+  }
+}
+
 ceph_tid_t Objecter::_op_submit_with_budget(Op *op, RWLock::Context& lc, int *ctx_budget)
 {
   assert(initialized.read());
@@ -2183,7 +2262,20 @@ ceph_tid_t Objecter::_op_submit(Op *op, RWLock::Context& lc)
   _session_op_assign(s, op);
 
   if (need_send) {
-    _send_op(op, m);
+    // per-OSD adaptive window: hold the op back if the target already
+    // has a full window in flight; it goes out as replies drain (see
+    // _session_window_drain)
+    if (cct->_conf->objecter_adaptive_window_min > 0 &&
+	s->window > 0 && s->window_inflight >= s->window) {
+      ldout(cct, 10) << " deferring " << op->tid << " to osd." << s->osd
+		     << " window " << s->window_inflight << "/" << s->window
+		     << dendl;
+      op->window_deferred = true;
+      s->window_waiting.push_back(op->tid);
+      m->put();
+    } else {
+      _send_op(op, m);
+    }
   }
 
   // Last chance to touch Op here, after giving up session lock it can be
@@ -2612,6 +2704,15 @@ void Objecter::_session_op_remove(OSDSession *from, Op *op)
     num_homeless_ops.dec();
   }
 
+  if (op->window_counted) {
+    op->window_counted = false;
+    --from->window_inflight;
+  }
+  if (op->window_deferred) {
+    op->window_deferred = false;
+    from->window_waiting.remove(op->tid);
+  }
+
   from->ops.erase(op->tid);
   put_session(from);
   op->session = NULL;
@@ -2619,6 +2720,60 @@ void Objecter::_session_op_remove(OSDSession *from, Op *op)
   ldout(cct, 15) << __func__ << " " << from->osd << " " << op->tid << dendl;
 }
 
+void Objecter::_session_window_update(OSDSession *s, Op *op, MOSDOpReply *m)
+{
+  assert(s->lock.is_locked());
+
+  utime_t now = ceph_clock_now(cct);
+  double rtt = (double)(now - op->stamp);
+  if (s->smoothed_rtt <= 0)
+    s->smoothed_rtt = rtt;
+  else
+    s->smoothed_rtt = s->smoothed_rtt * 0.875 + rtt * 0.125;
+
+  int wmin = cct->_conf->objecter_adaptive_window_min;
+  int wmax = cct->_conf->objecter_adaptive_window_max;
+  if (wmax < wmin)
+    wmax = wmin;
+  if (s->window == 0)
+    s->window = wmax;   // first reply; start wide open
+
+  // additive increase while the osd keeps up, multiplicative decrease
+  // when its queue builds or this op's rtt blew past the average
+  uint32_t hint = m->get_queue_depth_hint();
+  bool congested =
+    (hint > (uint32_t)cct->_conf->objecter_backoff_qlen) ||
+    (rtt > s->smoothed_rtt * cct->_conf->objecter_backoff_latency_factor);
+  if (congested)
+    s->window = MAX(wmin, s->window / 2);
+  else if (s->window < wmax)
+    s->window++;
+
+  ldout(cct, 20) << __func__ << " osd." << s->osd << " hint " << hint
+		 << " rtt " << rtt << " smoothed " << s->smoothed_rtt
+		 << (congested ? " congested" : "")
+		 << " window " << s->window_inflight << "/" << s->window
+		 << dendl;
+}
+
+void Objecter::_session_window_drain(OSDSession *s)
+{
+  assert(rwlock.is_locked());
+  assert(s->lock.is_locked());
+
+  while (!s->window_waiting.empty() &&
+	 (s->window == 0 || s->window_inflight < s->window)) {
+    ceph_tid_t tid = s->window_waiting.front();
+    s->window_waiting.pop_front();
+    map<ceph_tid_t, Op*>::iterator p = s->ops.find(tid);
+    if (p == s->ops.end() || !p->second->window_deferred)
+      continue;   // finished or already sent by a resend path
+    ldout(cct, 10) << __func__ << " sending deferred " << tid
+		   << " to osd." << s->osd << dendl;
+    _send_op(p->second);
+  }
+}
+
 void Objecter::_session_linger_op_assign(OSDSession *to, LingerOp *op)
 {
   assert(to->lock.is_wlocked());
@@ -2807,6 +2962,10 @@ MOSDOp *Objecter::_prepare_osd_op(Op *op)
     m->set_reqid(op->reqid);
   }
 
+  uint64_t trace_every = cct->_conf->objecter_trace_every;
+  if (trace_every && (trace_counter.inc() % trace_every) == 0)
+    m->trace.add(osd_optrace_t::STAGE_CLIENT_SUBMIT);
+
   logger->inc(l_osdc_op_send);
   logger->inc(l_osdc_op_send_bytes, m->get_data().length());
 
@@ -2825,6 +2984,15 @@ void Objecter::_send_op(Op *op, MOSDOp *m)
 
   ldout(cct, 15) << "_send_op " << op->tid << " to osd." << op->session->osd << dendl;
 
+  // resend paths may push a window-deferred op out early; that is fine,
+  // just stop tracking it on the waiting list (the tid is skipped when
+  // the drain gets to it)
+  op->window_deferred = false;
+  if (!op->window_counted) {
+    op->window_counted = true;
+    ++op->session->window_inflight;
+  }
+
   ConnectionRef con = op->session->con;
   assert(con);
 
@@ -2845,6 +3013,53 @@ void Objecter::_send_op(Op *op, MOSDOp *m)
 
   m->set_tid(op->tid);
 
+  // reuse the encoded payload from the previous send when the target,
+  // replay version, and peer features are unchanged; only the epoch,
+  // flags, and retry attempt are patched into a fresh copy, so a mass
+  // resend after a map change costs a small memcpy per op instead of
+  // re-encoding the op vector and object locator every time.  traced
+  // ops bypass the cache entirely: their payload tail (the trace blob)
+  // differs on every send
+  if (con->has_feature(CEPH_FEATURE_OBJECTLOCATOR) && !m->trace.enabled()) {
+    uint64_t features = con->get_features();
+    if (op->payload_cache.length() &&
+	features == op->payload_cache_features &&
+	op->target.pgid == op->payload_cache_pgid &&
+	op->target.target_oid == op->payload_cache_oid &&
+	op->target.target_oloc == op->payload_cache_oloc &&
+	op->replay_version == op->payload_cache_replay) {
+      bufferlist pl;
+      pl.append(op->payload_cache.c_str(), op->payload_cache.length());
+      bufferlist head;
+      ::encode((__u32)m->get_map_epoch(), head);
+      ::encode((__u32)m->get_flags(), head);
+      pl.copy_in(sizeof(__u32), head.length(), head.c_str());
+      bufferlist attempt;
+      ::encode((int32_t)m->get_retry_attempt(), attempt);
+      pl.copy_in(op->payload_cache_retry_off, attempt.length(),
+		 attempt.c_str());
+      m->set_preencoded_payload(pl, op->data_cache);
+    } else {
+      m->encode_payload(features);
+      op->payload_cache = m->get_payload();
+      op->data_cache = m->get_data();
+      op->payload_cache_features = features;
+      op->payload_cache_pgid = op->target.pgid;
+      op->payload_cache_oid = op->target.target_oid;
+      op->payload_cache_oloc = op->target.target_oloc;
+      op->payload_cache_replay = op->replay_version;
+      bufferlist r;
+      ::encode(op->reqid, r);
+      bufferlist tr;
+      ::encode(m->trace, tr);  // empty, but still takes payload space
+      op->payload_cache_retry_off = op->payload_cache.length() -
+	tr.length() - r.length() - sizeof(uint64_t) - sizeof(__u32);
+    }
+  }
+
+  if (m->trace.enabled())
+    m->trace.add(osd_optrace_t::STAGE_CLIENT_SEND);
+
   op->session->con->send_message(m);
 }
 
@@ -2967,6 +3182,9 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
     // have, but that is better than doing callbacks out of order.
   }
 
+  if (cct->_conf->objecter_adaptive_window_min > 0)
+    _session_window_update(s, op, m);
+
   Context *onack = 0;
   Context *oncommit = 0;
 
@@ -3010,6 +3228,14 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
   l.unlock();
   lc.set_state(RWLock::Context::Untaken);
 
+  if (m->trace.enabled()) {
+    m->trace.add(osd_optrace_t::STAGE_CLIENT_RECV);
+    Mutex::Locker tl(trace_lock);
+    trace_history.push_back(make_pair(tid, m->trace));
+    if (trace_history.size() > TRACE_HISTORY_MAX)
+      trace_history.pop_front();
+  }
+
   if (op->objver)
     *op->objver = m->get_user_version();
   if (op->reply_epoch)
@@ -3095,6 +3321,10 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
 
   ldout(cct, 5) << num_unacked.read() << " unacked, " << num_uncommitted.read() << " uncommitted" << dendl;
 
+  // push out ops the window was holding back
+  if (cct->_conf->objecter_adaptive_window_min > 0)
+    _session_window_drain(s);
+
   // serialize completions
   if (completion_lock) {
     completion_lock->Lock();
@@ -3132,6 +3362,23 @@ uint32_t Objecter::list_nobjects_seek(NListContext *list_context,
   return list_context->current_pg;
 }
 
+uint32_t Objecter::list_nobjects_set_end(NListContext *list_context,
+					 uint32_t pos)
+{
+  RWLock::RLocker rl(rwlock);
+  const pg_pool_t *pool = osdmap->get_pg_pool(list_context->pool_id);
+  if (pool && pos >= pool->get_pg_num()) {
+    // past the last pg: list to the end of the pool
+    list_context->range_end_pg = 0;
+    return 0;
+  }
+  pg_t actual = osdmap->raw_pg_to_pg(pg_t(pos, list_context->pool_id));
+  ldout(cct, 10) << "list_nobjects_set_end " << list_context
+		 << " pos " << pos << " -> " << actual << dendl;
+  list_context->range_end_pg = actual.ps();
+  return list_context->range_end_pg;
+}
+
 void Objecter::list_nobjects(NListContext *list_context, Context *onfinish)
 {
   ldout(cct, 10) << "list_objects" << dendl;
@@ -3148,9 +3395,11 @@ void Objecter::list_nobjects(NListContext *list_context, Context *onfinish)
     ++list_context->current_pg;
     list_context->current_pg_epoch = 0;
     list_context->cookie = collection_list_handle_t();
-    if (list_context->current_pg >= list_context->starting_pg_num) {
+    if (list_context->current_pg >= list_context->starting_pg_num ||
+	(list_context->range_end_pg &&
+	 list_context->current_pg >= list_context->range_end_pg)) {
       list_context->at_end_of_pool = true;
-      ldout(cct, 20) << " no more pgs; reached end of pool" << dendl;
+      ldout(cct, 20) << " no more pgs; reached end of range" << dendl;
     } else {
       ldout(cct, 20) << " move to next pg " << list_context->current_pg << dendl;
     }
@@ -3180,6 +3429,16 @@ void Objecter::list_nobjects(NListContext *list_context, Context *onfinish)
     list_context->sort_bitwise = osdmap->test_flag(CEPH_OSDMAP_SORTBITWISE);
   }
   if (list_context->starting_pg_num != pg_num) {
+    if (list_context->range_end_pg) {
+      // a ranged listing cannot survive a pg split: the shards no
+      // longer tile the pool.  end this range; the caller must restart
+      // its parallel listing against the new pg count.
+      ldout(cct, 10) << " pg_num changed; ending ranged listing" << dendl;
+      list_context->at_end_of_pool = true;
+      put_nlist_context_budget(list_context);
+      onfinish->complete(0);
+      return;
+    }
     // start reading from the beginning; the pgs have changed
     ldout(cct, 10) << " pg_num changed; restarting with " << pg_num << dendl;
     list_context->current_pg = 0;
@@ -4278,6 +4537,22 @@ void Objecter::dump_statfs_ops(Formatter *fmt) const
   fmt->close_section(); // pool_stat_ops array
 }
 
+void Objecter::dump_traces(Formatter *fmt)
+{
+  Mutex::Locker l(trace_lock);
+  fmt->open_array_section("traces");
+  for (deque<pair<ceph_tid_t, osd_optrace_t> >::const_iterator p =
+	 trace_history.begin();
+       p != trace_history.end();
+       ++p) {
+    fmt->open_object_section("trace");
+    fmt->dump_unsigned("tid", p->first);
+    p->second.dump(fmt);
+    fmt->close_section(); // trace object
+  }
+  fmt->close_section(); // traces array
+}
+
 Objecter::RequestStateHook::RequestStateHook(Objecter *objecter) :
   m_objecter(objecter)
 {
@@ -4287,8 +4562,12 @@ bool Objecter::RequestStateHook::call(std::string command, cmdmap_t& cmdmap,
 				      std::string format, bufferlist& out)
 {
   Formatter *f = Formatter::create(format, "json-pretty", "json-pretty");
-  RWLock::RLocker rl(m_objecter->rwlock);
-  m_objecter->dump_requests(f);
+  if (command == "objecter_traces") {
+    m_objecter->dump_traces(f);
+  } else {
+    RWLock::RLocker rl(m_objecter->rwlock);
+    m_objecter->dump_requests(f);
+  }
   f->flush(out);
   delete f;
   return true;
@@ -1065,6 +1065,7 @@ public:
 
 private:
   atomic64_t last_tid;
+  atomic64_t trace_counter;
   atomic_t inflight_ops;
   atomic_t client_inc;
   uint64_t max_linger_id;
@@ -1083,6 +1084,10 @@ private:
   version_t last_seen_osdmap_version;
   version_t last_seen_pgmap_version;
 
+  /// latest osdmap epoch, published under rwlock but readable without
+  /// it for cheap pre-checks (see have_map())
+  atomic_t cached_epoch;
+
   RWLock rwlock;
   Mutex timer_lock;
   SafeTimer timer;
@@ -1109,6 +1114,12 @@ private:
 
   RequestStateHook *m_request_state_hook;
 
+  /// most recent completed op traces, shown by the objecter_traces
+  /// asok command (see objecter_trace_every)
+  static const unsigned TRACE_HISTORY_MAX = 32;
+  Mutex trace_lock;
+  deque<pair<ceph_tid_t, osd_optrace_t> > trace_history;
+
 public:
   /*** track pending operations ***/
   // read
@@ -1205,12 +1216,29 @@ public:
     /// the very first OP of the series and released upon receiving the last OP reply.
     bool ctx_budgeted;
 
+    /// held back by the session's adaptive in-flight window
+    bool window_deferred;
+    /// counted against the session's in-flight window
+    bool window_counted;
+
     int *data_offset;
 
     epoch_t last_force_resend;
 
     osd_reqid_t reqid; // explicitly setting reqid
 
+    /// encoded payload and data of the last message sent for this op;
+    /// a resend patches only the epoch, flags and attempt fields into
+    /// a copy instead of re-encoding (see Objecter::_send_op)
+    bufferlist payload_cache;
+    bufferlist data_cache;
+    uint64_t payload_cache_features;
+    pg_t payload_cache_pgid;
+    object_t payload_cache_oid;
+    object_locator_t payload_cache_oloc;
+    eversion_t payload_cache_replay;
+    unsigned payload_cache_retry_off;
+
     Op(const object_t& o, const object_locator_t& ol, vector<OSDOp>& op,
        int f, Context *ac, Context *co, version_t *ov, int *offset = NULL) :
       session(NULL), incarnation(0),
@@ -1232,8 +1260,12 @@ public:
       budgeted(false),
       should_resend(true),
       ctx_budgeted(false),
+      window_deferred(false),
+      window_counted(false),
       data_offset(offset),
-      last_force_resend(0) {
+      last_force_resend(0),
+      payload_cache_features(0),
+      payload_cache_retry_off(0) {
       ops.swap(op);
       
       /* initialize out_* to match op vector */
@@ -1323,6 +1355,7 @@ public:
     collection_list_handle_t cookie;
     epoch_t current_pg_epoch;
     int starting_pg_num;
+    int range_end_pg;  ///< stop before this pg (0 = list to end of pool)
     bool at_end_of_pool;
     bool at_end_of_pg;
     bool sort_bitwise;
@@ -1346,6 +1379,7 @@ public:
     int ctx_budget;
 
     NListContext() : current_pg(0), current_pg_epoch(0), starting_pg_num(0),
+		    range_end_pg(0),
 		    at_end_of_pool(false),
 		    at_end_of_pg(false),
 		    sort_bitwise(false),
@@ -1687,11 +1721,22 @@ public:
     int num_locks;
     ConnectionRef con;
 
+    // adaptive in-flight window (AIMD on the osd's queue-depth hint
+    // and op rtt; see Objecter::_session_window_update).  all under
+    // the session lock.
+    int window;            ///< current max ops in flight (0 = not yet sized)
+    int window_inflight;   ///< ops sent and not yet completed
+    double smoothed_rtt;   ///< EWMA of op round trip time, in seconds
+    list<ceph_tid_t> window_waiting;  ///< ops held back by the window
+
     OSDSession(CephContext *cct, int o) :
       lock("OSDSession"),
       osd(o),
       incarnation(0),
-      con(NULL)
+      con(NULL),
+      window(0),
+      window_inflight(0),
+      smoothed_rtt(0)
     {
       num_locks = cct->_conf->objecter_completion_locks_per_session;
       completion_locks = new Mutex *[num_locks];
@@ -1771,6 +1816,8 @@ public:
 
   void _session_op_assign(OSDSession *s, Op *op);
   void _session_op_remove(OSDSession *s, Op *op);
+  void _session_window_update(OSDSession *s, Op *op, class MOSDOpReply *m);
+  void _session_window_drain(OSDSession *s);
   void _session_linger_op_assign(OSDSession *to, LingerOp *op);
   void _session_linger_op_remove(OSDSession *from, LingerOp *op);
   void _session_command_op_assign(OSDSession *to, CommandOp *op);
@@ -1876,17 +1923,21 @@ private:
     messenger(m), monc(mc), finisher(fin),
     osdmap(new OSDMap),
     initialized(0),
-    last_tid(0), client_inc(-1), max_linger_id(0),
+    last_tid(0), trace_counter(0), client_inc(-1), max_linger_id(0),
     num_unacked(0), num_uncommitted(0),
     global_op_flags(0),
     keep_balanced_budget(false), honor_osdmap_full(true),
     last_seen_osdmap_version(0),
     last_seen_pgmap_version(0),
+    cached_epoch(0),
     rwlock("Objecter::rwlock"),
     timer_lock("Objecter::timer_lock"),
-    timer(cct, timer_lock, false),
+    // op timeouts are scheduled and cancelled for every request; use
+    // the wheel backend so that churn stays O(1)
+    timer(cct, timer_lock, false, true),
     logger(NULL), tick_event(NULL),
     m_request_state_hook(NULL),
+    trace_lock("Objecter::trace_lock"),
     num_linger_callbacks(0),
     linger_callback_lock("Objecter::linger_callback_lock"),
     num_homeless_ops(0),
@@ -1950,11 +2001,16 @@ private:
     }
   }
   void ms_fast_dispatch(Message *m) {
-    ms_dispatch(m);
+    // on the fast path nobody else gets a crack at the message, so
+    // drop it ourselves if we didn't consume it (e.g. a reply racing
+    // with shutdown)
+    if (!ms_dispatch(m))
+      m->put();
   }
 
   void handle_osd_op_reply(class MOSDOpReply *m);
   void handle_watch_notify(class MWatchNotify *m);
+  void handle_watch_ping(class MWatchPing *m);
   void handle_osd_map(class MOSDMap *m);
   void wait_for_osd_map();
 
@@ -1971,6 +2027,7 @@ private:
   // public interface
 public:
   ceph_tid_t op_submit(Op *op, int *ctx_budget = NULL);
+  void op_submit_batch(vector<Op*>& ops, vector<ceph_tid_t> *ptids = NULL);
   bool is_active() {
     return !((!inflight_ops.read()) && linger_ops.empty() && poolstat_ops.empty() && statfs_ops.empty());
   }
@@ -1991,6 +2048,7 @@ public:
   void dump_pool_ops(Formatter *fmt) const;
   void dump_pool_stat_ops(Formatter *fmt) const;
   void dump_statfs_ops(Formatter *fmt) const;
+  void dump_traces(Formatter *fmt);
 
   int get_client_incarnation() const { return client_inc.read(); }
   void set_client_incarnation(int inc) { client_inc.set(inc); }
@@ -2469,6 +2527,7 @@ public:
 
   void list_nobjects(NListContext *p, Context *onfinish);
   uint32_t list_nobjects_seek(NListContext *p, uint32_t pos);
+  uint32_t list_nobjects_set_end(NListContext *p, uint32_t pos);
   void list_objects(ListContext *p, Context *onfinish);
   uint32_t list_objects_seek(ListContext *p, uint32_t pos);
 
@@ -26,35 +26,31 @@
 #define dout_prefix *_dout << "striper "
 
 
+namespace {
+  struct objectno_less {
+    bool operator()(const ObjectExtent& l, const ObjectExtent& r) const {
+      return l.objectno < r.objectno;
+    }
+  };
+}
+
 void Striper::file_to_extents(CephContext *cct, const char *object_format,
 			    const ceph_file_layout *layout,
 			    uint64_t offset, uint64_t len, uint64_t trunc_size,
 			    vector<ObjectExtent>& extents,
 			    uint64_t buffer_offset)
 {
-  map<object_t,vector<ObjectExtent> > object_extents;
-  file_to_extents(cct, object_format, layout, offset, len, trunc_size,
-		  object_extents, buffer_offset);
-  assimilate_extents(object_extents, extents);
-}
-
-void Striper::file_to_extents(CephContext *cct, const char *object_format,
-			      const ceph_file_layout *layout,
-			      uint64_t offset, uint64_t len, uint64_t trunc_size,
-			      map<object_t,vector<ObjectExtent> >& object_extents,
-			      uint64_t buffer_offset)
-{
-  ldout(cct, 10) << "file_to_extents " << offset << "~" << len 
+  ldout(cct, 10) << "file_to_extents " << offset << "~" << len
 		 << " format " << object_format
 		 << dendl;
   assert(len > 0);
 
   /*
    * we want only one extent per object!
-   * this means that each extent we read may map into different bits of the 
+   * this means that each extent we read may map into different bits of the
    * final read buffer.. hence ObjectExtent.buffer_extents
    */
-  
+
   __u32 object_size = layout->fl_object_size;
   __u32 su = layout->fl_stripe_unit;
   __u32 stripe_count = layout->fl_stripe_count;
@@ -67,24 +63,37 @@ void Striper::file_to_extents(CephContext *cct, const char *object_format,
   ldout(cct, 20) << " su " << su << " sc " << stripe_count << " os " << object_size
 		 << " stripes_per_object " << stripes_per_object << dendl;
 
+  object_locator_t oloc = OSDMap::file_to_object_locator(*layout);
+
+  // all the layout divisions happen here, once; the loop below advances
+  // one stripe unit at a time with additions and comparisons only
+  uint64_t blockno = offset / su;               // which block
+  uint64_t stripeno = blockno / stripe_count;   // which horizontal stripe        (Y)
+  uint64_t stripepos = blockno % stripe_count;  // which object in the object set (X)
+  uint64_t objectsetno = stripeno / stripes_per_object;      // which object set
+  uint64_t stripeno_in_object = stripeno % stripes_per_object;
+  uint64_t block_off = offset % su;
+
+  // a block can revisit an object only once every stripe_count blocks,
+  // so remember the extent most recently appended at each stripe
+  // position and revisits need neither a name nor a map lookup.  when
+  // the whole range is shorter than one full stripe there are no
+  // revisits and nothing to remember.
+  uint64_t nblocks = (block_off + len + su - 1) / su;
+  vector<size_t> last_ex;
+  if (nblocks > stripe_count)
+    last_ex.resize(stripe_count, (size_t)-1);
+
+  size_t first_extent = extents.size();
+  char buf[strlen(object_format) + 32];
+
   uint64_t cur = offset;
   uint64_t left = len;
   while (left > 0) {
-    // layout into objects
-    uint64_t blockno = cur / su;          // which block
-    uint64_t stripeno = blockno / stripe_count;    // which horizontal stripe        (Y)
-    uint64_t stripepos = blockno % stripe_count;   // which object in the object set (X)
-    uint64_t objectsetno = stripeno / stripes_per_object;       // which object set
     uint64_t objectno = objectsetno * stripe_count + stripepos;  // object id
 
-    // find oid, extent
-    char buf[strlen(object_format) + 32];
-    snprintf(buf, sizeof(buf), object_format, (long long unsigned)objectno);
-    object_t oid = buf;
-
     // map range into object
-    uint64_t block_start = (stripeno % stripes_per_object) * su;
-    uint64_t block_off = cur % su;
+    uint64_t block_start = stripeno_in_object * su;
     uint64_t max = su - block_off;
 
     uint64_t x_offset = block_start + block_off;
@@ -103,32 +112,79 @@ void Striper::file_to_extents(CephContext *cct, const char *object_format,
 		   << dendl;
 
     ObjectExtent *ex = 0;
-    vector<ObjectExtent>& exv = object_extents[oid];
-    if (exv.empty() || exv.back().offset + exv.back().length != x_offset) {
-      exv.resize(exv.size() + 1);
-      ex = &exv.back();
-      ex->oid = oid;
+    size_t li = last_ex.empty() ? (size_t)-1 : last_ex[stripepos];
+    if (li != (size_t)-1 &&
+	extents[li].objectno == objectno &&
+	extents[li].offset + extents[li].length == x_offset) {
+      // add to extent
+      ex = &extents[li];
+      ldout(cct, 20) << " adding in to " << *ex << dendl;
+      ex->length += x_len;
+    } else {
+      // find oid, make new extent
+      snprintf(buf, sizeof(buf), object_format, (long long unsigned)objectno);
+      if (!last_ex.empty())
+	last_ex[stripepos] = extents.size();
+      extents.resize(extents.size() + 1);
+      ex = &extents.back();
+      ex->oid = object_t(buf);
       ex->objectno = objectno;
-      ex->oloc = OSDMap::file_to_object_locator(*layout);
+      ex->oloc = oloc;
 
       ex->offset = x_offset;
       ex->length = x_len;
       ex->truncate_size = object_truncate_size(cct, layout, objectno, trunc_size);
 
       ldout(cct, 20) << " added new " << *ex << dendl;
-    } else {
-      // add to extent
-      ex = &exv.back();
-      ldout(cct, 20) << " adding in to " << *ex << dendl;
-      ex->length += x_len;
     }
     ex->buffer_extents.push_back(make_pair(cur - offset + buffer_offset, x_len));
-        
+
     ldout(cct, 15) << "file_to_extents  " << *ex << " in " << ex->oloc << dendl;
-    //ldout(cct, 0) << "map: ino " << ino << " oid " << ex.oid << " osd " << ex.osd << " offset " << ex.offset << " len " << ex.len << " ... left " << left << dendl;
-    
+
     left -= x_len;
     cur += x_len;
+
+    // advance to the next stripe unit
+    blockno++;
+    block_off = 0;
+    if (++stripepos == stripe_count) {
+      stripepos = 0;
+      stripeno++;
+      if (++stripeno_in_object == stripes_per_object) {
+	stripeno_in_object = 0;
+	objectsetno++;
+      }
+    }
+  }
+
+  // keep the output ordered by object, as it was when it was built by
+  // way of a map keyed on oid
+  std::stable_sort(extents.begin() + first_extent, extents.end(),
+		   objectno_less());
+}
+
+void Striper::file_to_extents(CephContext *cct, const char *object_format,
+			      const ceph_file_layout *layout,
+			      uint64_t offset, uint64_t len, uint64_t trunc_size,
+			      map<object_t,vector<ObjectExtent> >& object_extents,
+			      uint64_t buffer_offset)
+{
+  vector<ObjectExtent> flat;
+  file_to_extents(cct, object_format, layout, offset, len, trunc_size, flat,
+		  buffer_offset);
+  for (vector<ObjectExtent>::iterator p = flat.begin(); p != flat.end(); ++p) {
+    vector<ObjectExtent>& exv = object_extents[p->oid];
+    if (!exv.empty() &&
+	exv.back().offset + exv.back().length == p->offset) {
+      // contiguous with an extent accumulated by an earlier call; extend it
+      ObjectExtent& ex = exv.back();
+      ex.length += p->length;
+      ex.buffer_extents.insert(ex.buffer_extents.end(),
+			       p->buffer_extents.begin(),
+			       p->buffer_extents.end());
+    } else {
+      exv.push_back(*p);
+    }
   }
 }
 
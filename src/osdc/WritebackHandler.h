@@ -33,6 +33,21 @@ class WritebackHandler {
 			   const bufferlist &bl, utime_t mtime,
 			   uint64_t trunc_size, __u32 trunc_seq,
 			   Context *oncommit) = 0;
+  /**
+   * write several non-overlapping extents of one object in a single op
+   *
+   * Only called when can_scattered_write() returns true.
+   */
+  virtual ceph_tid_t write_scattered(const object_t& oid,
+				     const object_locator_t& oloc,
+				     std::vector<std::pair<uint64_t, bufferlist> >& io_vec,
+				     const SnapContext& snapc, utime_t mtime,
+				     uint64_t trunc_size, __u32 trunc_seq,
+				     Context *oncommit) {
+    assert(0 == "write_scattered is not implemented");
+    return 0;
+  }
+  virtual bool can_scattered_write() { return false; }
 
   virtual void get_client_lock() {}
   virtual void put_client_lock() {}
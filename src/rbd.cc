@@ -1123,16 +1123,61 @@ struct ExportContext {
   {}
 };
 
+// Re-orders chunks that completed out of order so they can be written
+// to a non-seekable destination (stdout) strictly sequentially.  The
+// throttle bounds how many chunks can be parked here waiting for an
+// earlier chunk to complete.
+class ExportReorderBuffer {
+public:
+  ExportReorderBuffer(int fd)
+    : m_fd(fd), m_lock("ExportReorderBuffer::lock"), m_next_offset(0),
+      m_error(0)
+  {}
+
+  int write(uint64_t offset, bufferlist &bl) {
+    Mutex::Locker l(m_lock);
+    m_pending[offset].claim(bl);
+    while (!m_pending.empty() &&
+           m_pending.begin()->first == m_next_offset) {
+      bufferlist out;
+      out.claim(m_pending.begin()->second);
+      m_pending.erase(m_pending.begin());
+      m_next_offset += out.length();
+      if (m_error == 0) {
+        int r = out.write_fd(m_fd);
+        if (r < 0) {
+          m_error = r;
+        }
+      }
+    }
+    return m_error;
+  }
+
+  bool empty() {
+    Mutex::Locker l(m_lock);
+    return m_pending.empty();
+  }
+
+private:
+  int m_fd;
+  Mutex m_lock;
+  uint64_t m_next_offset;
+  int m_error;
+  std::map<uint64_t, bufferlist> m_pending;
+};
+
 class AioExportContext : public Context
 {
 public:
   AioExportContext(SimpleThrottle &simple_throttle, librbd::Image &image,
-                   uint64_t offset, uint64_t length, int fd)
+                   uint64_t offset, uint64_t length, int fd,
+                   ExportReorderBuffer *reorder)
     : m_aio_completion(
         new librbd::RBD::AioCompletion(this, &AioExportContext::aio_callback)),
       m_throttle(simple_throttle),
       m_offset(offset),
-      m_fd(fd)
+      m_fd(fd),
+      m_reorder(reorder)
   {
     m_throttle.start_op();
 
@@ -1165,18 +1210,27 @@ public:
     }
 
     assert(m_bufferlist.length() == static_cast<size_t>(r));
-    if (m_fd != STDOUT_FILENO) {
-      if (m_bufferlist.is_zero()) {
-        return;
+    if (m_reorder != NULL) {
+      // non-seekable destination: park the chunk until every earlier
+      // chunk has been written
+      r = m_reorder->write(m_offset, m_bufferlist);
+      if (r < 0) {
+        cerr << "rbd: error writing to destination image at offset "
+             << m_offset << ": " << cpp_strerror(r) << std::endl;
       }
+      return;
+    }
 
-      uint64_t chkret = lseek64(m_fd, m_offset, SEEK_SET);
-      if (chkret != m_offset) {
-        cerr << "rbd: error seeking destination image to offset "
-             << m_offset << std::endl;
-        r = -errno;
-        return;
-      }
+    if (m_bufferlist.is_zero()) {
+      return;
+    }
+
+    uint64_t chkret = lseek64(m_fd, m_offset, SEEK_SET);
+    if (chkret != m_offset) {
+      cerr << "rbd: error seeking destination image to offset "
+           << m_offset << std::endl;
+      r = -errno;
+      return;
     }
 
     r = m_bufferlist.write_fd(m_fd);
@@ -1200,6 +1254,7 @@ private:
   bufferlist m_bufferlist;
   uint64_t m_offset;
   int m_fd;
+  ExportReorderBuffer *m_reorder;
 };
 
 static int do_export(librbd::Image& image, const char *path)
@@ -1210,13 +1265,15 @@ static int do_export(librbd::Image& image, const char *path)
     return r;
 
   int fd;
-  int max_concurrent_ops;
+  int max_concurrent_ops = max(g_conf->rbd_concurrent_management_ops, 1);
   bool to_stdout = (strcmp(path, "-") == 0);
+  boost::scoped_ptr<ExportReorderBuffer> reorder;
   if (to_stdout) {
     fd = STDOUT_FILENO;
-    max_concurrent_ops = 1;
+    // stdout must be written sequentially, but the reads can still run
+    // in parallel with completed chunks re-ordered before the write
+    reorder.reset(new ExportReorderBuffer(fd));
   } else {
-    max_concurrent_ops = max(g_conf->rbd_concurrent_management_ops, 1);
     fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0644);
     if (fd < 0) {
       return -errno;
@@ -1230,11 +1287,14 @@ static int do_export(librbd::Image& image, const char *path)
   uint64_t period = image.get_stripe_count() * (1ull << info.order);
   for (uint64_t offset = 0; offset < info.size; offset += period) {
     uint64_t length = min(period, info.size - offset);
-    new AioExportContext(throttle, image, offset, length, fd);
+    new AioExportContext(throttle, image, offset, length, fd, reorder.get());
     pc.update_progress(offset, info.size);
   }
 
   r = throttle.wait_for_ret();
+  if (r >= 0 && reorder != NULL) {
+    assert(reorder->empty());
+  }
   if (!to_stdout) {
     if (r >= 0) {
       r = ftruncate(fd, info.size);
@@ -1617,7 +1677,10 @@ static int do_import(librbd::RBD &rbd, librados::IoCtx& io_ctx,
   boost::scoped_ptr<SimpleThrottle> throttle;
   bool from_stdin = !strcmp(path, "-");
   if (from_stdin) {
-    throttle.reset(new SimpleThrottle(1, false));
+    // the image writes never overlap and the mid-import resizes only
+    // ever grow, so stdin imports can keep multiple writes in flight
+    throttle.reset(new SimpleThrottle(
+      max(g_conf->rbd_concurrent_management_ops, 1), false));
     fd = 0;
     size = 1ULL << *order;
   } else {
@@ -1835,6 +1835,9 @@ int main(int argc, char **argv)
 
   if (opt_cmd == OPT_BUCKETS_LIST) {
     if (bucket_name.empty()) {
+      bucket_op.set_marker(marker);
+      if (max_entries > 0)
+        bucket_op.set_max_entries(max_entries);
       RGWBucketAdminOp::info(store, bucket_op, f);
     } else {
       RGWBucketInfo bucket_info;
@@ -2385,7 +2388,7 @@ next:
     formatter->open_array_section("objects");
     while (is_truncated) {
       map<string, RGWObjEnt> result;
-      int r = store->cls_bucket_list(bucket, marker, prefix, 1000, true,
+      int r = store->cls_bucket_list(bucket, marker, prefix, string(), 1000, true,
                                      result, &is_truncated, &marker,
                                      bucket_object_check_filter);
 
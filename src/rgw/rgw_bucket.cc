@@ -780,7 +780,7 @@ int RGWBucket::check_object_index(RGWBucketAdminOpState& op_state,
   while (is_truncated) {
     map<string, RGWObjEnt> result;
 
-    int r = store->cls_bucket_list(bucket, marker, prefix, 1000, true,
+    int r = store->cls_bucket_list(bucket, marker, prefix, string(), 1000, true,
                                    result, &is_truncated, &marker,
                                    bucket_object_check_filter);
     if (r == -ENOENT) {
@@ -1067,11 +1067,16 @@ int RGWBucketAdminOp::info(RGWRados *store, RGWBucketAdminOpState& op_state,
     formatter->open_array_section("buckets");
 
     RGWUserBuckets buckets;
-    string marker;
+    string marker = op_state.get_marker();
+    uint64_t left = op_state.get_max_entries(); /* 0 == list everything */
     bool done;
 
     do {
-      ret = rgw_read_user_buckets(store, op_state.get_user_id(), buckets, marker, max_entries, false);
+      size_t read_count = max_entries;
+      if (left && left < read_count)
+        read_count = left;
+
+      ret = rgw_read_user_buckets(store, op_state.get_user_id(), buckets, marker, read_count, false);
       if (ret < 0)
         return ret;
 
@@ -1089,7 +1094,12 @@ int RGWBucketAdminOp::info(RGWRados *store, RGWBucketAdminOpState& op_state,
       }
 
       flusher.flush();
-      done = (m.size() < max_entries);
+      done = (m.size() < read_count);
+      if (left) {
+        left -= m.size();
+        if (!left)
+          done = true;
+      }
     } while (!done);
 
     formatter->close_section();
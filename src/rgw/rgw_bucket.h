@@ -139,6 +139,9 @@ struct RGWBucketAdminOpState {
   bool delete_child_objects;
   bool bucket_stored;
 
+  std::string marker;
+  uint64_t max_entries;
+
   rgw_bucket bucket;
 
   void set_fetch_stats(bool value) { stat_buckets = value; }
@@ -173,6 +176,17 @@ struct RGWBucketAdminOpState {
   }
   const string& get_bucket_id() { return bucket_id; }
 
+  /* paginated bucket listing; continue by passing the last returned
+   * bucket name as the marker, max_entries == 0 lists everything */
+  void set_marker(const std::string& marker_str) {
+    marker = marker_str;
+  }
+  void set_max_entries(uint64_t max) {
+    max_entries = max;
+  }
+  const std::string& get_marker() { return marker; }
+  uint64_t get_max_entries() { return max_entries; }
+
   bool will_fetch_stats() { return stat_buckets; }
   bool will_fix_index() { return fix_index; }
   bool will_delete_children() { return delete_child_objects; }
@@ -181,9 +195,9 @@ struct RGWBucketAdminOpState {
   bool is_system_op() { return uid.empty(); }
   bool has_bucket_stored() { return bucket_stored; }
 
-  RGWBucketAdminOpState() : list_buckets(false), stat_buckets(false), check_objects(false), 
+  RGWBucketAdminOpState() : list_buckets(false), stat_buckets(false), check_objects(false),
                             fix_index(false), delete_child_objects(false),
-                            bucket_stored(false)  {}
+                            bucket_stored(false), max_entries(0)  {}
 };
 
 /*
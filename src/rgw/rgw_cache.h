@@ -7,14 +7,21 @@
 #include "rgw_rados.h"
 #include <string>
 #include <map>
+#include <set>
+#include <vector>
 #include "include/types.h"
 #include "include/utime.h"
 #include "include/assert.h"
+#include "include/ceph_hash.h"
+#include "common/Cond.h"
+#include "common/Mutex.h"
 #include "common/RWLock.h"
+#include "common/Thread.h"
 
 enum {
   UPDATE_OBJ,
   REMOVE_OBJ,
+  DIGEST_OBJS,
 };
 
 #define CACHE_FLAG_DATA           0x01
@@ -138,11 +145,25 @@ struct ObjectCacheEntry {
 };
 
 class ObjectCache {
-  std::map<string, ObjectCacheEntry> cache_map;
-  std::list<string> lru;
-  unsigned long lru_size;
-  unsigned long lru_counter;
+  /*
+   * the cache is sharded by name hash; each shard has its own map, LRU
+   * and rwlock so lookups on different shards never contend.  The top
+   * level lock only guards the shard vector, the chained cache list and
+   * the enabled flag, and is taken for write only on reconfiguration.
+   */
+  struct Shard {
+    std::map<string, ObjectCacheEntry> cache_map;
+    std::list<string> lru;
+    unsigned long lru_size;
+    unsigned long lru_counter;
+    RWLock lock;
+
+    Shard() : lru_size(0), lru_counter(0), lock("ObjectCache::Shard") {}
+  };
+
+  std::vector<Shard *> shards;
   unsigned long lru_window;
+  unsigned long lru_max_per_shard;
   RWLock lock;
   CephContext *cct;
 
@@ -150,19 +171,20 @@ class ObjectCache {
 
   bool enabled;
 
-  void touch_lru(string& name, ObjectCacheEntry& entry, std::list<string>::iterator& lru_iter);
-  void remove_lru(string& name, std::list<string>::iterator& lru_iter);
+  size_t shard_id(const string& name) {
+    return ceph_str_hash_linux(name.c_str(), name.size()) % shards.size();
+  }
+  void touch_lru(Shard& shard, string& name, ObjectCacheEntry& entry, std::list<string>::iterator& lru_iter);
+  void remove_lru(Shard& shard, std::list<string>::iterator& lru_iter);
 
   void do_invalidate_all();
 public:
-  ObjectCache() : lru_size(0), lru_counter(0), lru_window(0), lock("ObjectCache"), cct(NULL), enabled(false) { }
+  ObjectCache() : lru_window(0), lru_max_per_shard(0), lock("ObjectCache"), cct(NULL), enabled(false) { }
+  ~ObjectCache();
   int get(std::string& name, ObjectCacheInfo& bl, uint32_t mask, rgw_cache_entry_info *cache_info);
   void put(std::string& name, ObjectCacheInfo& bl, rgw_cache_entry_info *cache_info);
   void remove(std::string& name);
-  void set_ctx(CephContext *_cct) {
-    cct = _cct;
-    lru_window = cct->_conf->rgw_cache_lru_size / 2;
-  }
+  void set_ctx(CephContext *_cct);
   bool chain_cache_entry(list<rgw_cache_entry_info *>& cache_info_entries, RGWChainedCache::Entry *chained_entry);
 
   void set_enabled(bool status);
@@ -176,6 +198,50 @@ class RGWCache  : public T
 {
   ObjectCache cache;
 
+  /*
+   * when rgw_cache_distribute_interval_ms is set, cache notifications are
+   * queued here and folded into one digest notify per interval by the
+   * flusher thread, instead of one synchronous notify per metadata write
+   */
+  Mutex digest_lock;
+  list<RGWCacheNotifyInfo> pending_notifies;
+  uint64_t digest_counter;
+
+  class DigestFlusher : public Thread {
+    RGWCache<T> *cache;
+    Mutex lock;
+    Cond cond;
+    bool stop_flag;
+  public:
+    DigestFlusher(RGWCache<T> *_cache)
+      : cache(_cache), lock("RGWCache::DigestFlusher"), stop_flag(false) {}
+    void *entry() {
+      lock.Lock();
+      while (!stop_flag) {
+	int ms = cache->cct->_conf->rgw_cache_distribute_interval_ms;
+	if (ms < 1)
+	  ms = 1;
+	utime_t interval(ms / 1000, (ms % 1000) * 1000000);
+	cond.WaitInterval(cache->cct, lock, interval);
+	if (stop_flag)
+	  break;
+	lock.Unlock();
+	cache->flush_pending_notifies();
+	lock.Lock();
+      }
+      lock.Unlock();
+      return NULL;
+    }
+    void stop() {
+      lock.Lock();
+      stop_flag = true;
+      cond.Signal();
+      lock.Unlock();
+      join();
+    }
+  } digest_flusher;
+  bool flusher_started;
+
   int list_objects_raw_init(rgw_bucket& bucket, RGWAccessHandle *handle) {
     return T::list_objects_raw_init(bucket, handle);
   }
@@ -204,6 +270,11 @@ class RGWCache  : public T
     if (ret < 0)
       return ret;
 
+    if (T::cct->_conf->rgw_cache_distribute_interval_ms > 0) {
+      digest_flusher.create();
+      flusher_started = true;
+    }
+
     return 0;
   }
 
@@ -212,6 +283,8 @@ class RGWCache  : public T
   }
 
   int distribute_cache(const string& normal_name, rgw_obj& obj, ObjectCacheInfo& obj_info, int op);
+  void flush_pending_notifies();
+  int apply_notify_info(RGWCacheNotifyInfo& info);
   int watch_cb(uint64_t notify_id,
 	       uint64_t cookie,
 	       uint64_t notifier_id,
@@ -221,7 +294,20 @@ class RGWCache  : public T
     cache.set_enabled(state);
   }
 public:
-  RGWCache() {}
+  RGWCache()
+    : digest_lock("RGWCache::digest_lock"), digest_counter(0),
+      digest_flusher(this), flusher_started(false) {}
+
+  void finalize() {
+    if (flusher_started) {
+      digest_flusher.stop();
+      flusher_started = false;
+      /* the watch is still up until T::finalize(), push out whatever is
+       * left in the queue */
+      flush_pending_notifies();
+    }
+    T::finalize();
+  }
 
   void register_chained_cache(RGWChainedCache *cc) {
     cache.chain_cache(cc);
@@ -569,6 +655,13 @@ int RGWCache<T>::distribute_cache(const string& normal_name, rgw_obj& obj, Objec
 
   info.obj_info = obj_info;
   info.obj = obj;
+
+  if (T::cct->_conf->rgw_cache_distribute_interval_ms > 0) {
+    Mutex::Locker l(digest_lock);
+    pending_notifies.push_back(info);
+    return 0;
+  }
+
   bufferlist bl;
   ::encode(info, bl);
   int ret = T::distribute(normal_name, bl);
@@ -576,29 +669,46 @@ int RGWCache<T>::distribute_cache(const string& normal_name, rgw_obj& obj, Objec
 }
 
 template <class T>
-int RGWCache<T>::watch_cb(uint64_t notify_id,
-			  uint64_t cookie,
-			  uint64_t notifier_id,
-			  bufferlist& bl)
+void RGWCache<T>::flush_pending_notifies()
 {
-  RGWCacheNotifyInfo info;
-
-  try {
-    bufferlist::iterator iter = bl.begin();
-    ::decode(info, iter);
-  } catch (buffer::end_of_buffer& err) {
-    mydout(0) << "ERROR: got bad notification" << dendl;
-    return -EIO;
-  } catch (buffer::error& err) {
-    mydout(0) << "ERROR: buffer::error" << dendl;
-    return -EIO;
+  list<RGWCacheNotifyInfo> notifies;
+  {
+    Mutex::Locker l(digest_lock);
+    notifies.swap(pending_notifies);
   }
+  if (notifies.empty())
+    return;
+
+  bufferlist bl;
+  if (notifies.size() == 1) {
+    ::encode(notifies.front(), bl);
+  } else {
+    RGWCacheNotifyInfo header;
+    header.op = DIGEST_OBJS;
+    ::encode(header, bl);
+    ::encode(notifies, bl);
+  }
+
+  /* spread digests over the control objects; every gateway watches all
+   * of them, the key only picks which one carries this notify */
+  char buf[32];
+  snprintf(buf, sizeof(buf), "digest.%llu", (unsigned long long)digest_counter++);
+  string key = buf;
+
+  mydout(10) << "distributing digest of " << notifies.size() << " cache notifications" << dendl;
+  int r = T::distribute(key, bl);
+  if (r < 0)
+    mydout(0) << "ERROR: failed to distribute cache digest, r=" << r << dendl;
+}
 
+template <class T>
+int RGWCache<T>::apply_notify_info(RGWCacheNotifyInfo& info)
+{
   rgw_bucket bucket;
   string oid;
   normalize_bucket_and_obj(info.obj.bucket, info.obj.get_object(), bucket, oid);
   string name = normal_name(bucket, oid);
-  
+
   switch (info.op) {
   case UPDATE_OBJ:
     cache.put(name, info.obj_info, NULL);
@@ -614,4 +724,36 @@ int RGWCache<T>::watch_cb(uint64_t notify_id,
   return 0;
 }
 
+template <class T>
+int RGWCache<T>::watch_cb(uint64_t notify_id,
+			  uint64_t cookie,
+			  uint64_t notifier_id,
+			  bufferlist& bl)
+{
+  RGWCacheNotifyInfo info;
+  bufferlist::iterator iter = bl.begin();
+
+  try {
+    ::decode(info, iter);
+    if (info.op == DIGEST_OBJS) {
+      /* a batch of notifications follows the header */
+      list<RGWCacheNotifyInfo> entries;
+      ::decode(entries, iter);
+      for (list<RGWCacheNotifyInfo>::iterator eiter = entries.begin();
+	   eiter != entries.end(); ++eiter) {
+	apply_notify_info(*eiter);
+      }
+      return 0;
+    }
+  } catch (buffer::end_of_buffer& err) {
+    mydout(0) << "ERROR: got bad notification" << dendl;
+    return -EIO;
+  } catch (buffer::error& err) {
+    mydout(0) << "ERROR: buffer::error" << dendl;
+    return -EIO;
+  }
+
+  return apply_notify_info(info);
+}
+
 #endif
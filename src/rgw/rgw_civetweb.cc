@@ -9,6 +9,20 @@
 
 #define dout_subsys ceph_subsys_rgw
 
+int RGWMongoose::write_all(const char *buf, int len)
+{
+  int sent = 0;
+  while (sent < len) {
+    int r = mg_write(conn, buf + sent, len - sent);
+    if (r <= 0) {
+      /* didn't send anything, error out */
+      return -EIO;
+    }
+    sent += r;
+  }
+  return len;
+}
+
 int RGWMongoose::write_data(const char *buf, int len)
 {
   if (!header_done) {
@@ -19,16 +33,25 @@ int RGWMongoose::write_data(const char *buf, int len)
     data.append(buf, len);
     return len;
   }
-  int r = mg_write(conn, buf, len);
-  if (r == 0) {
-    /* didn't send anything, error out */
-    return -EIO;
+  if (chunked) {
+    if (!len) {
+      /* a zero length chunk would terminate the response */
+      return 0;
+    }
+    char sizebuf[16];
+    int l = snprintf(sizebuf, sizeof(sizebuf), "%x\r\n", len);
+    if (write_all(sizebuf, l) < 0 ||
+        write_all(buf, len) < 0 ||
+        write_all("\r\n", 2) < 0) {
+      return -EIO;
+    }
+    return len;
   }
-  return r;
+  return write_all(buf, len);
 }
 
-RGWMongoose::RGWMongoose(mg_connection *_conn, int _port) : conn(_conn), port(_port), header_done(false), sent_header(false), has_content_length(false),
-                                                 explicit_keepalive(false), explicit_conn_close(false)
+RGWMongoose::RGWMongoose(mg_connection *_conn, int _port) : conn(_conn), cct(NULL), port(_port), header_done(false), sent_header(false), has_content_length(false),
+                                                 explicit_keepalive(false), explicit_conn_close(false), chunked(false), http_10(false)
 {
 }
 
@@ -47,15 +70,9 @@ int RGWMongoose::complete_request()
     if (!has_content_length) {
       header_done = false; /* let's go back to writing the header */
 
-      if (0 && data.length() == 0) {
-        has_content_length = true;
-        print("Transfer-Enconding: %s\r\n", "chunked");
-        data.append("0\r\n\r\n", sizeof("0\r\n\r\n")-1);
-      } else {
-        int r = send_content_length(data.length());
-        if (r < 0)
-	  return r;
-      }
+      int r = send_content_length(data.length());
+      if (r < 0)
+        return r;
     }
 
     complete_header();
@@ -68,16 +85,25 @@ int RGWMongoose::complete_request()
     data.clear();
   }
 
+  if (chunked) {
+    /* terminating zero length chunk */
+    return write_all("0\r\n\r\n", sizeof("0\r\n\r\n") - 1);
+  }
+
   return 0;
 }
 
-void RGWMongoose::init_env(CephContext *cct)
+void RGWMongoose::init_env(CephContext *_cct)
 {
+  cct = _cct;
   env.init(cct);
   struct mg_request_info *info = mg_get_request_info(conn);
   if (!info)
     return;
 
+  if (info->http_version && strcmp(info->http_version, "1.0") == 0)
+    http_10 = true;
+
   for (int i = 0; i < info->num_headers; i++) {
     struct mg_request_info::mg_header *header = &info->http_headers[i];
 
@@ -175,7 +201,13 @@ int RGWMongoose::complete_header()
   header_done = true;
 
   if (!has_content_length) {
-    return 0;
+    if (http_10 || !cct || !cct->_conf->rgw_civetweb_stream_responses) {
+      /* buffer the body so complete_request() can learn its length */
+      return 0;
+    }
+    /* stream the body with chunked transfer encoding instead */
+    header_data.append("Transfer-Encoding: chunked\r\n");
+    chunked = true;
   }
 
   dump_date_header(header_data);
@@ -15,6 +15,8 @@ class RGWMongoose : public RGWClientIO
 {
   mg_connection *conn;
 
+  CephContext *cct;
+
   bufferlist header_data;
   bufferlist data;
 
@@ -25,6 +27,10 @@ class RGWMongoose : public RGWClientIO
   bool has_content_length;
   bool explicit_keepalive;
   bool explicit_conn_close;
+  bool chunked;     /* streaming the body with chunked transfer encoding */
+  bool http_10;     /* HTTP/1.0 client, can't be sent chunked responses */
+
+  int write_all(const char *buf, int len);
 
 public:
   void init_env(CephContext *cct);
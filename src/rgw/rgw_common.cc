@@ -51,6 +51,11 @@ int rgw_perf_start(CephContext *cct)
   plb.add_u64_counter(l_rgw_keystone_token_cache_hit, "keystone_token_cache_hit", "Keystone token cache hits");
   plb.add_u64_counter(l_rgw_keystone_token_cache_miss, "keystone_token_cache_miss", "Keystone token cache miss");
 
+  plb.add_u64_counter(l_rgw_gc_entries, "gc_entries", "Expired GC entries processed");
+  plb.add_u64_counter(l_rgw_gc_removed_chains, "gc_removed_chains", "GC chains fully reclaimed");
+  plb.add_u64_counter(l_rgw_gc_removed_objs, "gc_removed_objs", "GC tail objects removed");
+  plb.add_u64_counter(l_rgw_gc_failed_objs, "gc_failed_objs", "GC tail object removals that failed");
+
   perfcounter = plb.create_perf_counters();
   cct->get_perfcounters_collection()->add(perfcounter);
   return 0;
@@ -188,6 +188,11 @@ enum {
   l_rgw_keystone_token_cache_hit,
   l_rgw_keystone_token_cache_miss,
 
+  l_rgw_gc_entries,
+  l_rgw_gc_removed_chains,
+  l_rgw_gc_removed_objs,
+  l_rgw_gc_failed_objs,
+
   l_rgw_last,
 };
 
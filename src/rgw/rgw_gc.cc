@@ -8,7 +8,9 @@
 #include "cls/lock/cls_lock_client.h"
 #include "auth/Crypto.h"
 
+#include <deque>
 #include <list>
+#include <set>
 
 #define dout_subsys ceph_subsys_rgw
 
@@ -128,6 +130,62 @@ int RGWGC::list(int *index, string& marker, uint32_t max, bool expired_only, std
   return 0;
 }
 
+/* tracks one gc chain whose tail deletions are in flight */
+struct gc_chain_state {
+  string tag;
+  int remaining;
+  bool all_issued;
+  bool failed;
+
+  gc_chain_state(const string& t) : tag(t), remaining(0), all_issued(false), failed(false) {}
+};
+
+struct gc_inflight_io {
+  AioCompletion *c;
+  gc_chain_state *chain;
+  string pool;
+  string oid;
+  string loc;
+};
+
+static void gc_finalize_chain(gc_chain_state *cs, std::list<string>& remove_tags,
+			      std::set<gc_chain_state *>& live_chains)
+{
+  if (!cs->failed) {
+    remove_tags.push_back(cs->tag);
+    if (perfcounter)
+      perfcounter->inc(l_rgw_gc_removed_chains);
+  }
+  live_chains.erase(cs);
+  delete cs;
+}
+
+static void gc_reap_one(std::deque<gc_inflight_io>& inflight, std::list<string>& remove_tags,
+			std::set<gc_chain_state *>& live_chains)
+{
+  gc_inflight_io io = inflight.front();
+  inflight.pop_front();
+
+  io.c->wait_for_complete();
+  int ret = io.c->get_return_value();
+  io.c->release();
+
+  if (ret == -ENOENT)
+    ret = 0;
+  if (ret < 0) {
+    io.chain->failed = true;
+    dout(0) << "failed to remove " << io.pool << ":" << io.oid << "@" << io.loc << dendl;
+    if (perfcounter)
+      perfcounter->inc(l_rgw_gc_failed_objs);
+  } else if (perfcounter) {
+    perfcounter->inc(l_rgw_gc_removed_objs);
+  }
+
+  io.chain->remaining--;
+  if (io.chain->all_issued && io.chain->remaining == 0)
+    gc_finalize_chain(io.chain, remove_tags, live_chains);
+}
+
 int RGWGC::process(int index, int max_secs)
 {
   rados::cls::lock::Lock l(gc_index_lock_name);
@@ -153,9 +211,15 @@ int RGWGC::process(int index, int max_secs)
   if (ret < 0)
     return ret;
 
+  int aio_window = cct->_conf->rgw_gc_aio_window;
+  if (aio_window < 1)
+    aio_window = 1;
+
   string marker;
   bool truncated;
   IoCtx *ctx = new IoCtx;
+  std::deque<gc_inflight_io> inflight;
+  std::set<gc_chain_state *> live_chains;
   do {
     int max = 100;
     std::list<cls_rgw_gc_obj_info> entries;
@@ -170,7 +234,6 @@ int RGWGC::process(int index, int max_secs)
     string last_pool;
     std::list<cls_rgw_gc_obj_info>::iterator iter;
     for (iter = entries.begin(); iter != entries.end(); ++iter) {
-      bool remove_tag;
       cls_rgw_gc_obj_info& info = *iter;
       std::list<cls_rgw_obj>::iterator liter;
       cls_rgw_obj_chain& chain = info.chain;
@@ -179,16 +242,25 @@ int RGWGC::process(int index, int max_secs)
       if (now >= end)
         goto done;
 
-      remove_tag = true;
+      if (perfcounter)
+        perfcounter->inc(l_rgw_gc_entries);
+
+      gc_chain_state *cs = new gc_chain_state(info.tag);
+      live_chains.insert(cs);
+
       for (liter = chain.objs.begin(); liter != chain.objs.end(); ++liter) {
         cls_rgw_obj& obj = *liter;
 
         if (obj.pool != last_pool) {
+          /* the ioctx can't be dropped while it still has ops in flight */
+          while (!inflight.empty())
+            gc_reap_one(inflight, remove_tags, live_chains);
           delete ctx;
           ctx = new IoCtx;
 	  ret = store->get_rados_handle()->ioctx_create(obj.pool.c_str(), *ctx);
 	  if (ret < 0) {
 	    dout(0) << "ERROR: failed to create ioctx pool=" << obj.pool << dendl;
+	    cs->failed = true;
 	    continue;
 	  }
           last_pool = obj.pool;
@@ -202,29 +274,50 @@ int RGWGC::process(int index, int max_secs)
 	dout(0) << "gc::process: removing " << obj.pool << ":" << key_obj.get_object() << dendl;
 	ObjectWriteOperation op;
 	cls_refcount_put(op, info.tag, true);
-        ret = ctx->operate(key_obj.get_object(), &op);
-	if (ret == -ENOENT)
-	  ret = 0;
-        if (ret < 0) {
-          remove_tag = false;
-          dout(0) << "failed to remove " << obj.pool << ":" << key_obj.get_object() << "@" << obj.loc << dendl;
-        }
+
+	gc_inflight_io io;
+	io.chain = cs;
+	io.pool = obj.pool;
+	io.oid = key_obj.get_object();
+	io.loc = obj.loc;
+	io.c = librados::Rados::aio_create_completion(NULL, NULL, NULL);
+	ret = ctx->aio_operate(io.oid, io.c, &op);
+	if (ret < 0) {
+	  io.c->release();
+	  cs->failed = true;
+	  dout(0) << "failed to remove " << obj.pool << ":" << io.oid << "@" << obj.loc << dendl;
+	} else {
+	  cs->remaining++;
+	  inflight.push_back(io);
+	}
+
+	while ((int)inflight.size() >= aio_window)
+	  gc_reap_one(inflight, remove_tags, live_chains);
 
         if (going_down()) // leave early, even if tag isn't removed, it's ok
           goto done;
       }
-      if (remove_tag) {
-        remove_tags.push_back(info.tag);
+
+      cs->all_issued = true;
+      if (cs->remaining == 0)
+        gc_finalize_chain(cs, remove_tags, live_chains);
+
 #define MAX_REMOVE_CHUNK 16
-        if (remove_tags.size() > MAX_REMOVE_CHUNK) {
-          RGWGC::remove(index, remove_tags);
-          remove_tags.clear();
-        }
+      if (remove_tags.size() > MAX_REMOVE_CHUNK) {
+        RGWGC::remove(index, remove_tags);
+        remove_tags.clear();
       }
     }
   } while (truncated);
 
 done:
+  while (!inflight.empty())
+    gc_reap_one(inflight, remove_tags, live_chains);
+  /* chains whose deletions weren't all issued keep their tags for the next pass */
+  for (std::set<gc_chain_state *>::iterator citer = live_chains.begin();
+       citer != live_chains.end(); ++citer)
+    delete *citer;
+  live_chains.clear();
   if (!remove_tags.empty())
     RGWGC::remove(index, remove_tags);
   l.unlock(&store->gc_pool_ctx, obj_names[index]);
@@ -258,19 +351,29 @@ bool RGWGC::going_down()
 
 void RGWGC::start_processor()
 {
-  worker = new GCWorker(cct, this);
-  worker->create();
+  int num = cct->_conf->rgw_gc_processor_threads;
+  if (num < 1)
+    num = 1;
+  /* workers race for the per-shard cls lock and skip shards another
+   * worker (or gateway) already holds */
+  for (int i = 0; i < num; i++) {
+    GCWorker *worker = new GCWorker(cct, this);
+    worker->create();
+    workers.push_back(worker);
+  }
 }
 
 void RGWGC::stop_processor()
 {
   down_flag.set(1);
-  if (worker) {
-    worker->stop();
-    worker->join();
+  for (size_t i = 0; i < workers.size(); i++) {
+    workers[i]->stop();
+  }
+  for (size_t i = 0; i < workers.size(); i++) {
+    workers[i]->join();
+    delete workers[i];
   }
-  delete worker;
-  worker = NULL;
+  workers.clear();
 }
 
 void *RGWGC::GCWorker::entry() {
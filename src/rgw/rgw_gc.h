@@ -36,9 +36,9 @@ class RGWGC {
     void stop();
   };
 
-  GCWorker *worker;
+  std::vector<GCWorker *> workers;
 public:
-  RGWGC() : cct(NULL), store(NULL), max_objs(0), obj_names(NULL), worker(NULL) {}
+  RGWGC() : cct(NULL), store(NULL), max_objs(0), obj_names(NULL) {}
   ~RGWGC() {
     stop_processor();
     finalize();
@@ -0,0 +1,295 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "common/strtol.h"
+
+#include "rgw_log_trim.h"
+#include "rgw_rados.h"
+#include "rgw_bucket.h"
+#include "rgw_metadata.h"
+#include "rgw_replica_log.h"
+
+#include "cls/log/cls_log_types.h"
+
+#include <string>
+#include <list>
+
+#define dout_subsys ceph_subsys_rgw
+
+using namespace std;
+
+void RGWLogTrimmer::initialize(CephContext *_cct, RGWRados *_store)
+{
+  cct = _cct;
+  store = _store;
+}
+
+int RGWLogTrimmer::trim_data_log_shard(int shard)
+{
+  RGWReplicaObjectLogger logger(store, string(), DATA_REPLICA_LOG_OBJ_PREFIX);
+  RGWReplicaBounds bounds;
+
+  int r = logger.get_bounds(shard, bounds);
+  if (r == -ENOENT)
+    return 0;
+  if (r < 0)
+    return r;
+
+  if (bounds.markers.empty() || bounds.marker.empty())
+    return 0; /* no peer reported progress yet, nothing is safe to trim */
+
+  int batch = cct->_conf->rgw_log_trim_batch_size;
+  utime_t start_time;
+  bool truncated;
+
+  /* only list entries older than the slowest peer's position, so every
+   * batch we see has already been consumed everywhere */
+  do {
+    list<rgw_data_change> entries;
+    string out_marker;
+    truncated = false;
+
+    r = store->data_log->list_entries(shard, start_time, bounds.oldest_time,
+                                      batch, entries, string(), &out_marker, &truncated);
+    if (r < 0)
+      return r;
+
+    if (entries.empty())
+      return 0;
+
+    ldout(cct, 20) << "auto-trim: data log shard=" << shard << " trimming "
+                   << entries.size() << " entries up to " << out_marker << dendl;
+
+    r = store->data_log->trim_entries(shard, start_time, utime_t(), string(), out_marker);
+    if (r < 0)
+      return r;
+  } while (truncated && !going_down());
+
+  return 0;
+}
+
+int RGWLogTrimmer::trim_md_log_shard(int shard)
+{
+  RGWReplicaObjectLogger logger(store, string(), META_REPLICA_LOG_OBJ_PREFIX);
+  RGWReplicaBounds bounds;
+
+  int r = logger.get_bounds(shard, bounds);
+  if (r == -ENOENT)
+    return 0;
+  if (r < 0)
+    return r;
+
+  if (bounds.markers.empty() || bounds.marker.empty())
+    return 0;
+
+  RGWMetadataLog *mdlog = store->meta_mgr->get_log();
+
+  int batch = cct->_conf->rgw_log_trim_batch_size;
+  utime_t start_time;
+  string marker;
+  void *handle;
+
+  mdlog->init_list_entries(shard, start_time, bounds.oldest_time, marker, &handle);
+
+  r = 0;
+  do {
+    list<cls_log_entry> entries;
+    string last_marker;
+    bool truncated = false;
+
+    r = mdlog->list_entries(handle, batch, entries, &last_marker, &truncated);
+    if (r < 0 || entries.empty())
+      break;
+
+    ldout(cct, 20) << "auto-trim: metadata log shard=" << shard << " trimming "
+                   << entries.size() << " entries up to " << last_marker << dendl;
+
+    r = mdlog->trim(shard, start_time, utime_t(), string(), last_marker);
+    if (r < 0 || !truncated)
+      break;
+  } while (!going_down());
+
+  mdlog->complete_list_entries(handle);
+
+  return r;
+}
+
+static int trim_one_bilog(CephContext *cct, RGWRados *store,
+                          RGWReplicaBucketLogger& logger, const string& key)
+{
+  size_t pos = key.find(':');
+  if (pos == string::npos)
+    return 0; /* old-style entry, not indexed by bucket instance */
+
+  string bucket_name = key.substr(0, pos);
+  string instance = key.substr(pos + 1);
+
+  RGWBucketInfo bucket_info;
+  RGWObjectCtx obj_ctx(store);
+  int r = store->get_bucket_info(obj_ctx, bucket_name, bucket_info, NULL);
+  if (r == -ENOENT)
+    return 0; /* bucket is gone, replica log entry is stale */
+  if (r < 0)
+    return r;
+
+  rgw_bucket& bucket = bucket_info.bucket;
+
+  /* the instance is either the bucket id, or the bucket id with a
+   * trailing .<shard> for sharded indexes */
+  int shard_id = -1;
+  if (instance.compare(bucket.bucket_id) != 0) {
+    if (instance.compare(0, bucket.bucket_id.size(), bucket.bucket_id) != 0 ||
+        instance.size() <= bucket.bucket_id.size() + 1 ||
+        instance[bucket.bucket_id.size()] != '.')
+      return 0; /* refers to an older incarnation of the bucket */
+
+    string err;
+    shard_id = strict_strtol(instance.substr(bucket.bucket_id.size() + 1).c_str(), 10, &err);
+    if (!err.empty())
+      return 0;
+  }
+
+  RGWReplicaBounds bounds;
+  r = logger.get_bounds(bucket, shard_id, bounds);
+  if (r == -ENOENT)
+    return 0;
+  if (r < 0)
+    return r;
+
+  if (bounds.markers.empty() || bounds.marker.empty())
+    return 0;
+
+  ldout(cct, 20) << "auto-trim: bucket index log bucket=" << bucket
+                 << " shard=" << shard_id << " trimming up to " << bounds.marker << dendl;
+
+  string start_marker;
+  r = store->trim_bi_log_entries(bucket, shard_id, start_marker, bounds.marker);
+  if (r == -ENOENT || r == -ENODATA)
+    r = 0;
+
+  return r;
+}
+
+int RGWLogTrimmer::trim_bucket_index_logs()
+{
+  string pool_name;
+  store->get_log_pool_name(pool_name);
+  rgw_bucket pool(pool_name.c_str());
+
+  string prefix = cct->_conf->rgw_replica_log_obj_prefix;
+  prefix.append(".");
+
+  RGWReplicaBucketLogger logger(store);
+
+  /* buckets with sync state are exactly those with a replica log entry,
+   * so walk those instead of enumerating every bucket in the system */
+  RGWListRawObjsCtx ctx;
+  bool truncated;
+  do {
+    list<string> oids;
+    truncated = false;
+
+    int r = store->list_raw_objects(pool, prefix, 1000, ctx, oids, &truncated);
+    if (r == -ENOENT)
+      return 0;
+    if (r < 0)
+      return r;
+
+    for (list<string>::iterator iter = oids.begin();
+         iter != oids.end() && !going_down(); ++iter) {
+      r = trim_one_bilog(cct, store, logger, iter->substr(prefix.size()));
+      if (r < 0) {
+        ldout(cct, 0) << "ERROR: failed to trim bucket index log for " << *iter
+                      << " r=" << r << dendl;
+      }
+    }
+  } while (truncated && !going_down());
+
+  return 0;
+}
+
+int RGWLogTrimmer::process()
+{
+  int num_shards = cct->_conf->rgw_data_log_num_shards;
+  for (int i = 0; i < num_shards && !going_down(); i++) {
+    int r = trim_data_log_shard(i);
+    if (r < 0) {
+      ldout(cct, 0) << "ERROR: failed to trim data log shard=" << i << " r=" << r << dendl;
+    }
+  }
+
+  num_shards = cct->_conf->rgw_md_log_max_shards;
+  for (int i = 0; i < num_shards && !going_down(); i++) {
+    int r = trim_md_log_shard(i);
+    if (r < 0) {
+      ldout(cct, 0) << "ERROR: failed to trim metadata log shard=" << i << " r=" << r << dendl;
+    }
+  }
+
+  if (!going_down()) {
+    int r = trim_bucket_index_logs();
+    if (r < 0) {
+      ldout(cct, 0) << "ERROR: failed to trim bucket index logs r=" << r << dendl;
+    }
+  }
+
+  return 0;
+}
+
+bool RGWLogTrimmer::going_down()
+{
+  return (down_flag.read() != 0);
+}
+
+void RGWLogTrimmer::start_processor()
+{
+  worker = new TrimWorker(cct, this);
+  worker->create();
+}
+
+void RGWLogTrimmer::stop_processor()
+{
+  down_flag.set(1);
+  if (worker) {
+    worker->stop();
+    worker->join();
+    delete worker;
+    worker = NULL;
+  }
+}
+
+void *RGWLogTrimmer::TrimWorker::entry() {
+  do {
+    utime_t start = ceph_clock_now(cct);
+    dout(2) << "log auto-trim: start" << dendl;
+    int r = trimmer->process();
+    if (r < 0) {
+      dout(0) << "ERROR: log auto-trim process() returned error r=" << r << dendl;
+    }
+    dout(2) << "log auto-trim: stop" << dendl;
+
+    if (trimmer->going_down())
+      break;
+
+    utime_t end = ceph_clock_now(cct);
+    end -= start;
+    int secs = cct->_conf->rgw_log_auto_trim_interval;
+
+    if (secs <= end.sec())
+      continue; // next round
+
+    secs -= end.sec();
+
+    lock.Lock();
+    cond.WaitInterval(cct, lock, utime_t(secs, 0));
+    lock.Unlock();
+  } while (!trimmer->going_down());
+
+  return NULL;
+}
+
+void RGWLogTrimmer::TrimWorker::stop()
+{
+  Mutex::Locker l(lock);
+  cond.Signal();
+}
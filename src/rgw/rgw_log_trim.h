@@ -0,0 +1,63 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_RGW_LOG_TRIM_H
+#define CEPH_RGW_LOG_TRIM_H
+
+#include "include/types.h"
+#include "include/atomic.h"
+#include "common/Mutex.h"
+#include "common/Cond.h"
+#include "common/Thread.h"
+#include "rgw_common.h"
+
+class RGWRados;
+
+/*
+ * Background trimmer for the metadata log, the data changes log and the
+ * per-bucket index logs.  Replication peers record how far they have
+ * consumed each log in the replica log; everything below the slowest
+ * peer's position is dead weight in the log objects' omaps, and this
+ * service removes it incrementally so the logs never need a manual
+ * radosgw-admin trim.  Shards with no recorded peer progress are never
+ * touched.
+ */
+class RGWLogTrimmer {
+  CephContext *cct;
+  RGWRados *store;
+  atomic_t down_flag;
+
+  class TrimWorker : public Thread {
+    CephContext *cct;
+    RGWLogTrimmer *trimmer;
+    Mutex lock;
+    Cond cond;
+
+  public:
+    TrimWorker(CephContext *_cct, RGWLogTrimmer *_trimmer) : cct(_cct), trimmer(_trimmer), lock("TrimWorker") {}
+    void *entry();
+    void stop();
+  };
+
+  TrimWorker *worker;
+
+  int trim_data_log_shard(int shard);
+  int trim_md_log_shard(int shard);
+  int trim_bucket_index_logs();
+
+public:
+  RGWLogTrimmer() : cct(NULL), store(NULL), worker(NULL) {}
+  ~RGWLogTrimmer() {
+    stop_processor();
+  }
+
+  void initialize(CephContext *_cct, RGWRados *_store);
+
+  int process();
+
+  bool going_down();
+  void start_processor();
+  void stop_processor();
+};
+
+#endif
@@ -972,6 +972,13 @@ void RGWGetObj::execute()
 
   perfcounter->inc(l_rgw_get_b, end - ofs);
 
+  /* large requests benefit from a wider read window: keep enough stripe
+   * reads in flight to cover the whole range, up to the configured cap */
+  if (end - ofs + 1 > s->cct->_conf->rgw_get_obj_window_size) {
+    read_op.params.window_size = MIN((uint64_t)(end - ofs + 1),
+			 (uint64_t)s->cct->_conf->rgw_get_obj_max_window_size);
+  }
+
   ret = read_op.iterate(ofs, end, &cb);
 
   perfcounter->tinc(l_rgw_get_lat,
@@ -3005,7 +3012,8 @@ static int list_multipart_parts(RGWRados *store, struct req_state *s,
                                 string& meta_oid, int num_parts,
                                 int marker, map<uint32_t, RGWUploadPartInfo>& parts,
                                 int *next_marker, bool *truncated,
-                                bool assume_unsorted = false)
+                                bool assume_unsorted = false,
+                                map<string, bufferlist> *prefetched_map = NULL)
 {
   map<string, bufferlist> parts_map;
   map<string, bufferlist>::iterator iter;
@@ -3021,7 +3029,11 @@ static int list_multipart_parts(RGWRados *store, struct req_state *s,
 
   parts.clear();
 
-  if (sorted_omap) {
+  if (sorted_omap && prefetched_map) {
+    /* caller already read this batch of omap keys */
+    parts_map.swap(*prefetched_map);
+    ret = 0;
+  } else if (sorted_omap) {
     string p;
     p = "part.";
     char buf[32];
@@ -3192,8 +3204,41 @@ void RGWCompleteMultipart::execute()
     return;
   }
 
+  /* v2 upload ids keep the part omap sorted, so the marker for every batch
+   * of part entries is known up front from the part count the client sent.
+   * Prefetch all the batches concurrently instead of marker-chaining one
+   * synchronous read per 1000 parts; each batch still goes through
+   * list_multipart_parts() below for decoding and the unsorted-omap
+   * fallback, and completion stays guarded by the same atomic write_meta().
+   */
+  vector<map<string, bufferlist> > prefetched_batches;
+  size_t batch_idx = 0;
+  if (is_v2_upload_id(upload_id) &&
+      (int)parts->parts.size() > max_parts) {
+    vector<string> markers;
+    int num_batches = (parts->parts.size() + max_parts - 1) / max_parts;
+    for (int i = 0; i < num_batches; ++i) {
+      char buf[32];
+      snprintf(buf, sizeof(buf), "part.%08d", i * max_parts);
+      markers.push_back(buf);
+    }
+    int r = store->omap_get_vals_multi(meta_obj, markers, max_parts + 1,
+                                       &prefetched_batches,
+                                       s->cct->_conf->rgw_multipart_complete_max_aio);
+    if (r < 0) {
+      /* fall back to the serial listing below */
+      ldout(s->cct, 5) << "WARNING: failed to prefetch part entries, r=" << r << dendl;
+      prefetched_batches.clear();
+    }
+  }
+
   do {
-    ret = list_multipart_parts(store, s, upload_id, meta_oid, max_parts, marker, obj_parts, &marker, &truncated);
+    map<string, bufferlist> *prefetched_map = NULL;
+    if (batch_idx < prefetched_batches.size()) {
+      prefetched_map = &prefetched_batches[batch_idx++];
+    }
+    ret = list_multipart_parts(store, s, upload_id, meta_oid, max_parts, marker, obj_parts, &marker, &truncated,
+                               false, prefetched_map);
     if (ret == -ENOENT) {
       ret = -ERR_NO_SUCH_UPLOAD;
     }
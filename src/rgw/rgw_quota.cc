@@ -197,6 +197,19 @@ int RGWQuotaCache<T>::get_stats(const string& user, rgw_bucket& bucket, RGWStora
       stats = qs.stats;
       return 0;
     }
+
+    /* the entry expired, but if it's still within the configured staleness
+     * bound we can keep serving it while the async refresh (kicked above)
+     * replaces it, instead of blocking the request on an index read.  Near
+     * the quota limit can_use_cached_stats() already forced us off the
+     * cached value, so enforcement accuracy is unchanged where it matters.
+     */
+    int max_staleness = store->ctx()->_conf->rgw_quota_cache_max_staleness;
+    if (max_staleness > 0 && can_use_cached_stats(quota, qs.stats) &&
+        qs.expiration + utime_t(max_staleness, 0) > now) {
+      stats = qs.stats;
+      return 0;
+    }
   }
 
   int ret = fetch_stats_from_storage(user, bucket, stats);
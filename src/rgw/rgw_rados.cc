@@ -47,6 +47,7 @@ using namespace librados;
 #include "rgw_log.h"
 
 #include "rgw_gc.h"
+#include "rgw_log_trim.h"
 
 #define dout_subsys ceph_subsys_rgw
 
@@ -1052,6 +1053,18 @@ int RGWPutObjProcessor_Atomic::write_data(bufferlist& bl, off_t ofs, void **phan
   return RGWPutObjProcessor_Aio::handle_obj_data(cur_obj, bl, ofs - cur_part_ofs, ofs, phandle, exclusive);
 }
 
+/*
+ * hash buffer by buffer; bl.c_str() on a multi-buffer bufferlist would
+ * rebuild it into one contiguous allocation, copying the whole chunk
+ */
+static void hash_update_bl(MD5 *hash, bufferlist& bl)
+{
+  for (std::list<bufferptr>::const_iterator it = bl.buffers().begin();
+       it != bl.buffers().end(); ++it) {
+    hash->Update((const byte *)it->c_str(), it->length());
+  }
+}
+
 int RGWPutObjProcessor_Atomic::handle_data(bufferlist& bl, off_t ofs, MD5 *hash, void **phandle, bool *again)
 {
   *again = false;
@@ -1087,7 +1100,7 @@ int RGWPutObjProcessor_Atomic::handle_data(bufferlist& bl, off_t ofs, MD5 *hash,
     first_chunk.claim(bl);
     obj_len = (uint64_t)first_chunk.length();
     if (hash) {
-      hash->Update((const byte *)first_chunk.c_str(), obj_len);
+      hash_update_bl(hash, first_chunk);
     }
     int r = prepare_next_part(obj_len);
     if (r < 0) {
@@ -1104,7 +1117,7 @@ int RGWPutObjProcessor_Atomic::handle_data(bufferlist& bl, off_t ofs, MD5 *hash,
   int ret = write_data(bl, write_ofs, phandle, exclusive);
   if (ret >= 0) { /* we might return, need to clear bl as it was already sent */
     if (hash) {
-      hash->Update((const byte *)bl.c_str(), bl.length());
+      hash_update_bl(hash, bl);
     }
     bl.clear();
   }
@@ -1113,7 +1126,7 @@ int RGWPutObjProcessor_Atomic::handle_data(bufferlist& bl, off_t ofs, MD5 *hash,
 
 void RGWPutObjProcessor_Atomic::complete_hash(MD5 *hash)
 {
-  hash->Update((const byte *)pending_data_bl.c_str(), pending_data_bl.length());
+  hash_update_bl(hash, pending_data_bl);
 }
 
 
@@ -1436,6 +1449,12 @@ void RGWRados::finalize()
   if (need_watch_notify()) {
     finalize_watch();
   }
+  if (log_trimmer) {
+    /* stop the trimmer before tearing down the logs it walks */
+    log_trimmer->stop_processor();
+    delete log_trimmer;
+    log_trimmer = NULL;
+  }
   delete meta_mgr;
   delete data_log;
   if (use_gc_thread) {
@@ -1616,6 +1635,12 @@ int RGWRados::init_complete()
   if (use_gc_thread)
     gc->start_processor();
 
+  if (use_gc_thread && cct->_conf->rgw_log_auto_trim_interval > 0) {
+    log_trimmer = new RGWLogTrimmer();
+    log_trimmer->initialize(cct, this);
+    log_trimmer->start_processor();
+  }
+
   quota_handler = RGWQuotaHandler::generate_handler(this, quota_threads);
 
   bucket_index_max_shards = (cct->_conf->rgw_override_bucket_index_max_shards ? cct->_conf->rgw_override_bucket_index_max_shards :
@@ -2449,6 +2474,13 @@ int RGWRados::Bucket::List::list_objects(int max, vector<RGWObjEnt> *result,
 
   string skip_after_delim;
 
+  /* push the delimiter down to the index so the OSD returns only one
+   * boundary entry per common prefix; a name filter must see every entry,
+   * so it disables the pushdown */
+  string osd_delim;
+  if (!params.filter)
+    osd_delim = params.delim;
+
   /* if marker points at a common prefix, fast forward it into its upperbound string */
   if (!params.delim.empty()) {
     int delim_pos = cur_marker.name.find(params.delim, params.prefix.size());
@@ -2465,7 +2497,8 @@ int RGWRados::Bucket::List::list_objects(int max, vector<RGWObjEnt> *result,
       ldout(cct, 20) << "setting cur_marker=" << cur_marker.name << "[" << cur_marker.instance << "]" << dendl;
     }
     std::map<string, RGWObjEnt> ent_map;
-    int r = store->cls_bucket_list(bucket, cur_marker, cur_prefix, max + 1 - count, params.list_versions, ent_map,
+    int r = store->cls_bucket_list(bucket, cur_marker, cur_prefix, osd_delim,
+                            max + 1 - count, params.list_versions, ent_map,
                             &truncated, &cur_marker);
     if (r < 0)
       return r;
@@ -4311,7 +4344,7 @@ int RGWRados::delete_bucket(rgw_bucket& bucket, RGWObjVersionTracker& objv_track
 
   do {
 #define NUM_ENTRIES 1000
-    r = cls_bucket_list(bucket, marker, prefix, NUM_ENTRIES, true, ent_map,
+    r = cls_bucket_list(bucket, marker, prefix, string(), NUM_ENTRIES, true, ent_map,
                         &is_truncated, &marker);
     if (r < 0)
       return r;
@@ -5865,12 +5898,12 @@ struct get_obj_data : public RefCountedObject {
   Throttle throttle;
   list<bufferlist> read_list;
 
-  get_obj_data(CephContext *_cct)
+  get_obj_data(CephContext *_cct, uint64_t window_size)
     : cct(_cct),
       rados(NULL), ctx(NULL),
       total_read(0), lock("get_obj_data"), data_lock("get_obj_data::data_lock"),
       client_cb(NULL),
-      throttle(cct, "get_obj_data", cct->_conf->rgw_get_obj_window_size, false) {}
+      throttle(cct, "get_obj_data", window_size, false) {}
   virtual ~get_obj_data() { } 
   void set_cancelled(int r) {
     cancelled.set(1);
@@ -6187,7 +6220,12 @@ int RGWRados::Object::Read::iterate(int64_t ofs, int64_t end, RGWGetDataCB *cb)
   RGWRados *store = source->get_store();
   CephContext *cct = store->ctx();
 
-  struct get_obj_data *data = new get_obj_data(cct);
+  uint64_t window_size = params.window_size;
+  if (!window_size) {
+    window_size = cct->_conf->rgw_get_obj_window_size;
+  }
+
+  struct get_obj_data *data = new get_obj_data(cct, window_size);
   bool done = false;
 
   RGWObjectCtx& obj_ctx = source->get_ctx();
@@ -7495,7 +7533,79 @@ int RGWRados::omap_get_vals(rgw_obj& obj, bufferlist& header, const string& mark
     return r;
 
   return 0;
- 
+
+}
+
+/*
+ * read multiple omap ranges off the same object concurrently, at most
+ * max_aio rados ops in flight.  vals is resized to match markers; entry
+ * i holds up to count keys following markers[i].
+ */
+int RGWRados::omap_get_vals_multi(rgw_obj& obj, const vector<string>& markers, uint64_t count,
+                                  vector<std::map<string, bufferlist> > *vals, int max_aio)
+{
+  rgw_rados_ref ref;
+  rgw_bucket bucket;
+  int r = get_obj_ref(obj, &ref, &bucket);
+  if (r < 0) {
+    return r;
+  }
+
+  if (max_aio < 1) {
+    max_aio = 1;
+  }
+
+  vals->clear();
+  vals->resize(markers.size());
+  vector<int> rvals(markers.size(), 0);
+  list<librados::AioCompletion *> completions;
+
+  int ret = 0;
+  for (size_t i = 0; i < markers.size(); ++i) {
+    ObjectReadOperation op;
+    op.omap_get_vals(markers[i], count, &(*vals)[i], &rvals[i]);
+
+    librados::AioCompletion *c = librados::Rados::aio_create_completion(NULL, NULL, NULL);
+    r = ref.ioctx.aio_operate(ref.oid, c, &op, NULL);
+    if (r < 0) {
+      c->release();
+      ret = r;
+      break;
+    }
+    completions.push_back(c);
+
+    while ((int)completions.size() >= max_aio) {
+      librados::AioCompletion *front = completions.front();
+      completions.pop_front();
+      front->wait_for_complete();
+      r = front->get_return_value();
+      front->release();
+      if (r < 0 && ret == 0) {
+        ret = r;
+      }
+    }
+  }
+
+  while (!completions.empty()) {
+    librados::AioCompletion *front = completions.front();
+    completions.pop_front();
+    front->wait_for_complete();
+    r = front->get_return_value();
+    front->release();
+    if (r < 0 && ret == 0) {
+      ret = r;
+    }
+  }
+
+  if (ret < 0) {
+    return ret;
+  }
+  for (size_t i = 0; i < rvals.size(); ++i) {
+    if (rvals[i] < 0) {
+      return rvals[i];
+    }
+  }
+  return 0;
 }
 
 int RGWRados::omap_get_all(rgw_obj& obj, bufferlist& header, std::map<string, bufferlist>& m)
@@ -8023,6 +8133,7 @@ int RGWRados::cls_obj_set_bucket_tag_timeout(rgw_bucket& bucket, uint64_t timeou
 }
 
 int RGWRados::cls_bucket_list(rgw_bucket& bucket, rgw_obj_key& start, const string& prefix,
+		              const string& delimiter,
 		              uint32_t num_entries, bool list_versions, map<string, RGWObjEnt>& m,
 			      bool *is_truncated, rgw_obj_key *last_entry,
 			      bool (*force_check_filter)(const string&  name))
@@ -8038,23 +8149,46 @@ int RGWRados::cls_bucket_list(rgw_bucket& bucket, rgw_obj_key& start, const stri
   if (r < 0)
     return r;
 
+  // bound the per-shard readahead so memory and OSD load do not scale
+  // with the shard count; exhausted shards are refilled from their last
+  // returned key as the merge streams along
+  uint32_t num_shards = oids.size();
+  uint32_t per_shard = num_entries;
+  if (num_shards > 1) {
+    per_shard = cct->_conf->rgw_bucket_index_list_per_shard;
+    if (per_shard == 0) {
+      // auto: assume a roughly uniform key distribution, with headroom
+      // so a mildly skewed bucket still fills in one round
+      per_shard = num_entries / num_shards * 2 + 8;
+    }
+    per_shard = MIN(per_shard, num_entries);
+  }
+
   cls_rgw_obj_key start_key(start.name, start.instance);
-  r = CLSRGWIssueBucketList(index_ctx, start_key, prefix, num_entries, list_versions,
+  r = CLSRGWIssueBucketList(index_ctx, start_key, prefix, delimiter, per_shard, list_versions,
                             oids, list_results, cct->_conf->rgw_bucket_index_max_aio)();
   if (r < 0)
     return r;
 
   // Create a list of iterators that are used to iterate each shard
-  vector<map<string, struct rgw_bucket_dir_entry>::iterator> vcurrents(list_results.size());
-  vector<map<string, struct rgw_bucket_dir_entry>::iterator> vends(list_results.size());
-  vector<string> vnames(list_results.size());
+  vector<int> vshards;
+  vector<map<string, struct rgw_bucket_dir_entry>::iterator> vcurrents;
+  vector<map<string, struct rgw_bucket_dir_entry>::iterator> vends;
+  vector<string> vnames;
+  vector<bool> vtruncated;
+  vshards.reserve(list_results.size());
+  vcurrents.reserve(list_results.size());
+  vends.reserve(list_results.size());
+  vnames.reserve(list_results.size());
+  vtruncated.reserve(list_results.size());
   map<int, struct rgw_cls_list_ret>::iterator iter = list_results.begin();
   *is_truncated = false;
   for (; iter != list_results.end(); ++iter) {
+    vshards.push_back(iter->first);
     vcurrents.push_back(iter->second.dir.m.begin());
     vends.push_back(iter->second.dir.m.end());
     vnames.push_back(oids[iter->first]);
-    *is_truncated = (*is_truncated || iter->second.is_truncated);
+    vtruncated.push_back(iter->second.is_truncated);
   }
 
   // Create a map to track the next candidate entry from each shard, if the entry
@@ -8108,6 +8242,25 @@ int RGWRados::cls_bucket_list(rgw_bucket& bucket, rgw_obj_key& start, const stri
     // Refresh the candidates map
     candidates.erase(candidates.begin());
     ++vcurrents[pos];
+    if (vcurrents[pos] == vends[pos] && vtruncated[pos] &&
+        count < num_entries) {
+      // stream in the next batch from this shard
+      int shard = vshards[pos];
+      map<int, string> refill_oids;
+      refill_oids[shard] = vnames[pos];
+      map<int, struct rgw_cls_list_ret> refill_results;
+      cls_rgw_obj_key marker =
+        list_results[shard].dir.m.rbegin()->second.key;
+      r = CLSRGWIssueBucketList(index_ctx, marker, prefix, delimiter, per_shard,
+                                list_versions, refill_oids, refill_results,
+                                cct->_conf->rgw_bucket_index_max_aio)();
+      if (r < 0)
+        return r;
+      list_results[shard] = refill_results[shard];
+      vcurrents[pos] = list_results[shard].dir.m.begin();
+      vends[pos] = list_results[shard].dir.m.end();
+      vtruncated[pos] = list_results[shard].is_truncated;
+    }
     if (vcurrents[pos] != vends[pos]) {
       candidates[vcurrents[pos]->first] = pos;
     }
@@ -8128,7 +8281,7 @@ int RGWRados::cls_bucket_list(rgw_bucket& bucket, rgw_obj_key& start, const stri
 
   // Check if all the returned entries are consumed or not
   for (size_t i = 0; i < vcurrents.size(); ++i) {
-    if (vcurrents[i] != vends[i])
+    if (vcurrents[i] != vends[i] || vtruncated[i])
       *is_truncated = true;
   }
   if (!m.empty())
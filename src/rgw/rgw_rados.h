@@ -21,6 +21,7 @@ class RGWWatcher;
 class SafeTimer;
 class ACLOwner;
 class RGWGC;
+class RGWLogTrimmer;
 
 /* flags for put_obj_meta() */
 #define PUT_OBJ_CREATE      0x01
@@ -1207,6 +1208,7 @@ class RGWRados
   };
 
   RGWGC *gc;
+  RGWLogTrimmer *log_trimmer;
   bool use_gc_thread;
   bool quota_threads;
 
@@ -1262,7 +1264,7 @@ protected:
 
 public:
   RGWRados() : max_req_id(0), lock("rados_timer_lock"), watchers_lock("watchers_lock"), timer(NULL),
-               gc(NULL), use_gc_thread(false), quota_threads(false),
+               gc(NULL), log_trimmer(NULL), use_gc_thread(false), quota_threads(false),
                num_watchers(0), watchers(NULL),
                watch_initialized(false),
                bucket_id_lock("rados_bucket_id"),
@@ -1539,8 +1541,10 @@ public:
         uint64_t *obj_size;
         map<string, bufferlist> *attrs;
         struct rgw_err *perr;
+        uint64_t window_size; /* bytes of stripe reads kept in flight by
+                                 iterate(); 0 = rgw_get_obj_window_size */
 
-        Params() : lastmod(NULL), read_size(NULL), obj_size(NULL), attrs(NULL), perr(NULL) {}
+        Params() : lastmod(NULL), read_size(NULL), obj_size(NULL), attrs(NULL), perr(NULL), window_size(0) {}
       } params;
 
       Read(RGWRados::Object *_source) : source(_source) {}
@@ -1966,6 +1970,8 @@ public:
   void gen_rand_obj_instance_name(rgw_obj *target);
 
   int omap_get_vals(rgw_obj& obj, bufferlist& header, const std::string& marker, uint64_t count, std::map<string, bufferlist>& m);
+  int omap_get_vals_multi(rgw_obj& obj, const std::vector<string>& markers, uint64_t count,
+                          std::vector<std::map<string, bufferlist> > *vals, int max_aio);
   virtual int omap_get_all(rgw_obj& obj, bufferlist& header, std::map<string, bufferlist>& m);
   virtual int omap_set(rgw_obj& obj, std::string& key, bufferlist& bl);
   virtual int omap_set(rgw_obj& obj, map<std::string, bufferlist>& m);
@@ -2035,6 +2041,7 @@ public:
   int cls_obj_complete_cancel(BucketShard& bs, string& tag, rgw_obj& obj, uint16_t bilog_flags);
   int cls_obj_set_bucket_tag_timeout(rgw_bucket& bucket, uint64_t timeout);
   int cls_bucket_list(rgw_bucket& bucket, rgw_obj_key& start, const string& prefix,
+                      const string& delimiter,
                       uint32_t num_entries, bool list_versions, map<string, RGWObjEnt>& m,
                       bool *is_truncated, rgw_obj_key *last_entry,
                       bool (*force_check_filter)(const string&  name) = NULL);
@@ -258,11 +258,10 @@ static void dump_status(struct req_state *s, const char *status, const char *sta
 
 void rgw_flush_formatter_and_reset(struct req_state *s, Formatter *formatter)
 {
-  std::ostringstream oss;
-  formatter->flush(oss);
-  std::string outs(oss.str());
-  if (!outs.empty() && s->op != OP_HEAD) {
-    s->cio->write(outs.c_str(), outs.size());
+  bufferlist bl;
+  formatter->flush(bl);
+  if (bl.length() && s->op != OP_HEAD) {
+    s->cio->write(bl.c_str(), bl.length());
   }
 
   s->formatter->reset();
@@ -270,11 +269,10 @@ void rgw_flush_formatter_and_reset(struct req_state *s, Formatter *formatter)
 
 void rgw_flush_formatter(struct req_state *s, Formatter *formatter)
 {
-  std::ostringstream oss;
-  formatter->flush(oss);
-  std::string outs(oss.str());
-  if (!outs.empty() && s->op != OP_HEAD) {
-    s->cio->write(outs.c_str(), outs.size());
+  bufferlist bl;
+  formatter->flush(bl);
+  if (bl.length() && s->op != OP_HEAD) {
+    s->cio->write(bl.c_str(), bl.length());
   }
 }
 
@@ -848,7 +846,9 @@ int RGWPutObj_ObjStore::get_data(bufferlist& bl)
 
   int len = 0;
   if (cl) {
-    bufferptr bp(cl);
+    /* page aligned so the buffer can travel to the messenger without a
+     * realignment copy */
+    bufferptr bp = buffer::create_page_aligned(cl);
 
     int read_len; /* cio->read() expects int * */
     int r = s->cio->read(bp.c_str(), cl, &read_len);
@@ -31,15 +31,21 @@ void RGWOp_Bucket_Info::execute()
 
   std::string uid;
   std::string bucket;
+  std::string marker;
+  uint64_t max_entries;
 
   RESTArgs::get_string(s, "uid", uid, &uid);
   RESTArgs::get_string(s, "bucket", bucket, &bucket);
   RESTArgs::get_bool(s, "stats", false, &fetch_stats);
+  RESTArgs::get_string(s, "marker", marker, &marker);
+  RESTArgs::get_uint64(s, "max-entries", 0, &max_entries);
 
 
   op_state.set_user_id(uid);
   op_state.set_bucket_name(bucket);
   op_state.set_fetch_stats(fetch_stats);
+  op_state.set_marker(marker);
+  op_state.set_max_entries(max_entries);
 
   http_ret = RGWBucketAdminOp::info(store, op_state, flusher);
 }
@@ -17,6 +17,7 @@
 #include "rgw_user.h"
 #include "rgw_cors.h"
 #include "rgw_cors_s3.h"
+#include "rgw_swift.h"
 
 #include "rgw_client_io.h"
 
@@ -2229,10 +2230,38 @@ int RGWHandler_ObjStore_S3::init(RGWRados *store, struct req_state *s, RGWClient
 }
 
 
+/* cache key for a validated s3 credential: the access key plus a digest of
+ * the canonical request and its signature, so only an identical (and
+ * identically signed) request can hit the entry */
+static void get_s3token_cache_key(const string& access_key, const string& token,
+				  const string& sign, string& key)
+{
+  unsigned char m[CEPH_CRYPTO_MD5_DIGESTSIZE];
+
+  MD5 hash;
+  hash.Update((const byte *)token.c_str(), token.size());
+  hash.Update((const byte *)sign.c_str(), sign.size());
+  hash.Final(m);
+
+  char calc_md5[CEPH_CRYPTO_MD5_DIGESTSIZE * 2 + 1];
+  buf_to_hex(m, CEPH_CRYPTO_MD5_DIGESTSIZE, calc_md5);
+  key = access_key;
+  key.append(":");
+  key.append(calc_md5);
+}
+
 /*
  * Try to validate S3 auth against keystone s3token interface
  */
 int RGW_Auth_S3_Keystone_ValidateToken::validate_s3token(const string& auth_id, const string& auth_token, const string& auth_sign) {
+  /* a repeated request with the same signature was already validated by
+   * keystone; serve it from the cache instead of going over the network */
+  string cache_key;
+  get_s3token_cache_key(auth_id, auth_token, auth_sign, cache_key);
+  RGWKeystoneTokenCache *cache = RGWSwift::get_token_cache();
+  if (cache && cache->find(cache_key, response))
+    return 0;
+
   /* prepare keystone url */
   string keystone_url = cct->_conf->rgw_keystone_url;
   if (keystone_url[keystone_url.size() - 1] != '/')
@@ -2292,6 +2321,12 @@ int RGW_Auth_S3_Keystone_ValidateToken::validate_s3token(const string& auth_id,
 
   /* everything seems fine, continue with this user */
   ldout(cct, 5) << "s3 keystone: validated token: " << response.token.tenant.name << ":" << response.user.name << " expires: " << response.token.expires << dendl;
+
+  /* entries are keyed by request digest rather than token id, so revocation
+   * cannot match them; they simply age out with the token's own expiry */
+  if (cache && !response.expired())
+    cache->add(cache_key, response);
+
   return 0;
 }
 
@@ -244,42 +244,91 @@ int	RGWSwift::get_keystone_url(std::string& url)
   return 0;
 }
 
-int	RGWSwift::get_keystone_admin_token(std::string& token)
+int	RGWSwift::fetch_keystone_admin_token(KeystoneToken& t)
 {
   std::string token_url;
 
   if (get_keystone_url(token_url) < 0)
     return -EINVAL;
-  if (cct->_conf->rgw_keystone_admin_token.empty()) {
-    token_url.append("v2.0/tokens");
-    KeystoneToken t;
-    bufferlist token_bl;
-    RGWGetKeystoneAdminToken token_req(cct, &token_bl);
-    token_req.append_header("Content-Type", "application/json");
-    JSONFormatter jf;
-    jf.open_object_section("token_request");
-    jf.open_object_section("auth");
-    jf.open_object_section("passwordCredentials");
-    encode_json("username", cct->_conf->rgw_keystone_admin_user, &jf);
-    encode_json("password", cct->_conf->rgw_keystone_admin_password, &jf);
-    jf.close_section();
-    encode_json("tenantName", cct->_conf->rgw_keystone_admin_tenant, &jf);
-    jf.close_section();
-    jf.close_section();
-    std::stringstream ss;
-    jf.flush(ss);
-    token_req.set_post_data(ss.str());
-    token_req.set_send_length(ss.str().length());
-    int ret = token_req.process("POST", token_url.c_str());
-    if (ret < 0)
-      return ret;
-    if (t.parse(cct, token_bl) != 0)
-      return -EINVAL;
-    token = t.token.id;
-  } else {
+  token_url.append("v2.0/tokens");
+  bufferlist token_bl;
+  RGWGetKeystoneAdminToken token_req(cct, &token_bl);
+  token_req.append_header("Content-Type", "application/json");
+  JSONFormatter jf;
+  jf.open_object_section("token_request");
+  jf.open_object_section("auth");
+  jf.open_object_section("passwordCredentials");
+  encode_json("username", cct->_conf->rgw_keystone_admin_user, &jf);
+  encode_json("password", cct->_conf->rgw_keystone_admin_password, &jf);
+  jf.close_section();
+  encode_json("tenantName", cct->_conf->rgw_keystone_admin_tenant, &jf);
+  jf.close_section();
+  jf.close_section();
+  std::stringstream ss;
+  jf.flush(ss);
+  token_req.set_post_data(ss.str());
+  token_req.set_send_length(ss.str().length());
+  int ret = token_req.process("POST", token_url.c_str());
+  if (ret < 0)
+    return ret;
+  if (t.parse(cct, token_bl) != 0)
+    return -EINVAL;
+  return 0;
+}
+
+int	RGWSwift::get_keystone_admin_token(std::string& token)
+{
+  if (!cct->_conf->rgw_keystone_admin_token.empty()) {
     token = cct->_conf->rgw_keystone_admin_token;
+    return 0;
+  }
+
+  {
+    Mutex::Locker l(admin_token_lock);
+    if (!cached_admin_token.empty() &&
+	ceph_clock_now(cct).sec() < cached_admin_token_expires) {
+      token = cached_admin_token;
+      return 0;
+    }
   }
-  return 0; 
+
+  /* no valid cached admin token; fetch one synchronously (the refresh
+   * thread normally renews it before we get here) */
+  int ret = refresh_admin_token();
+  if (ret < 0)
+    return ret;
+
+  Mutex::Locker l(admin_token_lock);
+  token = cached_admin_token;
+  return 0;
+}
+
+int RGWSwift::refresh_admin_token()
+{
+  KeystoneToken t;
+  int ret = fetch_keystone_admin_token(t);
+  if (ret < 0)
+    return ret;
+
+  Mutex::Locker l(admin_token_lock);
+  cached_admin_token = t.token.id;
+  cached_admin_token_expires = t.token.expires;
+  ldout(cct, 10) << "keystone admin token renewed, expires: " << t.token.expires << dendl;
+  return 0;
+}
+
+bool RGWSwift::admin_token_needs_refresh()
+{
+  if (!cct->_conf->rgw_keystone_admin_token.empty())
+    return false;   /* statically configured shared secret, nothing to renew */
+
+  Mutex::Locker l(admin_token_lock);
+  if (cached_admin_token.empty())
+    return false;   /* don't fetch one before the first request needs it */
+
+  utime_t now = ceph_clock_now(cct);
+  return (now.sec() + cct->_conf->rgw_keystone_token_refresh_window >=
+	  cached_admin_token_expires);
 }
 
 
@@ -715,6 +764,11 @@ void RGWSwift::init_keystone()
 
   keystone_revoke_thread = new KeystoneRevokeThread(cct, this);
   keystone_revoke_thread->create();
+
+  if (cct->_conf->rgw_keystone_token_refresh_window > 0) {
+    keystone_refresh_thread = new KeystoneTokenRefreshThread(cct, this);
+    keystone_refresh_thread->create();
+  }
 }
 
 
@@ -736,6 +790,18 @@ void RGWSwift::finalize_keystone()
   }
   delete keystone_revoke_thread;
   keystone_revoke_thread = NULL;
+
+  if (keystone_refresh_thread) {
+    keystone_refresh_thread->stop();
+    keystone_refresh_thread->join();
+  }
+  delete keystone_refresh_thread;
+  keystone_refresh_thread = NULL;
+}
+
+RGWKeystoneTokenCache *RGWSwift::get_token_cache()
+{
+  return keystone_token_cache;
 }
 
 RGWSwift *rgw_swift = NULL;
@@ -780,3 +846,35 @@ void RGWSwift::KeystoneRevokeThread::stop()
   cond.Signal();
 }
 
+void *RGWSwift::KeystoneTokenRefreshThread::entry() {
+  int window = cct->_conf->rgw_keystone_token_refresh_window;
+  int interval = window / 2;
+  if (interval < 10)
+    interval = 10;
+
+  do {
+    if (swift->admin_token_needs_refresh()) {
+      dout(2) << "keystone refresh thread: renewing admin token" << dendl;
+      int r = swift->refresh_admin_token();
+      if (r < 0) {
+	dout(0) << "ERROR: keystone admin token renewal returned error r=" << r << dendl;
+      }
+    }
+
+    if (swift->going_down())
+      break;
+
+    lock.Lock();
+    cond.WaitInterval(cct, lock, utime_t(interval, 0));
+    lock.Unlock();
+  } while (!swift->going_down());
+
+  return NULL;
+}
+
+void RGWSwift::KeystoneTokenRefreshThread::stop()
+{
+  Mutex::Locker l(lock);
+  cond.Signal();
+}
+
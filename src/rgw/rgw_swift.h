@@ -10,6 +10,7 @@
 
 class RGWRados;
 class KeystoneToken;
+class RGWKeystoneTokenCache;
 
 struct rgw_swift_auth_info {
   int status;
@@ -34,6 +35,8 @@ class RGWSwift {
   int update_user_info(RGWRados *store, struct rgw_swift_auth_info *info, RGWUserInfo& user_info);
   int get_keystone_url(std::string& url);
   int get_keystone_admin_token(std::string& token);
+  int fetch_keystone_admin_token(KeystoneToken& t);
+  bool admin_token_needs_refresh();
 
   class KeystoneRevokeThread : public Thread {
     CephContext *cct;
@@ -49,6 +52,26 @@ class RGWSwift {
 
   KeystoneRevokeThread *keystone_revoke_thread;
 
+  /* renews the cached keystone admin token ahead of its expiry so request
+   * threads don't have to go to keystone for it synchronously */
+  class KeystoneTokenRefreshThread : public Thread {
+    CephContext *cct;
+    RGWSwift *swift;
+    Mutex lock;
+    Cond cond;
+
+  public:
+    KeystoneTokenRefreshThread(CephContext *_cct, RGWSwift *_swift) : cct(_cct), swift(_swift), lock("KeystoneTokenRefreshThread") {}
+    void *entry();
+    void stop();
+  };
+
+  KeystoneTokenRefreshThread *keystone_refresh_thread;
+
+  Mutex admin_token_lock;
+  string cached_admin_token;
+  time_t cached_admin_token_expires;
+
   void init();
   void finalize();
   void init_keystone();
@@ -59,9 +82,13 @@ class RGWSwift {
   bool do_verify_swift_token(RGWRados *store, req_state *s);
 protected:
   int check_revoked();
+  int refresh_admin_token();
 public:
 
-  RGWSwift(CephContext *_cct) : cct(_cct), keystone_revoke_thread(NULL) {
+  RGWSwift(CephContext *_cct) : cct(_cct), keystone_revoke_thread(NULL),
+				keystone_refresh_thread(NULL),
+				admin_token_lock("RGWSwift::admin_token_lock"),
+				cached_admin_token_expires(0) {
     init();
   }
   ~RGWSwift() {
@@ -70,6 +97,8 @@ public:
 
   bool verify_swift_token(RGWRados *store, req_state *s);
   bool going_down();
+
+  static RGWKeystoneTokenCache *get_token_cache();
 };
 
 extern RGWSwift *rgw_swift;
@@ -1983,6 +1983,24 @@ TEST(BufferList, write_fd) {
   ::unlink(FILENAME);
 }
 
+TEST(BufferList, write_fd_offset) {
+  ::unlink(FILENAME);
+  int fd = ::open(FILENAME, O_WRONLY|O_CREAT|O_TRUNC, 0600);
+  bufferlist bl;
+  for (unsigned i = 0; i < IOV_MAX * 2; i++) {
+    bufferptr ptr("A", 1);
+    bl.push_back(ptr);
+  }
+  uint64_t offset = 200;
+  EXPECT_EQ(0, bl.write_fd(fd, offset));
+  ::close(fd);
+  struct stat st;
+  memset(&st, 0, sizeof(st));
+  ::stat(FILENAME, &st);
+  EXPECT_EQ(IOV_MAX * 2 + offset, (uint64_t)st.st_size);
+  ::unlink(FILENAME);
+}
+
 TEST(BufferList, crc32c) {
   bufferlist bl;
   __u32 crc = 0;
@@ -2010,6 +2028,25 @@ TEST(BufferList, crc32c_append) {
   ASSERT_EQ(bl1.crc32c(0), bl2.crc32c(0));
 }
 
+TEST(BufferList, crc32c_compose) {
+  // crcs cached for sub-ranges of a raw buffer should satisfy a
+  // later crc over the whole range without recomputing
+  bufferptr whole(10);
+  memcpy(whole.c_str(), "0123456789", 10);
+  bufferlist pieces;
+  pieces.append(bufferptr(whole, 0, 5));
+  pieces.append(bufferptr(whole, 5, 5));
+  uint32_t crc_pieces = pieces.crc32c(0); // caches the two sub-ranges
+
+  buffer::track_cached_crc(true);
+  int base_cached = buffer::get_cached_crc();
+  bufferlist full;
+  full.append(whole);
+  ASSERT_EQ(crc_pieces, full.crc32c(0));
+  ASSERT_EQ(base_cached + 1, buffer::get_cached_crc());
+  buffer::track_cached_crc(false);
+}
+
 TEST(BufferList, crc32c_append_perf) {
   int len = 256 * 1024 * 1024;
   bufferptr a(len);
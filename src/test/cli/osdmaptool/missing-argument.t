@@ -5,6 +5,8 @@
      --import-crush <file>   replace osdmap's crush map with <file>
      --test-map-pgs [--pool <poolid>] map all pgs
      --test-map-pgs-dump [--pool <poolid>] map all pgs
+     --compare <mapfile>     map all pgs in both maps and report data movement
+     --threads <n>           spread mapping work over <n> threads
      --mark-up-in            mark osds up and in (but do not persist)
      --clear-temp            clear pg_temp and primary_temp
      --test-random           do random placements
@@ -34,11 +34,39 @@ TEST(Readahead, random_access) {
   ASSERT_RA(0, 0, r.update(1000, 10, Readahead::NO_LIMIT));
   ASSERT_RA(0, 0, r.update(1010, 10, Readahead::NO_LIMIT));
   ASSERT_RA(1030, 20, r.update(1020, 10, Readahead::NO_LIMIT));
+  // no two deltas repeat, so neither the sequential nor the stride
+  // detector should fire
   ASSERT_RA(0, 0, r.update(1040, 10, Readahead::NO_LIMIT));
-  ASSERT_RA(0, 0, r.update(1060, 10, Readahead::NO_LIMIT));
-  ASSERT_RA(0, 0, r.update(1080, 10, Readahead::NO_LIMIT));
-  ASSERT_RA(0, 0, r.update(1100, 10, Readahead::NO_LIMIT));
-  ASSERT_RA(0, 0, r.update(1200, 10, Readahead::NO_LIMIT));
+  ASSERT_RA(0, 0, r.update(1500, 10, Readahead::NO_LIMIT));
+  ASSERT_RA(0, 0, r.update(1700, 10, Readahead::NO_LIMIT));
+  ASSERT_RA(0, 0, r.update(2100, 10, Readahead::NO_LIMIT));
+  ASSERT_RA(0, 0, r.update(2600, 10, Readahead::NO_LIMIT));
+}
+
+TEST(Readahead, stride_access) {
+  Readahead r;
+  r.set_trigger_requests(2);
+  // 10-byte reads every 100 bytes
+  ASSERT_RA(0, 0, r.update(1000, 10, Readahead::NO_LIMIT));
+  ASSERT_RA(0, 0, r.update(1100, 10, Readahead::NO_LIMIT));  // stride candidate
+  ASSERT_RA(0, 0, r.update(1200, 10, Readahead::NO_LIMIT));  // confirmed
+  ASSERT_RA(1310, 20, r.update(1300, 10, Readahead::NO_LIMIT));
+  ASSERT_RA(1410, 35, r.update(1400, 10, Readahead::NO_LIMIT));
+  ASSERT_RA(1510, 63, r.update(1500, 10, Readahead::NO_LIMIT));
+}
+
+TEST(Readahead, interleaved_streams) {
+  Readahead r;
+  r.set_trigger_requests(2);
+  // two sequential streams, far apart, interleaved request by request
+  ASSERT_RA(0, 0, r.update(1000, 10, Readahead::NO_LIMIT));
+  ASSERT_RA(0, 0, r.update(9000000, 10, Readahead::NO_LIMIT));
+  ASSERT_RA(0, 0, r.update(1010, 10, Readahead::NO_LIMIT));
+  ASSERT_RA(0, 0, r.update(9000010, 10, Readahead::NO_LIMIT));
+  ASSERT_RA(1030, 20, r.update(1020, 10, Readahead::NO_LIMIT));
+  ASSERT_RA(9000030, 20, r.update(9000020, 10, Readahead::NO_LIMIT));
+  ASSERT_RA(1050, 40, r.update(1030, 10, Readahead::NO_LIMIT));
+  ASSERT_RA(9000050, 40, r.update(9000030, 10, Readahead::NO_LIMIT));
 }
 
 TEST(Readahead, min_size_limit) {
@@ -107,6 +107,47 @@ TEST(Histogram, Position4) {
   ASSERT_EQ(0u, ub);
 }
 
+TEST(LogLinearHistogram, Buckets) {
+  // values below SUB_BUCKETS map to themselves
+  ASSERT_EQ(0u, log_linear_hist_t::bucket_of(0));
+  ASSERT_EQ(15u, log_linear_hist_t::bucket_of(15));
+  // each power-of-two group has 16 linear sub-buckets
+  ASSERT_EQ(16u, log_linear_hist_t::bucket_of(16));
+  ASSERT_EQ(31u, log_linear_hist_t::bucket_of(31));
+  ASSERT_EQ(32u, log_linear_hist_t::bucket_of(32));
+  ASSERT_EQ(32u, log_linear_hist_t::bucket_of(33));
+  ASSERT_EQ(33u, log_linear_hist_t::bucket_of(34));
+  // floor of a bucket maps back to that bucket
+  for (unsigned b = 0; b < 200; ++b) {
+    uint64_t v = log_linear_hist_t::bucket_floor(b);
+    ASSERT_EQ(b, log_linear_hist_t::bucket_of(v));
+  }
+}
+
+TEST(LogLinearHistogram, Quantile) {
+  log_linear_hist_t h;
+  ASSERT_EQ(0u, h.value_at_quantile(0.5));
+  for (int i = 1; i <= 100; ++i)
+    h.add(i);
+  ASSERT_EQ(100u, h.total);
+  ASSERT_EQ(1u, h.value_at_quantile(0.0));
+  // bucket floors underestimate by at most 1/16
+  ASSERT_LE(h.value_at_quantile(0.5), 50u);
+  ASSERT_GE(h.value_at_quantile(0.5), 47u);
+  ASSERT_LE(h.value_at_quantile(0.99), 99u);
+  ASSERT_GE(h.value_at_quantile(0.99), 93u);
+}
+
+TEST(LogLinearHistogram, Merge) {
+  log_linear_hist_t a, b;
+  a.add(1);
+  a.add(1000);
+  b.add(500000);
+  a.add(b);
+  ASSERT_EQ(3u, a.total);
+  ASSERT_GE(a.value_at_quantile(1.0), 468750u);
+}
+
 TEST(Histogram, Decay) {
   pow2_hist_t h;
   h.set_bin(0, 123);
@@ -167,6 +167,36 @@ TEST(BloomFilter, CompressibleSweep) {
 
 
 
+TEST(BloomFilter, TryMerge) {
+  compressible_bloom_filter a(1024, .01, 5);
+  compressible_bloom_filter b(1024, .01, 5);
+  for (int n = 0; n < 100; n++)
+    a.insert(n);
+  for (int n = 1000; n < 1100; n++)
+    b.insert(n);
+
+  // power-of-two folds keep the filters mergeable
+  a.compress_mergeable(.5);
+  b.compress_mergeable(.25);
+
+  ASSERT_TRUE(a.try_merge(b));
+  for (int n = 0; n < 100; n++)
+    ASSERT_TRUE(a.contains(n));
+  for (int n = 1000; n < 1100; n++)
+    ASSERT_TRUE(a.contains(n));
+  ASSERT_EQ(200U, a.element_count());
+
+  // a different seed hashes differently and must not merge
+  compressible_bloom_filter c(1024, .01, 6);
+  c.insert(1);
+  ASSERT_FALSE(a.try_merge(c));
+
+  // as must different table parameters
+  compressible_bloom_filter d(4096, .01, 5);
+  d.insert(1);
+  ASSERT_FALSE(a.try_merge(d));
+}
+
 TEST(BloomFilter, BinSweep) {
   std::cout.setf(std::ios_base::fixed, std::ios_base::floatfield);
   std::cout.precision(5);
@@ -0,0 +1,220 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ */
+
+#include <iostream>
+#include <stdlib.h>
+#include <gtest/gtest.h>
+
+#include "include/buffer.h"
+#include "include/encoding.h"
+#include "include/interval_set.h"
+#include "include/flat_interval_set.h"
+
+typedef interval_set<uint64_t> iset_t;
+typedef flat_interval_set<uint64_t> fset_t;
+
+// flat_interval_set must behave exactly like interval_set; every check
+// in this file compares the two over the same operations.
+static void expect_same(const fset_t& f, const iset_t& s)
+{
+  ASSERT_EQ((int64_t)s.size(), (int64_t)f.size());
+  ASSERT_EQ(s.num_intervals(), f.num_intervals());
+  fset_t::const_iterator pf = f.begin();
+  for (iset_t::const_iterator ps = s.begin(); ps != s.end(); ++ps, ++pf) {
+    ASSERT_EQ(ps.get_start(), pf.get_start());
+    ASSERT_EQ(ps.get_len(), pf.get_len());
+  }
+  ASSERT_TRUE(pf == f.end());
+}
+
+// insert up to n random non-overlapping intervals into both sets
+static void random_fill(int n, fset_t *f, iset_t *s)
+{
+  for (int i = 0; i < n; i++) {
+    uint64_t start = rand() % 1000;
+    uint64_t len = 1 + rand() % 60;
+    if (!s->intersects(start, len)) {
+      s->insert(start, len);
+      f->insert(start, len);
+    }
+  }
+}
+
+TEST(FlatIntervalSet, Basics)
+{
+  fset_t f;
+  ASSERT_TRUE(f.empty());
+  ASSERT_EQ(0, f.size());
+  ASSERT_EQ(0, f.num_intervals());
+
+  f.insert(10, 10);
+  ASSERT_FALSE(f.empty());
+  ASSERT_EQ(10, f.size());
+  ASSERT_EQ(1, f.num_intervals());
+  ASSERT_EQ(10u, f.range_start());
+  ASSERT_EQ(20u, f.range_end());
+
+  // adjacent inserts coalesce on both sides
+  f.insert(30, 10);
+  f.insert(20, 10);
+  ASSERT_EQ(1, f.num_intervals());
+  ASSERT_EQ(30, f.size());
+  ASSERT_EQ(40u, f.range_end());
+
+  ASSERT_TRUE(f.contains(10));
+  ASSERT_TRUE(f.contains(39));
+  ASSERT_FALSE(f.contains(40));
+  ASSERT_TRUE(f.contains(10, 30));
+  ASSERT_FALSE(f.contains(10, 31));
+  ASSERT_TRUE(f.intersects(35, 100));
+  ASSERT_FALSE(f.intersects(40, 100));
+
+  // erase in the middle splits
+  f.erase(15, 5);
+  ASSERT_EQ(2, f.num_intervals());
+  ASSERT_EQ(25, f.size());
+  ASSERT_FALSE(f.contains(15));
+  ASSERT_TRUE(f.contains(14));
+  ASSERT_TRUE(f.contains(20));
+
+  f.clear();
+  ASSERT_TRUE(f.empty());
+  ASSERT_EQ(0, f.size());
+}
+
+TEST(FlatIntervalSet, WireFormat)
+{
+  srand(123);
+  fset_t f;
+  iset_t s;
+  random_fill(50, &f, &s);
+  expect_same(f, s);
+
+  // identical bytes in both directions
+  bufferlist fbl, sbl;
+  ::encode(f, fbl);
+  ::encode(s, sbl);
+  ASSERT_TRUE(fbl.contents_equal(sbl));
+
+  // each container decodes the other's encoding
+  fset_t f2;
+  bufferlist::iterator fp = sbl.begin();
+  ::decode(f2, fp);
+  expect_same(f2, s);
+
+  iset_t s2;
+  bufferlist::iterator sp = fbl.begin();
+  ::decode(s2, sp);
+  expect_same(f, s2);
+
+  // empty set round trip
+  fset_t fe;
+  iset_t se;
+  bufferlist febl, sebl;
+  ::encode(fe, febl);
+  ::encode(se, sebl);
+  ASSERT_TRUE(febl.contents_equal(sebl));
+}
+
+TEST(FlatIntervalSet, MixedContainerOps)
+{
+  srand(456);
+  fset_t f, fother;
+  iset_t s, sother;
+  random_fill(40, &f, &s);
+  random_fill(40, &fother, &sother);
+
+  // the templated operations take interval_set-style iterators, so an
+  // interval_set argument works directly on a flat set
+  fset_t fi = f;
+  iset_t si = s;
+  fi.intersection_of(sother);
+  si.intersection_of(sother);
+  expect_same(fi, si);
+
+  // each intersection interval is contained in f, so it is a legal
+  // subtrahend
+  fset_t fs = f;
+  iset_t ss = s;
+  fs.subtract(si);
+  ss.subtract(si);
+  expect_same(fs, ss);
+  ASSERT_TRUE(fi.subset_of(f));
+}
+
+TEST(FlatIntervalSet, DifferentialRandom)
+{
+  srand(42);
+  fset_t f;
+  iset_t s;
+
+  for (int i = 0; i < 20000; i++) {
+    int op = rand() % 10;
+    uint64_t start = rand() % 1000;
+    uint64_t len = 1 + rand() % 50;
+
+    if (op < 4) {
+      // insert when the range is free
+      if (!s.intersects(start, len)) {
+	s.insert(start, len);
+	f.insert(start, len);
+      }
+    } else if (op < 6) {
+      // erase a subrange of a random existing interval
+      if (!s.empty()) {
+	int k = rand() % s.num_intervals();
+	iset_t::const_iterator p = s.begin();
+	while (k--)
+	  ++p;
+	uint64_t off = p.get_len() > 1 ? rand() % p.get_len() : 0;
+	uint64_t elen = 1 + rand() % (p.get_len() - off);
+	uint64_t estart = p.get_start() + off;
+	s.erase(estart, elen);
+	f.erase(estart, elen);
+      }
+    } else if (op == 6) {
+      fset_t fr;
+      iset_t sr;
+      random_fill(5, &fr, &sr);
+      f.intersection_of(fr);
+      s.intersection_of(sr);
+    } else if (op == 7) {
+      fset_t fr;
+      iset_t sr;
+      random_fill(5, &fr, &sr);
+      f.union_of(fr);
+      s.union_of(sr);
+    } else if (op == 8) {
+      // subtract the part of a random set that is actually present
+      fset_t fr, fi;
+      iset_t sr, si;
+      random_fill(5, &fr, &sr);
+      fi.intersection_of(f, fr);
+      si.intersection_of(s, sr);
+      f.subtract(fi);
+      s.subtract(si);
+    } else {
+      // point and range queries
+      ASSERT_EQ(s.contains(start), f.contains(start));
+      ASSERT_EQ(s.contains(start, len), f.contains(start, len));
+      ASSERT_EQ(s.intersects(start, len), f.intersects(start, len));
+    }
+
+    expect_same(f, s);
+
+    if (i % 1000 == 0) {
+      bufferlist fbl, sbl;
+      ::encode(f, fbl);
+      ::encode(s, sbl);
+      ASSERT_TRUE(fbl.contents_equal(sbl));
+    }
+  }
+}
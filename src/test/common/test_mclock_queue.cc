@@ -0,0 +1,130 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "gtest/gtest.h"
+#include "common/MClockQueue.h"
+
+#include <list>
+#include <vector>
+
+typedef int Klass;
+typedef unsigned Item;
+typedef MClockQueue<Item, Klass> MQ;
+
+// items encode their service class in the hundreds digit
+static unsigned item_class(const Item &item)
+{
+  return item / 100;
+}
+
+static MQ *make_queue(const MQ::ClassParams &c0, const MQ::ClassParams &c1)
+{
+  std::vector<MQ::ClassParams> params;
+  params.push_back(c0);
+  params.push_back(c1);
+  return new MQ(params, item_class);
+}
+
+TEST(MClockQueue, capacity) {
+  MQ *mq = make_queue(MQ::ClassParams(0, 1, 0), MQ::ClassParams(0, 1, 0));
+  EXPECT_TRUE(mq->empty());
+  EXPECT_EQ(0u, mq->length());
+
+  mq->enqueue_strict(Klass(1), 0, Item(0));
+  EXPECT_FALSE(mq->empty());
+  EXPECT_EQ(1u, mq->length());
+
+  for (int i = 0; i < 3; i++) {
+    mq->enqueue(Klass(1), 0, 10, Item(100));
+  }
+  for (unsigned i = 4; i > 0; i--) {
+    EXPECT_FALSE(mq->empty());
+    EXPECT_EQ(i, mq->length());
+    mq->dequeue();
+  }
+  EXPECT_TRUE(mq->empty());
+  EXPECT_EQ(0u, mq->length());
+  delete mq;
+}
+
+TEST(MClockQueue, strict_first) {
+  MQ *mq = make_queue(MQ::ClassParams(0, 1, 0), MQ::ClassParams(0, 1, 0));
+  mq->enqueue(Klass(1), 0, 10, Item(0));
+  mq->enqueue_strict(Klass(1), 1, Item(101));
+  mq->enqueue_strict(Klass(1), 5, Item(105));
+  EXPECT_EQ(105u, mq->dequeue());
+  EXPECT_EQ(101u, mq->dequeue());
+  EXPECT_EQ(0u, mq->dequeue());
+  EXPECT_TRUE(mq->empty());
+  delete mq;
+}
+
+TEST(MClockQueue, reservation_first) {
+  // class 0 has a huge reservation, class 1 a huge weight; the
+  // reservation phase runs first, so class 0 drains before class 1
+  // gets anything
+  MQ *mq = make_queue(MQ::ClassParams(1e9, 1, 0), MQ::ClassParams(0, 1e9, 0));
+  for (unsigned i = 0; i < 5; i++) {
+    mq->enqueue(Klass(1), 0, 10, Item(100 + i));
+    mq->enqueue(Klass(1), 0, 10, Item(i));
+  }
+  for (unsigned i = 0; i < 5; i++) {
+    EXPECT_GT(100u, mq->dequeue());
+  }
+  for (unsigned i = 0; i < 5; i++) {
+    EXPECT_LE(100u, mq->dequeue());
+  }
+  EXPECT_TRUE(mq->empty());
+  delete mq;
+}
+
+TEST(MClockQueue, weight_share) {
+  // weights 2 : 1 -> class 0 gets two dispatches for each one of
+  // class 1 while both have backlog
+  MQ *mq = make_queue(MQ::ClassParams(0, 2, 0), MQ::ClassParams(0, 1, 0));
+  for (unsigned i = 0; i < 10; i++)
+    mq->enqueue(Klass(1), 0, 10, Item(0));
+  for (unsigned i = 0; i < 5; i++)
+    mq->enqueue(Klass(1), 0, 10, Item(100));
+  unsigned got[2] = {0, 0};
+  for (int i = 0; i < 15; i++) {
+    got[item_class(mq->dequeue())]++;
+  }
+  EXPECT_EQ(10u, got[0]);
+  EXPECT_EQ(5u, got[1]);
+  EXPECT_TRUE(mq->empty());
+  delete mq;
+}
+
+TEST(MClockQueue, limit_defers_but_does_not_starve) {
+  // class 0 is limited to one op per 10s; once it is over limit,
+  // class 1 runs, but when only class 0 remains it still drains
+  MQ *mq = make_queue(MQ::ClassParams(0, 1, 0.1), MQ::ClassParams(0, 1, 0));
+  for (unsigned i = 0; i < 3; i++) {
+    mq->enqueue(Klass(1), 0, 10, Item(0));
+    mq->enqueue(Klass(1), 0, 10, Item(100));
+  }
+  EXPECT_EQ(0u, mq->dequeue());    // first limited op is within limit
+  EXPECT_EQ(100u, mq->dequeue());
+  EXPECT_EQ(100u, mq->dequeue());
+  EXPECT_EQ(100u, mq->dequeue());
+  EXPECT_EQ(0u, mq->dequeue());    // over limit but work conserving
+  EXPECT_EQ(0u, mq->dequeue());
+  EXPECT_TRUE(mq->empty());
+  delete mq;
+}
+
+TEST(MClockQueue, remove_by_class) {
+  MQ *mq = make_queue(MQ::ClassParams(0, 1, 0), MQ::ClassParams(0, 1, 0));
+  mq->enqueue(Klass(1), 0, 10, Item(1));
+  mq->enqueue(Klass(2), 0, 10, Item(2));
+  mq->enqueue(Klass(2), 0, 10, Item(102));
+  mq->enqueue_strict(Klass(2), 5, Item(103));
+  std::list<Item> out;
+  mq->remove_by_class(Klass(2), &out);
+  EXPECT_EQ(3u, out.size());
+  EXPECT_EQ(1u, mq->length());
+  EXPECT_EQ(1u, mq->dequeue());
+  EXPECT_TRUE(mq->empty());
+  delete mq;
+}
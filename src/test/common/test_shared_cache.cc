@@ -393,6 +393,37 @@ TEST(SharedCache_all, lru) {
   ASSERT_TRUE(cache.lookup(0).get());
 }
 
+TEST(ShardedSharedCache, lookup) {
+  ShardedSharedLRU<int, int> cache(NULL, 32, 4);
+  unsigned int key = 1;
+  int value = 42;
+  {
+    shared_ptr<int> ptr = cache.add(key, new int(value));
+    ASSERT_EQ(value, *cache.lookup(key));
+  }
+  ASSERT_TRUE(cache.lookup(key).get());
+  cache.purge(key);
+  ASSERT_FALSE(cache.lookup(key));
+}
+
+TEST(ShardedSharedCache, get_next) {
+  ShardedSharedLRU<int, int> cache(NULL, 32, 4);
+  // spread keys over every shard; get_next must still return them in
+  // global key order
+  for (int i = 0; i < 16; ++i)
+    cache.add(i, new int(i));
+  pair<int, shared_ptr<int> > i(-1, shared_ptr<int>());
+  int expected = 0;
+  while (cache.get_next(i.first, &i)) {
+    ASSERT_EQ(expected, i.first);
+    ASSERT_EQ(expected, *i.second);
+    ++expected;
+  }
+  ASSERT_EQ(16, expected);
+  ASSERT_FALSE(cache.empty());
+  cache.clear();
+}
+
 int main(int argc, char **argv) {
   vector<const char*> args;
   argv_to_vec(argc, (const char **)argv, args);
@@ -0,0 +1,123 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "gtest/gtest.h"
+#include "common/WeightedRoundRobinQueue.h"
+
+#include <list>
+
+class WeightedRoundRobinQueueTest : public testing::Test
+{
+protected:
+  typedef int Klass;
+  typedef unsigned Item;
+  typedef WeightedRoundRobinQueue<Item, Klass> WRR;
+  typedef OpQueue<Item, Klass> OQ;
+};
+
+TEST_F(WeightedRoundRobinQueueTest, capacity) {
+  const unsigned min_cost = 10;
+  const unsigned max_cost = 50;
+  WRR wrr(max_cost, min_cost);
+  EXPECT_TRUE(wrr.empty());
+  EXPECT_EQ(0u, wrr.length());
+
+  wrr.enqueue_strict(Klass(1), 0, Item(0));
+  EXPECT_FALSE(wrr.empty());
+  EXPECT_EQ(1u, wrr.length());
+
+  for (int i = 0; i < 3; i++) {
+    wrr.enqueue(Klass(1), 0, 10, Item(0));
+  }
+  for (unsigned i = 4; i > 0; i--) {
+    EXPECT_FALSE(wrr.empty());
+    EXPECT_EQ(i, wrr.length());
+    wrr.dequeue();
+  }
+  EXPECT_TRUE(wrr.empty());
+  EXPECT_EQ(0u, wrr.length());
+}
+
+TEST_F(WeightedRoundRobinQueueTest, strict_before_lanes) {
+  WRR wrr(50, 1);
+  wrr.enqueue(Klass(1), 10, 1, Item(100));
+  wrr.enqueue_strict(Klass(1), 1, Item(1));
+  wrr.enqueue_strict(Klass(1), 5, Item(5));
+  wrr.enqueue_strict(Klass(1), 3, Item(3));
+  // strict items first, highest strict priority first
+  EXPECT_EQ(5u, wrr.dequeue());
+  EXPECT_EQ(3u, wrr.dequeue());
+  EXPECT_EQ(1u, wrr.dequeue());
+  EXPECT_EQ(100u, wrr.dequeue());
+  EXPECT_TRUE(wrr.empty());
+}
+
+TEST_F(WeightedRoundRobinQueueTest, weighted_share) {
+  const unsigned min_cost = 10;
+  const unsigned max_cost = 1000;
+  WRR wrr(max_cost, min_cost);
+  // encode the priority in the item value; equal costs, so lanes
+  // should be served in proportion to (priority + 1): 2 : 4
+  for (int i = 0; i < 10; i++)
+    wrr.enqueue(Klass(1), 1, min_cost, Item(1));
+  for (int i = 0; i < 20; i++)
+    wrr.enqueue(Klass(1), 3, min_cost, Item(3));
+  unsigned got_p1 = 0, got_p3 = 0;
+  for (int i = 0; i < 30; i++) {
+    Item item = wrr.dequeue();
+    if (item == 1)
+      got_p1++;
+    else
+      got_p3++;
+  }
+  EXPECT_EQ(10u, got_p1);
+  EXPECT_EQ(20u, got_p3);
+  EXPECT_TRUE(wrr.empty());
+}
+
+TEST_F(WeightedRoundRobinQueueTest, fairness_by_class) {
+  WRR wrr(1000, 10);
+  for (int i = 0; i < 10; i++) {
+    wrr.enqueue(Klass(1), 1, 10, Item(1));
+    wrr.enqueue(Klass(2), 1, 10, Item(2));
+  }
+  // classes within a lane alternate
+  unsigned got[3] = {0, 0, 0};
+  for (int i = 0; i < 10; i++) {
+    got[wrr.dequeue()]++;
+    got[wrr.dequeue()]++;
+    EXPECT_EQ(got[1], got[2]);
+  }
+  EXPECT_TRUE(wrr.empty());
+}
+
+TEST_F(WeightedRoundRobinQueueTest, remove_by_class) {
+  WRR wrr(1000, 10);
+  wrr.enqueue(Klass(1), 1, 10, Item(1));
+  wrr.enqueue(Klass(2), 1, 10, Item(2));
+  wrr.enqueue(Klass(2), 2, 10, Item(22));
+  wrr.enqueue_strict(Klass(2), 10, Item(222));
+  std::list<Item> out;
+  wrr.remove_by_class(Klass(2), &out);
+  EXPECT_EQ(3u, out.size());
+  EXPECT_EQ(1u, wrr.length());
+  EXPECT_EQ(1u, wrr.dequeue());
+  EXPECT_TRUE(wrr.empty());
+}
+
+TEST_F(WeightedRoundRobinQueueTest, remove_by_filter) {
+  struct OddFilter : public OQ::Filter {
+    bool operator()(const Item &item) const {
+      return item % 2 == 1;
+    }
+  };
+  WRR wrr(1000, 10);
+  for (unsigned i = 0; i < 10; i++)
+    wrr.enqueue(Klass(1), i % 3, 10, Item(i));
+  std::list<Item> out;
+  wrr.remove_by_filter(OddFilter(), &out);
+  EXPECT_EQ(5u, out.size());
+  EXPECT_EQ(5u, wrr.length());
+  while (!wrr.empty())
+    EXPECT_EQ(0u, wrr.dequeue() % 2);
+}
@@ -0,0 +1,204 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * Copyright (C) 2015 Ceph contributors
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <fstream>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/program_options/option.hpp>
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <boost/program_options/cmdline.hpp>
+#include <boost/program_options/parsers.hpp>
+
+#include "global/global_context.h"
+#include "global/global_init.h"
+#include "common/ceph_argparse.h"
+#include "common/config.h"
+#include "common/Clock.h"
+#include "include/utime.h"
+#include "compressor/Compressor.h"
+
+namespace po = boost::program_options;
+
+class CompressionBench {
+  int in_size;
+  int max_iterations;
+  int level;
+  vector<string> codecs;
+  bufferlist sample;
+
+  int run_one(const string &codec);
+
+public:
+  int setup(int argc, char **argv);
+  int run();
+};
+
+int CompressionBench::setup(int argc, char **argv)
+{
+  po::options_description desc("Allowed options");
+  desc.add_options()
+    ("help,h", "produce help message")
+    ("size,s", po::value<int>()->default_value(4 * 1024 * 1024),
+     "size of the buffer to be compressed (ignored with --input)")
+    ("iterations,i", po::value<int>()->default_value(100),
+     "number of compress/decompress runs per codec")
+    ("codec,c", po::value<vector<string> >(),
+     "codec to benchmark (repeat for more than one; default all)")
+    ("level,l", po::value<int>()->default_value(0),
+     "compression level, 0 = codec default")
+    ("input,f", po::value<string>(),
+     "file with a representative data sample; synthetic data otherwise")
+    ;
+
+  po::parsed_options parsed =
+    po::command_line_parser(argc, argv).options(desc).allow_unregistered().run();
+  po::variables_map vm;
+  po::store(parsed, vm);
+  po::notify(vm);
+
+  vector<const char *> ceph_options, def_args;
+  vector<string> ceph_option_strings = po::collect_unrecognized(
+    parsed.options, po::include_positional);
+  ceph_options.reserve(ceph_option_strings.size());
+  for (vector<string>::iterator i = ceph_option_strings.begin();
+       i != ceph_option_strings.end();
+       ++i) {
+    ceph_options.push_back(i->c_str());
+  }
+
+  global_init(
+    &def_args, ceph_options, CEPH_ENTITY_TYPE_CLIENT,
+    CODE_ENVIRONMENT_UTILITY,
+    CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+  common_init_finish(g_ceph_context);
+  g_ceph_context->_conf->apply_changes(NULL);
+
+  if (vm.count("help")) {
+    cout << desc << std::endl;
+    return 1;
+  }
+
+  in_size = vm["size"].as<int>();
+  max_iterations = vm["iterations"].as<int>();
+  level = vm["level"].as<int>();
+  if (vm.count("codec"))
+    codecs = vm["codec"].as<vector<string> >();
+  else {
+    codecs.push_back("snappy");
+    codecs.push_back("lz4");
+    codecs.push_back("zstd");
+  }
+
+  if (vm.count("input")) {
+    string fname = vm["input"].as<string>();
+    string error;
+    if (sample.read_file(fname.c_str(), &error) < 0) {
+      cerr << "cannot read " << fname << ": " << error << std::endl;
+      return 1;
+    }
+  } else {
+    // mildly redundant synthetic data; all-random would make every
+    // codec look useless, all-zero would make every codec look great
+    bufferptr ptr(in_size);
+    for (int i = 0; i < in_size; i++)
+      ptr.c_str()[i] = (i & 7) ? (char)(i * 2654435761u >> 24) : 'x';
+    sample.append(ptr);
+  }
+  return 0;
+}
+
+int CompressionBench::run_one(const string &codec)
+{
+  Compressor *cs = Compressor::create(g_ceph_context, codec, level);
+  if (!cs) {
+    cout << codec << "\tunavailable" << std::endl;
+    return 0;
+  }
+
+  bufferlist compressed;
+  utime_t begin_time = ceph_clock_now(g_ceph_context);
+  for (int i = 0; i < max_iterations; i++) {
+    compressed.clear();
+    if (cs->compress(sample, compressed) < 0) {
+      cerr << codec << ": compress failed" << std::endl;
+      delete cs;
+      return 1;
+    }
+  }
+  utime_t compress_time = ceph_clock_now(g_ceph_context) - begin_time;
+
+  bufferlist decompressed;
+  begin_time = ceph_clock_now(g_ceph_context);
+  for (int i = 0; i < max_iterations; i++) {
+    decompressed.clear();
+    if (cs->decompress(compressed, decompressed) < 0) {
+      cerr << codec << ": decompress failed" << std::endl;
+      delete cs;
+      return 1;
+    }
+  }
+  utime_t decompress_time = ceph_clock_now(g_ceph_context) - begin_time;
+
+  if (decompressed.contents_equal(sample)) {
+    uint64_t total = (uint64_t)sample.length() * max_iterations;
+    cout << codec
+	 << "\tcompress " << (total / 1024 / 1024) / (double)compress_time
+	 << " MB/s"
+	 << "\tdecompress " << (total / 1024 / 1024) / (double)decompress_time
+	 << " MB/s"
+	 << "\tratio " << (double)compressed.length() / sample.length()
+	 << std::endl;
+  } else {
+    cerr << codec << ": decompressed data does not match input" << std::endl;
+    delete cs;
+    return 1;
+  }
+  delete cs;
+  return 0;
+}
+
+int CompressionBench::run()
+{
+  cout << "codec\tcompress\tdecompress\tratio ("
+       << sample.length() << " bytes x " << max_iterations << ")" << std::endl;
+  for (vector<string>::iterator i = codecs.begin(); i != codecs.end(); ++i) {
+    int r = run_one(*i);
+    if (r)
+      return r;
+  }
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  CompressionBench bench;
+  try {
+    int err = bench.setup(argc, argv);
+    if (err)
+      return err;
+    return bench.run();
+  } catch (po::error &e) {
+    cerr << e.what() << std::endl;
+    return 1;
+  }
+}
+
+/*
+ * Local Variables:
+ * compile-command: "cd ../.. ; make -j4 ceph_compression_benchmark &&
+ *   ./ceph_compression_benchmark --codec snappy --codec lz4 --codec zstd \
+ *      --compressor-dir .libs"
+ * End:
+ */
@@ -49,6 +49,7 @@ TYPE(pow2_hist_t)
 TYPE(osd_reqid_t)
 TYPE(object_locator_t)
 TYPE(request_redirect_t)
+TYPE(osd_optrace_t)
 TYPE(pg_t)
 TYPE(coll_t)
 TYPE(objectstore_perf_stat_t)
@@ -0,0 +1,405 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * Copyright (C) 2004-2006 Sage Weil <sage@newdream.net>
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+/*
+ * ceph_mdsbench: mdtest-style cephfs metadata benchmark.
+ *
+ * Runs phased create/stat/readdir/unlink workloads against libcephfs
+ * from multiple threads, each in its own subdirectory, and reports
+ * per-phase throughput and latency percentiles as JSON so runs can be
+ * compared across releases.  --start-at lets several hosts hit the MDS
+ * at the same wall-clock instant; --slo-ms counts operations over a
+ * latency budget.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "include/cephfs/libcephfs.h"
+#include "include/utime.h"
+#include "common/Clock.h"
+#include "common/Cond.h"
+#include "common/Formatter.h"
+#include "common/Mutex.h"
+#include "common/Thread.h"
+#include "common/ceph_argparse.h"
+
+struct Phase {
+  const char *name;
+  utime_t start, end;
+  std::vector<uint64_t> lat_usec;  // merged from all threads
+};
+
+enum {
+  PHASE_CREATE = 0,
+  PHASE_STAT,
+  PHASE_READDIR,
+  PHASE_UNLINK,
+  NUM_PHASES
+};
+
+static const char *phase_names[NUM_PHASES] = {
+  "create", "stat", "readdir", "unlink"
+};
+
+// all-thread rendezvous between phases, so a slow creator cannot
+// overlap with another thread's stat pass
+class PhaseBarrier {
+  Mutex lock;
+  Cond cond;
+  int count;
+  int waiting;
+  int generation;
+public:
+  explicit PhaseBarrier(int c)
+    : lock("PhaseBarrier::lock"), count(c), waiting(0), generation(0) {}
+  void wait() {
+    Mutex::Locker l(lock);
+    int gen = generation;
+    if (++waiting == count) {
+      waiting = 0;
+      generation++;
+      cond.Signal();
+    } else {
+      while (gen == generation)
+	cond.Wait(lock);
+    }
+  }
+};
+
+struct BenchParams {
+  std::string basedir;
+  std::string hostid;
+  int threads;
+  int files;
+  int readdir_scans;
+  long start_at;
+  double slo_ms;
+  BenchParams()
+    : basedir("/mdsbench"), threads(4), files(1000), readdir_scans(10),
+      start_at(0), slo_ms(0) {}
+};
+
+class BenchThread : public Thread {
+public:
+  struct ceph_mount_info *cmount;
+  const BenchParams *params;
+  PhaseBarrier *barrier;
+  int id;
+  std::string dir;
+  std::vector<uint64_t> lat_usec[NUM_PHASES];
+  int errors;
+
+  BenchThread() : cmount(NULL), params(NULL), barrier(NULL), id(0), errors(0) {}
+
+  std::string path_of(int n) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "/file.%d", n);
+    return dir + buf;
+  }
+
+  void *entry() {
+    for (int f = 0; f < NUM_PHASES; f++)
+      lat_usec[f].reserve(f == PHASE_READDIR ? params->readdir_scans
+			  : params->files);
+
+    // create
+    barrier->wait();
+    for (int n = 0; n < params->files; n++) {
+      utime_t start = ceph_clock_now(NULL);
+      int fd = ceph_open(cmount, path_of(n).c_str(),
+			 O_CREAT|O_EXCL|O_WRONLY, 0644);
+      if (fd < 0) {
+	errors++;
+	continue;
+      }
+      ceph_close(cmount, fd);
+      lat_usec[PHASE_CREATE].push_back(
+	(uint64_t)((ceph_clock_now(NULL) - start).to_nsec() / 1000));
+    }
+
+    // stat
+    barrier->wait();
+    for (int n = 0; n < params->files; n++) {
+      struct stat st;
+      utime_t start = ceph_clock_now(NULL);
+      if (ceph_stat(cmount, path_of(n).c_str(), &st) < 0) {
+	errors++;
+	continue;
+      }
+      lat_usec[PHASE_STAT].push_back(
+	(uint64_t)((ceph_clock_now(NULL) - start).to_nsec() / 1000));
+    }
+
+    // readdir (one latency sample per full scan of our directory)
+    barrier->wait();
+    for (int n = 0; n < params->readdir_scans; n++) {
+      struct ceph_dir_result *dirp;
+      utime_t start = ceph_clock_now(NULL);
+      if (ceph_opendir(cmount, dir.c_str(), &dirp) < 0) {
+	errors++;
+	continue;
+      }
+      while (ceph_readdir(cmount, dirp))
+	;
+      ceph_closedir(cmount, dirp);
+      lat_usec[PHASE_READDIR].push_back(
+	(uint64_t)((ceph_clock_now(NULL) - start).to_nsec() / 1000));
+    }
+
+    // unlink
+    barrier->wait();
+    for (int n = 0; n < params->files; n++) {
+      utime_t start = ceph_clock_now(NULL);
+      if (ceph_unlink(cmount, path_of(n).c_str()) < 0) {
+	errors++;
+	continue;
+      }
+      lat_usec[PHASE_UNLINK].push_back(
+	(uint64_t)((ceph_clock_now(NULL) - start).to_nsec() / 1000));
+    }
+    barrier->wait();
+    return NULL;
+  }
+};
+
+// timekeeper: participates in the barriers to stamp phase boundaries
+class TimerThread : public Thread {
+public:
+  PhaseBarrier *barrier;
+  Phase *phases;
+
+  TimerThread() : barrier(NULL), phases(NULL) {}
+
+  void *entry() {
+    for (int f = 0; f < NUM_PHASES; f++) {
+      barrier->wait();
+      phases[f].start = ceph_clock_now(NULL);
+    }
+    barrier->wait();
+    phases[NUM_PHASES - 1].end = ceph_clock_now(NULL);
+    // each phase ends when the next begins
+    for (int f = 0; f < NUM_PHASES - 1; f++)
+      phases[f].end = phases[f + 1].start;
+    return NULL;
+  }
+};
+
+static uint64_t percentile(const std::vector<uint64_t>& v, double p)
+{
+  if (v.empty())
+    return 0;
+  size_t i = (size_t)(p * (v.size() - 1));
+  return v[i];
+}
+
+static void usage()
+{
+  std::cerr << "usage: ceph_mdsbench [options] [-- ceph options]\n"
+	    << "  --dir <path>           base directory in cephfs (default /mdsbench)\n"
+	    << "  --host-id <name>       unique id for this host (default: hostname)\n"
+	    << "  --threads <n>          worker threads (default 4)\n"
+	    << "  --files <n>            files per thread (default 1000)\n"
+	    << "  --readdir-scans <n>    directory scans per thread (default 10)\n"
+	    << "  --start-at <unixtime>  sleep until this time before starting,\n"
+	    << "                         to coordinate multiple hosts\n"
+	    << "  --slo-ms <ms>          count operations slower than this\n"
+	    << std::endl;
+}
+
+int main(int argc, const char **argv)
+{
+  std::vector<const char*> args;
+  argv_to_vec(argc, argv, args);
+  env_to_vec(args);
+
+  BenchParams params;
+  std::string val;
+  for (std::vector<const char*>::iterator i = args.begin(); i != args.end(); ) {
+    if (ceph_argparse_double_dash(args, i)) {
+      break;
+    } else if (ceph_argparse_flag(args, i, "-h", "--help", (char*)NULL)) {
+      usage();
+      return 0;
+    } else if (ceph_argparse_witharg(args, i, &val, "--dir", (char*)NULL)) {
+      params.basedir = val;
+    } else if (ceph_argparse_witharg(args, i, &val, "--host-id", (char*)NULL)) {
+      params.hostid = val;
+    } else if (ceph_argparse_witharg(args, i, &val, "--threads", (char*)NULL)) {
+      params.threads = atoi(val.c_str());
+    } else if (ceph_argparse_witharg(args, i, &val, "--files", (char*)NULL)) {
+      params.files = atoi(val.c_str());
+    } else if (ceph_argparse_witharg(args, i, &val, "--readdir-scans",
+				     (char*)NULL)) {
+      params.readdir_scans = atoi(val.c_str());
+    } else if (ceph_argparse_witharg(args, i, &val, "--start-at", (char*)NULL)) {
+      params.start_at = atol(val.c_str());
+    } else if (ceph_argparse_witharg(args, i, &val, "--slo-ms", (char*)NULL)) {
+      params.slo_ms = atof(val.c_str());
+    } else {
+      ++i;
+    }
+  }
+  if (params.threads < 1 || params.files < 1 || params.readdir_scans < 0) {
+    usage();
+    return 1;
+  }
+  if (params.hostid.empty()) {
+    char hostname[256] = { 0 };
+    gethostname(hostname, sizeof(hostname) - 1);
+    params.hostid = hostname;
+  }
+
+  struct ceph_mount_info *cmount;
+  int r = ceph_create(&cmount, NULL);
+  if (r < 0) {
+    std::cerr << "ceph_create failed: " << strerror(-r) << std::endl;
+    return 1;
+  }
+  ceph_conf_read_file(cmount, NULL);
+  if (!args.empty()) {
+    // conf_parse_argv skips argv[0], so put the program name back
+    std::vector<const char*> conf_args;
+    conf_args.push_back(argv[0]);
+    conf_args.insert(conf_args.end(), args.begin(), args.end());
+    ceph_conf_parse_argv(cmount, conf_args.size(), &conf_args[0]);
+  }
+  r = ceph_mount(cmount, "/");
+  if (r < 0) {
+    std::cerr << "ceph_mount failed: " << strerror(-r) << std::endl;
+    return 1;
+  }
+
+  // per-host, per-thread working directories
+  ceph_mkdirs(cmount, params.basedir.c_str(), 0755);
+  std::vector<BenchThread*> workers;
+  PhaseBarrier barrier(params.threads + 1);  // workers + timekeeper
+  Phase phases[NUM_PHASES];
+  for (int f = 0; f < NUM_PHASES; f++)
+    phases[f].name = phase_names[f];
+
+  for (int i = 0; i < params.threads; i++) {
+    BenchThread *t = new BenchThread;
+    t->cmount = cmount;
+    t->params = &params;
+    t->barrier = &barrier;
+    t->id = i;
+    std::ostringstream oss;
+    oss << params.basedir << "/" << params.hostid << ".thr" << i;
+    t->dir = oss.str();
+    r = ceph_mkdir(cmount, t->dir.c_str(), 0755);
+    if (r < 0 && r != -EEXIST) {
+      std::cerr << "mkdir " << t->dir << " failed: " << strerror(-r)
+		<< std::endl;
+      return 1;
+    }
+    workers.push_back(t);
+  }
+
+  // coordinated multi-host start
+  if (params.start_at) {
+    utime_t now = ceph_clock_now(NULL);
+    if ((long)now.sec() < params.start_at) {
+      std::cerr << "waiting " << (params.start_at - now.sec())
+		<< "s for start time" << std::endl;
+      while ((long)ceph_clock_now(NULL).sec() < params.start_at)
+	usleep(10000);
+    }
+  }
+
+  TimerThread timer;
+  timer.barrier = &barrier;
+  timer.phases = phases;
+  timer.set_role("mdsbench_timer");
+  timer.create();
+  for (int i = 0; i < params.threads; i++) {
+    workers[i]->set_role("mdsbench_worker");
+    workers[i]->create();
+  }
+  timer.join();
+  int errors = 0;
+  for (int i = 0; i < params.threads; i++) {
+    workers[i]->join();
+    errors += workers[i]->errors;
+    for (int f = 0; f < NUM_PHASES; f++) {
+      phases[f].lat_usec.insert(phases[f].lat_usec.end(),
+				workers[i]->lat_usec[f].begin(),
+				workers[i]->lat_usec[f].end());
+    }
+  }
+
+  // report
+  ceph::Formatter *f = ceph::Formatter::create("json-pretty");
+  f->open_object_section("mdsbench");
+  f->dump_string("host_id", params.hostid);
+  f->dump_int("threads", params.threads);
+  f->dump_int("files_per_thread", params.files);
+  f->dump_int("errors", errors);
+  f->dump_float("slo_ms", params.slo_ms);
+  f->open_array_section("phases");
+  for (int ph = 0; ph < NUM_PHASES; ph++) {
+    Phase& p = phases[ph];
+    std::sort(p.lat_usec.begin(), p.lat_usec.end());
+    double secs = p.end - p.start;
+    uint64_t sum = 0, over_slo = 0;
+    uint64_t slo_usec = (uint64_t)(params.slo_ms * 1000);
+    for (size_t i = 0; i < p.lat_usec.size(); i++) {
+      sum += p.lat_usec[i];
+      if (slo_usec && p.lat_usec[i] > slo_usec)
+	over_slo++;
+    }
+    f->open_object_section("phase");
+    f->dump_string("name", p.name);
+    f->dump_unsigned("ops", p.lat_usec.size());
+    f->dump_float("secs", secs);
+    f->dump_float("ops_per_sec",
+		  secs > 0 ? (double)p.lat_usec.size() / secs : 0);
+    f->dump_float("lat_avg_ms",
+		  p.lat_usec.empty() ? 0 :
+		  (double)sum / p.lat_usec.size() / 1000.0);
+    f->dump_float("lat_p50_ms", percentile(p.lat_usec, 0.5) / 1000.0);
+    f->dump_float("lat_p90_ms", percentile(p.lat_usec, 0.9) / 1000.0);
+    f->dump_float("lat_p99_ms", percentile(p.lat_usec, 0.99) / 1000.0);
+    f->dump_float("lat_max_ms",
+		  p.lat_usec.empty() ? 0 : p.lat_usec.back() / 1000.0);
+    if (slo_usec)
+      f->dump_unsigned("over_slo", over_slo);
+    f->close_section();
+  }
+  f->close_section();  // phases
+  f->close_section();  // mdsbench
+  f->flush(std::cout);
+  std::cout << std::endl;
+  delete f;
+
+  // clean up our per-thread dirs; leave basedir for other hosts
+  for (int i = 0; i < params.threads; i++) {
+    ceph_rmdir(cmount, workers[i]->dir.c_str());
+    delete workers[i];
+  }
+  ceph_unmount(cmount);
+  ceph_release(cmount);
+  return errors ? 1 : 0;
+}
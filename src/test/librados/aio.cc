@@ -333,6 +333,57 @@ TEST(LibRadosAio, RoundTrip) {
   rados_aio_release(my_completion2);
 }
 
+TEST(LibRadosAio, RoundTripReadv) {
+  AioTestData test_data;
+  rados_completion_t my_completion;
+  ASSERT_EQ("", test_data.init());
+  ASSERT_EQ(0, rados_aio_create_completion((void*)&test_data,
+	      set_completion_complete, set_completion_safe, &my_completion));
+  char buf[128];
+  for (unsigned i = 0; i < sizeof(buf); i++)
+    buf[i] = i;
+  ASSERT_EQ(0, rados_aio_write(test_data.m_ioctx, "foo",
+			       my_completion, buf, sizeof(buf), 0));
+  {
+    TestAlarm alarm;
+    sem_wait(&test_data.m_sem);
+    sem_wait(&test_data.m_sem);
+  }
+  ASSERT_EQ(0, rados_aio_get_return_value(my_completion));
+  // three scattered extents in one op
+  char ext0[16], ext1[32], ext2[8];
+  memset(ext0, 0, sizeof(ext0));
+  memset(ext1, 0, sizeof(ext1));
+  memset(ext2, 0, sizeof(ext2));
+  struct iovec iov[3];
+  uint64_t off[3];
+  iov[0].iov_base = ext0;
+  iov[0].iov_len = sizeof(ext0);
+  off[0] = 0;
+  iov[1].iov_base = ext1;
+  iov[1].iov_len = sizeof(ext1);
+  off[1] = 64;
+  iov[2].iov_base = ext2;
+  iov[2].iov_len = sizeof(ext2);
+  off[2] = 120;
+  rados_completion_t my_completion2;
+  ASSERT_EQ(0, rados_aio_create_completion((void*)&test_data,
+	      set_completion_complete, set_completion_safe, &my_completion2));
+  ASSERT_EQ(0, rados_aio_readv(test_data.m_ioctx, "foo",
+			       my_completion2, iov, 3, off));
+  {
+    TestAlarm alarm;
+    ASSERT_EQ(0, rados_aio_wait_for_complete(my_completion2));
+  }
+  ASSERT_EQ((int)(sizeof(ext0) + sizeof(ext1) + sizeof(ext2)),
+	    rados_aio_get_return_value(my_completion2));
+  ASSERT_EQ(0, memcmp(buf, ext0, sizeof(ext0)));
+  ASSERT_EQ(0, memcmp(buf + 64, ext1, sizeof(ext1)));
+  ASSERT_EQ(0, memcmp(buf + 120, ext2, sizeof(ext2)));
+  rados_aio_release(my_completion);
+  rados_aio_release(my_completion2);
+}
+
 TEST(LibRadosAio, RoundTrip2) {
   AioTestData test_data;
   rados_completion_t my_completion;
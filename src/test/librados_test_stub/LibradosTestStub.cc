@@ -992,6 +992,49 @@ int cls_cxx_map_remove_key(cls_method_context_t hctx, const string &key) {
   return ctx->io_ctx_impl->omap_rm_keys(ctx->oid, keys);
 }
 
+int cls_cxx_map_get_vals_by_keys(cls_method_context_t hctx,
+                                 const std::set<string> &keys,
+                                 std::map<string, bufferlist> *vals) {
+  vals->clear();
+  for (std::set<string>::const_iterator it = keys.begin(); it != keys.end();
+      ++it) {
+    bufferlist bl;
+    int r = cls_cxx_map_get_val(hctx, *it, &bl);
+    if (r == -ENOENT) {
+      continue;
+    } else if (r < 0) {
+      return r;
+    }
+    (*vals)[*it] = bl;
+  }
+  return vals->size();
+}
+
+int cls_cxx_map_remove_keys(cls_method_context_t hctx,
+                            const std::set<string> &keys) {
+  librados::TestClassHandler::MethodContext *ctx =
+    reinterpret_cast<librados::TestClassHandler::MethodContext*>(hctx);
+  return ctx->io_ctx_impl->omap_rm_keys(ctx->oid, keys);
+}
+
+int cls_cxx_map_scanner::next_chunk(std::map<string, bufferlist> *vals) {
+  vals->clear();
+  if (end) {
+    return 0;
+  }
+  int r = cls_cxx_map_get_vals(hctx, next_after, filter_prefix, chunk_size,
+                               vals);
+  if (r < 0) {
+    return r;
+  }
+  if (vals->size() < chunk_size) {
+    end = true;
+  } else {
+    next_after = vals->rbegin()->first;
+  }
+  return vals->size();
+}
+
 int cls_cxx_map_set_val(cls_method_context_t hctx, const string &key,
                         bufferlist *inbl) {
   std::map<std::string, bufferlist> m;
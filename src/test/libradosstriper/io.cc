@@ -222,6 +222,28 @@ TEST_F(StriperTest, TruncTest) {
   ASSERT_EQ(0, memcmp(buf, buf2, sizeof(buf)/2));
 }
 
+TEST_F(StriperTest, AppendAfterTruncRoundTrip) {
+  // append after a truncation must restart from the truncated size,
+  // not from a stale cached size
+  char buf[128];
+  char buf2[sizeof(buf) + sizeof(buf)/2];
+  memset(buf, 0xaa, sizeof(buf));
+  ASSERT_EQ(0, rados_striper_append(striper, "AppendAfterTrunc", buf, sizeof(buf)));
+  ASSERT_EQ(0, rados_striper_trunc(striper, "AppendAfterTrunc", sizeof(buf) / 2));
+  memset(buf, 0xbb, sizeof(buf));
+  ASSERT_EQ(0, rados_striper_append(striper, "AppendAfterTrunc", buf, sizeof(buf)));
+  uint64_t size;
+  time_t mtime;
+  ASSERT_EQ(0, rados_striper_stat(striper, "AppendAfterTrunc", &size, &mtime));
+  ASSERT_EQ((uint64_t)(sizeof(buf) + sizeof(buf)/2), size);
+  memset(buf2, 0, sizeof(buf2));
+  ASSERT_EQ((int)sizeof(buf2), rados_striper_read(striper, "AppendAfterTrunc", buf2, sizeof(buf2), 0));
+  memset(buf, 0xaa, sizeof(buf));
+  ASSERT_EQ(0, memcmp(buf2, buf, sizeof(buf)/2));
+  memset(buf, 0xbb, sizeof(buf));
+  ASSERT_EQ(0, memcmp(buf2 + sizeof(buf)/2, buf, sizeof(buf)));
+}
+
 TEST_F(StriperTestPP, TruncTestPP) {
   char buf[128];
   memset(buf, 0xaa, sizeof(buf));
@@ -322,6 +322,43 @@ TEST(EventCenterTest, DispatchTest) {
   worker2.stop();
 }
 
+TEST(EventCenterTest, TimeEventTest) {
+  Worker worker(g_ceph_context);
+  atomic_t count(0);
+  Mutex lock("TimeEventTest::lock");
+  Cond cond;
+  worker.create();
+
+  // many events in the same coalesced bucket all fire
+  int n = 100;
+  for (int i = 0; i < n; ++i) {
+    count.inc();
+    worker.center.create_time_event(
+	1000, EventCallbackRef(new CountEvent(&count, &lock, &cond)));
+  }
+  {
+    Mutex::Locker l(lock);
+    while (count.read())
+      cond.Wait(lock);
+  }
+
+  // deleted events don't fire, including delete after fire
+  count.inc();
+  uint64_t live = worker.center.create_time_event(
+      1000, EventCallbackRef(new CountEvent(&count, &lock, &cond)));
+  uint64_t dead = worker.center.create_time_event(
+      60000000, EventCallbackRef(new CountEvent(&count, &lock, &cond)));
+  worker.center.delete_time_event(dead);
+  {
+    Mutex::Locker l(lock);
+    while (count.read())
+      cond.Wait(lock);
+  }
+  worker.center.delete_time_event(live);  // no-op, already fired
+
+  worker.stop();
+}
+
 INSTANTIATE_TEST_CASE_P(
   AsyncMessenger,
   EventDriverTest,
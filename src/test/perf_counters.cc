@@ -187,3 +187,85 @@ TEST(PerfCounters, MultiplePerfCounters) {
   ASSERT_EQ("", client.do_request("{ \"prefix\": \"perf dump\", \"format\": \"json\" }", &msg));
   ASSERT_EQ("{}", msg);
 }
+
+TEST(PerfCounters, BinaryDump) {
+  PerfCountersCollection *coll = g_ceph_context->get_perfcounters_collection();
+  coll->clear();
+  PerfCounters* fake_pf = setup_test_perfcounters1(g_ceph_context);
+  coll->add(fake_pf);
+  fake_pf->inc(TEST_PERFCOUNTERS1_ELEMENT_1, 7);
+  fake_pf->tset(TEST_PERFCOUNTERS1_ELEMENT_2, utime_t(2, 0));
+  fake_pf->tinc(TEST_PERFCOUNTERS1_ELEMENT_3, utime_t(100, 0));
+
+  bufferlist schema_bl, dump_bl;
+  coll->dump_binary_schema(schema_bl);
+  coll->dump_binary(dump_bl);
+
+  // schema: epoch, then (logger name, [(counter name, type), ...])
+  // (each decode goes in its own scope so the DECODE_START locals
+  // don't collide)
+  uint64_t schema_epoch;
+  __u32 num_counters;
+  std::vector<__u32> types;
+  {
+    bufferlist::iterator sp = schema_bl.begin();
+    DECODE_START(1, sp);
+    ::decode(schema_epoch, sp);
+    __u32 num_loggers;
+    ::decode(num_loggers, sp);
+    ASSERT_EQ(1u, num_loggers);
+    std::string logger_name;
+    ::decode(logger_name, sp);
+    ASSERT_EQ("test_perfcounter_1", logger_name);
+    ::decode(num_counters, sp);
+    ASSERT_EQ(3u, num_counters);
+    for (unsigned i = 0; i < num_counters; ++i) {
+      std::string counter_name;
+      __u32 type;
+      ::decode(counter_name, sp);
+      ::decode(type, sp);
+      types.push_back(type);
+    }
+    DECODE_FINISH(sp);
+  }
+
+  // dump: epoch, then raw values in schema order (avgcount + sum for
+  // LONGRUNAVG counters)
+  uint64_t dump_epoch;
+  std::vector<uint64_t> values;
+  {
+    bufferlist::iterator dp = dump_bl.begin();
+    DECODE_START(1, dp);
+    ::decode(dump_epoch, dp);
+    ASSERT_EQ(schema_epoch, dump_epoch);
+    for (unsigned i = 0; i < num_counters; ++i) {
+      uint64_t v;
+      ::decode(v, dp);
+      values.push_back(v);
+      if (types[i] & PERFCOUNTER_LONGRUNAVG) {
+	::decode(v, dp);
+	values.push_back(v);
+      }
+    }
+    DECODE_FINISH(dp);
+  }
+  ASSERT_EQ(4u, values.size());
+  ASSERT_EQ(7u, values[0]);                      // element1
+  ASSERT_EQ(2000000000ull, values[1]);           // element2, in ns
+  ASSERT_EQ(1u, values[2]);                      // element3 avgcount
+  ASSERT_EQ(100000000000ull, values[3]);         // element3 sum, in ns
+
+  // membership changes bump the epoch
+  coll->remove(fake_pf);
+  bufferlist bl2;
+  coll->dump_binary(bl2);
+  uint64_t epoch2;
+  {
+    bufferlist::iterator p2 = bl2.begin();
+    DECODE_START(1, p2);
+    ::decode(epoch2, p2);
+    ASSERT_GT(epoch2, dump_epoch);
+    DECODE_FINISH(p2);
+  }
+  coll->clear();
+}
@@ -0,0 +1,186 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+// Microbenchmarks for the refcounting and op tracking hot paths, in the
+// spirit of perf_local: each measurement runs in a single stand-alone
+// process and reports nanoseconds per operation.
+//
+//     ceph_perf_tracker [threads]
+//
+// Covers RefCountedObject get()/put() (single thread, all threads
+// hammering one shared object, and one private object per thread) and
+// TrackedOp create/destroy through OpTracker with tracking enabled and
+// disabled.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "common/ceph_argparse.h"
+#include "common/Cycles.h"
+#include "common/RefCountedObj.h"
+#include "common/Thread.h"
+#include "common/TrackedOp.h"
+#include "global/global_init.h"
+
+enum {
+  REFCOUNT_ITERATIONS = 1000000,
+  TRACKER_ITERATIONS = 200000
+};
+
+class BenchOp : public TrackedOp {
+public:
+  typedef ceph::shared_ptr<BenchOp> Ref;
+
+  BenchOp(int, OpTracker *tracker)
+    : TrackedOp(tracker, ceph_clock_now(NULL)) {}
+  void _dump_op_descriptor_unlocked(ostream& stream) const {
+    stream << "bench_op";
+  }
+};
+
+struct RefCountBenchThread : public Thread {
+  RefCountedObject *obj;   // if NULL, use a private object
+  uint64_t cycles;
+  RefCountBenchThread() : obj(NULL), cycles(0) {}
+  void *entry() {
+    RefCountedObject *o = obj ? obj->get() : new RefCountedObject;
+    uint64_t start = Cycles::rdtsc();
+    for (int i = 0; i < REFCOUNT_ITERATIONS; i++) {
+      o->get();
+      o->put();
+    }
+    cycles = Cycles::rdtsc() - start;
+    o->put();
+    return NULL;
+  }
+};
+
+struct TrackerBenchThread : public Thread {
+  OpTracker *tracker;
+  uint64_t cycles;
+  TrackerBenchThread() : tracker(NULL), cycles(0) {}
+  void *entry() {
+    uint64_t start = Cycles::rdtsc();
+    for (int i = 0; i < TRACKER_ITERATIONS; i++) {
+      BenchOp::Ref op = tracker->create_request<BenchOp, int>(0);
+    }
+    cycles = Cycles::rdtsc() - start;
+    return NULL;
+  }
+};
+
+template<typename T>
+static double run_threads(vector<T*> &threads, int iterations)
+{
+  for (unsigned i = 0; i < threads.size(); i++)
+    threads[i]->create();
+  uint64_t total_cycles = 0;
+  for (unsigned i = 0; i < threads.size(); i++) {
+    threads[i]->join();
+    total_cycles += threads[i]->cycles;
+  }
+  // average time per op per thread
+  return Cycles::to_seconds(total_cycles / threads.size()) / iterations;
+}
+
+static double refcount_single()
+{
+  vector<RefCountBenchThread*> threads;
+  RefCountBenchThread t;
+  threads.push_back(&t);
+  return run_threads(threads, REFCOUNT_ITERATIONS);
+}
+
+static double refcount_shared(int nthreads)
+{
+  RefCountedObject *obj = new RefCountedObject;
+  vector<RefCountBenchThread*> threads;
+  for (int i = 0; i < nthreads; i++) {
+    threads.push_back(new RefCountBenchThread);
+    threads.back()->obj = obj;
+  }
+  double r = run_threads(threads, REFCOUNT_ITERATIONS);
+  for (int i = 0; i < nthreads; i++)
+    delete threads[i];
+  obj->put();
+  return r;
+}
+
+static double refcount_private(int nthreads)
+{
+  vector<RefCountBenchThread*> threads;
+  for (int i = 0; i < nthreads; i++)
+    threads.push_back(new RefCountBenchThread);
+  double r = run_threads(threads, REFCOUNT_ITERATIONS);
+  for (int i = 0; i < nthreads; i++)
+    delete threads[i];
+  return r;
+}
+
+static double tracker_ops(int nthreads, bool tracking)
+{
+  OpTracker tracker(g_ceph_context, tracking, 32);
+  tracker.set_complaint_and_threshold(600, 5);
+  tracker.set_history_size_and_duration(0, 0);
+  vector<TrackerBenchThread*> threads;
+  for (int i = 0; i < nthreads; i++) {
+    threads.push_back(new TrackerBenchThread);
+    threads.back()->tracker = &tracker;
+  }
+  double r = run_threads(threads, TRACKER_ITERATIONS);
+  for (int i = 0; i < nthreads; i++)
+    delete threads[i];
+  tracker.on_shutdown();
+  return r;
+}
+
+static void report(const char *name, double seconds, const char *description)
+{
+  printf("%-26s %8.2f ns  %s\n", name, 1e9 * seconds, description);
+}
+
+int main(int argc, char *argv[])
+{
+  vector<const char*> args;
+  argv_to_vec(argc, (const char **)argv, args);
+
+  global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT, CODE_ENVIRONMENT_UTILITY, 0);
+  Cycles::init();
+
+  int nthreads = 4;
+  if (args.size() > 0)
+    nthreads = atoi(args[0]);
+  if (nthreads <= 0)
+    nthreads = 4;
+
+  report("refcount_single", refcount_single(),
+	 "get()+put(), one thread, one object");
+
+  char desc[128];
+  snprintf(desc, sizeof(desc),
+	   "get()+put(), %d threads sharing one object", nthreads);
+  report("refcount_shared", refcount_shared(nthreads), desc);
+
+  snprintf(desc, sizeof(desc),
+	   "get()+put(), %d threads, one object each", nthreads);
+  report("refcount_private", refcount_private(nthreads), desc);
+
+  snprintf(desc, sizeof(desc),
+	   "op create+destroy, %d threads, tracking off", nthreads);
+  report("tracker_ops_untracked", tracker_ops(nthreads, false), desc);
+
+  snprintf(desc, sizeof(desc),
+	   "op create+destroy, %d threads, tracking on", nthreads);
+  report("tracker_ops_tracked", tracker_ops(nthreads, true), desc);
+
+  return 0;
+}
@@ -0,0 +1,52 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * Copyright (C) 2004-2006 Sage Weil <sage@newdream.net>
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <errno.h>
+#include <time.h>
+#include <sstream>
+
+#include "common/SamplingProfiler.h"
+#include "gtest/gtest.h"
+
+// burn cpu time so ITIMER_PROF ticks fire
+static void spin_for(double seconds)
+{
+  volatile unsigned long x = 0;
+  clock_t end = clock() + (clock_t)(seconds * CLOCKS_PER_SEC);
+  while (clock() < end)
+    x++;
+}
+
+TEST(SamplingProfiler, StartStopDump)
+{
+  ASSERT_EQ(-EINVAL, SamplingProfiler::start(0));
+  ASSERT_EQ(0, SamplingProfiler::start(1000));
+  ASSERT_TRUE(SamplingProfiler::running());
+  ASSERT_EQ(-EBUSY, SamplingProfiler::start(1000));
+
+  for (int i = 0; i < 100 && SamplingProfiler::get_samples() == 0; i++)
+    spin_for(0.05);
+
+  ASSERT_EQ(0, SamplingProfiler::stop());
+  ASSERT_FALSE(SamplingProfiler::running());
+  ASSERT_EQ(-EINVAL, SamplingProfiler::stop());
+  ASSERT_GT(SamplingProfiler::get_samples(), 0u);
+
+  std::ostringstream os;
+  SamplingProfiler::dump_folded(os);
+  ASSERT_FALSE(os.str().empty());
+
+  SamplingProfiler::reset();
+  ASSERT_EQ((uint64_t)0, SamplingProfiler::get_samples());
+}
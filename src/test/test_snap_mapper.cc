@@ -543,6 +543,51 @@ public:
     snap_to_hobject.erase(snap);
   }
 
+  void trim_snap_batched() {
+    Mutex::Locker l(lock);
+    if (snap_to_hobject.empty())
+      return;
+    map<snapid_t, set<hobject_t, hobject_t::BitwiseComparator> >::iterator snap =
+      rand_choose(snap_to_hobject);
+    set<hobject_t, hobject_t::BitwiseComparator> hobjects = snap->second;
+
+    std::list<hobject_t> to_trim;
+    while (mapper->get_next_objects_to_trim(
+	     snap->first, 1 + (rand() % 5), &to_trim) == 0) {
+      for (std::list<hobject_t>::iterator p = to_trim.begin();
+	   p != to_trim.end();
+	   ++p) {
+	hobject_t hoid = *p;
+	assert(!hoid.is_max());
+	assert(hobjects.count(hoid));
+	hobjects.erase(hoid);
+
+	map<hobject_t, set<snapid_t>, hobject_t::BitwiseComparator>::iterator j =
+	  hobject_to_snap.find(hoid);
+	assert(j->second.count(snap->first));
+	set<snapid_t> old_snaps(j->second);
+	j->second.erase(snap->first);
+
+	{
+	  PausyAsyncMap::Transaction t;
+	  mapper->update_snaps(
+	    hoid,
+	    j->second,
+	    &old_snaps,
+	    &t);
+	  driver->submit(&t);
+	}
+	if (j->second.empty()) {
+	  hobject_to_snap.erase(j);
+	}
+      }
+      to_trim.clear();
+    }
+    assert(hobjects.empty());
+
+    snap_to_hobject.erase(snap);
+  }
+
   void remove_oid() {
     Mutex::Locker l(lock);
     if (hobject_to_snap.empty())
@@ -628,7 +673,10 @@ protected:
 	get_tester().create_object();
 	break;
       case 2:
-	get_tester().trim_snap();
+	if (rand() % 2)
+	  get_tester().trim_snap();
+	else
+	  get_tester().trim_snap_batched();
 	break;
       case 3:
 	get_tester().check_oid();
@@ -648,6 +696,14 @@ TEST_F(SnapMapperTest, Simple) {
   get_tester().trim_snap();
 }
 
+TEST_F(SnapMapperTest, BatchTrim) {
+  init(1);
+  get_tester().create_snap();
+  for (unsigned i = 0; i < 20; ++i)
+    get_tester().create_object();
+  get_tester().trim_snap_batched();
+}
+
 TEST_F(SnapMapperTest, More) {
   init(1);
   run();
@@ -40,6 +40,7 @@ enum {
     TYPE_PG_METADATA,
     TYPE_POOL_BEGIN,
     TYPE_POOL_END,
+    TYPE_OBJECT_INDEX,
     END_OF_TYPES,	//Keep at the end
 };
 
@@ -278,6 +279,82 @@ struct omap_section {
   }
 };
 
+/**
+ * One entry of the trailing object index: the file offset and length of
+ * an object's TYPE_OBJECT_BEGIN..TYPE_OBJECT_END segment.
+ */
+struct object_index_entry {
+  ghobject_t hoid;
+  uint64_t offset;
+  uint64_t len;
+
+  object_index_entry() : offset(0), len(0) { }
+  object_index_entry(const ghobject_t &hoid, uint64_t offset, uint64_t len)
+    : hoid(hoid), offset(offset), len(len) { }
+
+  void encode(bufferlist& bl) const {
+    ENCODE_START(1, 1, bl);
+    ::encode(hoid, bl);
+    ::encode(offset, bl);
+    ::encode(len, bl);
+    ENCODE_FINISH(bl);
+  }
+  void decode(bufferlist::iterator& bl) {
+    DECODE_START(1, bl);
+    ::decode(hoid, bl);
+    ::decode(offset, bl);
+    ::decode(len, bl);
+    DECODE_FINISH(bl);
+  }
+};
+WRITE_CLASS_ENCODER(object_index_entry)
+
+/**
+ * Index of the object segments in an export.  It is written after
+ * TYPE_PG_END, so older importers (which stop at TYPE_PG_END) never see
+ * it.  A seekable reader can use it to fetch objects out of order or in
+ * parallel.
+ */
+struct object_index_section {
+  vector<object_index_entry> entries;
+
+  object_index_section() { }
+
+  void encode(bufferlist& bl) const {
+    ENCODE_START(1, 1, bl);
+    ::encode(entries, bl);
+    ENCODE_FINISH(bl);
+  }
+  void decode(bufferlist::iterator& bl) {
+    DECODE_START(1, bl);
+    ::decode(entries, bl);
+    DECODE_FINISH(bl);
+  }
+};
+
+/**
+ * Written at the very end of a seekable export: a fixed-size pointer to
+ * the TYPE_OBJECT_INDEX section.  A reader seeks to
+ * (end - FIXED_LENGTH), checks the magic, and then seeks to index_off.
+ * Exports written to a pipe omit the index and the locator.
+ */
+struct index_locator {
+  static const uint32_t FIXED_LENGTH = 12;
+  uint64_t index_off;
+  mymagic_t magic;
+
+  index_locator() : index_off(0), magic(endmagic) { }
+
+  void encode(bufferlist& bl) const {
+    ::encode(index_off, bl);
+    ::encode(magic, bl);
+  }
+  void decode(bufferlist::iterator& bl) {
+    ::decode(index_off, bl);
+    ::decode(magic, bl);
+  }
+};
+
 struct metadata_section {
   // struct_ver is the on-disk version of original pg
   __u8 struct_ver;  // for reference
@@ -381,6 +458,19 @@ class RadosDump
         return ret;
       }
 
+    // Variant that serializes the section into a bufferlist instead of
+    // writing it to a fd, so sections can be built off the writer thread.
+    template <typename T>
+      void write_section(sectiontype_t type, const T& obj, bufferlist& out) {
+        bufferlist bl;
+        obj.encode(bl);
+        header hdr(type, bl.length());
+        hdr.encode(out);
+        out.claim_append(bl);
+        footer ft;
+        ft.encode(out);
+      }
+
     int write_simple(sectiontype_t type, int fd)
     {
       if (dry_run)
@@ -391,6 +481,12 @@ class RadosDump
       hdr.encode(hbl);
       return hbl.write_fd(fd);
     }
+
+    void write_simple(sectiontype_t type, bufferlist& out)
+    {
+      header hdr(type, 0);
+      hdr.encode(out);
+    }
 };
 
 #endif
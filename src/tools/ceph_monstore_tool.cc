@@ -232,6 +232,7 @@ int update_osdmap(MonitorDBStore& store, version_t ver, bool copy,
   OSDMap osdmap;
   osdmap.decode(bl);
   osdmap.crush = crush;
+  osdmap.invalidate_cached_crush();
   if (copy) {
     osdmap.inc_epoch();
   }
@@ -21,6 +21,8 @@
 #include "common/Formatter.h"
 #include "common/errno.h"
 #include "common/ceph_argparse.h"
+#include "common/Thread.h"
+#include "common/Cond.h"
 
 #include "global/global_init.h"
 
@@ -67,6 +69,7 @@ const ssize_t max_read = 1024 * 1024;
 const int fd_none = INT_MIN;
 bool outistty;
 bool dry_run = false;
+unsigned export_threads = 4;
 
 struct action_on_object_t {
   virtual ~action_on_object_t() {}
@@ -572,11 +575,15 @@ void get_omap_batch(ObjectMap::ObjectMapIterator &iter, map<string, bufferlist>
   }
 }
 
-int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj)
+// Serialize one object's TYPE_OBJECT_BEGIN..TYPE_OBJECT_END segment
+// into *out.  Only reads from the store, so it is safe to run several
+// of these concurrently; the caller owns writing the segments to the
+// export stream in a stable order.
+int ObjectStoreTool::export_object(ObjectStore *store, coll_t cid,
+    ghobject_t &obj, bufferlist *out)
 {
   struct stat st;
   mysize_t total;
-  footer ft;
 
   int ret = store->stat(cid, obj, &st);
   if (ret < 0)
@@ -606,9 +613,7 @@ int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj
 
   // XXX: Should we be checking for WHITEOUT or LOST in objb.oi.flags and skip?
 
-  ret = write_section(TYPE_OBJECT_BEGIN, objb, file_fd);
-  if (ret < 0)
-    return ret;
+  write_section(TYPE_OBJECT_BEGIN, objb, *out);
 
   uint64_t offset = 0;
   bufferlist rawdatabl;
@@ -631,8 +636,7 @@ int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj
     total -= ret;
     offset += ret;
 
-    ret = write_section(TYPE_DATA, dblock, file_fd);
-    if (ret) return ret;
+    write_section(TYPE_DATA, dblock, *out);
   }
 
   //Handle attrs for this object
@@ -640,9 +644,7 @@ int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj
   ret = store->getattrs(cid, obj, aset);
   if (ret) return ret;
   attr_section as(aset);
-  ret = write_section(TYPE_ATTRS, as, file_fd);
-  if (ret)
-    return ret;
+  write_section(TYPE_ATTRS, as, *out);
 
   if (debug) {
     cerr << "attrs size " << aset.size() << std::endl;
@@ -657,9 +659,7 @@ int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj
   }
 
   omap_hdr_section ohs(hdrbuf);
-  ret = write_section(TYPE_OMAP_HDR, ohs, file_fd);
-  if (ret)
-    return ret;
+  write_section(TYPE_OMAP_HDR, ohs, *out);
 
   ObjectMap::ObjectMapIterator iter = store->get_omap_iterator(cid, obj);
   if (!iter) {
@@ -669,30 +669,86 @@ int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj
   }
   iter->seek_to_first();
   int mapcount = 0;
-  map<string, bufferlist> out;
+  map<string, bufferlist> omapout;
   while(iter->valid()) {
-    get_omap_batch(iter, out);
+    get_omap_batch(iter, omapout);
 
-    if (out.empty()) break;
+    if (omapout.empty()) break;
 
-    mapcount += out.size();
-    omap_section oms(out);
-    ret = write_section(TYPE_OMAP, oms, file_fd);
-    if (ret)
-      return ret;
+    mapcount += omapout.size();
+    omap_section oms(omapout);
+    write_section(TYPE_OMAP, oms, *out);
   }
   if (debug)
     cerr << "omap map size " << mapcount << std::endl;
 
-  ret = write_simple(TYPE_OBJECT_END, file_fd);
-  if (ret)
-    return ret;
+  write_simple(TYPE_OBJECT_END, *out);
 
   return 0;
 }
 
-int ObjectStoreTool::export_files(ObjectStore *store, coll_t coll)
+struct export_job {
+  ghobject_t obj;
+  bufferlist bl;
+  int ret;
+  bool done;
+  export_job(const ghobject_t &obj) : obj(obj), ret(0), done(false) {}
+};
+
+struct export_queue {
+  ObjectStoreTool *tool;
+  ObjectStore *store;
+  coll_t coll;
+  vector<export_job*> jobs;
+  size_t next;     // next job a worker may take
+  size_t written;  // jobs already flushed to the export stream
+  size_t max_inflight;
+  Mutex lock;
+  Cond cond;
+  export_queue(ObjectStoreTool *tool, ObjectStore *store, coll_t coll)
+    : tool(tool), store(store), coll(coll), next(0), written(0),
+      max_inflight(0), lock("export_queue::lock") {}
+  ~export_queue() {
+    for (vector<export_job*>::iterator i = jobs.begin(); i != jobs.end(); ++i)
+      delete *i;
+  }
+};
+
+class ExportWorker : public Thread {
+  export_queue *q;
+public:
+  ExportWorker(export_queue *q) : q(q) {}
+  void *entry() {
+    while (true) {
+      q->lock.Lock();
+      // Don't read too far ahead of the writer, or a large pg would be
+      // buffered in memory in its entirety.
+      while (q->next < q->jobs.size() &&
+	     q->next >= q->written + q->max_inflight)
+	q->cond.Wait(q->lock);
+      if (q->next >= q->jobs.size()) {
+	q->lock.Unlock();
+	break;
+      }
+      export_job *job = q->jobs[q->next++];
+      q->lock.Unlock();
+
+      int r = q->tool->export_object(q->store, q->coll, job->obj, &job->bl);
+
+      q->lock.Lock();
+      job->ret = r;
+      job->done = true;
+      q->cond.Signal();
+      q->lock.Unlock();
+    }
+    return NULL;
+  }
+};
+
+int ObjectStoreTool::export_files(ObjectStore *store, coll_t coll,
+    object_index_section &index)
 {
+  export_queue q(this, store, coll);
   ghobject_t next;
 
   while (!next.is_max()) {
@@ -708,12 +764,73 @@ int ObjectStoreTool::export_files(ObjectStore *store, coll_t coll)
       if (i->is_pgmeta() || i->hobj.is_temp()) {
 	continue;
       }
-      r = export_file(store, coll, *i);
-      if (r < 0)
-        return r;
+      q.jobs.push_back(new export_job(*i));
+    }
+  }
+
+  unsigned nthreads = export_threads;
+  if (nthreads < 1)
+    nthreads = 1;
+  if (nthreads > q.jobs.size())
+    nthreads = q.jobs.size();
+  q.max_inflight = 2 * nthreads;
+
+  vector<ExportWorker*> workers;
+  for (unsigned i = 0; i < nthreads; ++i) {
+    ExportWorker *w = new ExportWorker(&q);
+    w->create();
+    workers.push_back(w);
+  }
+
+  // Segment offsets are relative to the start of the file; tolerate a
+  // non-seekable output (pipe), the index is simply not written then.
+  uint64_t cur_offset = 0;
+  off_t filepos = dry_run ? -1 : ::lseek(file_fd, 0, SEEK_CUR);
+  if (filepos >= 0)
+    cur_offset = filepos;
+
+  // Drain the jobs in listing order so the stream layout matches the
+  // serial format exactly.
+  int ret = 0;
+  for (size_t i = 0; i < q.jobs.size(); ++i) {
+    export_job *job = q.jobs[i];
+    q.lock.Lock();
+    while (!job->done)
+      q.cond.Wait(q.lock);
+    if (job->ret < 0 && ret == 0) {
+      ret = job->ret;
+      q.next = q.jobs.size();  // stop the workers early
+    }
+    q.written++;
+    q.cond.Signal();
+    q.lock.Unlock();
+    if (ret)
+      continue;
+
+    index.entries.push_back(
+      object_index_entry(job->obj, cur_offset, job->bl.length()));
+    cur_offset += job->bl.length();
+    if (!dry_run) {
+      int r = job->bl.write_fd(file_fd);
+      if (r) {
+	ret = r;
+	q.lock.Lock();
+	q.next = q.jobs.size();
+	q.cond.Signal();
+	q.lock.Unlock();
+      }
     }
+    job->bl.clear();
   }
-  return 0;
+
+  for (vector<ExportWorker*>::iterator i = workers.begin();
+       i != workers.end();
+       ++i) {
+    (*i)->join();
+    delete *i;
+  }
+
+  return ret;
 }
 
 int set_inc_osdmap(ObjectStore *store, epoch_t e, bufferlist& bl, bool force) {
@@ -857,7 +974,8 @@ int ObjectStoreTool::do_export(ObjectStore *fs, coll_t coll, spg_t pgid,
   if (ret)
     return ret;
 
-  ret = export_files(fs, coll);
+  object_index_section index;
+  ret = export_files(fs, coll, index);
   if (ret) {
     cerr << "export_files error " << ret << std::endl;
     return ret;
@@ -867,6 +985,27 @@ int ObjectStoreTool::do_export(ObjectStore *fs, coll_t coll, spg_t pgid,
   if (ret)
     return ret;
 
+  // The object index and its trailing locator come after TYPE_PG_END,
+  // so older importers (which stop at TYPE_PG_END) are unaffected.
+  // Skip both if the output isn't seekable (e.g. a pipe); offsets would
+  // be meaningless and a reader couldn't find the locator anyway.
+  off_t index_off = dry_run ? -1 : ::lseek(file_fd, 0, SEEK_CUR);
+  if (index_off >= 0) {
+    ret = write_section(TYPE_OBJECT_INDEX, index, file_fd);
+    if (ret)
+      return ret;
+    index_locator loc;
+    loc.index_off = index_off;
+    bufferlist locbl;
+    loc.encode(locbl);
+    ret = locbl.write_fd(file_fd);
+    if (ret)
+      return ret;
+    if (debug)
+      cerr << "object index: " << index.entries.size()
+	   << " entries at offset " << index_off << std::endl;
+  }
+
   return 0;
 }
 
@@ -941,7 +1080,8 @@ int get_omap(ObjectStore *store, coll_t coll, ghobject_t hoid,
   return 0;
 }
 
-int ObjectStoreTool::get_object(ObjectStore *store, coll_t coll,
+int ObjectStoreTool::get_object(ObjectStore *store,
+    ObjectStore::Sequencer &osr, coll_t coll,
     bufferlist &bl, OSDMap &curmap, bool *skipped_objects)
 {
   ObjectStore::Transaction tran;
@@ -1035,8 +1175,14 @@ int ObjectStoreTool::get_object(ObjectStore *store, coll_t coll,
       return -EFAULT;
     }
   }
-  if (!dry_run)
-    store->apply_transaction(*t);
+  if (!dry_run) {
+    // Queue rather than apply so the next object's sections can be
+    // decoded while this one commits; do_import drains the sequencer
+    // before writing the pg metadata.
+    ObjectStore::Transaction *qt = new ObjectStore::Transaction;
+    qt->swap(tran);
+    store->queue_transaction_and_cleanup(&osr, qt);
+  }
   return 0;
 }
 
@@ -1216,6 +1362,7 @@ int ObjectStoreTool::do_import(ObjectStore *store, OSDSuperblock& sb,
   pg_info_t info;
   PGLog::IndexedLog log;
   bool skipped_objects = false;
+  ObjectStore::Sequencer osr("import");
 
   if (!dry_run)
     finish_remove_pgs(store);
@@ -1374,7 +1521,7 @@ int ObjectStoreTool::do_import(ObjectStore *store, OSDSuperblock& sb,
     }
     switch(type) {
     case TYPE_OBJECT_BEGIN:
-      ret = get_object(store, coll, ebl, curmap, &skipped_objects);
+      ret = get_object(store, osr, coll, ebl, curmap, &skipped_objects);
       if (ret) return ret;
       break;
     case TYPE_PG_METADATA:
@@ -1391,6 +1538,15 @@ int ObjectStoreTool::do_import(ObjectStore *store, OSDSuperblock& sb,
     }
   }
 
+  // Wait for all queued object transactions to apply and commit before
+  // the pg metadata is written, so it can't get ahead of the objects.
+  if (!dry_run) {
+    osr.flush();
+    C_SaferCond on_commit;
+    if (!osr.flush_commit(&on_commit))
+      on_commit.wait();
+  }
+
   if (!found_metadata) {
     cerr << "Missing metadata section" << std::endl;
     return -EFAULT;
@@ -1943,6 +2099,8 @@ int main(int argc, char **argv)
     ("skip-journal-replay", "Disable journal replay")
     ("skip-mount-omap", "Disable mounting of omap")
     ("dry-run", "Don't modify the objectstore")
+    ("threads", po::value<unsigned>(&export_threads)->default_value(4),
+     "number of concurrent object reads for export")
     ;
 
   po::options_description positional("Positional options");
@@ -30,11 +30,12 @@ class ObjectStoreTool : public RadosDump
           pg_info_t &info, epoch_t map_epoch, __u8 struct_ver,
           const OSDSuperblock& superblock,
           map<epoch_t,pg_interval_t> &past_intervals);
-    int get_object(ObjectStore *store, coll_t coll,
-        bufferlist &bl, OSDMap &curmap, bool *skipped_objects);
-    int export_file(
-        ObjectStore *store, coll_t cid, ghobject_t &obj);
-    int export_files(ObjectStore *store, coll_t coll);
+    int get_object(ObjectStore *store, ObjectStore::Sequencer &osr,
+        coll_t coll, bufferlist &bl, OSDMap &curmap, bool *skipped_objects);
+    int export_object(
+        ObjectStore *store, coll_t cid, ghobject_t &obj, bufferlist *out);
+    int export_files(ObjectStore *store, coll_t coll,
+        object_index_section &index);
 };
 
 #endif // CEPH_OBJECSTORE_TOOL_H_
@@ -17,12 +17,104 @@
 
 #include "common/ceph_argparse.h"
 #include "common/errno.h"
+#include "common/Thread.h"
 
 #include "global/global_init.h"
 #include "osd/OSDMap.h"
 
 using namespace std;
 
+// per-thread tallies for --test-map-pgs; merged after the join
+struct pg_map_counts_t {
+  vector<int> count;
+  vector<int> first_count;
+  vector<int> primary_count;
+  vector<int> size;
+  pg_map_counts_t(int n) : count(n, 0), first_count(n, 0),
+			   primary_count(n, 0), size(30, 0) {}
+};
+
+class MapPgsThread : public Thread {
+  const OSDMap& osdmap;
+  const vector<pg_t>& pgs;
+  unsigned begin, stride;
+  bool dump;
+public:
+  pg_map_counts_t counts;
+  MapPgsThread(const OSDMap& o, const vector<pg_t>& p,
+	       unsigned b, unsigned s, bool d)
+    : osdmap(o), pgs(p), begin(b), stride(s), dump(d),
+      counts(o.get_max_osd()) {}
+  void *entry() {
+    for (unsigned i = begin; i < pgs.size(); i += stride) {
+      pg_t pgid = pgs[i];
+      vector<int> osds;
+      int primary;
+      osdmap.pg_to_acting_osds(pgid, &osds, &primary);
+      counts.size[osds.size()]++;
+      if (dump)
+	cout << pgid << "\t" << osds << "\t" << primary << std::endl;
+      for (unsigned j=0; j<osds.size(); j++)
+	counts.count[osds[j]]++;
+      if (osds.size())
+	counts.first_count[osds[0]]++;
+      if (primary >= 0)
+	counts.primary_count[primary]++;
+    }
+    return NULL;
+  }
+};
+
+// per-thread movement tallies for --compare
+struct pg_compare_counts_t {
+  uint64_t pgs_changed;
+  uint64_t primaries_changed;
+  uint64_t slots_moved;	  ///< acting slots whose osd has no copy in the old map
+  uint64_t slots_total;
+  pg_compare_counts_t()
+    : pgs_changed(0), primaries_changed(0), slots_moved(0), slots_total(0) {}
+  void add(const pg_compare_counts_t& o) {
+    pgs_changed += o.pgs_changed;
+    primaries_changed += o.primaries_changed;
+    slots_moved += o.slots_moved;
+    slots_total += o.slots_total;
+  }
+};
+
+class ComparePgsThread : public Thread {
+  const OSDMap& osdmap;
+  const OSDMap& osdmap2;
+  const vector<pg_t>& pgs;
+  unsigned begin, stride;
+public:
+  map<int64_t,pg_compare_counts_t> counts;   // per pool
+  ComparePgsThread(const OSDMap& o, const OSDMap& o2, const vector<pg_t>& p,
+		   unsigned b, unsigned s)
+    : osdmap(o), osdmap2(o2), pgs(p), begin(b), stride(s) {}
+  void *entry() {
+    for (unsigned i = begin; i < pgs.size(); i += stride) {
+      pg_t pgid = pgs[i];
+      vector<int> up, acting, up2, acting2;
+      int up_primary, primary, up_primary2, primary2;
+      osdmap.pg_to_up_acting_osds(pgid, &up, &up_primary, &acting, &primary);
+      osdmap2.pg_to_up_acting_osds(pgid, &up2, &up_primary2,
+				   &acting2, &primary2);
+      pg_compare_counts_t& c = counts[pgid.pool()];
+      if (acting2 != acting)
+	c.pgs_changed++;
+      if (primary2 != primary)
+	c.primaries_changed++;
+      c.slots_total += acting2.size();
+      for (unsigned j=0; j<acting2.size(); j++) {
+	if (std::find(acting.begin(), acting.end(),
+		      acting2[j]) == acting.end())
+	  c.slots_moved++;
+      }
+    }
+    return NULL;
+  }
+};
+
 void usage()
 {
   cout << " usage: [--print] [--createsimple <numosd> [--clobber] [--pg_bits <bitsperosd>]] <mapfilename>" << std::endl;
@@ -30,6 +122,8 @@ void usage()
   cout << "   --import-crush <file>   replace osdmap's crush map with <file>" << std::endl;
   cout << "   --test-map-pgs [--pool <poolid>] map all pgs" << std::endl;
   cout << "   --test-map-pgs-dump [--pool <poolid>] map all pgs" << std::endl;
+  cout << "   --compare <mapfile>     map all pgs in both maps and report data movement" << std::endl;
+  cout << "   --threads <n>           spread mapping work over <n> threads" << std::endl;
   cout << "   --mark-up-in            mark osds up and in (but do not persist)" << std::endl;
   cout << "   --clear-temp            clear pg_temp and primary_temp" << std::endl;
   cout << "   --test-random           do random placements" << std::endl;
@@ -73,6 +167,8 @@ int main(int argc, const char **argv)
   bool test_map_pgs = false;
   bool test_map_pgs_dump = false;
   bool test_random = false;
+  std::string compare_file;
+  int nthreads = 1;
 
   std::string val;
   std::ostringstream err;
@@ -111,6 +207,17 @@ int main(int argc, const char **argv)
       test_map_pgs_dump = true;
     } else if (ceph_argparse_flag(args, i, "--test-random", (char*)NULL)) {
       test_random = true;
+    } else if (ceph_argparse_witharg(args, i, &val, "--compare", (char*)NULL)) {
+      compare_file = val;
+    } else if (ceph_argparse_witharg(args, i, &nthreads, err, "--threads", (char*)NULL)) {
+      if (!err.str().empty()) {
+	cerr << err.str() << std::endl;
+	exit(EXIT_FAILURE);
+      }
+      if (nthreads < 1) {
+	cerr << me << ": --threads must be >= 1" << std::endl;
+	exit(EXIT_FAILURE);
+      }
     } else if (ceph_argparse_flag(args, i, "--clobber", (char*)NULL)) {
       clobber = true;
     } else if (ceph_argparse_witharg(args, i, &pg_bits, err, "--pg_bits", (char*)NULL)) {
@@ -230,6 +337,7 @@ int main(int argc, const char **argv)
       osdmap.set_weight(i, CEPH_OSD_IN);
       osdmap.crush->adjust_item_weightf(g_ceph_context, i, 1.0);
     }
+    osdmap.invalidate_cached_crush();
   }
   if (clear_temp) {
     cout << "clearing pg/primary temp" << std::endl;
@@ -330,6 +438,10 @@ int main(int argc, const char **argv)
     vector<int> size(30, 0);
     if (test_random)
       srand(getpid());
+
+    // collect the pgs up front so the mapping work can be striped
+    // across threads
+    vector<pg_t> pgs;
     const map<int64_t,pg_pool_t>& pools = osdmap.get_pools();
     for (map<int64_t,pg_pool_t>::const_iterator p = pools.begin();
 	 p != pools.end(); ++p) {
@@ -337,34 +449,48 @@ int main(int argc, const char **argv)
 	continue;
       cout << "pool " << p->first
 	   << " pg_num " << p->second.get_pg_num() << std::endl;
-      for (unsigned i = 0; i < p->second.get_pg_num(); ++i) {
-	pg_t pgid = pg_t(i, p->first);
-
-	vector<int> osds;
-	int primary;
-	if (test_random) {
-	  osds.resize(p->second.size);
-	  for (unsigned i=0; i<osds.size(); ++i) {
-	    osds[i] = rand() % osdmap.get_max_osd();
-	  }
-	  primary = osds[0];
-	} else {
-	  osdmap.pg_to_acting_osds(pgid, &osds, &primary);
-	}
-	size[osds.size()]++;
+      for (unsigned i = 0; i < p->second.get_pg_num(); ++i)
+	pgs.push_back(pg_t(i, p->first));
+    }
 
+    if (test_random) {
+      // rand() is not usefully parallelizable; keep the legacy loop
+      for (unsigned i = 0; i < pgs.size(); ++i) {
+	const pg_pool_t *p = osdmap.get_pg_pool(pgs[i].pool());
+	vector<int> osds(p->size);
+	for (unsigned j=0; j<osds.size(); ++j)
+	  osds[j] = rand() % osdmap.get_max_osd();
+	int primary = osds[0];
+	size[osds.size()]++;
 	if (test_map_pgs_dump)
-	  cout << pgid << "\t" << osds << "\t" << primary << std::endl;
-
-	for (unsigned i=0; i<osds.size(); i++) {
-	  //cout << " rep " << i << " on " << osds[i] << std::endl;
-	  count[osds[i]]++;
-	}
+	  cout << pgs[i] << "\t" << osds << "\t" << primary << std::endl;
+	for (unsigned j=0; j<osds.size(); j++)
+	  count[osds[j]]++;
 	if (osds.size())
 	  first_count[osds[0]]++;
 	if (primary >= 0)
 	  primary_count[primary]++;
       }
+    } else {
+      // dump output must stay in pg order, so it is single threaded
+      unsigned threads = test_map_pgs_dump ? 1 : (unsigned)nthreads;
+      vector<MapPgsThread*> workers;
+      for (unsigned i = 0; i < threads; i++)
+	workers.push_back(new MapPgsThread(osdmap, pgs, i, threads,
+					   test_map_pgs_dump));
+      for (unsigned i = 0; i < threads; i++)
+	workers[i]->create();
+      for (unsigned i = 0; i < threads; i++) {
+	workers[i]->join();
+	for (int j=0; j<n; j++) {
+	  count[j] += workers[i]->counts.count[j];
+	  first_count[j] += workers[i]->counts.first_count[j];
+	  primary_count[j] += workers[i]->counts.primary_count[j];
+	}
+	for (unsigned j=0; j<size.size(); j++)
+	  size[j] += workers[i]->counts.size[j];
+	delete workers[i];
+      }
     }
 
     uint64_t total = 0;
@@ -426,6 +552,92 @@ int main(int argc, const char **argv)
       cout << "size " << i << "\t" << size[i] << std::endl;
     }
   }
+  if (!compare_file.empty()) {
+    OSDMap osdmap2;
+    bufferlist bl2;
+    std::string error;
+    r = bl2.read_file(compare_file.c_str(), &error);
+    if (r < 0) {
+      cerr << me << ": couldn't open " << compare_file << ": " << error
+	   << std::endl;
+      return -1;
+    }
+    try {
+      osdmap2.decode(bl2);
+    }
+    catch (const buffer::error &e) {
+      cerr << me << ": error decoding osdmap '" << compare_file << "'"
+	   << std::endl;
+      return -1;
+    }
+    cout << "comparing epoch " << osdmap.get_epoch()
+	 << " to epoch " << osdmap2.get_epoch()
+	 << " (" << compare_file << ")" << std::endl;
+
+    // map every pg both maps know about; a pg only in one map is all
+    // new (or all gone) and not interesting for a reweight plan.
+    vector<pg_t> pgs;
+    const map<int64_t,pg_pool_t>& pools = osdmap.get_pools();
+    for (map<int64_t,pg_pool_t>::const_iterator p = pools.begin();
+	 p != pools.end(); ++p) {
+      if (pool != -1 && p->first != pool)
+	continue;
+      if (!osdmap2.have_pg_pool(p->first)) {
+	cout << "pool " << p->first << " only exists in " << fn
+	     << "; skipping" << std::endl;
+	continue;
+      }
+      unsigned pg_num = MIN(p->second.get_pg_num(),
+			    osdmap2.get_pg_pool(p->first)->get_pg_num());
+      for (unsigned i = 0; i < pg_num; ++i)
+	pgs.push_back(pg_t(i, p->first));
+    }
+
+    map<int64_t,pg_compare_counts_t> counts;
+    vector<ComparePgsThread*> workers;
+    for (int i = 0; i < nthreads; i++)
+      workers.push_back(new ComparePgsThread(osdmap, osdmap2, pgs,
+					     i, nthreads));
+    for (int i = 0; i < nthreads; i++)
+      workers[i]->create();
+    for (int i = 0; i < nthreads; i++) {
+      workers[i]->join();
+      for (map<int64_t,pg_compare_counts_t>::iterator p =
+	     workers[i]->counts.begin();
+	   p != workers[i]->counts.end(); ++p)
+	counts[p->first].add(p->second);
+      delete workers[i];
+    }
+
+    pg_compare_counts_t total;
+    cout << "#pool\tpgs\tmoved\tprim\tslots\tmoved\t%data" << std::endl;
+    for (map<int64_t,pg_compare_counts_t>::iterator p = counts.begin();
+	 p != counts.end(); ++p) {
+      const pg_pool_t *pgpool = osdmap.get_pg_pool(p->first);
+      cout << p->first
+	   << "\t" << pgpool->get_pg_num()
+	   << "\t" << p->second.pgs_changed
+	   << "\t" << p->second.primaries_changed
+	   << "\t" << p->second.slots_total
+	   << "\t" << p->second.slots_moved
+	   << "\t" << (p->second.slots_total ?
+		       (100.0 * p->second.slots_moved /
+			p->second.slots_total) : 0.0)
+	   << std::endl;
+      total.add(p->second);
+    }
+    cout << "total\t" << pgs.size()
+	 << "\t" << total.pgs_changed
+	 << "\t" << total.primaries_changed
+	 << "\t" << total.slots_total
+	 << "\t" << total.slots_moved
+	 << "\t" << (total.slots_total ?
+		     (100.0 * total.slots_moved / total.slots_total) : 0.0)
+	 << std::endl;
+    cout << "(moved slots are acting-set members with no copy in the old"
+	 << " acting set;\n %data assumes pgs within a pool are equally"
+	 << " sized)" << std::endl;
+  }
   if (test_crush) {
     int pass = 0;
     while (1) {
@@ -460,7 +672,7 @@ int main(int argc, const char **argv)
   if (!print && !tree && !modified &&
       export_crush.empty() && import_crush.empty() && 
       test_map_pg.empty() && test_map_object.empty() &&
-      !test_map_pgs && !test_map_pgs_dump) {
+      !test_map_pgs && !test_map_pgs_dump && compare_file.empty()) {
     cerr << me << ": no action specified?" << std::endl;
     usage();
   }
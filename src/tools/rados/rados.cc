@@ -23,6 +23,7 @@ using namespace libradosstriper;
 #include "common/ceph_argparse.h"
 #include "global/global_init.h"
 #include "common/Cond.h"
+#include "common/Thread.h"
 #include "common/debug.h"
 #include "common/errno.h"
 #include "common/Formatter.h"
@@ -96,10 +97,15 @@ void usage(ostream& out)
 "   rollback <obj-name> <snap-name>  roll back object to snap <snap-name>\n"
 "\n"
 "   listsnaps <obj-name>             list the snapshots of this object\n"
-"   bench <seconds> write|seq|rand [-t concurrent_operations] [--no-cleanup] [--run-name run_name]\n"
+"   bench <seconds> write|seq|rand|mix [-t concurrent_operations] [--no-cleanup] [--run-name run_name]\n"
+"                                    [--rw-mix-read percent] [--num-clients n --client-id i]\n"
 "                                    default is 16 concurrent IOs and 4 MB ops\n"
 "                                    default is to clean up after write benchmark\n"
 "                                    default run-name is 'benchmark_last_metadata'\n"
+"                                    mix reads and rewrites objects from a previous write run;\n"
+"                                    --rw-mix-read sets the percent of ops that are reads (default 50)\n"
+"                                    coordinated clients share a start barrier and client 0 prints\n"
+"                                    merged results; write clients need distinct run-names\n"
 "   cleanup [--run-name run_name] [--prefix prefix]\n"
 "                                    clean up a previous benchmark operation\n"
 "                                    default run-name is 'benchmark_last_metadata'\n"
@@ -182,6 +188,8 @@ void usage(ostream& out)
 "        Use radostriper interface rather than pure rados\n"
 "        Available for stat, get, put, truncate, rm, ls and \n"
 "        all xattr related operations\n"
+"   --parallel=N\n"
+"        Use with ls to list N pg slices of the pool in parallel\n"
 "\n"
 "BENCH OPTIONS:\n"
 "   -t N\n"
@@ -920,6 +928,84 @@ public:
   ~RadosBencher() { }
 };
 
+/// lists one pg slice of a pool on its own connection; used by "ls --parallel"
+class ParallelLsWorker : public Thread {
+  Rados &rados;
+  const char *pool_name;
+  const string nspace;
+  bool wildcard;
+  bool use_striper;
+  Formatter *formatter;
+  ostream *outstream;
+  Mutex *out_lock;
+  uint32_t begin_pos;
+  uint32_t end_pos;
+public:
+  int r;
+  ParallelLsWorker(Rados &rados, const char *pool_name, const string& nspace,
+		   bool wildcard, bool use_striper, Formatter *formatter,
+		   ostream *outstream, Mutex *out_lock,
+		   uint32_t begin_pos, uint32_t end_pos)
+    : rados(rados), pool_name(pool_name), nspace(nspace),
+      wildcard(wildcard), use_striper(use_striper), formatter(formatter),
+      outstream(outstream), out_lock(out_lock),
+      begin_pos(begin_pos), end_pos(end_pos), r(0) {}
+
+  void *entry() {
+    IoCtx ctx;
+    r = rados.ioctx_create(pool_name, ctx);
+    if (r < 0)
+      return NULL;
+    if (wildcard)
+      ctx.set_namespace(all_nspaces);
+    else if (nspace.size())
+      ctx.set_namespace(nspace);
+    try {
+      librados::NObjectIterator i = ctx.nobjects_begin(begin_pos, end_pos);
+      librados::NObjectIterator i_end = ctx.nobjects_end();
+      for (; i != i_end; ++i) {
+	if (use_striper) {
+	  // only list the first object of each striped object, without
+	  // its suffix '.000...000'
+	  size_t l = i->get_oid().length();
+	  if (l <= 17 ||
+	      (0 != i->get_oid().compare(l-17, 17, ".0000000000000000")))
+	    continue;
+	}
+	Mutex::Locker lck(*out_lock);
+	if (!formatter) {
+	  // Only include namespace in output when wildcard specified
+	  if (wildcard)
+	    *outstream << i->get_nspace() << "\t";
+	  if (use_striper) {
+	    *outstream << i->get_oid().substr(0, i->get_oid().length()-17);
+	  } else {
+	    *outstream << i->get_oid();
+	  }
+	  if (i->get_locator().size())
+	    *outstream << "\t" << i->get_locator();
+	  *outstream << std::endl;
+	} else {
+	  formatter->open_object_section("object");
+	  formatter->dump_string("namespace", i->get_nspace());
+	  if (use_striper) {
+	    formatter->dump_string("name", i->get_oid().substr(0, i->get_oid().length()-17));
+	  } else {
+	    formatter->dump_string("name", i->get_oid());
+	  }
+	  if (i->get_locator().size())
+	    formatter->dump_string("locator", i->get_locator());
+	  formatter->close_section(); //object
+	}
+      }
+    } catch (const std::runtime_error& e) {
+      cerr << e.what() << std::endl;
+      r = -1;
+    }
+    return NULL;
+  }
+};
+
 static int do_lock_cmd(std::vector<const char*> &nargs,
                        const std::map < std::string, std::string > &opts,
                        IoCtx *ioctx,
@@ -1180,6 +1266,7 @@ static int rados_tool_common(const std::map < std::string, std::string > &opts,
   const char *target_pool_name = NULL;
   string oloc, target_oloc, nspace, target_nspace;
   int concurrent_ios = 16;
+  int list_parallel = 0;
   unsigned op_size = default_op_size;
   bool block_size_specified = false;
   bool cleanup = true;
@@ -1205,6 +1292,9 @@ static int rados_tool_common(const std::map < std::string, std::string > &opts,
 
   std::string run_name;
   std::string prefix;
+  int rw_mix_read = 50;
+  int bench_num_clients = 1;
+  int bench_client_id = 0;
 
   Formatter *formatter = NULL;
   bool pretty_format = false;
@@ -1243,10 +1333,34 @@ static int rados_tool_common(const std::map < std::string, std::string > &opts,
       return -EINVAL;
     }
   }
+  i = opts.find("parallel");
+  if (i != opts.end()) {
+    if (rados_sistrtoll(i, &list_parallel)) {
+      return -EINVAL;
+    }
+  }
   i = opts.find("run-name");
   if (i != opts.end()) {
     run_name = i->second;
   }
+  i = opts.find("rw-mix-read");
+  if (i != opts.end()) {
+    if (rados_sistrtoll(i, &rw_mix_read)) {
+      return -EINVAL;
+    }
+  }
+  i = opts.find("num-clients");
+  if (i != opts.end()) {
+    if (rados_sistrtoll(i, &bench_num_clients)) {
+      return -EINVAL;
+    }
+  }
+  i = opts.find("client-id");
+  if (i != opts.end()) {
+    if (rados_sistrtoll(i, &bench_client_id)) {
+      return -EINVAL;
+    }
+  }
   i = opts.find("prefix");
   if (i != opts.end()) {
     prefix = i->second;
@@ -1581,7 +1695,38 @@ static int rados_tool_common(const std::map < std::string, std::string > &opts,
     {
       if (formatter)
         formatter->open_array_section("objects");
-      try {
+      if (list_parallel > 1) {
+	int pg_num = io_ctx.pool_get_pg_num();
+	if (pg_num < 0) {
+	  cerr << "error getting pg count for pool " << pool_name << ": "
+	       << cpp_strerror(pg_num) << std::endl;
+	  ret = pg_num;
+	  goto out;
+	}
+	// shard the pg space across the workers; each lists its own
+	// disjoint slice on a separate connection
+	int workers = list_parallel < pg_num ? list_parallel : pg_num;
+	Mutex out_lock("rados:ls");
+	vector<ParallelLsWorker*> lsw;
+	for (int w = 0; w < workers; w++) {
+	  lsw.push_back(
+	    new ParallelLsWorker(rados, pool_name, nspace, wildcard,
+				 use_striper, formatter, outstream, &out_lock,
+				 (uint32_t)((uint64_t)pg_num * w / workers),
+				 (uint32_t)((uint64_t)pg_num * (w + 1) / workers)));
+	  lsw.back()->create();
+	}
+	for (vector<ParallelLsWorker*>::iterator w = lsw.begin();
+	     w != lsw.end();
+	     ++w) {
+	  (*w)->join();
+	  if ((*w)->r < 0)
+	    ret = -1;
+	  delete *w;
+	}
+	if (ret < 0)
+	  goto out;
+      } else try {
 	librados::NObjectIterator i = io_ctx.nobjects_begin();
 	librados::NObjectIterator i_end = io_ctx.nobjects_end();
 	for (; i != i_end; ++i) {
@@ -2398,6 +2543,8 @@ static int rados_tool_common(const std::map < std::string, std::string > &opts,
       operation = OP_SEQ_READ;
     else if (strcmp(nargs[2], "rand") == 0)
       operation = OP_RAND_READ;
+    else if (strcmp(nargs[2], "mix") == 0)
+      operation = OP_RW_MIX;
     else
       usage_exit();
     if (block_size_specified && (operation != OP_WRITE)){
@@ -2406,10 +2553,23 @@ static int rados_tool_common(const std::map < std::string, std::string > &opts,
       ret = -EINVAL;
       goto out;
     }
+    if (rw_mix_read < 0 || rw_mix_read > 100) {
+      cerr << "--rw-mix-read must be between 0 and 100" << std::endl;
+      ret = -EINVAL;
+      goto out;
+    }
+    if (bench_num_clients < 1 || bench_client_id < 0 ||
+	bench_client_id >= bench_num_clients) {
+      cerr << "--client-id must be between 0 and num-clients - 1" << std::endl;
+      ret = -EINVAL;
+      goto out;
+    }
     RadosBencher bencher(g_ceph_context, rados, io_ctx);
     bencher.set_show_time(show_time);
+    bencher.set_multi_client(bench_num_clients, bench_client_id);
     ret = bencher.aio_bench(operation, seconds,
-			    concurrent_ios, op_size, cleanup, run_name, no_verify);
+			    concurrent_ios, op_size, cleanup, run_name, no_verify,
+			    rw_mix_read);
     if (ret != 0)
       cerr << "error during benchmark: " << ret << std::endl;
   }
@@ -2862,6 +3022,12 @@ int main(int argc, const char **argv)
       opts["no-verify"] = "true";
     } else if (ceph_argparse_witharg(args, i, &val, "--run-name", (char*)NULL)) {
       opts["run-name"] = val;
+    } else if (ceph_argparse_witharg(args, i, &val, "--rw-mix-read", (char*)NULL)) {
+      opts["rw-mix-read"] = val;
+    } else if (ceph_argparse_witharg(args, i, &val, "--num-clients", (char*)NULL)) {
+      opts["num-clients"] = val;
+    } else if (ceph_argparse_witharg(args, i, &val, "--client-id", (char*)NULL)) {
+      opts["client-id"] = val;
     } else if (ceph_argparse_witharg(args, i, &val, "--prefix", (char*)NULL)) {
       opts["prefix"] = val;
     } else if (ceph_argparse_witharg(args, i, &val, "-p", "--pool", (char*)NULL)) {
@@ -2878,6 +3044,8 @@ int main(int argc, const char **argv)
       opts["striper"] = "true";
     } else if (ceph_argparse_witharg(args, i, &val, "-t", "--concurrent-ios", (char*)NULL)) {
       opts["concurrent-ios"] = val;
+    } else if (ceph_argparse_witharg(args, i, &val, "--parallel", (char*)NULL)) {
+      opts["parallel"] = val;
     } else if (ceph_argparse_witharg(args, i, &val, "--block-size", (char*)NULL)) {
       opts["block-size"] = val;
     } else if (ceph_argparse_witharg(args, i, &val, "-b", (char*)NULL)) {